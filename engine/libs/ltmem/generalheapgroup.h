@@ -70,6 +70,9 @@ public:
 	// get the general heap that this memory is in
 	inline CGeneralHeap* GetGeneralHeap(void* pMem);
 
+	// bytes allocated for the heaps
+	uint32 GetFootprint() { return m_nFootprint; };
+
 	// memory allocations for this class will go though system malloc and free
     void* operator new(size_t size) {	return malloc(size); }
     void operator delete(void* p) { free(p); };
@@ -101,6 +104,9 @@ private:
 	// alignment for heap
 	uint32 m_nHeapAlign;
 
+	// total size of all of the heaps
+	uint32 m_nFootprint;
+
 	// contains a pointer to the first item in the heap list
 	CGeneralHeapItem* m_pHeapList;
 };
@@ -111,6 +117,8 @@ inline bool CGeneralHeapGroup::Init(
 		uint32 nGrowHeapSize,
 		uint32 nHeapAlign)
 {
+	m_nFootprint = 0;
+
 	// check if we are supposed to allocate initial heap space
 	if (nInitialHeapSize > 0)
 	{
@@ -192,6 +200,8 @@ inline bool CGeneralHeapGroup::AddHeap(
 	pNewHeap->m_pNext = m_pHeapList;
 	m_pHeapList = pNewHeap;
 
+	m_nFootprint += nHeapSize;
+
 	return true;
 }
 
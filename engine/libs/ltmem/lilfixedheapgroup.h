@@ -17,6 +17,8 @@
 #include "lilfixedheap.h"
 #endif
 
+#include <atomic>
+
 class CLilFixedHeapGroup 
 {
 public:
@@ -61,6 +63,8 @@ public:
 	inline bool Free(void* pFreeMem);
 
 	// check if this memory is in this heap
+	// (this is safe to call while another thread is allocating, since heaps are
+	// only ever added to the front of the list, and only once they are set up)
 	inline bool InHeap(void* pMem);
 
 	// memory allocations for this class will go though system malloc and free
@@ -91,7 +95,7 @@ private:
 	uint32 m_nGrowElemSize;
 
 	// contains a pointer to the first item in the heap list
-	CLilFixedHeapItem* m_pHeapList;
+	std::atomic<CLilFixedHeapItem*> m_pHeapList;
 };
 
 
@@ -104,16 +108,19 @@ inline bool CLilFixedHeapGroup::Init(
 	if (nInitialNumElements > 0)
 	{
 		// allocate initial heap item
-		m_pHeapList = new CLilFixedHeapItem;
-//		m_pHeapList = (CLilFixedHeapItem*)malloc(sizeof(CLilFixedHeapItem));
-		m_pHeapList->m_pNext = NULL;
-		if (m_pHeapList == NULL) return false;
+		CLilFixedHeapItem* pFirstHeap = new CLilFixedHeapItem;
+//		pFirstHeap = (CLilFixedHeapItem*)malloc(sizeof(CLilFixedHeapItem));
+		m_pHeapList = NULL;
+		if (pFirstHeap == NULL) return false;
+		pFirstHeap->m_pNext = NULL;
 
 		// initialize initial heap item
-		if (!m_pHeapList->m_heap.Init(nElemSizeBytes, nInitialNumElements))
+		if (!pFirstHeap->m_heap.Init(nElemSizeBytes, nInitialNumElements))
 		{
+			delete pFirstHeap;
 			return false;
 		}
+		m_pHeapList = pFirstHeap;
 	}
 
 	else
@@ -140,13 +147,15 @@ inline void CLilFixedHeapGroup::Term()
 	if (!m_bInitialized) return;
 
 	// go through list and delete all heaps
-	while (m_pHeapList != NULL)
+	CLilFixedHeapItem* pCurHeap = m_pHeapList;
+	m_pHeapList = NULL;
+	while (pCurHeap != NULL)
 	{
-		CLilFixedHeapItem* pNextHeapList = m_pHeapList->m_pNext;
-		m_pHeapList->m_heap.Term();
-		delete m_pHeapList;
-//		free(m_pHeapList);
-		m_pHeapList = pNextHeapList;
+		CLilFixedHeapItem* pNextHeapList = pCurHeap->m_pNext;
+		pCurHeap->m_heap.Term();
+		delete pCurHeap;
+//		free(pCurHeap);
+		pCurHeap = pNextHeapList;
 	}
 
 	// class is no longer initialized
@@ -192,7 +201,8 @@ inline void* CLilFixedHeapGroup::Alloc()
 		return NULL;
 	}
 	pMem = pCurHeap->m_heap.Alloc();
-	m_pHeapList = pCurHeap;
+	// it's all set up, so it can go in the list
+	m_pHeapList.store(pCurHeap, std::memory_order_release);
 
 	// return memory we allocated
 	return pMem;
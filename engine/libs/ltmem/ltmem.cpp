@@ -7,6 +7,13 @@
 #include "ltmemheap.h"
 #include "ltmemdebug.h"
 #include "ltmemtrack.h"
+#include "ltmemcache.h"
+
+// The thread caches only hold bare heap memory, so they're not used when the
+// memory is being tracked or debugged (those keep global lists of every block)
+#if !defined(LTMEMDEBUG) && !defined(LTMEMTRACK)
+#define LTMEMUSETHREADCACHE
+#endif
 
 ///////////////////////////////////////////////////////////////////////////////////////////
 // ltheap global variables
@@ -119,6 +126,12 @@ void* LTMemAlloc(uint32 nSize)
 	// make sure memory system is initialize
 	if (g_bLTMemInitialized == false) LTMemInit();
 
+#ifdef LTMEMUSETHREADCACHE
+	// small allocations come out of this thread's cache
+	pRet = LTMemCacheAlloc(nSize);
+	if (pRet != NULL) return pRet;
+#endif
+
 	// Request ownership of the LTMem critical section.
 	EnterCriticalSection(&g_LTMemCriticalSection); 
 
@@ -135,6 +148,11 @@ void* LTMemAlloc(uint32 nSize)
     // Release ownership of the LTMem critical section.
     LeaveCriticalSection(&g_LTMemCriticalSection);
 
+#if defined(LTMEMTRACK) && !defined(LTMEMDEBUG)
+	// now that the other threads can get at the heap again, write out the allocation trace if it's due
+	LTMemTrackTraceWrite();
+#endif
+
 	return pRet;
 
 #else
@@ -147,6 +165,11 @@ void* LTMemAlloc(uint32 nSize)
 void LTMemFree(void* pMem)
 {
 #ifdef USELTMEM
+#ifdef LTMEMUSETHREADCACHE
+	// small allocations go back into this thread's cache
+	if (LTMemCacheFree(pMem)) return;
+#endif
+
 	// Request ownership of the LTMem critical section.
 	EnterCriticalSection(&g_LTMemCriticalSection); 
 
@@ -163,6 +186,11 @@ void LTMemFree(void* pMem)
     // Release ownership of the LTMem critical section.
     LeaveCriticalSection(&g_LTMemCriticalSection);
 
+#if defined(LTMEMTRACK) && !defined(LTMEMDEBUG)
+	// now that the other threads can get at the heap again, write out the allocation trace if it's due
+	LTMemTrackTraceWrite();
+#endif
+
 #else
 	free(pMem);
 #endif
@@ -175,6 +203,19 @@ void* LTMemReAlloc(void* pOldMem, uint32 nNewSize)
 #ifdef USELTMEM
 	void* pRet;
 
+#ifdef LTMEMUSETHREADCACHE
+	// memory from the thread caches gets moved without the critical section
+	uint32 nOldSize = LTMemCacheGetSize(pOldMem);
+	if (nOldSize != 0)
+	{
+		pRet = LTMemAlloc(nNewSize);
+		if (pRet == NULL) return NULL;
+		memcpy(pRet, pOldMem, LTMIN(nOldSize, nNewSize));
+		LTMemFree(pOldMem);
+		return pRet;
+	}
+#endif
+
 	// Request ownership of the LTMem critical section.
 	EnterCriticalSection(&g_LTMemCriticalSection); 
 
@@ -191,6 +232,11 @@ void* LTMemReAlloc(void* pOldMem, uint32 nNewSize)
     // Release ownership of the LTMem critical section.
     LeaveCriticalSection(&g_LTMemCriticalSection);
 
+#if defined(LTMEMTRACK) && !defined(LTMEMDEBUG)
+	// now that the other threads can get at the heap again, write out the allocation trace if it's due
+	LTMemTrackTraceWrite();
+#endif
+
 	return pRet;
 
 #else
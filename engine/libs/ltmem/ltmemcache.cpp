@@ -0,0 +1,141 @@
+#include "stdafx.h"
+#ifdef _WIN32
+#include "windows.h"
+#endif
+#include "ltmem.h"
+#include "ltmemheap.h"
+#include "ltmemcache.h"
+
+#ifdef USELTMEM
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// ltmemcache global variables
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// true if lt mem system is initialized
+extern bool g_bLTMemInitialized;
+
+// critical section to make heap thread safe
+extern CRITICAL_SECTION g_LTMemCriticalSection; 
+
+enum
+{
+	// pieces of memory moved between a thread's cache and a simple heap at a time
+	k_nLTMemCacheBatch = 32,
+	// most pieces of each size a thread will cache before giving some back
+	k_nLTMemCacheMax = k_nLTMemCacheBatch * 4
+};
+
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// thread cache
+///////////////////////////////////////////////////////////////////////////////////////////
+
+class CLTMemThreadCache
+{
+public:
+	CLTMemThreadCache();
+
+	// give everything back to the simple heaps when the thread exits
+	~CLTMemThreadCache();
+
+	// free memory for one of the simple heaps (the end of the list is used first)
+	struct CList
+	{
+		void* m_pMem[k_nLTMemCacheMax + 1];
+		uint32 m_nCount;
+	};
+	CList m_aLists[LTMEMHEAPNUMSIMPLEHEAPSIZES];
+};
+
+static thread_local CLTMemThreadCache t_LTMemThreadCache;
+
+CLTMemThreadCache::CLTMemThreadCache()
+{
+	for (uint32 n = 0; n < LTMEMHEAPNUMSIMPLEHEAPSIZES; n++)
+	{
+		m_aLists[n].m_nCount = 0;
+	}
+}
+
+CLTMemThreadCache::~CLTMemThreadCache()
+{
+	// the heaps are already gone if the memory system has shut down
+	if (!g_bLTMemInitialized) return;
+
+	EnterCriticalSection(&g_LTMemCriticalSection); 
+
+	for (uint32 n = 0; n < LTMEMHEAPNUMSIMPLEHEAPSIZES; n++)
+	{
+		LTMemHeapFreeSimple(n, m_aLists[n].m_pMem, m_aLists[n].m_nCount);
+		m_aLists[n].m_nCount = 0;
+	}
+
+	LeaveCriticalSection(&g_LTMemCriticalSection);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// LTMemCache functions
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// allocate memory from this thread's cache
+void* LTMemCacheAlloc(uint32 nSize)
+{
+	uint32 nHeap = LTMemHeapGetSimpleHeap(nSize);
+	if (nHeap >= LTMEMHEAPNUMSIMPLEHEAPSIZES) return NULL;
+
+	CLTMemThreadCache::CList& cList = t_LTMemThreadCache.m_aLists[nHeap];
+
+	// get a batch from the simple heap if we're out
+	if (cList.m_nCount == 0)
+	{
+		EnterCriticalSection(&g_LTMemCriticalSection); 
+		cList.m_nCount = LTMemHeapAllocSimple(nHeap, cList.m_pMem, k_nLTMemCacheBatch);
+		LeaveCriticalSection(&g_LTMemCriticalSection);
+
+		if (cList.m_nCount == 0) return NULL;
+	}
+
+	return cList.m_pMem[--cList.m_nCount];
+}
+
+
+// free memory into this thread's cache
+bool LTMemCacheFree(void* pMem)
+{
+	if (pMem == NULL) return false;
+
+	uint32 nHeap = LTMemHeapFindSimpleHeap(pMem);
+	if (nHeap >= LTMEMHEAPNUMSIMPLEHEAPSIZES) return false;
+
+	CLTMemThreadCache::CList& cList = t_LTMemThreadCache.m_aLists[nHeap];
+	cList.m_pMem[cList.m_nCount++] = pMem;
+
+	// give the ones that have been sitting around longest back if we have too many
+	if (cList.m_nCount > k_nLTMemCacheMax)
+	{
+		EnterCriticalSection(&g_LTMemCriticalSection); 
+		LTMemHeapFreeSimple(nHeap, cList.m_pMem, k_nLTMemCacheBatch);
+		LeaveCriticalSection(&g_LTMemCriticalSection);
+
+		cList.m_nCount -= k_nLTMemCacheBatch;
+		memmove(cList.m_pMem, &cList.m_pMem[k_nLTMemCacheBatch], cList.m_nCount * sizeof(void*));
+	}
+
+	return true;
+}
+
+
+// get the size of memory from the simple heaps
+uint32 LTMemCacheGetSize(void* pMem)
+{
+	if (pMem == NULL) return 0;
+
+	uint32 nHeap = LTMemHeapFindSimpleHeap(pMem);
+	if (nHeap >= LTMEMHEAPNUMSIMPLEHEAPSIZES) return 0;
+
+	return g_nSimpleHeapSizes[nHeap];
+}
+
+#endif
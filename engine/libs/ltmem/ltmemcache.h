@@ -0,0 +1,18 @@
+
+#ifndef __LTMEMCACHE_H__
+#define __LTMEMCACHE_H__
+
+// Each thread keeps a cache of free memory for each of the simple heap sizes, and
+// only enters the LTMem critical section to move a batch of it between its cache
+// and the simple heaps.  Anything bigger goes to the general heap as usual.
+
+// Allocate memory from this thread's cache (NULL if it's too big for the simple heaps)
+void* LTMemCacheAlloc(uint32 nSize);
+
+// Free memory into this thread's cache (false if it's not from the simple heaps)
+bool LTMemCacheFree(void* pMem);
+
+// Get the size of memory from the simple heaps (0 if it's not from them)
+uint32 LTMemCacheGetSize(void* pMem);
+
+#endif
@@ -3,6 +3,7 @@
 #include "ltmem.h"
 #include "ltmemheap.h"
 #include "generalheapgroup.h"
+#include "sizeclassheap.h"
 
 // define if we are using the simple heaps
 #define LTMEMUSESIMPLEHEAP
@@ -10,6 +11,10 @@
 // define if we are using the general heap
 #define LTMEMUSEGENERALHEAP
 
+// define to use the size class heap as the general heap instead of CGeneralHeapGroup
+// (CGeneralHeapGroup keeps pointers in 32 bits so it only works in 32 bit builds)
+#define LTMEMUSESIZECLASSHEAP
+
 
 ///////////////////////////////////////////////////////////////////////////////////////////
 // ltheap global variables
@@ -23,10 +28,8 @@ bool g_bLTMemHeapInitialized = false;
 // simple heaps
 ///////////////////////////////////////////////////////////////////////////////////////////
 
-#define LTMEMHEAPNUMSIMPLEHEAPSIZES 4
-
 // size of the simple heaps 
-uint32 g_nSimpleHeapSizes[] = { 16, 32, 48, 64 };
+uint32 g_nSimpleHeapSizes[LTMEMHEAPNUMSIMPLEHEAPSIZES] = { 16, 32, 48, 64 };
 
 // initial number of items in each of the simple heap 
 uint32 g_nSimpleHeapNumItems[] = { 10000, 5000, 5000, 5000 };
@@ -35,7 +38,7 @@ uint32 g_nSimpleHeapNumItems[] = { 10000, 5000, 5000, 5000 };
 uint32 g_nSimpleHeapGrowItems[] = { 10000, 5000, 5000, 5000 };
 
 // array of simple heaps
-CLilFixedHeapGroup g_arySimpleHeaps[4];
+CLilFixedHeapGroup g_arySimpleHeaps[LTMEMHEAPNUMSIMPLEHEAPSIZES];
 
 
 ///////////////////////////////////////////////////////////////////////////////////////////
@@ -50,9 +53,22 @@ const uint32 g_nGeneralHeapGrowSize = 1024*1024*16;
 // alignment of the general heap
 const uint32 g_nGeneralHeapAlign = 16;
 
+#ifdef LTMEMUSESIZECLASSHEAP
+
+// true to try to put the general heap arenas, and the big blocks that world and model
+// data are loaded into, in huge pages
+const bool g_bGeneralHeapHugePages = false;
+
+// general heap
+CSizeClassHeap g_GeneralHeap;
+
+#else
+
 // general heap
 CGeneralHeapGroup g_GeneralHeap;
 
+#endif
+
 
 // Initialize the LTMemHeap
 void LTMemHeapInit()
@@ -74,7 +90,11 @@ void LTMemHeapInit()
 	if (can_use_general_heap)
 	{
 		// initialize the general heap
+#ifdef LTMEMUSESIZECLASSHEAP
+		g_GeneralHeap.Init(g_nGeneralHeapSize, g_nGeneralHeapGrowSize, g_nGeneralHeapAlign, g_bGeneralHeapHugePages);
+#else
 		g_GeneralHeap.Init(g_nGeneralHeapSize, g_nGeneralHeapGrowSize, g_nGeneralHeapAlign);
+#endif
 	}
 }
 
@@ -105,14 +125,10 @@ void* LTMemHeapAlloc(uint32 nSize)
 	void* pMem = NULL;
 
 	// see if this memory fits in a simple heap
+	uint32 nSimpleHeap = LTMemHeapGetSimpleHeap(nSize);
+	if (nSimpleHeap < LTMEMHEAPNUMSIMPLEHEAPSIZES)
 	{
-		for (uint32 n = 0; n < LTMEMHEAPNUMSIMPLEHEAPSIZES; n++)
-		{
-			if (nSize <= g_nSimpleHeapSizes[n])
-			{
-				pMem = g_arySimpleHeaps[n].Alloc();
-			}
-		}
+		pMem = g_arySimpleHeaps[nSimpleHeap].Alloc();
 	}
 
 	// if we didn't allocate in simple heap try general heap
@@ -210,7 +226,7 @@ void* LTMemHeapReAlloc(void* pMem, uint32 nNewSize)
 	LTMemHeapFree(pMem);	
 
 	// return value
-	return pMem;
+	return pNewMem;
 }
 
 
@@ -247,3 +263,65 @@ uint32 LTMemHeapGetSize(void* pMem)
 
 	return nSize;
 }
+
+
+// get the simple heap that memory of this size comes from
+uint32 LTMemHeapGetSimpleHeap(uint32 nSize)
+{
+	for (uint32 n = 0; n < LTMEMHEAPNUMSIMPLEHEAPSIZES; n++)
+	{
+		if (nSize <= g_nSimpleHeapSizes[n])
+		{
+			return n;
+		}
+	}
+
+	return LTMEMHEAPNUMSIMPLEHEAPSIZES;
+}
+
+
+// find the simple heap that this memory is in
+uint32 LTMemHeapFindSimpleHeap(void* pMem)
+{
+	// the simple heaps can't be in the middle of being set up or torn down
+	if (!g_bLTMemHeapInitialized) return LTMEMHEAPNUMSIMPLEHEAPSIZES;
+
+	for (uint32 n = 0; n < LTMEMHEAPNUMSIMPLEHEAPSIZES; n++)
+	{
+		if (g_arySimpleHeaps[n].InHeap(pMem))
+		{
+			return n;
+		}
+	}
+
+	return LTMEMHEAPNUMSIMPLEHEAPSIZES;
+}
+
+
+// allocate a batch of memory from a simple heap
+uint32 LTMemHeapAllocSimple(uint32 nHeap, void** pMemList, uint32 nCount)
+{
+	ASSERT(nHeap < LTMEMHEAPNUMSIMPLEHEAPSIZES);
+
+	uint32 nAllocated = 0;
+	while (nAllocated < nCount)
+	{
+		void* pMem = g_arySimpleHeaps[nHeap].Alloc();
+		if (pMem == NULL) break;
+		pMemList[nAllocated++] = pMem;
+	}
+
+	return nAllocated;
+}
+
+
+// free a batch of memory back to a simple heap
+void LTMemHeapFreeSimple(uint32 nHeap, void** pMemList, uint32 nCount)
+{
+	ASSERT(nHeap < LTMEMHEAPNUMSIMPLEHEAPSIZES);
+
+	for (uint32 n = 0; n < nCount; n++)
+	{
+		g_arySimpleHeaps[nHeap].Free(pMemList[n]);
+	}
+}
@@ -6,6 +6,10 @@
 #include "generalheapgroup.h"
 #endif
 
+#ifndef __SIZECLASSHEAP_H__
+#include "sizeclassheap.h"
+#endif
+
 #ifndef __LILFIXEDHEAPGROUP_H__
 #include "lilfixedheapgroup.h"
 #endif
@@ -14,6 +18,12 @@
 // if this is not defined then just standard malloc and free are available
 //#define USELTMEM
 
+// number of simple heap sizes
+#define LTMEMHEAPNUMSIMPLEHEAPSIZES 4
+
+// size of the simple heaps 
+extern uint32 g_nSimpleHeapSizes[LTMEMHEAPNUMSIMPLEHEAPSIZES];
+
 // Init the LTMemHeap
 void LTMemHeapInit();
 
@@ -32,4 +42,19 @@ void* LTMemHeapReAlloc(void* pMem, uint32 nRequestedSize);
 // Get the size of the allocated memory
 uint32 LTMemHeapGetSize(void* pMem);
 
+// Get the simple heap that memory of this size comes from
+// (LTMEMHEAPNUMSIMPLEHEAPSIZES if it's too big for the simple heaps)
+uint32 LTMemHeapGetSimpleHeap(uint32 nSize);
+
+// Find the simple heap that this memory is in
+// (LTMEMHEAPNUMSIMPLEHEAPSIZES if it's not in one).  
+// This doesn't need the LTMem critical section.
+uint32 LTMemHeapFindSimpleHeap(void* pMem);
+
+// Allocate up to nCount pieces of memory from a simple heap, returns how many it got
+uint32 LTMemHeapAllocSimple(uint32 nHeap, void** pMemList, uint32 nCount);
+
+// Free nCount pieces of memory back to a simple heap
+void LTMemHeapFreeSimple(uint32 nHeap, void** pMemList, uint32 nCount);
+
 #endif
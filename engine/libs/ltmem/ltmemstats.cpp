@@ -7,6 +7,11 @@
 #include "ltmemheap.h"
 #include "ltmemtrack.h"
 
+#include <chrono>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
 // true if lt mem system is initialized
 extern bool g_bLTMemInitialized;
 
@@ -24,6 +29,10 @@ void LTMemConsoleHelp()
 	dsi_ConsolePrint("log - logs all current allocations out to a file of the specified name in csv format\n");
 	dsi_ConsolePrint("fulllog - creates a log similar to log, but doesn't collapse the allocations from the same line\n");
 	dsi_ConsolePrint("ignore - ignore the currently marked memory (clears the marked flag)\n");
+	dsi_ConsolePrint("bench [threads] [allocations] - times allocations from 1 up to the specified number of threads\n");
+	dsi_ConsolePrint("heapbench [operations] - compares the general heaps on an allocation trace\n");
+	dsi_ConsolePrint("trace start <file> | trace stop - records every allocation, free and realloc to a file\n");
+	dsi_ConsolePrint("replay <file> - runs a recorded allocation trace on the general heaps\n");
 	dsi_ConsolePrint("\n");
 }
 
@@ -116,6 +125,414 @@ void LTMemConsoleIgnore()
 	dsi_ConsolePrint("%d blocks ignored", nIgnoredCount);
 }
 
+// one thread of the allocation benchmark
+// keeps a set of live allocations of mixed sizes and replaces a random one each time
+static void LTMemConsoleBenchThread(uint32 nSeed, uint32 nNumAllocs)
+{
+	const uint32 nNumLive = 256;
+	void* pLive[nNumLive];
+	memset(pLive, 0, sizeof(pLive));
+
+	uint32 nRand = nSeed;
+	for (uint32 n = 0; n < nNumAllocs; n++)
+	{
+		nRand = nRand * 1664525 + 1013904223;
+
+		uint32 nSlot = (nRand >> 8) % nNumLive;
+		if (pLive[nSlot] != NULL) LTMemFree(pLive[nSlot]);
+
+		// mostly small allocations, like the engine makes
+		uint32 nSize;
+		if ((nRand >> 24) < 224) nSize = 8 + (nRand >> 16) % 57;
+		else nSize = 65 + (nRand >> 12) % 1024;
+		pLive[nSlot] = LTMemAlloc(nSize);
+	}
+
+	for (uint32 nSlot = 0; nSlot < nNumLive; nSlot++)
+	{
+		if (pLive[nSlot] != NULL) LTMemFree(pLive[nSlot]);
+	}
+}
+
+// allocation benchmark
+void LTMemConsoleBench(int argc, char *argv[])
+{
+	uint32 nMaxThreads = (argc > 1) ? (uint32)atoi(argv[1]) : (uint32)std::thread::hardware_concurrency();
+	uint32 nNumAllocs = (argc > 2) ? (uint32)atoi(argv[2]) : 1000000;
+	nMaxThreads = LTCLAMP(nMaxThreads, 1, 64);
+	nNumAllocs = LTMAX(nNumAllocs, 1);
+
+	dsi_ConsolePrint("mem bench : %d allocations per thread (%s)\n", nNumAllocs, 
+		g_bLTMemInitialized ? "ltmem" : "system heap");
+
+	float fSingleThreadRate = 0.0f;
+	for (uint32 nNumThreads = 1; ; )
+	{
+		std::chrono::steady_clock::time_point cStart = std::chrono::steady_clock::now();
+
+		std::vector<std::thread> aThreads;
+		for (uint32 nThread = 0; nThread < nNumThreads; nThread++)
+		{
+			aThreads.push_back(std::thread(LTMemConsoleBenchThread, nThread + 1, nNumAllocs));
+		}
+		for (uint32 nThread = 0; nThread < nNumThreads; nThread++)
+		{
+			aThreads[nThread].join();
+		}
+
+		float fSeconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - cStart).count();
+		float fRate = (float)nNumThreads * (float)nNumAllocs / LTMAX(fSeconds, 0.000001f);
+		if (nNumThreads == 1) fSingleThreadRate = fRate;
+
+		dsi_ConsolePrint("%2d threads : %7.2f million allocations/sec (%.2fx one thread)\n", 
+			nNumThreads, fRate / 1000000.0f, fRate / fSingleThreadRate);
+
+		// go up by powers of 2, finishing with the maximum
+		if (nNumThreads == nMaxThreads) break;
+		nNumThreads = LTMIN(nNumThreads * 2, nMaxThreads);
+	}
+}
+
+// one step of an allocation trace
+// if nSize is 0 the block in nSlot is freed, otherwise a block is allocated into nSlot
+struct CLTMemTraceOp
+{
+	uint32 m_nSlot;
+	uint32 m_nSize;
+};
+
+// what happened when a trace was run on a heap
+struct CLTMemTraceResult
+{
+	float m_fSeconds;
+	uint32 m_nFailedAllocs;
+	size_t m_nPeakLiveSize;
+	size_t m_nPeakFootprint;
+};
+
+// make a trace that loads a level, plays it for a while, and loads another one
+// the sizes are the ones that get past the simple heaps to the general heap
+static void LTMemMakeHeapTrace(uint32 nNumOps, std::vector<CLTMemTraceOp>& aTrace, uint32& nNumSlots)
+{
+	// level data slots come first, then short lived ones
+	const uint32 nNumLevelSlots = 4096;
+	const uint32 nNumTempSlots = 1024;
+	nNumSlots = nNumLevelSlots + nNumTempSlots;
+
+	std::vector<bool> aUsed(nNumSlots, false);
+	aTrace.clear();
+	aTrace.reserve(nNumOps + nNumSlots);
+
+	uint32 nRand = 12345;
+	for (uint32 nLevel = 0; aTrace.size() < nNumOps; nLevel++)
+	{
+		// unload the last level
+		for (uint32 nSlot = 0; nSlot < nNumLevelSlots; nSlot++)
+		{
+			if (!aUsed[nSlot]) continue;
+			CLTMemTraceOp cOp = { nSlot, 0 };
+			aTrace.push_back(cOp);
+			aUsed[nSlot] = false;
+		}
+
+		// load a level, world and model data goes from a hundred bytes up to a couple of megs
+		// and there are file buffers and other temporary memory in between
+		for (uint32 nSlot = 0; nSlot < nNumLevelSlots; nSlot++)
+		{
+			nRand = nRand * 1664525 + 1013904223;
+			uint32 nSize = (65 + (nRand >> 21)) << ((nRand >> 8) % ((nRand & 0xff) < 4 ? 10 : 5));
+			CLTMemTraceOp cOp = { nSlot, nSize };
+			aTrace.push_back(cOp);
+			aUsed[nSlot] = true;
+
+			if ((nRand & 7) == 0)
+			{
+				uint32 nTempSlot = nNumLevelSlots + (nRand >> 16) % nNumTempSlots;
+				CLTMemTraceOp cTempOp = { nTempSlot, aUsed[nTempSlot] ? 0 : 4096 + (nRand >> 12) % 61440 };
+				aTrace.push_back(cTempOp);
+				aUsed[nTempSlot] = !aUsed[nTempSlot];
+			}
+		}
+
+		// play it, with small short lived allocations
+		uint32 nNumPlayOps = LTMAX(nNumOps / 4, 1);
+		for (uint32 n = 0; n < nNumPlayOps; n++)
+		{
+			nRand = nRand * 1664525 + 1013904223;
+			uint32 nTempSlot = nNumLevelSlots + (nRand >> 16) % nNumTempSlots;
+			CLTMemTraceOp cOp = { nTempSlot, aUsed[nTempSlot] ? 0 : 65 + (nRand >> 8) % 2048 };
+			aTrace.push_back(cOp);
+			aUsed[nTempSlot] = !aUsed[nTempSlot];
+		}
+	}
+
+	// clean up at the end
+	for (uint32 nSlot = 0; nSlot < nNumSlots; nSlot++)
+	{
+		if (!aUsed[nSlot]) continue;
+		CLTMemTraceOp cOp = { nSlot, 0 };
+		aTrace.push_back(cOp);
+	}
+}
+
+// run a trace on a heap
+template <class T>
+static void LTMemRunHeapTrace(T* pHeap, const std::vector<CLTMemTraceOp>& aTrace, uint32 nNumSlots, CLTMemTraceResult& cResult)
+{
+	std::vector<void*> aSlots(nNumSlots, (void*)NULL);
+	std::vector<uint32> aSizes(nNumSlots, 0);
+
+	memset(&cResult, 0, sizeof(cResult));
+	size_t nLiveSize = 0;
+
+	std::chrono::steady_clock::time_point cStart = std::chrono::steady_clock::now();
+
+	for (size_t nOp = 0; nOp < aTrace.size(); nOp++)
+	{
+		const CLTMemTraceOp& cOp = aTrace[nOp];
+		if (cOp.m_nSize == 0)
+		{
+			if (aSlots[cOp.m_nSlot] == NULL) continue;
+			pHeap->Free(aSlots[cOp.m_nSlot]);
+			aSlots[cOp.m_nSlot] = NULL;
+			nLiveSize -= aSizes[cOp.m_nSlot];
+		}
+		else
+		{
+			aSlots[cOp.m_nSlot] = pHeap->Alloc(cOp.m_nSize);
+			if (aSlots[cOp.m_nSlot] == NULL)
+			{
+				cResult.m_nFailedAllocs++;
+				continue;
+			}
+			aSizes[cOp.m_nSlot] = cOp.m_nSize;
+			nLiveSize += cOp.m_nSize;
+
+			cResult.m_nPeakLiveSize = LTMAX(cResult.m_nPeakLiveSize, nLiveSize);
+			cResult.m_nPeakFootprint = LTMAX(cResult.m_nPeakFootprint, (size_t)pHeap->GetFootprint());
+		}
+	}
+
+	cResult.m_fSeconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - cStart).count();
+
+	for (uint32 nSlot = 0; nSlot < nNumSlots; nSlot++)
+	{
+		if (aSlots[nSlot] != NULL) pHeap->Free(aSlots[nSlot]);
+	}
+}
+
+// print the results of a trace
+static void LTMemPrintHeapTraceResult(const char* pName, size_t nNumOps, const CLTMemTraceResult& cResult)
+{
+	dsi_ConsolePrint("%-16s : %7.2f million ops/sec, peak %.1f megs live in %.1f megs (%.2fx)", pName,
+		(float)nNumOps / LTMAX(cResult.m_fSeconds, 0.000001f) / 1000000.0f,
+		(float)cResult.m_nPeakLiveSize / (1024.0f * 1024.0f),
+		(float)cResult.m_nPeakFootprint / (1024.0f * 1024.0f),
+		(float)cResult.m_nPeakFootprint / (float)LTMAX(cResult.m_nPeakLiveSize, 1));
+	if (cResult.m_nFailedAllocs != 0) dsi_ConsolePrint(", %d allocations failed", cResult.m_nFailedAllocs);
+	dsi_ConsolePrint("\n");
+}
+
+// run a trace on each of the general heaps and print how they did
+static void LTMemCompareHeaps(const std::vector<CLTMemTraceOp>& aTrace, uint32 nNumSlots)
+{
+	// no initial heap, and grow the same way as the real general heap does
+	const uint32 nGrowSize = 1024*1024*16;
+	CLTMemTraceResult cResult;
+
+	CSizeClassHeap* pSizeClassHeap = new CSizeClassHeap(0, nGrowSize, 16, false);
+	LTMemRunHeapTrace(pSizeClassHeap, aTrace, nNumSlots, cResult);
+	delete pSizeClassHeap;
+	LTMemPrintHeapTraceResult("size class heap", aTrace.size(), cResult);
+
+	if (sizeof(void*) == sizeof(uint32))
+	{
+		CGeneralHeapGroup* pGeneralHeap = new CGeneralHeapGroup(0, nGrowSize, 16);
+		LTMemRunHeapTrace(pGeneralHeap, aTrace, nNumSlots, cResult);
+		delete pGeneralHeap;
+		LTMemPrintHeapTraceResult("general heap", aTrace.size(), cResult);
+	}
+	else
+	{
+		dsi_ConsolePrint("general heap     : not run (it only works with 32 bit pointers)\n");
+	}
+}
+
+// compare the general heaps on an allocation trace
+// the heaps are set up separately from the ltmem ones, so this works without ltmem turned on
+void LTMemConsoleHeapBench(int argc, char *argv[])
+{
+	uint32 nNumOps = (argc > 1) ? (uint32)atoi(argv[1]) : 1000000;
+	nNumOps = LTMAX(nNumOps, 1);
+
+	std::vector<CLTMemTraceOp> aTrace;
+	uint32 nNumSlots;
+	LTMemMakeHeapTrace(nNumOps, aTrace, nNumSlots);
+
+	dsi_ConsolePrint("mem heapbench : %d operations\n", (uint32)aTrace.size());
+
+	LTMemCompareHeaps(aTrace, nNumSlots);
+}
+
+// load a trace recorded with "mem trace" and turn it into heap operations
+// the pieces of memory get numbered slots, which are reused after they are freed
+static bool LTMemLoadHeapTrace(const char* sFileName, std::vector<CLTMemTraceOp>& aTrace, uint32& nNumSlots)
+{
+	FILE* pFile = fopen(sFileName, "rb");
+	if (pFile == NULL)
+	{
+		dsi_ConsolePrint("could not open %s\n", sFileName);
+		return false;
+	}
+
+	CMemTrackTraceHeader cHeader;
+	if ((fread(&cHeader, sizeof(cHeader), 1, pFile) != 1) ||
+		(cHeader.m_nMagic != CMEMTRACKTRACEMAGIC) ||
+		(cHeader.m_nVersion != CMEMTRACKTRACEVERSION) ||
+		(cHeader.m_nEventSize != sizeof(CMemTrackTraceEvent)))
+	{
+		dsi_ConsolePrint("%s is not an allocation trace from this version\n", sFileName);
+		fclose(pFile);
+		return false;
+	}
+
+	// slot that each piece of live memory is in
+	std::unordered_map<uint64, uint32> cLiveSlots;
+	std::vector<uint32> aFreeSlots;
+	nNumSlots = 0;
+	aTrace.clear();
+
+	// totals for each type, game types all go in the last one
+	uint32 aTypeAllocs[LT_NUM_MEM_TYPES + 1];
+	uint64 aTypeSizes[LT_NUM_MEM_TYPES + 1];
+	memset(aTypeAllocs, 0, sizeof(aTypeAllocs));
+	memset(aTypeSizes, 0, sizeof(aTypeSizes));
+
+	uint32 nNumEvents = 0;
+	uint32 nNumThreads = 0;
+	uint32 nUnknownFrees = 0;
+	uint64 nDuration = 0;
+
+	CMemTrackTraceEvent aEvents[1024];
+	size_t nNumRead;
+	while ((nNumRead = fread(aEvents, sizeof(CMemTrackTraceEvent), 1024, pFile)) > 0)
+	{
+		for (size_t nEvent = 0; nEvent < nNumRead; nEvent++)
+		{
+			const CMemTrackTraceEvent& cEvent = aEvents[nEvent];
+			nNumEvents++;
+			nNumThreads = LTMAX(nNumThreads, cEvent.m_nThread);
+			nDuration = cEvent.m_nTime;
+
+			// find the memory that goes away
+			uint64 nOldMem = (cEvent.m_nOp == CMemTrackTraceEvent::k_nOp_Free) ? cEvent.m_nMem : cEvent.m_nOldMem;
+			bool bHaveOldSlot = false;
+			uint32 nOldSlot = 0;
+			if (cEvent.m_nOp != CMemTrackTraceEvent::k_nOp_Alloc)
+			{
+				std::unordered_map<uint64, uint32>::iterator iLive = cLiveSlots.find(nOldMem);
+				if (iLive != cLiveSlots.end())
+				{
+					bHaveOldSlot = true;
+					nOldSlot = iLive->second;
+					cLiveSlots.erase(iLive);
+				}
+				// memory from before the trace started
+				else if (cEvent.m_nOp == CMemTrackTraceEvent::k_nOp_Free) nUnknownFrees++;
+			}
+
+			// allocate the new memory before freeing the old, like a realloc does
+			if (cEvent.m_nOp != CMemTrackTraceEvent::k_nOp_Free)
+			{
+				uint32 nSlot;
+				if (!aFreeSlots.empty())
+				{
+					nSlot = aFreeSlots.back();
+					aFreeSlots.pop_back();
+				}
+				else nSlot = nNumSlots++;
+				cLiveSlots[cEvent.m_nMem] = nSlot;
+
+				CLTMemTraceOp cOp = { nSlot, LTMAX(cEvent.m_nRequestedSize, 1) };
+				aTrace.push_back(cOp);
+
+				uint32 nType = LTMIN((uint32)cEvent.m_nAllocationType, (uint32)LT_NUM_MEM_TYPES);
+				aTypeAllocs[nType]++;
+				aTypeSizes[nType] += cEvent.m_nRequestedSize;
+			}
+
+			if (bHaveOldSlot)
+			{
+				CLTMemTraceOp cOp = { nOldSlot, 0 };
+				aTrace.push_back(cOp);
+				aFreeSlots.push_back(nOldSlot);
+			}
+		}
+	}
+
+	fclose(pFile);
+
+	dsi_ConsolePrint("%s : %d events over %.1f seconds on %d threads, %d frees of memory from before the trace\n",
+		sFileName, nNumEvents, (float)nDuration / 1000000000.0f, nNumThreads, nUnknownFrees);
+	for (uint32 nType = 0; nType <= LT_NUM_MEM_TYPES; nType++)
+	{
+		if (aTypeAllocs[nType] == 0) continue;
+
+		CMemTrackTypeToString* pType = LTMemTrackGetPointerFromType(nType);
+		char sTypeName[32];
+		if (nType == LT_NUM_MEM_TYPES) LTStrCpy(sTypeName, "game", sizeof(sTypeName));
+		else if (pType != NULL) LTStrCpy(sTypeName, pType->m_sName, sizeof(sTypeName));
+		else LTSNPrintF(sTypeName, sizeof(sTypeName), "type %d", nType);
+
+		dsi_ConsolePrint("  %-20s : %8d allocations, %8.2f megs\n", sTypeName, aTypeAllocs[nType],
+			(float)aTypeSizes[nType] / (1024.0f * 1024.0f));
+	}
+
+	return true;
+}
+
+// run a recorded trace on the general heaps
+// like heapbench this doesn't need ltmem to be turned on, so traces can be replayed in any build
+void LTMemConsoleReplay(int argc, char *argv[])
+{
+	if ((argc < 2) || (argv[1] == NULL))
+	{
+		dsi_ConsolePrint("usage : mem replay <trace file>\n");
+		return;
+	}
+
+	std::vector<CLTMemTraceOp> aTrace;
+	uint32 nNumSlots;
+	if (!LTMemLoadHeapTrace(argv[1], aTrace, nNumSlots)) return;
+
+	LTMemCompareHeaps(aTrace, nNumSlots);
+}
+
+#ifdef LTMEMTRACK
+// start or stop recording an allocation trace
+void LTMemConsoleTrace(int argc, char *argv[])
+{
+	if ((argc >= 3) && (argv[1] != NULL) && (argv[2] != NULL) && (stricmp(argv[1], "start") == 0))
+	{
+		if (LTMemTrackTraceStart(argv[2])) dsi_ConsolePrint("tracing allocations to %s\n", argv[2]);
+		else dsi_ConsolePrint("could not start tracing to %s\n", argv[2]);
+	}
+	else if ((argc >= 2) && (argv[1] != NULL) && (stricmp(argv[1], "stop") == 0))
+	{
+		if (LTMemTrackTraceIsRunning())
+		{
+			LTMemTrackTraceStop();
+			dsi_ConsolePrint("allocation trace stopped\n");
+		}
+		else dsi_ConsolePrint("no allocation trace is running\n");
+	}
+	else
+	{
+		dsi_ConsolePrint("usage : mem trace start <file> | mem trace stop\n");
+	}
+}
+#endif
+
 // console command handler for "mem" console command
 void LTMemConsole(int argc, char *argv[])
 {
@@ -126,6 +543,23 @@ void LTMemConsole(int argc, char *argv[])
 //		dsi_ConsolePrint("  argv[%i] = %s\n",n,argv[n]);
 //	}
 
+	// the benchmarks and replays work no matter how the memory system is set up
+	if ((argc >= 1) && (argv[0] != NULL) && (stricmp(argv[0], "bench") == 0))
+	{
+		LTMemConsoleBench(argc, argv);
+		return;
+	}
+	if ((argc >= 1) && (argv[0] != NULL) && (stricmp(argv[0], "heapbench") == 0))
+	{
+		LTMemConsoleHeapBench(argc, argv);
+		return;
+	}
+	if ((argc >= 1) && (argv[0] != NULL) && (stricmp(argv[0], "replay") == 0))
+	{
+		LTMemConsoleReplay(argc, argv);
+		return;
+	}
+
 	// if the ltmem system is not being used then just display message and exit
 	if (!g_bLTMemInitialized)
 	{
@@ -202,6 +636,12 @@ void LTMemConsole(int argc, char *argv[])
 		LTMemConsoleIgnore();
 	}
 
+	// is this the trace command
+	else if (stricmp(sCommand, "trace") == 0) 
+	{
+		LTMemConsoleTrace(argc, argv);
+	}
+
 	// if command is unknown display help
 	else LTMemConsoleHelp();
 #endif // !LTMEMTRACK
@@ -1,5 +1,8 @@
 
 #include "stdafx.h"
+#ifdef _WIN32
+#include "windows.h"
+#endif
 #include "bdefs.h"
 #include "ltmem.h"
 #include "ltbasedefs.h"
@@ -7,6 +10,15 @@
 #include "ltmemheap.h"
 #include "ltmemtrack.h"
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#ifdef USELTMEM
+// critical section to make heap thread safe
+extern CRITICAL_SECTION g_LTMemCriticalSection; 
+#endif
+
 
 ///////////////////////////////////////////////////////////////////////////////////////////
 // information about the current allocation
@@ -65,6 +77,38 @@ CMemTrackAllocInfo* g_pTrackHeap = NULL;
 uint32 g_nMemTypeTrackAllocationCount[LT_NUM_MEM_TYPES];
 
 
+///////////////////////////////////////////////////////////////////////////////////////////
+// allocation trace
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// number of events that are buffered up before they are written to the file
+#define CMEMTRACKTRACEBUFFERSIZE 65536
+
+// file the trace is going to (NULL if there is no trace running)
+static FILE* g_pMemTrackTraceFile = NULL;
+
+// events that haven't been written to the file yet
+static CMemTrackTraceEvent* g_pMemTrackTraceBuffer = NULL;
+static uint32 g_nMemTrackTraceBufferCount = 0;
+
+// a full buffer waiting to be written out once the LTMem critical section has been released
+static CMemTrackTraceEvent* g_pMemTrackTraceFullBuffer = NULL;
+static uint32 g_nMemTrackTraceFullBufferCount = 0;
+static std::atomic<bool> g_bMemTrackTraceFullBuffer(false);
+
+// the buffer to switch to when the current one fills up (NULL while it's being written out)
+static std::atomic<CMemTrackTraceEvent*> g_pMemTrackTraceSpareBuffer(NULL);
+
+// when the trace was started
+static std::chrono::steady_clock::time_point g_MemTrackTraceStartTime;
+
+// number of threads that have been traced
+static uint32 g_nMemTrackTraceNumThreads = 0;
+
+// this thread's number in the trace (0 if it hasn't been traced yet)
+static thread_local uint32 t_nMemTrackTraceThread = 0;
+
+
 ///////////////////////////////////////////////////////////////////////////////////////////
 // init mem tracking	
 ///////////////////////////////////////////////////////////////////////////////////////////
@@ -78,6 +122,7 @@ void LTMemTrackInit()
 ///////////////////////////////////////////////////////////////////////////////////////////
 void LTMemTrackTerm()
 {
+	LTMemTrackTraceStop();
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////
@@ -189,6 +234,186 @@ void LTMemTrackAllocEnd()
 	g_nCurMemTrackAllocInfoDepth--;
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////
+// allocation trace functions
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// write out the buffered events
+static void LTMemTrackTraceFlush()
+{
+	if (g_nMemTrackTraceBufferCount == 0) return;
+
+	fwrite(g_pMemTrackTraceBuffer, sizeof(CMemTrackTraceEvent), g_nMemTrackTraceBufferCount, g_pMemTrackTraceFile);
+	g_nMemTrackTraceBufferCount = 0;
+}
+
+// write out the full buffer if nobody has picked it up yet
+// this is called with the LTMem critical section held
+static void LTMemTrackTraceFlushFullBuffer()
+{
+	if (g_pMemTrackTraceFullBuffer == NULL) return;
+
+	fwrite(g_pMemTrackTraceFullBuffer, sizeof(CMemTrackTraceEvent), g_nMemTrackTraceFullBufferCount, g_pMemTrackTraceFile);
+	g_pMemTrackTraceSpareBuffer.store(g_pMemTrackTraceFullBuffer);
+	g_pMemTrackTraceFullBuffer = NULL;
+	g_bMemTrackTraceFullBuffer.store(false);
+}
+
+// wait for a write that's going on outside the LTMem critical section to finish
+static void LTMemTrackTraceWaitForSpare()
+{
+	// it doesn't need the critical section to finish, so it's ok to wait while holding it
+	while ((g_pMemTrackTraceFullBuffer == NULL) && (g_pMemTrackTraceSpareBuffer.load() == NULL))
+	{
+		std::this_thread::yield();
+	}
+}
+
+// set the full buffer aside to be written out by LTMemTrackTraceWrite, and carry on in the spare one
+// this is called with the LTMem critical section held
+static void LTMemTrackTraceSwapBuffers()
+{
+	// the last one should have been picked up by now, but keep things in order if it hasn't
+	LTMemTrackTraceWaitForSpare();
+	LTMemTrackTraceFlushFullBuffer();
+
+	g_pMemTrackTraceFullBuffer = g_pMemTrackTraceBuffer;
+	g_nMemTrackTraceFullBufferCount = g_nMemTrackTraceBufferCount;
+	g_pMemTrackTraceBuffer = g_pMemTrackTraceSpareBuffer.exchange(NULL);
+	g_nMemTrackTraceBufferCount = 0;
+	g_bMemTrackTraceFullBuffer.store(true);
+}
+
+// add an event to the trace
+// this is called from the memory functions so the LTMem critical section is held
+static void LTMemTrackTraceRecord(uint32 nOp, void* pMem, void* pOldMem, uint32 nRequestedSize, uint32 nAllocationType)
+{
+	// make sure a trace is running
+	if (g_pMemTrackTraceFile == NULL) return;
+
+	// number this thread the first time it shows up
+	if (t_nMemTrackTraceThread == 0) t_nMemTrackTraceThread = ++g_nMemTrackTraceNumThreads;
+
+	CMemTrackTraceEvent& cEvent = g_pMemTrackTraceBuffer[g_nMemTrackTraceBufferCount];
+	cEvent.m_nTime = (uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - g_MemTrackTraceStartTime).count();
+	cEvent.m_nMem = (uint64)(uintptr_t)pMem;
+	cEvent.m_nOldMem = (uint64)(uintptr_t)pOldMem;
+	cEvent.m_nRequestedSize = nRequestedSize;
+	cEvent.m_nAllocationType = (uint16)LTMIN(nAllocationType, 0xffff);
+	cEvent.m_nThread = (uint8)LTMIN(t_nMemTrackTraceThread, 0xff);
+	cEvent.m_nOp = (uint8)nOp;
+
+	// write the events out when the buffer fills up
+	g_nMemTrackTraceBufferCount++;
+	if (g_nMemTrackTraceBufferCount == CMEMTRACKTRACEBUFFERSIZE) LTMemTrackTraceSwapBuffers();
+}
+
+// write out a full trace buffer
+// this is called by the memory functions after they release the LTMem critical section, so the
+// other threads can carry on allocating while the file is written
+void LTMemTrackTraceWrite()
+{
+	// quick check so this costs next to nothing most of the time
+	if (!g_bMemTrackTraceFullBuffer.load(std::memory_order_relaxed)) return;
+
+#ifdef USELTMEM
+	EnterCriticalSection(&g_LTMemCriticalSection); 
+#endif
+
+	CMemTrackTraceEvent* pBuffer = g_pMemTrackTraceFullBuffer;
+	uint32 nCount = g_nMemTrackTraceFullBufferCount;
+	FILE* pFile = g_pMemTrackTraceFile;
+	g_pMemTrackTraceFullBuffer = NULL;
+	g_bMemTrackTraceFullBuffer.store(false);
+
+#ifdef USELTMEM
+	LeaveCriticalSection(&g_LTMemCriticalSection);
+#endif
+
+	// somebody else got to it first
+	if (pBuffer == NULL) return;
+
+	fwrite(pBuffer, sizeof(CMemTrackTraceEvent), nCount, pFile);
+	g_pMemTrackTraceSpareBuffer.store(pBuffer);
+}
+
+// start tracing every allocation to a file
+bool LTMemTrackTraceStart(const char* sFileName)
+{
+	// only one trace at a time
+	LTMemTrackTraceStop();
+
+	FILE* pFile = fopen(sFileName, "wb");
+	if (pFile == NULL) return false;
+
+	CMemTrackTraceHeader cHeader;
+	cHeader.m_nMagic = CMEMTRACKTRACEMAGIC;
+	cHeader.m_nVersion = CMEMTRACKTRACEVERSION;
+	cHeader.m_nEventSize = sizeof(CMemTrackTraceEvent);
+	cHeader.m_nReserved = 0;
+	fwrite(&cHeader, sizeof(cHeader), 1, pFile);
+
+	// the buffers come from the system heap so they don't show up in the trace
+	CMemTrackTraceEvent* pBuffer = (CMemTrackTraceEvent*)malloc(sizeof(CMemTrackTraceEvent) * CMEMTRACKTRACEBUFFERSIZE);
+	CMemTrackTraceEvent* pSpareBuffer = (CMemTrackTraceEvent*)malloc(sizeof(CMemTrackTraceEvent) * CMEMTRACKTRACEBUFFERSIZE);
+	if ((pBuffer == NULL) || (pSpareBuffer == NULL))
+	{
+		free(pBuffer);
+		free(pSpareBuffer);
+		fclose(pFile);
+		return false;
+	}
+
+#ifdef USELTMEM
+	EnterCriticalSection(&g_LTMemCriticalSection); 
+#endif
+
+	g_pMemTrackTraceBuffer = pBuffer;
+	g_nMemTrackTraceBufferCount = 0;
+	g_pMemTrackTraceSpareBuffer.store(pSpareBuffer);
+	g_MemTrackTraceStartTime = std::chrono::steady_clock::now();
+	g_pMemTrackTraceFile = pFile;
+
+#ifdef USELTMEM
+	LeaveCriticalSection(&g_LTMemCriticalSection);
+#endif
+
+	return true;
+}
+
+// stop tracing and close the file
+void LTMemTrackTraceStop()
+{
+#ifdef USELTMEM
+	EnterCriticalSection(&g_LTMemCriticalSection); 
+#endif
+
+	if (g_pMemTrackTraceFile != NULL)
+	{
+		// everything goes out in order, including a buffer that's being written right now
+		LTMemTrackTraceWaitForSpare();
+		LTMemTrackTraceFlushFullBuffer();
+		LTMemTrackTraceFlush();
+		fclose(g_pMemTrackTraceFile);
+		g_pMemTrackTraceFile = NULL;
+
+		free(g_pMemTrackTraceBuffer);
+		g_pMemTrackTraceBuffer = NULL;
+		free(g_pMemTrackTraceSpareBuffer.exchange(NULL));
+	}
+
+#ifdef USELTMEM
+	LeaveCriticalSection(&g_LTMemCriticalSection);
+#endif
+}
+
+// true if a trace is running
+bool LTMemTrackTraceIsRunning()
+{
+	return g_pMemTrackTraceFile != NULL;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////////////////
 // memory tracking functions that are called from the memory functions
 ///////////////////////////////////////////////////////////////////////////////////////////
@@ -254,6 +479,8 @@ void* LTMemTrackAlloc(uint32 nRequestedSize)
 	// adjust mem pointer to point after our header
 	pMem += sizeof(CMemTrackAllocInfo);
 
+	LTMemTrackTraceRecord(CMemTrackTraceEvent::k_nOp_Alloc, pMem, NULL, nRequestedSize, g_curAllocInfo.m_nAllocationType);
+
 	//The following lines of code can be used to identify blocks of memory that aren't
 	//setup to track properly. Just uncomment them and set a break point on the
 	//variable and it will get hit whenever there is untracked memory.
@@ -279,6 +506,8 @@ void LTMemTrackFree(void* pMem)
 	// pointer to header
 	CMemTrackAllocInfo* pInfo = (CMemTrackAllocInfo*)pMemActual;
 
+	LTMemTrackTraceRecord(CMemTrackTraceEvent::k_nOp_Free, pMem, NULL, 0, pInfo->m_nAllocationType);
+
 	// decrement total allocated counter
 	g_nMemTrackTotalAllocated -= (LTMemHeapGetSize(pMemActual) - sizeof(CMemTrackAllocInfo));
 
@@ -351,6 +580,8 @@ void* LTMemTrackReAlloc(void* pMemOld, uint32 nRequestedSize)
 	// adjust mem pointer to point after our header
 	pMem += sizeof(CMemTrackAllocInfo);
 
+	LTMemTrackTraceRecord(CMemTrackTraceEvent::k_nOp_ReAlloc, pMem, pMemOld, nRequestedSize, g_curAllocInfo.m_nAllocationType);
+
 	// return allocated pointer
 	return pMem;
 }
@@ -73,6 +73,62 @@ struct CMemTrackAllocInfo
 };
 
 
+///////////////////////////////////////////////////////////////////////////////////////////
+// allocation trace file
+// the file is a CMemTrackTraceHeader followed by CMemTrackTraceEvent's in the order the
+// allocations happened
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// "LTMT"
+#define CMEMTRACKTRACEMAGIC 0x544d544c
+
+// bump this when the events change
+#define CMEMTRACKTRACEVERSION 1
+
+struct CMemTrackTraceHeader
+{
+	uint32	m_nMagic;
+	uint32	m_nVersion;
+
+	// size of each event
+	uint32	m_nEventSize;
+
+	uint32	m_nReserved;
+};
+
+struct CMemTrackTraceEvent
+{
+	enum
+	{
+		k_nOp_Alloc,
+		k_nOp_Free,
+		k_nOp_ReAlloc
+	};
+
+	// nanoseconds since the trace was started
+	uint64	m_nTime;
+
+	// the memory (the new memory for a realloc)
+	uint64	m_nMem;
+
+	// the old memory for a realloc
+	uint64	m_nOldMem;
+
+	// the amount of memory requested (0 for a free)
+	uint32	m_nRequestedSize;
+
+	// the category of memory this belongs to
+	uint16	m_nAllocationType;
+
+	// the thread it happened on, numbered in the order the threads first got traced
+	// (threads past 255 all get 255)
+	uint8	m_nThread;
+
+	// k_nOp_*
+	uint8	m_nOp;
+};
+
+
 ///////////////////////////////////////////////////////////////////////////////////////////
 // information about the current allocation
 ///////////////////////////////////////////////////////////////////////////////////////////
@@ -155,4 +211,12 @@ void LTMemTrackAddTypeToString(uint32 nType, const char* sName);
 
 CMemTrackTypeToString* LTMemTrackGetPointerFromType(uint32 nType);
 
+bool LTMemTrackTraceStart(const char* sFileName);
+
+void LTMemTrackTraceStop();
+
+bool LTMemTrackTraceIsRunning();
+
+void LTMemTrackTraceWrite();
+
 #endif
@@ -0,0 +1,724 @@
+// ----------------------------------------------------------------------- //
+//
+// MODULE  : sizeclassheap.h
+//
+// PURPOSE : general heap with segregated size classes, used in place of
+//			 CGeneralHeapGroup behind LTMemHeapAlloc.
+//
+//			 Memory comes from the OS in arenas that are cut up into 64k pages.
+//			 A span is a run of pages that only holds blocks of one size class,
+//			 so alloc and free just pop and push the span's free list, and
+//			 blocks don't need headers.  A two level page map goes from an
+//			 address to its span, which is how free finds the size and the
+//			 span.  Blocks bigger than the largest size class are mapped
+//			 straight from the OS and given back as soon as they are freed.
+//
+//			 Pointers are never squeezed into 32 bits, so this works on
+//			 64 bit as well as 32 bit builds.
+//
+//			 This class is not thread safe, the LTMem critical section
+//			 protects it.
+//
+// CREATED : Oct-17-2026
+//
+// ----------------------------------------------------------------------- //
+
+#ifndef __SIZECLASSHEAP_H__
+#define __SIZECLASSHEAP_H__
+
+#ifdef _WIN32
+#include "windows.h"
+#else
+#include <sys/mman.h>
+#endif
+
+// size of the pages spans are made of (64k so it matches the windows allocation granularity)
+#define SIZECLASSHEAPPAGESHIFT 16
+#define SIZECLASSHEAPPAGESIZE (1 << SIZECLASSHEAPPAGESHIFT)
+
+// number of size classes
+// these go up by 16 bytes to 64, then 4 steps for each power of 2 (80, 96, 112, 128, 160 ...)
+#define SIZECLASSHEAPNUMCLASSES 40
+
+// largest size class, anything bigger is mapped from the OS by itself
+#define SIZECLASSHEAPMAXCLASSSIZE 32768
+
+// each span holds at least this many blocks
+#define SIZECLASSHEAPMINSPANBLOCKS 8
+
+// biggest span (enough pages for SIZECLASSHEAPMINSPANBLOCKS of the largest class)
+#define SIZECLASSHEAPMAXSPANPAGES 4
+
+// size class values for spans that aren't holding a size class
+#define SIZECLASSHEAPLARGESPAN SIZECLASSHEAPNUMCLASSES
+#define SIZECLASSHEAPIDLESPAN (SIZECLASSHEAPNUMCLASSES + 1)
+
+// the page map covers this many bits of address space
+// the root is indexed by the high bits and each leaf covers 4 gigs
+#define SIZECLASSHEAPADDRESSBITS 48
+#define SIZECLASSHEAPLEAFBITS 16
+#define SIZECLASSHEAPROOTBITS (SIZECLASSHEAPADDRESSBITS - SIZECLASSHEAPPAGESHIFT - SIZECLASSHEAPLEAFBITS)
+
+// huge page size, arenas are rounded up to this when using huge pages
+// and only big blocks of at least this size are put in huge pages
+#define SIZECLASSHEAPHUGEPAGESIZE (2 * 1024 * 1024)
+
+
+// map memory from the OS, aligned to nAlign (which must be a power of 2 of
+// at least SIZECLASSHEAPPAGESIZE).  If bHugePages is set this tries huge pages
+// first and falls back on normal pages.
+inline void* SizeClassHeapMapMemory(size_t nSize, size_t nAlign, bool bHugePages)
+{
+#ifdef _WIN32
+	// large pages need the lock pages privilege, so this fails for most users
+	if (bHugePages)
+	{
+		SIZE_T nLargePageSize = GetLargePageMinimum();
+		if ((nLargePageSize != 0) && ((nSize % nLargePageSize) == 0))
+		{
+			void* pMem = VirtualAlloc(NULL, nSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+			if (pMem != NULL) return pMem;
+		}
+	}
+
+	// VirtualAlloc is always aligned to the 64k allocation granularity
+	return VirtualAlloc(NULL, nSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+#ifdef MAP_HUGETLB
+	// this only works if the system has huge pages set aside
+	if (bHugePages && ((nSize % SIZECLASSHEAPHUGEPAGESIZE) == 0))
+	{
+		void* pMem = mmap(NULL, nSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (pMem != MAP_FAILED) return pMem;
+	}
+#endif
+
+	// map extra so we can trim it down to the alignment
+	size_t nMapSize = nSize + nAlign;
+	uint8* pMap = (uint8*)mmap(NULL, nMapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (pMap == (uint8*)MAP_FAILED) return NULL;
+
+	uint8* pMem = (uint8*)(((uintptr_t)pMap + nAlign - 1) & ~(uintptr_t)(nAlign - 1));
+	if (pMem != pMap) munmap(pMap, pMem - pMap);
+	size_t nTailSize = (pMap + nMapSize) - (pMem + nSize);
+	if (nTailSize != 0) munmap(pMem + nSize, nTailSize);
+
+#ifdef MADV_HUGEPAGE
+	// let transparent huge pages have it instead
+	if (bHugePages) madvise(pMem, nSize, MADV_HUGEPAGE);
+#endif
+
+	return pMem;
+#endif
+}
+
+// give memory from SizeClassHeapMapMemory back to the OS
+inline void SizeClassHeapUnmapMemory(void* pMem, size_t nSize)
+{
+#ifdef _WIN32
+	VirtualFree(pMem, 0, MEM_RELEASE);
+#else
+	munmap(pMem, nSize);
+#endif
+}
+
+
+class CSizeClassHeap
+{
+public:
+	// simple constructor
+	CSizeClassHeap()
+	{
+// these can't be initialized because they sometimes get initialized
+// after the class is set up
+//		m_bInitialized = false;
+	};
+
+	// constructor which also initializes the class
+	CSizeClassHeap(
+		uint32 nInitialArenaSize,
+		uint32 nGrowArenaSize,
+		uint32 nAlign,
+		bool bHugePages)
+	{
+		m_bInitialized = false;
+		Init(nInitialArenaSize,nGrowArenaSize,nAlign,bHugePages);
+	};
+
+	// destructor
+	~CSizeClassHeap()
+	{
+		Term();
+	};
+
+	// function to initialize the class
+	// this must be called before any other calls
+	// if bHugePages is set then the arenas and the big blocks of SIZECLASSHEAPHUGEPAGESIZE
+	// or more (which is mostly world and model data) are put in huge pages if the OS lets us
+	inline bool Init(
+		uint32 nInitialArenaSize,
+		uint32 nGrowArenaSize,
+		uint32 nAlign,
+		bool bHugePages);
+
+	// terminate the class, this frees everything that is still allocated
+	inline void Term();
+
+	// allocate a piece of memory from the heap
+	inline void* Alloc(uint32 nSize);
+
+	// free a piece of memory from the heap
+	// returns false if it isn't from this heap
+	inline bool Free(void* pFreeMem);
+
+	// check if this memory is in this heap
+	inline bool InHeap(void* pMem);
+
+	// get the size of a piece of allocated memory
+	// (this is the size of its size class, so it can be more than was asked for)
+	inline uint32 GetSize(void* pMem);
+
+	// bytes mapped from the OS, including the page map
+	size_t GetFootprint() { return m_nFootprint; };
+
+	// bytes in allocated blocks
+	size_t GetAllocatedSize() { return m_nAllocatedSize; };
+
+	// memory allocations for this class will go though system malloc and free
+    void* operator new(size_t size) {	return malloc(size); }
+    void operator delete(void* p) { free(p); };
+
+private:
+
+	// a run of pages that holds blocks of one size class, or one big block
+	struct CSpan
+	{
+		// first byte of the span
+		uint8* m_pStart;
+
+		// number of pages in the span
+		uint32 m_nNumPages;
+
+		// size class of the blocks in this span,
+		// or SIZECLASSHEAPLARGESPAN or SIZECLASSHEAPIDLESPAN
+		uint32 m_nSizeClass;
+
+		// freed blocks in this span, the first pointer sized bytes of each one
+		// point to the next one
+		void* m_pFreeList;
+
+		// blocks past this one have never been handed out
+		uint32 m_nNumCarved;
+
+		// number of blocks that are allocated
+		uint32 m_nNumUsed;
+
+		// size that was asked for, for a big block
+		uint32 m_nLargeSize;
+
+		// links in the list of partly used spans of this size class
+		// or in the list of idle spans
+		CSpan* m_pPrev;
+		CSpan* m_pNext;
+
+		// memory allocations for this class will go though system malloc and free
+	    void* operator new(size_t size) {	return malloc(size); }
+	    void operator delete(void* p) { free(p); };
+	};
+
+	// a piece of memory from the OS that spans are made from
+	struct CArena
+	{
+		uint8* m_pMem;
+		size_t m_nSize;
+
+		// bytes that have been made into spans
+		size_t m_nUsed;
+
+		CArena* m_pNext;
+
+		// memory allocations for this class will go though system malloc and free
+	    void* operator new(size_t size) {	return malloc(size); }
+	    void operator delete(void* p) { free(p); };
+	};
+
+	// a size class
+	struct CSizeClass
+	{
+		// size of the blocks
+		uint32 m_nSize;
+
+		// number of pages in each span, and how many blocks fit in it
+		uint32 m_nSpanPages;
+		uint32 m_nSpanBlocks;
+
+		// spans that have some free blocks
+		CSpan* m_pPartialSpans;
+	};
+
+	// add an arena of at least nSize bytes
+	inline bool AddArena(size_t nSize);
+
+	// get a span of nNumPages pages, from the idle spans if there is one or else an arena
+	inline CSpan* NewSpan(uint32 nNumPages);
+
+	// allocate and free blocks that are too big for the size classes
+	inline void* AllocLarge(uint32 nSize);
+	inline void FreeLarge(CSpan* pSpan);
+
+	// find the span that this memory is in (NULL if it isn't in one)
+	inline CSpan* FindSpan(void* pMem);
+
+	// point the page map entries for the span's pages at the span
+	inline bool SetSpan(CSpan* pSpan, CSpan* pMapTo);
+
+	// span lists
+	inline void LinkSpan(CSpan** ppList, CSpan* pSpan);
+	inline void UnlinkSpan(CSpan** ppList, CSpan* pSpan);
+
+	// true if class is initialized
+	bool m_bInitialized;
+
+	// true if we try to use huge pages
+	bool m_bHugePages;
+
+	// size of arenas that are added after the first one
+	size_t m_nGrowArenaSize;
+
+	// the size classes
+	CSizeClass m_aSizeClasses[SIZECLASSHEAPNUMCLASSES];
+
+	// size class for each size, indexed by the size in 16 byte units rounded up
+	uint8 m_aSizeToClass[(SIZECLASSHEAPMAXCLASSSIZE >> 4) + 1];
+
+	// empty spans that can be used for any size class, by number of pages
+	CSpan* m_aIdleSpans[SIZECLASSHEAPMAXSPANPAGES + 1];
+
+	// arenas, the first one is the one spans are made from
+	CArena* m_pArenaList;
+
+	// statistics
+	size_t m_nFootprint;
+	size_t m_nAllocatedSize;
+
+	// the page map, the leaves are mapped as they are needed
+	CSpan** m_aPageMap[1 << SIZECLASSHEAPROOTBITS];
+};
+
+
+inline bool CSizeClassHeap::Init(
+	uint32 nInitialArenaSize,
+	uint32 nGrowArenaSize,
+	uint32 nAlign,
+	bool bHugePages)
+{
+	// all of the size classes are multiples of 16 bytes
+	ASSERT((nAlign <= 16) && ((nAlign & (nAlign - 1)) == 0));
+
+	m_bHugePages = bHugePages;
+	m_nGrowArenaSize = nGrowArenaSize;
+	m_pArenaList = NULL;
+	m_nFootprint = 0;
+	m_nAllocatedSize = 0;
+	memset(m_aIdleSpans, 0, sizeof(m_aIdleSpans));
+	memset(m_aPageMap, 0, sizeof(m_aPageMap));
+
+	// set up the size classes
+	uint32 nSizeIndex = 0;
+	for (uint32 n = 0; n < SIZECLASSHEAPNUMCLASSES; n++)
+	{
+		CSizeClass& cSizeClass = m_aSizeClasses[n];
+
+		if (n < 4) cSizeClass.m_nSize = (n + 1) * 16;
+		else cSizeClass.m_nSize = (5 + ((n - 4) % 4)) << (4 + ((n - 4) / 4));
+
+		uint32 nSpanSize = LTMAX(cSizeClass.m_nSize * SIZECLASSHEAPMINSPANBLOCKS, SIZECLASSHEAPPAGESIZE);
+		cSizeClass.m_nSpanPages = (nSpanSize + SIZECLASSHEAPPAGESIZE - 1) >> SIZECLASSHEAPPAGESHIFT;
+		cSizeClass.m_nSpanBlocks = (cSizeClass.m_nSpanPages << SIZECLASSHEAPPAGESHIFT) / cSizeClass.m_nSize;
+		cSizeClass.m_pPartialSpans = NULL;
+		ASSERT(cSizeClass.m_nSpanPages <= SIZECLASSHEAPMAXSPANPAGES);
+
+		for (; nSizeIndex <= (cSizeClass.m_nSize >> 4); nSizeIndex++)
+		{
+			m_aSizeToClass[nSizeIndex] = (uint8)n;
+		}
+	}
+	ASSERT(m_aSizeClasses[SIZECLASSHEAPNUMCLASSES - 1].m_nSize == SIZECLASSHEAPMAXCLASSSIZE);
+
+	// class is now initialized
+	m_bInitialized = true;
+
+	// get the first arena
+	if (nInitialArenaSize > 0)
+	{
+		if (!AddArena(nInitialArenaSize))
+		{
+			ASSERT(false);
+			return false;
+		}
+	}
+
+	return true;
+};
+
+
+inline void CSizeClassHeap::Term()
+{
+	// make sure class was initialized
+	if (!m_bInitialized) return;
+
+	// go through the page map and delete every span
+	for (uint32 nRoot = 0; nRoot < (1 << SIZECLASSHEAPROOTBITS); nRoot++)
+	{
+		CSpan** pLeaf = m_aPageMap[nRoot];
+		if (pLeaf == NULL) continue;
+
+		for (uint32 nLeaf = 0; nLeaf < (1 << SIZECLASSHEAPLEAFBITS); nLeaf++)
+		{
+			CSpan* pSpan = pLeaf[nLeaf];
+			if (pSpan == NULL) continue;
+
+			// the rest of the span's pages can't be left pointing at it
+			SetSpan(pSpan, NULL);
+
+			// big blocks have their own memory
+			if (pSpan->m_nSizeClass == SIZECLASSHEAPLARGESPAN)
+			{
+				SizeClassHeapUnmapMemory(pSpan->m_pStart, (size_t)pSpan->m_nNumPages << SIZECLASSHEAPPAGESHIFT);
+			}
+			delete pSpan;
+		}
+
+		SizeClassHeapUnmapMemory(pLeaf, sizeof(CSpan*) << SIZECLASSHEAPLEAFBITS);
+		m_aPageMap[nRoot] = NULL;
+	}
+
+	// give back the arenas
+	while (m_pArenaList != NULL)
+	{
+		CArena* pNextArena = m_pArenaList->m_pNext;
+		SizeClassHeapUnmapMemory(m_pArenaList->m_pMem, m_pArenaList->m_nSize);
+		delete m_pArenaList;
+		m_pArenaList = pNextArena;
+	}
+
+	// class is no longer initialized
+	m_bInitialized = false;
+};
+
+
+inline void* CSizeClassHeap::Alloc(uint32 nSize)
+{
+	ASSERT(m_bInitialized);
+
+	if (nSize > SIZECLASSHEAPMAXCLASSSIZE) return AllocLarge(nSize);
+
+	CSizeClass& cSizeClass = m_aSizeClasses[m_aSizeToClass[(nSize + 15) >> 4]];
+
+	// get a span with free blocks in it
+	CSpan* pSpan = cSizeClass.m_pPartialSpans;
+	if (pSpan == NULL)
+	{
+		pSpan = NewSpan(cSizeClass.m_nSpanPages);
+		if (pSpan == NULL) return NULL;
+
+		pSpan->m_nSizeClass = (uint32)(&cSizeClass - m_aSizeClasses);
+		LinkSpan(&cSizeClass.m_pPartialSpans, pSpan);
+	}
+
+	// use a freed block, or the next one that has never been used
+	void* pMem = pSpan->m_pFreeList;
+	if (pMem != NULL)
+	{
+		pSpan->m_pFreeList = *(void**)pMem;
+	}
+	else
+	{
+		pMem = pSpan->m_pStart + pSpan->m_nNumCarved * cSizeClass.m_nSize;
+		pSpan->m_nNumCarved++;
+	}
+
+	// full spans come off the partial list until something in them is freed
+	pSpan->m_nNumUsed++;
+	if (pSpan->m_nNumUsed == cSizeClass.m_nSpanBlocks)
+	{
+		UnlinkSpan(&cSizeClass.m_pPartialSpans, pSpan);
+	}
+
+	m_nAllocatedSize += cSizeClass.m_nSize;
+
+	return pMem;
+};
+
+
+inline bool CSizeClassHeap::Free(void* pFreeMem)
+{
+	ASSERT(m_bInitialized);
+
+	CSpan* pSpan = FindSpan(pFreeMem);
+	if ((pSpan == NULL) || (pSpan->m_nSizeClass == SIZECLASSHEAPIDLESPAN)) return false;
+
+	if (pSpan->m_nSizeClass == SIZECLASSHEAPLARGESPAN)
+	{
+		FreeLarge(pSpan);
+		return true;
+	}
+
+	CSizeClass& cSizeClass = m_aSizeClasses[pSpan->m_nSizeClass];
+
+	// a full span has room again
+	if (pSpan->m_nNumUsed == cSizeClass.m_nSpanBlocks)
+	{
+		LinkSpan(&cSizeClass.m_pPartialSpans, pSpan);
+	}
+
+	*(void**)pFreeMem = pSpan->m_pFreeList;
+	pSpan->m_pFreeList = pFreeMem;
+	pSpan->m_nNumUsed--;
+
+	m_nAllocatedSize -= cSizeClass.m_nSize;
+
+	// empty spans go back to the idle list so another size class can use them,
+	// unless it's the only one this size class has left
+	if ((pSpan->m_nNumUsed == 0) &&
+		((cSizeClass.m_pPartialSpans != pSpan) || (pSpan->m_pNext != NULL)))
+	{
+		UnlinkSpan(&cSizeClass.m_pPartialSpans, pSpan);
+		pSpan->m_nSizeClass = SIZECLASSHEAPIDLESPAN;
+		LinkSpan(&m_aIdleSpans[pSpan->m_nNumPages], pSpan);
+	}
+
+	return true;
+};
+
+
+inline bool CSizeClassHeap::InHeap(void* pMem)
+{
+	ASSERT(m_bInitialized);
+
+	CSpan* pSpan = FindSpan(pMem);
+	return (pSpan != NULL) && (pSpan->m_nSizeClass != SIZECLASSHEAPIDLESPAN);
+};
+
+
+// get the size of a piece of allocated memory
+inline uint32 CSizeClassHeap::GetSize(void* pMem)
+{
+	ASSERT(m_bInitialized);
+
+	CSpan* pSpan = FindSpan(pMem);
+	if ((pSpan == NULL) || (pSpan->m_nSizeClass == SIZECLASSHEAPIDLESPAN)) return 0;
+
+	if (pSpan->m_nSizeClass == SIZECLASSHEAPLARGESPAN) return pSpan->m_nLargeSize;
+
+	return m_aSizeClasses[pSpan->m_nSizeClass].m_nSize;
+};
+
+
+// add an arena of at least nSize bytes
+inline bool CSizeClassHeap::AddArena(size_t nSize)
+{
+	// huge pages come in bigger pieces
+	size_t nAlign = m_bHugePages ? SIZECLASSHEAPHUGEPAGESIZE : SIZECLASSHEAPPAGESIZE;
+	nSize = (nSize + nAlign - 1) & ~(nAlign - 1);
+
+	CArena* pNewArena = new CArena;
+	if (pNewArena == NULL)
+	{
+		ASSERT(false);
+		return false;
+	}
+
+	pNewArena->m_pMem = (uint8*)SizeClassHeapMapMemory(nSize, nAlign, m_bHugePages);
+	if (pNewArena->m_pMem == NULL)
+	{
+		delete pNewArena;
+		return false;
+	}
+
+	pNewArena->m_nSize = nSize;
+	pNewArena->m_nUsed = 0;
+
+	// add to arena list
+	pNewArena->m_pNext = m_pArenaList;
+	m_pArenaList = pNewArena;
+
+	m_nFootprint += nSize;
+
+	return true;
+}
+
+
+// get a span of nNumPages pages, from the idle spans if there is one or else an arena
+inline CSizeClassHeap::CSpan* CSizeClassHeap::NewSpan(uint32 nNumPages)
+{
+	ASSERT(nNumPages <= SIZECLASSHEAPMAXSPANPAGES);
+
+	CSpan* pSpan = m_aIdleSpans[nNumPages];
+	if (pSpan != NULL)
+	{
+		UnlinkSpan(&m_aIdleSpans[nNumPages], pSpan);
+	}
+	else
+	{
+		// make sure the current arena has room
+		size_t nSize = (size_t)nNumPages << SIZECLASSHEAPPAGESHIFT;
+		if ((m_pArenaList == NULL) || (m_pArenaList->m_nUsed + nSize > m_pArenaList->m_nSize))
+		{
+			if (!AddArena(LTMAX(m_nGrowArenaSize, nSize))) return NULL;
+		}
+
+		pSpan = new CSpan;
+		if (pSpan == NULL) return NULL;
+
+		pSpan->m_pStart = m_pArenaList->m_pMem + m_pArenaList->m_nUsed;
+		pSpan->m_nNumPages = nNumPages;
+		if (!SetSpan(pSpan, pSpan))
+		{
+			delete pSpan;
+			return NULL;
+		}
+
+		m_pArenaList->m_nUsed += nSize;
+	}
+
+	// start it out empty
+	pSpan->m_pFreeList = NULL;
+	pSpan->m_nNumCarved = 0;
+	pSpan->m_nNumUsed = 0;
+	pSpan->m_nLargeSize = 0;
+	pSpan->m_pPrev = NULL;
+	pSpan->m_pNext = NULL;
+
+	return pSpan;
+}
+
+
+// allocate a block that is too big for the size classes
+inline void* CSizeClassHeap::AllocLarge(uint32 nSize)
+{
+	size_t nMapSize = ((size_t)nSize + SIZECLASSHEAPPAGESIZE - 1) & ~(size_t)(SIZECLASSHEAPPAGESIZE - 1);
+
+	// only really big blocks are worth huge pages
+	bool bHugePages = m_bHugePages && (nMapSize >= SIZECLASSHEAPHUGEPAGESIZE);
+	if (bHugePages)
+	{
+		nMapSize = (nMapSize + SIZECLASSHEAPHUGEPAGESIZE - 1) & ~(size_t)(SIZECLASSHEAPHUGEPAGESIZE - 1);
+	}
+
+	CSpan* pSpan = new CSpan;
+	if (pSpan == NULL) return NULL;
+
+	pSpan->m_pStart = (uint8*)SizeClassHeapMapMemory(nMapSize,
+		bHugePages ? SIZECLASSHEAPHUGEPAGESIZE : SIZECLASSHEAPPAGESIZE, bHugePages);
+	if (pSpan->m_pStart == NULL)
+	{
+		delete pSpan;
+		return NULL;
+	}
+
+	pSpan->m_nNumPages = (uint32)(nMapSize >> SIZECLASSHEAPPAGESHIFT);
+	pSpan->m_nSizeClass = SIZECLASSHEAPLARGESPAN;
+	pSpan->m_pFreeList = NULL;
+	pSpan->m_nNumCarved = 1;
+	pSpan->m_nNumUsed = 1;
+	pSpan->m_nLargeSize = nSize;
+	pSpan->m_pPrev = NULL;
+	pSpan->m_pNext = NULL;
+
+	if (!SetSpan(pSpan, pSpan))
+	{
+		SizeClassHeapUnmapMemory(pSpan->m_pStart, nMapSize);
+		delete pSpan;
+		return NULL;
+	}
+
+	m_nFootprint += nMapSize;
+	m_nAllocatedSize += nSize;
+
+	return pSpan->m_pStart;
+}
+
+
+// free a block that is too big for the size classes
+inline void CSizeClassHeap::FreeLarge(CSpan* pSpan)
+{
+	size_t nMapSize = (size_t)pSpan->m_nNumPages << SIZECLASSHEAPPAGESHIFT;
+
+	SetSpan(pSpan, NULL);
+	SizeClassHeapUnmapMemory(pSpan->m_pStart, nMapSize);
+
+	m_nFootprint -= nMapSize;
+	m_nAllocatedSize -= pSpan->m_nLargeSize;
+
+	delete pSpan;
+}
+
+
+// find the span that this memory is in (NULL if it isn't in one)
+inline CSizeClassHeap::CSpan* CSizeClassHeap::FindSpan(void* pMem)
+{
+	uintptr_t nPage = (uintptr_t)pMem >> SIZECLASSHEAPPAGESHIFT;
+	uintptr_t nRoot = nPage >> SIZECLASSHEAPLEAFBITS;
+	if (nRoot >= (1 << SIZECLASSHEAPROOTBITS)) return NULL;
+
+	CSpan** pLeaf = m_aPageMap[nRoot];
+	if (pLeaf == NULL) return NULL;
+
+	return pLeaf[nPage & ((1 << SIZECLASSHEAPLEAFBITS) - 1)];
+}
+
+
+// point the page map entries for the span's pages at pMapTo
+inline bool CSizeClassHeap::SetSpan(CSpan* pSpan, CSpan* pMapTo)
+{
+	uintptr_t nFirstPage = (uintptr_t)pSpan->m_pStart >> SIZECLASSHEAPPAGESHIFT;
+	for (uintptr_t nPage = nFirstPage; nPage < nFirstPage + pSpan->m_nNumPages; nPage++)
+	{
+		uintptr_t nRoot = nPage >> SIZECLASSHEAPLEAFBITS;
+		if (nRoot >= (1 << SIZECLASSHEAPROOTBITS))
+		{
+			ASSERT(!"Address is outside the size class heap page map");
+			return false;
+		}
+
+		// the OS hands back zeroed memory so a new leaf starts out empty
+		if (m_aPageMap[nRoot] == NULL)
+		{
+			if (pMapTo == NULL) continue;
+
+			size_t nLeafSize = sizeof(CSpan*) << SIZECLASSHEAPLEAFBITS;
+			m_aPageMap[nRoot] = (CSpan**)SizeClassHeapMapMemory(nLeafSize, SIZECLASSHEAPPAGESIZE, false);
+			if (m_aPageMap[nRoot] == NULL) return false;
+
+			m_nFootprint += nLeafSize;
+		}
+
+		m_aPageMap[nRoot][nPage & ((1 << SIZECLASSHEAPLEAFBITS) - 1)] = pMapTo;
+	}
+
+	return true;
+}
+
+
+// add a span to the front of a list
+inline void CSizeClassHeap::LinkSpan(CSpan** ppList, CSpan* pSpan)
+{
+	pSpan->m_pPrev = NULL;
+	pSpan->m_pNext = *ppList;
+	if (*ppList != NULL) (*ppList)->m_pPrev = pSpan;
+	*ppList = pSpan;
+}
+
+
+// take a span out of a list
+inline void CSizeClassHeap::UnlinkSpan(CSpan** ppList, CSpan* pSpan)
+{
+	if (pSpan->m_pPrev != NULL) pSpan->m_pPrev->m_pNext = pSpan->m_pNext;
+	else *ppList = pSpan->m_pNext;
+	if (pSpan->m_pNext != NULL) pSpan->m_pNext->m_pPrev = pSpan->m_pPrev;
+	pSpan->m_pPrev = NULL;
+	pSpan->m_pNext = NULL;
+}
+
+#endif
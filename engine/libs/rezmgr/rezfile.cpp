@@ -6,7 +6,15 @@
 #define REZMGRDONTUNDEF
 #include "rezmgr.h"
 #include <string.h>
+#include <stdint.h>
 #include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 // -----------------------------------------------------------------------------------------
 // CBaseRezFileList
@@ -238,6 +246,212 @@ char* CRezFile::GetFileName() {
 };
 
 
+// -----------------------------------------------------------------------------------------
+// CRezFileMapped
+
+// The whole file is mapped copy-on-write, so users that scribble on the data they got from
+// CRezItm::Load only change their own copy of those pages.
+
+#ifdef _WIN32
+// PrefetchVirtualMemory is only around on Windows 8 and up, so look it up by hand
+struct CRezMappedRange {
+  void* m_pAddress;
+  SIZE_T m_nSize;
+};
+typedef BOOL (WINAPI *TRezPrefetchVirtualMemory)(HANDLE, ULONG_PTR, CRezMappedRange*, ULONG);
+
+static TRezPrefetchVirtualMemory GetRezPrefetchVirtualMemory() {
+  static TRezPrefetchVirtualMemory s_pPrefetch = (TRezPrefetchVirtualMemory)GetProcAddress(GetModuleHandleA("kernel32.dll"), "PrefetchVirtualMemory");
+  return s_pPrefetch;
+};
+#endif
+
+
+// -----------------------------------------------------------------------------------------
+CRezFileMapped::CRezFileMapped(CRezMgr* pRezMgr) : CBaseRezFile(pRezMgr) {
+  ASSERT(pRezMgr != NULL);
+  m_pMapping = NULL;
+  m_nMapSize = 0;
+  m_sFileName = NULL;
+#ifdef _WIN32
+  m_hFile = INVALID_HANDLE_VALUE;
+  m_hMapping = NULL;
+#endif
+};
+
+
+// -----------------------------------------------------------------------------------------
+CRezFileMapped::~CRezFileMapped() {
+  if (m_pMapping != NULL) Close();
+  if (m_sFileName != NULL) delete [] m_sFileName;
+};
+
+
+// -----------------------------------------------------------------------------------------
+DWORD CRezFileMapped::Read(DWORD nItemPos, DWORD nItemOffset, DWORD nSize, void* pData) {
+  ASSERT(pData != NULL);
+
+  // if size is zero just return
+  if (nSize <= 0) return 0;
+
+  BYTE* pSrc = GetMappedData(nItemPos, nItemOffset, nSize);
+  if (pSrc == NULL) {
+    ASSERT(FALSE); // Read past the end of the file!
+    return 0;
+  }
+
+  memcpy(pData, pSrc, nSize);
+  return nSize;
+};
+
+
+// -----------------------------------------------------------------------------------------
+DWORD CRezFileMapped::Write(DWORD nItemPos, DWORD nItemOffset, DWORD nSize, void* pData) {
+  ASSERT(FALSE); // Mapped rez files are always read only!
+  return 0;
+};
+
+
+// -----------------------------------------------------------------------------------------
+BOOL CRezFileMapped::Open(const char* sFileName, BOOL bReadOnly, BOOL bCreateNew) {
+  ASSERT(m_pMapping == NULL);
+
+  // writable files have to go through CRezFile
+  if (!bReadOnly || bCreateNew) return FALSE;
+
+#ifdef _WIN32
+  m_hFile = CreateFileA(sFileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (m_hFile == INVALID_HANDLE_VALUE) return FALSE;
+
+  LARGE_INTEGER nFileSize;
+  if (!GetFileSizeEx(m_hFile, &nFileSize) || (nFileSize.QuadPart <= 0) || (nFileSize.QuadPart > REZMAPPEDMAXFILESIZE)) {
+    Close();
+    return FALSE;
+  }
+  m_nMapSize = (DWORD)nFileSize.QuadPart;
+
+  m_hMapping = CreateFileMappingA(m_hFile, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+  if (m_hMapping != NULL) m_pMapping = (BYTE*)MapViewOfFile(m_hMapping, FILE_MAP_COPY, 0, 0, 0);
+#else
+  int nFile = open(sFileName, O_RDONLY);
+  if (nFile < 0) return FALSE;
+
+  struct stat cFileStat;
+  if ((fstat(nFile, &cFileStat) == 0) && (cFileStat.st_size > 0) && ((unsigned long long)cFileStat.st_size <= REZMAPPEDMAXFILESIZE)) {
+    m_nMapSize = (DWORD)cFileStat.st_size;
+    void* pMapping = mmap(NULL, m_nMapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, nFile, 0);
+    if (pMapping != MAP_FAILED) m_pMapping = (BYTE*)pMapping;
+  }
+
+  // the mapping keeps the file around
+  close(nFile);
+#endif
+
+  if (m_pMapping == NULL) {
+    Close();
+    return FALSE;
+  }
+
+  if (m_sFileName != NULL) 
+	  delete [] m_sFileName;
+  
+  uint32 nNewStrLen = strlen(sFileName)+1;
+  LT_MEM_TRACK_ALLOC(m_sFileName = new char[nNewStrLen],LT_MEM_TYPE_MISC);
+  
+  if (m_sFileName != NULL) 
+	  LTStrCpy(m_sFileName,sFileName,nNewStrLen);
+
+  return TRUE;
+};
+
+
+// -----------------------------------------------------------------------------------------
+BOOL CRezFileMapped::Close() {
+  BOOL bRetVal = (m_pMapping != NULL);
+
+#ifdef _WIN32
+  if (m_pMapping != NULL) UnmapViewOfFile(m_pMapping);
+  if (m_hMapping != NULL) CloseHandle(m_hMapping);
+  if (m_hFile != INVALID_HANDLE_VALUE) CloseHandle(m_hFile);
+  m_hMapping = NULL;
+  m_hFile = INVALID_HANDLE_VALUE;
+#else
+  if (m_pMapping != NULL) munmap(m_pMapping, m_nMapSize);
+#endif
+
+  m_pMapping = NULL;
+  m_nMapSize = 0;
+  if (m_sFileName != NULL) delete [] m_sFileName;
+  m_sFileName = NULL;
+  return bRetVal;
+};
+
+
+// -----------------------------------------------------------------------------------------
+BOOL CRezFileMapped::Flush() {
+  return (m_pMapping != NULL);
+};
+
+
+// -----------------------------------------------------------------------------------------
+BOOL CRezFileMapped::VerifyFileOpen() {
+  // a mapping can't get closed out from under us
+  return (m_pMapping != NULL);
+};
+
+
+// -----------------------------------------------------------------------------------------
+char* CRezFileMapped::GetFileName() {
+  return m_sFileName;
+};
+
+
+// -----------------------------------------------------------------------------------------
+BYTE* CRezFileMapped::GetMappedData(DWORD nItemPos, DWORD nItemOffset, DWORD nSize) {
+  ASSERT(m_pMapping != NULL);
+
+  // make sure the whole range is inside the file (watching out for overflow)
+  DWORD nStart = nItemPos+nItemOffset;
+  if ((nStart < nItemPos) || (nStart > m_nMapSize) || (nSize > m_nMapSize-nStart)) return NULL;
+
+  return m_pMapping+nStart;
+};
+
+
+// -----------------------------------------------------------------------------------------
+void CRezFileMapped::Advise(DWORD nItemPos, DWORD nItemOffset, DWORD nSize, int nAdvice) {
+  BYTE* pStart = GetMappedData(nItemPos, nItemOffset, nSize);
+  if ((pStart == NULL) || (nSize <= 0)) return;
+
+#ifdef _WIN32
+  // all windows can do is start reading it in
+  if ((nAdvice == REZADVICE_SEQUENTIAL) || (nAdvice == REZADVICE_WILLNEED)) {
+    TRezPrefetchVirtualMemory pPrefetch = GetRezPrefetchVirtualMemory();
+    if (pPrefetch != NULL) {
+      CRezMappedRange cRange;
+      cRange.m_pAddress = pStart;
+      cRange.m_nSize = nSize;
+      pPrefetch(GetCurrentProcess(), 1, &cRange, 0);
+    }
+  }
+#else
+  // the range has to start on a page
+  static const uintptr_t s_nPageMask = (uintptr_t)sysconf(_SC_PAGESIZE)-1;
+  BYTE* pPageStart = (BYTE*)((uintptr_t)pStart & ~s_nPageMask);
+  size_t nLength = (pStart-pPageStart)+nSize;
+
+  int nPosixAdvice;
+  switch (nAdvice) {
+    case REZADVICE_SEQUENTIAL : nPosixAdvice = POSIX_MADV_SEQUENTIAL; break;
+    case REZADVICE_WILLNEED : nPosixAdvice = POSIX_MADV_WILLNEED; break;
+    case REZADVICE_DONTNEED : nPosixAdvice = POSIX_MADV_DONTNEED; break;
+    default : nPosixAdvice = POSIX_MADV_NORMAL; break;
+  }
+  posix_madvise(pPageStart, nLength, nPosixAdvice);
+#endif
+};
+
+
 // -----------------------------------------------------------------------------------------
 // CRezFileDirectory
 
@@ -18,6 +18,19 @@
 #endif
 
 
+// hints for CBaseRezFile::Advise about how a range of the file is about to be used
+#define REZADVICE_NORMAL		0	// no special treatment
+#define REZADVICE_SEQUENTIAL	1	// going to be read from front to back
+#define REZADVICE_WILLNEED		2	// going to be read soon, start bringing it in
+#define REZADVICE_DONTNEED		3	// done with it for now
+
+// largest rez file that will be memory mapped (bigger ones use the stdio path)
+#if defined(_WIN64) || defined(__LP64__)
+#define REZMAPPEDMAXFILESIZE	0xFFFFFFFF
+#else
+#define REZMAPPEDMAXFILESIZE	(256*1024*1024)
+#endif
+
 // forward classes
 class CRezMgr;
 class CBaseRezFile;
@@ -59,6 +72,8 @@ public:
   virtual BOOL Flush() = 0;
   virtual BOOL VerifyFileOpen() = 0;
   virtual char* GetFileName() = 0;
+  virtual BYTE* GetMappedData(DWORD nItemPos, DWORD nItemOffset, DWORD nSize) { return NULL; };	// pointer straight into the file if it is memory mapped (NULL if not)
+  virtual void Advise(DWORD nItemPos, DWORD nItemOffset, DWORD nSize, int nAdvice) { };			// hint at how a range of the file is about to be used (REZADVICE_*)
   CBaseRezFile* Next() { return (CBaseRezFile*)CVirtBaseListItem::Next(); };
   void VirtualFoo();
 protected:
@@ -88,6 +103,32 @@ private:
   DWORD m_nLastSeekPos;
 };
 
+// -----------------------------------------------------------------------------------------
+// CRezFileMapped (read only rez file that is memory mapped instead of read with stdio)
+
+class CRezFileMapped : public CBaseRezFile {
+public:
+  CRezFileMapped(CRezMgr* pRezMgr);
+  ~CRezFileMapped();
+  virtual DWORD Read(DWORD nItemPos, DWORD nItemOffset, DWORD nSize, void* pData);
+  virtual DWORD Write(DWORD nItemPos, DWORD nItemOffset, DWORD nSize, void* pData);
+  virtual BOOL Open(const char* sFileName, BOOL bReadOnly, BOOL bCreateNew);
+  virtual BOOL Close();
+  virtual BOOL Flush();
+  virtual BOOL VerifyFileOpen();
+  virtual char* GetFileName();
+  virtual BYTE* GetMappedData(DWORD nItemPos, DWORD nItemOffset, DWORD nSize);
+  virtual void Advise(DWORD nItemPos, DWORD nItemOffset, DWORD nSize, int nAdvice);
+private:
+  BYTE* m_pMapping;
+  DWORD m_nMapSize;
+  char* m_sFileName;
+#ifdef _WIN32
+  void* m_hFile;
+  void* m_hMapping;
+#endif
+};
+
 // -----------------------------------------------------------------------------------------
 // CRezFileDirectory
 
@@ -133,4 +133,111 @@ CRezDir* CRezDirHashTable::Find(REZCDIRNAME sName, BOOL bIgnoreCase) {
 };
 
 
+// -----------------------------------------------------------------------------------------
+// CRezItmPathIndex
+
+CRezItmPathIndex::CRezItmPathIndex() {
+  m_pSlots = NULL;
+  m_nSlotMask = 0;
+  m_nNumItems = 0;
+  m_pKeys = NULL;
+  m_nKeyBufferSize = 0;
+  m_nKeyBufferUsed = 0;
+};
+
+BOOL CRezItmPathIndex::Init(unsigned int nNumItems, unsigned int nKeyBufferSize) {
+  Term();
+
+  // keep it at most half full so the probes stay short
+  unsigned int nNumSlots = 16;
+  while (nNumSlots < nNumItems*2) nNumSlots *= 2;
+
+  m_pSlots = new CSlot[nNumSlots];
+  if (m_pSlots == NULL) return FALSE;
+  memset(m_pSlots,0,sizeof(CSlot)*nNumSlots);
+  m_nSlotMask = nNumSlots-1;
+
+  if (nKeyBufferSize > 0) {
+    m_pKeys = new char[nKeyBufferSize];
+    if (m_pKeys == NULL) {
+      Term();
+      return FALSE;
+    }
+  }
+  m_nKeyBufferSize = nKeyBufferSize;
+
+  return TRUE;
+};
+
+void CRezItmPathIndex::Term() {
+  if (m_pSlots != NULL) delete [] m_pSlots;
+  if (m_pKeys != NULL) delete [] m_pKeys;
+  m_pSlots = NULL;
+  m_nSlotMask = 0;
+  m_nNumItems = 0;
+  m_pKeys = NULL;
+  m_nKeyBufferSize = 0;
+  m_nKeyBufferUsed = 0;
+};
 
+unsigned int CRezItmPathIndex::HashFunc(const char* sKey, unsigned int nKeyLen, REZTYPE nType) {
+  // FNV-1a over the key, then the type mixed in
+  unsigned int nHash = 2166136261u;
+  for (unsigned int i = 0; i < nKeyLen; i++) {
+    nHash ^= (unsigned char)sKey[i];
+    nHash *= 16777619u;
+  }
+  nHash ^= (unsigned int)nType * 2654435761u;
+  nHash ^= nHash >> 15;
+  return nHash;
+};
+
+BOOL CRezItmPathIndex::Add(const char* sKey, unsigned int nKeyLen, REZTYPE nType, CRezItm* pRezItm) {
+  ASSERT(m_pSlots != NULL);
+  ASSERT(pRezItm != NULL);
+  if ((m_pSlots == NULL) || (pRezItm == NULL)) return FALSE;
+  ASSERT(m_nNumItems < (m_nSlotMask+1)/2);
+  if (m_nKeyBufferUsed+nKeyLen > m_nKeyBufferSize) return FALSE;
+
+  unsigned int nHash = HashFunc(sKey,nKeyLen,nType);
+  unsigned int nSlot = nHash & m_nSlotMask;
+  while (m_pSlots[nSlot].m_pRezItm != NULL) {
+    CSlot* pSlot = &m_pSlots[nSlot];
+
+    // the directory hashes never hold two of the same thing, so this shouldn't happen
+    if ((pSlot->m_nHash == nHash) && (pSlot->m_nType == nType) && (pSlot->m_nKeyLen == nKeyLen) &&
+        (memcmp(&m_pKeys[pSlot->m_nKeyPos],sKey,nKeyLen) == 0)) {
+      ASSERT(FALSE);
+      return FALSE;
+    }
+
+    nSlot = (nSlot+1) & m_nSlotMask;
+  }
+
+  CSlot* pSlot = &m_pSlots[nSlot];
+  pSlot->m_nHash = nHash;
+  pSlot->m_nType = nType;
+  pSlot->m_nKeyPos = m_nKeyBufferUsed;
+  pSlot->m_nKeyLen = nKeyLen;
+  pSlot->m_pRezItm = pRezItm;
+  memcpy(&m_pKeys[m_nKeyBufferUsed],sKey,nKeyLen);
+  m_nKeyBufferUsed += nKeyLen;
+  m_nNumItems++;
+
+  return TRUE;
+};
+
+CRezItm* CRezItmPathIndex::Find(const char* sKey, unsigned int nKeyLen, REZTYPE nType) {
+  ASSERT(m_pSlots != NULL);
+  if (m_pSlots == NULL) return NULL;
+
+  unsigned int nHash = HashFunc(sKey,nKeyLen,nType);
+  unsigned int nSlot = nHash & m_nSlotMask;
+  while (m_pSlots[nSlot].m_pRezItm != NULL) {
+    CSlot* pSlot = &m_pSlots[nSlot];
+    if ((pSlot->m_nHash == nHash) && (pSlot->m_nType == nType) && (pSlot->m_nKeyLen == nKeyLen) &&
+        (memcmp(&m_pKeys[pSlot->m_nKeyPos],sKey,nKeyLen) == 0)) return pSlot->m_pRezItm;
+    nSlot = (nSlot+1) & m_nSlotMask;
+  }
+  return NULL;
+};
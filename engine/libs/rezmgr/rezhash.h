@@ -202,5 +202,42 @@ protected:
 };
 
 
+// -----------------------------------------------------------------------------------------
+// CRezItmPathIndex (flat table of every item in a read only rez mgr keyed by full path and type)
+//
+// The keys are the directory names and item name joined with '\' (already folded to upper
+// case if names are case insensitive).  Once it is built nothing in it changes, so any
+// number of threads can call Find at the same time.
+
+class CRezItmPathIndex {
+public:
+    CRezItmPathIndex();
+    ~CRezItmPathIndex() { Term(); };
+    BOOL                Init(unsigned int nNumItems, unsigned int nKeyBufferSize);	// Allocates room for the items and their keys
+    void                Term();
+    BOOL                IsBuilt() { return (m_pSlots != NULL); };
+    BOOL                Add(const char* sKey, unsigned int nKeyLen, REZTYPE nType, CRezItm* pRezItm);
+    CRezItm*            Find(const char* sKey, unsigned int nKeyLen, REZTYPE nType);
+    unsigned int        GetNumItems() { return m_nNumItems; };
+    static unsigned int HashFunc(const char* sKey, unsigned int nKeyLen, REZTYPE nType);
+
+private:
+    struct CSlot {
+        unsigned int    m_nHash;
+        REZTYPE         m_nType;
+        unsigned int    m_nKeyPos;
+        unsigned int    m_nKeyLen;
+        CRezItm*        m_pRezItm;      // NULL if the slot is empty
+    };
+
+    CSlot*              m_pSlots;
+    unsigned int        m_nSlotMask;    // number of slots - 1 (always a power of 2)
+    unsigned int        m_nNumItems;
+    char*               m_pKeys;        // all of the keys one after the other (not terminated)
+    unsigned int        m_nKeyBufferSize;
+    unsigned int        m_nKeyBufferUsed;
+};
+
+
 #endif
 
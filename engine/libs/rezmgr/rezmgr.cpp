@@ -244,6 +244,10 @@ BYTE* CRezItm::Load() {
 
   // allocate memory for the data
   if (m_nSize == 0) return NULL;
+
+  // if the rez file is memory mapped just hand out a pointer into it
+  BYTE* pMapped = GetMappedData();
+  if (pMapped != NULL) return pMapped;
   LT_MEM_TRACK_ALLOC(m_pData = new BYTE[m_nSize],LT_MEM_TYPE_MISC);
   ASSERT(m_pData != NULL);
   if (m_pData == NULL) return NULL;
@@ -271,9 +275,25 @@ BOOL CRezItm::UnLoad() {
 BOOL CRezItm::IsLoaded() { 
   ASSERT(m_pParentDir != NULL);
   if (m_pParentDir->m_pMemBlock != NULL) return TRUE;
-  else return (m_pData != NULL); 
+  else if (m_pData != NULL) return TRUE;
+  else return (m_pRezFile != NULL) && (GetMappedData() != NULL);
 }; 
 
+//---------------------------------------------------------------------------------------------------
+BYTE* CRezItm::GetMappedData() {
+  if ((m_pRezFile == NULL) || (m_nSize == 0)) return NULL;
+  return m_pRezFile->GetMappedData(m_nFilePos,0,m_nSize);
+};
+
+//---------------------------------------------------------------------------------------------------
+void CRezItm::Advise(int nAdvice) {
+  ASSERT(m_pRezFile != NULL);
+
+  // only matters if it's going to be read from the file
+  if ((m_pParentDir->m_pMemBlock != NULL) || (m_pData != NULL)) return;
+  m_pRezFile->Advise(m_nFilePos,0,m_nSize,nAdvice);
+};
+
 //---------------------------------------------------------------------------------------------------
 BOOL CRezItm::Get(BYTE* pBytes) {
   return (Get(pBytes,0,m_nSize));
@@ -612,13 +632,25 @@ CRezItm* CRezDir::GetRez(REZNAME sRes, REZTYPE nType) {
 CRezItm* CRezDir::GetRezFromDosName(char* sDosName) {
   ASSERT(sDosName != NULL);
 //  ASSERT(strlen(sDosName) < 13);
+  char fname[_MAX_FNAME+1+_MAX_EXT+1];
+  REZTYPE nType;
+  m_pRezMgr->SplitDosName(sDosName,fname,&nType);
+
+  // call the normal GetRez function
+  return GetRez(fname,nType);
+};
+
+//---------------------------------------------------------------------------------------------------
+void CRezMgr::SplitDosName(const char* sDosName, char* fname, REZTYPE* pType) {
+  ASSERT(sDosName != NULL);
+  ASSERT(fname != NULL);
+  ASSERT(pType != NULL);
   char sExt[5];
   REZTYPE nType;
 
   // split the file name up into its parts
   char drive[_MAX_DRIVE+1];
   char dir[_MAX_DIR+1];
-  char fname[_MAX_FNAME+1+_MAX_EXT+1];
   char ext[_MAX_EXT+1];
   _splitpath(sDosName, drive, dir, fname, ext );
 
@@ -638,13 +670,12 @@ CRezItm* CRezDir::GetRezFromDosName(char* sDosName) {
 	if (strlen(ext) > 0) {
 		strcpy(sExt,&ext[1]);
 		strupr(sExt);
-		nType = m_pRezMgr->StrToType(sExt);
+		nType = StrToType(sExt);
 	}
 	else nType = 0;
   }
 
-  // call the normal GetRez function
-  return GetRez(fname,nType);
+  *pType = nType;
 };
 
 //---------------------------------------------------------------------------------------------------
@@ -660,8 +691,13 @@ BOOL CRezDir::Load(BOOL LoadAllSubDirs) {
     return FALSE;
   }
 
+  // if the file is memory mapped the items already point into it, so just get it read in
+  if ((m_nItemsSize > 0) && (m_pRezMgr->m_pPrimaryRezFile->GetMappedData(m_nItemsPos,0,m_nItemsSize) != NULL)) {
+    m_pRezMgr->m_pPrimaryRezFile->Advise(m_nItemsPos,0,m_nItemsSize,REZADVICE_WILLNEED);
+  }
+
   // if the data size is 0 then we don't need to do anything
-  if (m_nItemsSize > 0) {
+  else if (m_nItemsSize > 0) {
 
     // allocate memory for data
     LT_MEM_TRACK_ALLOC(m_pMemBlock = new BYTE[m_nItemsSize],LT_MEM_TYPE_MISC);
@@ -1158,6 +1194,7 @@ CRezMgr::CRezMgr() {
   m_bIsSorted = TRUE;
   m_sFileName = NULL;
   m_nMaxOpenFilesInEmulatedDir = 3;
+  m_bUseMemoryMapping = TRUE;
   m_sDirSeparators = NULL;
   m_bLowerCaseUsed = FALSE;
   m_bItemByIDUsed = FALSE;
@@ -1227,6 +1264,34 @@ CRezMgr::~CRezMgr() {
   }
 };
 
+//---------------------------------------------------------------------------------------------------
+// Creates the low level file object for a rez file and tries to open it.  Read only files are
+// memory mapped if possible, anything else (or a file that couldn't be mapped) uses CRezFile.
+CBaseRezFile* CRezMgr::OpenRezFile(const char* FileName, BOOL ReadOnly, BOOL CreateNew, BOOL* pOpened) {
+  ASSERT(pOpened != NULL);
+  *pOpened = FALSE;
+
+  // try to map it
+  if (m_bUseMemoryMapping && ReadOnly && !CreateNew) {
+    CRezFileMapped* pMappedFile;
+    LT_MEM_TRACK_ALLOC(pMappedFile = new CRezFileMapped(this),LT_MEM_TYPE_MISC);
+    if (pMappedFile != NULL) {
+      if (pMappedFile->Open(FileName,ReadOnly,CreateNew)) {
+        *pOpened = TRUE;
+        return pMappedFile;
+      }
+      delete pMappedFile;
+    }
+  }
+
+  // fall back on stdio
+  CRezFile* pRezFile;
+  LT_MEM_TRACK_ALLOC(pRezFile = new CRezFile(this),LT_MEM_TYPE_MISC);
+  if (pRezFile == NULL) return NULL;
+  *pOpened = pRezFile->Open(FileName,ReadOnly,CreateNew);
+  return pRezFile;
+};
+
 //---------------------------------------------------------------------------------------------------
 BOOL CRezMgr::Open(const char* FileName, BOOL ReadOnly, BOOL CreateNew) {
   ASSERT(FileName != NULL); // NULL file name!
@@ -1270,13 +1335,14 @@ BOOL CRezMgr::Open(const char* FileName, BOOL ReadOnly, BOOL CreateNew) {
 
 	// read in data from directory and all sub directories
 	ReadEmulationDirectory(pRezFile,m_pRootDir,m_sFileName,FALSE);
+	BuildPathIndex();
 
     return TRUE;
   }
 
-  // create a new CRezFile object for the RezFile
-  CRezFile* pRezFile;
-  LT_MEM_TRACK_ALLOC(pRezFile = new CRezFile(this),LT_MEM_TYPE_MISC);
+  // create and open the low level file object for the RezFile
+  BOOL bOpened;
+  CBaseRezFile* pRezFile = OpenRezFile(FileName,ReadOnly,CreateNew,&bOpened);
   ASSERT(pRezFile != NULL);
   if (pRezFile == NULL) {
 	delete [] m_sFileName;
@@ -1287,8 +1353,8 @@ BOOL CRezMgr::Open(const char* FileName, BOOL ReadOnly, BOOL CreateNew) {
   m_lstRezFiles.Insert(pRezFile);
   m_nNumRezFiles++;
 
-  // open the file
-  if (!pRezFile->Open(FileName,ReadOnly,CreateNew)) return FALSE;
+  // make sure the file opened
+  if (!bOpened) return FALSE;
   m_bFileOpened = TRUE;
 
   // set up variables if this is a new file
@@ -1349,6 +1415,9 @@ BOOL CRezMgr::Open(const char* FileName, BOOL ReadOnly, BOOL CreateNew) {
     m_pRootDir->ReadAllDirs(pRezFile, m_nRootDirPos, m_nRootDirSize, FALSE);
   }
 
+  // index all the items by path now that the directories are all there
+  BuildPathIndex();
+
   return TRUE;
 }; 
 
@@ -1394,13 +1463,14 @@ BOOL CRezMgr::OpenAdditional(const char* FileName, BOOL bOverwriteItems) {
 
 	// read in data from directory and all sub directories
 	ReadEmulationDirectory(pRezFile,m_pRootDir,m_sFileName,bOverwriteItems);
+	BuildPathIndex();
 
     return TRUE;
   }
 
-  // create a new CRezFile object for the RezFile
-  CRezFile* pRezFile;
-  LT_MEM_TRACK_ALLOC(pRezFile = new CRezFile(this),LT_MEM_TYPE_MISC);
+  // create and open the low level file object for the RezFile
+  BOOL bOpened;
+  CBaseRezFile* pRezFile = OpenRezFile(FileName,ReadOnly,CreateNew,&bOpened);
   ASSERT(pRezFile != NULL);
   if (pRezFile == NULL) {
 	delete [] m_sFileName;
@@ -1410,8 +1480,8 @@ BOOL CRezMgr::OpenAdditional(const char* FileName, BOOL bOverwriteItems) {
   m_lstRezFiles.Insert(pRezFile);
   m_nNumRezFiles++;
 
-  // open the file
-  if (!pRezFile->Open(FileName,ReadOnly,CreateNew)) return FALSE;
+  // make sure the file opened
+  if (!bOpened) return FALSE;
 
   // read in the header
   FileMainHeaderStruct Header;
@@ -1432,6 +1502,9 @@ BOOL CRezMgr::OpenAdditional(const char* FileName, BOOL bOverwriteItems) {
   // read in directories
   m_pRootDir->ReadAllDirs(pRezFile, Header.RootDirPos, Header.RootDirSize, bOverwriteItems);
 
+  // the new items may have replaced old ones so index everything again
+  BuildPathIndex();
+
   return TRUE;
 };
 
@@ -1632,6 +1705,7 @@ BOOL CRezMgr::Close(BOOL bCompact) {
   }
 
   // remove memory in this object associated with the open file
+  m_PathIndex.Term();
   if (m_pRootDir != NULL) {
     delete m_pRootDir;
     m_pRootDir = NULL;
@@ -2231,15 +2305,192 @@ CRezItm* CRezDir::GetRezFromPath(const char* sPath, REZTYPE type)
 //---------------------------------------------------------------------------------------------------
 CRezItm* CRezMgr::GetRezFromPath(const char* sPath, REZTYPE type)
 {
+	CRezItm* pRezItm;
+	if (FindInPathIndex(sPath, FALSE, type, &pRezItm)) return(pRezItm);
+
 	return(GetRootDir()->GetRezFromPath(sPath, type));
 }
 
 //---------------------------------------------------------------------------------------------------
 CRezItm* CRezMgr::GetRezFromDosPath(const char* sPath)
 {
+	CRezItm* pRezItm;
+	if (FindInPathIndex(sPath, TRUE, 0, &pRezItm)) return(pRezItm);
+
 	return(GetRootDir()->GetRezFromDosPath(sPath));
 }
 
+//---------------------------------------------------------------------------------------------------
+// Builds the path index for a read only rez mgr.  Items get looked up in it with the same
+// path rules as CRezDir::GetRezFromPath, but with one probe instead of a walk down the
+// directory and type hash tables.
+void CRezMgr::BuildPathIndex()
+{
+	m_PathIndex.Term();
+
+	// a file that can be written to can change under the index
+	if (!m_bReadOnly || (m_pRootDir == NULL)) return;
+
+	char sPath[1024];
+
+	// count everything first so it all goes in one block
+	unsigned int nNumItems = 0;
+	unsigned int nKeyBufferSize = 0;
+	AddDirToPathIndex(m_pRootDir, sPath, 0, &nNumItems, &nKeyBufferSize);
+
+	if (!m_PathIndex.Init(nNumItems, nKeyBufferSize)) return;
+
+	AddDirToPathIndex(m_pRootDir, sPath, 0, NULL, NULL);
+	ASSERT(m_PathIndex.GetNumItems() == nNumItems);
+}
+
+//---------------------------------------------------------------------------------------------------
+// Adds the items in a directory and all of its sub directories (or just counts them if pNumItems
+// is not NULL).  sPath holds the key for the directory up to nPathLen.
+void CRezMgr::AddDirToPathIndex(CRezDir* pDir, char* sPath, unsigned int nPathLen, unsigned int* pNumItems, unsigned int* pKeyBufferSize)
+{
+	ASSERT(pDir != NULL);
+
+	// the items in this directory
+	for (CRezTypeHash* pTypHash = pDir->m_haTypes.GetFirst(); pTypHash != NULL; pTypHash = pTypHash->Next())
+	{
+		CRezTyp* pTyp = pTypHash->GetRezTyp();
+		for (CRezItmHashByName* pItmHash = pTyp->m_haName.GetFirst(); pItmHash != NULL; pItmHash = pItmHash->Next())
+		{
+			CRezItm* pItm = pItmHash->GetRezItm();
+			unsigned int nNameLen = FoldPathIndexKey(&sPath[nPathLen], pItm->GetName(), 1023-nPathLen);
+
+			// anything this long can't be looked up by path anyway
+			if (nNameLen == 0xffffffff) continue;
+
+			if (pNumItems != NULL)
+			{
+				(*pNumItems)++;
+				(*pKeyBufferSize) += nPathLen+nNameLen;
+			}
+			else
+			{
+				m_PathIndex.Add(sPath, nPathLen+nNameLen, pTyp->GetType(), pItm);
+			}
+		}
+	}
+
+	// and all of the sub directories
+	for (CRezDirHash* pDirHash = pDir->m_haDir.GetFirst(); pDirHash != NULL; pDirHash = pDirHash->Next())
+	{
+		CRezDir* pSubDir = pDirHash->GetRezDir();
+		unsigned int nNameLen = FoldPathIndexKey(&sPath[nPathLen], pSubDir->GetDirName(), 1022-nPathLen);
+		if (nNameLen == 0xffffffff) continue;
+
+		sPath[nPathLen+nNameLen] = '\\';
+		AddDirToPathIndex(pSubDir, sPath, nPathLen+nNameLen+1, pNumItems, pKeyBufferSize);
+	}
+}
+
+//---------------------------------------------------------------------------------------------------
+// Copies a name into a path index key, folding it to upper case unless names are case sensitive.
+// Returns the length, or 0xffffffff if it doesn't fit in nMaxLen.
+unsigned int CRezMgr::FoldPathIndexKey(char* sKey, const char* sName, unsigned int nMaxLen)
+{
+	unsigned int nLen = 0;
+	for (; sName[nLen] != '\0'; nLen++)
+	{
+		if (nLen >= nMaxLen) return 0xffffffff;
+
+		char c = sName[nLen];
+		if (!m_bLowerCaseUsed && (c >= 'a') && (c <= 'z')) c -= 'a'-'A';
+		sKey[nLen] = c;
+	}
+	return nLen;
+}
+
+//---------------------------------------------------------------------------------------------------
+// Looks up a full path in the path index.  Returns TRUE if the index gave the answer (which may
+// be that the item isn't there), or FALSE if the path has to go through the directories instead.
+// This follows CRezDir::GetRezFromDosPath and GetDirFromPath step for step.  Anything that doesn't
+// fit in the key buffers goes to the directories too, rather than being cut short and matching
+// some other item.
+BOOL CRezMgr::FindInPathIndex(const char* sPath, BOOL bDosName, REZTYPE nType, CRezItm** ppRezItm)
+{
+	ASSERT(ppRezItm != NULL);
+	*ppRezItm = NULL;
+
+	if (!m_PathIndex.IsBuilt()) return(FALSE);
+	CRezDir* pRoot = m_pRootDir;
+
+	int len = strlen(sPath);
+	if (len >= 1023) return(FALSE);
+
+	// strip off leading slash
+	if (len > 1)
+	{
+		if (!pRoot->IsGoodChar(sPath[0]))
+		{
+			sPath = &sPath[1];
+			len--;
+		}
+	}
+
+	// find where the rez name starts
+	int i = len - 1;
+	while ((i >= 0) && pRoot->IsGoodChar(sPath[i])) i--;
+
+	// names right after the first character are looked up in the root directory no
+	// matter what comes before them, so leave those to the directories
+	if ((i == 0) || (i == 1)) return(FALSE);
+
+	char sKey[1024];
+	unsigned int nKeyLen = 0;
+
+	// directory part (sPath[0] to sPath[i])
+	if (i > 1)
+	{
+		int nDirLen = i;
+		int nPos = 0;
+
+		if (!pRoot->IsGoodChar(sPath[0])) nPos++;
+
+		while (TRUE)
+		{
+			// one directory name
+			int nStart = nPos;
+			while ((nPos < nDirLen) && pRoot->IsGoodChar(sPath[nPos])) nPos++;
+			if (nPos == nStart) return(TRUE);  // no directory has an empty name
+
+			char sDirName[1024];
+			memcpy(sDirName, &sPath[nStart], nPos-nStart);
+			sDirName[nPos-nStart] = '\0';
+			unsigned int nNameLen = FoldPathIndexKey(&sKey[nKeyLen], sDirName, 1022-nKeyLen);
+			if (nNameLen == 0xffffffff) return(FALSE);
+			nKeyLen += nNameLen;
+			sKey[nKeyLen++] = '\\';
+
+			// skip the separators, the rest of the path might be nothing but separators
+			while ((nPos < nDirLen) && !pRoot->IsGoodChar(sPath[nPos])) nPos++;
+			if (nPos >= nDirLen) break;
+		}
+	}
+
+	// the rez name
+	char sRez[_MAX_FNAME+1+_MAX_EXT+1];
+	if (strlen(&sPath[i+1]) >= sizeof(sRez)) return(FALSE);
+	if (bDosName)
+	{
+		SplitDosName(&sPath[i+1], sRez, &nType);
+	}
+	else
+	{
+		strcpy(sRez, &sPath[i+1]);
+	}
+
+	unsigned int nNameLen = FoldPathIndexKey(&sKey[nKeyLen], sRez, 1023-nKeyLen);
+	if (nNameLen == 0xffffffff) return(FALSE);
+	nKeyLen += nNameLen;
+
+	*ppRezItm = m_PathIndex.Find(sKey, nKeyLen, nType);
+	return(TRUE);
+}
+
 //---------------------------------------------------------------------------------------------------
 CRezDir* CRezMgr::GetDirFromPath(const char* sPath)
 {
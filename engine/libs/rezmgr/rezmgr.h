@@ -72,6 +72,8 @@ public:
 	BYTE*		Load();                                                                 // Returns a pointer to the data for this item (loads from disk if not already in memory)
 	BOOL		UnLoad();                                                               // Frees the memory for this item
 	BOOL		IsLoaded();                                                             // Returns TRUE if this item is currently in memory
+	BYTE*		GetMappedData();                                                        // Returns a pointer straight into the rez file if it is memory mapped (NULL if not), nothing is copied or allocated
+	void		Advise(int nAdvice);                                                    // Hint at how this item is about to be read (REZADVICE_*, only does anything for memory mapped rez files)
 
 	DWORD		GetSeekPos() { return m_nCurPos; };                                     // Get the current position inside this resource
 	BOOL		Seek(DWORD offset);                                                     // Set the current position inside this resource
@@ -285,6 +287,10 @@ public:
     void ForceIsSortedFlag(BOOL bFlag) { m_bIsSorted = bFlag; };   // For use in zmgr program to force the sorted flag
 	void SetMaxOpenFilesInEmulatedDir(int nNumFiles) { m_nMaxOpenFilesInEmulatedDir = nNumFiles; };  
 
+	// memory mapping of read only rez files (defaults to TRUE, should call set right after constructor but before open)
+	BOOL GetUseMemoryMapping() { return m_bUseMemoryMapping; };
+	void SetUseMemoryMapping(BOOL bUseMemoryMapping) { m_bUseMemoryMapping = bUseMemoryMapping; };
+
 	// accessors for usertitle header information
 	void SetUserTitle(const char* sUserTitle);
 	char* GetUserTitle() { return m_sUserTitle; };
@@ -327,8 +333,16 @@ private:
     // other internal functions
     REZTIME     GetCurTime();                                                           // For use by any internal function that wants to get the current time
     BOOL		IsDirectory(const char* sFileName);
+    CBaseRezFile* OpenRezFile(const char* FileName, BOOL ReadOnly, BOOL CreateNew, BOOL* pOpened);
     BOOL        ReadEmulationDirectory(CRezFileDirectoryEmulation* pRezFileEmulation, CRezDir* pDir, char* sParamPath, BOOL bOverwriteItems);
 	BOOL		Flush();
+	void		SplitDosName(const char* sDosName, char* sName, REZTYPE* pType);		// Splits an old style dos file name into the resource name and type (sName must hold _MAX_FNAME+1+_MAX_EXT+1)
+
+	// path index functions
+	void		BuildPathIndex();
+	void		AddDirToPathIndex(CRezDir* pDir, char* sPath, unsigned int nPathLen, unsigned int* pNumItems, unsigned int* pKeyBufferSize);
+	unsigned int FoldPathIndexKey(char* sKey, const char* sName, unsigned int nMaxLen);
+	BOOL		FindInPathIndex(const char* sPath, BOOL bDosName, REZTYPE nType, CRezItm** ppRezItm);
 
 	// internal data members
 	char*		m_sDirSeparators;		// Separator characters between directories (if NULL(default) use built in method)
@@ -341,6 +355,7 @@ private:
 	BOOL		m_bRenumberIDCollisions;// If TRUE then ID's of resources that collide will simply be re-numbered
 	DWORD		m_nNextIDNumToUse;		// Next ID number to use for allocating collisions and assigning to directories
 	int			m_nMaxOpenFilesInEmulatedDir; // Maximum number of files that can be open at one time in a emulated dir
+	BOOL		m_bUseMemoryMapping;	// If TRUE then read only rez files are memory mapped instead of read with stdio (DEFAULT IS TRUE)
 //	FILE*		m_pRezFile;	  			// The system file pointer for the resource file
 // MOST OF THE REST OF THE VARIABLES BELOW ONLY APPLY TO THE FIRST RESOURCE FILE IN THE m_lstRezFiles LIST
 	DWORD		m_nRootDirPos;			// The seek position in the file where the root directory is located
@@ -367,6 +382,7 @@ private:
 	CRezItmChunkList m_lstRezItmChunks; // list of RezItm chunks
 	unsigned int m_nRezItmChunkSize;	// number of rez items to allocate at once in a chunk
 	char		m_sUserTitle[RezMgrUserTitleSize+1]; // user title information found in file header
+	CRezItmPathIndex m_PathIndex;		// Index of every item by full path (only built for read only files)
 };
 
 
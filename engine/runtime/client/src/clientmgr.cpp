@@ -38,6 +38,7 @@
 #include "bindmgr.h"
 #include "clientshell.h"
 #include "servermgr.h"
+#include "framearena.h"
 #include "systimer.h"
 #include "iltclient.h"
 #include "ltbenchmark_impl.h"
@@ -790,6 +791,9 @@ LTRESULT CClientMgr::Update()
 
 #endif
 
+    // Start a new frame for this thread's scratch memory
+    FrameArena_BeginFrame();
+
     // Update videos.
     if (m_pVideoMgr)
 	{
@@ -710,6 +710,9 @@ LTRESULT CClientShell::DoLoadWorld(const CPacket_Read &cPacket, bool bLocal)
     // Cleanup...
     cs_UnloadWorld(this);
 
+    // The server starts the delta snapshots over with the new world.
+    m_SnapshotDelta.Reset();
+
     
 	// Tell the client shell to stop rendering for a sec..
 	if (i_client_shell != NULL)
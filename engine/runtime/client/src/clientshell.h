@@ -27,6 +27,10 @@ struct FileIdentifier;
 #include "netmgr.h"
 #endif
 
+#ifndef __SNAPSHOTDELTA_H__
+#include "snapshotdelta.h"
+#endif
+
 class CClientShell : public CNetHandler
 {
 	// Main stuff.
@@ -164,6 +168,9 @@ class CClientShell : public CNetHandler
 		uint16					m_ClientID;
 		bool					m_bLocal;	// Are we connected to the server locally?
 
+		// Baselines and acks for the delta compressed unguaranteed updates.
+		CSnapshotDeltaReceiver	m_SnapshotDelta;
+
 
 	public:
 
@@ -93,4 +93,9 @@ char* CMoveAbstract::GetObjectClassName(LTObject *pObject) {
     return "CLIENT-OBJECT";
 }
 
+
+void CMoveAbstract::OnObjectMoved(LTObject *pObj) {
+
+}
+
 //EOF
@@ -31,6 +31,7 @@ public:
 	LTBOOL			CanOptimizeObject(LTObject *pObj);
 	char*			GetObjectClassName(LTObject *pObject);
 	ILTPhysics *	GetPhysics();
+	void			OnObjectMoved(LTObject *pObj);
 };
 
 #endif  // __CMOVEABSTRACT_H__
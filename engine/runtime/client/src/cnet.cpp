@@ -13,6 +13,7 @@
 // Includes....
 #include "bdefs.h"
 #include "clientmgr.h"
+#include "clientshell.h"
 #include "consolecommands.h"
 
 
@@ -61,4 +62,15 @@ void CClientMgr::SendUpdate(CNetMgr *pNetMgr, CBaseConn *pConnID)
 
 		pNetMgr->SendPacket(CPacket_Read(cPacket), pConnID, MESSAGE_GUARANTEED);
 	}
+
+	// Tell the server which delta snapshots made it.  Losing one of these just
+	// means the server builds on older snapshots, so it doesn't need to be guaranteed.
+	CSnapshotDeltaReceiver *pSnapshotDelta = &m_pCurShell->m_SnapshotDelta;
+	if (pSnapshotDelta->IsAckPending())
+	{
+		CPacket_Write cAckPacket;
+		cAckPacket.Writeuint8(CMSG_SNAPSHOTACK);
+		pSnapshotDelta->WriteAck(cAckPacket);
+		pNetMgr->SendPacket(CPacket_Read(cAckPacket), pConnID, 0);
+	}
 }
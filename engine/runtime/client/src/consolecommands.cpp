@@ -24,6 +24,7 @@
 #include "render.h"
 
 #include "client_ticks.h"
+#include "framearena.h"
 
 //------------------------------------------------------------------
 //------------------------------------------------------------------
@@ -871,6 +872,7 @@ static LTCommandStruct g_LTCommandStructs[] =
 	"ShowVersionInfo", con_ShowVersionInfo, 0,
 	"MoveConsole", con_MoveConsole, 0,
 	"Mem", LTMemConsole, 0,
+	"FrameArena", FrameArenaConsole, 0,
 	"ShowTicks", con_ShowTicks, 0,
 };	
 
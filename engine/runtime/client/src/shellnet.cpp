@@ -65,6 +65,7 @@ extern int32 g_bLocalDebug;
 extern int32 g_CV_UpdateRate;
 extern int32 g_bDebugPackets;
 extern int32 g_CV_BandwidthTargetClient;
+extern int32 g_CV_SnapshotDeltaClient;
 
 // The main list of packet handlers.
 struct ShellPacketHandler 
@@ -1207,7 +1208,9 @@ static LTRESULT OnUpdatePacket(CClientShell *pShell, CPacket_Read &cPacket)
 
 
  
-static LTRESULT OnUnguaranteedUpdatePacket(CClientShell *pShell, CPacket_Read &cPacket) 
+// Reads the object updates in an unguaranteed update.  If pDelta is provided, 
+// the positions are delta compressed.
+static LTRESULT ReadUnguaranteedObjects(CClientShell *pShell, CPacket_Read &cPacket, CSnapshotDeltaReceiver *pDelta) 
 {
     uint16 id;
 	uint8 flags;
@@ -1236,13 +1239,24 @@ static LTRESULT OnUnguaranteedUpdatePacket(CClientShell *pShell, CPacket_Read &c
            			
             if (flags & UUF_POS) 
 			{
-				newPos = CLTMessage_Read_Client::ReadCompPos(cPacket);
+				bool bHavePos = true;
+				if (pDelta)
+				{
+					CompWorldPos cDeltaPos;
+					bHavePos = pDelta->ReadPos(cPacket, id, &cDeltaPos);
+					if (bHavePos)
+						world_bsp_client->DecodeCompressWorldPosition(&newPos, &cDeltaPos);
+				}
+				else
+				{
+					newPos = CLTMessage_Read_Client::ReadCompPos(cPacket);
+				}
 				if (cPacket.Readbool())
 					newVel = CLTMessage_Read::ReadCompLTVector(cPacket);
 				else
 					newVel.Init();
 
-                if (pObject) 
+                if (pObject && bHavePos) 
 				{
 					bool bSameAsLast = false;
 					ClientData *pData;
@@ -1305,6 +1319,28 @@ static LTRESULT OnUnguaranteedUpdatePacket(CClientShell *pShell, CPacket_Read &c
     return LT_OK;
 }
 
+static LTRESULT OnUnguaranteedUpdatePacket(CClientShell *pShell, CPacket_Read &cPacket) 
+{
+	// Let the server know we'd rather have delta updates
+	pShell->m_SnapshotDelta.OnPlainUpdate(!pShell->m_bLocal && (g_CV_SnapshotDeltaClient != 0));
+
+	return ReadUnguaranteedObjects(pShell, cPacket, LTNULL);
+}
+
+static LTRESULT OnDeltaUpdatePacket(CClientShell *pShell, CPacket_Read &cPacket) 
+{
+	// Skip it if it's out of date
+	if (!pShell->m_SnapshotDelta.BeginSnapshot(cPacket))
+		return LT_OK;
+
+	LTRESULT dResult = ReadUnguaranteedObjects(pShell, cPacket, &pShell->m_SnapshotDelta);
+
+	// Only ack it if we got all the way through
+	pShell->m_SnapshotDelta.EndSnapshot((dResult == LT_OK) && cPacket.EOP());
+
+	return dResult;
+}
+
 
 static LTRESULT OnMessagePacket(CClientShell *pShell, CPacket_Read &cPacket) 
 {
@@ -1753,6 +1789,7 @@ void CClientShell::InitHandlers()
 
     g_ShellHandlers[SMSG_UPDATE].fn = &OnUpdatePacket;
     g_ShellHandlers[SMSG_UNGUARANTEEDUPDATE].fn = &OnUnguaranteedUpdatePacket;
+    g_ShellHandlers[SMSG_DELTAUPDATE].fn = &OnDeltaUpdatePacket;
 
     g_ShellHandlers[SMSG_MESSAGE].fn = &OnMessagePacket;
     g_ShellHandlers[SMSG_PACKETGROUP].fn = &OnPacketGroupPacket;
@@ -394,3 +394,10 @@ int df_Save(ILTStream *hFile, const char* pName)
 {
 	return 0;
 }
+
+
+// Rez trees can't be opened here, so there's never anything mapped
+const void* df_GetMappedData(HLTFileTree* hTree, const char *pName, uint32* nSize)
+{
+	return LTNULL;
+}
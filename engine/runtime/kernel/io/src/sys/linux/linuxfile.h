@@ -112,6 +112,10 @@
 	// returns 1 if successful 0 if an error occured
 	int df_Save(ILTStream *hFile, const char* pName);
 
+	// Returns a pointer straight to the data for pName if it lives in a memory
+	// mapped rez file (LTNULL otherwise).
+	const void* df_GetMappedData(HLTFileTree* hTree, const char *pName, uint32* nSize);
+
 #endif  // __DE_FILE_ACCESS_H__
 
 
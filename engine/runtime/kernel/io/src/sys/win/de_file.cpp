@@ -72,10 +72,6 @@ uint32 g_PD_FOpen=0;
 // Structures and defines.
 // ------------------------------------------------------------------ //
 
-CRezItm* g_pDeFileLastRezItm;
-uint32 g_nDeFileLastRezPos;
-
-
 struct FileTree
 {
 	TreeType	m_TreeType;
@@ -222,22 +218,15 @@ public:
 			EnterCriticalSection(&m_pTree->m_CriticalSection);
 			#endif
 			
-			if ((g_pDeFileLastRezItm == m_pRezItm) && (g_nDeFileLastRezPos == m_SeekOffset))
-			{
-				sizeRead = m_pRezItm->Read(pData, size);
-			}
-			else
-			{
-				sizeRead = m_pRezItm->Read(pData, size, m_SeekOffset);
-			}
+			// Always give it the position, since another stream (maybe on another
+			// thread) could have moved the item's position since our last read
+			sizeRead = m_pRezItm->Read(pData, size, m_SeekOffset);
 			
 			#ifdef LT_FILE_THREADSAFE
 			LeaveCriticalSection(&m_pTree->m_CriticalSection);
 			#endif
 			
 			m_SeekOffset += sizeRead;
-			g_pDeFileLastRezItm = m_pRezItm;
-			g_nDeFileLastRezPos = m_SeekOffset;
 			if(sizeRead != size)
 			{
 				memset(pData, 0, size);
@@ -298,8 +287,6 @@ struct LTFindData
 
 void df_Init()
 {
-	g_pDeFileLastRezItm = LTNULL;
-	g_nDeFileLastRezPos = 0;
 }
 
 void df_Term()
@@ -349,8 +336,6 @@ int df_OpenTree(const char *pName, HLTFileTree *&pTreePointer)
 		}
 
 		pTree->m_pRezMgr->SetDirSeparators("\\/");
-		g_pDeFileLastRezItm = LTNULL;
-		g_nDeFileLastRezPos = 0;
 
 #ifdef LT_FILE_THREADSAFE
 		InitializeCriticalSection(&pTree->m_CriticalSection);
@@ -380,8 +365,6 @@ void df_CloseTree(HLTFileTree *hTree)
 		DeleteCriticalSection(&pTree->m_CriticalSection);
 #endif
 	}
-	g_pDeFileLastRezItm = LTNULL;
-	g_nDeFileLastRezPos = 0;
 
 	dfree(pTree);
 }
@@ -561,6 +544,10 @@ ILTStream* df_Open(HLTFileTree *hTree, const char *pName, int openMode)
 		pRezStream->m_FileLen = pRezItm->GetSize();
 		pRezStream->m_SeekOffset = 0;
 
+		// Streams get read front to back (worlds especially), so have the OS read ahead
+		// if the rez file is mapped
+		pRezItm->Advise(REZADVICE_SEQUENTIAL);
+
 		if (g_CV_ShowFileAccess >= 1)
 		{
 			dsi_ConsolePrint("stream %p open rez %s size = %u",pRezStream,pName,pRezItm->GetSize());
@@ -918,3 +905,29 @@ int df_GetRawInfo(HLTFileTree *hTree, const char *pName, char* sFileName, unsign
 }
 
 
+
+
+// Returns a pointer straight to the data for pName if it lives in a memory mapped
+// rez file (LTNULL otherwise), and the size of the data in nSize
+const void* df_GetMappedData(HLTFileTree *hTree, const char *pName, uint32* nSize)
+{
+	FileTree *pTree;
+	CRezItm* pRezItm;
+	BYTE* pData;
+
+	// cast as a FileTree
+	pTree = (FileTree*)hTree;
+	if(!pTree || (pTree->m_TreeType != RezFileTree)) return LTNULL;
+
+	// get the rez item that corresponds to this resource
+	pRezItm = pTree->m_pRezMgr->GetRezFromDosPath(pName);
+	if (pRezItm == LTNULL) return LTNULL;
+
+	// only hand it out if it's in the mapping, since anything Load()ed would
+	// have to be freed by someone
+	pData = pRezItm->GetMappedData();
+	if (pData == LTNULL) return LTNULL;
+
+	*nSize = pRezItm->GetSize();
+	return pData;
+}
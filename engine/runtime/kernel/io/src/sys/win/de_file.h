@@ -111,6 +111,11 @@ int df_Save(ILTStream *hFile, const char *pName);
 // nSize returns the size of the data 
 int df_GetRawInfo(HLTFileTree *hTree, const char *pName, char* sFileName, unsigned int nMaxFileName, uint32* nPos, uint32* nSize);
 
+// Returns a pointer straight to the data for pName if it lives in a memory mapped
+// rez file, so it can be used without reading it anywhere.  The pointer stays good
+// until the tree is closed.  Returns LTNULL for dos trees and unmapped rez files.
+const void* df_GetMappedData(HLTFileTree *hTree, const char *pName, uint32* nSize);
+
 #endif  // __DE_FILE_H__
 
 
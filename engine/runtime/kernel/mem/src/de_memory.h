@@ -21,6 +21,13 @@ void dm_Term();
 uint32 dm_GetBytesAllocated();
 uint32 dm_GetNumAllocations();
 
+// Count the allocations made on this thread on their own as well, so test harnesses 
+// can take out what they use.  They're counted by the thread that does the 
+// allocating or freeing, so memory that changes threads throws them off a bit.
+void dm_SetThreadExcluded(bool bExcluded);
+uint32 dm_GetExcludedBytesAllocated();
+uint32 dm_GetExcludedNumAllocations();
+
 extern void* operator new(size_t size, void *ptr, char z);
 
 // C dalloc/dfree functions.
@@ -0,0 +1,261 @@
+#include "bdefs.h"
+
+#include "framearena.h"
+
+#include <cstdint>
+
+
+// Chunks are kept in a list in the order they get used.  Rolling back leaves
+// the later ones where they are, so the next frame walks the same chunks again.
+struct CFrameArena::SChunk
+{
+	SChunk	*m_pNext;
+	uint32	m_nSize;
+
+	uint8	*GetData() { return (uint8*)this + k_nHeaderSize; }
+
+	enum { k_nHeaderSize = (sizeof(SChunk*) + sizeof(uint32) + k_nDefaultAlign - 1) & ~(k_nDefaultAlign - 1) };
+};
+
+
+//------------------------------------------------------------------
+// CFrameArena
+//------------------------------------------------------------------
+
+CFrameArena::CFrameArena() :
+	m_pFirst(LTNULL),
+	m_pCur(LTNULL),
+	m_nUsed(0),
+	m_nUsedBefore(0),
+	m_nOpenMarks(0),
+	m_nReserved(0),
+	m_nAllocs(0),
+	m_nBytes(0),
+	m_pPrevArena(LTNULL)
+{
+	memset(&m_Stats, 0, sizeof(m_Stats));
+
+	std::lock_guard<std::mutex> cLock(GetArenaListMutex());
+	m_pNextArena = s_pArenaList;
+	if (m_pNextArena)
+		m_pNextArena->m_pPrevArena = this;
+	s_pArenaList = this;
+}
+
+CFrameArena::~CFrameArena()
+{
+	Term();
+
+	std::lock_guard<std::mutex> cLock(GetArenaListMutex());
+	if (m_pPrevArena)
+		m_pPrevArena->m_pNextArena = m_pNextArena;
+	else
+		s_pArenaList = m_pNextArena;
+	if (m_pNextArena)
+		m_pNextArena->m_pPrevArena = m_pPrevArena;
+}
+
+CFrameArena *CFrameArena::s_pArenaList = LTNULL;
+
+std::mutex &CFrameArena::GetArenaListMutex()
+{
+	static std::mutex s_cMutex;
+	return s_cMutex;
+}
+
+void CFrameArena::Term()
+{
+	ASSERT(!m_nOpenMarks);
+
+	SChunk *pCurChunk = m_pFirst;
+	while (pCurChunk)
+	{
+		SChunk *pNextChunk = pCurChunk->m_pNext;
+		delete [] (uint8*)pCurChunk;
+		pCurChunk = pNextChunk;
+	}
+
+	m_pFirst = LTNULL;
+	m_pCur = LTNULL;
+	m_nUsed = 0;
+	m_nUsedBefore = 0;
+	m_nReserved.store(0, std::memory_order_relaxed);
+}
+
+CFrameArena::SChunk *CFrameArena::NextChunk(uint32 nMinSize)
+{
+	SChunk *pNextChunk = m_pCur ? m_pCur->m_pNext : m_pFirst;
+
+	// Use the next one if it's big enough, otherwise put a new one in front of it
+	if (!pNextChunk || (pNextChunk->m_nSize < nMinSize))
+	{
+		uint32 nSize = LTMAX((uint32)k_nChunkSize, nMinSize);
+
+		uint8 *pMem;
+		LT_MEM_TRACK_ALLOC(pMem = new uint8[SChunk::k_nHeaderSize + nSize], LT_MEM_TYPE_MEM);
+
+		SChunk *pNewChunk = (SChunk*)pMem;
+		pNewChunk->m_pNext = pNextChunk;
+		pNewChunk->m_nSize = nSize;
+
+		if (m_pCur)
+			m_pCur->m_pNext = pNewChunk;
+		else
+			m_pFirst = pNewChunk;
+
+		m_nReserved.store(GetReserved() + nSize, std::memory_order_relaxed);
+		++m_Stats.m_nChunkAllocs;
+
+		pNextChunk = pNewChunk;
+	}
+
+	if (m_pCur)
+		m_nUsedBefore += m_nUsed;
+	m_pCur = pNextChunk;
+	m_nUsed = 0;
+
+	return pNextChunk;
+}
+
+void *CFrameArena::Alloc(uint32 nSize, uint32 nAlign)
+{
+	ASSERT(nAlign && !(nAlign & (nAlign - 1)));
+
+	uint8 *pResult = LTNULL;
+	if (m_pCur)
+	{
+		uint8 *pData = m_pCur->GetData();
+		pResult = (uint8*)(((uintptr_t)(pData + m_nUsed) + nAlign - 1) & ~(uintptr_t)(nAlign - 1));
+		if ((uint32)(pResult - pData) + nSize > m_pCur->m_nSize)
+			pResult = LTNULL;
+	}
+
+	if (!pResult)
+	{
+		// Leave room to line it up, since new only promises 8 byte alignment on some platforms
+		SChunk *pChunk = NextChunk(nSize + nAlign - 1);
+		uint8 *pData = pChunk->GetData();
+		pResult = (uint8*)(((uintptr_t)pData + nAlign - 1) & ~(uintptr_t)(nAlign - 1));
+	}
+
+	m_nUsed = (uint32)(pResult - m_pCur->GetData()) + nSize;
+
+	++m_Stats.m_nAllocs;
+	m_Stats.m_nBytes += nSize;
+	m_Stats.m_nHighWater = LTMAX(m_Stats.m_nHighWater, m_nUsedBefore + m_nUsed);
+	m_nAllocs.store(GetNumAllocs() + 1, std::memory_order_relaxed);
+	m_nBytes.store(GetNumBytes() + nSize, std::memory_order_relaxed);
+
+	return pResult;
+}
+
+CFrameArena::SMark CFrameArena::GetMark() const
+{
+	SMark cMark;
+	cMark.m_pChunk = m_pCur;
+	cMark.m_nUsed = m_nUsed;
+	cMark.m_nUsedBefore = m_nUsedBefore;
+	return cMark;
+}
+
+void CFrameArena::FreeToMark(const SMark &cMark)
+{
+	m_pCur = cMark.m_pChunk;
+	m_nUsed = cMark.m_nUsed;
+	m_nUsedBefore = cMark.m_nUsedBefore;
+}
+
+void CFrameArena::BeginFrame()
+{
+	++m_Stats.m_nFrames;
+
+	m_Stats.m_nLastAllocs = m_Stats.m_nAllocs;
+	m_Stats.m_nLastBytes = m_Stats.m_nBytes;
+	m_Stats.m_nLastHighWater = m_Stats.m_nHighWater;
+
+	m_Stats.m_nMaxAllocs = LTMAX(m_Stats.m_nMaxAllocs, m_Stats.m_nAllocs);
+	m_Stats.m_nMaxBytes = LTMAX(m_Stats.m_nMaxBytes, m_Stats.m_nBytes);
+	m_Stats.m_nMaxHighWater = LTMAX(m_Stats.m_nMaxHighWater, m_Stats.m_nHighWater);
+	m_Stats.m_nTotalAllocs += m_Stats.m_nAllocs;
+	m_Stats.m_nTotalBytes += m_Stats.m_nBytes;
+
+	m_Stats.m_nAllocs = 0;
+	m_Stats.m_nBytes = 0;
+
+	// Somebody up the stack is still using it
+	if (m_nOpenMarks)
+	{
+		m_Stats.m_nHighWater = m_nUsedBefore + m_nUsed;
+		return;
+	}
+
+	m_pCur = LTNULL;
+	m_nUsed = 0;
+	m_nUsedBefore = 0;
+	m_Stats.m_nHighWater = 0;
+}
+
+void CFrameArena::ClearStats()
+{
+	memset(&m_Stats, 0, sizeof(m_Stats));
+	m_nAllocs.store(0, std::memory_order_relaxed);
+	m_nBytes.store(0, std::memory_order_relaxed);
+}
+
+
+//------------------------------------------------------------------
+// Per-thread arenas
+//------------------------------------------------------------------
+
+CFrameArena &FrameArena_Get()
+{
+	static thread_local CFrameArena s_Arena;
+	return s_Arena;
+}
+
+// FrameArena [reset]
+void FrameArenaConsole(int argc, char *argv[])
+{
+	CFrameArena &cArena = FrameArena_Get();
+
+	std::lock_guard<std::mutex> cLock(CFrameArena::GetArenaListMutex());
+
+	// The other threads' frame stats are theirs to clear, so just start their totals over
+	if (argc >= 1 && stricmp(argv[0], "reset") == 0)
+	{
+		cArena.ClearStats();
+		for (CFrameArena *pCurArena = CFrameArena::s_pArenaList; pCurArena; pCurArena = pCurArena->m_pNextArena)
+		{
+			pCurArena->m_nAllocs.store(0, std::memory_order_relaxed);
+			pCurArena->m_nBytes.store(0, std::memory_order_relaxed);
+		}
+		dsi_ConsolePrint("FrameArena stats reset");
+		return;
+	}
+
+	const CFrameArena::SStats &cStats = cArena.GetStats();
+	float fFrames = (float)LTMAX(cStats.m_nFrames, (uint32)1);
+
+	dsi_ConsolePrint("FrameArena: %u frames on this thread, %u bytes reserved in %u chunk allocations",
+		cStats.m_nFrames, cArena.GetReserved(), cStats.m_nChunkAllocs);
+	dsi_ConsolePrint("%-10s %12s %12s %10s", "Arena use", "Allocs", "Bytes", "Peak");
+	dsi_ConsolePrint("%-10s %12u %12u %10u", "Last", cStats.m_nLastAllocs, cStats.m_nLastBytes, cStats.m_nLastHighWater);
+	dsi_ConsolePrint("%-10s %12.1f %12.1f %10s", "Average",
+		(float)cStats.m_nTotalAllocs / fFrames, (float)cStats.m_nTotalBytes / fFrames, "");
+	dsi_ConsolePrint("%-10s %12u %12u %10u", "Max", cStats.m_nMaxAllocs, cStats.m_nMaxBytes, cStats.m_nMaxHighWater);
+
+	// Everybody, including the worker threads, per frame of this thread
+	uint32 nNumArenas = 0;
+	uint32 nReserved = 0;
+	uint64 nAllocs = 0;
+	uint64 nBytes = 0;
+	for (CFrameArena *pCurArena = CFrameArena::s_pArenaList; pCurArena; pCurArena = pCurArena->m_pNextArena)
+	{
+		++nNumArenas;
+		nReserved += pCurArena->GetReserved();
+		nAllocs += pCurArena->GetNumAllocs();
+		nBytes += pCurArena->GetNumBytes();
+	}
+	dsi_ConsolePrint("All %u threads: %.1f arena allocs, %.1f arena bytes per frame, %u bytes reserved",
+		nNumArenas, (float)nAllocs / fFrames, (float)nBytes / fFrames, nReserved);
+}
@@ -0,0 +1,208 @@
+// Per-frame linear allocator for transient data.
+//
+// Each thread has its own CFrameArena (FrameArena_Get()).  Allocating from it is
+// a pointer bump into a chunk that's kept from frame to frame, so temporaries
+// that used to go through the heap (or live in static containers) cost nothing
+// to get rid of.  Nothing is ever freed on its own; scopes release what they
+// used with a CFrameArenaMark, and FrameArena_BeginFrame() throws out the rest.
+//
+// The server calls FrameArena_BeginFrame() at the top of CServerMgr::Update and
+// the client at the top of CClientMgr::Update.  When a local server runs inside
+// the client update, the arena is only emptied if no marks are open, so anything
+// the client has marked stays put.  Memory that isn't under a mark lives until
+// the next frame begins on that thread, so don't hold on to it across an update.
+//
+// The counters are how much the arena gets used, not what it saved the heap.  Most
+// of what moved onto it was in static containers, fixed arrays or alloca before,
+// which didn't go to the heap once they'd grown.  The heap allocations it still
+// makes are the chunk allocations.  "FrameArena" on the console prints them for
+// the calling thread, along with the totals for every thread's arena.
+
+#ifndef __FRAMEARENA_H__
+#define __FRAMEARENA_H__
+
+#include <stddef.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+class CFrameArena
+{
+public:
+	enum { k_nChunkSize = 64 * 1024, k_nDefaultAlign = 16 };
+
+	struct SChunk;
+
+	// Where the top of the arena is, for rolling back to
+	struct SMark
+	{
+		SChunk *m_pChunk;
+		uint32 m_nUsed;
+		uint32 m_nUsedBefore;
+	};
+
+	struct SStats
+	{
+		uint32 m_nFrames;
+
+		// The frame in progress
+		uint32 m_nAllocs;
+		uint32 m_nBytes;
+		uint32 m_nHighWater;
+
+		// The last whole frame
+		uint32 m_nLastAllocs;
+		uint32 m_nLastBytes;
+		uint32 m_nLastHighWater;
+
+		// Worst frames and totals since the stats were cleared
+		uint32 m_nMaxAllocs;
+		uint32 m_nMaxBytes;
+		uint32 m_nMaxHighWater;
+		uint64 m_nTotalAllocs;
+		uint64 m_nTotalBytes;
+
+		// How many times it went to the heap for more chunks
+		uint32 m_nChunkAllocs;
+	};
+
+	CFrameArena();
+	~CFrameArena();
+
+	// Get nSize bytes aligned to nAlign (a power of 2).  Never fails; runs
+	// out of memory the same way new does.
+	void	*Alloc(uint32 nSize, uint32 nAlign = k_nDefaultAlign);
+
+	template <class T>
+	T		*AllocArray(uint32 nCount) { return (T*)Alloc(nCount * sizeof(T), (uint32)LTMAX(sizeof(void*), alignof(T))); }
+
+	SMark	GetMark() const;
+	void	FreeToMark(const SMark &cMark);
+
+	// Roll the stats over to a new frame, and empty the arena if nobody's
+	// holding a mark
+	void	BeginFrame();
+
+	// Number of CFrameArenaMark's currently open
+	uint32	GetNumOpenMarks() const { return m_nOpenMarks; }
+
+	const SStats &GetStats() const { return m_Stats; }
+	void	ClearStats();
+
+	// Chunk memory held by the arena
+	uint32	GetReserved() const { return m_nReserved.load(std::memory_order_relaxed); }
+
+	// Allocations since the stats were cleared.  Unlike the frame stats, these are
+	// kept for threads that never begin a frame (like the task pool's workers), and
+	// can be read from any thread.
+	uint64	GetNumAllocs() const { return m_nAllocs.load(std::memory_order_relaxed); }
+	uint64	GetNumBytes() const { return m_nBytes.load(std::memory_order_relaxed); }
+
+	// Let go of all the chunks (only when nothing is using them)
+	void	Term();
+
+private:
+	friend class CFrameArenaMark;
+
+	SChunk	*NextChunk(uint32 nMinSize);
+
+	SChunk	*m_pFirst;
+	SChunk	*m_pCur;
+	uint32	m_nUsed;
+	// Bytes used in the chunks before m_pCur
+	uint32	m_nUsedBefore;
+	uint32	m_nOpenMarks;
+
+	SStats	m_Stats;
+
+	// Only ever changed by the owning thread, except for being cleared
+	std::atomic<uint32>	m_nReserved;
+	std::atomic<uint64>	m_nAllocs;
+	std::atomic<uint64>	m_nBytes;
+
+	// Every thread's arena is on a list for the console
+	CFrameArena	*m_pPrevArena;
+	CFrameArena	*m_pNextArena;
+	static CFrameArena	*s_pArenaList;
+	static std::mutex	&GetArenaListMutex();
+
+	friend void FrameArenaConsole(int argc, char *argv[]);
+};
+
+// The calling thread's arena
+CFrameArena &FrameArena_Get();
+
+// Start a new frame on the calling thread's arena
+inline void FrameArena_BeginFrame() { FrameArena_Get().BeginFrame(); }
+
+// Frees everything allocated from an arena in its scope
+class CFrameArenaMark
+{
+public:
+	CFrameArenaMark(CFrameArena &cArena = FrameArena_Get()) :
+		m_Arena(cArena),
+		m_Mark(cArena.GetMark())
+	{
+		++m_Arena.m_nOpenMarks;
+	}
+	~CFrameArenaMark()
+	{
+		m_Arena.FreeToMark(m_Mark);
+		--m_Arena.m_nOpenMarks;
+	}
+
+	CFrameArena &GetArena() const { return m_Arena; }
+
+private:
+	CFrameArenaMark(const CFrameArenaMark&);
+	CFrameArenaMark &operator=(const CFrameArenaMark&);
+
+	CFrameArena &m_Arena;
+	CFrameArena::SMark m_Mark;
+};
+
+// STL allocator on the calling thread's arena.  deallocate doesn't give anything
+// back (the mark does), so these are for containers that live inside a mark.
+template <class T>
+class CFrameArenaAllocator
+{
+public:
+	typedef T value_type;
+
+	CFrameArenaAllocator() : m_pArena(&FrameArena_Get()) {}
+	explicit CFrameArenaAllocator(CFrameArena &cArena) : m_pArena(&cArena) {}
+	template <class U>
+	CFrameArenaAllocator(const CFrameArenaAllocator<U> &cOther) : m_pArena(cOther.GetArena()) {}
+
+	T *allocate(size_t nCount)
+	{
+		return m_pArena->AllocArray<T>((uint32)nCount);
+	}
+	void deallocate(T *, size_t)
+	{
+	}
+
+	CFrameArena *GetArena() const { return m_pArena; }
+
+	template <class U>
+	bool operator==(const CFrameArenaAllocator<U> &cOther) const { return m_pArena == cOther.GetArena(); }
+	template <class U>
+	bool operator!=(const CFrameArenaAllocator<U> &cOther) const { return m_pArena != cOther.GetArena(); }
+
+private:
+	CFrameArena *m_pArena;
+};
+
+// A vector that lives on the frame arena
+template <class T>
+class CFrameArenaVector : public std::vector<T, CFrameArenaAllocator<T> >
+{
+public:
+	CFrameArenaVector() {}
+	explicit CFrameArenaVector(CFrameArena &cArena) : std::vector<T, CFrameArenaAllocator<T> >(CFrameArenaAllocator<T>(cArena)) {}
+};
+
+// Console command: FrameArena [reset]
+void FrameArenaConsole(int argc, char *argv[]);
+
+#endif  // __FRAMEARENA_H__
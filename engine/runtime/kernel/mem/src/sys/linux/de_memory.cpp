@@ -19,6 +19,11 @@ public:
 static uint32 g_MemoryUsage;
 static uint32 g_nAllocations;
 
+// See dm_SetThreadExcluded.
+static thread_local bool g_bThreadExcluded = false;
+static uint32 g_ExcludedMemoryUsage;
+static uint32 g_nExcludedAllocations;
+
 uint32 g_nTotalAllocations, g_nTotalFrees;
 
 static int g_MemRefCount=0;
@@ -78,6 +83,8 @@ void dm_Init()
 
 		g_MemoryUsage = 0;
 		g_nAllocations = 0;
+		g_ExcludedMemoryUsage = 0;
+		g_nExcludedAllocations = 0;
 		g_nTotalAllocations = g_nTotalFrees = 0;
 	}
 
@@ -97,6 +104,8 @@ void dm_Term()
 
 		g_MemoryUsage = 0;
 		g_nAllocations = 0;
+		g_ExcludedMemoryUsage = 0;
+		g_nExcludedAllocations = 0;
 	}
 }
 
@@ -113,6 +122,24 @@ uint32 dm_GetNumAllocations()
 }
 
 
+void dm_SetThreadExcluded(bool bExcluded)
+{
+	g_bThreadExcluded = bExcluded;
+}
+
+
+uint32 dm_GetExcludedBytesAllocated()
+{
+	return g_ExcludedMemoryUsage;
+}
+
+
+uint32 dm_GetExcludedNumAllocations()
+{
+	return g_nExcludedAllocations;
+}
+
+
 
 void* dalloc(uint32 size)
 {
@@ -155,6 +182,14 @@ void* dalloc(uint32 size)
 	++g_nAllocations;
 	++g_nTotalAllocations;
 
+	if(g_bThreadExcluded)
+	{
+		#ifdef TRACK_MEMORY_USAGE
+			g_ExcludedMemoryUsage += size;
+		#endif
+		++g_nExcludedAllocations;
+	}
+
 	return ptr;
 	
 }
@@ -193,10 +228,15 @@ void dfree(void *ptr)
 		}
 
 		g_MemoryUsage -= pMemTrack->m_AllocSize;
+		if(g_bThreadExcluded)
+			g_ExcludedMemoryUsage -= pMemTrack->m_AllocSize;
 	#endif
 
 	--g_nAllocations;
 	++g_nTotalFrees;
+
+	if(g_bThreadExcluded)
+		--g_nExcludedAllocations;
 	
 	{
 		CountAdder cntAdd(&g_PD_Free);
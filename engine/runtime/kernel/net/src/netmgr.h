@@ -92,6 +92,15 @@ class CBaseConn
 
 		// Returns the average packet loss for this connection
 		virtual float		GetPacketLoss() const { return 0.0f; }
+
+		// Guaranteed packets queued or waiting to be acknowledged
+		virtual uint32		GetGuaranteedQueueDepth() const { return 0; }
+		// How many times guaranteed sending has been paused because the queue backed up
+		virtual uint32		GetNumGuaranteedPauses() const { return 0; }
+		// Guaranteed frames which had to be re-sent, and how long (in ms) they took to get through
+		virtual uint32		GetNumRecoveredFrames() const { return 0; }
+		virtual uint32		GetTotalRecoveryTime() const { return 0; }
+		virtual uint32		GetMaxRecoveryTime() const { return 0; }
 		
 		// BPS=bytes per second, PPS=packets per second
 		RateTracker		m_SendBPS;	
@@ -132,6 +141,24 @@ enum EDisconnectReason { DISCONNECTREASON_VOLUNTARY_CLIENTSIDE =0,
 class BaseService;
 class CNetMgr;
 
+// Socket-level I/O counters reported by a driver.
+struct NetDriverIOStats
+{
+	NetDriverIOStats() { Clear(); }
+	void Clear()
+	{
+		m_nRecvCalls = 0;
+		m_nRecvDatagrams = 0;
+		m_nSendCalls = 0;
+		m_nSendDatagrams = 0;
+	}
+
+	uint32	m_nRecvCalls;		// Receive syscalls which returned data
+	uint32	m_nRecvDatagrams;	// Datagrams returned by those calls
+	uint32	m_nSendCalls;		// Send syscalls
+	uint32	m_nSendDatagrams;	// Datagrams handed to those calls
+};
+
 // Base class for a network driver (such as DirectPlay).
 class CBaseDriver
 {
@@ -211,6 +238,15 @@ class CBaseDriver
 		// Update the GUID
 		virtual void		UpdateGUID(LTGUID &cGUID) { }
 
+		// Let the system pick the port when a socket is opened to connect, instead of
+		// going through the IPClientPort range.  IPClientPortMRU is left alone too, since
+		// saving it sets a console variable.
+		virtual void		SetAnyClientPort(bool bAnyClientPort) { }
+
+		// Socket I/O statistics.  Returns false if the driver doesn't track them.
+		virtual bool		GetIOStats(NetDriverIOStats *pStats) { return false; }
+		virtual void		ResetIOStats() { }
+
 	public:
 
 		char				m_Name[64];
@@ -3,32 +3,7 @@
 #include "packet.h"
 #include "syslthread.h"
 
-
-// special interlock for LINUX
-#ifdef __LINUX
-
-#include <pthread.h>
-
-static pthread_mutex_t g_hInterlockedMutex = PTHREAD_MUTEX_INITIALIZER;
-
-void InterlockedIncrement(long* pAddend)
-{
-	::pthread_mutex_lock(&g_hInterlockedMutex);
-	++(*pAddend);
-	::pthread_mutex_unlock(&g_hInterlockedMutex);
-}
-
-long InterlockedDecrement(long * pAddend)
-{
-	::pthread_mutex_lock(&g_hInterlockedMutex);
-	long nRV = --(*pAddend);
-	::pthread_mutex_unlock(&g_hInterlockedMutex);
-
-	return nRV;
-}
-
-#endif
-
+#include <new>
 
 
 //////////////////////////////////////////////////////////////////////////////
@@ -60,110 +35,210 @@ uint32 CountSetBits(uint32 nValue)
 
 //////////////////////////////////////////////////////////////////////////////
 // Packet data allocation handling
+//
+// Packet data and chunks are carved out of cache line aligned slabs which are
+// never given back to the heap.  Each thread keeps a small cache of free entries,
+// and only takes the shared lock to move a batch between its cache and the
+// shared free list, so a running server stops allocating once its working set
+// of packets has been reached.  Chunks are a multiple of the cache line size, so
+// each one starts on a line.  The packet data headers are small and packed.
+
+enum {
+	k_nPacketCacheLineSize = 64,
+	k_nPacketSlabSize = 64 * 1024, // Bytes per slab
+	k_nPacketCacheBatch = 32, // Entries moved between a thread cache and the shared list at a time
+	k_nPacketCacheMax = k_nPacketCacheBatch * 4, // Most entries a thread will cache before giving some back
+};
 
-CSysSerialVar g_cPacket_CS_Trash;
-CPacket_Data *CPacket_Data::s_pTrash_Data = 0;
+// A singly-linked list of free entries, linked through the entries themselves
+class CPacket_FreeList
+{
+public:
+	CPacket_FreeList() : m_pHead(0), m_nCount(0) {}
 
-CPacket_Data CPacket_Data::s_cTrash_Chunk;
+	bool Empty() const { return m_pHead == 0; }
+	uint32 Count() const { return m_nCount; }
 
-CSysSerialVar g_cPacket_CS_Tracking;
+	void Push(void *pEntry) {
+		SNode *pNode = reinterpret_cast<SNode*>(pEntry);
+		pNode->m_pNext = m_pHead;
+		m_pHead = pNode;
+		++m_nCount;
+	}
+	void *Pop() {
+		SNode *pResult = m_pHead;
+		if (pResult)
+		{
+			m_pHead = pResult->m_pNext;
+			--m_nCount;
+		}
+		return pResult;
+	}
+	// Move up to nCount entries from cOther into this list
+	void Take(CPacket_FreeList &cOther, uint32 nCount) {
+		while (nCount-- && !cOther.Empty())
+			Push(cOther.Pop());
+	}
 
-uint32 s_nAllocatedChunks = 0;
-uint32 s_nActiveChunks = 0;
-uint32 s_nAllocatedPackets = 0;
-uint32 s_nActivePackets = 0;
+private:
+	struct SNode
+	{
+		SNode *m_pNext;
+	};
+	SNode *m_pHead;
+	uint32 m_nCount;
+};
 
-// Gimmie some chunk, baby...
-CPacket_Data::SChunk *CPacket_Data::Allocate_Chunk(uint32 nOffset)
+// Shared slab storage for one size of entry
+class CPacket_SlabPool
 {
-	g_cPacket_CS_Trash.Lock();
-	
-	g_cPacket_CS_Tracking.Lock();
-	++s_nActiveChunks;
-	g_cPacket_CS_Tracking.Unlock();
-
-	if (s_cTrash_Chunk.m_pFirstChunk)
+public:
+	CPacket_SlabPool(uint32 nEntrySize) :
+		m_nEntrySize(nEntrySize)
 	{
-		SChunk *pResult = s_cTrash_Chunk.m_pFirstChunk;
-		s_cTrash_Chunk.m_pFirstChunk = s_cTrash_Chunk.m_pFirstChunk->m_pNext;
-		
-		g_cPacket_CS_Trash.Unlock();
+		ASSERT(m_nEntrySize >= sizeof(void*));
+	}
 
-		pResult->Init(nOffset);
-	
-		return pResult;
+	// Give cList a batch of free entries
+	void Refill(CPacket_FreeList &cList);
+	// Take nCount entries back from cList
+	void Drain(CPacket_FreeList &cList, uint32 nCount);
+
+private:
+	// Add a new slab to the free list.  Must be called with m_cCS locked.
+	void AllocSlab();
+
+	CSysSerialVar m_cCS;
+	CPacket_FreeList m_cFree;
+	uint32 m_nEntrySize;
+};
+
+// A thread's cache of free entries
+struct SPacket_ThreadCache
+{
+	~SPacket_ThreadCache();
+
+	CPacket_FreeList m_cData;
+	CPacket_FreeList m_cChunks;
+};
+
+class CPacket_Allocator
+{
+public:
+	static void *Allocate(CPacket_SlabPool &cPool, CPacket_FreeList &cCache)
+	{
+		if (cCache.Empty())
+			cPool.Refill(cCache);
+		return cCache.Pop();
 	}
-	else
+	static void Free(CPacket_SlabPool &cPool, CPacket_FreeList &cCache, void *pEntry)
 	{
-		g_cPacket_CS_Tracking.Lock();
-		++s_nAllocatedChunks;
-		g_cPacket_CS_Tracking.Unlock();
-		
-		g_cPacket_CS_Trash.Unlock();
-
-		SChunk* pNewChunk;
-		LT_MEM_TRACK_ALLOC(pNewChunk = new SChunk(nOffset), LT_MEM_TYPE_NETWORKING);
-		return pNewChunk;
+		cCache.Push(pEntry);
+		if (cCache.Count() > k_nPacketCacheMax)
+			cPool.Drain(cCache, k_nPacketCacheBatch);
 	}
+
+	static CPacket_SlabPool s_cDataPool;
+	static CPacket_SlabPool s_cChunkPool;
+
+	static std::atomic<uint32> s_nActivePackets;
+	static std::atomic<uint32> s_nActiveChunks;
+	static std::atomic<uint32> s_nAllocCalls;
+	static std::atomic<uint32> s_nHeapAllocs;
+	static std::atomic<uint32> s_nReservedBytes;
+};
+
+CPacket_SlabPool CPacket_Allocator::s_cDataPool(sizeof(CPacket_Data));
+CPacket_SlabPool CPacket_Allocator::s_cChunkPool(sizeof(CPacket_Data::SChunk));
+
+std::atomic<uint32> CPacket_Allocator::s_nActivePackets(0);
+std::atomic<uint32> CPacket_Allocator::s_nActiveChunks(0);
+std::atomic<uint32> CPacket_Allocator::s_nAllocCalls(0);
+std::atomic<uint32> CPacket_Allocator::s_nHeapAllocs(0);
+std::atomic<uint32> CPacket_Allocator::s_nReservedBytes(0);
+
+static thread_local SPacket_ThreadCache t_cPacketCache;
+
+SPacket_ThreadCache::~SPacket_ThreadCache()
+{
+	// Hand everything back for the other threads
+	CPacket_Allocator::s_cDataPool.Drain(m_cData, m_cData.Count());
+	CPacket_Allocator::s_cChunkPool.Drain(m_cChunks, m_cChunks.Count());
 }
 
-// Dump the chunk onto the free chunk list
-void CPacket_Data::Free_Chunk(SChunk *pChunk)
+void CPacket_SlabPool::Refill(CPacket_FreeList &cList)
 {
-	g_cPacket_CS_Trash.Lock();
+	m_cCS.Lock();
 
-	g_cPacket_CS_Tracking.Lock();
-	ASSERT(s_nActiveChunks);
-	--s_nActiveChunks;
-	g_cPacket_CS_Tracking.Unlock();
+	if (m_cFree.Count() < k_nPacketCacheBatch)
+		AllocSlab();
+	cList.Take(m_cFree, k_nPacketCacheBatch);
 
-	pChunk->m_pNext = s_cTrash_Chunk.m_pFirstChunk;
-	s_cTrash_Chunk.m_pFirstChunk = pChunk;
+	m_cCS.Unlock();
+}
 
-	g_cPacket_CS_Trash.Unlock();
+void CPacket_SlabPool::Drain(CPacket_FreeList &cList, uint32 nCount)
+{
+	m_cCS.Lock();
+	m_cFree.Take(cList, nCount);
+	m_cCS.Unlock();
 }
 
-CPacket_Data* CPacket_Data::Allocate()
+void CPacket_SlabPool::AllocSlab()
 {
-	// Insert packet tracking here
-	// NYI
-	g_cPacket_CS_Tracking.Lock();
-	++s_nActivePackets;
-	g_cPacket_CS_Tracking.Unlock();
+	uint8 *pSlab;
+	LT_MEM_TRACK_ALLOC(pSlab = new uint8[k_nPacketSlabSize + k_nPacketCacheLineSize], LT_MEM_TYPE_NETWORKING);
+
+	++CPacket_Allocator::s_nHeapAllocs;
+	CPacket_Allocator::s_nReservedBytes += k_nPacketSlabSize + k_nPacketCacheLineSize;
 
-	g_cPacket_CS_Trash.Lock();
+	// Start on a cache line.  Slabs are never freed, so there's no need to remember the original pointer.
+	uint8 *pCurEntry = reinterpret_cast<uint8*>((reinterpret_cast<uintptr_t>(pSlab) + (k_nPacketCacheLineSize - 1)) & ~(uintptr_t)(k_nPacketCacheLineSize - 1));
+	uint32 nNumEntries = k_nPacketSlabSize / m_nEntrySize;
+	ASSERT((reinterpret_cast<uintptr_t>(pCurEntry) & (k_nPacketCacheLineSize - 1)) == 0);
 
-	CPacket_Data *pResult;
-	if (s_pTrash_Data)
+	// Push them in reverse so they come back out in address order
+	pCurEntry += (nNumEntries - 1) * m_nEntrySize;
+	for (uint32 nCurEntry = 0; nCurEntry < nNumEntries; ++nCurEntry, pCurEntry -= m_nEntrySize)
 	{
-		pResult = s_pTrash_Data;
-		s_pTrash_Data = (CPacket_Data*)s_pTrash_Data->m_pFirstChunk;
-	    pResult->Init();
+		m_cFree.Push(pCurEntry);
 	}
-	else
-	{
-		g_cPacket_CS_Tracking.Lock();
-		++s_nAllocatedPackets;
-		g_cPacket_CS_Tracking.Unlock();
+}
 
-		LT_MEM_TRACK_ALLOC(pResult = new CPacket_Data, LT_MEM_TYPE_NETWORKING);
-	}
+// Gimmie some chunk, baby...
+CPacket_Data::SChunk *CPacket_Data::Allocate_Chunk(uint32 nOffset)
+{
+	static_assert(sizeof(SChunk) == SChunk::k_nSize, "Packet chunks need to fill their cache lines exactly");
 
-	g_cPacket_CS_Trash.Unlock();
+	++CPacket_Allocator::s_nActiveChunks;
+	++CPacket_Allocator::s_nAllocCalls;
 
-	return pResult;
+	void *pMem = CPacket_Allocator::Allocate(CPacket_Allocator::s_cChunkPool, t_cPacketCache.m_cChunks);
+	return new(pMem) SChunk(nOffset);
 }
 
-void CPacket_Data::Free()
+// Dump the chunk onto the free chunk list
+void CPacket_Data::Free_Chunk(SChunk *pChunk)
 {
-	g_cPacket_CS_Tracking.Lock();
+	ASSERT(CPacket_Allocator::s_nActiveChunks);
+	--CPacket_Allocator::s_nActiveChunks;
 
-	// Insert packet tracking here
-	// NYI
-	ASSERT(s_nActivePackets);
-	--s_nActivePackets;
+	CPacket_Allocator::Free(CPacket_Allocator::s_cChunkPool, t_cPacketCache.m_cChunks, pChunk);
+}
 
-	g_cPacket_CS_Tracking.Unlock();
+CPacket_Data* CPacket_Data::Allocate()
+{
+	++CPacket_Allocator::s_nActivePackets;
+	++CPacket_Allocator::s_nAllocCalls;
+
+	void *pMem = CPacket_Allocator::Allocate(CPacket_Allocator::s_cDataPool, t_cPacketCache.m_cData);
+	return new(pMem) CPacket_Data;
+}
+
+void CPacket_Data::Free()
+{
+	ASSERT(CPacket_Allocator::s_nActivePackets);
+	--CPacket_Allocator::s_nActivePackets;
 
 	// Dump our chunks
 	while (m_pFirstChunk)
@@ -173,13 +248,17 @@ void CPacket_Data::Free()
 		Free_Chunk(pTemp);
 	}
 
-	g_cPacket_CS_Trash.Lock();
-
 	// Put ourselves in the trash list
-	m_pFirstChunk = (SChunk*)s_pTrash_Data;
-	s_pTrash_Data = this;
+	CPacket_Allocator::Free(CPacket_Allocator::s_cDataPool, t_cPacketCache.m_cData, this);
+}
 
-	g_cPacket_CS_Trash.Unlock();
+void CPacket_Data::GetAllocStats(SPacketAllocStats *pStats)
+{
+	pStats->m_nActivePackets = CPacket_Allocator::s_nActivePackets;
+	pStats->m_nActiveChunks = CPacket_Allocator::s_nActiveChunks;
+	pStats->m_nAllocCalls = CPacket_Allocator::s_nAllocCalls;
+	pStats->m_nHeapAllocs = CPacket_Allocator::s_nHeapAllocs;
+	pStats->m_nReservedBytes = CPacket_Allocator::s_nReservedBytes;
 }
 
 //////////////////////////////////////////////////////////////////////////////
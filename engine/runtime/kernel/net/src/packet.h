@@ -3,17 +3,23 @@
 #define __NEWPACKET_H__
 
 #include "ltbasetypes.h"
+#include <atomic>
 
 // forward declarations
 class CPacket_Read;
 class CPacket_Write;
 class CPacket_Data;
+class CPacket_Allocator;
 
-
-#ifdef __LINUX
-void InterlockedIncrement(long* pAddend);
-long InterlockedDecrement(long * pAddend);
-#endif
+// Packet data allocation statistics
+struct SPacketAllocStats
+{
+	uint32 m_nActivePackets;	// Packet data currently in use
+	uint32 m_nActiveChunks;		// Chunks currently in use
+	uint32 m_nAllocCalls;		// Packet data + chunk allocations since startup
+	uint32 m_nHeapAllocs;		// Slabs allocated from the heap since startup
+	uint32 m_nReservedBytes;	// Bytes held in slabs
+};
 
 //////////////////////////////////////////////////////////////////////////////
 // Packet data class.  Please ignore this class.  It has to be visible in order
@@ -27,6 +33,7 @@ public:
 	friend struct SIterator;
 	struct SIterator_Const;
 	friend struct SIterator_Const;
+	friend class CPacket_Allocator;
 private:
 	struct SChunk;
 	friend struct SChunk;
@@ -44,17 +51,20 @@ public:
 	{
 		m_pFirstChunk = 0;
 		m_pLastChunk = 0;
-		m_nRefCount = 0;
+		m_nRefCount.store(0, std::memory_order_relaxed);
 		m_nSize = 0;
 	}
 	
 	// Allocate a new CPacket_Data
 	static CPacket_Data *Allocate();
 
+	// Get the allocation statistics
+	static void GetAllocStats(SPacketAllocStats *pStats);
+
 	// Reference counting...
-	void IncRef() const { InterlockedIncrement(( long* )&m_nRefCount ); }
-	void DecRef() const { if (!InterlockedDecrement(( long* )&m_nRefCount )) const_cast<CPacket_Data*>(this)->Free(); }
-	uint32 GetRefCount() const { return m_nRefCount; }
+	void IncRef() const { m_nRefCount.fetch_add(1, std::memory_order_relaxed); }
+	void DecRef() const { if (m_nRefCount.fetch_sub(1, std::memory_order_acq_rel) == 1) const_cast<CPacket_Data*>(this)->Free(); }
+	uint32 GetRefCount() const { return m_nRefCount.load(std::memory_order_relaxed); }
 
 	bool Append(uint32 nData, uint32 nBits) {
 		// We're never supposed to append after an unaligned append
@@ -276,8 +286,9 @@ private:
 
 		}
 
+		// Chunks are exactly k_nSize bytes, and are allocated on cache line boundaries
 		enum {
-			k_nOverhead = sizeof(uint32) + sizeof(SChunk*),
+			k_nOverhead = sizeof(uint32) * 2 + sizeof(SChunk*),
 			k_nSize = 256,
 			k_nCapacity = (k_nSize - k_nOverhead) / sizeof(uint32),
 			k_nBitCapacity = k_nCapacity * 32,
@@ -296,7 +307,7 @@ private:
 	SChunk *m_pFirstChunk, *m_pLastChunk;
 
 	// How many people know about me?
-	mutable uint32 m_nRefCount;
+	mutable std::atomic<uint32> m_nRefCount;
 	// Size of the data
 	uint32 m_nSize;
 
@@ -304,10 +315,6 @@ private:
 	static SChunk *Allocate_Chunk(uint32 nOffset = 0);
 	// Free a chunk
 	static void Free_Chunk(SChunk *pChunk);
-	// Static storage for dead chunks
-	static CPacket_Data s_cTrash_Chunk;
-	// Static storage for dead data
-	static CPacket_Data *s_pTrash_Data;
 };
 
 
@@ -336,7 +343,7 @@ public:
 	}
 
 	// Forget everything that's been written
-	void Reset() { if (m_pData) m_pData->DecRef(); m_pData = 0; }
+	void Reset() { if (m_pData) m_pData->DecRef(); m_pData = 0; m_nBitAccumulator = 0; m_nBitsAccumulated = 0; }
 
 	// How much data have we written?
 	uint32 Size() const { return ((m_pData) ? (m_pData->Size()) : 0) + m_nBitsAccumulated; }
@@ -12,6 +12,7 @@
 #ifdef __LINUX
 #include <fcntl.h>
 #include <errno.h>
+#include <sys/socket.h>
 #endif
 
 #ifndef DE_SERVER_COMPILE
@@ -43,8 +44,13 @@ extern float g_CV_IPQueryTimeout;
 
 // Packet loss simulation
 extern int32 g_CV_UDPSimulatePacketLoss;
+extern float g_CV_UDPSimulateLossBurst;
 // Packet corruption simulation
 extern int32 g_CV_UDPSimulateCorruption;
+// Batched socket I/O
+extern int32 g_CV_UDPBatchIO;
+// Connection updates on the listen thread
+extern int32 g_CV_UDPThreadedIO;
 
 // Need to know what the bandwidth target for clients is so we can tell the server
 // during the connection handshake.
@@ -60,6 +66,11 @@ CUDPConn::CFrameQueue CUDPConn::s_cFrameTrash;
 CUDPConn::CUDPConn() :
 	m_Socket(INVALID_SOCKET),
 	m_bPauseGuaranteed(false),
+	m_nGuaranteedWaiting(0),
+	m_nGuaranteedPauses(0),
+	m_nRecoveredFrames(0),
+	m_nTotalRecoveryTime(0),
+	m_nMaxRecoveryTime(0),
 	m_nOutgoingGCount(0),
 	m_nOutgoingGSize(0),
 	m_nOutgoingUCount(0),
@@ -72,14 +83,18 @@ CUDPConn::CUDPConn() :
 	m_fCurPing((float)k_nStartPing),
 	m_fReportedPing(0.0f),
 	m_bWaitingForPingResponse(false),
-	m_bFlushingNAKs(false),
+	m_fSmoothedRTT((float)k_nStartPing),
+	m_fRTTVariance((float)k_nStartPing / 2.0f),
+	m_bHaveRTTSample(false),
+	m_bSimulatedLossBurst(false),
 	m_nBandwidth(0x7FFFFFFF),
 	m_nReportedBandwidth(0x7FFFFFFF),
 	m_nMaxBandwidth(0x7FFFFFFF),
 	m_nNumOutOfOrderPackets(0),
 	m_bFlowControlInitialized(false),
-	m_nFlowControlCurPeriodSent(0),
-	m_nFlowControlLastPeriodSent(0)
+	m_nFlowControlTokens(0),
+	m_nFlowControlBucketSize(0),
+	m_nFlowControlFillTime(0)
 {
 	uint32 nCurTime = timeGetTime();
 	m_nLastHeartbeatTime = nCurTime;
@@ -196,7 +211,19 @@ CUDPConn::EIncomingPacketResult CUDPConn::HandleIncomingPacket(const CPacket_Rea
 	// Simulate packet loss....
 	if (g_CV_UDPSimulatePacketLoss)
 	{
-		if ((rand() % 100) < g_CV_UDPSimulatePacketLoss)
+		if (g_CV_UDPSimulateLossBurst > 1.0f)
+		{
+			// Losses come in bursts averaging UDPSimulateLossBurst packets long, and
+			// UDPSimulatePacketLoss percent of the packets are lost overall
+			float fLoss = (float)LTMIN(g_CV_UDPSimulatePacketLoss, 99) / 100.0f;
+			float fEndBurst = 1.0f / g_CV_UDPSimulateLossBurst;
+			float fStartBurst = fLoss * fEndBurst / (1.0f - fLoss);
+			float fRand = (float)rand() / (float)RAND_MAX;
+			m_bSimulatedLossBurst = m_bSimulatedLossBurst ? (fRand >= fEndBurst) : (fRand < fStartBurst);
+			if (m_bSimulatedLossBurst)
+				return eIPR_OK;
+		}
+		else if ((rand() % 100) < g_CV_UDPSimulatePacketLoss)
 			return eIPR_OK;
 	}
 
@@ -238,22 +265,21 @@ CUDPConn::EIncomingPacketResult CUDPConn::HandleIncomingPacket(const CPacket_Rea
 
 void CUDPConn::ClearFrameHistory(uint32 nFrameCode)
 {
+	uint32 nCurTime = timeGetTime();
+
 	// m_cFrameHistory MUST contain nFrameCode before this function is called..
 	while (m_cFrameHistory.front().m_nFrameCode != nFrameCode)
 	{
 		m_aPacketLossHistory.push(true);
+		if (!m_cFrameHistory.front().m_bReceivedOO)
+			OnFrameACKed(m_cFrameHistory.front(), nCurTime);
 		m_cFrameHistory.pop_front(s_cFrameTrash, s_cPacketTrash);
 	}
 	ASSERT(!m_cFrameHistory.empty()); // This means the frame code was not in the history
 	m_aPacketLossHistory.push(true);
+	if (!m_cFrameHistory.front().m_bReceivedOO)
+		OnFrameACKed(m_cFrameHistory.front(), nCurTime);
 	m_cFrameHistory.pop_front(s_cFrameTrash, s_cPacketTrash);
-
-	// Reset the resend counts
-	CFrameQueue::iterator iCurFrame = m_cFrameHistory.begin();
-	for (; iCurFrame != m_cFrameHistory.end(); ++iCurFrame)
-	{
-		iCurFrame->m_nSendCount = LTMIN(iCurFrame->m_nSendCount, k_nGuaranteedBlockCount + 1);
-	}
 }
 
 bool CUDPConn::RemoveFrameHistory(uint32 nFrameCode, CPacketFrame **pFrame)
@@ -265,7 +291,10 @@ bool CUDPConn::RemoveFrameHistory(uint32 nFrameCode, CPacketFrame **pFrame)
 		{
 			bool bWasAlreadyReceived = iCurFrame->m_bReceivedOO;
 			if (!bWasAlreadyReceived)
+			{
 				m_aPacketLossHistory.push(true);
+				OnFrameACKed(*iCurFrame, timeGetTime());
+			}
 			iCurFrame->m_bReceivedOO = true;
 			*pFrame = &(*iCurFrame);
 			return !bWasAlreadyReceived;
@@ -292,6 +321,57 @@ void CUDPConn::AddPing(uint32 nTime)
 	}
 }
 
+void CUDPConn::AddRTTSample(uint32 nTime)
+{
+	float fSample = (float)nTime;
+	if (!m_bHaveRTTSample)
+	{
+		m_fSmoothedRTT = fSample;
+		m_fRTTVariance = fSample / 2.0f;
+		m_bHaveRTTSample = true;
+		return;
+	}
+
+	m_fRTTVariance = 0.75f * m_fRTTVariance + 0.25f * (float)fabs(m_fSmoothedRTT - fSample);
+	m_fSmoothedRTT = 0.875f * m_fSmoothedRTT + 0.125f * fSample;
+}
+
+uint32 CUDPConn::GetResendTime(uint32 nSendCount) const
+{
+	// Leave room for the heartbeat to wait for the next update on the other end
+	uint32 nResendTime = (uint32)(m_fSmoothedRTT + LTMAX(4.0f * m_fRTTVariance, (float)k_nHeartbeatDelay));
+	nResendTime = LTCLAMP(nResendTime, (uint32)k_nMinResendTime, (uint32)k_nMaxResendTime);
+	// Back off each time it's re-sent
+	nResendTime <<= LTMIN(nSendCount, (uint32)k_nMaxResendBackoff);
+	return LTMIN(nResendTime, (uint32)k_nMaxResendTime);
+}
+
+void CUDPConn::OnFrameACKed(const CPacketFrame &cFrame, uint32 nCurTime)
+{
+	// Only frames which were sent once tell us the round-trip time, since we don't
+	// know which send a re-sent one is being ACK'ed for
+	if (!cFrame.m_nSendCount)
+	{
+		AddRTTSample(nCurTime - cFrame.m_nFirstSent);
+		return;
+	}
+
+	uint32 nRecoveryTime = nCurTime - cFrame.m_nFirstSent;
+	++m_nRecoveredFrames;
+	m_nTotalRecoveryTime += nRecoveryTime;
+	m_nMaxRecoveryTime = LTMAX(m_nMaxRecoveryTime, nRecoveryTime);
+}
+
+bool CUDPConn::IsGuaranteedWindowFull() const
+{
+	if (m_cFrameHistory.empty())
+		return false;
+
+	// They only hold on to k_nMaxOutOfOrderPackets frames past the one they're waiting for
+	uint32 nNextFrame = (m_nOutgoingFrameCode + 1) & k_nFrameMask;
+	return ((nNextFrame - m_cFrameHistory.front().m_nFrameCode) & k_nFrameMask) > k_nMaxOutOfOrderPackets;
+}
+
 bool CUDPConn::ShouldSendHeartbeat()
 {
 	// If it won't go through, don't bother
@@ -323,10 +403,6 @@ bool CUDPConn::ShouldSendEmptyFrame()
 
 bool CUDPConn::ShouldSendPacket(bool bOnlyBandwidth)
 {
-	// If we're flushing NAKs, deal with it ASAP
-	if (bOnlyBandwidth && m_bFlushingNAKs)
-		return true;
-
 	if (ShouldSendHeartbeat())
 		return true;
 
@@ -399,12 +475,13 @@ CUDPConn::EIncomingPacketResult CUDPConn::HandleUDP(CPacket_Read &cPacket)
 				ClearFrameHistory(nSuccessfulFrame);
 			}
 
-			bool bOOACK = false;
 			// Clear any out of order packets they've already got
+			CPacketFrame *aNewOOACKs[k_nMaxOutOfOrderPackets];
+			uint32 nNumNewOOACKs = 0;
 			if (cPacket.Readbool())
 			{
 				uint32 nCurFrame = (nSuccessfulFrame + 2) & k_nFrameMask;
-				for (uint32 nOOACK = 0; nOOACK < k_nMaxOutOfOrderPackets; ++nOOACK, ++nCurFrame)
+				for (uint32 nOOACK = 0; nOOACK < k_nMaxOutOfOrderPackets; ++nOOACK, nCurFrame = (nCurFrame + 1) & k_nFrameMask)
 				{
 					if (!cPacket.Readbool())
 						continue;
@@ -414,22 +491,32 @@ CUDPConn::EIncomingPacketResult CUDPConn::HandleUDP(CPacket_Read &cPacket)
 						continue;
 					// Update the ping
 					AddPing(nCurTime - pFrame->m_nFirstSent);
-					bOOACK = true;
+					aNewOOACKs[nNumNewOOACKs++] = pFrame;
 				}
 			}
 
-			if (bOOACK)
+			// Count the frames sent after each missing frame which they've now got.  Once
+			// k_nFastResendACKs of them have arrived since it was last sent, it was lost, so
+			// re-send it now instead of waiting for its timer.  (Both lists are in frame order.)
+			uint32 nNextNewOOACK = 0;
+			CFrameQueue::iterator iCurFrame2 = m_cFrameHistory.begin();
+			for (; (iCurFrame2 != m_cFrameHistory.end()) && (nNextNewOOACK < nNumNewOOACKs); ++iCurFrame2)
 			{
-				CFrameQueue::iterator iCurFrame2 = m_cFrameHistory.begin();
-				for (; iCurFrame2 != m_cFrameHistory.end(); ++iCurFrame2)
+				if (&(*iCurFrame2) == aNewOOACKs[nNextNewOOACK])
+				{
+					++nNextNewOOACK;
+					continue;
+				}
+				if (iCurFrame2->m_bReceivedOO)
+					continue;
+				for (uint32 nCurOOACK = nNextNewOOACK; nCurOOACK < nNumNewOOACKs; ++nCurOOACK)
 				{
-					if (iCurFrame2->m_bReceivedOO)
+					if (iCurFrame2->m_nSendCount && ((int32)(iCurFrame2->m_nLastSent - aNewOOACKs[nCurOOACK]->m_nFirstSent) >= 0))
 						continue;
-					// NAK the first packet, since it was skipped
-					iCurFrame2->m_nLastSent = LTMIN(iCurFrame2->m_nLastSent, timeGetTime() - LTMAX((uint32)m_fCurPing, k_nHeartbeatDelay));
-					m_bACKPending = true;
-					break;
+					++iCurFrame2->m_nLaterACKs;
 				}
+				if (iCurFrame2->m_nLaterACKs >= k_nFastResendACKs)
+					iCurFrame2->m_nResendTime = nCurTime;
 			}
 
 			break;
@@ -687,14 +774,14 @@ void CUDPConn::WriteHeartbeat(CPacket_Write &cPacket)
 		if (!cCurSlot.m_bInUse)
 			continue;
 		uint32 nFrameOffset = (cCurSlot.m_nFrameCode - (m_nIncomingLastFrame + 2)) & k_nFrameMask;
-		if (nFrameOffset > k_nMaxOutOfOrderPackets)
+		if (nFrameOffset >= k_nMaxOutOfOrderPackets)
 		{
 			ASSERT(!"Invalid out of order packet encountered.");
 			// Remove it from the queue....  Maybe it'll work itself out later.  Hopefully.
 			cCurSlot.m_bInUse = false;
 			continue;
 		}
-		nFlags |= (1 << nFrameOffset);
+		nFlags |= (1u << nFrameOffset);
 	}
 	if (m_nNumOutOfOrderPackets)
 		cPacket.WriteBits(nFlags, k_nMaxOutOfOrderPackets);
@@ -705,9 +792,9 @@ void CUDPConn::WriteHeartbeat(CPacket_Write &cPacket)
 
 void CUDPConn::WriteGuaranteed(CPacket_Write &cPacket, bool bForceEmpty)
 {
-	// Jump out if we don't have any guaranteed info, or if guaranteed messaging is paused while fixing lost packets
+	// Jump out if we don't have any guaranteed info, or if the other end can't take any more frames yet
 	if (m_bPauseGuaranteed || (m_cOutgoingGuaranteedQueue.empty() && !bForceEmpty) || 
-		IsFlowControlBlocked(GetUDPPacketSize(cPacket.Size())))
+		IsGuaranteedWindowFull() || IsFlowControlBlocked(GetUDPPacketSize(cPacket.Size())))
 	{
 		cPacket.Writebool(false);
 		return;
@@ -717,7 +804,7 @@ void CUDPConn::WriteGuaranteed(CPacket_Write &cPacket, bool bForceEmpty)
 	bool bContinued = false;
 	bool bFirst = true;
 
-	uint32 nBiggestPacketSize = LTMIN(k_nTargetPacketSize, m_nFlowControlBitsPerPeriod / 2);
+	uint32 nBiggestPacketSize = LTMIN(k_nTargetPacketSize, m_nFlowControlBucketSize / 2);
 
 	uint32 nNumSubPackets = 0;
 	while (!m_cOutgoingGuaranteedQueue.empty() && !bContinued)
@@ -810,8 +897,10 @@ void CUDPConn::WriteGuaranteed(CPacket_Write &cPacket, bool bForceEmpty)
 		LT_MEM_TRACK_ALLOC(m_cFrameHistory.push_back(CPacketFrame(), s_cFrameTrash), LT_MEM_TYPE_NETWORKING);
 	}
 	m_cFrameHistory.back().m_nFirstSent = timeGetTime();
-	m_cFrameHistory.back().m_nLastSent = m_cFrameHistory.back().m_nFirstSent + LTMIN(LTMAX((uint32)m_fCurPing, k_nHeartbeatDelay) * k_nPingFirstNAKMultiplier, k_nMaxPingNAKTime);
+	m_cFrameHistory.back().m_nLastSent = m_cFrameHistory.back().m_nFirstSent;
+	m_cFrameHistory.back().m_nResendTime = m_cFrameHistory.back().m_nFirstSent + GetResendTime(0);
 	m_cFrameHistory.back().m_bReceivedOO = false;
+	m_cFrameHistory.back().m_nLaterACKs = 0;
 
 	// Write the frame code
 	m_nOutgoingFrameCode = (m_nOutgoingFrameCode + 1) & k_nFrameMask;
@@ -978,77 +1067,45 @@ void CUDPConn::ReSendFrame(CPacketFrame &cFrame)
 void CUDPConn::ReSendLostPackets()
 {
 	bool bWasPaused = m_bPauseGuaranteed;
-	m_bPauseGuaranteed = m_bFlushingNAKs;
 
 	uint32 nCurTime = timeGetTime();
-	uint32 nNAKMS = LTMIN(LTMAX((uint32)m_fCurPing, k_nHeartbeatDelay) * k_nPingNAKMultiplier, k_nMaxPingNAKTime);
 
 	// Strip OO received packets from the front of the frame history
 	while (!m_cFrameHistory.empty() && m_cFrameHistory.front().m_bReceivedOO)
 		m_cFrameHistory.pop_front(s_cFrameTrash, s_cPacketTrash);
 
-	// Find out if we should pause...
-	bool bResetGuaranteed = false;
+	// Re-send whatever's due, oldest first.  The flow control paces them out.
 	uint32 nWaitingCount = 0;
+	bool bFlowControlBlocked = false;
+	uint32 nPacketOverhead = GetUDPPacketSize(k_nUDPCommand_Heartbeat_Size + 32);
 	CFrameQueue::iterator iCurFrame = m_cFrameHistory.begin();
 	for (; iCurFrame != m_cFrameHistory.end(); ++iCurFrame)
 	{
 		++nWaitingCount;
-		if (iCurFrame->m_bReceivedOO)
+		if (iCurFrame->m_bReceivedOO || bFlowControlBlocked)
 			continue;
-		bResetGuaranteed |= (iCurFrame->m_nSendCount > k_nGuaranteedTrickleCount);
-	}
-	if (bResetGuaranteed)
-	{
-		if (!m_bFlushingNAKs)
-			m_nNAKFlushStartTime = nCurTime;
-		m_bFlushingNAKs = true;
-		// Re-send the first frame with a reset message
-		CPacketFrame &cFirstFrame = m_cFrameHistory.front();
-		cFirstFrame.m_nSendCount = k_nGuaranteedTrickleCount + 1;
-		uint32 nDiff = nCurTime - LTMIN(cFirstFrame.m_nLastSent, nCurTime);
-		if ((nDiff >= LTMAX(nNAKMS, k_nTrickleNAKDelay)) && !IsFlowControlBlocked(GetUDPPacketSize(cFirstFrame.m_nFrameSize + k_nUDPCommand_Heartbeat_Size + 32)))
+		// Is its timer up?
+		if ((int32)(nCurTime - iCurFrame->m_nResendTime) < 0)
+			continue;
+		if (IsFlowControlBlocked(nPacketOverhead + iCurFrame->m_nFrameSize))
 		{
-			ReSendFrame(cFirstFrame);
-			cFirstFrame.m_nLastSent = nCurTime;
-			if (g_CV_UDPDebug)
-			{
-				dsi_ConsolePrint("UDP: Trickling on frame %d", cFirstFrame.m_nFrameCode);
-			}
+			// Don't let the newer ones jump ahead of it
+			bFlowControlBlocked = true;
+			continue;
 		}
-		return;
-	}
-	else
-	{
-		m_bFlushingNAKs = false;
+		ReSendFrame(*iCurFrame);
+		iCurFrame->m_nLastSent = nCurTime;
+		iCurFrame->m_nLaterACKs = 0;
+		++(iCurFrame->m_nSendCount);
+		iCurFrame->m_nResendTime = nCurTime + GetResendTime(iCurFrame->m_nSendCount);
 	}
+	m_nGuaranteedWaiting = nWaitingCount;
 
-	if (nWaitingCount > k_nGuaranteedOverflowCount)
-	{
-		m_bPauseGuaranteed = true;
-	}
+	// New frames have to wait if the other end couldn't hold on to them
+	m_bPauseGuaranteed = IsGuaranteedWindowFull();
 
-	uint32 nPacketOverhead = GetUDPPacketSize(k_nUDPCommand_Heartbeat_Size + 32);
-	iCurFrame = m_cFrameHistory.begin();
-	for (; iCurFrame != m_cFrameHistory.end(); ++iCurFrame)
-	{
-		if (iCurFrame->m_bReceivedOO)
-			continue;
-		m_bPauseGuaranteed |= (iCurFrame->m_nSendCount > k_nGuaranteedBlockCount);
-		// Should we send a NAK yet?
-		uint32 nDiff = nCurTime - LTMIN(iCurFrame->m_nLastSent, nCurTime);
-		if (nDiff >= nNAKMS)
-		{
-			uint32 nNAKSize = iCurFrame->m_nFrameSize;
-			if (IsFlowControlBlocked(nPacketOverhead + nNAKSize))
-				continue;
-			ReSendFrame(*iCurFrame);
-			// Take up some more of the outgoing bandwidth so we don't get crowded out
-			//UpdateOutgoingFlowControl(iCurFrame->m_nFrameSize / 2, nCurTime);
-			iCurFrame->m_nLastSent = nCurTime;
-			++(iCurFrame->m_nSendCount);
-		}
-	}
+	if (m_bPauseGuaranteed && !bWasPaused)
+		++m_nGuaranteedPauses;
 
 	if (g_CV_UDPDebug && m_bPauseGuaranteed && !bWasPaused)
 	{
@@ -1256,7 +1313,7 @@ bool CUDPConn::IsInTrouble()
 int32 CUDPConn::GetAvailableBandwidth(float fTime) const
 {
 	// If we're backed up, pause
-	if (m_bFlushingNAKs)
+	if (!m_cFrameHistory.empty() && (m_cFrameHistory.front().m_nSendCount >= k_nBackedUpSendCount))
 		return 0;
 
 	uint32 nCurTime = timeGetTime();
@@ -1266,20 +1323,11 @@ int32 CUDPConn::GetAvailableBandwidth(float fTime) const
 
 	// Figure in flow control
 	const_cast<CUDPConn*>(this)->UpdateOutgoingFlowControl(0, nCurTime);
-	uint32 nFutureTime = nCurTime + (uint32)(fTime * 1000.0f);
-	uint32 nTotalFlowControlTime = (nFutureTime - m_nFlowControlPeriodTime);
-	uint32 nFlowControlBits = (nTotalFlowControlTime * m_nFlowControlBitsPerPeriod) / k_nFlowControlPeriod;
-	uint32 nCurFlowControlBits = m_nFlowControlLastPeriodSent + m_nFlowControlCurPeriodSent;
-	if (nFlowControlBits > nCurFlowControlBits)
-	{
-		// Restrict the available bandwidth to how much the flow control will let us have...
-		nFlowControlBits -= nCurFlowControlBits;
-		nAvailableBandwidth = LTMIN(nFlowControlBits, nAvailableBandwidth);
-	}
-	else
-	{
+	uint64 nFlowControlBits = (uint64)m_nFlowControlTokens + (uint64)((float)m_nBandwidth * fTime);
+	if (!nFlowControlBits)
 		return 0;
-	}
+	// Restrict the available bandwidth to how much the flow control will let us have...
+	nAvailableBandwidth = (int32)LTMIN(nFlowControlBits, (uint64)nAvailableBandwidth);
 
 	// Start with the guaranteed queue
 	int32 nReservedBandwidth = (int32)m_nOutgoingGSize;
@@ -1387,7 +1435,7 @@ bool CUDPConn::SendPacket(const CPacket_Read &cPacket)
 	cFingerprintPacket.WriteBits(nFingerprint, k_nFingerprintBits);
 	cFingerprintPacket.WritePacket(cPacket);
 
-	return CUDPDriver::SendTo(m_Socket, CPacket_Read(cFingerprintPacket), &m_RemoteAddr);
+	return static_cast<CUDPDriver*>(m_pDriver)->SendConnPacket(m_Socket, CPacket_Read(cFingerprintPacket), &m_RemoteAddr);
 }
 
 void CUDPConn::AccumulateHistory(TBandwidthHistory &cHistory)
@@ -1403,98 +1451,65 @@ void CUDPConn::AccumulateHistory(TBandwidthHistory &cHistory)
 
 void CUDPConn::ResetFlowControl()
 {
-	const uint32 k_nRawBitsPerPeriod = (m_nBandwidth * k_nFlowControlPeriod) / 1000;
-	m_nFlowControlBitsPerPeriod = k_nRawBitsPerPeriod;
+	// Make sure the biggest packet always fits
+	uint64 nBucketSize = ((uint64)m_nBandwidth * k_nFlowControlBurstTime) / 1000;
+	nBucketSize = LTCLAMP(nBucketSize, (uint64)(GetUDPPacketSize(k_nTargetPacketSize) * 2), (uint64)0x7FFFFFFF);
+	m_nFlowControlBucketSize = (uint32)nBucketSize;
 	if (g_CV_UDPDebug > 1)
 	{
-		dsi_ConsolePrint("UDP: Reset flow control (%d / %d)", m_nFlowControlBitsPerPeriod, m_nBandwidth);
+		dsi_ConsolePrint("UDP: Reset flow control (%d / %d)", m_nFlowControlBucketSize, m_nBandwidth);
 	}
-	m_nFlowControlCurPeriodSent = LTMIN(m_nFlowControlCurPeriodSent, m_nFlowControlBitsPerPeriod);
-	m_nFlowControlLastPeriodSent = LTMIN(m_nFlowControlLastPeriodSent, m_nFlowControlBitsPerPeriod);
+	m_nFlowControlTokens = LTMIN(m_nFlowControlTokens, m_nFlowControlBucketSize);
 }
 
 void CUDPConn::UpdateOutgoingFlowControl(uint32 nPacketSize, uint32 nCurTime)
 {
-	uint32 nOriginalPacketSize = nPacketSize;
-	uint32 nTimeOffset = (nCurTime < m_nFlowControlPeriodTime) ? 0 : nCurTime - m_nFlowControlPeriodTime;
-
-	// Are we just starting? (or is our time messed up..)
+	// Are we just starting?
 	if (!m_bFlowControlInitialized)
 	{
 		m_bFlowControlInitialized = true;
 
 		ResetFlowControl();
-		m_nFlowControlPeriodTime = nCurTime;
-	}
-	// Are we starting a new period?
-	else if (nTimeOffset >= k_nFlowControlMinPeriod)
-	{
-		// Move the current period into last period
-		uint32 nPeriodTime = nCurTime - m_nFlowControlPeriodTime;
-		uint32 nFlowBits = (m_nBandwidth * nPeriodTime) / 1000;
-		if (m_nFlowControlCurPeriodSent >= nFlowBits)
-		{
-			m_nFlowControlLastPeriodSent += nFlowBits;
-			m_nFlowControlCurPeriodSent -= nFlowBits;
-		}
-		else
-		{
-			m_nFlowControlCurPeriodSent = 0;
-		}
-		
-		if (m_nFlowControlLastPeriodSent >= nFlowBits)
-		{
-			m_nFlowControlLastPeriodSent -= nFlowBits;
-		}
+		m_nFlowControlTokens = m_nFlowControlBucketSize;
+		m_nFlowControlFillTime = nCurTime;
+	}
+	// Fill the bucket
+	else if (nCurTime != m_nFlowControlFillTime)
+	{
+		// Is our time messed up?
+		uint32 nFillTime = ((int32)(nCurTime - m_nFlowControlFillTime) < 0) ? 0 : nCurTime - m_nFlowControlFillTime;
+		uint64 nNewTokens = ((uint64)m_nBandwidth * nFillTime) / 1000;
+		m_nFlowControlTokens = (uint32)LTMIN((uint64)m_nFlowControlTokens + nNewTokens, (uint64)m_nFlowControlBucketSize);
+		// Hang on to the partial bits if it's not full
+		if ((m_nFlowControlTokens < m_nFlowControlBucketSize) && m_nBandwidth)
+			m_nFlowControlFillTime += (uint32)((nNewTokens * 1000) / m_nBandwidth);
 		else
-		{
-			m_nFlowControlLastPeriodSent = 0;
-		}
-		
-		// You are now here.
-		m_nFlowControlPeriodTime = nCurTime;
+			m_nFlowControlFillTime = nCurTime;
 
-		if ((g_CV_UDPDebug > 2) && (!nOriginalPacketSize))
+		if ((g_CV_UDPDebug > 2) && (!nPacketSize))
 		{
-			dsi_ConsolePrint("UDP: Flow control period (%d/%d of %d)", m_nFlowControlLastPeriodSent, m_nFlowControlCurPeriodSent, m_nFlowControlBitsPerPeriod);
+			dsi_ConsolePrint("UDP: Flow control fill (%d of %d)", m_nFlowControlTokens, m_nFlowControlBucketSize);
 		}
 	}
 
 	if (nPacketSize)
 	{
-		// Put whatever we can into last period
-		if (m_nFlowControlLastPeriodSent < m_nFlowControlBitsPerPeriod)
+		m_nFlowControlTokens -= LTMIN(nPacketSize, m_nFlowControlTokens);
+
+		if (g_CV_UDPDebug > 2)
 		{
-			uint32 nUnderflowBits = m_nFlowControlBitsPerPeriod - m_nFlowControlLastPeriodSent;
-			if (nUnderflowBits >= nPacketSize)
-			{
-				m_nFlowControlLastPeriodSent += nPacketSize;
-				nPacketSize = 0;
-			}
-			else
-			{
-				m_nFlowControlLastPeriodSent = m_nFlowControlBitsPerPeriod;
-				nPacketSize -= nUnderflowBits;
-			}
+			dsi_ConsolePrint("UDP: Flow control update (%d of %d, %d)", m_nFlowControlTokens, m_nFlowControlBucketSize, nPacketSize);
 		}
-
-		// Put the rest into the current period
-		m_nFlowControlCurPeriodSent += nPacketSize;
-	}
-
-	if ((g_CV_UDPDebug > 2) && nOriginalPacketSize)
-	{
-		dsi_ConsolePrint("UDP: Flow control update (%d/%d of %d, %d)", m_nFlowControlLastPeriodSent, m_nFlowControlCurPeriodSent, m_nFlowControlBitsPerPeriod, nOriginalPacketSize);
 	}
 }
 
 bool CUDPConn::IsFlowControlBlocked(uint32 nPacketSize) const
 {
 	const_cast<CUDPConn*>(this)->UpdateOutgoingFlowControl(0, timeGetTime());
-	bool bBlocked = (m_nFlowControlLastPeriodSent + m_nFlowControlCurPeriodSent + nPacketSize) > (m_nFlowControlBitsPerPeriod * 2);
+	bool bBlocked = nPacketSize > m_nFlowControlTokens;
 	if ((g_CV_UDPDebug > 2) && bBlocked)
 	{
-		dsi_ConsolePrint("UDP: Flow control blocked (%d/%d of %d, %d)", m_nFlowControlLastPeriodSent, m_nFlowControlCurPeriodSent, m_nFlowControlBitsPerPeriod, nPacketSize);
+		dsi_ConsolePrint("UDP: Flow control blocked (%d of %d, %d)", m_nFlowControlTokens, m_nFlowControlBucketSize, nPacketSize);
 	}
 	return bBlocked;
 }
@@ -1788,10 +1803,14 @@ SOCKET udp_BindToPort(sockaddr_in *pAddr, sockaddr_in *pFinalAddr)
 }
 
 
+// Largest datagram we're willing to receive
+static const uint32 k_nMaxUDPPacketSize = 8192;
+// Most datagrams we'll pull off the socket in one batched receive
+static const uint32 k_nMaxUDPRecvBatchSize = 32;
+
 // Tries to receive incoming data for the socket.  Returns true if data was successfully received
 bool udp_RecvFromSocket(SOCKET theSocket, CPacket_Read *pPacket, sockaddr_in *pSender, int *pResultStatus = 0)
 {
-	const uint32 k_nMaxUDPPacketSize = 8192;
 	uint8 aRecvBuffer[k_nMaxUDPPacketSize];
 
 	// Get the data.
@@ -1841,6 +1860,109 @@ bool udp_RecvFromSocket(SOCKET theSocket, CPacket_Read *pPacket, sockaddr_in *pS
 	return true;
 }
 
+// Tries to receive up to nMaxPackets datagrams from the socket.  pRecvBuffer must hold
+// nMaxPackets * k_nMaxUDPPacketSize bytes.  Returns the number of packets received, and
+// fills in pResultStatus the same way udp_RecvFromSocket does when nothing was received.
+uint32 udp_RecvBatchFromSocket(SOCKET theSocket, CPacket_Read *aPackets, sockaddr_in *aSenders, uint32 nMaxPackets, 
+	uint8 *pRecvBuffer, CUDPIOCounters *pStats, int *pResultStatus)
+{
+#ifdef __LINUX
+	mmsghdr aMsgs[k_nMaxUDPRecvBatchSize];
+	iovec aIOVecs[k_nMaxUDPRecvBatchSize];
+	nMaxPackets = LTMIN(nMaxPackets, k_nMaxUDPRecvBatchSize);
+
+	memset(aMsgs, 0, sizeof(aMsgs[0]) * nMaxPackets);
+	for (uint32 nCurMsg = 0; nCurMsg < nMaxPackets; ++nCurMsg)
+	{
+		aIOVecs[nCurMsg].iov_base = &pRecvBuffer[nCurMsg * k_nMaxUDPPacketSize];
+		aIOVecs[nCurMsg].iov_len = k_nMaxUDPPacketSize;
+		aMsgs[nCurMsg].msg_hdr.msg_iov = &aIOVecs[nCurMsg];
+		aMsgs[nCurMsg].msg_hdr.msg_iovlen = 1;
+		aMsgs[nCurMsg].msg_hdr.msg_name = &aSenders[nCurMsg];
+		aMsgs[nCurMsg].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+	}
+
+	int status = recvmmsg(theSocket, aMsgs, nMaxPackets, MSG_DONTWAIT, NULL);
+	if (status <= 0)
+	{
+		*pResultStatus = (status == 0) ? 0 : errno;
+		if ((status != 0) && (errno != EWOULDBLOCK) && (g_CV_UDPDebug > 1))
+		{
+			dsi_ConsolePrint("UDP: recvmmsg returned error %d (max packet size %d)", errno, k_nMaxUDPPacketSize);
+		}
+		return 0;
+	}
+
+	++pStats->m_nRecvCalls;
+	pStats->m_nRecvDatagrams += (uint32)status;
+
+	uint32 nNumPackets = 0;
+	for (uint32 nCurMsg = 0; nCurMsg < (uint32)status; ++nCurMsg)
+	{
+		// Drop zero-length and truncated messages, like recvfrom would
+		if ((aMsgs[nCurMsg].msg_len == 0) || (aMsgs[nCurMsg].msg_hdr.msg_flags & MSG_TRUNC))
+		{
+			if (g_CV_UDPDebug > 1)
+			{
+				dsi_ConsolePrint("UDP: recvmmsg dropped a %s message", (aMsgs[nCurMsg].msg_len) ? "truncated" : "zero-length");
+			}
+			continue;
+		}
+
+		CPacket_Write cIncomingPacket;
+		cIncomingPacket.WriteDataRaw(aIOVecs[nCurMsg].iov_base, aMsgs[nCurMsg].msg_len);
+		aPackets[nNumPackets] = CPacket_Read(cIncomingPacket);
+		aSenders[nNumPackets] = aSenders[nCurMsg];
+		++nNumPackets;
+	}
+
+	// Report a zero-length message if that's all we got, so the caller goes around again
+	if (!nNumPackets)
+	{
+		*pResultStatus = 0;
+	}
+
+	return nNumPackets;
+#else
+	// No batched receive here; drain the socket one datagram at a time instead
+	uint32 nNumPackets = 0;
+	while (nNumPackets < nMaxPackets)
+	{
+		int nRecvStatus;
+		if (!udp_RecvFromSocket(theSocket, &aPackets[nNumPackets], &aSenders[nNumPackets], &nRecvStatus))
+		{
+			if (!nNumPackets)
+			{
+				*pResultStatus = nRecvStatus;
+			}
+			break;
+		}
+
+		++pStats->m_nRecvCalls;
+		++pStats->m_nRecvDatagrams;
+		++nNumPackets;
+	}
+
+	return nNumPackets;
+#endif
+}
+
+// Screw over a packet if we're simulating corruption
+static void udp_SimulateCorruption(uint8 *pData, int nDataLen)
+{
+	if (!g_CV_UDPSimulateCorruption)
+		return;
+
+	if ((rand() % 100) < g_CV_UDPSimulateCorruption)
+	{
+		uint32 nNumCorruptions = rand() % 10 + 1;
+		while (nNumCorruptions--)
+		{
+			pData[rand() % nDataLen] = (uint8)rand();
+		}
+	}
+}
+
 
 // ----------------------------------------------------------------- //
 // CUDPDriver code.
@@ -1862,6 +1984,13 @@ CUDPDriver::CUDPDriver()
 	m_DriverFlags = NETDRIVER_TCPIP;
 	m_nCurPingID = 0;
 	memset(&m_cGUID, 0, sizeof(m_cGUID));
+	m_bSendBatchOpen = false;
+	m_bAnyClientPort = false;
+	m_bThreadedIO = false;
+	m_bFrameUpdatePending = false;
+	m_WakeSocket = INVALID_SOCKET;
+	m_bWakePending = false;
+	m_bIncomingRingFull = false;
 }
 
 
@@ -1918,7 +2047,26 @@ void CUDPDriver::Term2(bool bFullShutdown, bool bShutdownSocket )
 {
 	// Close down any connections.
 	m_cCS_Connections.Enter();
-	MDeleteAndRemoveElements(m_Connections);
+	if (m_bThreadedIO)
+	{
+		// The listen thread may still have packets for them
+		MPOS pCurPos = m_Connections.GetHeadPosition();
+		while (pCurPos)
+		{
+			CUDPConn *pCurConn = m_Connections.GetNext(pCurPos);
+			m_Connections.RemoveAt(&pCurConn->m_Node);
+			ReleaseConnection(pCurConn);
+		}
+
+		CIncomingEntry cEntry;
+		while (m_cIncomingRing.pop(cEntry))
+			;
+		m_cIncomingBacklog.clear();
+	}
+	else
+	{
+		MDeleteAndRemoveElements(m_Connections);
+	}
 	m_cCS_Connections.Leave();
 
 	if ( bShutdownSocket )
@@ -1987,23 +2135,267 @@ bool CUDPDriver::SendTo(SOCKET theSocket, const CPacket_Read &cPacket, sockaddr_
 //	cReadPacket.ReadData(aSendBuffer, nDataLen * 8);
 	cReadPacket.ReadDataRaw( aSendBuffer, nDataLen );
 
-	if (g_CV_UDPSimulateCorruption)
+	udp_SimulateCorruption(aSendBuffer, nDataLen);
+
+	status = sendto(theSocket, (char*)aSendBuffer, nDataLen,
+		0, (sockaddr*)pSendTo, sizeof(*pSendTo));
+
+	return status != SOCKET_ERROR;
+}
+
+bool CUDPDriver::SendConnPacket(SOCKET theSocket, const CPacket_Read &cPacket, sockaddr_in *pSendTo)
+{
+	if (!m_bSendBatchOpen)
 	{
-		if ((rand() % 100) < g_CV_UDPSimulateCorruption)
+		++m_cIOStats.m_nSendCalls;
+		++m_cIOStats.m_nSendDatagrams;
+		return SendTo(theSocket, cPacket, pSendTo);
+	}
+
+	// Make room if the batch is full
+	if (m_aSendBatch.size() >= k_nMaxIOBatchSize)
+	{
+		FlushSendBatch();
+	}
+
+	CPacket_Read cReadPacket(cPacket);
+	cReadPacket.SeekTo(0);
+	uint32 nDataLen = (cReadPacket.Size() + 7) / 8;
+
+	CBatchedDatagram cDatagram;
+	cDatagram.m_Socket = theSocket;
+	cDatagram.m_cAddr = *pSendTo;
+	cDatagram.m_nOffset = m_aSendBatchData.size();
+	cDatagram.m_nSize = nDataLen;
+
+	// ReadDataRaw copies whole dwords, so leave room for the tail
+	LT_MEM_TRACK_ALLOC(m_aSendBatchData.resize(cDatagram.m_nOffset + ((nDataLen + 3) & ~3)), LT_MEM_TYPE_NETWORKING);
+	uint8 *pData = &m_aSendBatchData[cDatagram.m_nOffset];
+	cReadPacket.ReadDataRaw(pData, nDataLen);
+	udp_SimulateCorruption(pData, nDataLen);
+
+	LT_MEM_TRACK_ALLOC(m_aSendBatch.push_back(cDatagram), LT_MEM_TYPE_NETWORKING);
+
+	return true;
+}
+
+void CUDPDriver::OpenSendBatch()
+{
+	m_bSendBatchOpen = (g_CV_UDPBatchIO != 0);
+}
+
+void CUDPDriver::FlushSendBatch()
+{
+	uint32 nNumDatagrams = m_aSendBatch.size();
+	uint32 nCurDatagram = 0;
+	while (nCurDatagram < nNumDatagrams)
+	{
+		// Send runs of datagrams going out the same socket together
+		SOCKET theSocket = m_aSendBatch[nCurDatagram].m_Socket;
+		uint32 nRunEnd = nCurDatagram + 1;
+		while ((nRunEnd < nNumDatagrams) && (m_aSendBatch[nRunEnd].m_Socket == theSocket))
 		{
-			// Screw over the packet...
-			uint32 nNumCorruptions = rand() % 10 + 1;
-			while (nNumCorruptions--)
+			++nRunEnd;
+		}
+
+#ifdef __LINUX
+		mmsghdr aMsgs[k_nMaxIOBatchSize];
+		iovec aIOVecs[k_nMaxIOBatchSize];
+		uint32 nRunSize = nRunEnd - nCurDatagram;
+
+		memset(aMsgs, 0, sizeof(aMsgs[0]) * nRunSize);
+		for (uint32 nCurMsg = 0; nCurMsg < nRunSize; ++nCurMsg)
+		{
+			CBatchedDatagram &cDatagram = m_aSendBatch[nCurDatagram + nCurMsg];
+			aIOVecs[nCurMsg].iov_base = &m_aSendBatchData[cDatagram.m_nOffset];
+			aIOVecs[nCurMsg].iov_len = cDatagram.m_nSize;
+			aMsgs[nCurMsg].msg_hdr.msg_iov = &aIOVecs[nCurMsg];
+			aMsgs[nCurMsg].msg_hdr.msg_iovlen = 1;
+			aMsgs[nCurMsg].msg_hdr.msg_name = &cDatagram.m_cAddr;
+			aMsgs[nCurMsg].msg_hdr.msg_namelen = sizeof(cDatagram.m_cAddr);
+		}
+
+		uint32 nRunSent = 0;
+		while (nRunSent < nRunSize)
+		{
+			int status = sendmmsg(theSocket, &aMsgs[nRunSent], nRunSize - nRunSent, 0);
+			++m_cIOStats.m_nSendCalls;
+			if (status <= 0)
 			{
-				aSendBuffer[rand() % nDataLen] = (uint8)rand();
+				// It's UDP.  Drop the rest of the run rather than stalling the frame.
+				if (g_CV_UDPDebug > 1)
+				{
+					dsi_ConsolePrint("UDP: sendmmsg returned error %d, dropping %d packets", errno, nRunSize - nRunSent);
+				}
+				break;
 			}
+			m_cIOStats.m_nSendDatagrams += (uint32)status;
+			nRunSent += (uint32)status;
+		}
+#else
+		for (uint32 nCurMsg = nCurDatagram; nCurMsg < nRunEnd; ++nCurMsg)
+		{
+			CBatchedDatagram &cDatagram = m_aSendBatch[nCurMsg];
+			sendto(theSocket, (char*)&m_aSendBatchData[cDatagram.m_nOffset], cDatagram.m_nSize,
+				0, (sockaddr*)&cDatagram.m_cAddr, sizeof(cDatagram.m_cAddr));
+			++m_cIOStats.m_nSendCalls;
+			++m_cIOStats.m_nSendDatagrams;
 		}
+#endif
+
+		nCurDatagram = nRunEnd;
 	}
 
-	status = sendto(theSocket, (char*)aSendBuffer, nDataLen,
-		0, (sockaddr*)pSendTo, sizeof(*pSendTo));
+	m_aSendBatch.clear();
+	m_aSendBatchData.clear();
+}
 
-	return status != SOCKET_ERROR;
+bool CUDPDriver::GetIOStats(NetDriverIOStats *pStats)
+{
+	m_cIOStats.Get(pStats);
+	return true;
+}
+
+void CUDPDriver::ResetIOStats()
+{
+	m_cIOStats.Clear();
+}
+
+bool CUDPDriver::PushOutgoing(const COutgoingEntry &cEntry)
+{
+	// Stay in order behind anything that's already waiting
+	FlushOutgoingBacklog();
+	if (m_cOutgoingBacklog.empty() && m_cOutgoingRing.push(cEntry))
+	{
+		WakeListenThread();
+		return true;
+	}
+
+	// The listen thread is behind.  Don't wait for it, since it needs m_cCS_Connections
+	// to drain the ring and the caller may well be holding it.  Releases always have to
+	// get through, but packets are refused once the backlog gets out of hand.
+	if (!cEntry.m_bRelease && (m_cOutgoingBacklog.size() >= k_nThreadedIO_MaxBacklog))
+	{
+		if (g_CV_UDPDebug > 1)
+		{
+			dsi_ConsolePrint("UDP: Outgoing packet backlog full, dropping packet");
+		}
+		return false;
+	}
+
+	LT_MEM_TRACK_ALLOC(m_cOutgoingBacklog.push_back(cEntry), LT_MEM_TYPE_NETWORKING);
+	return true;
+}
+
+void CUDPDriver::FlushOutgoingBacklog()
+{
+	while (!m_cOutgoingBacklog.empty())
+	{
+		if (!m_cOutgoingRing.push(m_cOutgoingBacklog.front()))
+			break;
+		m_cOutgoingBacklog.pop_front();
+		WakeListenThread();
+	}
+}
+
+void CUDPDriver::WakeListenThread()
+{
+	if (m_WakeSocket == INVALID_SOCKET)
+		return;
+
+	// One poke is enough until the listen thread picks it up
+	if (m_bWakePending.exchange(true))
+		return;
+
+	uint8 nWake = 0;
+	sendto(m_WakeSocket, (char*)&nWake, sizeof(nWake), 0, (sockaddr*)&m_WakeAddr, sizeof(m_WakeAddr));
+}
+
+void CUDPDriver::ReleaseConnection(CUDPConn *pConn)
+{
+	COutgoingEntry cEntry;
+	cEntry.m_pConn = pConn;
+	cEntry.m_bRelease = true;
+	PushOutgoing(cEntry);
+}
+
+void CUDPDriver::ServiceOutgoingRing(bool bSend)
+{
+	COutgoingEntry cEntry;
+	while (m_cOutgoingRing.pop(cEntry))
+	{
+		if (cEntry.m_bRelease)
+		{
+			delete cEntry.m_pConn;
+		}
+		else if (bSend)
+		{
+			cEntry.m_pConn->QueuePacket(cEntry.m_cPacket, cEntry.m_bGuaranteed);
+		}
+	}
+}
+
+void CUDPDriver::DrainIncoming(CUDPConn *pConn)
+{
+	while (!m_bIncomingRingFull)
+	{
+		// Leave the rest on the connection if the game thread's behind
+		if (m_cIncomingRing.full())
+		{
+			m_bIncomingRingFull = true;
+			break;
+		}
+
+		CIncomingEntry cEntry;
+		cEntry.m_cPacket = pConn->GetPacket();
+		if (cEntry.m_cPacket.Empty())
+			break;
+		cEntry.m_pConn = pConn;
+		m_cIncomingRing.push(cEntry);
+	}
+}
+
+void CUDPDriver::ServiceThreadedIO()
+{
+	// Pick up whatever the game thread sent
+	ServiceOutgoingRing(true);
+
+	if (m_bFrameUpdatePending.exchange(false))
+	{
+		OpenSendBatch();
+
+		MPOS pCurPos = m_Connections.GetHeadPosition();
+		while (pCurPos)
+		{
+			CUDPConn *pCurConn = m_Connections.GetNext(pCurPos);
+			pCurConn->Update(true);
+			// Kick 'em if they get out of line.  That has to happen on the game thread.
+			if (pCurConn->IsInTrouble())
+			{
+				CDisconnectRequest cRequest;
+				cRequest.m_pConnection = pCurConn;
+				cRequest.m_eReason = DISCONNECTREASON_DEAD;
+
+				CSAccess cDisconnectProtect(&m_cCS_DisconnectQueue);
+				LT_MEM_TRACK_ALLOC(m_cDisconnectQueue.push_back(cRequest), LT_MEM_TYPE_NETWORKING);
+			}
+		}
+
+		m_bSendBatchOpen = false;
+		FlushSendBatch();
+	}
+
+	// Try again with anything that didn't fit last time
+	if (m_bIncomingRingFull)
+	{
+		m_bIncomingRingFull = false;
+
+		MPOS pCurPos = m_Connections.GetHeadPosition();
+		while (pCurPos)
+		{
+			DrainIncoming(m_Connections.GetNext(pCurPos));
+		}
+	}
 }
 
 
@@ -2499,6 +2891,16 @@ void CUDPDriver::FlushUnknownMessageQueue()
 
 void CUDPDriver::Update()
 {
+	if (m_bThreadedIO)
+	{
+		FlushInternalQueues();
+		FlushOutgoingBacklog();
+		// The listen thread picks this up and updates the connections
+		m_bFrameUpdatePending.store(true);
+		WakeListenThread();
+		return;
+	}
+
 	CSAccess cConnProtect(&m_cCS_Connections);
 
 	FlushInternalQueues();
@@ -2509,12 +2911,19 @@ void CUDPDriver::Update()
 	{
 		MPOS pNextPos = pCurPos;
 		CUDPConn *pCurConn = m_Connections.GetNext(pNextPos);
+
+		// Collect this frame's outgoing packets so they go out in one flush
+		OpenSendBatch();
 		pCurConn->Update(true);
+		m_bSendBatchOpen = false;
+
 		// Kick 'em if they get out of line
 		if (pCurConn->IsInTrouble())
 			Disconnect(pCurConn, DISCONNECTREASON_DEAD, true);
 		pCurPos = pNextPos;
 	}
+
+	FlushSendBatch();
 }
 
 
@@ -2537,10 +2946,41 @@ void CUDPDriver::Disconnect(CBaseConn *id, EDisconnectReason reason, bool bSendM
 
 	m_pNetMgr->DisconnectNotify(id, reason);
 	if (bSendMessage)
+	{
+		// Anything already batched for them has to go out ahead of the disconnect
+		bool bBatchOpen = m_bSendBatchOpen;
+		m_bSendBatchOpen = false;
+		FlushSendBatch();
 		pConn->SendDisconnectMessage( reason );
+		m_bSendBatchOpen = bBatchOpen;
+	}
 
 	m_Connections.RemoveAt(&pConn->m_Node);
-	delete pConn;
+
+	if (m_bThreadedIO)
+	{
+		// Nobody's going to ask for its incoming packets any more
+		CIncomingEntry cEntry;
+		while (m_cIncomingRing.pop(cEntry))
+		{
+			LT_MEM_TRACK_ALLOC(m_cIncomingBacklog.push_back(cEntry), LT_MEM_TYPE_NETWORKING);
+		}
+		std::deque<CIncomingEntry>::iterator iCurEntry = m_cIncomingBacklog.begin();
+		while (iCurEntry != m_cIncomingBacklog.end())
+		{
+			if (iCurEntry->m_pConn == pConn)
+				iCurEntry = m_cIncomingBacklog.erase(iCurEntry);
+			else
+				++iCurEntry;
+		}
+
+		// Let the listen thread delete it once it's done with it
+		ReleaseConnection(pConn);
+	}
+	else
+	{
+		delete pConn;
+	}
 }
 
 
@@ -2799,6 +3239,27 @@ void CUDPDriver::HandleUnconnectedData(CPacket_Read &cPacket, sockaddr_in *pSend
 
 bool CUDPDriver::GetPacket(CPacket_Read *pPacket, CBaseConn **pSender)
 {
+	if (m_bThreadedIO)
+	{
+		// New connections need to be announced before their packets
+		FlushConnectQueue();
+
+		CIncomingEntry cEntry;
+		if (!m_cIncomingBacklog.empty())
+		{
+			cEntry = m_cIncomingBacklog.front();
+			m_cIncomingBacklog.pop_front();
+		}
+		else if (!m_cIncomingRing.pop(cEntry))
+		{
+			return false;
+		}
+
+		*pPacket = cEntry.m_cPacket;
+		*pSender = cEntry.m_pConn;
+		return true;
+	}
+
 	CSAccess cConnProtect(&m_cCS_Connections);
 
 	// Flush the queues, just in case something got processed since the update
@@ -2829,10 +3290,20 @@ bool CUDPDriver::SendPacket(const CPacket_Read &cPacket, CBaseConn *idSendTo, bo
 	if(!idSendTo || !m_Socket)
 		return false;
 
-	CSAccess cConnProtect(&m_cCS_Connections);
-
 	pConn = (CUDPConn*)idSendTo;
 
+	if (m_bThreadedIO)
+	{
+		// The listen thread queues it on the connection
+		COutgoingEntry cEntry;
+		cEntry.m_cPacket = cPacket;
+		cEntry.m_pConn = pConn;
+		cEntry.m_bGuaranteed = bGuaranteed;
+		return PushOutgoing(cEntry);
+	}
+
+	CSAccess cConnProtect(&m_cCS_Connections);
+
 	// Forgive any past transgressions
 #ifdef __LINUX
 	errno = 0;
@@ -3373,7 +3844,7 @@ LTRESULT CUDPDriver::OpenSocket( SOCKET* phSocket )
 {
 	StopThread_Listen( );
 
-	int32 bindPort = udp_GetFirstClientPort();
+	int32 bindPort = m_bAnyClientPort ? 0 : udp_GetFirstClientPort();
 	int32 bindAttempts = 0;
 
 	while( m_Socket == INVALID_SOCKET )
@@ -3704,6 +4175,22 @@ void CUDPDriver::StartThread_Listen()
 
 	ASSERT(m_Socket != INVALID_SOCKET);
 
+	m_bThreadedIO = (g_CV_UDPThreadedIO != 0);
+	m_bFrameUpdatePending = false;
+	m_bWakePending = false;
+	m_bIncomingRingFull = false;
+
+	// Without a wake socket, the listen thread still gets to the rings every k_nThreadedIO_Period
+	if (m_bThreadedIO)
+	{
+		sockaddr_in cLoopback;
+		memset(&cLoopback, 0, sizeof(cLoopback));
+		cLoopback.sin_family = AF_INET;
+		cLoopback.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		cLoopback.sin_port = 0;
+		m_WakeSocket = udp_BindToPort(&cLoopback, &m_WakeAddr);
+	}
+
 	m_cListenThread.Create(&ThreadBootstrap_Listen, (void*) this);
 	m_cEvent_Thread_Listen_Ready.Block();
 }
@@ -3729,11 +4216,42 @@ void CUDPDriver::StopThread_Listen()
 	{	
 		m_cListenThread.WaitForExit();
 	}
+
+	if (m_WakeSocket != INVALID_SOCKET)
+	{
+#ifdef __LINUX
+		close(m_WakeSocket);
+#else
+		closesocket(m_WakeSocket);
+#endif
+		m_WakeSocket = INVALID_SOCKET;
+	}
 	
 	// Clean up
 	m_hEvent_Thread_Listen_Shutdown.Clear();
 	m_hEvent_Thread_Listen_Pause.Clear( );
 	m_hEvent_Thread_Listen_Paused.Clear( );
+
+	// Finish off anything the listen thread didn't get to
+	if (m_bThreadedIO)
+	{
+		ServiceOutgoingRing(false);
+		while (!m_cOutgoingBacklog.empty())
+		{
+			if (m_cOutgoingBacklog.front().m_bRelease)
+			{
+				delete m_cOutgoingBacklog.front().m_pConn;
+			}
+			m_cOutgoingBacklog.pop_front();
+		}
+
+		CIncomingEntry cEntry;
+		while (m_cIncomingRing.pop(cEntry))
+			;
+		m_cIncomingBacklog.clear();
+
+		m_bThreadedIO = false;
+	}
 }
 
 uint32 CUDPDriver::ThreadBootstrap_Listen(void *pUserData)
@@ -3747,9 +4265,15 @@ uint32 CUDPDriver::Thread_Listen()
 {
 	uint32 nResult = 0;
 
+	// Wake up regularly to service the game thread in threaded I/O mode
+	uint32 nTimeoutMS = (m_bThreadedIO) ? k_nThreadedIO_Period : k_nListenThread_Timeout;
 	timeval cTimeout;
-	cTimeout.tv_sec = k_nListenThread_Timeout / 1000;
-	cTimeout.tv_usec = (k_nListenThread_Timeout % 1000) * 1000;
+
+	// Receive buffers for batched reads
+	CPacket_Read aIncomingPackets[k_nMaxIOBatchSize];
+	sockaddr_in aSenderAddrs[k_nMaxIOBatchSize];
+	std::vector<uint8> aRecvBuffer;
+	LT_MEM_TRACK_ALLOC(aRecvBuffer.resize(k_nMaxIOBatchSize * k_nMaxUDPPacketSize), LT_MEM_TYPE_NETWORKING);
 
 	// Ok, we're starting now...
 	m_cEvent_Thread_Listen_Ready.Set();
@@ -3757,11 +4281,12 @@ uint32 CUDPDriver::Thread_Listen()
 	// Semi-infinite loop...
 	while (1)
 	{
-		// Read a packet
-		CPacket_Read cIncomingPacket;
-		sockaddr_in senderAddr;
+		// Read as many packets as we're allowed
+		uint32 nBatchSize = (g_CV_UDPBatchIO) ? k_nMaxIOBatchSize : 1;
 		int nRecvStatus;
-		if (!udp_RecvFromSocket(m_Socket, &cIncomingPacket, &senderAddr, &nRecvStatus))
+		uint32 nNumReceived = udp_RecvBatchFromSocket(m_Socket, aIncomingPackets, aSenderAddrs, nBatchSize, 
+			&aRecvBuffer[0], &m_cIOStats, &nRecvStatus);
+		if (!nNumReceived)
 		{
 			// Jump out if the socket's being shut down
 			if (m_hEvent_Thread_Listen_Shutdown.IsSet())
@@ -3831,15 +4356,44 @@ uint32 CUDPDriver::Thread_Listen()
 				fd_set aReadSet;
 				FD_ZERO(&aReadSet);
 				FD_SET(m_Socket, &aReadSet);
+				SOCKET nMaxSocket = m_Socket;
+				if (m_WakeSocket != INVALID_SOCKET)
+				{
+					FD_SET(m_WakeSocket, &aReadSet);
+					nMaxSocket = LTMAX(nMaxSocket, m_WakeSocket);
+				}
 
 				// Wait...
-				int status = select(m_Socket + 1, &aReadSet, NULL, NULL, &cTimeout);
+				cTimeout.tv_sec = nTimeoutMS / 1000;
+				cTimeout.tv_usec = (nTimeoutMS % 1000) * 1000;
+				int status = select(nMaxSocket + 1, &aReadSet, NULL, NULL, &cTimeout);
+				// Did the game thread hand us something?
+				if ((status > 0) && (m_WakeSocket != INVALID_SOCKET) && FD_ISSET(m_WakeSocket, &aReadSet))
+				{
+					// Clear the flag before servicing, so anything pushed from here on sends another poke
+					uint8 aWake[16];
+					while (recv(m_WakeSocket, (char*)aWake, sizeof(aWake), 0) > 0)
+						;
+					m_bWakePending.store(false);
+
+					if (m_hEvent_Thread_Listen_Shutdown.IsSet())
+						break;
+					CSAccess cConnProtection(&m_cCS_Connections);
+					ServiceThreadedIO();
+					continue;
+				}
 				// Did we time out?
 				if (status == 0)
 				{
 					// Jump out if we're supposed to shut down...
 					if (m_hEvent_Thread_Listen_Shutdown.IsSet())
 						break;
+					if (m_bThreadedIO)
+					{
+						CSAccess cConnProtection(&m_cCS_Connections);
+						ServiceThreadedIO();
+						continue;
+					}
 					// Update the connections so they stay alive
 					// Note : This can't use the standard update, because we don't want
 					// to flush anything, and we don't want to disconnect any dead connections.
@@ -3887,52 +4441,83 @@ uint32 CUDPDriver::Thread_Listen()
 			continue;
 		}
 
-		if (cIncomingPacket.Peekuint32() == UNCONNECTED_DATA_TOKEN)
-		{
-			// Parse the unconnected data packet
-			HandleUnconnectedData(cIncomingPacket, &senderAddr);
-		}
-		else 
+		// Handle the connected packets under one lock, and send any responses together
+		uint32 aUnconnected[k_nMaxIOBatchSize];
+		uint32 nNumUnconnected = 0;
 		{
 			CSAccess cConnProtect(&m_cCS_Connections);
+			OpenSendBatch();
 
-			// Look up the sender
-			CUDPConn *pConn = FindConnByAddr(&senderAddr);
-
-			if (pConn)
+			for (uint32 nCurPacket = 0; nCurPacket < nNumReceived; ++nCurPacket)
 			{
-				// Handle the packet
-				CUDPConn::EIncomingPacketResult eResult;
-				eResult = pConn->HandleIncomingPacket(cIncomingPacket);
-				if (eResult == CUDPConn::eIPR_Disconnect)
-				{
-					// Handle a disconnection the next time we update
-					CDisconnectRequest cRequest;
-					cRequest.m_pConnection = pConn;
-					cRequest.m_eReason = pConn->GetLastDisconnectReason( );
-
-					CSAccess cDisconnectProtect(&m_cCS_DisconnectQueue);
-					LT_MEM_TRACK_ALLOC(m_cDisconnectQueue.push_back(cRequest), LT_MEM_TYPE_NETWORKING);
-				}
-				else
+				// Unconnected data gets handled once the lock's released
+				if (aIncomingPackets[nCurPacket].Peekuint32() == UNCONNECTED_DATA_TOKEN)
 				{
-					// Give them an update, just to keep things running as smoothly as possible
-					pConn->Update(false);
+					aUnconnected[nNumUnconnected++] = nCurPacket;
+					continue;
 				}
+
+				HandleIncomingDatagram(aIncomingPackets[nCurPacket], &aSenderAddrs[nCurPacket]);
+				// Don't hang on to the packet data until the next batch
+				aIncomingPackets[nCurPacket] = CPacket_Read();
 			}
-			else
-			{
-				CUnknownMessage cMsg;
-				cMsg.m_cPacket = cIncomingPacket;
-				cMsg.m_cSender = senderAddr;
-				// Handle an unknown message the next time we update
-				CSAccess cUnknownMessageProtect(&m_cCS_UnknownMessages);
-				LT_MEM_TRACK_ALLOC(m_cUnknownMessages.push_back(cMsg), LT_MEM_TYPE_NETWORKING);
-			}
+
+			m_bSendBatchOpen = false;
+			FlushSendBatch();
+
+			if (m_bThreadedIO)
+				ServiceThreadedIO();
+		}
+
+		// Queries and connection requests take their own locks, and reply without the send batch
+		for (uint32 nCurUnconnected = 0; nCurUnconnected < nNumUnconnected; ++nCurUnconnected)
+		{
+			uint32 nCurPacket = aUnconnected[nCurUnconnected];
+			HandleUnconnectedData(aIncomingPackets[nCurPacket], &aSenderAddrs[nCurPacket]);
+			aIncomingPackets[nCurPacket] = CPacket_Read();
 		}
 	}
 
 	return nResult;
 }
 
+void CUDPDriver::HandleIncomingDatagram(CPacket_Read &cPacket, sockaddr_in *pSender)
+{
+	// Look up the sender
+	CUDPConn *pConn = FindConnByAddr(pSender);
 
+	if (pConn)
+	{
+		// Handle the packet
+		CUDPConn::EIncomingPacketResult eResult;
+		eResult = pConn->HandleIncomingPacket(cPacket);
+		if (eResult == CUDPConn::eIPR_Disconnect)
+		{
+			// Handle a disconnection the next time we update
+			CDisconnectRequest cRequest;
+			cRequest.m_pConnection = pConn;
+			cRequest.m_eReason = pConn->GetLastDisconnectReason( );
+
+			CSAccess cDisconnectProtect(&m_cCS_DisconnectQueue);
+			LT_MEM_TRACK_ALLOC(m_cDisconnectQueue.push_back(cRequest), LT_MEM_TYPE_NETWORKING);
+		}
+		else
+		{
+			// Give them an update, just to keep things running as smoothly as possible
+			pConn->Update(false);
+
+			// Hand off anything it finished receiving
+			if (m_bThreadedIO)
+				DrainIncoming(pConn);
+		}
+	}
+	else
+	{
+		CUnknownMessage cMsg;
+		cMsg.m_cPacket = cPacket;
+		cMsg.m_cSender = *pSender;
+		// Handle an unknown message the next time we update
+		CSAccess cUnknownMessageProtect(&m_cCS_UnknownMessages);
+		LT_MEM_TRACK_ALLOC(m_cUnknownMessages.push_back(cMsg), LT_MEM_TYPE_NETWORKING);
+	}
+}
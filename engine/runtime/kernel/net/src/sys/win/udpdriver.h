@@ -23,8 +23,11 @@
 
 #include "listqueue.h"
 #include "staticfifo.h"
+#include "spscring.h"
+#include <atomic>
 #include <deque>
 #include <map>
+#include <vector>
 
 #define MAX_UDP_QUERY_TIMES 32
 #define BROADCAST_QUERYNUM  0xFF
@@ -157,6 +160,11 @@ public:
 	virtual uint32		GetIncomingBandwidthUsage() const;
 	virtual uint32		GetTransportOverhead() const;
 	virtual float		GetPacketLoss() const;
+	virtual uint32		GetGuaranteedQueueDepth() const { return m_nOutgoingGCount + m_nGuaranteedWaiting; }
+	virtual uint32		GetNumGuaranteedPauses() const { return m_nGuaranteedPauses; }
+	virtual uint32		GetNumRecoveredFrames() const { return m_nRecoveredFrames; }
+	virtual uint32		GetTotalRecoveryTime() const { return m_nTotalRecoveryTime; }
+	virtual uint32		GetMaxRecoveryTime() const { return m_nMaxRecoveryTime; }
 	
 	virtual float GetPing() { return m_fReportedPing; }
 
@@ -196,9 +204,14 @@ private:
 		uint32 m_nFrameCode;
 		uint32 m_nFrameSize;
 		uint32 m_nFirstSent, m_nLastSent;
+		// When to re-send it if it hasn't been ACK'ed
+		uint32 m_nResendTime;
 		bool m_bReceivedOO;
 		bool m_bContinued;
+		// Number of times it's been re-sent
 		uint32 m_nSendCount;
+		// Frames sent after this one which were ACK'ed since it was last sent
+		uint32 m_nLaterACKs;
 		CPacketQueue m_cPackets;
 	};
 
@@ -212,25 +225,21 @@ private:
 		k_nHeartbeatDelay = 17, // Wait for at least this many ms between heartbeats
 		k_nPingDelay = 200, // Wait at least this long between ping requests
 		k_nPingHistorySize = 16, // Number of pings to average
-		k_nPingNAKMultiplier = 1, // Wait Ping * this number of ms before re-sending packets
-		k_nPingFirstNAKMultiplier = 1, // Wait Ping * this number of ms extra before re-sending packets the first time
-		k_nMaxPingNAKTime = 1000, // Don't wait longer than this to send a NAK
+		k_nMaxPingNAKTime = 1000, // Don't wait longer than this for a heartbeat response
+		k_nMinResendTime = 50, // Don't re-send a frame sooner than this
+		k_nMaxResendTime = 2000, // Don't wait longer than this to re-send a frame
+		k_nMaxResendBackoff = 4, // The re-send time doubles for each re-send, up to 2^this times
+		k_nBackedUpSendCount = 10, // If the oldest frame has been re-sent this many times, the connection is backed up
 		k_nTroubleDelay = 120000, // After 2 minutes, consider the connection in trouble
-		k_nNAKFlushTroubleDelay = 120000, // After 2 minutes of trying to flush, it's in trouble
-		k_nGuaranteedBlockCount = 2, // If we've retried a packet in the queue more times than this, 
-									 // stop sending guaranteed packets for a while
-		k_nGuaranteedTrickleCount = 10, // If we've incremented our resend count this many times, resend only the first frame
-		k_nGuaranteedOverflowCount = 8, // If we get more messages than this in our NAK queue, pause
 		k_nFingerprintBits = 8, // Number of bits in the fingerprint
 		k_nUDPPacketOverhead = 28 * 8, // UDP packet overhead
 		k_nStartPing = 200, // Initial ping value, for handling lost initial packets
-		k_nMaxOutOfOrderPackets = 8, // Maximum number of out of order packets to track
-		k_nFlowControlPeriod = 200, // Flow control operates at this resolution
-		k_nFlowControlMinPeriod = 17, // Don't allow sub-period flow control updates smaller than this
+		k_nMaxOutOfOrderPackets = 32, // Maximum number of out of order packets to track (also the send window)
+		k_nFastResendACKs = 3, // Re-send a frame early once this many later frames have been ACK'ed
+		k_nFlowControlBurstTime = 100, // The flow control bucket holds this many ms worth of bandwidth
 		k_nBandwidthUsageTarget = 90, // Try to target using this much of our bandwidth
 		k_nUnguaranteedDropDelay = 2, // Don't hang on to unguaranteed data longer than ping * this number
 		k_nDisconnectSleep = 100, // How long to wait after each disconnect message to avoid blocking the outgoing pipe
-		k_nTrickleNAKDelay = 500, // Wait at least this long between NAKs while trickling
 	};
 
 	// Internal UDP commands
@@ -271,8 +280,17 @@ private:
 
 	// Add a ping to the ping history
 	void AddPing(uint32 nTime);
+	// Add a round-trip sample to the re-send timer
+	void AddRTTSample(uint32 nTime);
+	// How long to wait before re-sending a frame that's been re-sent nSendCount times
+	uint32 GetResendTime(uint32 nSendCount) const;
+	// A frame has been ACK'ed
+	void OnFrameACKed(const CPacketFrame &cFrame, uint32 nCurTime);
 
-	// Re-send packets which never got ACK'ed
+	// Would sending another frame go past what the other end can hold on to?
+	bool IsGuaranteedWindowFull() const;
+
+	// Re-send packets which never got ACK'ed in time
 	void ReSendLostPackets();
 	void ReSendFrame(CPacketFrame &cFrame);
 
@@ -302,6 +320,12 @@ private:
 	LCriticalSection m_cUpdateCS;
 
 	bool m_bPauseGuaranteed;
+	// Frames waiting for an ACK as of the last ReSendLostPackets
+	uint32 m_nGuaranteedWaiting;
+	uint32 m_nGuaranteedPauses;
+	// Frames which were re-sent before they got through
+	uint32 m_nRecoveredFrames;
+	uint32 m_nTotalRecoveryTime, m_nMaxRecoveryTime;
 	CPacketQueue m_cOutgoingGuaranteedQueue;
 	uint32 m_nOutgoingGCount;
 	uint32 m_nOutgoingGSize;
@@ -336,9 +360,12 @@ private:
 	bool m_bWaitingForPingResponse;
 	uint32 m_nLastPingTimeStamp;
 
-	// NAK flushing...
-	bool m_bFlushingNAKs;
-	uint32 m_nNAKFlushStartTime;
+	// Re-send timer (RFC 6298 style smoothed round-trip time and variance, in ms)
+	float m_fSmoothedRTT, m_fRTTVariance;
+	bool m_bHaveRTTSample;
+
+	// Loss simulation state
+	bool m_bSimulatedLossBurst;
 
 	// Bandwidth tracking
 	uint32 m_nBandwidth, m_nReportedBandwidth, m_nMaxBandwidth;
@@ -392,16 +419,16 @@ private:
 
 	void SaveOutOfOrderPacket(CPacket_Read &cPacket, uint32 nFrameCode);
 
-	// Per-frame flow control
+	// Token bucket flow control.  The bucket fills at m_nBandwidth and holds
+	// k_nFlowControlBurstTime worth of it, and sending a packet takes its size out.
 	void ResetFlowControl();
 	void UpdateOutgoingFlowControl(uint32 nPacketSize, uint32 nCurTime);
 	bool IsFlowControlBlocked(uint32 nPacketSize) const;
 
 	bool m_bFlowControlInitialized;
-	uint32 m_nFlowControlLastPeriodSent;
-	uint32 m_nFlowControlCurPeriodSent;
-	uint32 m_nFlowControlPeriodTime;
-	uint32 m_nFlowControlBitsPerPeriod;
+	uint32 m_nFlowControlTokens;
+	uint32 m_nFlowControlBucketSize;
+	uint32 m_nFlowControlFillTime;
 
 	// Stores the disconnect reason if told to disconnect.
 	EDisconnectReason m_eLastDisconnectReason;
@@ -513,6 +540,32 @@ const SUDPError g_UDPErrorStrings[] =
 
 const uint32 NUM_UDPERRORSTRINGS = sizeof(g_UDPErrorStrings) / sizeof(g_UDPErrorStrings[0]);
 
+// Socket I/O counters.  The listen thread counts receives without holding any
+// locks, so these are bumped atomically and copied out on request.
+struct CUDPIOCounters
+{
+	CUDPIOCounters() { Clear(); }
+	void Clear()
+	{
+		m_nRecvCalls = 0;
+		m_nRecvDatagrams = 0;
+		m_nSendCalls = 0;
+		m_nSendDatagrams = 0;
+	}
+	void Get(NetDriverIOStats *pStats) const
+	{
+		pStats->m_nRecvCalls = m_nRecvCalls.load(std::memory_order_relaxed);
+		pStats->m_nRecvDatagrams = m_nRecvDatagrams.load(std::memory_order_relaxed);
+		pStats->m_nSendCalls = m_nSendCalls.load(std::memory_order_relaxed);
+		pStats->m_nSendDatagrams = m_nSendDatagrams.load(std::memory_order_relaxed);
+	}
+
+	std::atomic<uint32>	m_nRecvCalls;
+	std::atomic<uint32>	m_nRecvDatagrams;
+	std::atomic<uint32>	m_nSendCalls;
+	std::atomic<uint32>	m_nSendDatagrams;
+};
+
 class CUDPDriver : public CBaseDriver 
 {
 public:
@@ -527,6 +580,8 @@ public:
 
     
     static bool SendTo(SOCKET theSocket, const CPacket_Read &cPacket, sockaddr_in *pSendTo);
+    // Send a connection's packet.  Deferred to the outgoing batch while one is open.
+    bool SendConnPacket(SOCKET theSocket, const CPacket_Read &cPacket, sockaddr_in *pSendTo);
     CUDPConn *FindConnByAddr(sockaddr_in *pAddr);
 
 
@@ -590,6 +645,11 @@ public:
 	virtual LTRESULT OpenSocket( SOCKET* phSocket );
 
 	virtual void UpdateGUID(LTGUID &cGUID);
+
+	virtual void SetAnyClientPort(bool bAnyClientPort) { m_bAnyClientPort = bAnyClientPort; }
+
+	virtual bool GetIOStats(NetDriverIOStats *pStats);
+	virtual void ResetIOStats();
 	
 	enum {
 		UNCONNECTED_DATA_TOKEN = 0x9919D9C7, // Packet identifier for unconnected communication
@@ -618,6 +678,10 @@ protected:
 	enum {
 		k_nReconnection_Delay = 10000, // Re-connection lockout delay, in ms
 		k_nListenThread_Timeout = 30000, // Time-out on the listen thread, in ms
+		k_nMaxIOBatchSize = 32, // Maximum number of datagrams per batched send/receive call
+		k_nThreadedIO_Period = 5, // Longest the listen thread waits on the sockets in threaded I/O mode, in ms (it's woken for new packets)
+		k_nThreadedIO_RingSize = 4096, // Packet ring size in threaded I/O mode (must be a power of two)
+		k_nThreadedIO_MaxBacklog = 16384, // Most outgoing packets held back while the packet ring is full
 	};
 	
 private:
@@ -654,6 +718,80 @@ private:
 
 private:
 
+	// Route a connected datagram from the listen thread to its connection.
+	// The caller holds m_cCS_Connections.
+	void HandleIncomingDatagram(CPacket_Read &cPacket, sockaddr_in *pSender);
+
+	// Outgoing datagram batching.  Connection updates performed between
+	// opening and flushing the batch are sent with as few syscalls as possible.
+	void OpenSendBatch();
+	void FlushSendBatch();
+
+	struct CBatchedDatagram
+	{
+		SOCKET m_Socket;
+		sockaddr_in m_cAddr;
+		uint32 m_nOffset;
+		uint32 m_nSize;
+	};
+
+	bool m_bSendBatchOpen;
+	std::vector<CBatchedDatagram> m_aSendBatch;
+	std::vector<uint8> m_aSendBatchData;
+
+	// OpenSocket binds to port 0 instead of the IPClientPort range
+	bool m_bAnyClientPort;
+
+	// Threaded I/O mode.  The listen thread also performs the per-frame connection
+	// updates, and packets are handed between it and the game thread through
+	// single-producer/single-consumer rings instead of under m_cCS_Connections.
+	// Connections are only ever disconnected from the game thread in this mode, and
+	// are deleted by the listen thread once it has seen all of their outgoing packets.
+	struct CIncomingEntry
+	{
+		CIncomingEntry() : m_pConn(0) {}
+		CPacket_Read m_cPacket;
+		CUDPConn *m_pConn;
+	};
+	struct COutgoingEntry
+	{
+		COutgoingEntry() : m_pConn(0), m_bGuaranteed(false), m_bRelease(false) {}
+		CPacket_Read m_cPacket;
+		CUDPConn *m_pConn;
+		bool m_bGuaranteed;
+		bool m_bRelease; // Delete the connection instead of sending
+	};
+
+	bool m_bThreadedIO;
+	std::atomic<bool> m_bFrameUpdatePending;
+	// Loopback socket the game thread pokes so the listen thread doesn't sleep on new work
+	SOCKET m_WakeSocket;
+	sockaddr_in m_WakeAddr;
+	std::atomic<bool> m_bWakePending;
+	// Listen thread -> game thread
+	CSPSCRing<CIncomingEntry, k_nThreadedIO_RingSize> m_cIncomingRing;
+	// Packets pulled off the incoming ring while disconnecting (game thread only)
+	std::deque<CIncomingEntry> m_cIncomingBacklog;
+	// Game thread -> listen thread
+	CSPSCRing<COutgoingEntry, k_nThreadedIO_RingSize> m_cOutgoingRing;
+	// Entries which didn't fit in the outgoing ring yet (game thread only)
+	std::deque<COutgoingEntry> m_cOutgoingBacklog;
+	// A connection still has packets which didn't fit in the incoming ring (listen thread only)
+	bool m_bIncomingRingFull;
+
+	// Game thread side.  These never block, so they're safe to call with m_cCS_Connections held.
+	bool PushOutgoing(const COutgoingEntry &cEntry);
+	void FlushOutgoingBacklog();
+	void ReleaseConnection(CUDPConn *pConn);
+	void WakeListenThread();
+	// Listen thread side.  Must be called with m_cCS_Connections held.
+	void ServiceThreadedIO();
+	void ServiceOutgoingRing(bool bSend);
+	void DrainIncoming(CUDPConn *pConn);
+
+	// Socket I/O counters
+	CUDPIOCounters m_cIOStats;
+
 	void FlushInternalQueues();
 
 	// Unknown message queue
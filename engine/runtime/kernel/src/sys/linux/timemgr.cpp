@@ -2,6 +2,8 @@
 #include "timemgr.h"
 #include <sys/time.h>
 #include <unistd.h>
+#include <time.h>
+#include <errno.h>
 
 float time_GetTime()
 {
@@ -25,3 +27,22 @@ uint32 timeGetTime()
 	gettimeofday(&curTimeval, NULL);
 	return (curTimeval.tv_sec * 1000) + (curTimeval.tv_usec / 1000);
 }
+
+uint64 time_GetNSTime()
+{
+	timespec curTimespec;
+	clock_gettime(CLOCK_MONOTONIC, &curTimespec);
+	return ((uint64)curTimespec.tv_sec * 1000000000) + (uint64)curTimespec.tv_nsec;
+}
+
+void time_SleepUntilNS(uint64 nDeadline)
+{
+	timespec deadlineTimespec;
+	deadlineTimespec.tv_sec = (time_t)(nDeadline / 1000000000);
+	deadlineTimespec.tv_nsec = (long)(nDeadline % 1000000000);
+
+	// Absolute deadline, so getting interrupted doesn't add up to oversleeping
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadlineTimespec, NULL) == EINTR)
+	{
+	}
+}
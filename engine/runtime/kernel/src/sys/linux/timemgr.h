@@ -11,5 +11,8 @@ float	time_GetTime(); // returns time in seconds as a floating point number
 uint32  timeGetTime(); // returns time in milliseconds
 #define time_GetMSTime timeGetTime
 
+uint64	time_GetNSTime(); // returns monotonic time in nanoseconds
+void	time_SleepUntilNS(uint64 nDeadline); // sleeps until time_GetNSTime() reaches nDeadline
+
 #endif  // __TIMEMGR_H__
 
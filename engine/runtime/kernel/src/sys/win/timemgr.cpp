@@ -51,6 +51,40 @@ uint32 time_GetMSTime()
 	return (timeGetTime() - g_TimeBase);
 }
 
+uint64 time_GetNSTime()
+{
+	static LARGE_INTEGER s_Frequency = { 0 };
+	if (!s_Frequency.QuadPart)
+		QueryPerformanceFrequency(&s_Frequency);
+
+	LARGE_INTEGER nCount;
+	QueryPerformanceCounter(&nCount);
+
+	// Split it up so the multiply doesn't overflow
+	uint64 nSeconds = (uint64)(nCount.QuadPart / s_Frequency.QuadPart);
+	uint64 nRemainder = (uint64)(nCount.QuadPart % s_Frequency.QuadPart);
+	return (nSeconds * 1000000000) + (nRemainder * 1000000000 / (uint64)s_Frequency.QuadPart);
+}
+
+void time_SleepUntilNS(uint64 nDeadline)
+{
+	for (;;)
+	{
+		uint64 nCurTime = time_GetNSTime();
+		if (nCurTime >= nDeadline)
+			return;
+
+		// Sleep() can run up to a millisecond over even with timeBeginPeriod(1), so
+		// only use it while there's plenty of time left, and just give up the rest
+		// of the timeslice near the end.
+		uint64 nTimeLeftMS = (nDeadline - nCurTime) / 1000000;
+		if (nTimeLeftMS >= 2)
+			Sleep((DWORD)(nTimeLeftMS - 1));
+		else
+			Sleep(0);
+	}
+}
+
 
 
 
@@ -8,6 +8,11 @@
 float	time_GetTime();
 uint32	time_GetMSTime();
 
+// Monotonic high resolution time in nanoseconds
+uint64	time_GetNSTime();
+// Sleep until time_GetNSTime() reaches nDeadline
+void	time_SleepUntilNS(uint64 nDeadline);
+
 
 #endif  // __TIMEMGR_H__
 
@@ -290,6 +290,8 @@ AnimNode::AnimNode()
 {
 	m_pPosChannel = NULL ;
 	m_pQuatChannel = NULL ;
+	m_nPosFormat = ANIMCHANNEL_NONE ;
+	m_nQuatFormat = ANIMCHANNEL_NONE ;
 	m_pVertexChannel = NULL ;
 }
 
@@ -303,9 +305,11 @@ void AnimNode::Term()
 {
 	m_pPosChannel	= NULL;
 	m_pPosData		= NULL;
+	m_nPosFormat	= ANIMCHANNEL_NONE;
 
 	m_pQuatChannel	= NULL;
 	m_pQuatData		= NULL;
+	m_nQuatFormat	= ANIMCHANNEL_NONE;
 
 	if( m_pVertexChannel )
 	{
@@ -197,11 +197,26 @@ private :
 // associated with the animation these channels belong to.
 // All these classes are private, viewable only by animnode.
 // ------------------------------------------------------------------------
+
+// How a channel's data is stored, so AnimNode::DecodeData can read it
+// without calling through the interpreter.
+#define ANIMCHANNEL_NONE		0	// No data, the channel's default value
+#define ANIMCHANNEL_FULL		1	// A float value per keyframe
+#define ANIMCHANNEL_SINGLE		2	// One float value for every keyframe
+#define ANIMCHANNEL_16			3	// A 16 bit value per keyframe
+#define ANIMCHANNEL_SINGLE16	4	// One 16 bit value for every keyframe
+
+// Scale for 16 bit positions (1.11.4 fixed point)
+#define ANIMCHANNEL_POS16_SCALE		(1.0f/16.0f)
+// Scale for 16 bit quaternion components, which map the int16 range onto -1 to 1
+#define ANIMCHANNEL_QUAT16_SCALE	(1.0f/float(0x7fff))
+
 class IAnimPosChannel
 {
 public:
 	virtual ~IAnimPosChannel() {}
 
+	virtual uint32 GetFormat() const = 0;
 	virtual uint32 GetDataSize() const = 0;
 	virtual void GetData(const uint8* pData, uint32 index, LTVector& vPos ) const = 0;
 };
@@ -211,6 +226,7 @@ class IAnimQuatChannel
 public:
 	virtual ~IAnimQuatChannel() {}
 
+	virtual uint32 GetFormat() const = 0;
 	virtual uint32 GetDataSize() const = 0;
 	virtual void GetData(const uint8* pData, uint32 index, LTRotation& rRot ) const = 0;
 };
@@ -225,6 +241,8 @@ public:
 
 	static const IAnimPosChannel*	GetSingleton();
 
+	virtual uint32 GetFormat() const	{ return ANIMCHANNEL_NONE; }
+
 	virtual uint32 GetDataSize() const	{ return 0; }
 
     virtual void GetData(const uint8* pData, uint32 index, LTVector& vPos ) const
@@ -239,6 +257,8 @@ public:
 
 	static const IAnimQuatChannel*	GetSingleton();
 
+	virtual uint32 GetFormat() const	{ return ANIMCHANNEL_NONE; }
+
 	virtual uint32 GetDataSize() const	{ return 0;	}
 
     virtual void GetData(const uint8* pData, uint32 index, LTRotation& rRot ) const
@@ -256,6 +276,8 @@ public:
 
 	static const IAnimPosChannel*	GetSingleton();
 
+	virtual uint32 GetFormat() const	{ return ANIMCHANNEL_FULL; }
+
 	virtual uint32 GetDataSize() const	{ return sizeof(LTVector);	}
 
     virtual void GetData(const uint8* pData, uint32 index, LTVector& vPos ) const
@@ -270,6 +292,8 @@ public:
 
 	static const IAnimPosChannel*	GetSingleton();
 
+	virtual uint32 GetFormat() const	{ return ANIMCHANNEL_SINGLE; }
+
     virtual void GetData(const uint8* pData, uint32 index, LTVector& vPos ) const
 	{
 		POSChannel::GetData(pData, 0, vPos);
@@ -282,6 +306,8 @@ public:
 
 	static const IAnimQuatChannel*	GetSingleton();
 
+	virtual uint32 GetFormat() const	{ return ANIMCHANNEL_FULL; }
+
 	virtual uint32 GetDataSize() const	{ return sizeof(LTRotation);	}
 
     virtual void GetData(const uint8* pData, uint32 index, LTRotation& rRot) const
@@ -296,6 +322,8 @@ public:
 
 	static const IAnimQuatChannel*	GetSingleton();
 
+	virtual uint32 GetFormat() const	{ return ANIMCHANNEL_SINGLE; }
+
     virtual void GetData(const uint8* pData, uint32 index, LTRotation& rRot ) const
 	{
 		QUATChannel::GetData(pData, 0, rRot);
@@ -311,11 +339,13 @@ public:
 
 	static const IAnimPosChannel*	GetSingleton();
 
+	virtual uint32 GetFormat() const	{ return ANIMCHANNEL_16; }
+
 	virtual uint32 GetDataSize() const	{ return sizeof(int16) * 3; }
 
     virtual void GetData(const uint8* pData, uint32 index, LTVector& vPos ) const
     {
-        const float  kScale_1_11_4 = 	(1.0f/16.0f);
+        const float  kScale_1_11_4 = 	ANIMCHANNEL_POS16_SCALE;
 
         const int16 *in_vec = (const int16*)(pData + index * sizeof(int16) * 3);
 
@@ -331,6 +361,8 @@ public:
 
 	static const IAnimPosChannel*	GetSingleton();
 
+	virtual uint32 GetFormat() const	{ return ANIMCHANNEL_SINGLE16; }
+
     virtual void GetData(const uint8* pData, uint32 index, LTVector& vPos ) const
 	{
 		POS16Channel::GetData(pData, 0, vPos);
@@ -344,11 +376,13 @@ public:
 
 	static const IAnimQuatChannel*	GetSingleton();
 
+	virtual uint32 GetFormat() const	{ return ANIMCHANNEL_16; }
+
 	virtual uint32 GetDataSize() const	{ return sizeof(int16) * 4; }
 
     virtual void GetData(const uint8* pData, uint32 index, LTRotation& rRot) const
     {
-		const float inv_dec = 1.0f / float(0x7fff);
+		const float inv_dec = ANIMCHANNEL_QUAT16_SCALE;
 
         const int16 *in_vec = (const int16*)(pData + index * sizeof(int16) * 4);
 
@@ -365,6 +399,8 @@ public:
 
 	static const IAnimQuatChannel*	GetSingleton();
 
+	virtual uint32 GetFormat() const	{ return ANIMCHANNEL_SINGLE16; }
+
     virtual void GetData(const uint8* pData, uint32 index, LTRotation& rRot ) const
 	{
 		QUAT16Channel::GetData(pData, 0, rRot);
@@ -414,6 +450,60 @@ public:
 		m_pQuatChannel->GetData(m_pQuatData, frame, rot);
 	}
 
+	// Same as GetData, but reads the data directly based on the channel
+	// formats instead of calling the interpreters.
+	void DecodeData(uint32 frame, LTVector & pos , LTRotation & rot ) const
+	{
+		switch(m_nPosFormat)
+		{
+			case ANIMCHANNEL_FULL :
+				memcpy(&pos, m_pPosData + sizeof(LTVector) * frame, sizeof(LTVector));
+				break;
+			case ANIMCHANNEL_SINGLE :
+				memcpy(&pos, m_pPosData, sizeof(LTVector));
+				break;
+			case ANIMCHANNEL_16 :
+			case ANIMCHANNEL_SINGLE16 :
+			{
+				const int16 *in_vec = (const int16*)m_pPosData;
+				if(m_nPosFormat == ANIMCHANNEL_16)
+					in_vec += frame * 3;
+				pos.x = float(in_vec[0]) * ANIMCHANNEL_POS16_SCALE;
+				pos.y = float(in_vec[1]) * ANIMCHANNEL_POS16_SCALE;
+				pos.z = float(in_vec[2]) * ANIMCHANNEL_POS16_SCALE;
+				break;
+			}
+			default :
+				pos.Init();
+				break;
+		}
+
+		switch(m_nQuatFormat)
+		{
+			case ANIMCHANNEL_FULL :
+				memcpy(&rot, m_pQuatData + sizeof(LTRotation) * frame, sizeof(LTRotation));
+				break;
+			case ANIMCHANNEL_SINGLE :
+				memcpy(&rot, m_pQuatData, sizeof(LTRotation));
+				break;
+			case ANIMCHANNEL_16 :
+			case ANIMCHANNEL_SINGLE16 :
+			{
+				const int16 *in_vec = (const int16*)m_pQuatData;
+				if(m_nQuatFormat == ANIMCHANNEL_16)
+					in_vec += frame * 4;
+				rot.m_Quat[0] = float(in_vec[0]) * ANIMCHANNEL_QUAT16_SCALE;
+				rot.m_Quat[1] = float(in_vec[1]) * ANIMCHANNEL_QUAT16_SCALE;
+				rot.m_Quat[2] = float(in_vec[2]) * ANIMCHANNEL_QUAT16_SCALE;
+				rot.m_Quat[3] = float(in_vec[3]) * ANIMCHANNEL_QUAT16_SCALE;
+				break;
+			}
+			default :
+				rot.Init();
+				break;
+		}
+	}
+
 //internal utility functions
 private:
 
@@ -425,6 +515,9 @@ private:
 	const IAnimQuatChannel	*m_pQuatChannel;
 	const uint8				*m_pPosData;
 	const uint8				*m_pQuatData;
+	// ANIMCHANNEL_ formats of the channels
+	uint8					m_nPosFormat;
+	uint8					m_nQuatFormat;
 	CDefVertexLst			*m_pVertexChannel ;
 
 };
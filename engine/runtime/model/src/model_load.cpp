@@ -173,6 +173,7 @@ void AnimNode::SetupPosChannel(const IAnimPosChannel* pInterpreter, ILTStream& f
 {
 	assert(pInterpreter);
 	m_pPosChannel = pInterpreter;
+	m_nPosFormat = (uint8)pInterpreter->GetFormat();
 
 	uint32 nDataSize = nElements * pInterpreter->GetDataSize();
 
@@ -196,6 +197,7 @@ void AnimNode::SetupQuatChannel(const IAnimQuatChannel* pInterpreter, ILTStream&
 {
 	assert(pInterpreter);
 	m_pQuatChannel = pInterpreter;
+	m_nQuatFormat = (uint8)pInterpreter->GetFormat();
 
 	uint32 nDataSize = nElements * pInterpreter->GetDataSize();
 
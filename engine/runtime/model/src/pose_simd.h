@@ -0,0 +1,286 @@
+// ----------------------------------------------------------------
+// Structure of arrays pose kernels for TransformMaker.
+//
+// A pose keeps each component of its nodes' positions and rotations in its
+// own array, so the blends and the matrix conversion work on four nodes at a
+// time.  The math is done in the same order as LTRotation::Slerp, the LTVector
+// lerps and LTRotation::ConvertToMatrix, so the results are the same as doing
+// the nodes one at a time.
+// ----------------------------------------------------------------
+
+#ifndef __POSE_SIMD_H__
+#define __POSE_SIMD_H__
+
+#ifndef __LTBASEDEFS_H__
+#include "ltbasedefs.h"
+#endif
+
+
+//The SSE kernels are picked at compile time:  x64 and /arch:SSE2 builds get
+//them, and an /arch:IA32 build gets the scalar loops, which give the same
+//poses.  (phys_simd.h picks at run time instead.)
+#if defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define LT_POSE_SSE
+#endif
+
+#ifdef LT_POSE_SSE
+#include <emmintrin.h>
+#endif
+
+// Number of nodes the kernels work on at once.  Pose arrays are padded out to
+// a multiple of this.
+#define POSE_SIMD_WIDTH		4
+
+// Floats a pose needs per node
+#define POSE_SOA_FLOATS		7
+
+inline uint32 PoseSoAStride(uint32 nNodes)
+{
+	return (nNodes + (POSE_SIMD_WIDTH - 1)) & ~(POSE_SIMD_WIDTH - 1);
+}
+
+
+// ------------------------------------------------------------------------
+// SPoseSoA
+// Positions and rotations of a list of nodes, one array per component.
+// ------------------------------------------------------------------------
+struct SPoseSoA
+{
+	float	*m_pPos[3];
+	float	*m_pQuat[4];
+
+	// Point the arrays at pData, which holds POSE_SOA_FLOATS * nStride floats
+	// and is 16 byte aligned.  nStride comes from PoseSoAStride.
+	void Init(float *pData, uint32 nStride)
+	{
+		ASSERT(((size_t)pData & 15) == 0);
+		ASSERT((nStride % POSE_SIMD_WIDTH) == 0);
+
+		for(uint32 i=0; i < 3; i++)
+			m_pPos[i] = &pData[i * nStride];
+		for(uint32 i=0; i < 4; i++)
+			m_pQuat[i] = &pData[(3 + i) * nStride];
+	}
+
+	void Get(uint32 i, LTVector &vPos, LTRotation &rRot) const
+	{
+		vPos.x = m_pPos[0][i];
+		vPos.y = m_pPos[1][i];
+		vPos.z = m_pPos[2][i];
+		rRot.m_Quat[0] = m_pQuat[0][i];
+		rRot.m_Quat[1] = m_pQuat[1][i];
+		rRot.m_Quat[2] = m_pQuat[2][i];
+		rRot.m_Quat[3] = m_pQuat[3][i];
+	}
+
+	void Set(uint32 i, const LTVector &vPos, const LTRotation &rRot)
+	{
+		m_pPos[0][i] = vPos.x;
+		m_pPos[1][i] = vPos.y;
+		m_pPos[2][i] = vPos.z;
+		m_pQuat[0][i] = rRot.m_Quat[0];
+		m_pQuat[1][i] = rRot.m_Quat[1];
+		m_pQuat[2][i] = rRot.m_Quat[2];
+		m_pQuat[3][i] = rRot.m_Quat[3];
+	}
+
+	// Fill entries nNodes through the end of the stride with the identity, so
+	// the kernels never see garbage in the padding.
+	void ClearPadding(uint32 nNodes)
+	{
+		LTVector vZero(0.0f, 0.0f, 0.0f);
+		LTRotation rIdentity(0.0f, 0.0f, 0.0f, 1.0f);
+		for(uint32 i = nNodes; i < PoseSoAStride(nNodes); i++)
+			Set(i, vZero, rIdentity);
+	}
+};
+
+
+// ------------------------------------------------------------------------
+// The slerp coefficients for one node, given the (sign adjusted) cosine.
+// This is the scalar part of quat_Slerp.
+// ------------------------------------------------------------------------
+inline void PoseSlerpCoeffs(float fCosom, float fT, float &fScale0, float &fScale1)
+{
+	if((1.0f - fCosom) > 0.0001f)
+	{
+		float fOmega = ltacosf(fCosom);
+		float fOOSinom = 1.0f / ltsinf(fOmega);
+		fScale0 = ltsinf((1.f - fT) * fOmega) * fOOSinom;
+		fScale1 = ltsinf(fT * fOmega) * fOOSinom;
+	}
+	else
+	{
+		fScale0 = 1.0f - fT;
+		fScale1 = fT;
+	}
+}
+
+
+// ------------------------------------------------------------------------
+// PoseBlend
+// pDest = cFrom blended towards cTo by pT[i] for nodes 0 through nCount.
+// Rotations are slerped, positions lerped.  pDest can be cFrom or cTo.
+// ------------------------------------------------------------------------
+inline void PoseBlend(const SPoseSoA &cFrom, const SPoseSoA &cTo, const float *pT, uint32 nCount, SPoseSoA *pDest)
+{
+	ASSERT(pDest);
+
+#ifdef LT_POSE_SSE
+
+	const __m128 vSignBit = _mm_set1_ps(-0.0f);
+
+	for(uint32 i=0; i < nCount; i += POSE_SIMD_WIDTH)
+	{
+		__m128 q1[4], q2[4];
+		for(uint32 c=0; c < 4; c++)
+		{
+			q1[c] = _mm_load_ps(&cFrom.m_pQuat[c][i]);
+			q2[c] = _mm_load_ps(&cTo.m_pQuat[c][i]);
+		}
+		__m128 vT = _mm_load_ps(&pT[i]);
+
+		// Cosine, and flip the destination to the near side
+		__m128 vCosom = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(q1[0], q2[0]), _mm_mul_ps(q1[1], q2[1])),
+			_mm_mul_ps(q1[2], q2[2])), _mm_mul_ps(q1[3], q2[3]));
+		__m128 vFlip = _mm_and_ps(_mm_cmplt_ps(vCosom, _mm_setzero_ps()), vSignBit);
+		vCosom = _mm_xor_ps(vCosom, vFlip);
+		for(uint32 c=0; c < 4; c++)
+			q2[c] = _mm_xor_ps(q2[c], vFlip);
+
+		// The trig has no SSE version, so the coefficients are done per node
+		float aCosom[POSE_SIMD_WIDTH], aT[POSE_SIMD_WIDTH];
+		float aScale0[POSE_SIMD_WIDTH], aScale1[POSE_SIMD_WIDTH];
+		_mm_storeu_ps(aCosom, vCosom);
+		_mm_storeu_ps(aT, vT);
+		for(uint32 j=0; j < POSE_SIMD_WIDTH; j++)
+			PoseSlerpCoeffs(aCosom[j], aT[j], aScale0[j], aScale1[j]);
+		__m128 vScale0 = _mm_loadu_ps(aScale0);
+		__m128 vScale1 = _mm_loadu_ps(aScale1);
+
+		for(uint32 c=0; c < 4; c++)
+			_mm_store_ps(&pDest->m_pQuat[c][i], _mm_add_ps(_mm_mul_ps(vScale0, q1[c]), _mm_mul_ps(vScale1, q2[c])));
+
+		for(uint32 c=0; c < 3; c++)
+		{
+			__m128 p1 = _mm_load_ps(&cFrom.m_pPos[c][i]);
+			__m128 p2 = _mm_load_ps(&cTo.m_pPos[c][i]);
+			_mm_store_ps(&pDest->m_pPos[c][i], _mm_add_ps(p1, _mm_mul_ps(_mm_sub_ps(p2, p1), vT)));
+		}
+	}
+
+#else
+
+	for(uint32 i=0; i < nCount; i++)
+	{
+		float q1[4], q2[4];
+		for(uint32 c=0; c < 4; c++)
+		{
+			q1[c] = cFrom.m_pQuat[c][i];
+			q2[c] = cTo.m_pQuat[c][i];
+		}
+		float fT = pT[i];
+
+		float fCosom = q1[0]*q2[0] + q1[1]*q2[1] + q1[2]*q2[2] + q1[3]*q2[3];
+		if(fCosom < 0.0f)
+		{
+			fCosom = -fCosom;
+			for(uint32 c=0; c < 4; c++)
+				q2[c] = -q2[c];
+		}
+
+		float fScale0, fScale1;
+		PoseSlerpCoeffs(fCosom, fT, fScale0, fScale1);
+
+		for(uint32 c=0; c < 4; c++)
+			pDest->m_pQuat[c][i] = fScale0 * q1[c] + fScale1 * q2[c];
+
+		for(uint32 c=0; c < 3; c++)
+		{
+			float p1 = cFrom.m_pPos[c][i];
+			float p2 = cTo.m_pPos[c][i];
+			pDest->m_pPos[c][i] = p1 + (p2 - p1) * fT;
+		}
+	}
+
+#endif
+}
+
+
+// ------------------------------------------------------------------------
+// PoseToMatrices
+// Build the matrix for each node in cPose: its rotation, translated by its
+// position.  Node i's matrix goes to pMats[pNodes[i]].
+// ------------------------------------------------------------------------
+inline void PoseToMatrices(const SPoseSoA &cPose, uint32 nCount, const uint32 *pNodes, LTMatrix *pMats)
+{
+#ifdef LT_POSE_SSE
+
+	const __m128 vOne = _mm_set1_ps(1.0f);
+	const __m128 vTwo = _mm_set1_ps(2.0f);
+
+	for(uint32 i=0; i < nCount; i += POSE_SIMD_WIDTH)
+	{
+		__m128 x = _mm_load_ps(&cPose.m_pQuat[0][i]);
+		__m128 y = _mm_load_ps(&cPose.m_pQuat[1][i]);
+		__m128 z = _mm_load_ps(&cPose.m_pQuat[2][i]);
+		__m128 w = _mm_load_ps(&cPose.m_pQuat[3][i]);
+
+		__m128 s = _mm_div_ps(vTwo, _mm_add_ps(_mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)), _mm_mul_ps(w, w)));
+
+		__m128 xs = _mm_mul_ps(x, s);
+		__m128 ys = _mm_mul_ps(y, s);
+		__m128 zs = _mm_mul_ps(z, s);
+
+		__m128 wx = _mm_mul_ps(w, xs);
+		__m128 wy = _mm_mul_ps(w, ys);
+		__m128 wz = _mm_mul_ps(w, zs);
+
+		__m128 xx = _mm_mul_ps(x, xs);
+		__m128 xy = _mm_mul_ps(x, ys);
+		__m128 xz = _mm_mul_ps(x, zs);
+
+		__m128 yy = _mm_mul_ps(y, ys);
+		__m128 yz = _mm_mul_ps(y, zs);
+
+		__m128 zz = _mm_mul_ps(z, zs);
+
+		// Each row is the three rotation entries and the translation, which
+		// a transpose turns into one row per node
+		__m128 aRow0[4] = { _mm_sub_ps(vOne, _mm_add_ps(yy, zz)), _mm_sub_ps(xy, wz), _mm_add_ps(xz, wy), _mm_load_ps(&cPose.m_pPos[0][i]) };
+		__m128 aRow1[4] = { _mm_add_ps(xy, wz), _mm_sub_ps(vOne, _mm_add_ps(xx, zz)), _mm_sub_ps(yz, wx), _mm_load_ps(&cPose.m_pPos[1][i]) };
+		__m128 aRow2[4] = { _mm_sub_ps(xz, wy), _mm_add_ps(yz, wx), _mm_sub_ps(vOne, _mm_add_ps(xx, yy)), _mm_load_ps(&cPose.m_pPos[2][i]) };
+		_MM_TRANSPOSE4_PS(aRow0[0], aRow0[1], aRow0[2], aRow0[3]);
+		_MM_TRANSPOSE4_PS(aRow1[0], aRow1[1], aRow1[2], aRow1[3]);
+		_MM_TRANSPOSE4_PS(aRow2[0], aRow2[1], aRow2[2], aRow2[3]);
+
+		const __m128 vLastRow = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+		uint32 nLanes = LTMIN(nCount - i, (uint32)POSE_SIMD_WIDTH);
+		for(uint32 j=0; j < nLanes; j++)
+		{
+			LTMatrix &mDest = pMats[pNodes[i + j]];
+			_mm_storeu_ps(mDest.m[0], aRow0[j]);
+			_mm_storeu_ps(mDest.m[1], aRow1[j]);
+			_mm_storeu_ps(mDest.m[2], aRow2[j]);
+			_mm_storeu_ps(mDest.m[3], vLastRow);
+		}
+	}
+
+#else
+
+	for(uint32 i=0; i < nCount; i++)
+	{
+		LTRotation rRot(cPose.m_pQuat[0][i], cPose.m_pQuat[1][i], cPose.m_pQuat[2][i], cPose.m_pQuat[3][i]);
+		LTMatrix &mDest = pMats[pNodes[i]];
+		rRot.ConvertToMatrix(mDest);
+		mDest.SetTranslation(cPose.m_pPos[0][i], cPose.m_pPos[1][i], cPose.m_pPos[2][i]);
+	}
+
+#endif
+}
+
+
+#endif
+//EOF
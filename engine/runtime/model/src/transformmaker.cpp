@@ -4,6 +4,8 @@
 #include "bdefs.h"
 #include "transformmaker.h"
 #include "de_objects.h"
+#include "pose_simd.h"
+#include "framearena.h"
 
 #define MAX_MODELPATH_LEN	64
 
@@ -43,9 +45,20 @@ bool TransformMaker::IsValid()
 // ------------------------------------------------------------------------
 bool TransformMaker::SetupTransforms()
 {
+	CFrameArenaMark cArenaMark;
+
 	if(!SetupCall()) 
 		return false;
 
+	// Every node gets evaluated
+	uint32 nNumNodes = m_pModel->NumNodes();
+	uint32 *pNodes = cArenaMark.GetArena().AllocArray<uint32>(nNumNodes);
+	for(uint32 i=0; i < nNumNodes; i++)
+	{
+		pNodes[i] = i;
+	}
+	SampleNodes(pNodes, nNumNodes);
+
 	Recurse(m_pModel->GetRootNode()->GetNodeIndex(), m_pStartMat);
 	return true;
 }
@@ -58,9 +71,17 @@ bool TransformMaker::SetupTransformsWithPath()
 	if( !m_pInstance->ShouldEvaluateNode( iRootNode ) )
 		return true ;
 
+	CFrameArenaMark cArenaMark;
+
 	if(!SetupCall()) 
 		return false ;
 
+	// sample everything on the path up front.
+	uint32 *pNodes = cArenaMark.GetArena().AllocArray<uint32>(m_pModel->NumNodes());
+	uint32 nNodes = 0;
+	GatherPathNodes_R( iRootNode, pNodes, nNodes );
+	SampleNodes( pNodes, nNodes );
+
 	RecurseWithPath( iRootNode, m_pStartMat);
 
 	return true;
@@ -70,6 +91,8 @@ bool TransformMaker::GetNodeTransform(uint32 iNode)
 {
 	uint32 thePath[MAX_MODELPATH_LEN];
 
+	CFrameArenaMark cArenaMark;
+
 	if(!SetupCall())
 		return false;
 
@@ -98,6 +121,8 @@ bool TransformMaker::GetNodeTransform(uint32 iNode)
 	m_iCurPath--;
 	ASSERT(m_pRecursePath[m_iCurPath] == m_pModel->GetRootNode()->GetNodeIndex());
 
+	SampleNodes(thePath, m_iCurPath + 1);
+
 	Recurse(m_pModel->GetRootNode()->GetNodeIndex(), m_pStartMat);
 	return true;
 }
@@ -134,56 +159,16 @@ bool TransformMaker::SetupCall()
 		m_pAnimCur[i]	= m_pModel->GetAnim(m_Anims[i].m_Cur.m_iAnim);
 	}
 
+	// Room for the local transforms, under the caller's arena mark
+	CFrameArena &cArena = FrameArena_Get();
+	m_pLocal		= cArena.AllocArray<LTMatrix>(m_pModel->NumNodes());
+	m_pLocalValid	= cArena.AllocArray<uint8>(m_pModel->NumNodes());
+	memset(m_pLocalValid, 0, m_pModel->NumNodes());
+
 	return LTTRUE;
 }
 
 
-// ------------------------------------------------------------------------
-// InitTransform
-//
-// ------------------------------------------------------------------------
-inline
-void TransformMaker::InitTransform(	uint32 iAnim,
-									uint32 iNode,
-									LTRotation &outQuat,
-									LTVector &outVec)
-{
-	AnimTimeRef *pTimeRef;
-	
-	LTVector p1,p2;
-	LTRotation q1,q2;
-	LTVector *pTrans1, *pTrans2;
-	
-
-	pTimeRef = &m_Anims[iAnim];
-	float inter_frame_param  = pTimeRef->m_Percent ;
-
-	// we don't want to interpolate the movement node between two different
-	// anims. When the two anims are different, use the next anim's first 
-	// frame during the interpolation time.
-	if( iNode == m_iMoveHintNode )
-	{
-		if( pTimeRef->m_Prev.m_iAnim != pTimeRef->m_Cur.m_iAnim )
-		{
-			 inter_frame_param = 1.0f; // take the next anims first frame.
-		}
-	}
-
-	m_pAnimPrev[iAnim]->GetAnimNode(iNode)->GetData(pTimeRef->m_Prev.m_iFrame, p1, q1);;
-	m_pAnimCur[iAnim]->GetAnimNode(iNode)->GetData(pTimeRef->m_Cur.m_iFrame, p2, q2);;
-	
-	outQuat.Slerp( q1, q2, inter_frame_param);
-	outVec = p1 + (p2 - p1) * inter_frame_param ;
-
-	// Apply the per-animation translation.
-	if(m_pModel->IsRootNode(iNode))
-	{
-		pTrans1 = &m_pModel->GetAnimInfo(pTimeRef->m_Prev.m_iAnim)->m_vTranslation;
-		pTrans2 = &m_pModel->GetAnimInfo(pTimeRef->m_Cur.m_iAnim)->m_vTranslation;
-		outVec += *pTrans1 + (*pTrans2 - *pTrans1) * inter_frame_param;
-	}
-}
-
 // ------------------------------------------------------------------------
 // 
 // ------------------------------------------------------------------------
@@ -201,9 +186,9 @@ void TransformMaker::InitTransformAdditive(
 	pTimeRef = &m_Anims[iAnim];
 
 	// get transforms
-	m_pAnimPrev[iAnim]->GetAnimNode(iNode)->GetData(pTimeRef->m_Prev.m_iFrame, p1, q1);;
-	m_pAnimPrev[iAnim]->GetAnimNode(iNode)->GetData(0,basepos,basequat);
-	m_pAnimCur [iAnim]->GetAnimNode(iNode)->GetData(pTimeRef->m_Cur.m_iFrame, p2, q2);
+	m_pAnimPrev[iAnim]->GetAnimNode(iNode)->DecodeData(pTimeRef->m_Prev.m_iFrame, p1, q1);
+	m_pAnimPrev[iAnim]->GetAnimNode(iNode)->DecodeData(0,basepos,basequat);
+	m_pAnimCur [iAnim]->GetAnimNode(iNode)->DecodeData(pTimeRef->m_Cur.m_iFrame, p2, q2);
 
 	outQuat.Slerp(q1, q2, pTimeRef->m_Percent );
 	outVec = p1 + ( p2 - p1 ) * pTimeRef->m_Percent;
@@ -214,37 +199,220 @@ void TransformMaker::InitTransformAdditive(
 }
  
 // ------------------------------------------------------------------------
-// 
+// SampleAnim
+// Interpolates animation iAnim between its prev and cur frames for each node
+// in pNodes, into pDest.  cPrev, cCur and pT are scratch space with room for
+// PoseSoAStride(nNodes) nodes.
 // ------------------------------------------------------------------------
-inline 
-void TransformMaker::BlendTransform(uint32 iAnim, uint32 iNode)
+void TransformMaker::SampleAnim(uint32 iAnim, 
+								const uint32 *pNodes, 
+								uint32 nNodes, 
+								SPoseSoA &cPrev, 
+								SPoseSoA &cCur, 
+								float *pT, 
+								SPoseSoA *pDest)
 {
-	float fPercent = m_WeightSets[iAnim]->m_Weights[iNode];
+	AnimTimeRef *pTimeRef = &m_Anims[iAnim];
+	ModelAnim *pAnimPrev = m_pAnimPrev[iAnim];
+	ModelAnim *pAnimCur = m_pAnimCur[iAnim];
+
+	LTVector vPos;
+	LTRotation rRot;
 
-	// skip this blend if the weight for this anim is zero.
-	if(fPercent == 0.0f)
+	for(uint32 i=0; i < nNodes; i++)
 	{
-		return;
+		uint32 iNode = pNodes[i];
+
+		pAnimPrev->GetAnimNode(iNode)->DecodeData(pTimeRef->m_Prev.m_iFrame, vPos, rRot);
+		cPrev.Set(i, vPos, rRot);
+		pAnimCur->GetAnimNode(iNode)->DecodeData(pTimeRef->m_Cur.m_iFrame, vPos, rRot);
+		cCur.Set(i, vPos, rRot);
+
+		// we don't want to interpolate the movement node between two different
+		// anims. When the two anims are different, use the next anim's first 
+		// frame during the interpolation time.
+		if( iNode == m_iMoveHintNode && pTimeRef->m_Prev.m_iAnim != pTimeRef->m_Cur.m_iAnim )
+			pT[i] = 1.0f; // take the next anims first frame.
+		else
+			pT[i] = pTimeRef->m_Percent;
 	}
-	else
+
+	uint32 nStride = PoseSoAStride(nNodes);
+	cPrev.ClearPadding(nNodes);
+	cCur.ClearPadding(nNodes);
+	for(uint32 i = nNodes; i < nStride; i++)
+		pT[i] = 0.0f;
+
+	PoseBlend(cPrev, cCur, pT, nNodes, pDest);
+
+	// Apply the per-animation translation.
+	for(uint32 i=0; i < nNodes; i++)
 	{
-		LTRotation qTransform, qTemp;
-		LTVector vTransform;
+		if(!m_pModel->IsRootNode(pNodes[i]))
+			continue;
 
-		if(fPercent == 2.0f)
+		LTVector *pTrans1 = &m_pModel->GetAnimInfo(pTimeRef->m_Prev.m_iAnim)->m_vTranslation;
+		LTVector *pTrans2 = &m_pModel->GetAnimInfo(pTimeRef->m_Cur.m_iAnim)->m_vTranslation;
+
+		pDest->Get(i, vPos, rRot);
+		vPos += *pTrans1 + (*pTrans2 - *pTrans1) * pT[i];
+		pDest->Set(i, vPos, rRot);
+	}
+}
+
+// ------------------------------------------------------------------------
+// SampleNodes
+// Evaluates the animations for all the nodes in pNodes at once and puts
+// their local transforms in m_pLocal.  The first animation sets the pose and
+// the rest are blended in by their weight sets, a weight of 2 meaning the
+// animation is added on.
+// ------------------------------------------------------------------------
+void TransformMaker::SampleNodes(const uint32 *pNodes, uint32 nNodes)
+{
+	if(!nNodes)
+		return;
+
+	CFrameArenaMark cArenaMark;
+	CFrameArena &cArena = cArenaMark.GetArena();
+
+	// The pose, three scratch poses and the blend interpolants
+	uint32 nStride = PoseSoAStride(nNodes);
+	uint32 nPoseFloats = nStride * POSE_SOA_FLOATS;
+	float *pData = (float*)cArena.Alloc(sizeof(float) * (nPoseFloats * 5 + nStride * 2), 16);
+
+	SPoseSoA cPose, cPrev, cCur, cAnim, cBlend;
+	cPose.Init(&pData[nPoseFloats * 0], nStride);
+	cPrev.Init(&pData[nPoseFloats * 1], nStride);
+	cCur.Init(&pData[nPoseFloats * 2], nStride);
+	cAnim.Init(&pData[nPoseFloats * 3], nStride);
+	cBlend.Init(&pData[nPoseFloats * 4], nStride);
+	float *pT = &pData[nPoseFloats * 5];
+	float *pWeights = &pT[nStride];
+
+	// Which of the nodes each blended animation applies to
+	uint32 *pBlendIndices = cArena.AllocArray<uint32>(nNodes);
+	uint32 *pBlendNodes = cArena.AllocArray<uint32>(nNodes);
+
+	// Apply animation data (first one inits, the rest are blended in).
+	SampleAnim(0, pNodes, nNodes, cPrev, cCur, pT, &cPose);
+
+	LTVector vPos, vTransform;
+	LTRotation rRot, qTransform;
+
+	for(uint32 iAnim=1; iAnim < m_nAnims; iAnim++)
+	{
+		WeightSet *pWeightSet = m_WeightSets[iAnim];
+
+		uint32 nBlendNodes = 0;
+		for(uint32 i=0; i < nNodes; i++)
 		{
-			// Add the animation.
-			InitTransformAdditive(iAnim, iNode, qTransform, vTransform);
+			float fPercent = pWeightSet->m_Weights[pNodes[i]];
+
+			// skip this blend if the weight for this anim is zero.
+			if(fPercent == 0.0f)
+				continue;
 
-			m_Quat = m_Quat * qTransform;
-			m_vTrans = m_vTrans + vTransform;
+			if(fPercent == 2.0f)
+			{
+				// Add the animation.
+				InitTransformAdditive(iAnim, pNodes[i], qTransform, vTransform);
+
+				cPose.Get(i, vPos, rRot);
+				rRot = rRot * qTransform;
+				vPos = vPos + vTransform;
+				cPose.Set(i, vPos, rRot);
+				continue;
+			}
+
+			pBlendIndices[nBlendNodes] = i;
+			pBlendNodes[nBlendNodes] = pNodes[i];
+			pWeights[nBlendNodes] = fPercent;
+			++nBlendNodes;
 		}
-		else
+
+		if(!nBlendNodes)
+			continue;
+
+		SampleAnim(iAnim, pBlendNodes, nBlendNodes, cPrev, cCur, pT, &cAnim);
+
+		// Blend the animation into the pose for the nodes it covers
+		for(uint32 i=0; i < nBlendNodes; i++)
+		{
+			cPose.Get(pBlendIndices[i], vPos, rRot);
+			cBlend.Set(i, vPos, rRot);
+		}
+		cBlend.ClearPadding(nBlendNodes);
+		for(uint32 i = nBlendNodes; i < PoseSoAStride(nBlendNodes); i++)
+			pWeights[i] = 0.0f;
+
+		PoseBlend(cBlend, cAnim, pWeights, nBlendNodes, &cBlend);
+
+		for(uint32 i=0; i < nBlendNodes; i++)
+		{
+			cBlend.Get(i, vPos, rRot);
+			cPose.Set(pBlendIndices[i], vPos, rRot);
+		}
+	}
+
+	// Use the offset from the parent if this node only uses rotation data
+	// from the animation.
+	for(uint32 i=0; i < nNodes; i++)
+	{
+		ModelNode *pNode = m_pModel->GetNode(pNodes[i]);
+		if(pNode->m_Flags & MNODE_ROTATIONONLY)
+		{
+			cPose.m_pPos[0][i] = pNode->m_vOffsetFromParent.x;
+			cPose.m_pPos[1][i] = pNode->m_vOffsetFromParent.y;
+			cPose.m_pPos[2][i] = pNode->m_vOffsetFromParent.z;
+		}
+	}
+	cPose.ClearPadding(nNodes);
+
+	PoseToMatrices(cPose, nNodes, pNodes, m_pLocal);
+
+	for(uint32 i=0; i < nNodes; i++)
+	{
+		m_pLocalValid[pNodes[i]] = 1;
+	}
+}
+
+// ------------------------------------------------------------------------
+// GetLocalTransform
+// Nodes normally get sampled up front, but a node control function can
+// change which nodes are on the path, so anything that was missed gets
+// sampled on its own.
+// ------------------------------------------------------------------------
+const LTMatrix& TransformMaker::GetLocalTransform(uint32 iNode)
+{
+	if(!m_pLocalValid[iNode])
+	{
+		SampleNodes(&iNode, 1);
+	}
+
+	return m_pLocal[iNode];
+}
+
+// ------------------------------------------------------------------------
+// GatherPathNodes_R( node-index, node-list, list-count )
+// follows the same path RecurseWithPath does, collecting the nodes it's
+// going to evaluate.
+// ------------------------------------------------------------------------
+void TransformMaker::GatherPathNodes_R(uint32 iNode, uint32 *pNodes, uint32 &nNodes)
+{
+	if( !m_pInstance->IsNodeEvaluated( iNode ) )
+	{
+		pNodes[nNodes] = iNode;
+		nNodes++;
+	}
+
+	ModelNode *pNode = m_pModel->GetNode(iNode);
+	uint32 nNumChildren = pNode->NumChildren();
+	for( uint32 i = 0 ; i < nNumChildren; i++ )
+	{
+		uint32 iChild = pNode->m_Children[i]->GetNodeIndex();
+		if( m_pInstance->ShouldEvaluateNode( iChild ))
 		{
-			InitTransform(iAnim, iNode, qTransform, vTransform);
-			qTemp = m_Quat;
-			m_Quat.Slerp(qTemp, qTransform, fPercent);
-			m_vTrans = m_vTrans + (vTransform - m_vTrans) * fPercent;
+			GatherPathNodes_R( iChild, pNodes, nNodes );
 		}
 	}
 }
@@ -255,7 +423,6 @@ void TransformMaker::Recurse(uint32 iNode, LTMatrix *pParentT)
 	uint32 i;
 	LTMatrix *pMyGlobal;
 	ModelNode *pNode;
-	static LTMatrix mScratchMat;
 
 	for(;;)
 	{
@@ -264,28 +431,8 @@ void TransformMaker::Recurse(uint32 iNode, LTMatrix *pParentT)
 		//cache our node reference
 		pNode = m_pModel->GetNode(iNode);
 
-		// Apply animation data (first one inits, the rest are blended in).
-		InitTransform(0, iNode, m_Quat, m_vTrans);
-		for(i=1; i < m_nAnims; i++)
-		{
-			BlendTransform(i, iNode);
-		}
-
 		// Update the global matrix.
-		m_Quat.ConvertToMatrix(m_mTemp);
-
-		// Use the offset from the parent if this node only uses rotation data
-		// from the animation.
-		if(pNode->m_Flags & MNODE_ROTATIONONLY)
-		{
-			m_mTemp.SetTranslation(pNode->m_vOffsetFromParent);
-		}
-		else
-		{
-			m_mTemp.SetTranslation(m_vTrans);
-		}
-
-		MatMul(pMyGlobal, pParentT, &m_mTemp);
+		MatMul(pMyGlobal, pParentT, &GetLocalTransform(iNode));
 
 		if(m_pInstance && m_pInstance->HasNodeControlFn(iNode))
 		{
@@ -360,29 +507,8 @@ void TransformMaker::RecurseWithPath(uint32 iNode, LTMatrix *pParentT)
 	// if we need to evaluate this node, do so.
 	if( !m_pInstance->IsNodeEvaluated( iNode ) )
 	{
-		// Apply animation data (first one inits, the rest are blended in).
-		InitTransform(0, iNode, m_Quat, m_vTrans);
-		for(i=1; i < m_nAnims; i++)
-		{
-			BlendTransform(i, iNode);
-		}
-
-		// Update the global matrix.
-		m_Quat.ConvertToMatrix(m_mTemp);
-
-		// Use the offset from the parent if this node only uses rotation data
-		// from the animation.
-		if(pNode->m_Flags & MNODE_ROTATIONONLY)
-		{
-			m_mTemp.SetTranslation(pNode->m_vOffsetFromParent);
-		}
-		else
-		{
-			m_mTemp.SetTranslation(m_vTrans);
-		}
-
 		// final global pos = parent transform * local-evaluated-animation
-		MatMul(pMyGlobal, pParentT, &m_mTemp);
+		MatMul(pMyGlobal, pParentT, &GetLocalTransform(iNode));
 
 		// tell node we've evaluated it.  Mark it done before the nodecontrolfn
 		// since it could end up calling back into this model to update it's transforms
@@ -13,6 +13,7 @@ struct LTRotation;
 
 class Model;
 class ModelAnim;
+struct SPoseSoA;
 
 // ----------------------------------------------------------------
 //  Calculate all transforms for current animation(s)
@@ -29,6 +30,8 @@ private:
 						m_pInstance = LTNULL;
 						m_nAnims	= 0;
 						m_iMoveHintNode = 0xFFFFFFFF;
+						m_pLocal	= LTNULL;
+						m_pLocalValid = LTNULL;
 					}
 
 	// Copies m_Anims, m_nAnims, and sets m_pStarbtMat to GVPStruct::m_BaseTransform.
@@ -51,10 +54,21 @@ private:
 
 	bool			SetupCall();
 
-	void			InitTransform(uint32 iAnim, uint32 iNode, LTRotation &outQuat, LTVector &outVec);
 	void			InitTransformAdditive(uint32 iAnim, uint32 iNode, LTRotation &outQuat, LTVector &outVec);
 
-	void			BlendTransform(uint32 iAnim, uint32 iNode);
+	// Evaluate the animations for a list of nodes all at once and fill in their
+	// local transforms.
+	void			SampleNodes(const uint32 *pNodes, uint32 nNodes);
+
+	// Interpolate one animation's prev and cur frames for a list of nodes.
+	void			SampleAnim(uint32 iAnim, const uint32 *pNodes, uint32 nNodes, 
+								SPoseSoA &cPrev, SPoseSoA &cCur, float *pT, SPoseSoA *pDest);
+
+	// The local transform of a node, sampling it if it wasn't already.
+	const LTMatrix&	GetLocalTransform(uint32 iNode);
+
+	// Collect the nodes RecurseWithPath is going to evaluate.
+	void			GatherPathNodes_R(uint32 iNode, uint32 *pNodes, uint32 &nNodes);
 
 	void			Recurse(uint32 iNode, LTMatrix *pParentT);
 
@@ -77,10 +91,10 @@ private:
 
 	uint32			m_iMoveHintNode ; 
 
-	LTMatrix		m_mTemp;
-
-	LTRotation		m_Quat;
-	LTVector		m_vTrans;
+	// Animated transform of each node relative to its parent, and whether it's
+	// been sampled yet.  These live on the frame arena for the length of a call.
+	LTMatrix		*m_pLocal;
+	uint8			*m_pLocalValid;
 
 	Model			*m_pModel;
 
@@ -1,4 +1,506 @@
 #include "aabb_tree.h"
+#include "phys_simd.h"
+#include <assert.h>
+
+
+//---------------------------------------------------------------------------//
+//add a leaf's triangle to the lists of the queries in 'hit', and return
+//the ones whose lists were already full (a query on its own stops looking
+//at the rest of the node when that happens)
+static inline uint32 add_leaf
+(
+	uint16*			ti[],
+	uint16			tc[],
+	const uint16	tc_max,
+	uint32			hit,
+	const uint16	t
+)
+{
+	uint32 full = 0;
+
+	for( uint32 i=0 ; hit ; i++, hit>>=1 )
+	{
+		if( hit & 1 )
+		{
+			if( tc[i]<tc_max )
+				ti[i][ tc[i]++ ] = t;
+			else
+				full |= 1<<i;
+		}
+	}
+
+	return full;
+}
+
+
+#ifdef LT_PHYS_SSE
+
+//---------------------------------------------------------------------------//
+//Everything about the segment that doesn't change from node to node, set up
+//once so each node test is just the separating axis checks.
+struct SSESegment
+{
+	__m128 S;		//l0 + l1
+	__m128 L_YZX;	//l1 - l0, shuffled for the cross products
+	__m128 L_ZXY;
+	__m128 F;		//|l1 - l0|
+	__m128 F_YZX;
+	__m128 F_ZXY;
+	__m128 D;		//swept box dimensions
+
+	LT_PHYS_TARGET_SSE2 SSESegment()
+	{}
+
+	LT_PHYS_TARGET_SSE2 SSESegment( const LTVector3f& l0, const LTVector3f& l1, const LTVector3f& d )
+	{
+		const __m128 p0 = SSELoad( l0 );
+		const __m128 p1 = SSELoad( l1 );
+		const __m128 l = _mm_sub_ps( p1, p0 );
+
+		S = _mm_add_ps( p0, p1 );
+		L_YZX = SSE_YZX( l );
+		L_ZXY = SSE_ZXY( l );
+		F = SSEAbs( l );
+		F_YZX = SSE_YZX( F );
+		F_ZXY = SSE_ZXY( F );
+		D = SSELoad( d );
+	}
+};
+
+
+//---------------------------------------------------------------------------//
+//AABBSegmentIntersect() on all three axes at once, with the
+//same operations in the same order so it gives the same answer
+LT_PHYS_TARGET_SSE2 static inline bool sse_segment_intersect
+(
+	const __m128&		min,
+	const __m128&		max,
+	const SSESegment&	l
+)
+{
+	const __m128 T = _mm_sub_ps( l.S, _mm_add_ps( max, min ) );//translation
+	const __m128 E = _mm_sub_ps( max, min );//extents
+
+		//do any of the principal axes form a separating axis?
+		if( _mm_movemask_ps( _mm_cmpgt_ps( SSEAbs(T), _mm_add_ps( l.F, E ) ) ) )
+			return false;
+
+	//l.Cross(x), l.Cross(y) and l.Cross(z)
+	const __m128 c = _mm_sub_ps( _mm_mul_ps( SSE_YZX(T), l.L_ZXY ),
+								 _mm_mul_ps( SSE_ZXY(T), l.L_YZX ) );
+	const __m128 e = _mm_add_ps( _mm_mul_ps( SSE_YZX(E), l.F_ZXY ),
+								 _mm_mul_ps( SSE_ZXY(E), l.F_YZX ) );
+
+	return 0 == _mm_movemask_ps( _mm_cmpgt_ps( SSEAbs(c), e ) );
+}
+
+
+//---------------------------------------------------------------------------//
+//does the box touch the other box, like LTAABB::Intersects()
+LT_PHYS_TARGET_SSE2 static inline bool sse_box_intersect
+(
+	const __m128& amin, const __m128& amax,
+	const __m128& bmin, const __m128& bmax
+)
+{
+	const __m128 m = _mm_and_ps( _mm_cmple_ps( bmin, amax ), _mm_cmple_ps( amin, bmax ) );
+
+	return 7 == (_mm_movemask_ps( m ) & 7);
+}
+
+
+//---------------------------------------------------------------------------//
+//minmax_expand() without the branches:  the flags are turned
+//into lane masks that pick which child gets each offset
+LT_PHYS_TARGET_SSE2 static inline void sse_minmax_expand
+(
+	__m128& lmin, __m128& lmax,
+	__m128& rmin, __m128& rmax,
+	const __m128& min, const __m128& max,
+	const LTAABB_Node& nd
+)
+{
+	const __m128 e = _mm_mul_ps( _mm_set1_ps(1/255.f), _mm_sub_ps( max, min ) );//scaled extent
+	const __m128i f = _mm_set1_epi32( nd.F );
+	const __m128i min_bits = _mm_set_epi32( 0, LTAABB_Node::Z_MIN, LTAABB_Node::Y_MIN, LTAABB_Node::X_MIN );
+	const __m128i max_bits = _mm_set_epi32( 0, LTAABB_Node::Z_MAX, LTAABB_Node::Y_MAX, LTAABB_Node::X_MAX );
+	//all 1's in a lane if that extent belongs to the left child
+	const __m128 lmin_mask = _mm_castsi128_ps( _mm_cmpeq_epi32( _mm_and_si128( f, min_bits ), min_bits ) );
+	const __m128 lmax_mask = _mm_castsi128_ps( _mm_cmpeq_epi32( _mm_and_si128( f, max_bits ), max_bits ) );
+	//unpacked offsets, lane 3 is 0
+	const __m128 dmin = _mm_mul_ps( _mm_cvtepi32_ps( _mm_set_epi32( 0, nd.z_min, nd.y_min, nd.x_min ) ), e );
+	const __m128 dmax = _mm_mul_ps( _mm_cvtepi32_ps( _mm_set_epi32( 0, nd.z_max, nd.y_max, nd.x_max ) ), e );
+
+	lmin = _mm_add_ps( min, _mm_and_ps( lmin_mask, dmin ) );
+	rmin = _mm_add_ps( min, _mm_andnot_ps( lmin_mask, dmin ) );
+	lmax = _mm_sub_ps( max, _mm_and_ps( lmax_mask, dmax ) );
+	rmax = _mm_sub_ps( max, _mm_andnot_ps( lmax_mask, dmax ) );
+}
+
+
+//---------------------------------------------------------------------------//
+//recursive check
+LT_PHYS_TARGET_SSE2 static void sse_aabbtree_box_sweep
+(
+	uint16				ti[],	//triangle indices
+	uint16&				tc,		//index count
+	const uint16		tc_max,	//size of ti[]
+	const LTAABB_Node&	nd,		//parent node
+	const __m128&		min,	//parent extents
+	const __m128&		max,
+	const LTAABB_Node	node[],	//node array
+	const SSESegment&	l		//segment and swept box dimensions
+)
+{
+	//calculate child extents in world space
+	__m128 lmin, lmax, rmin, rmax;
+
+	sse_minmax_expand( lmin, lmax, rmin, rmax, min, max, nd );
+
+		//does the line segment intersect the left child?
+		if( sse_segment_intersect( _mm_sub_ps( lmin, l.D ), _mm_add_ps( lmax, l.D ), l ) )
+		{
+			if( nd.L_Leaf() )
+			{
+				//add triangle index to list
+				if( tc<tc_max )
+					ti[tc++] = nd.L;
+				else
+					return;
+			}
+			else
+			{
+				//recurse on left branch
+				sse_aabbtree_box_sweep( ti, tc, tc_max,
+								node[nd.L], lmin, lmax, node, l );
+			}
+		}
+
+		//does the line segment intersect the right child?
+		if( sse_segment_intersect( _mm_sub_ps( rmin, l.D ), _mm_add_ps( rmax, l.D ), l ) )
+		{
+			if( nd.R_Leaf() )
+			{
+				//add triangle index to list
+				if( tc<tc_max )
+					ti[tc++] = nd.R;
+				else
+					return;
+			}
+			else
+			{
+				//recurse on right branch
+				sse_aabbtree_box_sweep( ti, tc, tc_max,
+								node[nd.R], rmin, rmax, node, l );
+			}
+		}
+}
+
+
+//---------------------------------------------------------------------------//
+//recursive check
+LT_PHYS_TARGET_SSE2 static void sse_aabbtree_box_intersect
+(
+	uint16				ti[],
+	uint16&				tc,
+	const uint16		tc_max,
+	const LTAABB_Node&	nd,
+	const __m128&		min,
+	const __m128&		max,
+	const LTAABB_Node	node[],
+	const __m128&		bmin,	//the box to test
+	const __m128&		bmax
+)
+{
+	//calculate child extents in world space
+	__m128 lmin, lmax, rmin, rmax;
+
+	sse_minmax_expand( lmin, lmax, rmin, rmax, min, max, nd );
+
+		//intersect left child node?
+		if( sse_box_intersect( lmin, lmax, bmin, bmax ) )
+		{
+			if( nd.L_Leaf() )
+			{
+				//add triangle index to list
+				if( tc<tc_max )
+					ti[tc++] = nd.L;
+				else
+					return;
+			}
+			else
+			{
+				//recurse on left branch
+				sse_aabbtree_box_intersect( ti, tc, tc_max,
+								node[nd.L], lmin, lmax, node,
+								bmin, bmax );
+			}
+		}
+
+		//intersect right child node?
+		if( sse_box_intersect( rmin, rmax, bmin, bmax ) )
+		{
+			if( nd.R_Leaf() )
+			{
+				//add triangle index to list
+				if( tc<tc_max )
+					ti[tc++] = nd.R;
+				else
+					return;
+			}
+			else
+			{
+				//recurse on right branch
+				sse_aabbtree_box_intersect( ti, tc, tc_max,
+								node[nd.R], rmin, rmax, node,
+								bmin, bmax );
+			}
+		}
+}
+
+//---------------------------------------------------------------------------//
+//sse_aabbtree_box_sweep() for several segments with the same swept box
+//dimensions, so each node is expanded once for all of them.  Bit i of
+//'live' is set if segment i reached this node, and only those are set up.
+LT_PHYS_TARGET_SSE2 static void sse_aabbtree_box_sweep_n
+(
+	uint16*				ti[],	//triangle indices, per segment
+	uint16				tc[],	//index counts
+	const uint16		tc_max,	//size of each ti[]
+	const LTAABB_Node&	nd,		//parent node
+	const __m128&		min,	//parent extents
+	const __m128&		max,
+	const LTAABB_Node	node[],	//node array
+	const SSESegment	l[],	//segments
+	const __m128&		D,		//swept box dimensions
+	uint32				live
+)
+{
+	//calculate child extents in world space
+	__m128 lmin, lmax, rmin, rmax;
+
+	sse_minmax_expand( lmin, lmax, rmin, rmax, min, max, nd );
+
+	const __m128 lmin_adj = _mm_sub_ps( lmin, D );
+	const __m128 lmax_adj = _mm_add_ps( lmax, D );
+	uint32 hit = 0;
+
+		//which line segments intersect the left child?
+		for( uint32 i=0 ; (live >> i) ; i++ )
+			if( (live & (1<<i)) && sse_segment_intersect( lmin_adj, lmax_adj, l[i] ) )
+				hit |= 1<<i;
+
+		if( hit )
+		{
+			if( nd.L_Leaf() )
+			{
+				//add triangle index to the lists, and stop
+				//looking for the segments whose lists are full
+				live &= ~add_leaf( ti, tc, tc_max, hit, nd.L );
+			}
+			else
+			{
+				//recurse on left branch
+				sse_aabbtree_box_sweep_n( ti, tc, tc_max,
+								node[nd.L], lmin, lmax, node, l, D, hit );
+			}
+		}
+
+	const __m128 rmin_adj = _mm_sub_ps( rmin, D );
+	const __m128 rmax_adj = _mm_add_ps( rmax, D );
+
+	hit = 0;
+
+		//which line segments intersect the right child?
+		for( uint32 i=0 ; (live >> i) ; i++ )
+			if( (live & (1<<i)) && sse_segment_intersect( rmin_adj, rmax_adj, l[i] ) )
+				hit |= 1<<i;
+
+		if( hit )
+		{
+			if( nd.R_Leaf() )
+			{
+				//add triangle index to the lists
+				add_leaf( ti, tc, tc_max, hit, nd.R );
+			}
+			else
+			{
+				//recurse on right branch
+				sse_aabbtree_box_sweep_n( ti, tc, tc_max,
+								node[nd.R], rmin, rmax, node, l, D, hit );
+			}
+		}
+}
+
+
+//---------------------------------------------------------------------------//
+//sse_aabbtree_box_intersect() for several boxes at once
+LT_PHYS_TARGET_SSE2 static void sse_aabbtree_box_intersect_n
+(
+	uint16*				ti[],
+	uint16				tc[],
+	const uint16		tc_max,
+	const LTAABB_Node&	nd,
+	const __m128&		min,
+	const __m128&		max,
+	const LTAABB_Node	node[],
+	const __m128		bmin[],	//the boxes to test
+	const __m128		bmax[],
+	uint32				live
+)
+{
+	//calculate child extents in world space
+	__m128 lmin, lmax, rmin, rmax;
+
+	sse_minmax_expand( lmin, lmax, rmin, rmax, min, max, nd );
+
+	uint32 hit = 0;
+
+		//which boxes intersect the left child node?
+		for( uint32 i=0 ; (live >> i) ; i++ )
+			if( (live & (1<<i)) && sse_box_intersect( lmin, lmax, bmin[i], bmax[i] ) )
+				hit |= 1<<i;
+
+		if( hit )
+		{
+			if( nd.L_Leaf() )
+			{
+				//add triangle index to the lists, and stop
+				//looking for the boxes whose lists are full
+				live &= ~add_leaf( ti, tc, tc_max, hit, nd.L );
+			}
+			else
+			{
+				//recurse on left branch
+				sse_aabbtree_box_intersect_n( ti, tc, tc_max,
+								node[nd.L], lmin, lmax, node,
+								bmin, bmax, hit );
+			}
+		}
+
+	hit = 0;
+
+		//which boxes intersect the right child node?
+		for( uint32 i=0 ; (live >> i) ; i++ )
+			if( (live & (1<<i)) && sse_box_intersect( rmin, rmax, bmin[i], bmax[i] ) )
+				hit |= 1<<i;
+
+		if( hit )
+		{
+			if( nd.R_Leaf() )
+			{
+				//add triangle index to the lists
+				add_leaf( ti, tc, tc_max, hit, nd.R );
+			}
+			else
+			{
+				//recurse on right branch
+				sse_aabbtree_box_intersect_n( ti, tc, tc_max,
+								node[nd.R], rmin, rmax, node,
+								bmin, bmax, hit );
+			}
+		}
+}
+
+//---------------------------------------------------------------------------//
+//AABBTreeBoxSweep()'s recursion, set up from plain vectors
+//so its caller doesn't touch SSE registers on CPUs without it
+LT_PHYS_TARGET_SSE2 static void sse_aabbtree_box_sweep_root
+(
+	uint16				ti[],
+	uint16&				tc,
+	const uint16		tc_max,
+	const LTVector3f&	min,
+	const LTVector3f&	max,
+	const LTAABB_Node	node[],
+	const LTVector3f&	p0,
+	const LTVector3f&	p1,
+	const LTVector3f&	d
+)
+{
+	const SSESegment l( p0, p1, d );
+
+	sse_aabbtree_box_sweep( ti, tc, tc_max,
+					node[0], SSELoad(min), SSELoad(max), node,
+					l );
+}
+
+
+//---------------------------------------------------------------------------//
+//AABBTreeBoxIntersect()'s recursion, set up from plain vectors
+LT_PHYS_TARGET_SSE2 static void sse_aabbtree_box_intersect_root
+(
+	uint16				ti[],
+	uint16&				tc,
+	const uint16		tc_max,
+	const LTVector3f&	min,
+	const LTVector3f&	max,
+	const LTAABB_Node	node[],
+	const LTAABB&		box
+)
+{
+	sse_aabbtree_box_intersect( ti, tc, tc_max,
+					node[0], SSELoad(min), SSELoad(max), node,
+					SSELoad(box.Min), SSELoad(box.Max) );
+}
+
+//---------------------------------------------------------------------------//
+//AABBTreeBoxSweepN()'s recursion, set up from plain vectors
+LT_PHYS_TARGET_SSE2 static void sse_aabbtree_box_sweep_n_root
+(
+	uint16*				ti[],
+	uint16				tc[],
+	const uint16		tc_max,
+	const LTVector3f&	min,
+	const LTVector3f&	max,
+	const LTAABB_Node	node[],
+	const LTVector3f	p0[],
+	const LTVector3f	p1[],
+	const LTVector3f&	d,
+	const uint32		live
+)
+{
+	SSESegment l[AABBTREE_MAX_QUERIES];
+
+	for( uint32 i=0 ; (live >> i) ; i++ )
+		if( live & (1<<i) )
+			l[i] = SSESegment( p0[i], p1[i], d );
+
+	sse_aabbtree_box_sweep_n( ti, tc, tc_max,
+					node[0], SSELoad(min), SSELoad(max), node,
+					l, SSELoad(d), live );
+}
+
+
+//---------------------------------------------------------------------------//
+//AABBTreeBoxIntersectN()'s recursion, set up from plain vectors
+LT_PHYS_TARGET_SSE2 static void sse_aabbtree_box_intersect_n_root
+(
+	uint16*				ti[],
+	uint16				tc[],
+	const uint16		tc_max,
+	const LTVector3f&	min,
+	const LTVector3f&	max,
+	const LTAABB_Node	node[],
+	const LTAABB		box[],
+	const uint32		live
+)
+{
+	__m128 bmin[AABBTREE_MAX_QUERIES];
+	__m128 bmax[AABBTREE_MAX_QUERIES];
+
+	for( uint32 i=0 ; (live >> i) ; i++ )
+	{
+		bmin[i] = SSELoad( box[i].Min );
+		bmax[i] = SSELoad( box[i].Max );
+	}
+
+	sse_aabbtree_box_intersect_n( ti, tc, tc_max,
+					node[0], SSELoad(min), SSELoad(max), node,
+					bmin, bmax, live );
+}
+
+#endif//LT_PHYS_SSE
 
 
 //---------------------------------------------------------------------------//
@@ -56,6 +558,7 @@ static inline void minmax_expand
 }
 
 
+
 //---------------------------------------------------------------------------//
 //recursive check
 static void aabbtree_box_sweep
@@ -128,6 +631,83 @@ static void aabbtree_box_sweep
 }
 
 
+//---------------------------------------------------------------------------//
+//aabbtree_box_sweep() for several segments with the same swept box
+//dimensions, so each node is expanded once for all of them.  Bit i of
+//'live' is set if segment i reached this node.
+static void aabbtree_box_sweep_n
+(
+	uint16*				ti[],	//triangle indices, per segment
+	uint16				tc[],	//index counts
+	const uint16		tc_max,	//size of each ti[]
+	const LTAABB_Node&	nd,		//parent node
+	const LTVector3f&	min,	//parent extents
+	const LTVector3f&	max,
+	const LTAABB_Node	node[],	//node array
+	const LTVector3f	p0[],	//first points on segments
+	const LTVector3f	p1[],	//last points on segments
+	const LTVector3f&	d,		//swept box dimensions
+	uint32				live
+)
+{
+	//calculate child extents in world space
+	LTVector3f lmin, lmax, rmin, rmax;
+
+	minmax_expand( lmin, lmax, rmin, rmax, min, max, nd );
+
+	const LTVector3f lmin_adj = lmin - d;
+	const LTVector3f lmax_adj = lmax + d;
+	uint32 hit = 0;
+
+		//which line segments intersect the left child?
+		for( uint32 i=0 ; (live >> i) ; i++ )
+			if( (live & (1<<i)) && AABBSegmentIntersect( lmin_adj, lmax_adj, p0[i], p1[i] ) )
+				hit |= 1<<i;
+
+		if( hit )
+		{
+			if( nd.L_Leaf() )
+			{
+				//add triangle index to the lists, and stop
+				//looking for the segments whose lists are full
+				live &= ~add_leaf( ti, tc, tc_max, hit, nd.L );
+			}
+			else
+			{
+				//recurse on left branch
+				aabbtree_box_sweep_n( ti, tc, tc_max,
+								node[nd.L], lmin, lmax, node,
+								p0, p1, d, hit );
+			}
+		}
+
+	const LTVector3f rmin_adj = rmin - d;
+	const LTVector3f rmax_adj = rmax + d;
+
+	hit = 0;
+
+		//which line segments intersect the right child?
+		for( uint32 i=0 ; (live >> i) ; i++ )
+			if( (live & (1<<i)) && AABBSegmentIntersect( rmin_adj, rmax_adj, p0[i], p1[i] ) )
+				hit |= 1<<i;
+
+		if( hit )
+		{
+			if( nd.R_Leaf() )
+			{
+				//add triangle index to the lists
+				add_leaf( ti, tc, tc_max, hit, nd.R );
+			}
+			else
+			{
+				//recurse on right branch
+				aabbtree_box_sweep_n( ti, tc, tc_max,
+								node[nd.R], rmin, rmax, node,
+								p0, p1, d, hit );
+			}
+		}
+}
+
 //---------------------------------------------------------------------------//
 bool AABBTreeBoxSweep
 (
@@ -153,6 +733,13 @@ bool AABBTreeBoxSweep
 		if( AABBSegmentIntersect( min_r, max_r, p0, p1 ) )
 		{
 			//...recursively check the children
+#ifdef LT_PHYS_SSE
+			if( PhysSimd() >= PHYS_SIMD_SSE2 )
+				sse_aabbtree_box_sweep_root( ti, tc, tc_max,
+								min, max, node,
+								p0, p1, d );
+			else
+#endif
 			aabbtree_box_sweep( ti, tc, tc_max,
 							node[0], min, max, node,
 							p0, p1, d );
@@ -235,6 +822,77 @@ static void aabbtree_box_intersect
 }
 
 
+//---------------------------------------------------------------------------//
+//aabbtree_box_intersect() for several boxes at once
+static void aabbtree_box_intersect_n
+(
+	uint16*				ti[],
+	uint16				tc[],
+	const uint16		tc_max,
+	const LTAABB_Node&	nd,
+	const LTVector3f&	min,
+	const LTVector3f&	max,
+	const LTAABB_Node	node[],
+	const LTAABB		box[],
+	uint32				live
+)
+{
+	//calculate child extents in world space
+	LTVector3f lmin, lmax, rmin, rmax;
+
+	minmax_expand( lmin, lmax, rmin, rmax, min, max, nd );
+
+	const LTAABB lb( lmin, lmax );
+	uint32 hit = 0;
+
+		//which boxes intersect the left child node?
+		for( uint32 i=0 ; (live >> i) ; i++ )
+			if( (live & (1<<i)) && lb.Intersects( box[i] ) )
+				hit |= 1<<i;
+
+		if( hit )
+		{
+			if( nd.L_Leaf() )
+			{
+				//add triangle index to the lists, and stop
+				//looking for the boxes whose lists are full
+				live &= ~add_leaf( ti, tc, tc_max, hit, nd.L );
+			}
+			else
+			{
+				//recurse on left branch
+				aabbtree_box_intersect_n( ti, tc, tc_max,
+								node[nd.L], lmin, lmax, node,
+								box, hit );
+			}
+		}
+
+	const LTAABB rb( rmin, rmax );
+
+	hit = 0;
+
+		//which boxes intersect the right child node?
+		for( uint32 i=0 ; (live >> i) ; i++ )
+			if( (live & (1<<i)) && rb.Intersects( box[i] ) )
+				hit |= 1<<i;
+
+		if( hit )
+		{
+			if( nd.R_Leaf() )
+			{
+				//add triangle index to the lists
+				add_leaf( ti, tc, tc_max, hit, nd.R );
+			}
+			else
+			{
+				//recurse on right branch
+				aabbtree_box_intersect_n( ti, tc, tc_max,
+								node[nd.R], rmin, rmax, node,
+								box, hit );
+			}
+		}
+}
+
 //---------------------------------------------------------------------------//
 bool AABBTreeBoxIntersect
 (
@@ -254,6 +912,14 @@ bool AABBTreeBoxIntersect
 		if( root.Intersects( box ) )
 		{
 			//...recursively check the children
+#ifdef LT_PHYS_SSE
+			if( PhysSimd() >= PHYS_SIMD_SSE2 )
+				sse_aabbtree_box_intersect_root(
+								ti, tc, tc_max,
+								min, max, node,
+								box );
+			else
+#endif
 			aabbtree_box_intersect(
 							ti, tc, tc_max,
 							node[0], min, max, node,
@@ -267,5 +933,111 @@ bool AABBTreeBoxIntersect
 	return false;
 }
 
+//---------------------------------------------------------------------------//
+bool AABBTreeBoxSweepN
+(
+	uint16*				ti[],	//triangle indices, per segment
+	uint16				tc[],	//index counts
+	const uint16		tc_max,	//size of each ti[]
+	const uint32		n,		//segment count
+	const LTVector3f&	min,	//extents of root node
+	const LTVector3f&	max,
+	const LTAABB_Node	node[],	//aabb node array
+	const LTVector3f	p0[],	//first positions
+	const LTVector3f	p1[],	//last positions
+	const LTVector3f&	d		//swept box dimensions
+)
+{
+	assert( n <= AABBTREE_MAX_QUERIES );
+
+	//ALGORITHM:  AABBTreeBoxSweep() for each segment, but walking the tree
+	//once.  Each segment is only tested against the nodes it would have
+	//been on its own, so each list comes out the same.
+	const LTVector3f min_r = min - d;
+	const LTVector3f max_r = max + d;
+	uint32 live = 0;//segments still looking
+	bool found = false;
+
+	for( uint32 i=0 ; i<n ; i++ )
+	{
+		//if the swept aabb intersects the root node...
+		if( AABBSegmentIntersect( min_r, max_r, p0[i], p1[i] ) )
+			live |= 1<<i;
+	}
+
+		if( live )
+		{
+			//...recursively check the children
+#ifdef LT_PHYS_SSE
+			if( PhysSimd() >= PHYS_SIMD_SSE2 )
+				sse_aabbtree_box_sweep_n_root( ti, tc, tc_max,
+								min, max, node,
+								p0, p1, d, live );
+			else
+#endif
+			aabbtree_box_sweep_n( ti, tc, tc_max,
+							node[0], min, max, node,
+							p0, p1, d, live );
+
+			for( uint32 i=0 ; i<n ; i++ )
+				found = found || tc[i] > 0;
+		}
+
+	//return true if any triangles might have been hit
+	return found;
+}
+
+
+//---------------------------------------------------------------------------//
+bool AABBTreeBoxIntersectN
+(
+	uint16*				ti[],	//triangle indices, per box
+	uint16				tc[],	//index counts
+	const uint16		tc_max,	//size of each ti[]
+	const uint32		n,		//box count
+	const LTVector3f&	min,	//extents of root node
+	const LTVector3f&	max,
+	const LTAABB_Node	node[],	//node array
+	const LTAABB		box[]	//the boxes to test
+)
+{
+	assert( n <= AABBTREE_MAX_QUERIES );
+
+	//ALGORITHM:  AABBTreeBoxIntersect() for each box, walking the tree once
+	LTAABB root( min, max );//root node
+	uint32 live = 0;//boxes still looking
+	bool found = false;
+
+	for( uint32 i=0 ; i<n ; i++ )
+	{
+		//if the box intersects the root node...
+		if( root.Intersects( box[i] ) )
+			live |= 1<<i;
+	}
+
+		if( live )
+		{
+			//...recursively check the children
+#ifdef LT_PHYS_SSE
+			if( PhysSimd() >= PHYS_SIMD_SSE2 )
+				sse_aabbtree_box_intersect_n_root(
+								ti, tc, tc_max,
+								min, max, node,
+								box, live );
+			else
+#endif
+			aabbtree_box_intersect_n(
+							ti, tc, tc_max,
+							node[0], min, max, node,
+							box, live );
+
+			for( uint32 i=0 ; i<n ; i++ )
+				found = found || tc[i] > 0;
+		}
+
+	//return true if any leaves were intersected
+	return found;
+}
+
 
 //EOF
@@ -1,5 +1,6 @@
 #include "build_aabb.h"
 #include "math_phys.h"
+#include "ltmem.h"
 
 
 static void sort_triangles
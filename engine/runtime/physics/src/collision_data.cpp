@@ -1,5 +1,6 @@
 #include "collision_data.h"
 #include "build_aabb.h"
+#include "ltmem.h"
 #include <string.h>
 
 /*
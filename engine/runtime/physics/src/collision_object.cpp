@@ -2,6 +2,7 @@
 #include "sphere.h"
 #include "obb.h"
 #include "cylinder.h"
+#include <assert.h>
 
 
 //---------------------------------------------------------------------------//
@@ -128,6 +129,81 @@ bool LTCollisionSphere::HitCylinder
 	return bHit;
 }
 
+//---------------------------------------------------------------------------//
+//sweep a sphere at C0 and C1 in the mesh's local frames F0 and F1 against
+//the triangles in ti[] that AABBTreeBoxSweep() found, and report the first
+//contact
+static bool sphere_mesh_sweep
+(
+	LTContactInfo&					ci,
+	const LTCollisionSphere&		sph,
+	const LTCollisionMesh&			mesh,
+	const LTCoordinateFrameQ&		F0,
+	const LTCoordinateFrameQ&		F1,
+	const LTVector3f&				C0,
+	const LTVector3f&				C1,
+	uint16							ti[],
+	uint16							tc,
+	const LTContactInfo::Filter&	cf
+)
+{
+	const float r = sph.m_Radius;
+	//mesh extents
+	const LTVector3f& min = mesh.m_pData->m_Min;
+	const LTVector3f& max = mesh.m_pData->m_Max;
+	const LTTriangle* tri = mesh.m_pData->Triangles();//Triangles
+	const LTVector3u16* V = mesh.m_pData->Vertices();//packed Vertices
+	const LTVector3f e = max - min;//dimensions of root node
+	const float s = 1 / float(0xFFFF);//scale factor
+	bool bHit = false;
+
+	//throw out the triangles whose planes
+	//the sphere never got close enough to
+	tc = SphereTriangleSweepCull( ti, tc, tri, V, min, e, C0, C1, r );
+
+	//sweep the sphere against each triangle
+	for( uint16 i=0 ; i<tc ; i++ )
+	{
+		const LTTriangle& t = tri[ ti[i] ];
+		LTVector3f v[3];//unpacked Vertices
+
+		v[0] = UnpackVector( V[t.v[0]], min, e, s );
+		v[1] = UnpackVector( V[t.v[1]], min, e, s );
+		v[2] = UnpackVector( V[t.v[2]], min, e, s );
+
+		LTVector3f n;//unit contact normal, parent frame
+		float u;//normalized time of collision
+
+		//mesh's local frame
+		if( SphereTriangleSweep( u, n, C0, C1, r, v[0], v[1], v[2] ) )
+		{
+			//if this collision occurred before the
+			//previous one, replace u, n and pc
+			if( u < ci.m_U )
+			{
+				//interpolate the mesh's local coordinate frame
+				//and transform the normal to the parent frame
+				const LTCoordinateFrameQ Fu = Interpolate( F0, F1, u );
+				n = Fu.TransformVectorToParent(n);
+				//unit contact normal
+				ci.m_N = n;
+				//normalized time of contact
+				ci.m_U = u;
+				//contact point, world frame
+				ci.m_P = (1-u)*sph.m_P0 + u*sph.m_P1 - r*n;
+				//this triangle's surface properties
+				ci.m_Sb = mesh.m_pData->FindSurface( ti[i] );
+
+				//apply filter
+				if( cf.Condition( ci ) )
+					bHit = true;
+			}
+		}
+	}
+
+	return bHit;
+}
+
 //---------------------------------------------------------------------------//
 bool LTCollisionSphere::HitMesh
 (
@@ -167,52 +243,7 @@ bool LTCollisionSphere::HitMesh
 	//might have hit along its path from p0 to p1, and
 	//report the first contact
 	if( AABBTreeBoxSweep( ti, tc, tc_max, min, max, node, C0, C1, d ) )
-	{
-		const LTTriangle* tri = mesh.m_pData->Triangles();//Triangles
-		const LTVector3u16* V = mesh.m_pData->Vertices();//packed Vertices
-		const LTVector3f e = max - min;//dimensions of root node
-		const float s = 1 / float(0xFFFF);//scale factor
-
-		//sweep the sphere against each triangle
-		for( uint16 i=0 ; i<tc ; i++ )
-		{
-			const LTTriangle& t = tri[ ti[i] ];
-			LTVector3f v[3];//unpacked Vertices
-
-			v[0] = UnpackVector( V[t.v[0]], min, e, s );
-			v[1] = UnpackVector( V[t.v[1]], min, e, s );
-			v[2] = UnpackVector( V[t.v[2]], min, e, s );
-
-			LTVector3f n;//unit contact normal, parent frame
-			float u;//normalized time of collision
-
-			//mesh's local frame
-			if( SphereTriangleSweep( u, n, C0, C1, r, v[0], v[1], v[2] ) )
-			{
-				//if this collision occurred before the
-				//previous one, replace u, n and pc
-				if( u < ci.m_U )
-				{
-					//interpolate the mesh's local coordinate frame
-					//and transform the normal to the parent frame
-					const LTCoordinateFrameQ Fu = Interpolate( F0, F1, u );
-					n = Fu.TransformVectorToParent(n);
-					//unit contact normal
-					ci.m_N = n;
-					//normalized time of contact
-					ci.m_U = u;
-					//contact point, world frame
-					ci.m_P = (1-u)*m_P0 + u*m_P1 - r*n;
-					//this triangle's surface properties
-					ci.m_Sb = mesh.m_pData->FindSurface( ti[i] );
-
-					//apply filter
-					if( cf.Condition( ci ) )
-						bHit = true;
-				}
-			}
-		}
-	}
+		bHit = sphere_mesh_sweep( ci, *this, mesh, F0, F1, C0, C1, ti, tc, cf );
 
 	return bHit;
 }
@@ -320,6 +351,90 @@ bool LTCollisionSphere::IntersectCylinder
 	return bIntersect;
 }
 
+//---------------------------------------------------------------------------//
+//check a sphere at C in the mesh's local frame F1 against the triangles
+//in ti[] that AABBTreeBoxIntersect() found, and sum the intersections
+static bool sphere_mesh_intersect
+(
+	LTIntersectInfo&				ii,
+	const LTCollisionSphere&		sph,
+	const LTCollisionMesh&			mesh,
+	const LTCoordinateFrameQ&		F1,
+	const LTVector3f&				C,
+	uint16							ti[],
+	uint16							tc,
+	const LTIntersectInfo::Filter&	iif
+)
+{
+	const float r = sph.m_Radius;
+	//mesh extents
+	const LTVector3f& min = mesh.m_pData->m_Min;
+	const LTVector3f& max = mesh.m_pData->m_Max;
+	const LTTriangle* tri = mesh.m_pData->Triangles();//Triangles
+	const LTVector3u16* V = mesh.m_pData->Vertices();//packed Vertices
+	const LTVector3f e = max - min;//dimensions of root node
+	const float s = 1 / float(0xFFFF);//scale factor
+	LTVector3f T_net(0,0,0);//net translation vector
+	LTVector3f P_net(0,0,0);//ave. intersect. pt.
+	LTIntersectInfo info;
+	int32 N=0;//intersection count
+
+	//who I intersected
+	info.m_hObj = mesh.m_hObj;
+
+	//throw out the triangles whose
+	//planes are too far from C
+	tc = SphereTriangleIntersectCull( ti, tc, tri, V, min, e, C, r );
+
+	//check sphere against each triangle
+	for( int32 i=0 ; i<tc ; i++ )
+	{
+		const LTTriangle& t = tri[ ti[i] ];
+		LTVector3f v[3];//unpacked Vertices
+		LTVector3f T;//pentration vector
+
+		v[0] = UnpackVector( V[t.v[0]], min, e, s );
+		v[1] = UnpackVector( V[t.v[1]], min, e, s );
+		v[2] = UnpackVector( V[t.v[2]], min, e, s );
+
+		if( SphereTriangleIntersect( T, C, r, v[0], v[1], v[2] ) )
+		{
+			//transform T to the mesh's parent frame
+			T = F1.TransformVectorToParent( T );
+			info.m_T = T;
+			//approximate the centroid of intersection
+			const float t = T.Length();
+			LTVector3f n;//n points away from sphere
+			if( t>0 )
+				n = -(1.f/t)*T;
+			else
+				n = (mesh.m_P1-sph.m_P1).Unit();
+
+			info.m_P = sph.m_P1 + (r-0.5f*t)*n;
+
+			//apply filter
+			if( iif.Condition( info ) )
+			{
+				T_net += info.m_T;//net
+				P_net += info.m_P;//to compute average
+				N++;
+			}
+		}
+	}
+
+	//intersection info
+	if( N )
+	{
+		ii.m_hObj = mesh.m_hObj;//who I intersected
+		ii.m_T = T_net;//net
+		ii.m_P = P_net / float(N);//average
+		return true;
+	}
+
+	//no valid intersection
+	return false;
+}
+
 //---------------------------------------------------------------------------//
 bool LTCollisionSphere::IntersectMesh
 (
@@ -347,64 +462,7 @@ bool LTCollisionSphere::IntersectMesh
 	//get a list of triangles the
 	//sphere might be intersecting
 	if( AABBTreeBoxIntersect( ti, tc, tc_max, min, max, node, box ) )
-	{
-		const LTTriangle* tri = mesh.m_pData->Triangles();//Triangles
-		const LTVector3u16* V = mesh.m_pData->Vertices();//packed Vertices
-		const LTVector3f e = max - min;//dimensions of root node
-		const float s = 1 / float(0xFFFF);//scale factor
-		LTVector3f T_net(0,0,0);//net translation vector
-		LTVector3f P_net(0,0,0);//ave. intersect. pt.
-		LTIntersectInfo info;
-		int32 N=0;//intersection count
-
-		//who I intersected
-		info.m_hObj = mesh.m_hObj;
-
-		//check sphere against each triangle
-		for( int32 i=0 ; i<tc ; i++ )
-		{
-			const LTTriangle& t = tri[ ti[i] ];
-			LTVector3f v[3];//unpacked Vertices
-			LTVector3f T;//pentration vector
-
-			v[0] = UnpackVector( V[t.v[0]], min, e, s );
-			v[1] = UnpackVector( V[t.v[1]], min, e, s );
-			v[2] = UnpackVector( V[t.v[2]], min, e, s );
-
-			if( SphereTriangleIntersect( T, C, r, v[0], v[1], v[2] ) )
-			{
-				//transform T to the mesh's parent frame
-				T = F1.TransformVectorToParent( T );
-				info.m_T = T;
-				//approximate the centroid of intersection
-				const float t = T.Length();
-				LTVector3f n;//n points away from sphere
-				if( t>0 )
-					n = -(1.f/t)*T;
-				else
-					n = (mesh.m_P1-m_P1).Unit();
-
-				info.m_P = m_P1 + (m_Radius-0.5f*t)*n;
-
-				//apply filter
-				if( iif.Condition( info ) )
-				{
-					T_net += info.m_T;//net
-					P_net += info.m_P;//to compute average
-					N++;
-				}
-			}
-		}
-
-		//intersection info
-		if( N )
-		{
-			ii.m_hObj = mesh.m_hObj;//who I intersected
-			ii.m_T = T_net;//net
-			ii.m_P = P_net / float(N);//average
-			return true;
-		}
-	}
+		return sphere_mesh_intersect( ii, *this, mesh, F1, C, ti, tc, iif );
 
 	//no valid intersection
 	return false;
@@ -551,20 +609,142 @@ bool LTCollisionBox::HitCylinder
 }
 
 //---------------------------------------------------------------------------//
-bool LTCollisionBox::HitMesh
+//LTCollisionSphere::HitMesh() for up to AABBTREE_MAX_QUERIES spheres of
+//radius r, walking the mesh's AABB tree once for all of them.  Each sphere
+//gets the same answer it would on its own.
+static void spheres_hit_mesh
 (
-	LTContactInfo& ci, const LTCollisionMesh& mesh,
-	const LTContactInfo::Filter& cf
-) const
+	bool							hit[],	//what each sphere's HitMesh() returns
+	LTContactInfo					ci[],	//and its contact info
+	const float						r,		//sphere radius
+	const LTVector3f				p0[],	//sphere positions at u=0
+	const LTVector3f				p1[],	//sphere positions at u=1
+	const uint32					n,		//sphere count
+	const LTPhysSurf&				surf,	//sphere surface properties
+	const HOBJECT					hobj,	//sphere object handle
+	const LTCollisionMesh&			mesh,
+	const LTContactInfo::Filter&	cf
+)
 {
-	//box's local coordinate frames at u=0 and u=1
-	LTCoordinateFrameM F0( m_P0, m_R0 );
-	LTCoordinateFrameM F1( m_P1, m_R1 );
+	const LTVector3f d(r,r,r);//use an aabb to approximate each sphere
+	//transform spheres to mesh's local frame
+	const LTCoordinateFrameQ F0( mesh.m_P0, mesh.m_R0 );
+	const LTCoordinateFrameQ F1( mesh.m_P1, mesh.m_R1 );
+	//mesh extents
+	const LTVector3f& min = mesh.m_pData->m_Min;
+	const LTVector3f& max = mesh.m_pData->m_Max;
+	//aabb node array
+	const LTAABB_Node* node = mesh.m_pData->Nodes();
+	//TODO:  use a dynamic array
+	const uint16 tc_max = 128;//max number of triangle indices
+	uint16 ti[AABBTREE_MAX_QUERIES][tc_max];//arrays of triangle indices
+	uint16* pti[AABBTREE_MAX_QUERIES];
+	uint16 tc[AABBTREE_MAX_QUERIES];//numbers of potential Triangles
+	LTVector3f C0[AABBTREE_MAX_QUERIES];
+	LTVector3f C1[AABBTREE_MAX_QUERIES];
+	uint32 i;
 
-	ci.m_U = 2.f;//assume no collision
+	assert( n <= AABBTREE_MAX_QUERIES );
 
-	//TEMP:  use spheres at each corner
-	LTVector3f ts = m_Dim;//translation of sphere to box corners
+	for( i=0 ; i<n ; i++ )
+	{
+		C0[i] = F0.TransformPointToLocal( p0[i] );
+		C1[i] = F1.TransformPointToLocal( p1[i] );
+		pti[i] = ti[i];
+		tc[i] = 0;
+
+		//what LTCollisionSphere::HitMesh() sets up
+		hit[i] = false;
+		ci[i].m_hObj = mesh.m_hObj;
+		ci[i].m_Sa = surf;
+		ci[i].m_U = 2.f;
+	}
+
+	//get the indices of the triangles that each sphere might
+	//have hit along its path, and report their first contacts
+	if( AABBTreeBoxSweepN( pti, tc, tc_max, n, min, max, node, C0, C1, d ) )
+	{
+		for( i=0 ; i<n ; i++ )
+		{
+			if( tc[i] )
+			{
+				const LTCollisionSphere s(r,p0[i],p1[i],surf,hobj);
+
+				hit[i] = sphere_mesh_sweep( ci[i], s, mesh, F0, F1, C0[i], C1[i], ti[i], tc[i], cf );
+			}
+		}
+	}
+}
+
+//---------------------------------------------------------------------------//
+//LTCollisionSphere::IntersectMesh() for up to AABBTREE_MAX_QUERIES spheres
+//of radius r, walking the mesh's AABB tree once for all of them.  Each
+//sphere gets the same answer it would on its own.
+static void spheres_intersect_mesh
+(
+	bool							hit[],	//what each sphere's IntersectMesh() returns
+	LTIntersectInfo					ii[],	//and its intersection info
+	const float						r,		//sphere radius
+	const LTVector3f				p1[],	//sphere positions
+	const uint32					n,		//sphere count
+	const LTPhysSurf&				surf,	//sphere surface properties
+	const HOBJECT					hobj,	//sphere object handle
+	const LTCollisionMesh&			mesh,
+	const LTIntersectInfo::Filter&	iif
+)
+{
+	const LTVector3f dim(r,r,r);
+	//transform sphere centers to mesh's local frame
+	const LTCoordinateFrameQ F1( mesh.m_P1, mesh.m_R1 );
+	//mesh extents
+	const LTVector3f& min = mesh.m_pData->m_Min;
+	const LTVector3f& max = mesh.m_pData->m_Max;
+	//aabb nodes
+	const LTAABB_Node* node = mesh.m_pData->Nodes();
+	//TODO:  use a dynamic array
+	const uint16 tc_max = 128;//max number of triangle indices
+	uint16 ti[AABBTREE_MAX_QUERIES][tc_max];//arrays of triangle indices
+	uint16* pti[AABBTREE_MAX_QUERIES];
+	uint16 tc[AABBTREE_MAX_QUERIES];//numbers of potential Triangles
+	LTVector3f C[AABBTREE_MAX_QUERIES];
+	LTAABB box[AABBTREE_MAX_QUERIES];
+	uint32 i;
+
+	assert( n <= AABBTREE_MAX_QUERIES );
+
+	for( i=0 ; i<n ; i++ )
+	{
+		C[i] = F1.TransformPointToLocal( p1[i] );
+		//approximate the sphere with an AABB
+		box[i] = LTAABB( C[i] - dim, C[i] + dim );
+		pti[i] = ti[i];
+		tc[i] = 0;
+		hit[i] = false;
+	}
+
+	//get lists of triangles the
+	//spheres might be intersecting
+	if( AABBTreeBoxIntersectN( pti, tc, tc_max, n, min, max, node, box ) )
+	{
+		for( i=0 ; i<n ; i++ )
+		{
+			if( tc[i] )
+			{
+				const LTCollisionSphere s(r,p1[i],p1[i],surf,hobj);
+
+				hit[i] = sphere_mesh_intersect( ii[i], s, mesh, F1, C[i], ti[i], tc[i], iif );
+			}
+		}
+	}
+}
+
+//---------------------------------------------------------------------------//
+//TEMP:  boxes are tested against meshes as four spheres, at the corners of
+//their largest cross-section.  Find the spheres' radius and their positions
+//in the box's local frame, in the order they're tested.
+static float box_corner_spheres( LTVector3f t[4], const LTVector3f& dim )
+{
+	LTVector3f ts = dim;//translation of sphere to box corners
 	const float r = Min(ts.x,Min(ts.y,ts.z));//radius of sphere
 	//index of min box dimension
 	int32 i_min = 0;
@@ -584,68 +764,61 @@ bool LTCollisionBox::HitMesh
 	ts[i2] -= r;
 
 	//upper right
-	{
-		//sphere displacement
-		const LTVector3f p0 = F0.TransformPointToParent( ts );
-		const LTVector3f p1 = F1.TransformPointToParent( ts );
-		const LTCollisionSphere s(r,p0,p1,m_Surf,m_hObj);
-		LTContactInfo info;
-
-		if( mesh.HitSphere( info, s, cf ) )
-			if( info.m_U < ci.m_U )
-				ci = info;
-	}
+	t[0] = ts;
 
 	//upper left
-	{
-		//sphere displacement
-		LTVector3f t = ts;
+	t[1] = ts;
+	t[1][i1] = -t[1][i1];//opposite side
 
-		t[i1] = -t[i1];//opposite side
-
-		const LTVector3f p0 = F0.TransformPointToParent( t );
-		const LTVector3f p1 = F1.TransformPointToParent( t );
-		const LTCollisionSphere s(r,p0,p1,m_Surf,m_hObj);
-		LTContactInfo info;
+	//lower left
+	t[2] = ts;
+	t[2][i1] = -t[2][i1];//opposite side
+	t[2][i2] = -t[2][i2];//opposite side
 
-		if( mesh.HitSphere( info, s, cf ) )
-			if( info.m_U < ci.m_U )
-				ci = info;
-	}
+	//lower right
+	t[3] = ts;
+	t[3][i2] = -t[3][i2];//opposite side
 
-	//lower left
-	{
-		//sphere displacement
-		LTVector3f t = ts;
+	return r;
+}
 
-		t[i1] = -t[i1];//opposite side
-		t[i2] = -t[i2];//opposite side
+//---------------------------------------------------------------------------//
+bool LTCollisionBox::HitMesh
+(
+	LTContactInfo& ci, const LTCollisionMesh& mesh,
+	const LTContactInfo::Filter& cf
+) const
+{
+	//box's local coordinate frames at u=0 and u=1
+	LTCoordinateFrameM F0( m_P0, m_R0 );
+	LTCoordinateFrameM F1( m_P1, m_R1 );
 
-		const LTVector3f p0 = F0.TransformPointToParent( t );
-		const LTVector3f p1 = F1.TransformPointToParent( t );
-		const LTCollisionSphere s(r,p0,p1,m_Surf,m_hObj);
-		LTContactInfo info;
+	ci.m_U = 2.f;//assume no collision
 
-		if( mesh.HitSphere( info, s, cf ) )
-			if( info.m_U < ci.m_U )
-				ci = info;
-	}
+	//TEMP:  use spheres at each corner
+	LTVector3f ts[4];//translation of spheres to box corners
+	const float r = box_corner_spheres( ts, m_Dim );//radius of spheres
+	LTVector3f p0[4], p1[4];//sphere displacements
+	LTContactInfo info[4];
+	bool bHit[4];
 
-	//lower right
+	for( int32 i=0 ; i<4 ; i++ )
 	{
-		//sphere displacement
-		LTVector3f t = ts;
+		p0[i] = F0.TransformPointToParent( ts[i] );
+		p1[i] = F1.TransformPointToParent( ts[i] );
+	}
 
-		t[i2] = -t[i2];//opposite side
+	spheres_hit_mesh( bHit, info, r, p0, p1, 4, m_Surf, m_hObj, mesh, cf );
 
-		const LTVector3f p0 = F0.TransformPointToParent( t );
-		const LTVector3f p1 = F1.TransformPointToParent( t );
-		const LTCollisionSphere s(r,p0,p1,m_Surf,m_hObj);
-		LTContactInfo info;
+	for( int32 i=0 ; i<4 ; i++ )
+	{
+		//what mesh.HitSphere() does, the
+		//spheres have the box's handle
+		SwapContactInfo( info[i], *this );
 
-		if( mesh.HitSphere( info, s, cf ) )
-			if( info.m_U < ci.m_U )
-				ci = info;
+		if( bHit[i] )
+			if( info[i].m_U < ci.m_U )
+				ci = info[i];
 	}
 
 	//valid collision
@@ -731,90 +904,26 @@ bool LTCollisionBox::IntersectMesh
 	bool bIntersect = false;
 
 	//TEMP:  use spheres at each corner
-	LTVector3f ts = m_Dim;//translation of sphere to box corners
-	const float r = Min(ts.x,Min(ts.y,ts.z));//radius of sphere
-	//index of min box dimension
-	int32 i_min = 0;
+	LTVector3f ts[4];//translation of spheres to box corners
+	const float r = box_corner_spheres( ts, m_Dim );//radius of spheres
+	LTVector3f p1[4];//sphere displacements
+	LTIntersectInfo info[4];
+	bool bHit[4];
 
-	if( r == ts.y )
-		i_min = 1;
-	else if( r== ts.z )
-		i_min = 2;
-
-	//translation along min dimension is 0
-	ts[i_min] = 0;
-	//translation along other axes
-	const int32 i1 = (i_min+1)%3;
-	const int32 i2 = (i_min+2)%3;
-
-	ts[i1] -= r;
-	ts[i2] -= r;
-
-	//upper right
-	{
-		//sphere displacement
-		const LTVector3f p1 = f1.TransformPointToParent( ts );
-		const LTCollisionSphere s(r,p1,p1,m_Surf,m_hObj);
-		LTIntersectInfo info;
-
-		if( mesh.IntersectSphere( info, s, iif ) )
-		{
-			ii = info;
-			bIntersect = true;
-		}
-	}
-
-	//upper left
-	{
-		//sphere displacement
-		LTVector3f t = ts;
-
-		t[i1] = -t[i1];//opposite side
-
-		const LTVector3f p1 = f1.TransformPointToParent( t );
-		const LTCollisionSphere s(r,p1,p1,m_Surf,m_hObj);
-		LTIntersectInfo info;
-
-		if( mesh.IntersectSphere( info, s, iif ) )
-		{
-			ii = info;
-			bIntersect = true;
-		}
-	}
-
-	//lower left
-	{
-		//sphere displacement
-		LTVector3f t = ts;
+	for( int32 i=0 ; i<4 ; i++ )
+		p1[i] = f1.TransformPointToParent( ts[i] );
 
-		t[i1] = -t[i1];//opposite side
-		t[i2] = -t[i2];//opposite side
+	spheres_intersect_mesh( bHit, info, r, p1, 4, m_Surf, m_hObj, mesh, iif );
 
-		const LTVector3f p1 = f1.TransformPointToParent( t );
-		const LTCollisionSphere s(r,p1,p1,m_Surf,m_hObj);
-		LTIntersectInfo info;
-
-		if( mesh.IntersectSphere( info, s, iif ) )
-		{
-			ii = info;
-			bIntersect = true;
-		}
-	}
-
-	//lower right
+	for( int32 i=0 ; i<4 ; i++ )
 	{
-		//sphere displacement
-		LTVector3f t = ts;
-
-		t[i2] = -t[i2];//opposite side
+		//what mesh.IntersectSphere() does, the
+		//spheres have the box's handle
+		SwapIntersectInfo( info[i], *this );
 
-		const LTVector3f p1 = f1.TransformPointToParent( t );
-		const LTCollisionSphere s(r,p1,p1,m_Surf,m_hObj);
-		LTIntersectInfo info;
-
-		if( mesh.IntersectSphere( info, s, iif ) )
+		if( bHit[i] )
 		{
-			ii = info;
+			ii = info[i];
 			bIntersect = true;
 		}
 	}
@@ -1268,21 +1377,34 @@ bool LTCollisionMesh::HitCylinder
 		const LTCoordinateFrameM B1(c.m_P1,c.m_R1);
 		const int32 N = int32(hr) + 1;
 		const float d = 2.f*(h-r)/float(N-1);
+		//sphere centers at times u=0 and u=1, parent frame
+		LTVector3f C0[AABBTREE_MAX_QUERIES], C1[AABBTREE_MAX_QUERIES];
+		LTContactInfo info[AABBTREE_MAX_QUERIES];
+		bool bHit[AABBTREE_MAX_QUERIES];
 
-		for( int32 j=0 ; j<N ; j++ )
+		//test the spheres a tree walk's worth at a time
+		for( int32 b=0 ; b<N ; b+=AABBTREE_MAX_QUERIES )
 		{
-			//sphere center, cylinder frame
-			const LTVector3f C( 0.f, r + j*d - h, 0.f );
-			//center at times u=0 and u=1, parent frame
-			const LTVector3f C0 = B0.TransformPointToParent(C);
-			const LTVector3f C1 = B1.TransformPointToParent(C);
-			//collision object
-			const LTCollisionSphere sphere(r,C0,C1,c.m_Surf,c.m_hObj);
-			LTContactInfo info;
-
-			if( sphere.HitMesh( info, *this, cf ) )
-				if( info.m_U < ci.m_U )
-					ci = info;
+			const int32 n = Min( N - b, int32(AABBTREE_MAX_QUERIES) );
+			int32 i;
+
+			for( i=0 ; i<n ; i++ )
+			{
+				//sphere center, cylinder frame
+				const LTVector3f C( 0.f, r + (b+i)*d - h, 0.f );
+
+				C0[i] = B0.TransformPointToParent(C);
+				C1[i] = B1.TransformPointToParent(C);
+			}
+
+			spheres_hit_mesh( bHit, info, r, C0, C1, n, c.m_Surf, c.m_hObj, *this, cf );
+
+			for( i=0 ; i<n ; i++ )
+			{
+				if( bHit[i] )
+					if( info[i].m_U < ci.m_U )
+						ci = info[i];
+			}
 		}
 	}
 	else//cylinder is short and squatty
@@ -1363,24 +1485,37 @@ bool LTCollisionMesh::IntersectCylinder
 		const LTCoordinateFrameM B1(c.m_P1,c.m_R1);
 		const int32 N = int32(hr) + 1;
 		const float d = 2.f*(h-r)/float(N-1);
+		//sphere centers at time u=1, parent frame
+		LTVector3f C1[AABBTREE_MAX_QUERIES];
+		LTIntersectInfo info[AABBTREE_MAX_QUERIES];
+		bool bHit[AABBTREE_MAX_QUERIES];
 
-		for( int32 j=0 ; j<N ; j++ )
+		//test the spheres a tree walk's worth at a time
+		for( int32 b=0 ; b<N ; b+=AABBTREE_MAX_QUERIES )
 		{
-			//sphere center, cylinder frame
-			const LTVector3f C( 0.f, r + j*d - h, 0.f );
-			//center at time u=1, parent frame
-			const LTVector3f C1 = B1.TransformPointToParent(C);
-			//collision object
-			const LTCollisionSphere sphere(r,C1,C1,c.m_Surf,c.m_hObj);
-			LTIntersectInfo info;
-
-			if( sphere.IntersectMesh( info, *this, iif ) )
+			const int32 n = Min( N - b, int32(AABBTREE_MAX_QUERIES) );
+			int32 i;
+
+			for( i=0 ; i<n ; i++ )
 			{
-				bIntersect = true;
+				//sphere center, cylinder frame
+				const LTVector3f C( 0.f, r + (b+i)*d - h, 0.f );
 
-				//use info with the largest penetration
-				if( info.m_T.LengthSqr() > ii.m_T.LengthSqr() )
-					ii = info;
+				C1[i] = B1.TransformPointToParent(C);
+			}
+
+			spheres_intersect_mesh( bHit, info, r, C1, n, c.m_Surf, c.m_hObj, *this, iif );
+
+			for( i=0 ; i<n ; i++ )
+			{
+				if( bHit[i] )
+				{
+					bIntersect = true;
+
+					//use info with the largest penetration
+					if( info[i].m_T.LengthSqr() > ii.m_T.LengthSqr() )
+						ii = info[i];
+				}
 			}
 		}
 	}
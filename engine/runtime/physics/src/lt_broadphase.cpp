@@ -0,0 +1,56 @@
+#pragma warning( disable : 4786 )
+#pragma warning( disable : 4530 )
+
+
+#include "lt_broadphase.h"
+#ifndef __NO_INTERFACE_DB__
+#include "ltassert.h"
+#endif
+
+
+//fat boxes are grown by this much on each side,
+//plus an eighth of the size of the object
+const float FAT_MARGIN	= 1.0f;
+
+
+//---------------------------------------------------------------------------//
+LTBroadphase::LTBroadphase()
+	:	m_Tree( FAT_MARGIN )
+{}
+
+
+//---------------------------------------------------------------------------//
+uint32 LTBroadphase::Insert( ILTCollisionObject* o, const LTAABB& b )
+{
+#ifndef __NO_INTERFACE_DB__
+	assert( o );
+#endif
+
+	return m_Tree.Insert( o, b.Min, b.Max );
+}
+
+
+//---------------------------------------------------------------------------//
+bool LTBroadphase::Move( const uint32 proxy, const LTAABB& b )
+{
+	//only changes the tree if 'b' left the fat box,
+	//and the proxy stays the same either way
+	return m_Tree.Move( proxy, b.Min, b.Max );
+}
+
+
+//---------------------------------------------------------------------------//
+void LTBroadphase::Remove( const uint32 proxy )
+{
+	m_Tree.Remove( proxy );
+}
+
+
+//---------------------------------------------------------------------------//
+void LTBroadphase::Clear()
+{
+	m_Tree.Clear();
+}
+
+
+//EOF
@@ -0,0 +1,157 @@
+#ifndef __LT_BROADPHASE_H__
+#define __LT_BROADPHASE_H__
+
+#include "aabb.h"
+
+#ifndef __COLLISION_OBJECT_H__
+#include "collision_object.h"
+#endif
+
+#ifndef __DYNAMICAABBTREE_H__
+#include "dynamicaabbtree.h"
+#endif
+
+
+//---------------------------------------------------------------------------//
+/*
+LTBroadphase is a dynamic AABB tree that LTCollisionMgr keeps its collision
+objects in, so queries only run the narrow phase on objects that are close.
+The tree itself is a CDynamicAABBTree (see dynamicaabbtree.h).
+
+Each leaf holds one object and a "fat" box:  the object's swept bounds grown
+by a margin.  Moving an object around inside its fat box doesn't change the
+tree at all.
+
+A leaf's node index doubles as the object's proxy handle.  Handles stay the
+same until the object is removed (Move() keeps them).
+
+NOTE:  Objects must not be added, moved or removed while a query is visiting
+the tree.
+*/
+class LTBroadphase
+{
+public:
+
+	enum
+	{
+		NULL_NODE = AABBTREE_NULL_NODE,
+		//deeper than any balanced tree could get
+		MAX_DEPTH = 64
+	};
+
+	LTBroadphase();
+
+	//add an object whose swept bounds are 'b', return its proxy
+	uint32 Insert( ILTCollisionObject* o, const LTAABB& b );
+
+	//update an object's bounds, returns true if its leaf had to move
+	bool Move( const uint32 proxy, const LTAABB& b );
+
+	void Remove( const uint32 proxy );
+
+	//remove everything
+	void Clear();
+
+	ILTCollisionObject* Object( const uint32 proxy ) const
+	{
+		return m_Tree.GetItem( proxy );
+	}
+
+	const LTAABB FatBox( const uint32 proxy ) const
+	{
+		const Node& node = m_Tree.GetNode( proxy );
+
+		return LTAABB( node.m_vMin, node.m_vMax );
+	}
+
+	uint32 ObjectCount() const	{ return m_Tree.GetNumItems(); }
+	//levels below the root, 0 for one leaf or an empty tree
+	uint32 Height() const		{ return m_Tree.GetHeight(); }
+
+	/*
+	Call v(proxy) for every leaf whose fat box, grown by 'r' on every
+	side, touches the line segment from p0 to p1.  A point (p0==p1) gives
+	a box query.  If v() returns false, the query stops.
+	*/
+	template<class V>
+	void QuerySegment
+	(
+		V&					v,
+		const LTVector3f&	p0,
+		const LTVector3f&	p1,
+		const float			r
+	) const
+	{
+		const LTVector3f e(r,r,r);
+		uint32 stack[MAX_DEPTH];
+		int32 top = 0;
+
+		if( m_Tree.GetRoot() != NULL_NODE )
+			stack[top++] = m_Tree.GetRoot();
+
+		while( top > 0 )
+		{
+			const uint32 i = stack[--top];
+			const Node& node = m_Tree.GetNode( i );
+
+			if( !AABBSegmentIntersect( node.m_vMin - e, node.m_vMax + e, p0, p1 ) )
+				continue;
+
+			if( node.IsLeaf() )
+			{
+				if( !v( i ) )
+					return;
+			}
+			else
+			{
+				stack[top++] = node.m_iChildren[0];
+				stack[top++] = node.m_iChildren[1];
+			}
+		}
+	}
+
+	/*
+	Call v(proxy) for every leaf whose fat box touches 'b'.  If v()
+	returns false, the query stops.
+	*/
+	template<class V>
+	void QueryBox( V& v, const LTAABB& b ) const
+	{
+		uint32 stack[MAX_DEPTH];
+		int32 top = 0;
+
+		if( m_Tree.GetRoot() != NULL_NODE )
+			stack[top++] = m_Tree.GetRoot();
+
+		while( top > 0 )
+		{
+			const uint32 i = stack[--top];
+			const Node& node = m_Tree.GetNode( i );
+
+			if( !LTAABB( node.m_vMin, node.m_vMax ).Intersects( b ) )
+				continue;
+
+			if( node.IsLeaf() )
+			{
+				if( !v( i ) )
+					return;
+			}
+			else
+			{
+				stack[top++] = node.m_iChildren[0];
+				stack[top++] = node.m_iChildren[1];
+			}
+		}
+	}
+
+private:
+
+	typedef CDynamicAABBTree<LTVector3f,ILTCollisionObject> Tree;
+	typedef Tree::SNode Node;
+
+	Tree m_Tree;
+};
+
+
+#endif
+//EOF
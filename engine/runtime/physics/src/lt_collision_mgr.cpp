@@ -7,6 +7,12 @@
 #include "ltassert.h"
 #endif
 
+#ifndef _FINAL
+#include "ltmem.h"
+#include <chrono>
+#include <string.h>
+#endif
+
 
 #ifndef __NO_INTERFACE_DB__
 //allocate a state mgr for both the client and the server
@@ -15,22 +21,293 @@ instantiate_interface( LTCollisionMgr, ILTCollisionMgr, Server );
 #endif
 
 
+//---------------------------------------------------------------------------//
+//radius of a sphere about the object's origin that contains
+//it, whatever its orientation
+static float BoundingRadius( const ILTCollisionObject& o )
+{
+	switch( o.m_Type )
+	{
+		case COT_SPHERE:
+		{
+			return static_cast<const LTCollisionSphere&>(o).m_Radius;
+		}
+
+		case COT_BOX:
+		{
+			return static_cast<const LTCollisionBox&>(o).m_Dim.Length();
+		}
+
+		case COT_CYLINDER:
+		{
+			const LTCollisionCylinder& c = static_cast<const LTCollisionCylinder&>(o);
+
+			return sqrtf( c.m_Radius*c.m_Radius + c.m_HHeight*c.m_HHeight );
+		}
+
+		case COT_MESH:
+		{
+			const LTCollisionData* pdata = static_cast<const LTCollisionMesh&>(o).m_pData;
+
+			if( !pdata )
+				return 0;
+
+			//the mesh extents are in local space
+			const LTVector3f& min = pdata->m_Min;
+			const LTVector3f& max = pdata->m_Max;
+			const LTVector3f e
+			(
+				Max( fabsf(min.x), fabsf(max.x) ),
+				Max( fabsf(min.y), fabsf(max.y) ),
+				Max( fabsf(min.z), fabsf(max.z) )
+			);
+
+			return e.Length();
+		}
+	}
+
+	return 0;
+}
+
+
+//---------------------------------------------------------------------------//
+//a box that contains the object all the way from p0 to p1
+static const LTAABB SweptBounds( const ILTCollisionObject& o )
+{
+	const float r = BoundingRadius( o );
+	const LTVector3f& p0 = o.m_P0;
+	const LTVector3f& p1 = o.m_P1;
+
+	return LTAABB
+	(
+		LTVector3f( Min(p0.x,p1.x) - r, Min(p0.y,p1.y) - r, Min(p0.z,p1.z) - r ),
+		LTVector3f( Max(p0.x,p1.x) + r, Max(p0.y,p1.y) + r, Max(p0.z,p1.z) + r )
+	);
+}
+
+
+//---------------------------------------------------------------------------//
+//is 'b' the same thing as the query object 'a'
+static inline bool IsSelf( const ILTCollisionObject& a, const ILTCollisionObject& b )
+{
+	//static geometry doesn't have a handle
+	return &a == &b || (a.m_hObj && a.m_hObj == b.m_hObj);
+}
+
+
+//---------------------------------------------------------------------------//
+//runs the narrow phase for Collide() on the broadphase's candidates
+struct CollideVisitor
+{
+	const LTBroadphase&					m_Broadphase;
+	LTContactInfo&						m_CI;
+	const ILTCollisionObject&			m_A;
+	const ILTCollisionObject::Filter&	m_OF;
+	const LTContactInfo::Filter&		m_CIF;
+
+	CollideVisitor
+	(
+		const LTBroadphase&					bp,
+		LTContactInfo&						ci,
+		const ILTCollisionObject&			a,
+		const ILTCollisionObject::Filter&	of,
+		const LTContactInfo::Filter&		cif
+	)
+		:	m_Broadphase(bp), m_CI(ci), m_A(a), m_OF(of), m_CIF(cif)
+	{}
+
+	bool operator()( const uint32 proxy )
+	{
+		const ILTCollisionObject* b = m_Broadphase.Object( proxy );
+
+		//filter objects before expensive test
+		if( !IsSelf( m_A, *b ) && m_OF.Condition( *b ) )
+		{
+			LTContactInfo info;
+
+			//check for collision
+			if( m_A.Hit( info, *b, m_CIF ) )
+			{
+				//if this collision occurred before
+				//the previous one, replace 'ci'
+				if( info.m_U < m_CI.m_U )
+					m_CI = info;
+			}
+		}
+
+		return true;
+	}
+};
+
+
+//---------------------------------------------------------------------------//
+//runs the narrow phase for Intersect() on the broadphase's candidates
+struct IntersectVisitor
+{
+	const LTBroadphase&					m_Broadphase;
+	LTIntersectInfo*					m_II;
+	int32&								m_N;
+	const int32							m_Size;
+	const ILTCollisionObject&			m_A;
+	const ILTCollisionObject::Filter&	m_OF;
+	const LTIntersectInfo::Filter&		m_IIF;
+
+	IntersectVisitor
+	(
+		const LTBroadphase&					bp,
+		LTIntersectInfo						ii[],
+		int32&								n,
+		const int32							sz,
+		const ILTCollisionObject&			a,
+		const ILTCollisionObject::Filter&	of,
+		const LTIntersectInfo::Filter&		iif
+	)
+		:	m_Broadphase(bp), m_II(ii), m_N(n), m_Size(sz), m_A(a), m_OF(of), m_IIF(iif)
+	{}
+
+	bool operator()( const uint32 proxy )
+	{
+		const ILTCollisionObject* b = m_Broadphase.Object( proxy );
+
+		//filter objects before expensive test
+		if( !IsSelf( m_A, *b ) && m_OF.Condition( *b ) )
+		{
+			LTIntersectInfo info;
+
+			//check for intersection
+			if( m_A.Intersect( info, *b, m_IIF ) )
+			{
+				//add to array
+				m_II[m_N++] = info;
+			}
+		}
+
+		//don't exceed array
+		return m_N < m_Size;
+	}
+};
+
+
+//---------------------------------------------------------------------------//
+//runs the narrow phase for IntersectSegment() on the broadphase's candidates
+struct SegmentVisitor
+{
+	const LTBroadphase&					m_Broadphase;
+	LTIntersectInfo*					m_II;
+	int32&								m_N;
+	const int32							m_Size;
+	const LTVector3f&					m_P0;
+	const LTVector3f&					m_P1;
+	const ILTCollisionObject::Filter&	m_OF;
+	const LTIntersectInfo::Filter&		m_IIF;
+	bool								m_Intersect;
+
+	SegmentVisitor
+	(
+		const LTBroadphase&					bp,
+		LTIntersectInfo						ii[],
+		int32&								n,
+		const int32							sz,
+		const LTVector3f&					p0,
+		const LTVector3f&					p1,
+		const ILTCollisionObject::Filter&	of,
+		const LTIntersectInfo::Filter&		iif
+	)
+		:	m_Broadphase(bp), m_II(ii), m_N(n), m_Size(sz),
+			m_P0(p0), m_P1(p1), m_OF(of), m_IIF(iif), m_Intersect(false)
+	{}
+
+	bool operator()( const uint32 proxy )
+	{
+		const ILTCollisionObject* o = m_Broadphase.Object( proxy );
+
+		//filter objects before expensive test
+		if( m_OF.Condition( *o ) )
+		{
+			//find segment intersections
+			if( o->IntersectSegment( m_II, m_N, m_Size, m_P0, m_P1, m_IIF ) )
+			{
+				//set flag
+				m_Intersect = true;
+			}
+		}
+
+		//don't exceed array
+		return m_N < m_Size;
+	}
+};
+
+
+//---------------------------------------------------------------------------//
+//collects the pairs for FindPairs()
+struct PairVisitor
+{
+	const LTBroadphase&					m_Broadphase;
+	LTCollisionPair*					m_Pairs;
+	int32&								m_N;
+	const int32							m_Size;
+	const uint32						m_Proxy;
+	ILTCollisionObject*					m_pA;
+	const LTAABB						m_Box;
+	const ILTCollisionObject::Filter&	m_OF;
+
+	PairVisitor
+	(
+		const LTBroadphase&					bp,
+		LTCollisionPair						pairs[],
+		int32&								n,
+		const int32							sz,
+		const uint32						proxy,
+		const ILTCollisionObject::Filter&	of
+	)
+		:	m_Broadphase(bp), m_Pairs(pairs), m_N(n), m_Size(sz),
+			m_Proxy(proxy), m_pA(bp.Object(proxy)),
+			m_Box(SweptBounds(*bp.Object(proxy))), m_OF(of)
+	{}
+
+	bool operator()( const uint32 proxy )
+	{
+		//both leaves find each other, so only
+		//take the pair from the lower proxy
+		if( proxy <= m_Proxy )
+			return true;
+
+		ILTCollisionObject* b = m_Broadphase.Object( proxy );
+
+		//static geometry never moves into other static geometry
+		if( !m_pA->m_hObj && !b->m_hObj )
+			return true;
+
+		//the fat boxes overlap, check the real bounds
+		if( m_Box.Intersects( SweptBounds( *b ) ) && m_OF.Condition( *b ) )
+		{
+			m_Pairs[m_N].m_pA = m_pA;
+			m_Pairs[m_N].m_pB = b;
+			m_N++;
+		}
+
+		//don't exceed array
+		return m_N < m_Size;
+	}
+};
+
+
 //---------------------------------------------------------------------------//
 LTCollisionMgr::~LTCollisionMgr()
 {
 	//delete any left over collision objects allocated by
 	//the engine, such as world models and static geometry
-	ObjectList::iterator i;
+	ObjectArray::iterator i;
 
 	for( i = m_Objects.begin() ; i != m_Objects.end() ; i++ )
 	{
-		const ILTCollisionObject* o = (*i);
-
-		delete o;
-
-		i = m_Objects.erase(i);
+		delete *i;
 	}
 
+	m_Objects.clear();
+	m_Proxies.clear();
+	m_Broadphase.Clear();
+
 	//NOTE:  Collision objects allocated in an application DLL should
 	//have been deleted before that DLL goes out of scope, otherwise
 	//their v-tables are gone by the time this destructor is called.
@@ -42,17 +319,17 @@ void LTCollisionMgr::Term()
 {
 	//delete any left over collision objects allocated by
 	//the engine, such as world models and static geometry
-	ObjectList::iterator i;
+	ObjectArray::iterator i;
 
 	for( i = m_Objects.begin() ; i != m_Objects.end() ; i++ )
 	{
-		const ILTCollisionObject* o = (*i);
-
-		delete o;
-
-		i = m_Objects.erase(i);
+		delete *i;
 	}
 
+	m_Objects.clear();
+	m_Proxies.clear();
+	m_Broadphase.Clear();
+
 	//NOTE:  Collision objects allocated in an application DLL should
 	//have been deleted before that DLL goes out of scope, otherwise
 	//their v-tables are gone by the time this destructor is called.
@@ -68,44 +345,17 @@ bool LTCollisionMgr::Collide
 	const LTContactInfo::Filter&		cif
 ) const
 {
-	//remove 'a' to prevent self-collision
-	ILTCollisionObject* pobj = NULL;
-
-	if( a.m_hObj )//don't remove static geometry
-		pobj = const_cast<LTCollisionMgr*>(this)->Remove( a.m_hObj );
+	CheckBounds();
 
 	//report the first collision that occurred (min u)
 	ci.m_U = 2;//ensure replacement
 
-	ObjectList::const_iterator i;
-
-	//check 'a' against every object in the collision DB
-	for( i = m_Objects.begin() ; i != m_Objects.end() ; i++ )
-	{
-		const ILTCollisionObject* b = *i;
-
-		//filter objects before expensive test
-		if( of.Condition( *b ) )
-		{
-			LTContactInfo info;
-
-			//check for collision
-			if( a.Hit( info, *b, cif ) )
-			{
-				//if this collision occurred before
-				//the previous one, replace 'ci'
-				if( info.m_U < ci.m_U )
-					ci = info;
-			}
-		}
-	}
+	//check 'a' against every object whose bounds
+	//touch the volume it sweeps through ('a' itself
+	//is skipped to prevent self-collision)
+	CollideVisitor v( m_Broadphase, ci, a, of, cif );
 
-	//put 'a' back into the list (pobj will
-	//be NULL if it wasn't in there before)
-	if( pobj )
-	{
-		const_cast<LTCollisionMgr*>(this)->Add( pobj );
-	}
+	m_Broadphase.QuerySegment( v, a.m_P0, a.m_P1, BoundingRadius(a) );
 
 	return (ci.m_U <= 1);//true if a collision occurred
 }
@@ -139,51 +389,22 @@ bool LTCollisionMgr::Intersect
 	const LTIntersectInfo::Filter&		iif
 ) const
 {
-	//remove 'a' to prevent self-collision
-	ILTCollisionObject* pobj = NULL;
-
-	if( a.m_hObj )//don't remove static geometry
-		pobj = const_cast<LTCollisionMgr*>(this)->Remove( a.m_hObj );
-
-	ObjectList::const_iterator i;
-	bool bIntersect = false;//did any intersections occur
-	LTIntersectInfo info;
-
 	n=0;//init count
 
-	//report all intersections between 'o'
-	//and every other object in the DB
-	for( i = m_Objects.begin() ; i != m_Objects.end() ; i++ )
-	{
-		const ILTCollisionObject* b = *i;
+	if( N <= 0 )
+		return false;
 
-		//filter objects before expensive test
-		if( of.Condition( *b ) )
-		{
-			//check for intersection
-			if( a.Intersect( info, *b, iif ) )
-			{
-				//set flag
-				bIntersect = true;
+	CheckBounds();
 
-				//add to array
-				ii[n++] = info;
+	//report all intersections between 'a' and every
+	//other object whose bounds touch it at p1
+	const float r = BoundingRadius( a );
+	const LTVector3f e( r, r, r );
+	IntersectVisitor v( m_Broadphase, ii, n, N, a, of, iif );
 
-				//don't exceed array
-				if( N==n )
-					break;
-			}
-		}
-	}
+	m_Broadphase.QueryBox( v, LTAABB( a.m_P1 - e, a.m_P1 + e ) );
 
-	//put 'a' back into the list (pobj will
-	//be NULL if it wasn't in there before)
-	if( pobj )
-	{
-		const_cast<LTCollisionMgr*>(this)->Add( pobj );
-	}
-
-	return bIntersect;
+	return (n > 0);//did any intersections occur
 }
 
 //---------------------------------------------------------------------------//
@@ -198,30 +419,54 @@ bool LTCollisionMgr::IntersectSegment
 	const LTIntersectInfo::Filter&		iif
 ) const
 {
-	bool bIntersect = false;
-	ObjectList::const_iterator i;
+	n=0;//init count
+
+	if( sz <= 0 )
+		return false;
+
+	CheckBounds();
+
+	//report all intersections between the line segment
+	//and objects whose bounds it passes through
+	SegmentVisitor v( m_Broadphase, ii, n, sz, p0, p1, of, iif );
+
+	m_Broadphase.QuerySegment( v, p0, p1, 0 );
+
+	return v.m_Intersect;
+}
+
+
+//---------------------------------------------------------------------------//
+bool LTCollisionMgr::FindPairs
+(
+	LTCollisionPair						pairs[],
+	int32&								n,
+	const int32							sz,
+	const ILTCollisionObject::Filter&	of
+) const
+{
+	ObjectArray::const_iterator i;
 
 	n=0;//init count
 
-	//report all intersections between the
-	//line segment and objects in the DB
-	for( i = m_Objects.begin() ; i != m_Objects.end() ; i++ )
+	CheckBounds();
+
+	//look for the neighbors of each object in the tree,
+	//in the order they were added
+	for( i = m_Objects.begin() ; i != m_Objects.end() && n < sz ; i++ )
 	{
-		const ILTCollisionObject* o = *i;
+		const uint32 proxy = m_Proxies.find( *i )->second;
 
-		//filter objects before expensive test
-		if( of.Condition( *o ) )
+		//filter objects before searching
+		if( of.Condition( **i ) )
 		{
-			//find segment intersections
-			if( o->IntersectSegment( ii, n, sz, p0, p1, iif ) )
-			{
-				//set flag
-				bIntersect = true;
-			}
+			PairVisitor v( m_Broadphase, pairs, n, sz, proxy, of );
+
+			m_Broadphase.QueryBox( v, m_Broadphase.FatBox(proxy) );
 		}
 	}
 
-	return bIntersect;
+	return (n > 0);
 }
 
 
@@ -232,10 +477,36 @@ void LTCollisionMgr::Add( ILTCollisionObject* o )
 	assert( o );
 #endif
 
+	//if it's already in there, just refresh its bounds
+	if( m_Proxies.find( o ) != m_Proxies.end() )
+	{
+		Update( o );
+		return;
+	}
+
+	m_Proxies[o] = m_Broadphase.Insert( o, SweptBounds(*o) );
 	m_Objects.push_back( o );
 }
 
 
+//---------------------------------------------------------------------------//
+void LTCollisionMgr::Update( ILTCollisionObject* o )
+{
+#ifndef __NO_INTERFACE_DB__
+	assert( o );
+#endif
+
+	ProxyMap::iterator i = m_Proxies.find( o );
+
+	if( i != m_Proxies.end() )
+	{
+		//only changes the tree if the object
+		//left the margin around its old bounds
+		m_Broadphase.Move( i->second, SweptBounds(*o) );
+	}
+}
+
+
 //---------------------------------------------------------------------------//
 void LTCollisionMgr::Remove( ILTCollisionObject* o )
 {
@@ -243,23 +514,28 @@ void LTCollisionMgr::Remove( ILTCollisionObject* o )
 	assert( o );
 #endif
 
-	m_Objects.remove( o );
+	for( uint32 i=0 ; i<m_Objects.size() ; i++ )
+	{
+		if( o == m_Objects[i] )
+		{
+			RemoveAt( i );
+			return;
+		}
+	}
 }
 
 
 //---------------------------------------------------------------------------//
 ILTCollisionObject* LTCollisionMgr::Remove( const HOBJECT h )
 {
-	ObjectList::iterator i;
-
 	//remove the collision object corresponding to 'h'
-	for( i = m_Objects.begin() ; i != m_Objects.end() ; i++ )
+	for( uint32 i=0 ; i<m_Objects.size() ; i++ )
 	{
-		ILTCollisionObject* o = *i;
+		ILTCollisionObject* o = m_Objects[i];
 
 		if( h == o->m_hObj )
 		{
-			m_Objects.remove(o);
+			RemoveAt( i );
 			return o;
 		}
 	}
@@ -271,9 +547,9 @@ ILTCollisionObject* LTCollisionMgr::Remove( const HOBJECT h )
 //---------------------------------------------------------------------------//
 ILTCollisionObject* LTCollisionMgr::Find( const HOBJECT h ) const
 {
-	ObjectList::const_iterator i;
+	ObjectArray::const_iterator i;
 
-	//remove the collision object corresponding to 'h'
+	//find the collision object corresponding to 'h'
 	for( i = m_Objects.begin() ; i != m_Objects.end() ; i++ )
 	{
 		ILTCollisionObject* o = *i;
@@ -288,4 +564,187 @@ ILTCollisionObject* LTCollisionMgr::Find( const HOBJECT h ) const
 }
 
 
+//---------------------------------------------------------------------------//
+void LTCollisionMgr::RemoveAt( const uint32 i )
+{
+	ProxyMap::iterator j = m_Proxies.find( m_Objects[i] );
+
+	m_Broadphase.Remove( j->second );
+	m_Proxies.erase( j );
+
+	//don't swap the last one in, the order has to stay the same
+	m_Objects.erase( m_Objects.begin() + i );
+}
+
+
+//---------------------------------------------------------------------------//
+void LTCollisionMgr::CheckBounds() const
+{
+#if defined(_DEBUG) && !defined(__NO_INTERFACE_DB__)
+	ProxyMap::const_iterator i;
+
+	for( i = m_Proxies.begin() ; i != m_Proxies.end() ; i++ )
+	{
+		const LTAABB b = SweptBounds( *i->first );
+		const LTAABB fat = m_Broadphase.FatBox( i->second );
+
+		//if this fires, the object was changed
+		//without Update() being called
+		assert( fat.Contains( b.Min ) && fat.Contains( b.Max ) );
+	}
+#endif
+}
+
+
+#ifndef _FINAL
+//---------------------------------------------------------------------------//
+//the same numbers every run, so runs can be compared
+static float BenchRandom( uint32& seed, const float min, const float max )
+{
+	seed = seed*1664525 + 1013904223;
+
+	return min + (max - min) * float(seed >> 8) / float(1 << 24);
+}
+
+
+//---------------------------------------------------------------------------//
+static float BenchSeconds( const std::chrono::steady_clock::time_point& start )
+{
+	return std::chrono::duration<float>( std::chrono::steady_clock::now() - start ).count();
+}
+
+
+//---------------------------------------------------------------------------//
+void LTCollisionMgr::Benchmark
+(
+	LTCollisionBenchResults&	r,
+	const uint32				count,
+	const uint32				frames
+)
+{
+	memset( &r, 0, sizeof(r) );
+
+	if( !count )
+		return;
+
+	//an open area where each object touches a few others
+	const float side = 48 * powf( float(count), 1.f/3.f );
+	const float speed = 4;//units per frame
+	uint32 seed = 1;
+
+	LTCollisionMgr mgr;
+	ObjectArray objects;
+	std::vector<LTVector3f> velocity;
+	uint32 i;
+
+	objects.reserve( count );
+	velocity.reserve( count );
+
+	for( i=0 ; i<count ; i++ )
+	{
+		const LTVector3f p
+		(
+			BenchRandom( seed, 0, side ),
+			BenchRandom( seed, 0, side ),
+			BenchRandom( seed, 0, side )
+		);
+		LTOrientation R;
+		R.Rotate( LTVector3f( BenchRandom( seed, -1, 1 ), BenchRandom( seed, -1, 1 ), BenchRandom( seed, -1, 1 ) ) );
+
+		//the handle just has to be unique and not NULL
+		const HOBJECT h = (HOBJECT)(uintptr_t)(i + 1);
+		ILTCollisionObject* o;
+
+		switch( i % 3 )
+		{
+			case 0:
+			{
+				const LTVector3f d( BenchRandom( seed, 4, 16 ), BenchRandom( seed, 4, 16 ), BenchRandom( seed, 4, 16 ) );
+
+				LT_MEM_TRACK_ALLOC(o = new LTCollisionBox( d, p, p, R, R, LTPhysSurf(), h ),LT_MEM_TYPE_PHYSICS);
+				break;
+			}
+
+			case 1:
+			{
+				LT_MEM_TRACK_ALLOC(o = new LTCollisionSphere( BenchRandom( seed, 4, 16 ), p, p, LTPhysSurf(), h ),LT_MEM_TYPE_PHYSICS);
+				break;
+			}
+
+			default:
+			{
+				LT_MEM_TRACK_ALLOC(o = new LTCollisionCylinder( BenchRandom( seed, 4, 16 ), BenchRandom( seed, 4, 24 ), p, p, R, R, LTPhysSurf(), h ),LT_MEM_TYPE_PHYSICS);
+				break;
+			}
+		}
+
+		objects.push_back( o );
+		velocity.push_back( LTVector3f( BenchRandom( seed, -speed, speed ), BenchRandom( seed, -speed, speed ), BenchRandom( seed, -speed, speed ) ) );
+	}
+
+	r.m_Objects = count;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for( i=0 ; i<count ; i++ )
+		mgr.Add( objects[i] );
+
+	r.m_AddTime = BenchSeconds( start );
+
+	//room for every object to touch quite a few others
+	std::vector<LTCollisionPair> pairs( count * 16 );
+	int32 n = 0;
+
+	for( uint32 f=0 ; f<frames ; f++ )
+	{
+		start = std::chrono::steady_clock::now();
+
+		for( i=0 ; i<count ; i++ )
+		{
+			ILTCollisionObject* o = objects[i];
+
+			o->m_P0 = o->m_P1;
+			o->m_P1 += velocity[i];
+			mgr.Update( o );
+		}
+
+		r.m_UpdateTime += BenchSeconds( start );
+
+		start = std::chrono::steady_clock::now();
+
+		mgr.FindPairs( &pairs[0], n, (int32)pairs.size() );
+
+		r.m_PairTime += BenchSeconds( start );
+	}
+
+	r.m_Updates = count * frames;
+	r.m_Queries = frames;
+	r.m_Pairs = n;
+
+	//what FindPairs() should have found the last frame
+	start = std::chrono::steady_clock::now();
+
+	std::vector<LTAABB> bounds;
+	bounds.reserve( count );
+
+	for( i=0 ; i<count ; i++ )
+		bounds.push_back( SweptBounds( *objects[i] ) );
+
+	for( i=0 ; i<count ; i++ )
+	{
+		for( uint32 j=i+1 ; j<count ; j++ )
+		{
+			if( bounds[i].Intersects( bounds[j] ) )
+				r.m_BrutePairs++;
+		}
+	}
+
+	r.m_BruteTime = BenchSeconds( start );
+
+	//deletes the objects
+	mgr.Term();
+}
+#endif
+
+
 //EOF
@@ -5,9 +5,44 @@
 #include "collision_mgr.h"
 #endif
 
-#ifndef __LIST__
-#include <list>
-#define __LIST__
+#ifndef __LT_BROADPHASE_H__
+#include "lt_broadphase.h"
+#endif
+
+#ifndef __MAP__
+#include <map>
+#define __MAP__
+#endif
+
+#ifndef __VECTOR__
+#include <vector>
+#define __VECTOR__
+#endif
+
+
+#ifndef _FINAL
+//
+// Results from LTCollisionMgr::Benchmark()
+//
+struct LTCollisionBenchResults
+{
+	//boxes, spheres and cylinders, a third of each
+	uint32	m_Objects;
+	float	m_AddTime;		//seconds
+
+	//every object moving a little each frame
+	uint32	m_Updates;
+	float	m_UpdateTime;
+
+	//one FindPairs() each frame
+	uint32	m_Queries;
+	uint32	m_Pairs;		//found by the last FindPairs()
+	float	m_PairTime;
+
+	//testing every pair of objects against each other, once
+	uint32	m_BrutePairs;	//should be the same as m_Pairs
+	float	m_BruteTime;
+};
 #endif
 
 
@@ -18,8 +53,11 @@ class LTCollisionMgr : public ILTCollisionMgr
 {
 public:
 
-    //A doubly-linked list of ILTCollisionObject's
-    typedef std::list<ILTCollisionObject*> ObjectList;
+    //ILTCollisionObject's, in the order they were added
+    typedef std::vector<ILTCollisionObject*> ObjectArray;
+
+    //ILTCollisionObject's and their broadphase proxies
+    typedef std::map<ILTCollisionObject*,uint32> ProxyMap;
 
 public:
 
@@ -28,8 +66,15 @@ public:
     declare_interface(LTCollisionMgr);
 #endif
 
-    //A list of abstract collision objects
-    ObjectList m_Objects;
+    //The abstract collision objects in the database,
+    //kept in order so FindPairs() is the same every run
+    ObjectArray m_Objects;
+
+    //For looking up an object's proxy
+    ProxyMap m_Proxies;
+
+    //A dynamic AABB tree of the objects' swept bounds
+    LTBroadphase m_Broadphase;
 
 public:
 
@@ -80,8 +125,20 @@ public:
 		const LTIntersectInfo::Filter&		iif = LTIntersectInfo::EmptyFilter()
 	) const;
 
+	//find the pairs of objects whose bounds overlap
+	virtual bool FindPairs
+	(
+		LTCollisionPair						pairs[],
+		int32&								n,
+		const int32							sz,
+		const ILTCollisionObject::Filter&	of = ILTCollisionObject::EmptyFilter()
+	) const;
+
 	//add the collision object to the database
 	virtual void Add( ILTCollisionObject* o );
+
+	//the collision object moved, update its bounds
+	virtual void Update( ILTCollisionObject* o );
  
 	//find the collision object representing the LTObject
 	virtual ILTCollisionObject* Find( const HOBJECT h ) const;
@@ -97,6 +154,25 @@ public:
 	//Delete all ILTCollisionObject's.
 	virtual void Term();
 
+#ifndef _FINAL
+	//time Add(), Update() and FindPairs() on 'count' objects
+	//spread over an open area, moving for 'frames' frames
+	static void Benchmark
+	(
+		LTCollisionBenchResults&	r,
+		const uint32				count,
+		const uint32				frames
+	);
+#endif
+
+protected:
+
+	//remove m_Objects[i]
+	void RemoveAt( const uint32 i );
+
+	//assert that nothing moved without calling Update()
+	void CheckBounds() const;
+
 };
 
 
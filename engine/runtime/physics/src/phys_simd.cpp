@@ -0,0 +1,330 @@
+#include "phys_simd.h"
+
+#ifndef __MATH_PHYS_H__
+#include "math_phys.h"
+#endif
+
+#ifdef LT_PHYS_SSE
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#ifndef _FINAL
+#include "collision_object.h"
+#include "sphere.h"
+#include <chrono>
+#include <vector>
+#include <string.h>
+#endif
+
+
+//---------------------------------------------------------------------------//
+//ask the CPU, and for AVX the OS, which kernels can run
+static LTPhysSimd DetectPhysSimd()
+{
+	LTPhysSimd s = PHYS_SIMD_NONE;
+
+#ifdef LT_PHYS_SSE
+	uint32 a, b, c, d;//eax, ebx, ecx, edx
+
+#ifdef _MSC_VER
+	int32 info[4];
+
+	__cpuid( info, 1 );
+	a = info[0]; b = info[1]; c = info[2]; d = info[3];
+#else
+	if( !__get_cpuid( 1, &a, &b, &c, &d ) )
+		return s;
+#endif
+
+	if( d & (1<<26) )
+		s = PHYS_SIMD_SSE2;
+
+#ifdef LT_PHYS_AVX
+	//the CPU has AVX, and the OS saves the upper halves of the
+	//registers on a context switch (XCR0 bits 1 and 2)
+	if( s == PHYS_SIMD_SSE2 && (c & (1<<27)) && (c & (1<<28)) )
+	{
+#ifdef _MSC_VER
+		const uint32 xcr0 = (uint32)_xgetbv( 0 );
+#else
+		uint32 xcr0, xcr0_hi;
+
+		//xgetbv, spelled out for assemblers that don't know it
+		__asm__ __volatile__( ".byte 0x0f, 0x01, 0xd0" : "=a"(xcr0), "=d"(xcr0_hi) : "c"(0) );
+#endif
+
+		if( (xcr0 & 6) == 6 )
+			s = PHYS_SIMD_AVX;
+	}
+#endif//LT_PHYS_AVX
+#endif//LT_PHYS_SSE
+
+	return s;
+}
+
+
+//NOTE:  Until these are initialized, g_PhysSimd is 0 and
+//anything that runs a query gets the scalar kernels.
+static const LTPhysSimd g_PhysSimdSupported = DetectPhysSimd();
+LTPhysSimd g_PhysSimd = g_PhysSimdSupported;
+
+
+//---------------------------------------------------------------------------//
+LTPhysSimd PhysSimdSupported()
+{
+	return g_PhysSimdSupported;
+}
+
+
+//---------------------------------------------------------------------------//
+LTPhysSimd SetPhysSimd( const LTPhysSimd max )
+{
+	g_PhysSimd = Min( max, g_PhysSimdSupported );
+
+	return g_PhysSimd;
+}
+
+
+//---------------------------------------------------------------------------//
+const char* PhysSimdName( const LTPhysSimd s )
+{
+	switch( s )
+	{
+		case PHYS_SIMD_SSE2:	return "SSE2";
+		case PHYS_SIMD_AVX:		return "AVX";
+		default:				return "scalar";
+	}
+}
+
+
+#ifndef _FINAL
+
+//---------------------------------------------------------------------------//
+static float BenchRandom( uint32& seed, const float min, const float max )
+{
+	seed = seed*1664525 + 1013904223;
+
+	return min + (max - min) * float(seed >> 8) / float(1 << 24);
+}
+
+
+//---------------------------------------------------------------------------//
+static float BenchSeconds( const std::chrono::steady_clock::time_point& start )
+{
+	return std::chrono::duration<float>( std::chrono::steady_clock::now() - start ).count();
+}
+
+
+//---------------------------------------------------------------------------//
+//rolling terrain, so the queries find triangles at every angle
+static float BenchHeight( const float x, const float y )
+{
+	return 48 * sinf( x / 170 ) * cosf( y / 130 ) + 12 * sinf( (x + y) / 37 );
+}
+
+
+//---------------------------------------------------------------------------//
+//what one query found, to compare between kernels
+struct BenchQuery
+{
+	LTVector3f	m_P0, m_P1;		//sphere or box center
+	float		m_R;			//sphere radius
+	LTVector3f	m_Dim;			//box half-dimensions
+	LTOrientation	m_O;		//box orientation
+
+	float		m_U[2];			//sphere and box contacts
+	LTVector3f	m_N[2], m_P[2];
+	bool		m_I[2];			//sphere and box intersections
+	LTVector3f	m_T[2], m_IP[2];
+};
+
+
+//---------------------------------------------------------------------------//
+uint32 PhysSimdBenchmark
+(
+	LTPhysSimdBenchResults	r[PHYS_SIMD_COUNT],
+	const uint32			queries
+)
+{
+	const LTPhysSimd current = PhysSimd();
+	const uint32 side = 61;//vertices along each side of the terrain
+	const float spacing = 16;
+	uint32 i;
+
+	//the terrain
+	std::vector<LTVector3f> V;
+	std::vector<LTTriangle> tri;
+
+	for( uint32 y=0 ; y<side ; y++ )
+	{
+		for( uint32 x=0 ; x<side ; x++ )
+			V.push_back( LTVector3f( x*spacing, y*spacing, BenchHeight( x*spacing, y*spacing ) ) );
+	}
+
+	for( uint32 y=0 ; y+1<side ; y++ )
+	{
+		for( uint32 x=0 ; x+1<side ; x++ )
+		{
+			const uint16 v = uint16(y*side + x);
+
+			tri.push_back( LTTriangle( v, v+1, v+side+1 ) );
+			tri.push_back( LTTriangle( v, v+side+1, v+side ) );
+		}
+	}
+
+	const LTPhysSurf surf( 0, 0.5f, 0.3f, 0.2f, 0, uint16(tri.size() - 1) );
+	uint32 size;
+	LTCollisionData* pdata = BuildCollisionData( size, &surf, 1, &tri[0], uint16(tri.size()), &V[0], uint16(V.size()) );
+	const LTOrientation R;
+	const LTCollisionMesh mesh( pdata, LTVector3f(0,0,0), LTVector3f(0,0,0), R, R );
+
+	//spheres and boxes moving near the ground
+	std::vector<BenchQuery> q( queries );
+	const float extent = (side - 1) * spacing;
+	uint32 seed = 1;
+
+	for( i=0 ; i<queries ; i++ )
+	{
+		const float x = BenchRandom( seed, 0, extent );
+		const float y = BenchRandom( seed, 0, extent );
+		const float z = BenchHeight( x, y ) + BenchRandom( seed, -8, 32 );
+
+		q[i].m_P0 = LTVector3f( x, y, z );
+		q[i].m_P1 = q[i].m_P0 + LTVector3f( BenchRandom( seed, -16, 16 ), BenchRandom( seed, -16, 16 ), BenchRandom( seed, -32, 8 ) );
+		q[i].m_R = BenchRandom( seed, 4, 24 );
+		q[i].m_Dim = LTVector3f( BenchRandom( seed, 4, 24 ), BenchRandom( seed, 4, 24 ), BenchRandom( seed, 4, 24 ) );
+		q[i].m_O.Rotate( LTVector3f( BenchRandom( seed, -1, 1 ), BenchRandom( seed, -1, 1 ), BenchRandom( seed, -1, 1 ) ) );
+	}
+
+	//the first run's answers, which every other run should match
+	std::vector<BenchQuery> scalar;
+	const uint16 tc_max = 128;
+	std::vector<uint16> found( queries * tc_max );//each sphere's triangles
+	std::vector<uint16> count( queries );
+	uint16 ti[tc_max];
+	uint32 n = 0;//runs
+
+	for( int32 s=PHYS_SIMD_NONE ; s<=PhysSimdSupported() ; s++ )
+	{
+		LTPhysSimdBenchResults& res = r[n++];
+
+		memset( &res, 0, sizeof(res) );
+		res.m_Simd = SetPhysSimd( LTPhysSimd(s) );
+		res.m_Queries = queries;
+
+		const LTVector3f& min = pdata->m_Min;
+		const LTVector3f& max = pdata->m_Max;
+		const LTVector3f e = max - min;
+
+		//the AABB tree, on its own
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		for( i=0 ; i<queries ; i++ )
+		{
+			const float rad = q[i].m_R;
+
+			count[i] = 0;
+			AABBTreeBoxSweep( &found[i*tc_max], count[i], tc_max, min, max, pdata->Nodes(),
+								q[i].m_P0, q[i].m_P1, LTVector3f(rad,rad,rad) );
+		}
+
+		res.m_TreeTime = BenchSeconds( start );
+
+		//the sweep cull, on what the tree found
+		start = std::chrono::steady_clock::now();
+
+		for( i=0 ; i<queries ; i++ )
+		{
+			memcpy( ti, &found[i*tc_max], count[i]*sizeof(uint16) );
+			res.m_Kept += SphereTriangleSweepCull( ti, count[i], pdata->Triangles(), pdata->Vertices(),
+								min, e, q[i].m_P0, q[i].m_P1, q[i].m_R );
+		}
+
+		res.m_CullTime = BenchSeconds( start );
+
+		//whole sphere queries
+		start = std::chrono::steady_clock::now();
+
+		for( i=0 ; i<queries ; i++ )
+		{
+			BenchQuery& b = q[i];
+			const LTCollisionSphere sph( b.m_R, b.m_P0, b.m_P1 );
+			LTContactInfo ci;
+			LTIntersectInfo ii;
+
+			b.m_U[0] = sph.HitMesh( ci, mesh ) ? ci.m_U : 2;
+			b.m_N[0] = ci.m_N;
+			b.m_P[0] = ci.m_P;
+			b.m_I[0] = sph.IntersectMesh( ii, mesh );
+			b.m_T[0] = ii.m_T;
+			b.m_IP[0] = ii.m_P;
+		}
+
+		res.m_SphereTime = BenchSeconds( start );
+
+		//whole box queries
+		start = std::chrono::steady_clock::now();
+
+		for( i=0 ; i<queries ; i++ )
+		{
+			BenchQuery& b = q[i];
+			const LTCollisionBox box( b.m_Dim, b.m_P0, b.m_P1, b.m_O, b.m_O );
+			LTContactInfo ci;
+			LTIntersectInfo ii;
+
+			b.m_U[1] = box.HitMesh( ci, mesh ) ? ci.m_U : 2;
+			b.m_N[1] = ci.m_N;
+			b.m_P[1] = ci.m_P;
+			b.m_I[1] = box.IntersectMesh( ii, mesh );
+			b.m_T[1] = ii.m_T;
+			b.m_IP[1] = ii.m_P;
+		}
+
+		res.m_BoxTime = BenchSeconds( start );
+
+		//count what was found, and compare it to the first run
+		res.m_Same = true;
+
+		for( i=0 ; i<queries ; i++ )
+		{
+			const BenchQuery& b = q[i];
+
+			for( int32 k=0 ; k<2 ; k++ )
+			{
+				if( b.m_U[k] <= 1 )
+					res.m_Hits++;
+
+				if( b.m_I[k] )
+					res.m_Hits++;
+
+				if( !scalar.empty() )
+				{
+					const BenchQuery& a = scalar[i];
+
+					if( a.m_U[k] != b.m_U[k] || a.m_I[k] != b.m_I[k] )
+						res.m_Same = false;
+					else if( b.m_U[k] <= 1 && (a.m_N[k] != b.m_N[k] || a.m_P[k] != b.m_P[k]) )
+						res.m_Same = false;
+					else if( b.m_I[k] && (a.m_T[k] != b.m_T[k] || a.m_IP[k] != b.m_IP[k]) )
+						res.m_Same = false;
+				}
+			}
+		}
+
+		if( scalar.empty() )
+			scalar = q;
+	}
+
+	SetPhysSimd( current );
+
+	return n;
+}
+
+#endif//_FINAL
+
+
+//EOF
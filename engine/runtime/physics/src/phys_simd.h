@@ -0,0 +1,145 @@
+#ifndef __PHYS_SIMD_H__
+#define __PHYS_SIMD_H__
+
+#ifndef __VECTOR_H__
+#include "vector.h"
+#endif
+
+
+//The SSE2 and AVX kernels are compiled on every x86 target, and PhysSimd()
+//picks one when the query runs, from what the CPU and OS support.  The
+//build can't decide it:  the CMake projects build with /arch:IA32, and a
+//compile-time switch would leave them on the scalar code.  Anything else
+//only has the scalar versions, which give the same answers.
+#if defined(_M_IX86) || defined(_M_X64) || defined(_M_AMD64) || defined(__i386__) || defined(__x86_64__)
+#define LT_PHYS_SSE
+#endif
+
+//AVX intrinsics need VS2010 SP1 or a compiler with function target attributes
+#if defined(LT_PHYS_SSE) && (!defined(_MSC_VER) || _MSC_FULL_VER >= 160040219)
+#define LT_PHYS_AVX
+#endif
+
+
+//---------------------------------------------------------------------------//
+//Which kernels the physics queries use, best last
+enum LTPhysSimd
+{
+	PHYS_SIMD_NONE,
+	PHYS_SIMD_SSE2,
+	PHYS_SIMD_AVX,
+
+	PHYS_SIMD_COUNT
+};
+
+extern LTPhysSimd g_PhysSimd;
+
+//---------------------------------------------------------------------------//
+//the kernels the queries use right now
+inline LTPhysSimd PhysSimd()
+{
+	return g_PhysSimd;
+}
+
+//the best kernels this CPU, OS and build can run
+LTPhysSimd PhysSimdSupported();
+
+//use the best kernels up to 'max', for comparing them,
+//and return the ones that will actually be used
+LTPhysSimd SetPhysSimd( const LTPhysSimd max );
+
+//"scalar", "SSE2" or "AVX"
+const char* PhysSimdName( const LTPhysSimd s );
+
+
+#ifndef _FINAL
+//---------------------------------------------------------------------------//
+//Results from PhysSimdBenchmark(), for one set of kernels
+struct LTPhysSimdBenchResults
+{
+	LTPhysSimd	m_Simd;
+	uint32		m_Queries;		//spheres and boxes, one of each per query
+
+	//seconds
+	float		m_TreeTime;		//AABBTreeBoxSweep() for the spheres
+	float		m_CullTime;		//SphereTriangleSweepCull() on what it found
+	float		m_SphereTime;	//whole sphere HitMesh() and IntersectMesh()
+	float		m_BoxTime;		//whole box HitMesh() and IntersectMesh()
+
+	uint32		m_Kept;			//triangles the culls kept
+	uint32		m_Hits;			//contacts and intersections found
+	bool		m_Same;			//every answer matches the scalar run
+};
+
+//time spheres and boxes moving over a terrain mesh, with each set of
+//kernels this CPU supports, and return how many sets were timed
+uint32 PhysSimdBenchmark
+(
+	LTPhysSimdBenchResults	r[PHYS_SIMD_COUNT],
+	const uint32			queries
+);
+#endif
+
+
+#ifdef LT_PHYS_SSE
+
+//MSVC compiles intrinsics anywhere.  GCC only allows them in functions built
+//for the instruction set, so everything that touches a __m128 or a __m256 is
+//marked with the one it needs.
+#ifdef _MSC_VER
+#define LT_PHYS_TARGET_SSE2
+#define LT_PHYS_TARGET_AVX
+#else
+#define LT_PHYS_TARGET_SSE2	__attribute__((target("sse2")))
+#define LT_PHYS_TARGET_AVX	__attribute__((target("avx")))
+#endif
+
+#include <emmintrin.h>
+#ifdef LT_PHYS_AVX
+#include <immintrin.h>
+#endif
+
+
+//---------------------------------------------------------------------------//
+//x, y and z in lanes 0-2, 0 in lane 3
+LT_PHYS_TARGET_SSE2 inline __m128 SSELoad( const LTVector3f& v )
+{
+	return _mm_set_ps( 0, v.z, v.y, v.x );
+}
+
+
+//---------------------------------------------------------------------------//
+LT_PHYS_TARGET_SSE2 inline __m128 SSEAbs( const __m128& v )
+{
+	return _mm_andnot_ps( _mm_set1_ps(-0.f), v );
+}
+
+
+//---------------------------------------------------------------------------//
+//(y,z,x) and (z,x,y), for cross products
+LT_PHYS_TARGET_SSE2 inline __m128 SSE_YZX( const __m128& v )
+{
+	return _mm_shuffle_ps( v, v, _MM_SHUFFLE(3,0,2,1) );
+}
+
+LT_PHYS_TARGET_SSE2 inline __m128 SSE_ZXY( const __m128& v )
+{
+	return _mm_shuffle_ps( v, v, _MM_SHUFFLE(3,1,0,2) );
+}
+
+
+#ifdef LT_PHYS_AVX
+
+//---------------------------------------------------------------------------//
+LT_PHYS_TARGET_AVX inline __m256 AVXAbs( const __m256& v )
+{
+	return _mm256_andnot_ps( _mm256_set1_ps(-0.f), v );
+}
+
+#endif//LT_PHYS_AVX
+
+#endif//LT_PHYS_SSE
+
+
+#endif
+//EOF
@@ -1,5 +1,6 @@
 #include "sphere.h"
 #include "triangle.h"
+#include "phys_simd.h"
 #include <assert.h>
 
 
@@ -392,5 +393,490 @@ bool SphereSegmentIntersect
 	return false;//no intersection
 }
 
+//---------------------------------------------------------------------------//
+//The culls below compare plane distances that are computed a little
+//differently from the ones in the full tests, so they keep anything within
+//this fraction of the distances involved.
+const float CULL_TOLERANCE = 1.f/1024;
+
+
+//---------------------------------------------------------------------------//
+//distance from the triangle's plane to C, and how far it might be off
+static inline void triangle_plane_distance
+(
+	float&				d,
+	float&				tol,
+	const LTVector3f&	C,
+	const LTVector3f	v[3]
+)
+{
+	const LTVector3f n = (v[1] - v[0]).Cross(v[2] - v[0]);
+	const LTVector3f c = C - v[0];
+
+	d = n.Dot(c) / n.Length();
+	tol = CULL_TOLERANCE * (fabsf(c.x) + fabsf(c.y) + fabsf(c.z));
+}
+
+
+//---------------------------------------------------------------------------//
+//ALGORITHM:  SphereTriangleSweep() only reports hits if C0 is on the
+//triangle's + side (d0>=0).  Any hit, on the face, an edge or a vertex,
+//happens at a point within r of the plane, so if d0 and d1 are both
+//more than r, the sphere stayed too far away the whole time.
+static uint16 triangle_sweep_cull
+(
+	uint16				ti[],
+	const uint16		tc,
+	const LTTriangle	tri[],
+	const LTVector3u16	V[],
+	const LTVector3f&	min,
+	const LTVector3f&	e,
+	const LTVector3f&	C0,
+	const LTVector3f&	C1,
+	const float			r
+)
+{
+	const float s = 1 / float(0xFFFF);//scale factor
+	const float rr = r + CULL_TOLERANCE*r;
+	uint16 n = 0;//triangles kept
+
+	for( int32 i=0 ; i<tc ; i++ )
+	{
+		const LTTriangle& t = tri[ ti[i] ];
+		LTVector3f v[3];//unpacked vertices
+		float d0, d1, tol0, tol1;
+
+		v[0] = UnpackVector( V[t.v[0]], min, e, s );
+		v[1] = UnpackVector( V[t.v[1]], min, e, s );
+		v[2] = UnpackVector( V[t.v[2]], min, e, s );
+
+		triangle_plane_distance( d0, tol0, C0, v );
+		triangle_plane_distance( d1, tol1, C1, v );
+
+		if( d0 + tol0 >= 0 && Min( d0 - tol0, d1 - tol1 ) <= rr )
+			ti[n++] = ti[i];
+	}
+
+	return n;
+}
+
+
+//---------------------------------------------------------------------------//
+//ALGORITHM:  SphereTriangleIntersect() only looks
+//further if the plane is within r of C.
+static uint16 triangle_intersect_cull
+(
+	uint16				ti[],
+	const uint16		tc,
+	const LTTriangle	tri[],
+	const LTVector3u16	V[],
+	const LTVector3f&	min,
+	const LTVector3f&	e,
+	const LTVector3f&	C,
+	const float			r
+)
+{
+	const float s = 1 / float(0xFFFF);//scale factor
+	const float rr = r + CULL_TOLERANCE*r;
+	uint16 n = 0;//triangles kept
+
+	for( int32 i=0 ; i<tc ; i++ )
+	{
+		const LTTriangle& t = tri[ ti[i] ];
+		LTVector3f v[3];//unpacked vertices
+		float d, tol;
+
+		v[0] = UnpackVector( V[t.v[0]], min, e, s );
+		v[1] = UnpackVector( V[t.v[1]], min, e, s );
+		v[2] = UnpackVector( V[t.v[2]], min, e, s );
+
+		triangle_plane_distance( d, tol, C, v );
+
+		if( fabsf(d) - tol <= rr )
+			ti[n++] = ti[i];
+	}
+
+	return n;
+}
+
+
+#ifdef LT_PHYS_SSE
+
+//---------------------------------------------------------------------------//
+//Unit normals and first vertices of four triangles, one triangle per lane.
+//If there are fewer than four, the last lanes repeat the first triangle.
+struct SSETrianglePlanes
+{
+	__m128 nx, ny, nz;
+	__m128 x0, y0, z0;
+
+	LT_PHYS_TARGET_SSE2 SSETrianglePlanes
+	(
+		const uint16		ti[],
+		const int32			count,
+		const LTTriangle	tri[],
+		const LTVector3u16	V[],
+		const LTVector3f&	min,
+		const LTVector3f&	e
+	)
+	{
+		const float s = 1 / float(0xFFFF);//scale factor
+		LTVector3f v[4][3];//unpacked vertices
+
+		for( int32 i=0 ; i<4 ; i++ )
+		{
+			const LTTriangle& t = tri[ ti[ i<count ? i : 0 ] ];
+
+			v[i][0] = UnpackVector( V[t.v[0]], min, e, s );
+			v[i][1] = UnpackVector( V[t.v[1]], min, e, s );
+			v[i][2] = UnpackVector( V[t.v[2]], min, e, s );
+		}
+
+		x0 = _mm_set_ps( v[3][0].x, v[2][0].x, v[1][0].x, v[0][0].x );
+		y0 = _mm_set_ps( v[3][0].y, v[2][0].y, v[1][0].y, v[0][0].y );
+		z0 = _mm_set_ps( v[3][0].z, v[2][0].z, v[1][0].z, v[0][0].z );
+
+		//edges from v0
+		const __m128 ax = _mm_sub_ps( _mm_set_ps( v[3][1].x, v[2][1].x, v[1][1].x, v[0][1].x ), x0 );
+		const __m128 ay = _mm_sub_ps( _mm_set_ps( v[3][1].y, v[2][1].y, v[1][1].y, v[0][1].y ), y0 );
+		const __m128 az = _mm_sub_ps( _mm_set_ps( v[3][1].z, v[2][1].z, v[1][1].z, v[0][1].z ), z0 );
+		const __m128 bx = _mm_sub_ps( _mm_set_ps( v[3][2].x, v[2][2].x, v[1][2].x, v[0][2].x ), x0 );
+		const __m128 by = _mm_sub_ps( _mm_set_ps( v[3][2].y, v[2][2].y, v[1][2].y, v[0][2].y ), y0 );
+		const __m128 bz = _mm_sub_ps( _mm_set_ps( v[3][2].z, v[2][2].z, v[1][2].z, v[0][2].z ), z0 );
+
+		//a x b
+		nx = _mm_sub_ps( _mm_mul_ps( ay, bz ), _mm_mul_ps( az, by ) );
+		ny = _mm_sub_ps( _mm_mul_ps( az, bx ), _mm_mul_ps( ax, bz ) );
+		nz = _mm_sub_ps( _mm_mul_ps( ax, by ), _mm_mul_ps( ay, bx ) );
+
+		//NOTE:  degenerate triangles get NaN normals, so
+		//every comparison with their distances fails
+		const __m128 l = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( nx, nx ),
+											_mm_mul_ps( ny, ny ) ), _mm_mul_ps( nz, nz ) ) );
+
+		nx = _mm_div_ps( nx, l );
+		ny = _mm_div_ps( ny, l );
+		nz = _mm_div_ps( nz, l );
+	}
+
+	//distance from each plane to C, and how far it might be off
+	LT_PHYS_TARGET_SSE2 void Distance( __m128& d, __m128& tol, const LTVector3f& C ) const
+	{
+		const __m128 cx = _mm_sub_ps( _mm_set1_ps(C.x), x0 );
+		const __m128 cy = _mm_sub_ps( _mm_set1_ps(C.y), y0 );
+		const __m128 cz = _mm_sub_ps( _mm_set1_ps(C.z), z0 );
+
+		d = _mm_add_ps( _mm_add_ps( _mm_mul_ps( nx, cx ), _mm_mul_ps( ny, cy ) ), _mm_mul_ps( nz, cz ) );
+		tol = _mm_mul_ps( _mm_set1_ps(CULL_TOLERANCE),
+						  _mm_add_ps( _mm_add_ps( SSEAbs(cx), SSEAbs(cy) ), SSEAbs(cz) ) );
+	}
+};
+
+
+//---------------------------------------------------------------------------//
+LT_PHYS_TARGET_SSE2 static uint16 sse_triangle_sweep_cull
+(
+	uint16				ti[],
+	const uint16		tc,
+	const LTTriangle	tri[],
+	const LTVector3u16	V[],
+	const LTVector3f&	min,
+	const LTVector3f&	e,
+	const LTVector3f&	C0,
+	const LTVector3f&	C1,
+	const float			r
+)
+{
+	const __m128 rr = _mm_set1_ps( r + CULL_TOLERANCE*r );
+	uint16 n = 0;//triangles kept
+
+	for( int32 i=0 ; i<tc ; i+=4 )
+	{
+		const int32 count = Min( 4, tc - i );
+		const SSETrianglePlanes P( &ti[i], count, tri, V, min, e );
+		__m128 d0, d1, tol0, tol1;
+
+		P.Distance( d0, tol0, C0 );
+		P.Distance( d1, tol1, C1 );
+
+		const __m128 keep = _mm_and_ps
+		(
+			_mm_cmpge_ps( _mm_add_ps( d0, tol0 ), _mm_setzero_ps() ),
+			_mm_cmple_ps( _mm_min_ps( _mm_sub_ps( d0, tol0 ), _mm_sub_ps( d1, tol1 ) ), rr )
+		);
+		const int32 mask = _mm_movemask_ps( keep );
+
+		//compact the survivors, in order
+		for( int32 j=0 ; j<count ; j++ )
+			if( mask & (1<<j) )
+				ti[n++] = ti[i+j];
+	}
+
+	return n;
+}
+
+
+//---------------------------------------------------------------------------//
+LT_PHYS_TARGET_SSE2 static uint16 sse_triangle_intersect_cull
+(
+	uint16				ti[],
+	const uint16		tc,
+	const LTTriangle	tri[],
+	const LTVector3u16	V[],
+	const LTVector3f&	min,
+	const LTVector3f&	e,
+	const LTVector3f&	C,
+	const float			r
+)
+{
+	const __m128 rr = _mm_set1_ps( r + CULL_TOLERANCE*r );
+	uint16 n = 0;//triangles kept
+
+	for( int32 i=0 ; i<tc ; i+=4 )
+	{
+		const int32 count = Min( 4, tc - i );
+		const SSETrianglePlanes P( &ti[i], count, tri, V, min, e );
+		__m128 d, tol;
+
+		P.Distance( d, tol, C );
+
+		const int32 mask = _mm_movemask_ps( _mm_cmple_ps( _mm_sub_ps( SSEAbs(d), tol ), rr ) );
+
+		//compact the survivors, in order
+		for( int32 j=0 ; j<count ; j++ )
+			if( mask & (1<<j) )
+				ti[n++] = ti[i+j];
+	}
+
+	return n;
+}
+
+
+#ifdef LT_PHYS_AVX
+
+//---------------------------------------------------------------------------//
+//SSETrianglePlanes, eight triangles at a time
+struct AVXTrianglePlanes
+{
+	__m256 nx, ny, nz;
+	__m256 x0, y0, z0;
+
+	LT_PHYS_TARGET_AVX AVXTrianglePlanes
+	(
+		const uint16		ti[],
+		const int32			count,
+		const LTTriangle	tri[],
+		const LTVector3u16	V[],
+		const LTVector3f&	min,
+		const LTVector3f&	e
+	)
+	{
+		const float s = 1 / float(0xFFFF);//scale factor
+		float x[3][8], y[3][8], z[3][8];//unpacked vertices, by lane
+
+		for( int32 i=0 ; i<8 ; i++ )
+		{
+			const LTTriangle& t = tri[ ti[ i<count ? i : 0 ] ];
+
+			for( int32 k=0 ; k<3 ; k++ )
+			{
+				const LTVector3f v = UnpackVector( V[t.v[k]], min, e, s );
+
+				x[k][i] = v.x;
+				y[k][i] = v.y;
+				z[k][i] = v.z;
+			}
+		}
+
+		x0 = _mm256_loadu_ps( x[0] );
+		y0 = _mm256_loadu_ps( y[0] );
+		z0 = _mm256_loadu_ps( z[0] );
+
+		//edges from v0
+		const __m256 ax = _mm256_sub_ps( _mm256_loadu_ps( x[1] ), x0 );
+		const __m256 ay = _mm256_sub_ps( _mm256_loadu_ps( y[1] ), y0 );
+		const __m256 az = _mm256_sub_ps( _mm256_loadu_ps( z[1] ), z0 );
+		const __m256 bx = _mm256_sub_ps( _mm256_loadu_ps( x[2] ), x0 );
+		const __m256 by = _mm256_sub_ps( _mm256_loadu_ps( y[2] ), y0 );
+		const __m256 bz = _mm256_sub_ps( _mm256_loadu_ps( z[2] ), z0 );
+
+		//a x b
+		nx = _mm256_sub_ps( _mm256_mul_ps( ay, bz ), _mm256_mul_ps( az, by ) );
+		ny = _mm256_sub_ps( _mm256_mul_ps( az, bx ), _mm256_mul_ps( ax, bz ) );
+		nz = _mm256_sub_ps( _mm256_mul_ps( ax, by ), _mm256_mul_ps( ay, bx ) );
+
+		//NOTE:  degenerate triangles get NaN normals, so
+		//every comparison with their distances fails
+		const __m256 l = _mm256_sqrt_ps( _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( nx, nx ),
+											_mm256_mul_ps( ny, ny ) ), _mm256_mul_ps( nz, nz ) ) );
+
+		nx = _mm256_div_ps( nx, l );
+		ny = _mm256_div_ps( ny, l );
+		nz = _mm256_div_ps( nz, l );
+	}
+
+	//distance from each plane to C, and how far it might be off
+	LT_PHYS_TARGET_AVX void Distance( __m256& d, __m256& tol, const LTVector3f& C ) const
+	{
+		const __m256 cx = _mm256_sub_ps( _mm256_set1_ps(C.x), x0 );
+		const __m256 cy = _mm256_sub_ps( _mm256_set1_ps(C.y), y0 );
+		const __m256 cz = _mm256_sub_ps( _mm256_set1_ps(C.z), z0 );
+
+		d = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( nx, cx ), _mm256_mul_ps( ny, cy ) ), _mm256_mul_ps( nz, cz ) );
+		tol = _mm256_mul_ps( _mm256_set1_ps(CULL_TOLERANCE),
+							 _mm256_add_ps( _mm256_add_ps( AVXAbs(cx), AVXAbs(cy) ), AVXAbs(cz) ) );
+	}
+};
+
+
+//---------------------------------------------------------------------------//
+LT_PHYS_TARGET_AVX static uint16 avx_triangle_sweep_cull
+(
+	uint16				ti[],
+	const uint16		tc,
+	const LTTriangle	tri[],
+	const LTVector3u16	V[],
+	const LTVector3f&	min,
+	const LTVector3f&	e,
+	const LTVector3f&	C0,
+	const LTVector3f&	C1,
+	const float			r
+)
+{
+	const __m256 rr = _mm256_set1_ps( r + CULL_TOLERANCE*r );
+	uint16 n = 0;//triangles kept
+
+	for( int32 i=0 ; i<tc ; i+=8 )
+	{
+		const int32 count = Min( 8, tc - i );
+		const AVXTrianglePlanes P( &ti[i], count, tri, V, min, e );
+		__m256 d0, d1, tol0, tol1;
+
+		P.Distance( d0, tol0, C0 );
+		P.Distance( d1, tol1, C1 );
+
+		const __m256 keep = _mm256_and_ps
+		(
+			_mm256_cmp_ps( _mm256_add_ps( d0, tol0 ), _mm256_setzero_ps(), _CMP_GE_OQ ),
+			_mm256_cmp_ps( _mm256_min_ps( _mm256_sub_ps( d0, tol0 ), _mm256_sub_ps( d1, tol1 ) ), rr, _CMP_LE_OQ )
+		);
+		const int32 mask = _mm256_movemask_ps( keep );
+
+		//compact the survivors, in order
+		for( int32 j=0 ; j<count ; j++ )
+			if( mask & (1<<j) )
+				ti[n++] = ti[i+j];
+	}
+
+	//don't leave the upper halves dirty for SSE code
+	_mm256_zeroupper();
+
+	return n;
+}
+
+
+//---------------------------------------------------------------------------//
+LT_PHYS_TARGET_AVX static uint16 avx_triangle_intersect_cull
+(
+	uint16				ti[],
+	const uint16		tc,
+	const LTTriangle	tri[],
+	const LTVector3u16	V[],
+	const LTVector3f&	min,
+	const LTVector3f&	e,
+	const LTVector3f&	C,
+	const float			r
+)
+{
+	const __m256 rr = _mm256_set1_ps( r + CULL_TOLERANCE*r );
+	uint16 n = 0;//triangles kept
+
+	for( int32 i=0 ; i<tc ; i+=8 )
+	{
+		const int32 count = Min( 8, tc - i );
+		const AVXTrianglePlanes P( &ti[i], count, tri, V, min, e );
+		__m256 d, tol;
+
+		P.Distance( d, tol, C );
+
+		const int32 mask = _mm256_movemask_ps( _mm256_cmp_ps( _mm256_sub_ps( AVXAbs(d), tol ), rr, _CMP_LE_OQ ) );
+
+		//compact the survivors, in order
+		for( int32 j=0 ; j<count ; j++ )
+			if( mask & (1<<j) )
+				ti[n++] = ti[i+j];
+	}
+
+	//don't leave the upper halves dirty for SSE code
+	_mm256_zeroupper();
+
+	return n;
+}
+
+#endif//LT_PHYS_AVX
+
+#endif//LT_PHYS_SSE
+
+
+//---------------------------------------------------------------------------//
+uint16 SphereTriangleSweepCull
+(
+	uint16				ti[],	//triangle indices
+	const uint16		tc,		//index count
+	const LTTriangle	tri[],	//triangles
+	const LTVector3u16	V[],	//packed vertices
+	const LTVector3f&	min,	//vertex range
+	const LTVector3f&	e,
+	const LTVector3f&	C0,		//first sphere position
+	const LTVector3f&	C1,		//second sphere position
+	const float			r		//sphere radius
+)
+{
+	//run the widest kernel the CPU has
+	switch( PhysSimd() )
+	{
+#ifdef LT_PHYS_AVX
+		case PHYS_SIMD_AVX:
+			return avx_triangle_sweep_cull( ti, tc, tri, V, min, e, C0, C1, r );
+#endif
+#ifdef LT_PHYS_SSE
+		case PHYS_SIMD_SSE2:
+			return sse_triangle_sweep_cull( ti, tc, tri, V, min, e, C0, C1, r );
+#endif
+		default:
+			return triangle_sweep_cull( ti, tc, tri, V, min, e, C0, C1, r );
+	}
+}
+
+
+//---------------------------------------------------------------------------//
+uint16 SphereTriangleIntersectCull
+(
+	uint16				ti[],	//triangle indices
+	const uint16		tc,		//index count
+	const LTTriangle	tri[],	//triangles
+	const LTVector3u16	V[],	//packed vertices
+	const LTVector3f&	min,	//vertex range
+	const LTVector3f&	e,
+	const LTVector3f&	C,		//sphere position
+	const float			r		//sphere radius
+)
+{
+	//run the widest kernel the CPU has
+	switch( PhysSimd() )
+	{
+#ifdef LT_PHYS_AVX
+		case PHYS_SIMD_AVX:
+			return avx_triangle_intersect_cull( ti, tc, tri, V, min, e, C, r );
+#endif
+#ifdef LT_PHYS_SSE
+		case PHYS_SIMD_SSE2:
+			return sse_triangle_intersect_cull( ti, tc, tri, V, min, e, C, r );
+#endif
+		default:
+			return triangle_intersect_cull( ti, tc, tri, V, min, e, C, r );
+	}
+}
+
 
 //EOF
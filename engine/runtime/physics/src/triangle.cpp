@@ -1,5 +1,6 @@
 #include "triangle.h"
 #include "math_phys.h"
+#include "ltmem.h"
 
 
 //---------------------------------------------------------------------------//
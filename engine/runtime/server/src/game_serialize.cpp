@@ -842,8 +842,8 @@ static LTRESULT sm_CreateNextObject(ILTStream *pStream,
 	// Put it back in the sky..
 	if (tempInternalFlags & IFLAG_INSKY)
 	{
-		g_pServerMgr->m_SkyObjects[skyIndex] = pObj->m_ObjectID;
-		sm_SetSendSkyDef();
+		pObj->m_InternalFlags &= ~IFLAG_INSKY;
+		sm_AddObjectToSky(pObj, skyIndex);
 	}
 
 
@@ -16,8 +16,12 @@
 #include "ltmessage_server.h"
 #include "netmgr.h"
 #include "clienthack.h"
+#include "taskpool.h"
+#include "framearena.h"
 
 #include <queue>
+#include <vector>
+#include <algorithm>
 
 //------------------------------------------------------------------
 //------------------------------------------------------------------
@@ -59,10 +63,13 @@ struct UpdateInfo {
 	CPacket_Write	m_cUnguaranteed;
 	uint32			m_nTargetUpdateSize;
 	uint32			m_nUpdateTime;
+	SentList		*m_pPrevSentList;
+	SentList		*m_pCurSentList;	// The objects we're sending info on in this update
+	TDirtyTrackerList	m_aDirtyTrackers;	// Trackers to clean once the update is built
+	bool			m_bUseInterest;		// Only the objects in m_aInterest get sent
+	std::vector<LTObject*>	m_aInterest;	// The objects near the client's view position
 };
 
-SentList *g_pCurSentList;
-
 
 uint32 g_Ticks_ClientVis;
 
@@ -71,6 +78,10 @@ extern int32 g_CV_MeasurePackets;
 extern int32 g_bForceRemote;
 extern int32 g_CV_ConnTroubleCount;
 extern int32 g_CV_BandwidthTargetServer;
+extern int32 g_CV_ServerUpdateThreads;
+extern int32 g_CV_SnapshotDeltaServer;
+extern float g_CV_InterestRadius;
+extern float g_CV_InterestHysteresis;
 
 ILTStream* sm_FTOpenFn(FTServ *hServ, char *pFilename) 
 {
@@ -502,6 +513,10 @@ LTRESULT sm_UpdatePuttingInWorld(Client *pClient)
 			pInfo->m_nSoundFlags = 0;
 		}
 
+		// Start the delta snapshots over, since the objects are all new.
+		pClient->m_SnapshotDelta.Reset();
+		pClient->m_UnguaranteedSchedule.Reset();
+
 		pClient->m_State = CLIENT_INWORLD;
 	}
 
@@ -819,7 +834,8 @@ bool sm_FlushUpdate(UpdateInfo *pInfo, const CPacket_Read &cPacket, uint32 nPack
 }
 
 
-void WriteUnguaranteedInfo(LTObject *pObject, CPacket_Write &cPacket) 
+// pDelta is used to write the position if it's provided.
+void WriteUnguaranteedInfo(LTObject *pObject, CPacket_Write &cPacket, CSnapshotDeltaSender *pDelta) 
 {
 	uint32 flags = 0;
 
@@ -855,7 +871,16 @@ void WriteUnguaranteedInfo(LTObject *pObject, CPacket_Write &cPacket)
  	// Write position/rotation.
 	if (flags & UUF_POS)
 	{
-		CLTMessage_Write_Server::WriteCompPos(cPacket, pObject->GetPos());
+		if (pDelta)
+		{
+			CompWorldPos cCompPos;
+			world_bsp_server->EncodeCompressWorldPosition(&cCompPos, &pObject->GetPos());
+			pDelta->WritePos(cPacket, pObject->m_ObjectID, cCompPos);
+		}
+		else
+		{
+			CLTMessage_Write_Server::WriteCompPos(cPacket, pObject->GetPos());
+		}
 		bool bWriteVelocity = pObject->m_Velocity.MagSqr() > 0.00001f;
 		cPacket.Writebool(bWriteVelocity);
 		if (bWriteVelocity)
@@ -918,7 +943,7 @@ void sm_AddObjectChangeInfo(UpdateInfo *pInfo, LTObject *pObject, ObjInfo *pObjI
 	// Update the send time
 	pObjInfo->m_nLastSentG = pInfo->m_nUpdateTime;
 
-	AddObjectIdToSentList(g_pCurSentList, pObject->m_ObjectID);
+	AddObjectIdToSentList(pInfo->m_pCurSentList, pObject->m_ObjectID);
 
 	// Setup the packet with update info.
 	CPacket_Write cSubPacket;
@@ -1037,7 +1062,7 @@ void sm_SendSoundTracks(UpdateInfo *pInfo, CPacket_Write &cPacket)
 		pObjInfo = &pInfo->m_pClient->m_ObjInfos[GetLinkID(pSoundTrack->m_pIDLink)];
 
 		uint16 nNewId = (uint16)GetLinkID(pSoundTrack->m_pIDLink);
-		AddObjectIdToSentList( g_pCurSentList, nNewId );
+		AddObjectIdToSentList( pInfo->m_pCurSentList, nNewId );
 
 		// Setup the packet with update info.  If the client already told us the sound is done, then don't
 		// send it again...
@@ -1159,7 +1184,26 @@ struct CGuaranteedObjTrack
 	ObjInfo *m_pObjInfo;
 	float m_fPriority;
 };
-typedef std::priority_queue<CGuaranteedObjTrack> TGuaranteedObjQueue;
+typedef std::priority_queue<CGuaranteedObjTrack, CFrameArenaVector<CGuaranteedObjTrack> > TGuaranteedObjQueue;
+
+// Queues up the object for a remote client's guaranteed update if they should get it
+static inline void QueueGuaranteedObject(LTObject *pObject, UpdateInfo *pInfo, TGuaranteedObjQueue &aObjects)
+{
+	// Gotta check here too for objects not in the BSP.
+	if (!ShouldSendToClient(pInfo->m_pClient, pObject)) 
+		return;
+
+	// Don't send over the main world model
+	if (pObject->IsMainWorldModel()) 
+		return;
+
+	CGuaranteedObjTrack cCurObj;
+	cCurObj.m_pObject	= pObject;
+	cCurObj.m_pObjInfo	= &pInfo->m_pClient->m_ObjInfos[pObject->m_ObjectID];
+	cCurObj.m_fPriority = (float)(pInfo->m_nUpdateTime - cCurObj.m_pObjInfo->m_nLastSentG);
+
+	aObjects.push(cCurObj);
+}
 
 void SendAllObjectsGuaranteed(ObjectMgr *pObjectMgr, UpdateInfo *pInfo) 
 {
@@ -1196,32 +1240,29 @@ void SendAllObjectsGuaranteed(ObjectMgr *pObjectMgr, UpdateInfo *pInfo)
 	else
 	{
 		// Do this in priority order...
-		static TGuaranteedObjQueue aObjects;
+		CFrameArenaMark cArenaMark;
+		TGuaranteedObjQueue aObjects;
 
 		// Try not to use up the whole update...
 		uint32 nUpdateSizeRemaining = pInfo->m_nTargetUpdateSize / 2;
 
-		for (i=0; i < NUM_OBJECTTYPES; i++)
+		if (pInfo->m_bUseInterest)
 		{
-			pListHead = &pObjectMgr->m_ObjectLists[i].m_Head;
-			for (pCur=pListHead->m_pNext; pCur != pListHead; pCur=pCur->m_pNext)
+			// Just the ones nearby.  Everything else looks like it got removed.
+			for (i=0; i < pInfo->m_aInterest.size(); i++)
 			{
-				pObject = (LTObject*)pCur->m_pData;
-
-				// Gotta check here too for objects not in the BSP.
-				if (!ShouldSendToClient(pInfo->m_pClient, pObject)) 
-					continue;
-
-				// Don't send over the main world model
-				if (pObject->IsMainWorldModel()) 
-					continue;
-
-				CGuaranteedObjTrack cCurObj;
-				cCurObj.m_pObject	= pObject;
-				cCurObj.m_pObjInfo	= &pInfo->m_pClient->m_ObjInfos[pObject->m_ObjectID];
-				cCurObj.m_fPriority = (float)(pInfo->m_nUpdateTime - cCurObj.m_pObjInfo->m_nLastSentG);
-
-				aObjects.push(cCurObj);
+				QueueGuaranteedObject(pInfo->m_aInterest[i], pInfo, aObjects);
+			}
+		}
+		else
+		{
+			for (i=0; i < NUM_OBJECTTYPES; i++)
+			{
+				pListHead = &pObjectMgr->m_ObjectLists[i].m_Head;
+				for (pCur=pListHead->m_pNext; pCur != pListHead; pCur=pCur->m_pNext)
+				{
+					QueueGuaranteedObject((LTObject*)pCur->m_pData, pInfo, aObjects);
+				}
 			}
 		}
 
@@ -1246,7 +1287,7 @@ void SendAllObjectsGuaranteed(ObjectMgr *pObjectMgr, UpdateInfo *pInfo)
 			const CGuaranteedObjTrack &cCurObj = aObjects.top();
 
 			cCurObj.m_pObjInfo->m_ChangeFlags |= CF_SENTINFO;
-			AddObjectIdToSentList(g_pCurSentList, cCurObj.m_pObject->m_ObjectID);
+			AddObjectIdToSentList(pInfo->m_pCurSentList, cCurObj.m_pObject->m_ObjectID);
 
 			aObjects.pop();
 		}
@@ -1254,10 +1295,10 @@ void SendAllObjectsGuaranteed(ObjectMgr *pObjectMgr, UpdateInfo *pInfo)
 }
 
 //Handles writing out the unguaranteed data of an object as well as all of its attachments
-static void WriteUnguaranteedDataWithAttachments(LTObject* pObject, CPacket_Write& cUnguaranteed, const uint32 k_nUnguaranteedMask)
+static void WriteUnguaranteedDataWithAttachments(LTObject* pObject, CPacket_Write& cUnguaranteed, CSnapshotDeltaSender *pDelta, const uint32 k_nUnguaranteedMask)
 {
 	//write out the unguaranteed data for the object itself
-	WriteUnguaranteedInfo(pObject, cUnguaranteed);
+	WriteUnguaranteedInfo(pObject, cUnguaranteed, pDelta);
 
 	//now do the same for all the attached objects
 	for (Attachment *pAttachment = pObject->m_Attachments; pAttachment; pAttachment = pAttachment->m_pNext) 
@@ -1269,7 +1310,7 @@ static void WriteUnguaranteedDataWithAttachments(LTObject* pObject, CPacket_Writ
 		if ((pAttachedObj->sd->m_NetFlags & k_nUnguaranteedMask) == 0)
 			continue;
 
-		WriteUnguaranteedInfo(pAttachedObj, cUnguaranteed);
+		WriteUnguaranteedInfo(pAttachedObj, cUnguaranteed, pDelta);
 	}
 }
 
@@ -1294,23 +1335,462 @@ static void UpdateSendTimeWithAttachments(LTObject* pObject, UpdateInfo *pInfo,
 }
 
 
-struct CUnguaranteedObjTrack
+//mask representing all the flags that would indicate an object needing to be included
+//in an unguaranteed packet
+static const uint32 k_nUnguaranteedMask = (NETFLAG_POSUNGUARANTEED|NETFLAG_ROTUNGUARANTEED|NETFLAG_ANIMUNGUARANTEED);
+
+static const float k_fDistPriorityScale = 1.0f / 128.0f;
+
+// Snapshot of the objects with unguaranteed data, taken once per update and shared 
+// by all the remote clients.  The parts of the priority which don't depend on the 
+// client are folded into m_aWeight.  Each snapshot gets a serial number, and the
+// objects that changed since the one before are kept for the last few snapshots,
+// so the clients' schedules only have to rank those again.
+struct CUnguaranteedSnapshot
 {
-	bool operator<(const CUnguaranteedObjTrack &sOther) const { return m_fPriority < sOther.m_fPriority; }
-	LTObject *m_pObject;
-	float m_fPriority;
+	enum { 
+		k_nNoIndex = 0xFFFFFFFF,
+		// How many snapshots' worth of changes are kept
+		k_nChangeHistory = 8
+	};
+
+	CUnguaranteedSnapshot() : m_bValid(false), m_nSerial(0) {}
+
+	void Build(ObjectMgr *pObjectMgr);
+	void Clear() { m_bValid = false; }
+
+	uint32 GetCount() const { return (uint32)m_aObjects.size(); }
+
+	// Index of the object in the snapshot, or k_nNoIndex if it's not in there
+	uint32 GetIndex(uint16 nObjectID) const { return (nObjectID < m_aIndexByID.size()) ? m_aIndexByID[nObjectID] : k_nNoIndex; }
+
+	uint32 GetSerial() const { return m_nSerial; }
+	// The objects that changed between the snapshot before nSerial and nSerial.
+	// Only the last k_nChangeHistory snapshots are kept.
+	const std::vector<uint16> &GetChanges(uint32 nSerial) const { return m_aChanges[nSerial % k_nChangeHistory]; }
+
+	std::vector<LTObject*> m_aObjects;
+	std::vector<uint16> m_aObjectIDs;
+	std::vector<float> m_aPosX, m_aPosY, m_aPosZ;
+	std::vector<float> m_aWeight;	// Size * speed
+	std::vector<uint32> m_aIndexByID;
+	bool m_bValid;
+
+	uint32 m_nSerial;
+	std::vector<uint16> m_aChanges[k_nChangeHistory];
+	// Changes since the last snapshot (see sm_RecordUnguaranteedChanges)
+	std::vector<uint16> m_aPendingChanges;
 };
-typedef std::priority_queue<CUnguaranteedObjTrack> TUnguaranteedObjQueue;
+
+void CUnguaranteedSnapshot::Build(ObjectMgr *pObjectMgr)
+{
+	m_aObjects.clear();
+	m_aObjectIDs.clear();
+	m_aPosX.clear();
+	m_aPosY.clear();
+	m_aPosZ.clear();
+	m_aWeight.clear();
+	m_aIndexByID.clear();
+
+	// Serial 0 means "never" to the schedules
+	++m_nSerial;
+	if (!m_nSerial)
+		++m_nSerial;
+	m_aChanges[m_nSerial % k_nChangeHistory].swap(m_aPendingChanges);
+	m_aPendingChanges.clear();
+
+	for (uint32 i = 0; i < NUM_OBJECTTYPES; i++)
+	{
+		LTLink *pListHead = &pObjectMgr->m_ObjectLists[i].m_Head;
+		for (LTLink *pCur = pListHead->m_pNext; pCur != pListHead; pCur = pCur->m_pNext)
+		{
+			LTObject *pObject = (LTObject*)pCur->m_pData;
+
+			if ((pObject->sd->m_NetFlags & k_nUnguaranteedMask) == 0)
+				continue;
+
+			float fSize = pObject->m_Dims.MagSqr();
+			float fSpeed = (pObject->m_Velocity.Mag() * k_fDistPriorityScale) + 1.0f;
+
+			if (pObject->m_ObjectID >= m_aIndexByID.size())
+				m_aIndexByID.resize(pObject->m_ObjectID + 1, k_nNoIndex);
+			m_aIndexByID[pObject->m_ObjectID] = (uint32)m_aObjects.size();
+
+			m_aObjects.push_back(pObject);
+			m_aObjectIDs.push_back(pObject->m_ObjectID);
+			m_aPosX.push_back(pObject->m_Pos.x);
+			m_aPosY.push_back(pObject->m_Pos.y);
+			m_aPosZ.push_back(pObject->m_Pos.z);
+			m_aWeight.push_back(fSize * fSpeed);
+		}
+	}
+
+	m_bValid = true;
+}
+
+// How far the client's view can move before its schedule ranks everything again
+static const float k_fScheduleViewMoveDist = 1.0f / k_fDistPriorityScale;
+
+CUnguaranteedSchedule::CUnguaranteedSchedule()
+{
+	Reset();
+}
+
+void CUnguaranteedSchedule::Reset()
+{
+	UnlinkAll();
+	m_aTaken.clear();
+	m_aInterest.clear();
+	m_nSerial = 0;
+	m_nFullRankSerial = 0;
+	m_vRankViewPos.Init(0.0f, 0.0f, 0.0f);
+	m_bUsedInterest = false;
+}
+
+uint32 CUnguaranteedSchedule::GetBucket(float fRate)
+{
+	if (!(fRate > 0.0f))
+		return 0;
+
+	// Pull the exponent straight out of the float
+	uint32 nBits;
+	memcpy(&nBits, &fRate, sizeof(nBits));
+	int32 nExponent = (int32)((nBits >> 23) & 0xFF) - 127;
+
+	return (uint32)LTCLAMP(nExponent - k_nBucketExpBase + 1, 1, k_nNumBuckets - 1);
+}
+
+void CUnguaranteedSchedule::Link(uint16 nID)
+{
+	SEntry &cEntry = m_aEntries[nID];
+	uint32 nBucket = cEntry.m_nBucket;
+
+	// Most things going in were just sent, so look from the back
+	uint16 nPrev = m_aTail[nBucket];
+	while ((nPrev != k_nNoID) && ((int32)(m_aEntries[nPrev].m_nSentAt - cEntry.m_nSentAt) > 0))
+		nPrev = m_aEntries[nPrev].m_nPrev;
+
+	uint16 nNext = (nPrev != k_nNoID) ? m_aEntries[nPrev].m_nNext : m_aHead[nBucket];
+	cEntry.m_nPrev = nPrev;
+	cEntry.m_nNext = nNext;
+	if (nPrev != k_nNoID)
+		m_aEntries[nPrev].m_nNext = nID;
+	else
+		m_aHead[nBucket] = nID;
+	if (nNext != k_nNoID)
+		m_aEntries[nNext].m_nPrev = nID;
+	else
+		m_aTail[nBucket] = nID;
+}
+
+void CUnguaranteedSchedule::LinkFront(uint16 nID)
+{
+	SEntry &cEntry = m_aEntries[nID];
+	uint32 nBucket = cEntry.m_nBucket;
+
+	cEntry.m_nPrev = k_nNoID;
+	cEntry.m_nNext = m_aHead[nBucket];
+	if (cEntry.m_nNext != k_nNoID)
+		m_aEntries[cEntry.m_nNext].m_nPrev = nID;
+	else
+		m_aTail[nBucket] = nID;
+	m_aHead[nBucket] = nID;
+}
+
+void CUnguaranteedSchedule::Unlink(uint16 nID)
+{
+	SEntry &cEntry = m_aEntries[nID];
+	uint32 nBucket = cEntry.m_nBucket;
+
+	if (cEntry.m_nPrev != k_nNoID)
+		m_aEntries[cEntry.m_nPrev].m_nNext = cEntry.m_nNext;
+	else
+		m_aHead[nBucket] = cEntry.m_nNext;
+	if (cEntry.m_nNext != k_nNoID)
+		m_aEntries[cEntry.m_nNext].m_nPrev = cEntry.m_nPrev;
+	else
+		m_aTail[nBucket] = cEntry.m_nPrev;
+
+	cEntry.m_nPrev = cEntry.m_nNext = k_nNoID;
+}
+
+void CUnguaranteedSchedule::UnlinkAll()
+{
+	for (uint32 nCurEntry = 0; nCurEntry < m_aEntries.size(); ++nCurEntry)
+	{
+		m_aEntries[nCurEntry].m_pObject = LTNULL;
+		m_aEntries[nCurEntry].m_nPrev = m_aEntries[nCurEntry].m_nNext = k_nNoID;
+	}
+	for (uint32 nCurBucket = 0; nCurBucket < k_nNumBuckets; ++nCurBucket)
+	{
+		m_aHead[nCurBucket] = m_aTail[nCurBucket] = k_nNoID;
+	}
+}
+
+void CUnguaranteedSchedule::Rank(const CUnguaranteedSnapshot &cSnapshot, uint32 nIndex, const Client *pClient)
+{
+	uint16 nID = cSnapshot.m_aObjectIDs[nIndex];
+	SEntry &cEntry = m_aEntries[nID];
+
+	float fDX = cSnapshot.m_aPosX[nIndex] - pClient->m_ViewPos.x;
+	float fDY = cSnapshot.m_aPosY[nIndex] - pClient->m_ViewPos.y;
+	float fDZ = cSnapshot.m_aPosZ[nIndex] - pClient->m_ViewPos.z;
+	float fDistToClient = LTMAX((float)sqrt(fDX * fDX + fDY * fDY + fDZ * fDZ) * k_fDistPriorityScale, 1.0f);
+
+	cEntry.m_pObject = cSnapshot.m_aObjects[nIndex];
+	cEntry.m_fRate = cSnapshot.m_aWeight[nIndex] / fDistToClient;
+	cEntry.m_nBucket = (uint8)GetBucket(cEntry.m_fRate);
+	cEntry.m_nSentAt = pClient->m_ObjInfos[nID].m_nLastSentU;
+}
+
+void CUnguaranteedSchedule::Rerank(const CUnguaranteedSnapshot &cSnapshot, uint16 nID, const Client *pClient)
+{
+	SEntry &cEntry = m_aEntries[nID];
+	if (cEntry.m_pObject)
+	{
+		Unlink(nID);
+		cEntry.m_pObject = LTNULL;
+	}
+
+	// Gone, or out of sight
+	uint32 nIndex = cSnapshot.GetIndex(nID);
+	if ((nIndex == CUnguaranteedSnapshot::k_nNoIndex) || (m_bUsedInterest && !cEntry.m_bInterest))
+		return;
+
+	Rank(cSnapshot, nIndex, pClient);
+	Link(nID);
+}
+
+void CUnguaranteedSchedule::BeginUpdate(const CUnguaranteedSnapshot &cSnapshot, const Client *pClient, const std::vector<LTObject*> *pInterest)
+{
+	ASSERT(m_aTaken.empty());
+
+	if (m_aEntries.size() < g_pServerMgr->m_nObjInfos)
+	{
+		SEntry cEmpty;
+		memset(&cEmpty, 0, sizeof(cEmpty));
+		cEmpty.m_nPrev = cEmpty.m_nNext = k_nNoID;
+		// No LT_MEM_TRACK_ALLOC, this can be on one of the update threads
+		m_aEntries.resize(g_pServerMgr->m_nObjInfos, cEmpty);
+	}
+
+	uint32 nSerial = cSnapshot.GetSerial();
+	bool bUseInterest = (pInterest != LTNULL);
+	bool bFullRank = !m_nSerial ||
+		((nSerial - m_nSerial) >= CUnguaranteedSnapshot::k_nChangeHistory) ||
+		((nSerial - m_nFullRankSerial) >= k_nFullRankPeriod) ||
+		(bUseInterest != m_bUsedInterest) ||
+		(pClient->m_ViewPos.DistSqr(m_vRankViewPos) > k_fScheduleViewMoveDist * k_fScheduleViewMoveDist);
+	m_bUsedInterest = bUseInterest;
+
+	if (bUseInterest)
+	{
+		for (uint32 nCurObj = 0; nCurObj < pInterest->size(); ++nCurObj)
+		{
+			uint16 nID = (*pInterest)[nCurObj]->m_ObjectID;
+			if (!m_aEntries[nID].m_bInterest)
+			{
+				m_aEntries[nID].m_bInterest = true;
+				m_aInterest.push_back(nID);
+			}
+		}
+	}
+
+	if (bFullRank)
+	{
+		UnlinkAll();
+
+		// Everything goes in oldest first, so the lists end up in order
+		static thread_local std::vector<uint16> aRanked;
+		aRanked.clear();
+		if (bUseInterest)
+		{
+			for (uint32 nCurObj = 0; nCurObj < m_aInterest.size(); ++nCurObj)
+			{
+				uint32 nIndex = cSnapshot.GetIndex(m_aInterest[nCurObj]);
+				if (nIndex == CUnguaranteedSnapshot::k_nNoIndex)
+					continue;
+				Rank(cSnapshot, nIndex, pClient);
+				aRanked.push_back(m_aInterest[nCurObj]);
+			}
+		}
+		else
+		{
+			for (uint32 nIndex = 0; nIndex < cSnapshot.GetCount(); ++nIndex)
+			{
+				Rank(cSnapshot, nIndex, pClient);
+				aRanked.push_back(cSnapshot.m_aObjectIDs[nIndex]);
+			}
+		}
+
+		struct SOlderFirst
+		{
+			SOlderFirst(const std::vector<SEntry> &aEntries) : m_aEntries(aEntries) {}
+			bool operator()(uint16 nLeft, uint16 nRight) const { return (int32)(m_aEntries[nLeft].m_nSentAt - m_aEntries[nRight].m_nSentAt) < 0; }
+			const std::vector<SEntry> &m_aEntries;
+		};
+		std::sort(aRanked.begin(), aRanked.end(), SOlderFirst(m_aEntries));
+
+		for (uint32 nCurObj = 0; nCurObj < aRanked.size(); ++nCurObj)
+		{
+			Link(aRanked[nCurObj]);
+		}
+
+		m_nFullRankSerial = nSerial;
+		m_vRankViewPos = pClient->m_ViewPos;
+	}
+	else
+	{
+		// Rank the objects that changed since the last update
+		for (uint32 nCurSerial = m_nSerial + 1; nCurSerial != nSerial + 1; ++nCurSerial)
+		{
+			const std::vector<uint16> &aChanges = cSnapshot.GetChanges(nCurSerial);
+			for (uint32 nCurChange = 0; nCurChange < aChanges.size(); ++nCurChange)
+			{
+				Rerank(cSnapshot, aChanges[nCurChange], pClient);
+			}
+		}
+
+		// And the ones that just came into view
+		for (uint32 nCurObj = 0; nCurObj < m_aInterest.size(); ++nCurObj)
+		{
+			uint16 nID = m_aInterest[nCurObj];
+			uint32 nIndex = cSnapshot.GetIndex(nID);
+			if ((nIndex != CUnguaranteedSnapshot::k_nNoIndex) && (m_aEntries[nID].m_pObject != cSnapshot.m_aObjects[nIndex]))
+				Rerank(cSnapshot, nID, pClient);
+		}
+	}
+
+	m_nSerial = nSerial;
+}
+
+LTObject *CUnguaranteedSchedule::Pop(const CUnguaranteedSnapshot &cSnapshot, const ObjInfo *pObjInfos, uint32 nUpdateTime)
+{
+	uint16 nBestID = k_nNoID;
+	float fBestPriority = 0.0f;
+
+	for (uint32 nCurBucket = 0; nCurBucket < k_nNumBuckets; ++nCurBucket)
+	{
+		// Clean up the front of the list
+		uint16 nID;
+		while ((nID = m_aHead[nCurBucket]) != k_nNoID)
+		{
+			SEntry &cEntry = m_aEntries[nID];
+
+			// Drop the ones that are gone or out of sight
+			uint32 nIndex = cSnapshot.GetIndex(nID);
+			if ((nIndex == CUnguaranteedSnapshot::k_nNoIndex) || (cSnapshot.m_aObjects[nIndex] != cEntry.m_pObject) ||
+				(m_bUsedInterest && !cEntry.m_bInterest))
+			{
+				Unlink(nID);
+				cEntry.m_pObject = LTNULL;
+				continue;
+			}
+
+			// Move the ones that got sent some other way (i.e. as an attachment) to where they belong
+			if (pObjInfos[nID].m_nLastSentU != cEntry.m_nSentAt)
+			{
+				Unlink(nID);
+				cEntry.m_nSentAt = pObjInfos[nID].m_nLastSentU;
+				Link(nID);
+				continue;
+			}
+
+			break;
+		}
+
+		if (nID == k_nNoID)
+			continue;
+
+		// The oldest is the most important in each list
+		const SEntry &cEntry = m_aEntries[nID];
+		float fPriority = (float)(nUpdateTime - cEntry.m_nSentAt + 1) * cEntry.m_fRate;
+		if ((nBestID == k_nNoID) || (fPriority > fBestPriority))
+		{
+			nBestID = nID;
+			fBestPriority = fPriority;
+		}
+	}
+
+	if (nBestID == k_nNoID)
+		return LTNULL;
+
+	Unlink(nBestID);
+	m_aTaken.push_back(nBestID);
+	return m_aEntries[nBestID].m_pObject;
+}
+
+void CUnguaranteedSchedule::EndUpdate(const ObjInfo *pObjInfos)
+{
+	// Backwards, so the ones that didn't go out end up in the same order at the front
+	for (uint32 nCurTaken = (uint32)m_aTaken.size(); nCurTaken--; )
+	{
+		uint16 nID = m_aTaken[nCurTaken];
+		SEntry &cEntry = m_aEntries[nID];
+		if (pObjInfos[nID].m_nLastSentU != cEntry.m_nSentAt)
+		{
+			cEntry.m_nSentAt = pObjInfos[nID].m_nLastSentU;
+			Link(nID);
+		}
+		else
+		{
+			LinkFront(nID);
+		}
+	}
+	m_aTaken.clear();
+
+	for (uint32 nCurObj = 0; nCurObj < m_aInterest.size(); ++nCurObj)
+	{
+		m_aEntries[m_aInterest[nCurObj]].m_bInterest = false;
+	}
+	m_aInterest.clear();
+}
+
+static CUnguaranteedSnapshot g_UnguaranteedSnapshot;
+
+static void sm_BuildUnguaranteedSnapshot()
+{
+	// Only the remote clients use it
+	bool bAnyRemote = false;
+
+	LTLink *pListHead = &g_pServerMgr->m_Clients.m_Head;
+	for (LTLink *pCur = pListHead->m_pNext; pCur != pListHead; pCur = pCur->m_pNext) 
+	{
+		Client *pClient = (Client*)pCur->m_pData;
+		if ((pClient->m_State == CLIENT_INWORLD) && !(pClient->m_ClientFlags & CFLAG_LOCAL))
+		{
+			bAnyRemote = true;
+			break;
+		}
+	}
+
+	if (bAnyRemote)
+		g_UnguaranteedSnapshot.Build(&g_pServerMgr->m_ObjectMgr);
+	else
+		g_UnguaranteedSnapshot.Clear();
+}
+
+static void sm_ClearUnguaranteedSnapshot()
+{
+	g_UnguaranteedSnapshot.Clear();
+}
+
+void sm_RecordUnguaranteedChanges()
+{
+	std::vector<uint16> &aChanges = g_UnguaranteedSnapshot.m_aPendingChanges;
+
+	LTLink *pListHead = &g_pServerMgr->m_ChangedObjectHead.m_Head;
+	for (LTLink *pCur = pListHead->m_pNext; pCur != pListHead; pCur = pCur->m_pNext)
+	{
+		LT_MEM_TRACK_ALLOC(aChanges.push_back(((LTObject*)pCur->m_pData)->m_ObjectID), LT_MEM_TYPE_NETWORKING);
+	}
+}
 
 void SendAllObjectsUnguaranteed(ObjectMgr *pObjectMgr, UpdateInfo *pInfo) 
 {
 	//determine if we are dealing with a local client. 
 	bool bLocalClient = !!(pInfo->m_pClient->m_ClientFlags & CFLAG_LOCAL);
 
-	//mask representing all the flags that would indicate an object needing to be included
-	//in an unguaranteed packet
-	const uint32 k_nUnguaranteedMask = (NETFLAG_POSUNGUARANTEED|NETFLAG_ROTUNGUARANTEED|NETFLAG_ANIMUNGUARANTEED);
-
 	if(bLocalClient)
 	{
 		//we are on a local client, we don't need to do queuing, weighting, or anything, everything
@@ -1326,7 +1806,7 @@ void SendAllObjectsUnguaranteed(ObjectMgr *pObjectMgr, UpdateInfo *pInfo)
 					continue;
 
 				//write out all the unguaranteed data
-				WriteUnguaranteedDataWithAttachments(pObject, pInfo->m_cUnguaranteed, k_nUnguaranteedMask);
+				WriteUnguaranteedDataWithAttachments(pObject, pInfo->m_cUnguaranteed, LTNULL, k_nUnguaranteedMask);
 
 				// Update the send time
 				UpdateSendTimeWithAttachments(pObject, pInfo, k_nUnguaranteedMask);				
@@ -1343,65 +1823,44 @@ void SendAllObjectsUnguaranteed(ObjectMgr *pObjectMgr, UpdateInfo *pInfo)
 		
 		uint32 nUpdateSizeRemaining = pInfo->m_nTargetUpdateSize - pInfo->m_cPacket.Size();
 
-		// Do this in priority order...
-		static TUnguaranteedObjQueue aObjects;
+		ASSERT(g_UnguaranteedSnapshot.m_bValid);
 
-		uint32 nUnguaranteedLength = 0;
+		// Do this in priority order, only looking at the objects near the client if we're doing that
+		Client *pClient = pInfo->m_pClient;
+		CUnguaranteedSchedule &cSchedule = pClient->m_UnguaranteedSchedule;
+		cSchedule.BeginUpdate(g_UnguaranteedSnapshot, pClient, pInfo->m_bUseInterest ? &pInfo->m_aInterest : LTNULL);
 
-		const float k_fDistPriorityScale = 1.0f / 128.0f;
+		CSnapshotDeltaSender *pDelta = &pClient->m_SnapshotDelta;
 
-		for (uint32 i = 0; i < NUM_OBJECTTYPES; i++)
-		{
-			LTLink *pListHead = &pObjectMgr->m_ObjectLists[i].m_Head;
-			for (LTLink *pCur = pListHead->m_pNext; pCur != pListHead; pCur = pCur->m_pNext)
-			{
-				LTObject *pObject = (LTObject*)pCur->m_pData;
-
-				if ((pObject->sd->m_NetFlags & k_nUnguaranteedMask) == 0)
-					continue;
-
-
-				CUnguaranteedObjTrack cCurObj;
-				cCurObj.m_pObject = pObject;
-
-				//Determine the weight of this message based upon some rules
-				ObjInfo* pObjInfo = &pInfo->m_pClient->m_ObjInfos[pObject->m_ObjectID];
+		// Keep the header if the first object doesn't fit
+		uint32 nUnguaranteedLength = pInfo->m_cUnguaranteed.Size();
 
-				float fDistToClient = LTMAX(pObject->m_Pos.Dist(pInfo->m_pClient->m_ViewPos) * k_fDistPriorityScale, 1.0f);
-				float fTime = (float)(pInfo->m_nUpdateTime - pObjInfo->m_nLastSentU) + 1.0f;
-				float fSize = pObject->m_Dims.MagSqr();
-				float fSpeed = (pObject->m_Velocity.Mag() * k_fDistPriorityScale) + 1.0f;
-				cCurObj.m_fPriority = (fTime * fSize * fSpeed) / fDistToClient;
-
-				aObjects.push(cCurObj);
-			}
-		}
-
-		while (!aObjects.empty())
+		for (;;)
 		{
-			const CUnguaranteedObjTrack &cCurObj = aObjects.top();
+			LTObject *pObject = cSchedule.Pop(g_UnguaranteedSnapshot, pClient->m_ObjInfos, pInfo->m_nUpdateTime);
+			if (!pObject)
+				break;
 
 			//write out all the unguaranteed data
-			WriteUnguaranteedDataWithAttachments(cCurObj.m_pObject, pInfo->m_cUnguaranteed, k_nUnguaranteedMask);
+			WriteUnguaranteedDataWithAttachments(pObject, pInfo->m_cUnguaranteed, pDelta, k_nUnguaranteedMask);
 
 			// Jump out if we're sending too much...
 			if (pInfo->m_cUnguaranteed.Size() >= nUpdateSizeRemaining)
 			{
+				pDelta->DiscardPos();
 				break;
 			}
 			else
+			{
 				nUnguaranteedLength = pInfo->m_cUnguaranteed.Size();
+				pDelta->CommitPos();
+			}
 
 			// Update the send time
-			UpdateSendTimeWithAttachments(cCurObj.m_pObject, pInfo, k_nUnguaranteedMask);
-
-			// Next!
-			aObjects.pop();
+			UpdateSendTimeWithAttachments(pObject, pInfo, k_nUnguaranteedMask);
 		}
 
-		// Forget the left-overs
-		while (!aObjects.empty())
-			aObjects.pop();
+		cSchedule.EndUpdate(pClient->m_ObjInfos);
 
 		// Strip the end of the packet
 		if (nUnguaranteedLength != pInfo->m_cUnguaranteed.Size())
@@ -1413,28 +1872,27 @@ void SendAllObjectsUnguaranteed(ObjectMgr *pObjectMgr, UpdateInfo *pInfo)
 }
 
 
-void sm_UpdateClientInWorld(Client *pClient)
+// Sets up the update for a client.  Returns false if they don't get one this time around.
+static bool sm_BeginClientUpdate(Client *pClient, UpdateInfo *pInfo)
 {
 	// If the client's queue is backed up, wait until it's ok.
 	if (IsClientInTrouble(pClient))
 	{
-		return;
+		return false;
 	}
 
 	// If they're not in the world, they don't need to be updated...
 	if (pClient->m_State != CLIENT_INWORLD)
-		return;
+		return false;
 
 	// Init the update info
-	UpdateInfo updateInfo;
-	updateInfo.m_cPacket.Writeuint8(SMSG_UPDATE);
-	updateInfo.m_cUnguaranteed.Writeuint8(SMSG_UNGUARANTEEDUPDATE);
-	updateInfo.m_pClient = pClient;
+	pInfo->m_cPacket.Writeuint8(SMSG_UPDATE);
+	pInfo->m_pClient = pClient;
 
 	// Keep track of time
-	updateInfo.m_nUpdateTime = timeGetTime();
-	uint32 nTimeSinceUpdate = updateInfo.m_nUpdateTime - pClient->m_nLastUpdateTime;
-	pClient->m_nLastUpdateTime = updateInfo.m_nUpdateTime;
+	pInfo->m_nUpdateTime = timeGetTime();
+	uint32 nTimeSinceUpdate = pInfo->m_nUpdateTime - pClient->m_nLastUpdateTime;
+	pClient->m_nLastUpdateTime = pInfo->m_nUpdateTime;
 
 	// Get the available bandwidth
 	// Note : We're more interested in multi-frame bandwidth usage.
@@ -1443,36 +1901,105 @@ void sm_UpdateClientInWorld(Client *pClient)
 	if (nAvailableBandwidth <= 0)
 	{
 		// Don't update them if we're choking
-		return;
+		return false;
 	}
-	updateInfo.m_nTargetUpdateSize = (uint32)nAvailableBandwidth;
+	pInfo->m_nTargetUpdateSize = (uint32)nAvailableBandwidth;
+
+	// Remote clients that asked for it get delta compressed positions
+	if (pClient->m_ClientFlags & CFLAG_LOCAL)
+		pInfo->m_cUnguaranteed.Writeuint8(SMSG_UNGUARANTEEDUPDATE);
+	else
+		pClient->m_SnapshotDelta.BeginSnapshot(pInfo->m_cUnguaranteed, g_CV_SnapshotDeltaServer && pClient->m_SnapshotDelta.IsEnabled());
 
-	SentList *pPrevList = &pClient->m_SentLists[pClient->m_iPrevSentList];
-	SentList *pCurList = &pClient->m_SentLists[!pClient->m_iPrevSentList];
-	g_pCurSentList = pCurList;
+	pInfo->m_pPrevSentList = &pClient->m_SentLists[pClient->m_iPrevSentList];
+	pInfo->m_pCurSentList = &pClient->m_SentLists[!pClient->m_iPrevSentList];
 
 	// Clear the CF_SENTINFO flag on all the objects we sent info on earlier.
-	for (uint32 i = 0; i < pPrevList->m_nObjectIDs; i++)
+	for (uint32 i = 0; i < pInfo->m_pPrevSentList->m_nObjectIDs; i++)
 	{
-		pClient->m_ObjInfos[pPrevList->m_ObjectIDs[i]].m_ChangeFlags &= ~CF_SENTINFO;
+		pClient->m_ObjInfos[pInfo->m_pPrevSentList->m_ObjectIDs[i]].m_ChangeFlags &= ~CF_SENTINFO;
 	}
 
 	// Build the new SentInfo list.
-	pCurList->m_nObjectIDs = 0;
+	pInfo->m_pCurSentList->m_nObjectIDs = 0;
 
-#ifdef USE_LOCAL_STUFF
-	if (!(pClient->m_ClientFlags & CFLAG_LOCAL))
-#endif
+	return true;
+}
+
+// Finds the objects near a remote client's view position, if InterestRadius is set.
+static void sm_GatherInterestingObjects(UpdateInfo *pInfo)
+{
+	Client *pClient = pInfo->m_pClient;
+
+	pInfo->m_aInterest.clear();
+	pInfo->m_bUseInterest = !(pClient->m_ClientFlags & CFLAG_LOCAL) && (g_CV_InterestRadius > 0.0f);
+	if (!pInfo->m_bUseInterest)
+		return;
+
+	// Objects the client already has get to stay a bit further out, so they don't
+	// keep getting removed and re-created at the edge
+	float fRadius = g_CV_InterestRadius;
+	float fKeepRadius = fRadius * (1.0f + LTMAX(g_CV_InterestHysteresis, 0.0f));
+	float fRadiusSqr = fRadius * fRadius;
+	float fKeepRadiusSqr = fKeepRadius * fKeepRadius;
+
+	static thread_local std::vector<LTObject*> aNearby;
+	aNearby.clear();
+	g_pServerMgr->m_InterestGrid.Query(pClient->m_ViewPos, fKeepRadius, aNearby);
+
+	bool bHaveClientObject = false;
+	for (uint32 nCurObj = 0; nCurObj < aNearby.size(); ++nCurObj)
 	{
-		// Activate everything they can see.
-		{
-			CountAdder cTicks_ClientVis(&g_Ticks_ClientVis);
+		LTObject *pObject = aNearby[nCurObj];
 
-			// Send all the alive objects to the client
-			SendAllObjectsGuaranteed(&g_pServerMgr->m_ObjectMgr, &updateInfo);
+		if (pObject == pClient->m_pObject)
+		{
+			bHaveClientObject = true;
 		}
+		else if (!CInterestGrid::IsGlobal(pObject))
+		{
+			float fDistSqr = pObject->GetPos().DistSqr(pClient->m_ViewPos);
+			if (fDistSqr > fKeepRadiusSqr)
+				continue;
+			if ((fDistSqr > fRadiusSqr) && (pClient->m_ObjInfos[pObject->m_ObjectID].m_ChangeFlags & CF_NEWOBJECT))
+				continue;
+		}
+
+		pInfo->m_aInterest.push_back(pObject);
+	}
+
+	// They always get their own object, even if the camera's somewhere else
+	if (pClient->m_pObject && !bHaveClientObject)
+		pInfo->m_aInterest.push_back(pClient->m_pObject);
+}
+
+// Writes the guaranteed object info.  This only touches the client's own state
+// and packets, so it runs on the task pool.
+static void sm_BuildClientUpdate_Objects(void *pUser, uint32 nTask)
+{
+	UpdateInfo *pInfo = ((UpdateInfo**)pUser)[nTask];
+
+	sm_SetDirtyTrackerList(&pInfo->m_aDirtyTrackers);
+
+	sm_GatherInterestingObjects(pInfo);
+
+#ifdef USE_LOCAL_STUFF
+	if (!(pInfo->m_pClient->m_ClientFlags & CFLAG_LOCAL))
+#endif
+	{
+		// Send all the alive objects to the client
+		SendAllObjectsGuaranteed(&g_pServerMgr->m_ObjectMgr, pInfo);
 	}
 
+	sm_SetDirtyTrackerList(LTNULL);
+}
+
+// Writes the events, sounds and removes.  These change the events and sound 
+// tracks, which are shared between the clients, so this runs on the server thread.
+static void sm_BuildClientUpdate_Events(UpdateInfo *pInfo)
+{
+	Client *pClient = pInfo->m_pClient;
+
 	// Add all the event subpackets.
 	LTLink *pCur = pClient->m_Events.m_Head.m_pNext;
 	while (pCur != &pClient->m_Events.m_Head)
@@ -1480,7 +2007,7 @@ void sm_UpdateClientInWorld(Client *pClient)
 		LTLink *pNext = pCur->m_pNext;
 	 	CServerEvent *pEvent = (CServerEvent*)pCur->m_pData;
 	
-		WriteEventToPacket(pEvent, pClient, updateInfo.m_cPacket);
+		WriteEventToPacket(pEvent, pClient, pInfo->m_cPacket);
 
 		dl_RemoveAt(&pClient->m_Events, pCur);
 		pEvent->DecrementRefCount();
@@ -1489,23 +2016,42 @@ void sm_UpdateClientInWorld(Client *pClient)
 	}
 
  	// Send sound tracking data.
-	sm_SendSoundTracks(&updateInfo, updateInfo.m_cPacket);
+	sm_SendSoundTracks(pInfo, pInfo->m_cPacket);
 	
 	// Write the list of objects to remove (objects we didn't send info on).
-	WriteObjectRemoves(&updateInfo, pPrevList);
+	WriteObjectRemoves(pInfo, pInfo->m_pPrevSentList);
 
 	// Clear out the change status on all the sound objects
-	ClearSoundChangeFlags(&updateInfo);
+	ClearSoundChangeFlags(pInfo);
+}
+
+// Writes the unguaranteed object info.  Runs on the task pool.
+static void sm_BuildClientUpdate_Unguaranteed(void *pUser, uint32 nTask)
+{
+	UpdateInfo *pInfo = ((UpdateInfo**)pUser)[nTask];
+
+	sm_SetDirtyTrackerList(&pInfo->m_aDirtyTrackers);
 
 	// Write unguaranteed stuff. 
-	SendAllObjectsUnguaranteed(&g_pServerMgr->m_ObjectMgr, &updateInfo);
+	SendAllObjectsUnguaranteed(&g_pServerMgr->m_ObjectMgr, pInfo);
 
 	// Mark the end of the unguaranteed info
-	WriteEndUpdateInfo(pClient, updateInfo.m_cUnguaranteed);
+	WriteEndUpdateInfo(pInfo->m_pClient, pInfo->m_cUnguaranteed);
+
+	if (!(pInfo->m_pClient->m_ClientFlags & CFLAG_LOCAL))
+		pInfo->m_pClient->m_SnapshotDelta.EndSnapshot(pInfo->m_cUnguaranteed.Size(), pInfo->m_nUpdateTime);
+
+	sm_SetDirtyTrackerList(LTNULL);
+}
+
+// Sends the update off to the client
+static void sm_EndClientUpdate(UpdateInfo *pInfo)
+{
+	Client *pClient = pInfo->m_pClient;
 
 	// Send them..
-	sm_FlushUpdate(&updateInfo, CPacket_Read(updateInfo.m_cPacket), MESSAGE_GUARANTEED);
-	sm_FlushUpdate(&updateInfo, CPacket_Read(updateInfo.m_cUnguaranteed), 0);
+	sm_FlushUpdate(pInfo, CPacket_Read(pInfo->m_cPacket), MESSAGE_GUARANTEED);
+	sm_FlushUpdate(pInfo, CPacket_Read(pInfo->m_cUnguaranteed), 0);
 
 	pClient->m_iPrevSentList = !pClient->m_iPrevSentList; // Swap this..
 
@@ -1524,6 +2070,182 @@ void sm_UpdateClientInWorld(Client *pClient)
 	}
 }
 
+// The threads used for building the client updates
+static CTaskPool g_ClientUpdatePool;
+static bool g_bClientUpdatePoolInit = false;
+
+// Get the client update pool going with the number of threads asked for in
+// ServerUpdateThreads
+static CTaskPool *sm_GetClientUpdatePool()
+{
+	uint32 nNumWorkers;
+#ifdef LTMEMTRACK
+	// The memory tracking isn't thread safe
+	nNumWorkers = 0;
+#else
+	if (g_CV_ServerUpdateThreads <= 0)
+		nNumWorkers = CTaskPool::GetDefaultNumWorkers();
+	else
+		nNumWorkers = (uint32)g_CV_ServerUpdateThreads - 1;
+#endif
+
+	if (!g_bClientUpdatePoolInit || (g_ClientUpdatePool.GetNumWorkers() != nNumWorkers))
+	{
+		g_ClientUpdatePool.Init(nNumWorkers);
+		g_bClientUpdatePoolInit = true;
+	}
+
+	return &g_ClientUpdatePool;
+}
+
+// The update infos are kept from frame to frame, so their packets and lists
+// don't have to be reallocated for every client on every update
+static std::vector<UpdateInfo*> g_aUpdateInfos;
+
+static UpdateInfo *sm_GetUpdateInfo(uint32 nIndex)
+{
+	while (g_aUpdateInfos.size() <= nIndex)
+	{
+		UpdateInfo *pInfo;
+		LT_MEM_TRACK_ALLOC(pInfo = new UpdateInfo, LT_MEM_TYPE_NETWORKING);
+		LT_MEM_TRACK_ALLOC(g_aUpdateInfos.push_back(pInfo), LT_MEM_TYPE_NETWORKING);
+	}
+	return g_aUpdateInfos[nIndex];
+}
+
+// Forget anything written to an update which isn't going to be sent
+static void sm_ResetUpdateInfo(UpdateInfo *pInfo)
+{
+	pInfo->m_cPacket.Reset();
+	pInfo->m_cUnguaranteed.Reset();
+}
+
+void sm_TermClientUpdatePool()
+{
+	g_ClientUpdatePool.Term();
+	g_bClientUpdatePoolInit = false;
+
+	for (uint32 nCurInfo = 0; nCurInfo < g_aUpdateInfos.size(); ++nCurInfo)
+	{
+		delete g_aUpdateInfos[nCurInfo];
+	}
+	g_aUpdateInfos.clear();
+}
+
+// Builds and sends this frame's client updates.  Returns how many were sent.
+static uint32 sm_BuildClientUpdates(LTList *pClientList)
+{
+	static std::vector<UpdateInfo*> aUpdates;
+
+	// Figure out who's getting an update
+	LTLink *pListHead = &pClientList->m_Head;
+	for (LTLink *pCur = pListHead->m_pNext; pCur != pListHead; pCur = pCur->m_pNext) 
+	{
+		Client *pClient = (Client*)pCur->m_pData;
+
+		UpdateInfo *pInfo = sm_GetUpdateInfo(aUpdates.size());
+		if (sm_BeginClientUpdate(pClient, pInfo))
+			aUpdates.push_back(pInfo);
+		else
+			sm_ResetUpdateInfo(pInfo);
+	}
+
+	if (aUpdates.empty())
+		return 0;
+
+	sm_BuildUnguaranteedSnapshot();
+
+	CTaskPool *pPool = sm_GetClientUpdatePool();
+	uint32 nNumUpdates = (uint32)aUpdates.size();
+
+	// Activate everything they can see.
+	{
+		CountAdder cTicks_ClientVis(&g_Ticks_ClientVis);
+		pPool->Run(nNumUpdates, sm_BuildClientUpdate_Objects, &aUpdates[0]);
+	}
+
+	for (uint32 nCurUpdate = 0; nCurUpdate < nNumUpdates; ++nCurUpdate)
+	{
+		sm_BuildClientUpdate_Events(aUpdates[nCurUpdate]);
+	}
+
+	pPool->Run(nNumUpdates, sm_BuildClientUpdate_Unguaranteed, &aUpdates[0]);
+
+	sm_ClearUnguaranteedSnapshot();
+
+	// Send them in order, and clean up
+	for (uint32 nCurUpdate = 0; nCurUpdate < nNumUpdates; ++nCurUpdate)
+	{
+		UpdateInfo *pInfo = aUpdates[nCurUpdate];
+
+		sm_EndClientUpdate(pInfo);
+		sm_CleanDirtyTrackers(pInfo->m_aDirtyTrackers);
+	}
+
+	aUpdates.clear();
+
+	return nNumUpdates;
+}
+
+// What PacketStats bench measures: the packet allocations made by the real
+// client updates, over the next few frames that send any
+struct SClientUpdateBench
+{
+	uint32 m_nFramesLeft;
+	uint32 m_nFrames;
+	uint32 m_nUpdates;
+	uint32 m_nTime;
+	uint32 m_nAllocCalls;
+	uint32 m_nHeapAllocs;
+	uint32 m_nReservedBytes;
+};
+static SClientUpdateBench g_ClientUpdateBench = { 0 };
+
+void sm_BenchClientUpdates(uint32 nFrames)
+{
+	memset(&g_ClientUpdateBench, 0, sizeof(g_ClientUpdateBench));
+	g_ClientUpdateBench.m_nFramesLeft = nFrames;
+}
+
+void sm_SendClientUpdates(LTList *pClientList)
+{
+	if (!g_ClientUpdateBench.m_nFramesLeft)
+	{
+		sm_BuildClientUpdates(pClientList);
+		return;
+	}
+
+	SPacketAllocStats startStats, endStats;
+	CPacket_Data::GetAllocStats(&startStats);
+	uint32 nStartTime = timeGetTime();
+
+	uint32 nNumUpdates = sm_BuildClientUpdates(pClientList);
+
+	uint32 nTime = timeGetTime() - nStartTime;
+	CPacket_Data::GetAllocStats(&endStats);
+
+	// Frames that don't update anybody don't count
+	if (!nNumUpdates)
+		return;
+
+	SClientUpdateBench &cBench = g_ClientUpdateBench;
+	++cBench.m_nFrames;
+	cBench.m_nUpdates += nNumUpdates;
+	cBench.m_nTime += nTime;
+	cBench.m_nAllocCalls += endStats.m_nAllocCalls - startStats.m_nAllocCalls;
+	cBench.m_nHeapAllocs += endStats.m_nHeapAllocs - startStats.m_nHeapAllocs;
+	cBench.m_nReservedBytes += endStats.m_nReservedBytes - startStats.m_nReservedBytes;
+
+	if (--cBench.m_nFramesLeft)
+		return;
+
+	float fFrames = (float)cBench.m_nFrames;
+	dsi_ConsolePrint("%u update frames (%u client updates) in %ums, %.2fms each", cBench.m_nFrames, cBench.m_nUpdates,
+		cBench.m_nTime, (float)cBench.m_nTime / fFrames);
+	dsi_ConsolePrint("Per frame: %.1f packet allocations, %.2f heap allocations (%.0f bytes reserved)",
+		(float)cBench.m_nAllocCalls / fFrames, (float)cBench.m_nHeapAllocs / fFrames, (float)cBench.m_nReservedBytes / fFrames);
+}
+
 
 Client* sm_FindClient(CBaseConn *connID)
 {
@@ -1602,6 +2324,29 @@ void sm_TellClientAboutGlobalLight(Client *pClient)
 
 
 
+LTRESULT sm_AddObjectToSky(LTObject *pObject, uint32 index)
+{
+	// Is it already in the sky?
+	if (pObject->m_InternalFlags & IFLAG_INSKY)
+	{
+		return LT_OK;
+	}
+
+	// Whatever had this slot isn't in the sky any more
+	LTObject *pPrevObject = (g_pServerMgr->m_SkyObjects[index] != 0xFFFF) ? sm_FindObject(g_pServerMgr->m_SkyObjects[index]) : LTNULL;
+	if (pPrevObject)
+	{
+		sm_RemoveObjectFromSky(pPrevObject);
+	}
+
+	pObject->m_InternalFlags |= IFLAG_INSKY;
+	g_pServerMgr->m_InterestGrid.UpdateObject(pObject);
+	g_pServerMgr->m_SkyObjects[index] = pObject->m_ObjectID;
+	sm_SetSendSkyDef();
+
+	return LT_OK;
+}
+
 LTRESULT sm_RemoveObjectFromSky(LTObject *pObject)
 {
 	uint32 i;
@@ -1613,6 +2358,7 @@ LTRESULT sm_RemoveObjectFromSky(LTObject *pObject)
 	}
 
 	pObject->m_InternalFlags &= ~IFLAG_INSKY;
+	g_pServerMgr->m_InterestGrid.UpdateObject(pObject);
 
 	sm_SetSendSkyDef();
 	for (i=0; i < MAX_SKYOBJECTS; i++)
@@ -6,6 +6,7 @@
 
 #include "packet.h"
 #include "systimer.h"
+#include "snapshotdelta.h"
 
 #ifndef __PACKETDEFS_H__
 #include "packetdefs.h"
@@ -96,6 +97,80 @@ struct ObjInfo
 #define OBJINFOSOUNDF_CLIENTDONE	(1<<0)		// Sound track has completed on this client
 
 
+struct CUnguaranteedSnapshot;
+struct Client;
+
+// A client's unguaranteed update order, kept from update to update.  The objects
+// are kept in lists by how fast their priority grows, each list in the order
+// they were last sent, so an object that hasn't changed just gets older instead
+// of being ranked again.  Only the objects that changed since the last update are
+// ranked again, plus all of them every so often.  See SendAllObjectsUnguaranteed.
+class CUnguaranteedSchedule
+{
+public:
+	CUnguaranteedSchedule();
+
+	// Forget the ranks, so the next update ranks every object
+	void Reset();
+
+	// Bring the lists up to date for an update.  pInterest is the objects the
+	// client can see, or LTNULL if it can see everything.
+	void BeginUpdate(const CUnguaranteedSnapshot &cSnapshot, const Client *pClient, const std::vector<LTObject*> *pInterest);
+	// Take the highest priority object out of the lists, or LTNULL when there aren't any more
+	LTObject *Pop(const CUnguaranteedSnapshot &cSnapshot, const ObjInfo *pObjInfos, uint32 nUpdateTime);
+	// Put back what Pop handed out.  The ones that were sent go to the back of their lists.
+	void EndUpdate(const ObjInfo *pObjInfos);
+
+private:
+	enum {
+		k_nNoID = 0xFFFF,
+		k_nNumBuckets = 64,
+		// Exponent of the lowest non-zero bucket
+		k_nBucketExpBase = -24,
+		// Every object gets ranked again after this many updates
+		k_nFullRankPeriod = 32,
+	};
+
+	struct SEntry
+	{
+		LTObject	*m_pObject;		// LTNULL if it's not in a list
+		float		m_fRate;		// How much its priority grows per ms
+		uint32		m_nSentAt;		// m_nLastSentU when it was put in its list
+		uint16		m_nPrev, m_nNext;
+		uint8		m_nBucket;
+		bool		m_bInterest;	// In this update's interest list
+	};
+
+	static uint32 GetBucket(float fRate);
+
+	void Rank(const CUnguaranteedSnapshot &cSnapshot, uint32 nIndex, const Client *pClient);
+	void Rerank(const CUnguaranteedSnapshot &cSnapshot, uint16 nID, const Client *pClient);
+	// Insert an entry in its list, in m_nSentAt order
+	void Link(uint16 nID);
+	void LinkFront(uint16 nID);
+	void Unlink(uint16 nID);
+	void UnlinkAll();
+
+	// Indexed by object ID
+	std::vector<SEntry> m_aEntries;
+	uint16 m_aHead[k_nNumBuckets];
+	uint16 m_aTail[k_nNumBuckets];
+
+	// What Pop handed out this update
+	std::vector<uint16> m_aTaken;
+	// IDs with m_bInterest set
+	std::vector<uint16> m_aInterest;
+
+	// The snapshot serial the lists are up to date with (0 if they're empty)
+	uint32 m_nSerial;
+	// The serial of the last time every object was ranked
+	uint32 m_nFullRankSerial;
+	// The view position for the last full rank
+	LTVector m_vRankViewPos;
+	bool m_bUsedInterest;
+};
+
+
 struct SentList
 {
 	SentList() : m_nObjectIDs(0), m_AllocatedSize(0), m_ObjectIDs(0) {}
@@ -175,6 +250,12 @@ struct Client
 	// FileID based information.
 	HHashTable  *m_hFileIDTable;
 
+	// Delta compression state for the unguaranteed updates.
+	CSnapshotDeltaSender	m_SnapshotDelta;
+
+	// The order the unguaranteed updates go out in.
+	CUnguaranteedSchedule	m_UnguaranteedSchedule;
+
 };
 
 
@@ -205,8 +286,20 @@ bool sm_SetClientState(Client *pClient, int state);
 // Update the client's state in the world.
 void sm_UpdateClientState(Client *pClient);
 
-// Updates the client if it's in the world.
-void sm_UpdateClientInWorld(Client *pClient);
+// Builds and sends the updates for the clients in the list that are in the world.
+// The updates are built in parallel, and sent in list order.
+void sm_SendClientUpdates(LTList *pClientList);
+
+// Remembers which objects changed this frame, for the clients' unguaranteed
+// schedules.  Call this before the server's changed object list is cleared.
+void sm_RecordUnguaranteedChanges();
+
+// Measures the packet allocations made by sm_SendClientUpdates over the next
+// nFrames frames that send any updates, and prints them when it's done.
+void sm_BenchClientUpdates(uint32 nFrames);
+
+// Shuts down the threads used by sm_SendClientUpdates.
+void sm_TermClientUpdatePool();
 
 // Finds a client given its connection ID.
 Client* sm_FindClient(CBaseConn *connID);
@@ -218,7 +311,8 @@ void sm_SetSendSkyDef();
 // Sends the sky info to a client.
 void sm_TellClientAboutSky(Client *pClient);
 
-// Take the object out of the sky.
+// Put the object in the sky, or take it out.  These keep the interest grid up to date.
+LTRESULT sm_AddObjectToSky(LTObject *pObject, uint32 index);
 LTRESULT sm_RemoveObjectFromSky(LTObject *pObject);
 
 FileIDInfo *sm_GetClientFileIDInfo( Client *pClient, uint16 wFileID );
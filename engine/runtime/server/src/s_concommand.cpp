@@ -7,6 +7,9 @@
 #include "dhashtable.h"
 #include "s_client.h"
 #include "ltobjectcreate.h"
+#include "framearena.h"
+#include "lt_collision_mgr.h"
+#include "phys_simd.h"
 
 //------------------------------------------------------------------
 //------------------------------------------------------------------
@@ -30,6 +33,12 @@ define_holder(IServerConsoleState, console_state);
 static ILTServer *ilt_server;
 define_holder(ILTServer, ilt_server);
 
+//IWorldServerBSP holder
+#include "world_server_bsp.h"
+#include "world_tree_bvh.h"
+static IWorldServerBSP *world_bsp_server;
+define_holder(IWorldServerBSP, world_bsp_server);
+
 
 
 
@@ -42,6 +51,7 @@ extern int GetNumEngineVars();
 
 
 extern CServerMgr *g_pServerMgr;
+extern float g_CV_InterestRadius;
 
 // Each server console command can return a status by setting this.
 static LTRESULT g_CommandStatus;
@@ -273,6 +283,439 @@ void con_SpawnObject(int argc, char **argv)
 }
 
 
+static void con_NetIOStats(int argc, char *argv[])
+{
+    CBaseDriver *pDriver;
+    NetDriverIOStats stats;
+
+    if (!g_pServerMgr)
+        return;
+
+    pDriver = g_pServerMgr->m_NetMgr.GetDriver("internet");
+    if (!pDriver || !pDriver->GetIOStats(&stats))
+    {
+        dsi_ConsolePrint("No socket I/O stats available");
+        return;
+    }
+
+    if (argc >= 1 && stricmp(argv[0], "reset") == 0)
+    {
+        pDriver->ResetIOStats();
+        dsi_ConsolePrint("Socket I/O stats reset");
+        return;
+    }
+
+    dsi_ConsolePrint("Recv: %u datagrams in %u calls (%.2f per call)", stats.m_nRecvDatagrams, stats.m_nRecvCalls,
+        stats.m_nRecvCalls ? (float)stats.m_nRecvDatagrams / (float)stats.m_nRecvCalls : 0.0f);
+    dsi_ConsolePrint("Send: %u datagrams in %u calls (%.2f per call)", stats.m_nSendDatagrams, stats.m_nSendCalls,
+        stats.m_nSendCalls ? (float)stats.m_nSendDatagrams / (float)stats.m_nSendCalls : 0.0f);
+}
+
+
+#ifndef _FINAL
+
+// Times the console benches, and prints what they did the same way.
+class CConBench
+{
+public:
+    CConBench() : m_nStartTime(timeGetTime()), m_nTime(0) {}
+
+    // Stop the clock
+    void Stop() { m_nTime = timeGetTime() - m_nStartTime; }
+
+    // Prints "<what> in <time>ms: <rate>/s, <time> us each" for nCount of something
+    void Print(uint32 nCount, const char *pFormat, ...) const
+    {
+        static const uint32 knBufferSize = 256;
+
+        va_list marker;
+        char msg[knBufferSize];
+
+        va_start(marker, pFormat);
+        LTVSNPrintF(msg, knBufferSize, pFormat, marker);
+        va_end(marker);
+
+        dsi_ConsolePrint("%s in %ums: %.0f/s, %.2f us each", msg, m_nTime,
+            m_nTime ? (float)nCount * 1000.0f / (float)m_nTime : 0.0f,
+            GetMicrosEach((float)m_nTime / 1000.0f, nCount));
+    }
+
+    // Microseconds per item for nCount items in fSeconds
+    static float GetMicrosEach(float fSeconds, uint32 nCount)
+    {
+        return nCount ? fSeconds * 1000000.0f / (float)nCount : 0.0f;
+    }
+
+private:
+    uint32 m_nStartTime;
+    uint32 m_nTime;
+};
+
+#endif // _FINAL
+
+static void con_PacketStats(int argc, char *argv[])
+{
+    SPacketAllocStats stats;
+
+#ifndef _FINAL
+    // Measures the real client updates, so the results show up once the frames have gone by
+    if (argc >= 1 && stricmp(argv[0], "bench") == 0)
+    {
+        int nFrames = (argc >= 2) ? atoi(argv[1]) : 100;
+        if (nFrames <= 0)
+            return;
+        sm_BenchClientUpdates((uint32)nFrames);
+        dsi_ConsolePrint("Measuring the next %d client update frames", nFrames);
+        return;
+    }
+#endif // _FINAL
+
+    CPacket_Data::GetAllocStats(&stats);
+    dsi_ConsolePrint("Active: %u packets, %u chunks", stats.m_nActivePackets, stats.m_nActiveChunks);
+    dsi_ConsolePrint("Allocations: %u, heap allocations: %u (%u bytes reserved)",
+        stats.m_nAllocCalls, stats.m_nHeapAllocs, stats.m_nReservedBytes);
+}
+
+// Unguaranteed update bandwidth for each remote client, and how much the
+// delta compression saved on the positions.
+static void con_SnapshotStats(int argc, char *argv[])
+{
+    LTLink *pCur, *pListHead;
+    bool bReset;
+
+    if (!g_pServerMgr)
+        return;
+
+    bReset = (argc >= 1 && stricmp(argv[0], "reset") == 0);
+
+    pListHead = &g_pServerMgr->m_Clients.m_Head;
+    for (pCur = pListHead->m_pNext; pCur != pListHead; pCur = pCur->m_pNext)
+    {
+        Client *pClient = (Client*)pCur->m_pData;
+        if (pClient->m_ClientFlags & CFLAG_LOCAL)
+            continue;
+
+        if (bReset)
+        {
+            pClient->m_SnapshotDelta.ClearStats();
+            continue;
+        }
+
+        const SSnapshotDeltaStats &stats = pClient->m_SnapshotDelta.GetStats();
+        uint32 nElapsed = stats.m_nLastTime - stats.m_nFirstTime;
+        float fBytesPerSec = nElapsed ? (float)stats.m_nUpdateBits / 8.0f * 1000.0f / (float)nElapsed : 0.0f;
+
+        dsi_ConsolePrint("Client %d (%s): %u updates (%u delta), %.0f bytes/sec",
+            pClient->m_ClientID, pClient->m_SnapshotDelta.IsEnabled() ? "delta" : "plain",
+            stats.m_nSnapshots, stats.m_nDeltaSnapshots, fBytesPerSec);
+        dsi_ConsolePrint("  Positions: %u delta, %u full, %.1f bits each (%.1f%% of uncompressed)",
+            stats.m_nDeltaPos, stats.m_nFullPos,
+            (stats.m_nDeltaPos + stats.m_nFullPos) ? (float)stats.m_nPosBits / (float)(stats.m_nDeltaPos + stats.m_nFullPos) : 0.0f,
+            stats.m_nUncompressedPosBits ? (float)stats.m_nPosBits * 100.0f / (float)stats.m_nUncompressedPosBits : 0.0f);
+    }
+
+    if (bReset)
+        dsi_ConsolePrint("Snapshot stats reset");
+}
+
+
+// How the objects are spread over the interest grid.
+static void con_InterestStats(int argc, char *argv[])
+{
+    if (!g_pServerMgr)
+        return;
+
+    const CInterestGrid &cGrid = g_pServerMgr->m_InterestGrid;
+
+    dsi_ConsolePrint("Interest grid: %.0f unit cells, %s", cGrid.GetCellSize(),
+        (g_CV_InterestRadius > 0.0f) ? "in use" : "not in use (InterestRadius is 0)");
+    dsi_ConsolePrint("  %u objects, %u global", cGrid.GetNumObjects(), cGrid.GetNumGlobalObjects());
+    dsi_ConsolePrint("  %u cells, %u occupied, %u objects in the fullest",
+        cGrid.GetNumCells(), cGrid.GetNumOccupiedCells(), cGrid.GetLargestCellSize());
+}
+
+
+// Writes the tick stats to a file, one tab separated line per phase with the
+// raw histogram at the end.
+static bool DumpTickStats(const CTickStats &cStats, const char *pFilename)
+{
+    FILE *fp = fopen(pFilename, "wt");
+    if (!fp)
+        return false;
+
+    fprintf(fp, "phase\tcount\ttotal_ns\tmax_ns\tp50_us\tp90_us\tp99_us");
+    for (uint32 nCurBucket = 0; nCurBucket < CTickStats::k_nNumBuckets; ++nCurBucket)
+        fprintf(fp, "\tlt%llu_us", (unsigned long long)((uint64)1 << nCurBucket));
+    fprintf(fp, "\n");
+
+    for (uint32 nCurPhase = 0; nCurPhase < eTickPhase_Count; ++nCurPhase)
+    {
+        ETickPhase ePhase = (ETickPhase)nCurPhase;
+        const CTickStats::SPhase &cPhase = cStats.GetPhase(ePhase);
+
+        fprintf(fp, "%s\t%u\t%llu\t%llu\t%.1f\t%.1f\t%.1f", CTickStats::GetPhaseName(ePhase), cPhase.m_nCount,
+            (unsigned long long)cPhase.m_nTotalNS, (unsigned long long)cPhase.m_nMaxNS,
+            cStats.GetPercentileUS(ePhase, 50.0f), cStats.GetPercentileUS(ePhase, 90.0f), cStats.GetPercentileUS(ePhase, 99.0f));
+        for (uint32 nCurBucket = 0; nCurBucket < CTickStats::k_nNumBuckets; ++nCurBucket)
+            fprintf(fp, "\t%u", cPhase.m_aBuckets[nCurBucket]);
+        fprintf(fp, "\n");
+    }
+
+    fclose(fp);
+    return true;
+}
+
+// How long each phase of the server update takes.
+// TickStats [reset | dump [filename]]
+static void con_TickStats(int argc, char *argv[])
+{
+    if (!g_pServerMgr)
+        return;
+
+    CTickStats &cStats = g_pServerMgr->m_TickStats;
+
+    if (argc >= 1 && stricmp(argv[0], "reset") == 0)
+    {
+        cStats.Clear();
+#ifdef DE_SERVER_COMPILE
+        g_pServerMgr->m_TickScheduler.ResetNumDroppedTicks();
+#endif // DE_SERVER_COMPILE
+        dsi_ConsolePrint("Tick stats reset");
+        return;
+    }
+
+    if (argc >= 1 && stricmp(argv[0], "dump") == 0)
+    {
+        const char *pFilename = (argc >= 2) ? argv[1] : "tickstats.txt";
+        if (DumpTickStats(cStats, pFilename))
+            dsi_ConsolePrint("Tick stats written to %s", pFilename);
+        else
+            dsi_ConsolePrint("Couldn't write %s", pFilename);
+        return;
+    }
+
+    dsi_ConsolePrint("%-16s %8s %9s %9s %9s %9s", "Phase (us)", "Count", "Mean", "p50", "p99", "Max");
+    for (uint32 nCurPhase = 0; nCurPhase < eTickPhase_Count; ++nCurPhase)
+    {
+        ETickPhase ePhase = (ETickPhase)nCurPhase;
+        const CTickStats::SPhase &cPhase = cStats.GetPhase(ePhase);
+
+        dsi_ConsolePrint("%-16s %8u %9.1f %9.1f %9.1f %9.1f", CTickStats::GetPhaseName(ePhase), cPhase.m_nCount,
+            cPhase.m_nCount ? (float)cPhase.m_nTotalNS / 1000.0f / (float)cPhase.m_nCount : 0.0f,
+            cStats.GetPercentileUS(ePhase, 50.0f), cStats.GetPercentileUS(ePhase, 99.0f),
+            (float)cPhase.m_nMaxNS / 1000.0f);
+    }
+
+#ifdef DE_SERVER_COMPILE
+    dsi_ConsolePrint("%u ticks dropped", g_pServerMgr->m_TickScheduler.GetNumDroppedTicks());
+#endif // DE_SERVER_COMPILE
+}
+
+// Connects synthetic clients to this server and reports how it holds up.
+// LoadTest [start <count> | stop | reset]
+static void con_LoadTest(int argc, char *argv[])
+{
+    if (!g_pServerMgr)
+        return;
+
+    CLoadTest &cLoadTest = g_pServerMgr->m_LoadTest;
+
+    if (argc >= 2 && stricmp(argv[0], "start") == 0)
+    {
+        int nNumClients = atoi(argv[1]);
+        if (nNumClients > 0)
+            cLoadTest.Start((uint32)nNumClients);
+        return;
+    }
+
+    if (argc >= 1 && stricmp(argv[0], "stop") == 0)
+    {
+        cLoadTest.Stop();
+        dsi_ConsolePrint("LoadTest stopped");
+        return;
+    }
+
+    // Start the tick stats over too, so they cover the same time
+    if (argc >= 1 && stricmp(argv[0], "reset") == 0)
+    {
+        cLoadTest.ClearStats();
+        g_pServerMgr->m_TickStats.Clear();
+        dsi_ConsolePrint("LoadTest stats reset");
+        return;
+    }
+
+    if (!cLoadTest.IsRunning())
+    {
+        dsi_ConsolePrint("LoadTest [start <count> | stop | reset]");
+        return;
+    }
+
+    cLoadTest.PrintStats();
+}
+
+
+#ifndef _FINAL
+static void PrintWorldTreeBench(const char *pName, const WTBenchResults &cResults)
+{
+    dsi_ConsolePrint("%-8s %6u boxes: %7.1f objects, %7.2f us each", pName, cResults.m_nBoxQueries,
+        cResults.m_nBoxQueries ? (float)cResults.m_nBoxObjects / (float)cResults.m_nBoxQueries : 0.0f,
+        CConBench::GetMicrosEach(cResults.m_fBoxTime, cResults.m_nBoxQueries));
+    dsi_ConsolePrint("%-8s %6u segments: %7.1f objects, %7.2f us each", "", cResults.m_nSegmentQueries,
+        cResults.m_nSegmentQueries ? (float)cResults.m_nSegmentObjects / (float)cResults.m_nSegmentQueries : 0.0f,
+        CConBench::GetMicrosEach(cResults.m_fSegmentTime, cResults.m_nSegmentQueries));
+    dsi_ConsolePrint("%-8s %6u moves: %7.2f us each", "", cResults.m_nMoves,
+        CConBench::GetMicrosEach(cResults.m_fMoveTime, cResults.m_nMoves));
+}
+#endif // _FINAL
+
+// Where the server's objects are kept, and how the quadtree and the BVH compare
+// on the objects in this level.
+// WorldTree [bvh <0|1> | bench [count]]
+static void con_WorldTree(int argc, char *argv[])
+{
+    if (!world_bsp_server->IsLoaded())
+    {
+        dsi_ConsolePrint("No world loaded");
+        return;
+    }
+
+    WorldTree *pTree = world_bsp_server->ServerTree();
+
+    if (argc >= 2 && stricmp(argv[0], "bvh") == 0)
+    {
+        pTree->SetUseBVH(atoi(argv[1]) != 0);
+    }
+#ifndef _FINAL
+    else if (argc >= 1 && stricmp(argv[0], "bench") == 0)
+    {
+        int nMaxObjects = (argc >= 2) ? atoi(argv[1]) : 1000;
+        if (nMaxObjects <= 0)
+            return;
+
+        WTBenchResults cQuadTree, cBVH;
+        pTree->Benchmark((uint32)nMaxObjects, &cQuadTree, &cBVH);
+        PrintWorldTreeBench("Quadtree", cQuadTree);
+        PrintWorldTreeBench("BVH", cBVH);
+        return;
+    }
+#endif // _FINAL
+
+    const WorldTreeBVH *pBVH = pTree->GetBVH();
+    if (pBVH)
+    {
+        dsi_ConsolePrint("World tree: objects in a BVH, %u objects, %u nodes, %u levels",
+            pBVH->GetNumObjects(), pBVH->GetNumNodes(), pBVH->GetHeight() + 1);
+    }
+    else
+    {
+        dsi_ConsolePrint("World tree: objects in the quadtree, %u node links",
+            pTree->GetRootNode()->GetNumObjectsOnOrBelow());
+    }
+}
+
+
+#ifndef _FINAL
+// How fast the transform maker evaluates the poses of the models in the
+// world.  Every animated model's whole skeleton is evaluated count times.
+// PoseBench [count]
+static void con_PoseBench(int argc, char *argv[])
+{
+    int nPasses = (argc >= 1) ? atoi(argv[0]) : 100;
+    if (nPasses <= 0)
+        return;
+
+    LTLink *pCur, *pListHead;
+    uint32 nModels = 0, nNodes = 0, nPoses = 0;
+    CConBench cBench;
+
+    for (int nPass = 0; nPass < nPasses; ++nPass)
+    {
+        pListHead = &g_pServerMgr->m_Objects.m_Head;
+        for (pCur=pListHead->m_pNext; pCur != pListHead; pCur=pCur->m_pNext)
+        {
+            LTObject *pObj = (LTObject*)pCur->m_pData;
+            if (pObj->m_ObjectType != OT_MODEL)
+                continue;
+
+            ModelInstance *pInstance = pObj->ToModel();
+            if (!pInstance->m_AnimTrackers || !pInstance->GetModelDB())
+                continue;
+
+            if (!pInstance->ForceUpdateCachedTransforms())
+                continue;
+
+            ++nPoses;
+            if (nPass == 0)
+            {
+                ++nModels;
+                nNodes += pInstance->NumNodes();
+            }
+        }
+    }
+
+    cBench.Stop();
+
+    if (!nPoses)
+    {
+        dsi_ConsolePrint("No animated models");
+        return;
+    }
+
+    cBench.Print(nPoses, "%u models (%u nodes), %u poses", nModels, nNodes, nPoses);
+}
+
+// How fast the collision manager's broadphase keeps up with boxes, spheres and
+// cylinders moving around, and what testing every pair would have cost instead.
+// CollisionBench [count] [frames]
+static void con_CollisionBench(int argc, char *argv[])
+{
+    int nObjects = (argc >= 1) ? atoi(argv[0]) : 3000;
+    int nFrames = (argc >= 2) ? atoi(argv[1]) : 30;
+    if (nObjects <= 0 || nFrames <= 0)
+        return;
+
+    LTCollisionBenchResults cResults;
+    LTCollisionMgr::Benchmark(cResults, (uint32)nObjects, (uint32)nFrames);
+
+    dsi_ConsolePrint("%u objects added in %.2fms", cResults.m_Objects, cResults.m_AddTime * 1000.0f);
+    dsi_ConsolePrint("%8u updates: %7.2f us each", cResults.m_Updates,
+        CConBench::GetMicrosEach(cResults.m_UpdateTime, cResults.m_Updates));
+    dsi_ConsolePrint("%8u FindPairs: %7.2f us each, %u pairs", cResults.m_Queries,
+        CConBench::GetMicrosEach(cResults.m_PairTime, cResults.m_Queries), cResults.m_Pairs);
+    dsi_ConsolePrint("%8s all pairs: %7.2f us, %u pairs", "",
+        CConBench::GetMicrosEach(cResults.m_BruteTime, 1), cResults.m_BrutePairs);
+}
+
+// How fast spheres and boxes query a terrain mesh with each set of physics
+// kernels this CPU can run, and whether they all give the scalar answers.
+// PhysSimdBench [count]
+static void con_PhysSimdBench(int argc, char *argv[])
+{
+    int nQueries = (argc >= 1) ? atoi(argv[0]) : 20000;
+    if (nQueries <= 0)
+        return;
+
+    LTPhysSimdBenchResults cResults[PHYS_SIMD_COUNT];
+    uint32 nRuns = PhysSimdBenchmark(cResults, (uint32)nQueries);
+
+    dsi_ConsolePrint("%u queries, using %s", (uint32)nQueries, PhysSimdName(PhysSimd()));
+    for (uint32 i = 0; i < nRuns; ++i)
+    {
+        const LTPhysSimdBenchResults &cRun = cResults[i];
+
+        dsi_ConsolePrint("%-6s tree %6.2f us, cull %6.2f us, sphere %6.2f us, box %6.2f us",
+            PhysSimdName(cRun.m_Simd),
+            CConBench::GetMicrosEach(cRun.m_TreeTime, cRun.m_Queries),
+            CConBench::GetMicrosEach(cRun.m_CullTime, cRun.m_Queries),
+            CConBench::GetMicrosEach(cRun.m_SphereTime, cRun.m_Queries),
+            CConBench::GetMicrosEach(cRun.m_BoxTime, cRun.m_Queries));
+        dsi_ConsolePrint("%6s %u triangles kept, %u hits, %s", "",
+            cRun.m_Kept, cRun.m_Hits, cRun.m_Same ? "same as scalar" : "DIFFERENT FROM SCALAR");
+    }
+}
+#endif // _FINAL
+
+
 // ------------------------------------------------------------------ //
 // Tables.
 // ------------------------------------------------------------------ //
@@ -286,7 +729,20 @@ static LTCommandStruct g_ServerCommandStructs[] =
     { "DisableWMPhysics", con_DisableWMPhysics, 0 },
     { "ExhaustMemory", con_ExhaustMemory, 0 },
     { "SpawnObject", con_SpawnObject, 0 },
+    { "NetIOStats", con_NetIOStats, 0 },
+    { "PacketStats", con_PacketStats, 0 },
+    { "SnapshotStats", con_SnapshotStats, 0 },
+    { "InterestStats", con_InterestStats, 0 },
+    { "TickStats", con_TickStats, 0 },
+    { "LoadTest", con_LoadTest, 0 },
+    { "WorldTree", con_WorldTree, 0 },
+#ifndef _FINAL
+    { "PoseBench", con_PoseBench, 0 },
+    { "CollisionBench", con_CollisionBench, 0 },
+    { "PhysSimdBench", con_PhysSimdBench, 0 },
+#endif // _FINAL
 	{ "Mem", LTMemConsole, 0 },
+	{ "FrameArena", FrameArenaConsole, 0 },
 };
 
 #define NUM_SERVERCOMMANDSTRUCTS    (sizeof(g_ServerCommandStructs) / sizeof(LTCommandStruct))
@@ -0,0 +1,222 @@
+#include "bdefs.h"
+
+#include "s_interest.h"
+#include "servermgr.h"
+
+#include <math.h>
+
+
+CInterestGrid::CInterestGrid() :
+	m_fCellSize(1.0f),
+	m_fInvCellSize(1.0f),
+	m_nOccupiedCells(0),
+	m_nNumObjects(0)
+{
+	m_aCells.resize(1);
+}
+
+void CInterestGrid::Init(float fCellSize)
+{
+	// Anything in there is about to be forgotten
+	for (uint32 nCurCell = 0; nCurCell < m_aCells.size(); ++nCurCell)
+	{
+		std::vector<LTObject*> &aObjects = m_aCells[nCurCell].m_aObjects;
+		for (uint32 nCurObj = 0; nCurObj < aObjects.size(); ++nCurObj)
+		{
+			aObjects[nCurObj]->sd->m_nInterestCell = k_nNoCell;
+		}
+	}
+
+	m_fCellSize = LTMAX(fCellSize, 1.0f);
+	m_fInvCellSize = 1.0f / m_fCellSize;
+
+	m_aCells.clear();
+	m_aCells.resize(1);
+	m_cCellMap.clear();
+
+	m_nOccupiedCells = 0;
+	m_nNumObjects = 0;
+}
+
+uint64 CInterestGrid::GetKey(int32 nX, int32 nY, int32 nZ)
+{
+	// 21 bits per axis is way more than a world needs
+	return ((uint64)((uint32)nX & 0x1FFFFF) << 42) |
+		((uint64)((uint32)nY & 0x1FFFFF) << 21) |
+		(uint64)((uint32)nZ & 0x1FFFFF);
+}
+
+int32 CInterestGrid::GetCellCoord(float fPos) const
+{
+	float fCell = (float)floor(fPos * m_fInvCellSize);
+	return (int32)LTCLAMP(fCell, -1048576.0f, 1048575.0f);
+}
+
+uint32 CInterestGrid::GetCell(int32 nX, int32 nY, int32 nZ)
+{
+	uint64 nKey = GetKey(nX, nY, nZ);
+
+	std::unordered_map<uint64, uint32>::const_iterator iCell = m_cCellMap.find(nKey);
+	if (iCell != m_cCellMap.end())
+		return iCell->second;
+
+	uint32 nCell = (uint32)m_aCells.size();
+	m_aCells.resize(nCell + 1);
+	m_aCells[nCell].m_nX = nX;
+	m_aCells[nCell].m_nY = nY;
+	m_aCells[nCell].m_nZ = nZ;
+	m_cCellMap[nKey] = nCell;
+
+	return nCell;
+}
+
+bool CInterestGrid::ShouldBeGlobal(const LTObject *pObj) const
+{
+	// World models are part of the level, and the client needs them for collisions
+	if (HasWorldModel(pObj))
+		return true;
+
+	// Special effect controllers and lights don't have a meaningful position
+	if ((pObj->m_ObjectType == OT_NORMAL) || (pObj->m_ObjectType == OT_LIGHT))
+		return true;
+
+	// The sky can be seen from anywhere
+	if (pObj->m_InternalFlags & IFLAG_INSKY)
+		return true;
+
+	// Big objects would stick out of their cell
+	float fMaxDim = LTMAX(pObj->m_Dims.x, LTMAX(pObj->m_Dims.y, pObj->m_Dims.z));
+	if (fMaxDim > m_fCellSize)
+		return true;
+
+	return false;
+}
+
+bool CInterestGrid::IsGlobal(const LTObject *pObj)
+{
+	return pObj->sd && (pObj->sd->m_nInterestCell == k_nGlobalCell);
+}
+
+void CInterestGrid::AddToCell(LTObject *pObj, uint32 nCell)
+{
+	std::vector<LTObject*> &aObjects = m_aCells[nCell].m_aObjects;
+
+	if (aObjects.empty() && (nCell != k_nGlobalCell))
+		++m_nOccupiedCells;
+
+	pObj->sd->m_nInterestCell = nCell;
+	pObj->sd->m_nInterestIndex = (uint32)aObjects.size();
+	aObjects.push_back(pObj);
+	++m_nNumObjects;
+}
+
+void CInterestGrid::RemoveFromCell(LTObject *pObj)
+{
+	uint32 nCell = pObj->sd->m_nInterestCell;
+	std::vector<LTObject*> &aObjects = m_aCells[nCell].m_aObjects;
+
+	// Swap the last one into its spot
+	uint32 nIndex = pObj->sd->m_nInterestIndex;
+	ASSERT((nIndex < aObjects.size()) && (aObjects[nIndex] == pObj));
+	LTObject *pLast = aObjects.back();
+	aObjects[nIndex] = pLast;
+	pLast->sd->m_nInterestIndex = nIndex;
+	aObjects.pop_back();
+
+	if (aObjects.empty() && (nCell != k_nGlobalCell))
+		--m_nOccupiedCells;
+
+	pObj->sd->m_nInterestCell = k_nNoCell;
+	--m_nNumObjects;
+}
+
+void CInterestGrid::UpdateObject(LTObject *pObj)
+{
+	if (!pObj->sd)
+		return;
+
+	uint32 nNewCell;
+	if (ShouldBeGlobal(pObj))
+	{
+		nNewCell = k_nGlobalCell;
+	}
+	else
+	{
+		const LTVector &vPos = pObj->GetPos();
+		nNewCell = GetCell(GetCellCoord(vPos.x), GetCellCoord(vPos.y), GetCellCoord(vPos.z));
+	}
+
+	uint32 nOldCell = pObj->sd->m_nInterestCell;
+	if (nNewCell == nOldCell)
+		return;
+
+	if (nOldCell != k_nNoCell)
+		RemoveFromCell(pObj);
+
+	AddToCell(pObj, nNewCell);
+}
+
+void CInterestGrid::RemoveObject(LTObject *pObj)
+{
+	if (!pObj->sd || (pObj->sd->m_nInterestCell == k_nNoCell))
+		return;
+
+	RemoveFromCell(pObj);
+}
+
+void CInterestGrid::Query(const LTVector &vPos, float fRadius, std::vector<LTObject*> &aResults) const
+{
+	const std::vector<LTObject*> &aGlobal = m_aCells[k_nGlobalCell].m_aObjects;
+	aResults.insert(aResults.end(), aGlobal.begin(), aGlobal.end());
+
+	int32 nMinX = GetCellCoord(vPos.x - fRadius), nMaxX = GetCellCoord(vPos.x + fRadius);
+	int32 nMinY = GetCellCoord(vPos.y - fRadius), nMaxY = GetCellCoord(vPos.y + fRadius);
+	int32 nMinZ = GetCellCoord(vPos.z - fRadius), nMaxZ = GetCellCoord(vPos.z + fRadius);
+
+	uint64 nNumLookups = (uint64)(nMaxX - nMinX + 1) * (uint64)(nMaxY - nMinY + 1) * (uint64)(nMaxZ - nMinZ + 1);
+
+	if (nNumLookups < m_nOccupiedCells)
+	{
+		// Look up the cells in the box
+		for (int32 nX = nMinX; nX <= nMaxX; ++nX)
+		{
+			for (int32 nY = nMinY; nY <= nMaxY; ++nY)
+			{
+				for (int32 nZ = nMinZ; nZ <= nMaxZ; ++nZ)
+				{
+					std::unordered_map<uint64, uint32>::const_iterator iCell = m_cCellMap.find(GetKey(nX, nY, nZ));
+					if (iCell == m_cCellMap.end())
+						continue;
+
+					const std::vector<LTObject*> &aObjects = m_aCells[iCell->second].m_aObjects;
+					aResults.insert(aResults.end(), aObjects.begin(), aObjects.end());
+				}
+			}
+		}
+	}
+	else
+	{
+		// The box covers more cells than there are in use, so it's cheaper to go through all of them
+		for (uint32 nCurCell = k_nGlobalCell + 1; nCurCell < m_aCells.size(); ++nCurCell)
+		{
+			const SCell &cCell = m_aCells[nCurCell];
+			if (cCell.m_aObjects.empty() ||
+				(cCell.m_nX < nMinX) || (cCell.m_nX > nMaxX) ||
+				(cCell.m_nY < nMinY) || (cCell.m_nY > nMaxY) ||
+				(cCell.m_nZ < nMinZ) || (cCell.m_nZ > nMaxZ))
+				continue;
+
+			aResults.insert(aResults.end(), cCell.m_aObjects.begin(), cCell.m_aObjects.end());
+		}
+	}
+}
+
+uint32 CInterestGrid::GetLargestCellSize() const
+{
+	uint32 nLargest = 0;
+	for (uint32 nCurCell = k_nGlobalCell + 1; nCurCell < m_aCells.size(); ++nCurCell)
+	{
+		nLargest = LTMAX(nLargest, (uint32)m_aCells[nCurCell].m_aObjects.size());
+	}
+	return nLargest;
+}
@@ -0,0 +1,81 @@
+// Interest management for the client updates.
+//
+// The objects are kept in a uniform grid of cells by position, so a client's
+// update only has to look at the cells around its view position instead of every
+// object in the world.  Objects that can matter from anywhere (world models,
+// lights, sky objects, OT_NORMAL objects and anything bigger than a cell) are kept
+// on a global list which every query returns.
+//
+// The grid is kept up to date by MoveObject and sm_UpdateInBspStatus, and objects
+// come out of it when their server data is destroyed.
+
+#ifndef __S_INTEREST_H__
+#define __S_INTEREST_H__
+
+#include <vector>
+#include <unordered_map>
+
+class CInterestGrid
+{
+public:
+	CInterestGrid();
+
+	// Drop everything and start over with a new cell size.  Called when a world starts.
+	void	Init(float fCellSize);
+
+	// Put the object in the right cell (or on the global list) for its position
+	void	UpdateObject(LTObject *pObj);
+	// Take the object out of the grid
+	void	RemoveObject(LTObject *pObj);
+
+	// Adds the objects in the cells touching the box around vPos, and everything
+	// on the global list, to aResults.  The objects aren't filtered by distance.
+	void	Query(const LTVector &vPos, float fRadius, std::vector<LTObject*> &aResults) const;
+
+	// Is the object on the global list?
+	static bool IsGlobal(const LTObject *pObj);
+
+	float	GetCellSize() const { return m_fCellSize; }
+	uint32	GetNumCells() const { return (uint32)m_aCells.size() - 1; }
+	uint32	GetNumOccupiedCells() const { return m_nOccupiedCells; }
+	uint32	GetNumObjects() const { return m_nNumObjects; }
+	uint32	GetNumGlobalObjects() const { return (uint32)m_aCells[k_nGlobalCell].m_aObjects.size(); }
+	uint32	GetLargestCellSize() const;
+
+	enum {
+		// SObjData::m_nInterestCell for objects that aren't in the grid
+		k_nNoCell = 0xFFFFFFFF,
+		// Index of the global list in m_aCells
+		k_nGlobalCell = 0
+	};
+
+private:
+	struct SCell
+	{
+		int32 m_nX, m_nY, m_nZ;
+		std::vector<LTObject*> m_aObjects;
+	};
+
+	static uint64 GetKey(int32 nX, int32 nY, int32 nZ);
+	int32	GetCellCoord(float fPos) const;
+	// Find the cell, creating it if it's not there
+	uint32	GetCell(int32 nX, int32 nY, int32 nZ);
+	// Should the object be on the global list?
+	bool	ShouldBeGlobal(const LTObject *pObj) const;
+
+	void	AddToCell(LTObject *pObj, uint32 nCell);
+	void	RemoveFromCell(LTObject *pObj);
+
+	float	m_fCellSize;
+	float	m_fInvCellSize;
+
+	// Cell 0 is the global list.  Cells stick around once they're created, so
+	// the indices stored in the objects stay good until the next Init.
+	std::vector<SCell> m_aCells;
+	std::unordered_map<uint64, uint32> m_cCellMap;
+
+	uint32	m_nOccupiedCells;
+	uint32	m_nNumObjects;
+};
+
+#endif  // __S_INTEREST_H__
@@ -21,6 +21,11 @@ bool ServerIntersectSegment(IntersectQuery *pQuery, IntersectInfo *pInfo)
 	return i_IntersectSegment(pQuery, pInfo, world_bsp_server->ServerTree());
 }
 
+uint32 ServerIntersectSegments(IntersectQuery *pQueries, IntersectInfo *pInfos, uint32 nQueries)
+{
+	return i_IntersectSegments(pQueries, pInfos, nQueries, world_bsp_server->ServerTree());
+}
+
 
 
 
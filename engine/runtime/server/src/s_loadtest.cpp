@@ -0,0 +1,529 @@
+#include "bdefs.h"
+
+#include "s_loadtest.h"
+#include "servermgr.h"
+#include "s_client.h"
+#include "s_object.h"
+#include "smoveabstract.h"
+#include "ftbase.h"
+#include "packetdefs.h"
+
+#include <math.h>
+
+extern int32 g_CV_BandwidthTargetClient;
+extern int32 g_CV_SnapshotDeltaClient;
+extern int32 g_CV_LoadTestConnectRate;
+extern float g_CV_LoadTestMoveRadius;
+extern float g_CV_LoadTestMoveSpeed;
+extern int32 g_CV_LoadTestClientFPS;
+
+
+//------------------------------------------------------------------
+// CLoadTestClient
+//------------------------------------------------------------------
+
+CLoadTestClient::CLoadTestClient() :
+	m_pServerConn(LTNULL),
+	m_bConnected(false),
+	m_bInWorld(false),
+	m_nObjectID(0xFFFF),
+	m_nBytesReceived(0),
+	m_nBytesSent(0),
+	m_nPacketsReceived(0)
+{
+}
+
+CLoadTestClient::~CLoadTestClient()
+{
+	Disconnect();
+}
+
+bool CLoadTestClient::Connect(const char *pAddress, LTGUID *pAppGuid)
+{
+	m_NetMgr.Init("LOADTEST_PLAYER");
+	m_NetMgr.SetNetHandler(this);
+	m_NetMgr.SetAppGuid(pAppGuid);
+
+	CBaseDriver *pDriver = m_NetMgr.AddDriver("internet");
+	if (!pDriver)
+		return false;
+	pDriver->SetAnyClientPort(true);
+
+	// NewConnectionNotify gets called in here if the server lets us in
+	if ((pDriver->ConnectTCP(pAddress) != LT_OK) || !m_pServerConn)
+		return false;
+
+	// Say hello, like CClientMgr::StartShell.  There's no client data.
+	CPacket_Write cHello;
+	cHello.Writeuint8(CMSG_HELLO);
+	cHello.Writeuint16(0);
+	Send(cHello, MESSAGE_GUARANTEED);
+
+	// Tell the server how much we can take, like CClientMgr::SendUpdate
+	CPacket_Write cUpdate;
+	cUpdate.Writeuint8(CMSG_UPDATE);
+	cUpdate.Writeuint16((uint16)LTCLAMP(g_CV_BandwidthTargetClient / 8000, 0, 0xFFFF));
+	Send(cUpdate, MESSAGE_GUARANTEED);
+	m_pServerConn->SetBandwidth(g_CV_BandwidthTargetClient);
+
+	return true;
+}
+
+void CLoadTestClient::Disconnect()
+{
+	if (m_pServerConn)
+	{
+		// This will in turn call DisconnectNotify()
+		m_NetMgr.Disconnect(m_pServerConn, DISCONNECTREASON_VOLUNTARY_CLIENTSIDE);
+	}
+
+	m_NetMgr.Term();
+}
+
+void CLoadTestClient::Update(float fCurTime)
+{
+	m_NetMgr.Update("LoadTest: ", fCurTime);
+
+	CPacket_Read cPacket;
+	CBaseConn *pSender;
+
+	m_NetMgr.StartGettingPackets();
+	while (m_NetMgr.GetPacket(NETMGR_TRAVELDIR_SERVER2CLIENT, &cPacket, &pSender))
+	{
+		m_nBytesReceived += (cPacket.Size() + 7) / 8;
+		++m_nPacketsReceived;
+
+		ProcessPacket(cPacket);
+	}
+	m_NetMgr.EndGettingPackets();
+
+	if (m_pServerConn && m_SnapshotDelta.IsAckPending())
+	{
+		CPacket_Write cAckPacket;
+		cAckPacket.Writeuint8(CMSG_SNAPSHOTACK);
+		m_SnapshotDelta.WriteAck(cAckPacket);
+		Send(cAckPacket, 0);
+	}
+}
+
+void CLoadTestClient::ClearStats()
+{
+	m_nBytesReceived = 0;
+	m_nBytesSent = 0;
+	m_nPacketsReceived = 0;
+}
+
+bool CLoadTestClient::NewConnectionNotify(CBaseConn *id, bool bIsLocal)
+{
+	m_pServerConn = id;
+	m_bConnected = true;
+	return true;
+}
+
+void CLoadTestClient::DisconnectNotify(CBaseConn *id, EDisconnectReason eDisconnectReason)
+{
+	if (id != m_pServerConn)
+		return;
+
+	m_pServerConn = LTNULL;
+	m_bConnected = false;
+	m_bInWorld = false;
+	m_nObjectID = 0xFFFF;
+}
+
+void CLoadTestClient::ProcessPacket(CPacket_Read &cPacket)
+{
+	if (!m_pServerConn)
+		return;
+
+	uint8 nPacketID = cPacket.Readuint8();
+
+	switch (nPacketID)
+	{
+		case SMSG_PACKETGROUP :
+		{
+			// Same layout OnPacketGroupPacket reads
+			while (!cPacket.EOP())
+			{
+				uint32 nLength = cPacket.Readuint8();
+				if (!nLength || (nLength > cPacket.TellEnd()))
+					break;
+
+				CPacket_Read cSubPacket(cPacket, cPacket.Tell(), nLength);
+				cPacket.Seek(nLength);
+				ProcessPacket(cSubPacket);
+			}
+			break;
+		}
+		case STC_FILEDESC :
+		{
+			// We have every file already
+			CPacket_Write cResponse;
+			cResponse.Writeuint8(CTS_FILESTATUS);
+			while (!cPacket.EOP())
+			{
+				uint16 nFileID = cPacket.Readuint16();
+				cPacket.Readuint32();
+				char aFileName[MAX_PATH];
+				cPacket.ReadString(aFileName, sizeof(aFileName));
+
+				cResponse.Writeuint16(nFileID | 0x8000);
+			}
+			Send(cResponse, MESSAGE_GUARANTEED);
+			break;
+		}
+		case SMSG_LOADWORLD :
+		{
+			m_bInWorld = false;
+			m_nObjectID = 0xFFFF;
+			m_SnapshotDelta.Reset();
+
+			CPacket_Write cResponse;
+			cResponse.Writeuint8(CMSG_CONNECTSTAGE);
+			cResponse.Writeuint8(0);
+			Send(cResponse, MESSAGE_GUARANTEED);
+			break;
+		}
+		case SMSG_PRELOADLIST :
+		{
+			if (cPacket.Readuint8() != PRELOADTYPE_END)
+				break;
+
+			// Nothing to preload, we're ready
+			CPacket_Write cResponse;
+			cResponse.Writeuint8(CMSG_CONNECTSTAGE);
+			cResponse.Writeuint8(1);
+			Send(cResponse, MESSAGE_GUARANTEED);
+			break;
+		}
+		case SMSG_CLIENTOBJECTID :
+		{
+			m_nObjectID = cPacket.Readuint16();
+			m_bInWorld = true;
+			break;
+		}
+		case SMSG_UNLOADWORLD :
+		{
+			m_bInWorld = false;
+			m_nObjectID = 0xFFFF;
+			break;
+		}
+		case SMSG_UNGUARANTEEDUPDATE :
+		{
+			m_SnapshotDelta.OnPlainUpdate(g_CV_SnapshotDeltaClient != 0);
+			break;
+		}
+		case SMSG_DELTAUPDATE :
+		{
+			// The objects aren't decoded.  The ack only tells the server what it
+			// can build on, so it doesn't matter that we don't have the positions.
+			if (m_SnapshotDelta.BeginSnapshot(cPacket))
+				m_SnapshotDelta.EndSnapshot(true);
+			break;
+		}
+	}
+}
+
+void CLoadTestClient::Send(CPacket_Write &cPacket, uint32 nPacketFlags)
+{
+	CPacket_Read cSendPacket(cPacket);
+	m_nBytesSent += (cSendPacket.Size() + 7) / 8;
+	m_NetMgr.SendPacket(cSendPacket, m_pServerConn, nPacketFlags);
+}
+
+
+//------------------------------------------------------------------
+// CLoadTest
+//------------------------------------------------------------------
+
+CLoadTest::CLoadTest() :
+	m_bRunning(false),
+	m_bShutdown(false),
+	m_nPendingClients(0),
+	m_nNextConnect(0),
+	m_nFailedConnects(0),
+	m_fLastUpdateTime(0.0f),
+	m_nStatsStartTime(0)
+{
+	m_aAddress[0] = 0;
+}
+
+CLoadTest::~CLoadTest()
+{
+	Stop();
+}
+
+void CLoadTest::Start(uint32 nNumClients)
+{
+	if (!IsRunning())
+	{
+		// Connect to whatever port the server is listening on
+		char aIP[64];
+		uint16 nPort = 0xFFFF;
+		g_pServerMgr->m_NetMgr.GetLocalIpAddress(aIP, sizeof(aIP), nPort);
+		if ((nPort == 0xFFFF) || !nPort)
+		{
+			dsi_ConsolePrint("LoadTest: The server isn't hosting on the internet driver");
+			return;
+		}
+		LTSNPrintF(m_aAddress, sizeof(m_aAddress), "127.0.0.1:%d", (int)nPort);
+
+		m_nPendingClients = 0;
+		m_nNextConnect = 0;
+		m_nFailedConnects = 0;
+		m_fLastUpdateTime = 0.0f;
+		m_nStatsStartTime = time_GetNSTime();
+
+		m_bShutdown = false;
+		m_bRunning = true;
+#ifndef LTMEMTRACK
+		m_cThread = std::thread(&CLoadTest::ClientThread, this);
+#endif
+	}
+
+	m_nPendingClients += nNumClients;
+
+	dsi_ConsolePrint("LoadTest: Connecting %u clients to %s", nNumClients, m_aAddress);
+}
+
+void CLoadTest::Stop()
+{
+	if (!IsRunning())
+		return;
+
+#ifdef LTMEMTRACK
+	dm_SetThreadExcluded(true);
+	DeleteClients();
+	dm_SetThreadExcluded(false);
+#else
+	// The client thread disconnects them on its way out
+	m_bShutdown = true;
+	m_cThread.join();
+#endif
+
+	m_bRunning = false;
+	m_aMovers.clear();
+}
+
+void CLoadTest::ClientThread()
+{
+	// Everything the clients use comes out of this thread
+	dm_SetThreadExcluded(true);
+
+	uint64 nStartTime = time_GetNSTime();
+	uint64 nNextFrameTime = nStartTime;
+
+	while (!m_bShutdown)
+	{
+		uint64 nFrameLength = 1000000000 / (uint64)LTMAX(g_CV_LoadTestClientFPS, 1);
+		nNextFrameTime += nFrameLength;
+
+		UpdateClients((float)(time_GetNSTime() - nStartTime) / 1000000000.0f);
+
+		// Don't try to make up for frames we've fallen behind on
+		uint64 nCurTime = time_GetNSTime();
+		if (nNextFrameTime < nCurTime)
+			nNextFrameTime = nCurTime;
+		else
+			time_SleepUntilNS(nNextFrameTime);
+	}
+
+	DeleteClients();
+}
+
+void CLoadTest::DeleteClients()
+{
+	std::vector<CLoadTestClient*> aClients;
+	{
+		std::lock_guard<std::mutex> cLock(m_cClientMutex);
+		aClients.swap(m_aClients);
+	}
+	for (uint32 nCurClient = 0; nCurClient < aClients.size(); ++nCurClient)
+	{
+		delete aClients[nCurClient];
+	}
+}
+
+void CLoadTest::UpdateClients(float fCurTime)
+{
+	// Make the clients Start() asked for
+	uint32 nNewClients = m_nPendingClients.exchange(0);
+	if (nNewClients)
+	{
+		std::lock_guard<std::mutex> cLock(m_cClientMutex);
+		m_aClients.reserve(m_aClients.size() + nNewClients);
+		for (uint32 nCurClient = 0; nCurClient < nNewClients; ++nCurClient)
+		{
+			CLoadTestClient *pClient;
+			LT_MEM_TRACK_ALLOC(pClient = new CLoadTestClient, LT_MEM_TYPE_NETWORKING);
+			m_aClients.push_back(pClient);
+		}
+	}
+
+	// Connect some more
+	uint32 nConnects = (uint32)LTMAX(g_CV_LoadTestConnectRate, 1);
+	for (; nConnects && (m_nNextConnect < m_aClients.size()); --nConnects)
+	{
+		CLoadTestClient *pClient = m_aClients[m_nNextConnect++];
+		if (!pClient->Connect(m_aAddress, g_pServerMgr->m_NetMgr.GetAppGuid()))
+			++m_nFailedConnects;
+	}
+
+	uint32 nNumConnected = m_nNextConnect;
+	for (uint32 nCurClient = 0; nCurClient < nNumConnected; ++nCurClient)
+	{
+		CLoadTestClient *pClient = m_aClients[nCurClient];
+		if (pClient->IsConnected())
+			pClient->Update(fCurTime);
+	}
+}
+
+void CLoadTest::Update(float fCurTime)
+{
+	float fFrameTime = (m_fLastUpdateTime > 0.0f) ? LTCLAMP(fCurTime - m_fLastUpdateTime, 0.0f, 0.2f) : 0.0f;
+	m_fLastUpdateTime = fCurTime;
+
+#ifdef LTMEMTRACK
+	// There's no client thread
+	if (IsRunning())
+	{
+		dm_SetThreadExcluded(true);
+		UpdateClients(fCurTime);
+		dm_SetThreadExcluded(false);
+	}
+#endif
+
+	std::lock_guard<std::mutex> cLock(m_cClientMutex);
+
+	if (m_aMovers.size() < m_aClients.size())
+		m_aMovers.resize(m_aClients.size());
+
+	for (uint32 nCurClient = 0; nCurClient < m_aClients.size(); ++nCurClient)
+	{
+		const CLoadTestClient *pClient = m_aClients[nCurClient];
+		if (pClient->IsInWorld())
+			MoveClientObject(m_aMovers[nCurClient], pClient->GetObjectID(), fFrameTime);
+		else
+			m_aMovers[nCurClient].m_bHaveCenter = false;
+	}
+}
+
+void CLoadTest::MoveClientObject(SMover &cMover, uint16 nObjectID, float fFrameTime)
+{
+	if (g_CV_LoadTestMoveRadius <= 0.0f)
+		return;
+
+	LTObject *pObj = sm_FindObject(nObjectID);
+	if (!pObj)
+		return;
+
+	// Start out on the circle where the object is now
+	if (!cMover.m_bHaveCenter)
+	{
+		cMover.m_vCenter = pObj->GetPos();
+		cMover.m_vCenter.x -= g_CV_LoadTestMoveRadius;
+		cMover.m_fAngle = 0.0f;
+		cMover.m_bHaveCenter = true;
+	}
+
+	cMover.m_fAngle += fFrameTime * g_CV_LoadTestMoveSpeed / g_CV_LoadTestMoveRadius;
+	cMover.m_fAngle = (float)fmod(cMover.m_fAngle, MATH_CIRCLE);
+
+	LTVector vNewPos(
+		cMover.m_vCenter.x + (float)cos(cMover.m_fAngle) * g_CV_LoadTestMoveRadius,
+		pObj->GetPos().y,
+		cMover.m_vCenter.z + (float)sin(cMover.m_fAngle) * g_CV_LoadTestMoveRadius);
+
+	FullMoveObject(pObj, &vNewPos, MO_DETACHSTANDING | MO_SETCHANGEFLAG | MO_MOVESTANDINGONS);
+}
+
+void CLoadTest::ClearStats()
+{
+	std::lock_guard<std::mutex> cLock(m_cClientMutex);
+	for (uint32 nCurClient = 0; nCurClient < m_aClients.size(); ++nCurClient)
+	{
+		m_aClients[nCurClient]->ClearStats();
+	}
+
+	m_nStatsStartTime = time_GetNSTime();
+}
+
+void CLoadTest::PrintStats() const
+{
+	std::lock_guard<std::mutex> cLock(m_cClientMutex);
+
+	uint32 nNumClients = (uint32)m_aClients.size();
+	uint32 nNextConnect = LTMIN((uint32)m_nNextConnect, nNumClients);
+	uint32 nConnected = 0, nInWorld = 0;
+	uint64 nTotalReceived = 0, nTotalSent = 0;
+	uint64 nMinReceived = (uint64)-1, nMaxReceived = 0;
+	for (uint32 nCurClient = 0; nCurClient < nNextConnect; ++nCurClient)
+	{
+		const CLoadTestClient *pClient = m_aClients[nCurClient];
+		if (!pClient->IsConnected())
+			continue;
+
+		++nConnected;
+		if (pClient->IsInWorld())
+			++nInWorld;
+
+		nTotalReceived += pClient->GetBytesReceived();
+		nTotalSent += pClient->GetBytesSent();
+		nMinReceived = LTMIN(nMinReceived, pClient->GetBytesReceived());
+		nMaxReceived = LTMAX(nMaxReceived, pClient->GetBytesReceived());
+	}
+
+	uint32 nPending = m_nPendingClients;
+	dsi_ConsolePrint("LoadTest: %u clients, %u connected, %u in the world, %u failed to connect, %u waiting",
+		nNumClients + nPending, nConnected, nInWorld, (uint32)m_nFailedConnects, nNumClients - nNextConnect + nPending);
+
+	// How the server is holding up
+	const CTickStats &cTickStats = g_pServerMgr->m_TickStats;
+	dsi_ConsolePrint("Tick (us): p50 %.1f, p90 %.1f, p99 %.1f, max %.1f",
+		cTickStats.GetPercentileUS(eTickPhase_Tick, 50.0f), cTickStats.GetPercentileUS(eTickPhase_Tick, 90.0f),
+		cTickStats.GetPercentileUS(eTickPhase_Tick, 99.0f), (float)cTickStats.GetPhase(eTickPhase_Tick).m_nMaxNS / 1000.0f);
+	dsi_ConsolePrint("ClientSend (us): p50 %.1f, p99 %.1f   LoadTest moves (us): p50 %.1f, p99 %.1f",
+		cTickStats.GetPercentileUS(eTickPhase_ClientSend, 50.0f), cTickStats.GetPercentileUS(eTickPhase_ClientSend, 99.0f),
+		cTickStats.GetPercentileUS(eTickPhase_LoadTest, 50.0f), cTickStats.GetPercentileUS(eTickPhase_LoadTest, 99.0f));
+
+	// Traffic per client
+	float fSeconds = (float)(time_GetNSTime() - m_nStatsStartTime) / 1000000000.0f;
+	if (nConnected && (fSeconds > 0.0f))
+	{
+		dsi_ConsolePrint("Bytes/sec per client: down %.0f (min %.0f, max %.0f), up %.0f",
+			(float)nTotalReceived / (float)nConnected / fSeconds,
+			(float)nMinReceived / fSeconds, (float)nMaxReceived / fSeconds,
+			(float)nTotalSent / (float)nConnected / fSeconds);
+	}
+
+	// The server's guaranteed queues for all the remote clients
+	uint32 nMaxDepth = 0, nTotalDepth = 0, nPauses = 0, nRemoteClients = 0;
+	uint32 nRecoveredFrames = 0, nTotalRecoveryTime = 0, nMaxRecoveryTime = 0;
+	LTLink *pListHead = &g_pServerMgr->m_Clients.m_Head;
+	for (LTLink *pCur = pListHead->m_pNext; pCur != pListHead; pCur = pCur->m_pNext)
+	{
+		Client *pServerClient = (Client*)pCur->m_pData;
+		if ((pServerClient->m_ClientFlags & CFLAG_LOCAL) || !pServerClient->m_ConnectionID)
+			continue;
+
+		uint32 nDepth = pServerClient->m_ConnectionID->GetGuaranteedQueueDepth();
+		nMaxDepth = LTMAX(nMaxDepth, nDepth);
+		nTotalDepth += nDepth;
+		nPauses += pServerClient->m_ConnectionID->GetNumGuaranteedPauses();
+		nRecoveredFrames += pServerClient->m_ConnectionID->GetNumRecoveredFrames();
+		nTotalRecoveryTime += pServerClient->m_ConnectionID->GetTotalRecoveryTime();
+		nMaxRecoveryTime = LTMAX(nMaxRecoveryTime, pServerClient->m_ConnectionID->GetMaxRecoveryTime());
+		++nRemoteClients;
+	}
+	dsi_ConsolePrint("Guaranteed queue: mean %.1f, max %u, %u pauses since connecting",
+		nRemoteClients ? (float)nTotalDepth / (float)nRemoteClients : 0.0f, nMaxDepth, nPauses);
+	dsi_ConsolePrint("Lost guaranteed frames: %u re-sent, took mean %.1fms, max %ums to get through",
+		nRecoveredFrames, nRecoveredFrames ? (float)nTotalRecoveryTime / (float)nRecoveredFrames : 0.0f, nMaxRecoveryTime);
+
+	// Leave out what the clients are using
+	uint32 nClientBytes = LTMIN(dm_GetExcludedBytesAllocated(), dm_GetBytesAllocated());
+	uint32 nClientAllocations = LTMIN(dm_GetExcludedNumAllocations(), dm_GetNumAllocations());
+	dsi_ConsolePrint("Memory: %uk in %u allocations, not counting %uk in %u allocations for the load test clients",
+		(dm_GetBytesAllocated() - nClientBytes) / 1024, dm_GetNumAllocations() - nClientAllocations,
+		nClientBytes / 1024, nClientAllocations);
+}
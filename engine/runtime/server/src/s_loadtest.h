@@ -0,0 +1,154 @@
+// Load testing with synthetic clients.
+//
+// CLoadTest connects scripted clients to this server over the loopback interface.
+// Each one has its own CNetMgr and UDP driver, so the server sees them exactly
+// like real remote clients.  They answer the connection handshake (hello, file
+// status, connect stages) the way CClientShell does, ack the delta snapshots
+// without decoding them, and count everything else they get.  Once a client is
+// in the world, its object is walked around in a circle so the updates have
+// something to send.
+//
+// The clients run on a thread of their own at LoadTestClientFPS, so building and
+// sending their packets doesn't count against the server's tick.  Connecting
+// blocks until the server's listen thread answers, so a few are connected per
+// client frame.  Their drivers bind to any free port, so they never touch the
+// IPClientPort console variables from that thread.  Walking their objects around
+// changes server state, so that's done on the server thread in the LoadTest tick
+// phase.  The memory the client thread allocates is left out of the server's 
+// memory stats.
+//
+// The memory tracking (LTMEMTRACK) isn't thread safe, so builds that have it
+// update the clients on the server thread instead.
+
+#ifndef __S_LOADTEST_H__
+#define __S_LOADTEST_H__
+
+#ifndef __NETMGR_H__
+#include "netmgr.h"
+#endif
+
+#ifndef __SNAPSHOTDELTA_H__
+#include "snapshotdelta.h"
+#endif
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Only ever touched by the LoadTest client thread, except for the accessors
+// marked below, which are safe to call from anywhere.
+class CLoadTestClient : public CNetHandler
+{
+public:
+	CLoadTestClient();
+	virtual ~CLoadTestClient();
+
+	// Connect to the server at pAddress.  Blocks until the server answers or gives up.
+	bool	Connect(const char *pAddress, LTGUID *pAppGuid);
+	void	Disconnect();
+
+	// Handle the incoming packets and answer them
+	void	Update(float fCurTime);
+
+	// Safe from any thread
+	bool	IsConnected() const { return m_bConnected.load(std::memory_order_relaxed); }
+	bool	IsInWorld() const { return m_bInWorld.load(std::memory_order_relaxed); }
+	// The object the server gave this client
+	uint16	GetObjectID() const { return m_nObjectID.load(std::memory_order_relaxed); }
+
+	uint64	GetBytesReceived() const { return m_nBytesReceived.load(std::memory_order_relaxed); }
+	uint64	GetBytesSent() const { return m_nBytesSent.load(std::memory_order_relaxed); }
+	uint32	GetPacketsReceived() const { return m_nPacketsReceived.load(std::memory_order_relaxed); }
+	void	ClearStats();
+
+// CNetHandler
+public:
+	virtual bool	NewConnectionNotify(CBaseConn *id, bool bIsLocal);
+	virtual void	DisconnectNotify(CBaseConn *id, EDisconnectReason eDisconnectReason);
+	virtual void	HandleUnknownPacket(const CPacket_Read &cPacket, uint8 senderAddr[4], uint16 senderPort) {}
+
+private:
+	void	ProcessPacket(CPacket_Read &cPacket);
+	void	Send(CPacket_Write &cPacket, uint32 nPacketFlags);
+
+	CNetMgr		m_NetMgr;
+	CBaseConn	*m_pServerConn;
+
+	std::atomic<bool>	m_bConnected;
+	std::atomic<bool>	m_bInWorld;
+	std::atomic<uint16>	m_nObjectID;
+
+	CSnapshotDeltaReceiver m_SnapshotDelta;
+
+	std::atomic<uint64>	m_nBytesReceived;
+	std::atomic<uint64>	m_nBytesSent;
+	std::atomic<uint32>	m_nPacketsReceived;
+};
+
+class CLoadTest
+{
+public:
+	CLoadTest();
+	~CLoadTest();
+
+	// Start connecting nNumClients clients (on top of any already running)
+	void	Start(uint32 nNumClients);
+	// Disconnect all of them
+	void	Stop();
+
+	bool	IsRunning() const { return m_bRunning; }
+
+	// Called by CServerMgr::Update.  Walks the clients' objects around.
+	void	Update(float fCurTime);
+
+	// Print the report to the console
+	void	PrintStats() const;
+	void	ClearStats();
+
+private:
+	// Where a client's object is walking around, and how far around it is
+	struct SMover
+	{
+		SMover() : m_bHaveCenter(false), m_fAngle(0.0f) { m_vCenter.Init(); }
+		bool	m_bHaveCenter;
+		LTVector m_vCenter;
+		float	m_fAngle;
+	};
+
+	// The client thread
+	void	ClientThread();
+	// Create, connect and update the clients for one client frame
+	void	UpdateClients(float fCurTime);
+	// Disconnect and delete all the clients
+	void	DeleteClients();
+
+	// Walk a client's object along its circle
+	void	MoveClientObject(SMover &cMover, uint16 nObjectID, float fFrameTime);
+
+	// Where the server is listening
+	char	m_aAddress[64];
+
+	bool	m_bRunning;
+	std::thread	m_cThread;
+	std::atomic<bool> m_bShutdown;
+
+	// Only the client thread changes the list, and it holds m_cClientMutex while
+	// it does.  Other threads have to hold it to look at the list.
+	std::vector<CLoadTestClient*> m_aClients;
+	mutable std::mutex m_cClientMutex;
+	// Clients Start() asked for which the client thread hasn't made yet
+	std::atomic<uint32> m_nPendingClients;
+	// Clients in m_aClients before this one have tried to connect
+	std::atomic<uint32> m_nNextConnect;
+	std::atomic<uint32> m_nFailedConnects;
+
+	// Parallel to m_aClients (server thread only)
+	std::vector<SMover> m_aMovers;
+	float	m_fLastUpdateTime;
+
+	// When the stats were last cleared
+	uint64	m_nStatsStartTime;
+};
+
+#endif  // __S_LOADTEST_H__
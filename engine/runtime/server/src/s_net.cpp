@@ -135,6 +135,18 @@ LTRESULT OnClientUpdatePacket(CPacket_Read &cPacket, Client *pClient)
 }
 
 
+LTRESULT OnSnapshotAckPacket(CPacket_Read &cPacket, Client *pClient)
+{
+    // Local clients always get everything in full
+    if (!pClient || (pClient->m_ClientFlags & CFLAG_LOCAL))
+        return LT_OK;
+
+    pClient->m_SnapshotDelta.OnAck(cPacket);
+
+    return LT_OK;
+}
+
+
 LTRESULT OnClientDisconnectPacket(CPacket_Read &cPacket, Client *pClient)
 {
     if (pClient && pClient->m_ConnectionID)
@@ -370,6 +382,23 @@ void sm_WriteChangedModelFiles(LTObject *pObj, CPacket_Write &cPacket, ObjectCre
 	cPacket.Writeuint8(0xFF);
 }
 
+// Where WriteAnimInfo puts the dirty trackers when it's not cleaning them
+static thread_local TDirtyTrackerList *t_pDirtyTrackerList = LTNULL;
+
+void sm_SetDirtyTrackerList(TDirtyTrackerList *pList)
+{
+	t_pDirtyTrackerList = pList;
+}
+
+void sm_CleanDirtyTrackers(TDirtyTrackerList &aTrackers)
+{
+	for (TDirtyTrackerList::iterator iCurTracker = aTrackers.begin(); iCurTracker != aTrackers.end(); ++iCurTracker)
+	{
+		(*iCurTracker)->m_bDirty = false;
+	}
+	aTrackers.clear();
+}
+
 // ----------------------------------------------------------------------- //
 // Writes the model animation info into the packet.
 // ----------------------------------------------------------------------- //
@@ -403,7 +432,10 @@ void WriteAnimInfo(ModelInstance *pInst, CPacket_Write &cPacket)
 				if(pTracker->m_bDirty)
 				{
 					cPacket.Writebool(true);
-					pTracker->m_bDirty = false;
+					if (t_pDirtyTrackerList)
+						t_pDirtyTrackerList->push_back(pTracker);
+					else
+						pTracker->m_bDirty = false;
 				}
 				else
 				{
@@ -1271,6 +1303,7 @@ void InitServerNetHandlers()
     g_ServerHandlers[CMSG_GOODBYE].m_Fn = &OnClientDisconnectPacket;
     g_ServerHandlers[CMSG_UPDATE].m_Fn = &OnClientUpdatePacket;
     g_ServerHandlers[CMSG_SOUNDUPDATE].m_Fn = &OnSoundUpdatePacket;
+    g_ServerHandlers[CMSG_SNAPSHOTACK].m_Fn = &OnSnapshotAckPacket;
     g_ServerHandlers[CMSG_COMMANDSTRING].m_Fn = &OnCommandStringPacket;
     g_ServerHandlers[CMSG_MESSAGE].m_Fn = &OnMessagePacket;
     g_ServerHandlers[CMSG_CONNECTSTAGE].m_Fn = &OnConnectStagePacket;
@@ -7,12 +7,15 @@
 #ifndef __S_NET_H__
 #define __S_NET_H__
 
+#include <vector>
+
 class CServerMgr;
 class CServerEvent;
 struct Client;
 class ModelInstance;
 struct ObjInfo;
 class CSoundTrack;
+class LTAnimTracker;
 
 extern int32 g_bDebugPackets;
 
@@ -42,6 +45,16 @@ void sm_WriteChangedModelFiles(LTObject *pObj, CPacket_Write &cPacket, ObjectCre
 // Writes the model animation info into the packet.
 void WriteAnimInfo(ModelInstance *pInst, CPacket_Write &cPacket);
 
+// WriteAnimInfo normally cleans the dirty trackers as it writes them.  While a list is
+// set, the dirty trackers written on this thread are added to the list instead, so
+// client updates can be built on several threads at once.  Pass LTNULL to go back to
+// cleaning them right away.
+typedef std::vector<LTAnimTracker*> TDirtyTrackerList;
+void sm_SetDirtyTrackerList(TDirtyTrackerList *pList);
+
+// Cleans the trackers collected in the list, and empties it.
+void sm_CleanDirtyTrackers(TDirtyTrackerList &aTrackers);
+
 // Looks at the flags in pInfo and fills the packet with update data.
 // Returns FALSE if no info needed to be sent.
 bool FillPacketFromInfo(Client *pClient, LTObject *pObj, ObjInfo *pInfo, CPacket_Write &cPacket);
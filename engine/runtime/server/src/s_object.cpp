@@ -32,6 +32,16 @@
 #include "dhashtable.h"
 #include "s_client.h"
 #include "ltobjectcreate.h"
+#include "moveplayer.h"
+#include "iltphysics.h"
+#include "taskpool.h"
+
+#include <algorithm>
+#include <vector>
+
+
+extern int32 g_CV_ServerMoveThreads;
+extern int32 g_CV_NewPlayerPhysics;
 
 
 
@@ -47,6 +57,11 @@
 static IWorldServerBSP *world_bsp_server;
 define_holder(IWorldServerBSP, world_bsp_server);
 
+//IWorldBlockerData holder
+#include "world_blocker_data.h"
+static IWorldBlockerData *g_iWorldBlockerData = LTNULL;
+define_holder(IWorldBlockerData, g_iWorldBlockerData);
+
 
 //---------------------------------------------------------------------------//
 void GetPhysicsVector (LTObject *pObj, float dt, LTVector& dr)
@@ -115,6 +130,382 @@ void GetPhysicsVector (LTObject *pObj, float dt, LTVector& dr)
 }
 
 
+//---------------------------------------------------------------------------//
+// Move the object by dr from wherever it is now.  P0 is where it was before
+// its physics were worked out.
+static void PhysicsMoveObject(LTObject *pObj, const LTVector &P0, const LTVector &dr, const CPlayerMoveRecord *pSolve)
+{
+    const LTVector P1 = pObj->GetPos() + dr;
+
+    FullMoveObject(pObj, &P1, MO_DETACHSTANDING | MO_MOVESTANDINGONS, pSolve);
+
+    // Remove it if it's outside.
+    if (((pObj->m_Flags & FLAG_REMOVEIFOUTSIDE) != 0) &&
+        world_bsp_server->IsLoaded() &&
+        world_bsp_server->IsOutsideWorld(pObj->GetPos()))
+    {
+        AddObjectToRemoveList(pObj);
+        return;
+    }
+
+    // If it's still in the world, set its change flags..
+    if (pObj->m_InternalFlags & IFLAG_INWORLD)
+    {
+        const LTVector v = pObj->GetPos() - P0;//net displacement
+        const float d2 = v.Dot(v);//displacement squared
+
+        if (d2 > 0.001f)
+        {
+            SetObjectChangeFlags(pObj, CF_POSITION);
+        }
+    }
+}
+
+
+//---------------------------------------------------------------------------//
+// With ServerMoveThreads set to anything but 1, PhysicsUpdateObject doesn't move
+// player objects (the ones CPlayerMover moves) right away.  Their moves are
+// queued up, and sm_ResolvePhysicsMoves does them after all the objects have
+// updated.  Other objects still move during their own update, same as ever.
+//
+// That means object updates later in the frame see queued players where they
+// were at the start of the frame, not where they'd have moved to.  Moves are
+// dropped if the object leaves the world, is going away, or is teleported
+// (SetObjectPos) before they're done.
+//
+// - The moves are split into islands:  moves whose boxes (the swept box plus
+//   how far the move could reach) overlap are in the same island.
+// - The player moves' first sweeps against the blocker polygons are done
+//   together with IWorldBlockerData::IntersectPacket.  A move uses its result
+//   if it starts that same sweep (see CPlayerMover::GetBlockerSweep).
+// - The first move in each island, if it's a player mover (CPlayerMover), is
+//   worked out ahead of time on the move threads.  Nothing changes the world
+//   while they run, and the world tree is only read with
+//   FindObjectsInBoxReadOnly.
+// - Then every move is done on the server thread in the order it was queued,
+//   same as ever.  A move that was worked out ahead of time skips the collision
+//   work, but only if everything it looked at is still the same (see
+//   CPlayerMover::IsSolveCurrent); otherwise it's worked out again.
+//
+// So the results are the same as doing the queued moves one after another no
+// matter how many threads there are, the threads just get most of the collision
+// work done for moves that don't run into each other.
+//---------------------------------------------------------------------------//
+
+struct SPhysicsMove
+{
+    LTObject    *m_pObj;
+    // Where it was before GetPhysicsVector, and how far it's going
+    LTVector    m_vStartPos;
+    LTVector    m_vDelta;
+
+    // Box around anything the move could run into
+    LTVector    m_vMin;
+    LTVector    m_vMax;
+    // Index of the first move in its island (union-find parent while they're being built)
+    uint32      m_nIsland;
+
+    // Filled in if the move was worked out ahead of time
+    CPlayerMoveRecord m_cSolve;
+};
+
+// Can the move still be done?
+static bool sm_IsPhysicsMoveLive(const SPhysicsMove &cMove)
+{
+    const LTObject *pObj = cMove.m_pObj;
+    return pObj &&
+        (pObj->m_InternalFlags & IFLAG_INWORLD) &&
+        !(pObj->m_InternalFlags & IFLAG_OBJECTGOINGAWAY);
+}
+
+// The queued moves.  The list isn't shrunk between frames, so the records keep their memory.
+static std::vector<SPhysicsMove> g_aPhysicsMoves;
+static uint32 g_nNumPhysicsMoves = 0;
+// Set while the queued moves are being done, so anything that comes in then is done right away
+static bool g_bResolvingPhysicsMoves = false;
+
+// The threads used for working out moves ahead of time
+static CTaskPool g_PhysicsMovePool;
+static bool g_bPhysicsMovePoolInit = false;
+
+// Should PhysicsUpdateObject queue its moves?
+static bool sm_QueuePhysicsMoves()
+{
+    return (g_CV_ServerMoveThreads != 1) && !g_bResolvingPhysicsMoves;
+}
+
+// Get the move pool going with the number of threads asked for in ServerMoveThreads
+static CTaskPool *sm_GetPhysicsMovePool()
+{
+    uint32 nNumWorkers;
+#ifdef LTMEMTRACK
+    // The memory tracking isn't thread safe
+    nNumWorkers = 0;
+#else
+    if (g_CV_ServerMoveThreads <= 0)
+        nNumWorkers = CTaskPool::GetDefaultNumWorkers();
+    else
+        nNumWorkers = (uint32)g_CV_ServerMoveThreads - 1;
+#endif
+
+    if (!g_bPhysicsMovePoolInit || (g_PhysicsMovePool.GetNumWorkers() != nNumWorkers))
+    {
+        g_PhysicsMovePool.Init(nNumWorkers);
+        g_bPhysicsMovePoolInit = true;
+    }
+
+    return &g_PhysicsMovePool;
+}
+
+void sm_TermPhysicsMovePool()
+{
+    g_PhysicsMovePool.Term();
+    g_bPhysicsMovePoolInit = false;
+}
+
+void sm_ClearPhysicsMoves()
+{
+    g_nNumPhysicsMoves = 0;
+}
+
+void sm_DropPhysicsMoves(LTObject *pObj)
+{
+    for (uint32 nMove = 0; nMove < g_nNumPhysicsMoves; ++nMove)
+    {
+        if (g_aPhysicsMoves[nMove].m_pObj == pObj)
+            g_aPhysicsMoves[nMove].m_pObj = LTNULL;
+    }
+}
+
+static void sm_QueuePhysicsMove(LTObject *pObj, const LTVector &P0, const LTVector &dr)
+{
+    if (g_nNumPhysicsMoves == g_aPhysicsMoves.size())
+        g_aPhysicsMoves.resize(g_nNumPhysicsMoves + 1);
+
+    SPhysicsMove &cMove = g_aPhysicsMoves[g_nNumPhysicsMoves++];
+    cMove.m_pObj = pObj;
+    cMove.m_vStartPos = P0;
+    cMove.m_vDelta = dr;
+}
+
+static uint32 sm_FindIsland(uint32 nMove)
+{
+    while (g_aPhysicsMoves[nMove].m_nIsland != nMove)
+    {
+        // Halve the path on the way up
+        uint32 nParent = g_aPhysicsMoves[nMove].m_nIsland;
+        g_aPhysicsMoves[nMove].m_nIsland = g_aPhysicsMoves[nParent].m_nIsland;
+        nMove = nParent;
+    }
+
+    return nMove;
+}
+
+// Put two moves in the same island, which goes by the move that was queued first
+static void sm_JoinIslands(uint32 nMove1, uint32 nMove2)
+{
+    uint32 nIsland1 = sm_FindIsland(nMove1);
+    uint32 nIsland2 = sm_FindIsland(nMove2);
+
+    if (nIsland1 < nIsland2)
+        g_aPhysicsMoves[nIsland2].m_nIsland = nIsland1;
+    else if (nIsland2 < nIsland1)
+        g_aPhysicsMoves[nIsland1].m_nIsland = nIsland2;
+}
+
+// Sorts moves by the bottom of their boxes on X, then by queue order
+struct SPhysicsMoveMinXLess
+{
+    bool operator()(uint32 nMove1, uint32 nMove2) const
+    {
+        float fMin1 = g_aPhysicsMoves[nMove1].m_vMin.x;
+        float fMin2 = g_aPhysicsMoves[nMove2].m_vMin.x;
+        return (fMin1 < fMin2) || ((fMin1 == fMin2) && (nMove1 < nMove2));
+    }
+};
+
+static void sm_BuildPhysicsMoveIslands()
+{
+    // How far past its swept box a move can reach.  Stepping up stairs and the
+    // slope checks are the farthest a player mover looks.  It only decides what
+    // gets worked out ahead of time; the results are checked anyway.
+    float fStairHeight = 0.0f;
+    g_pServerMgr->m_MoveAbstract->GetPhysics()->GetStairHeight(fStairHeight);
+    const float fReach = fStairHeight * 3.0f + 1.0f;
+
+    std::vector<uint32> aSorted;
+    aSorted.reserve(g_nNumPhysicsMoves);
+
+    for (uint32 nMove = 0; nMove < g_nNumPhysicsMoves; ++nMove)
+    {
+        SPhysicsMove &cMove = g_aPhysicsMoves[nMove];
+        cMove.m_nIsland = nMove;
+
+        // Dropped moves are left on their own
+        if (!cMove.m_pObj)
+            continue;
+
+        const LTVector &vPos = cMove.m_pObj->GetPos();
+        const LTVector vEnd = vPos + cMove.m_vDelta;
+        const LTVector &vDims = cMove.m_pObj->GetDims();
+        const float fRadius = LTMAX(vDims.x, vDims.z);
+        const LTVector vGrow(fRadius + fReach, vDims.y + fReach, fRadius + fReach);
+
+        VEC_MIN(cMove.m_vMin, vPos, vEnd);
+        VEC_MAX(cMove.m_vMax, vPos, vEnd);
+        cMove.m_vMin -= vGrow;
+        cMove.m_vMax += vGrow;
+
+        aSorted.push_back(nMove);
+    }
+
+    // Sweep along X, only testing the moves that overlap there
+    std::sort(aSorted.begin(), aSorted.end(), SPhysicsMoveMinXLess());
+
+    const uint32 nNumSorted = (uint32)aSorted.size();
+    for (uint32 nSorted = 0; nSorted < nNumSorted; ++nSorted)
+    {
+        const SPhysicsMove &cMove = g_aPhysicsMoves[aSorted[nSorted]];
+
+        for (uint32 nOther = nSorted + 1; nOther < nNumSorted; ++nOther)
+        {
+            const SPhysicsMove &cOther = g_aPhysicsMoves[aSorted[nOther]];
+            if (cOther.m_vMin.x > cMove.m_vMax.x)
+                break;
+
+            if ((cOther.m_vMin.y <= cMove.m_vMax.y) && (cOther.m_vMax.y >= cMove.m_vMin.y) &&
+                (cOther.m_vMin.z <= cMove.m_vMax.z) && (cOther.m_vMax.z >= cMove.m_vMin.z))
+            {
+                sm_JoinIslands(aSorted[nSorted], aSorted[nOther]);
+            }
+        }
+    }
+}
+
+// Would MoveObject send this object through CPlayerMover?
+static bool sm_IsPlayerMove(LTObject *pObj)
+{
+    return g_CV_NewPlayerPhysics &&
+        CPlayerMover::ShouldMoveObject(pObj, true) &&
+        !(pObj->m_InternalFlags & IFLAG_MOVING) &&
+        pObj->IsMoveable() &&
+        !CanOptimizeObject(pObj);
+}
+
+struct SPhysicsMoveSolve
+{
+    WorldTree       *m_pWorldTree;
+    SPhysicsMove    **m_pMoves;
+};
+
+static void sm_SolvePhysicsMove(void *pUser, uint32 nTask)
+{
+    SPhysicsMoveSolve *pSolve = (SPhysicsMoveSolve*)pUser;
+    SPhysicsMove *pMove = pSolve->m_pMoves[nTask];
+
+    MoveState moveState;
+    moveState.Setup(pSolve->m_pWorldTree, g_pServerMgr->m_MoveAbstract, pMove->m_pObj, pMove->m_pObj->m_BPriority);
+    moveState.SetupCall();
+
+    CPlayerMover cMover(moveState, MO_DETACHSTANDING | MO_MOVESTANDINGONS);
+    cMover.SolveAhead(pMove->m_pObj->GetPos() + pMove->m_vDelta, &pMove->m_cSolve);
+}
+
+// Do the queued player moves' first blocker sweeps all at once
+static void sm_SweepPhysicsMoveBlockers()
+{
+    static std::vector<IWorldBlockerData::SSweep> aSweeps;
+    static std::vector<IWorldBlockerData::SSweepResult> aResults;
+    static std::vector<SPhysicsMove*> aSwept;
+    aSweeps.clear();
+    aSwept.clear();
+
+    WorldTree *pWorldTree = world_bsp_server->ServerTree();
+    for (uint32 nMove = 0; nMove < g_nNumPhysicsMoves; ++nMove)
+    {
+        SPhysicsMove &cMove = g_aPhysicsMoves[nMove];
+        cMove.m_cSolve.ClearBlockerSweep();
+
+        if (!cMove.m_pObj || !sm_IsPlayerMove(cMove.m_pObj))
+            continue;
+
+        MoveState moveState;
+        moveState.Setup(pWorldTree, g_pServerMgr->m_MoveAbstract, cMove.m_pObj, cMove.m_pObj->m_BPriority);
+        moveState.SetupCall();
+
+        CPlayerMover cMover(moveState, MO_DETACHSTANDING | MO_MOVESTANDINGONS);
+        IWorldBlockerData::SSweep sSweep;
+        if (!cMover.GetBlockerSweep(cMove.m_pObj->GetPos() + cMove.m_vDelta, &sSweep))
+            continue;
+
+        aSweeps.push_back(sSweep);
+        aSwept.push_back(&cMove);
+    }
+
+    if (aSweeps.empty())
+        return;
+
+    aResults.resize(aSweeps.size());
+    g_iWorldBlockerData->IntersectPacket(&aSweeps[0], &aResults[0], (uint32)aSweeps.size());
+
+    for (uint32 nSweep = 0; nSweep < aSwept.size(); ++nSweep)
+    {
+        aSwept[nSweep]->m_cSolve.SetBlockerSweep(aSweeps[nSweep], aResults[nSweep]);
+    }
+}
+
+void sm_ResolvePhysicsMoves()
+{
+    if (!g_nNumPhysicsMoves)
+        return;
+
+    // Drop the moves for objects that left the world or are going away
+    for (uint32 nMove = 0; nMove < g_nNumPhysicsMoves; ++nMove)
+    {
+        if (!sm_IsPhysicsMoveLive(g_aPhysicsMoves[nMove]))
+            g_aPhysicsMoves[nMove].m_pObj = LTNULL;
+    }
+
+    sm_BuildPhysicsMoveIslands();
+    sm_SweepPhysicsMoveBlockers();
+
+    // Work out the first move in each island ahead of time
+    std::vector<SPhysicsMove*> aSolve;
+    for (uint32 nMove = 0; nMove < g_nNumPhysicsMoves; ++nMove)
+    {
+        SPhysicsMove &cMove = g_aPhysicsMoves[nMove];
+        cMove.m_cSolve.Clear();
+
+        if (cMove.m_pObj && (sm_FindIsland(nMove) == nMove) && sm_IsPlayerMove(cMove.m_pObj))
+            aSolve.push_back(&cMove);
+    }
+
+    if (!aSolve.empty())
+    {
+        SPhysicsMoveSolve cSolve;
+        cSolve.m_pWorldTree = world_bsp_server->ServerTree();
+        cSolve.m_pMoves = &aSolve[0];
+        sm_GetPhysicsMovePool()->Run((uint32)aSolve.size(), sm_SolvePhysicsMove, &cSolve);
+    }
+
+    // Do them all in order.  The earlier moves can remove or teleport objects.
+    g_bResolvingPhysicsMoves = true;
+
+    for (uint32 nMove = 0; nMove < g_nNumPhysicsMoves; ++nMove)
+    {
+        SPhysicsMove &cMove = g_aPhysicsMoves[nMove];
+        if (!sm_IsPhysicsMoveLive(cMove))
+            continue;
+
+        PhysicsMoveObject(cMove.m_pObj, cMove.m_vStartPos, cMove.m_vDelta, &cMove.m_cSolve);
+    }
+
+    g_bResolvingPhysicsMoves = false;
+    g_nNumPhysicsMoves = 0;
+}
+
+
+//---------------------------------------------------------------------------//
 void PhysicsUpdateObject(LTObject *pObj)
 {
     //if physics is disabled, drop out early
@@ -134,30 +525,10 @@ void PhysicsUpdateObject(LTObject *pObj)
     // Call MoveObject() for it automatically if tried to move at all.
     if (dr.MagSqr() > 0.0001f)
     {
-        const LTVector P1 = pObj->GetPos() + dr;
-
-        FullMoveObject(pObj, &P1, MO_DETACHSTANDING | MO_MOVESTANDINGONS);
-
-        // Remove it if it's outside.
-        if (((pObj->m_Flags & FLAG_REMOVEIFOUTSIDE) != 0) &&
-            world_bsp_server->IsLoaded() &&
-            world_bsp_server->IsOutsideWorld(pObj->GetPos()))
-        {
-            AddObjectToRemoveList(pObj);
-            return;
-        }
-
-        // If it's still in the world, set its change flags..
-        if (pObj->m_InternalFlags & IFLAG_INWORLD)
-        {
-            const LTVector v = pObj->GetPos() - P0;//net displacement
-            const float d2 = v.Dot(v);//displacement squared
-
-            if (d2 > 0.001f)
-            {
-                SetObjectChangeFlags(pObj, CF_POSITION);
-            }
-        }
+        if (sm_QueuePhysicsMoves() && sm_IsPlayerMove(pObj))
+            sm_QueuePhysicsMove(pObj, P0, dr);
+        else
+            PhysicsMoveObject(pObj, P0, dr, LTNULL);
     }
 }
 
@@ -220,6 +591,9 @@ LTRESULT sm_UpdateInBspStatus(LTObject *pObject)
         pObject->RemoveFromWorldTree();
     }
 
+    // The flags might have changed whether it's on the interest grid's global list.
+    g_pServerMgr->m_InterestGrid.UpdateObject(pObject);
+
     return LT_OK;
 }
 
@@ -55,6 +55,19 @@ void DeleteModels();
 // Fully updates the object (called once per frame).
 void FullObjectUpdate(LTObject *pObj);
 
+// Does the player physics moves that FullObjectUpdate queued up (see ServerMoveThreads).
+// Called after all the objects have updated.
+void sm_ResolvePhysicsMoves();
+
+// Forget about the queued physics moves (for when the objects are going away).
+void sm_ClearPhysicsMoves();
+
+// Forget about any physics move queued for the object (it was teleported).
+void sm_DropPhysicsMoves(LTObject *pObj);
+
+// Shut down the threads sm_ResolvePhysicsMoves uses.
+void sm_TermPhysicsMovePool();
+
 // Loads and instantiates objects from the given world file.
 LTRESULT LoadObjects(ILTStream *pStream, const char *pWorldName, bool bAllObjects, uint32 nObjectDataOffset );
 
@@ -0,0 +1,152 @@
+#include "bdefs.h"
+
+#include "s_tick.h"
+
+
+//------------------------------------------------------------------
+// CTickScheduler
+//------------------------------------------------------------------
+
+CTickScheduler::CTickScheduler() :
+	m_fTicksPerSec(0.0f),
+	m_nPeriod(0),
+	m_nBaseTime(0),
+	m_nTickNum(0),
+	m_nDroppedTicks(0)
+{
+}
+
+void CTickScheduler::Reset()
+{
+	m_nBaseTime = time_GetNSTime();
+	m_nTickNum = 0;
+}
+
+void CTickScheduler::SetRate(float fTicksPerSec)
+{
+	if (fTicksPerSec == m_fTicksPerSec)
+		return;
+
+	m_fTicksPerSec = fTicksPerSec;
+	m_nPeriod = (fTicksPerSec > 0.0f) ? (uint64)(1000000000.0 / fTicksPerSec) : 0;
+	Reset();
+}
+
+uint64 CTickScheduler::GetTimeToNextTick() const
+{
+	uint64 nDeadline = m_nBaseTime + m_nTickNum * m_nPeriod;
+	uint64 nCurTime = time_GetNSTime();
+	return (nDeadline > nCurTime) ? (nDeadline - nCurTime) : 0;
+}
+
+void CTickScheduler::Wait(uint64 nMaxWaitNS)
+{
+	uint64 nTimeLeft = GetTimeToNextTick();
+	if (!nTimeLeft)
+		return;
+
+	time_SleepUntilNS(time_GetNSTime() + LTMIN(nTimeLeft, nMaxWaitNS));
+}
+
+uint64 CTickScheduler::BeginTick()
+{
+	uint64 nDeadline = m_nBaseTime + m_nTickNum * m_nPeriod;
+	uint64 nCurTime = time_GetNSTime();
+	uint64 nLate = (nCurTime > nDeadline) ? (nCurTime - nDeadline) : 0;
+
+	// Too far behind to catch up?  Forget about the ticks we missed.
+	if (m_nPeriod && (nLate > m_nPeriod * k_nMaxCatchupTicks))
+	{
+		m_nDroppedTicks += (uint32)(nLate / m_nPeriod);
+		m_nBaseTime = nCurTime;
+		m_nTickNum = 0;
+	}
+
+	++m_nTickNum;
+
+	return nLate;
+}
+
+
+//------------------------------------------------------------------
+// CTickStats
+//------------------------------------------------------------------
+
+void CTickStats::Clear()
+{
+	memset(m_aPhases, 0, sizeof(m_aPhases));
+}
+
+void CTickStats::Add(ETickPhase ePhase, uint64 nTimeNS)
+{
+	SPhase &cPhase = m_aPhases[ePhase];
+
+	++cPhase.m_nCount;
+	cPhase.m_nTotalNS += nTimeNS;
+	cPhase.m_nMaxNS = LTMAX(cPhase.m_nMaxNS, nTimeNS);
+
+	uint64 nTimeUS = nTimeNS / 1000;
+	uint32 nBucket = 0;
+	while (nTimeUS && (nBucket < k_nNumBuckets - 1))
+	{
+		nTimeUS >>= 1;
+		++nBucket;
+	}
+	++cPhase.m_aBuckets[nBucket];
+}
+
+void CTickStats::BeginTick()
+{
+	uint64 nCurTime = time_GetNSTime();
+	if (m_nLastTickStart)
+		Add(eTickPhase_Tick, nCurTime - m_nLastTickStart);
+	m_nLastTickStart = nCurTime;
+}
+
+float CTickStats::GetPercentileUS(ETickPhase ePhase, float fPercentile) const
+{
+	const SPhase &cPhase = m_aPhases[ePhase];
+	if (!cPhase.m_nCount)
+		return 0.0f;
+
+	float fTarget = (float)cPhase.m_nCount * LTCLAMP(fPercentile, 0.0f, 100.0f) / 100.0f;
+
+	uint32 nSoFar = 0;
+	for (uint32 nCurBucket = 0; nCurBucket < k_nNumBuckets; ++nCurBucket)
+	{
+		uint32 nInBucket = cPhase.m_aBuckets[nCurBucket];
+		if (!nInBucket || ((float)(nSoFar + nInBucket) < fTarget))
+		{
+			nSoFar += nInBucket;
+			continue;
+		}
+
+		// Interpolate across the bucket
+		float fLow = nCurBucket ? (float)(1 << (nCurBucket - 1)) : 0.0f;
+		float fHigh = (float)((uint64)1 << nCurBucket);
+		float fResult = fLow + (fHigh - fLow) * (fTarget - (float)nSoFar) / (float)nInBucket;
+
+		// Don't go over the worst one we actually saw
+		return LTMIN(fResult, (float)cPhase.m_nMaxNS / 1000.0f);
+	}
+
+	return (float)cPhase.m_nMaxNS / 1000.0f;
+}
+
+const char *CTickStats::GetPhaseName(ETickPhase ePhase)
+{
+	static const char *s_aNames[eTickPhase_Count] =
+	{
+		"NetIn",
+		"ShellUpdate",
+		"PreUpdateObjects",
+		"Remove",
+		"ClientSend",
+		"LoadTest",
+		"Sleep",
+		"Late",
+		"Tick"
+	};
+
+	return s_aNames[ePhase];
+}
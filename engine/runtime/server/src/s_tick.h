@@ -0,0 +1,125 @@
+// Server tick pacing and per-phase tick timing.
+//
+// CTickScheduler locks a stand-alone server to ServerFPS.  Tick deadlines are
+// absolute (base + n * period on the monotonic nanosecond clock), so sleeping
+// long or running a slow tick doesn't drift the rate; the next tick just comes
+// sooner.  If the server falls more than k_nMaxCatchupTicks behind it gives up
+// on the missed ticks and starts over from the current time.
+//
+// CTickStats keeps a log2 histogram of how long each phase of the server update
+// takes, for the TickStats console command.
+
+#ifndef __S_TICK_H__
+#define __S_TICK_H__
+
+#ifndef __SYSTIMER_H__
+#include "systimer.h"
+#endif
+
+enum ETickPhase
+{
+	eTickPhase_NetIn,			// ProcessIncomingPackets
+	eTickPhase_ShellUpdate,		// IServerShell::Update
+	eTickPhase_PreUpdateObjects,	// CServerMgr::PreUpdateObjects
+	eTickPhase_Remove,			// Removing objects and sounds
+	eTickPhase_ClientSend,		// Building and sending the client updates
+	eTickPhase_LoadTest,		// Walking the LoadTest clients' objects around
+	eTickPhase_Sleep,			// Waiting for the next tick
+	eTickPhase_Late,			// How far past its deadline each tick started
+	eTickPhase_Tick,			// Start of one tick to the start of the next
+
+	eTickPhase_Count
+};
+
+class CTickScheduler
+{
+public:
+	enum { k_nMaxCatchupTicks = 3 };
+
+	CTickScheduler();
+
+	// Start over, with the next tick due right away
+	void	Reset();
+
+	// Change the tick rate.  Starts over if it's different.
+	void	SetRate(float fTicksPerSec);
+
+	// Nanoseconds until the next tick is due (0 if it's due now)
+	uint64	GetTimeToNextTick() const;
+
+	// Sleep until the next tick is due, or until nMaxWaitNS have gone by
+	void	Wait(uint64 nMaxWaitNS);
+
+	// Start the tick that's due, and move on to the next deadline.  Returns how
+	// late the tick is, in nanoseconds.
+	uint64	BeginTick();
+
+	// Ticks skipped by falling too far behind
+	uint32	GetNumDroppedTicks() const { return m_nDroppedTicks; }
+	void	ResetNumDroppedTicks() { m_nDroppedTicks = 0; }
+
+private:
+	float	m_fTicksPerSec;
+	uint64	m_nPeriod;
+	uint64	m_nBaseTime;
+	uint64	m_nTickNum;
+	uint32	m_nDroppedTicks;
+};
+
+class CTickStats
+{
+public:
+	// Bucket n holds times in [2^(n-1), 2^n) microseconds, bucket 0 is under 1us
+	enum { k_nNumBuckets = 32 };
+
+	struct SPhase
+	{
+		uint32 m_nCount;
+		uint64 m_nTotalNS;
+		uint64 m_nMaxNS;
+		uint32 m_aBuckets[k_nNumBuckets];
+	};
+
+	CTickStats() : m_nLastTickStart(0) { Clear(); }
+
+	void	Clear();
+
+	void	Add(ETickPhase ePhase, uint64 nTimeNS);
+
+	// Called at the start of each tick to time the whole tick
+	void	BeginTick();
+
+	const SPhase &GetPhase(ETickPhase ePhase) const { return m_aPhases[ePhase]; }
+
+	// Estimate a percentile (0-100) of a phase from its histogram, in microseconds
+	float	GetPercentileUS(ETickPhase ePhase, float fPercentile) const;
+
+	static const char *GetPhaseName(ETickPhase ePhase);
+
+private:
+	SPhase	m_aPhases[eTickPhase_Count];
+	uint64	m_nLastTickStart;
+};
+
+// Adds the time spent in its scope to a phase
+class CTickPhaseTimer
+{
+public:
+	CTickPhaseTimer(CTickStats *pStats, ETickPhase ePhase) :
+		m_pStats(pStats),
+		m_ePhase(ePhase),
+		m_nStartTime(time_GetNSTime())
+	{
+	}
+	~CTickPhaseTimer()
+	{
+		m_pStats->Add(m_ePhase, time_GetNSTime() - m_nStartTime);
+	}
+
+private:
+	CTickStats *m_pStats;
+	ETickPhase m_ePhase;
+	uint64 m_nStartTime;
+};
+
+#endif  // __S_TICK_H__
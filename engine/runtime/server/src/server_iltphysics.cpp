@@ -127,7 +127,11 @@ LTRESULT CLTPhysicsServer::SetObjectDims(HOBJECT hObj, LTVector *pNewDims, uint3
         if (ChangeObjectDimensions(&moveState, newDims, !!(flags & SETDIMS_PUSHOBJECTS)))
         {
 			if (pObj->GetDims() != vOldDims)
+			{
 				SetObjectChangeFlags(pObj, CF_DIMS);
+				// Growing past a cell puts it on the interest grid's global list, and shrinking takes it off
+				g_pServerMgr->m_InterestGrid.UpdateObject(pObj);
+			}
             return LT_OK;
         }
         else
@@ -130,6 +130,7 @@ public:
 
 
 extern bool ServerIntersectSegment(IntersectQuery *pQuery, IntersectInfo *pInfo);
+extern uint32 ServerIntersectSegments(IntersectQuery *pQueries, IntersectInfo *pInfos, uint32 nQueries);
 
 
 // --------------------------------------------------------------- //
@@ -2025,17 +2026,7 @@ LTRESULT si_AddObjectToSky(HOBJECT hObject, uint32 index)
 		RETURN_ERROR_PARAM(1, ILTPhysics::AddObjectToSky, LT_ERROR, "invalid index");
 	}
 
-	// Is it already in the sky?
-	if (pObject->m_InternalFlags & IFLAG_INSKY)
-	{
-		return LT_OK;
-	}
-
-	pObject->m_InternalFlags |= IFLAG_INSKY;
-	g_pServerMgr->m_SkyObjects[index] = pObject->m_ObjectID;
-	sm_SetSendSkyDef();
-
-	return LT_OK;
+	return sm_AddObjectToSky(pObject, index);
 }
 
 
@@ -3050,6 +3041,7 @@ void CLTServer::SetupFunctionPointers()
 	SetGlobalLightObject = si_SetGlobalLightObject;
 
 	IntersectSegment = ServerIntersectSegment;
+	IntersectSegments = ServerIntersectSegments;
 	CastRay = si_CastRay;
 
 	GetObjectScale = si_GetObjectScale;
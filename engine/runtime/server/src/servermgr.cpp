@@ -28,6 +28,7 @@
 #include "stringmgr.h"
 #include "sysstreamsim.h"
 #include "game_serialize.h"
+#include "framearena.h"
 #include "server_interface.h"
 #include "server_extradata.h"
 #include "syscounter.h"
@@ -112,9 +113,16 @@ extern int32 g_CV_ShowGameTime;
 extern int32 g_CV_ShowSphereFindTicks;
 
 extern int32 g_CV_BandwidthTargetServer;
+extern float g_CV_InterestCellSize;
+extern int32 g_CV_PrefetchThreads;
 
 CServerMgr	  *g_pServerMgr = LTNULL;
 
+#ifdef DE_SERVER_COMPILE
+// How often to check for packets while waiting for the next tick
+static const uint64 k_nNetPollIntervalNS = 1000000;
+#endif // DE_SERVER_COMPILE
+
 #ifdef DE_SERVER_COMPILE
 	ObjectBank<LTLink> g_DLinkBank;
 #endif
@@ -245,6 +253,9 @@ void sm_FreeObjectScript(LTObject *pObject)
 // Removes all objects (including inactive ones) from the world.
 void sm_RemoveAllObjectsFromWorld(bool bRemoveStaticObjects) 
 {
+	// Don't move anything that's about to go away.
+	sm_ClearPhysicsMoves();
+
 	// Remove any objects waiting to get removed.. it does this here so their
 	// DLinks get freed correctly.
 	sm_RemoveObjectsThatNeedToGetRemoved();
@@ -336,12 +347,7 @@ void sm_UpdateClientStates()
  
 void sm_UpdateClientsInWorld() 
 {
-	LTLink *pListHead = &g_pServerMgr->m_Clients.m_Head;
-	for (LTLink *pCur = pListHead->m_pNext; pCur != pListHead; pCur = pCur->m_pNext) 
-	{
-		Client *pClient = (Client*)pCur->m_pData;
-		sm_UpdateClientInWorld(pClient);
-	}
+	sm_SendClientUpdates(&g_pServerMgr->m_Clients);
 
 	// Clear the send/drop counts
 	g_pServerMgr->m_nSendPackets = 0;
@@ -425,6 +431,8 @@ bool CServerMgr::Init()
 	m_ObjectMap.SetCacheSize(100);
 	m_CacheList = LTNULL;
 	m_CacheListSize = m_CacheListAllocedSize = 0;
+	m_pLoadingWorldFiles = LTNULL;
+	m_bCachingQueuedFiles = false;
 
 	memset(m_SkyObjects, 0xFF, sizeof(m_SkyObjects));
 
@@ -474,11 +482,6 @@ bool CServerMgr::Init()
 	m_pTracePacketFile = LTNULL;
 
 	m_FrameTime = 0.0f;
-	m_LastServerFPS = 0.0f;
-	#ifdef DE_SERVER_COMPILE
-	m_nTargetTimeSteps = 0;
-	m_TargetTimeBase = 0.0f;
-	#endif // DE_SERVER_COMPILE
 	m_GameTime = 0.0f;
 	m_nTrueFrameTimeMS = 0;
 	m_nTrueLastTimeMS = 0;
@@ -509,9 +512,15 @@ bool CServerMgr::Init()
 
 void CServerMgr::Term()
 {
+	// Get rid of the LoadTest clients while the net driver is still around.
+	m_LoadTest.Stop();
+
 	// Shutdown the world if it's running.
 	DoEndWorld(false);
 
+	m_FilePrefetcher.Term();
+	m_WorldFiles.clear();
+
 	//tell the server shell that the server is shutting down.
 	if (i_server_shell != NULL) 
 	{
@@ -534,6 +543,10 @@ void CServerMgr::Term()
 		sm_RemoveClient((Client*)pCur->m_pData);
 		pCur = pNext;
 	}
+
+	sm_TermClientUpdatePool();
+	sm_TermPhysicsMovePool();
+
 	dl_InitList(&m_Clients);
 
 	m_NetMgr.Term();
@@ -872,6 +885,9 @@ void sm_MergeClientChangeLists()
 		}
 	}
 
+	// The clients' unguaranteed schedules rank these objects again
+	sm_RecordUnguaranteedChanges();
+
 	sm_ClearChangedObjectList();
 	sm_ClearChangedSoundTrackList();
 }
@@ -955,6 +971,9 @@ void CServerMgr::PreUpdateObjects()
 		}
 	}
 
+	// Do the physics moves that were held until everyone had updated.
+	sm_ResolvePhysicsMoves();
+
 
 #ifdef _PROCESS_CLASS_TICKS_
 
@@ -979,13 +998,19 @@ void sm_FinishUpdateFrame()
 
 	// Remove the objects that got removed before updating in-world clients so they're not
 	// in the BSP and don't get sent to the clients.
-	while (g_pServerMgr->m_RemovedObjectHead.m_pNext != &g_pServerMgr->m_RemovedObjectHead)
 	{
-		sm_RemoveObjectsThatNeedToGetRemoved();
+		CTickPhaseTimer cTimer(&g_pServerMgr->m_TickStats, eTickPhase_Remove);
+		while (g_pServerMgr->m_RemovedObjectHead.m_pNext != &g_pServerMgr->m_RemovedObjectHead)
+		{
+			sm_RemoveObjectsThatNeedToGetRemoved();
+		}
 	}
 
 	// Update the in-world clients.
-	sm_UpdateClientsInWorld();
+	{
+		CTickPhaseTimer cTimer(&g_pServerMgr->m_TickStats, eTickPhase_ClientSend);
+		sm_UpdateClientsInWorld();
+	}
 }
 
 bool IsSoundTrackInRemoveList(CSoundTrack *pTest)
@@ -1066,10 +1091,6 @@ void CServerMgr::RemoveSounds()
 
 bool CServerMgr::Update(int32 updateFlags, uint32 nCurTimeMS)
 {
-	#ifdef DE_SERVER_COMPILE
-	static float s_serverSleepSecs = 0.0f;
-	#endif // DE_SERVER_COMPILE
-
 	int32 nOffsetTimeMS = (int32)nCurTimeMS + m_nTimeOffsetMS;
 
 	float curTime = nOffsetTimeMS / 1000.0f;
@@ -1081,6 +1102,9 @@ bool CServerMgr::Update(int32 updateFlags, uint32 nCurTimeMS)
 
 	m_NetMgr.Update("Server: ", curTime);
 
+	// Start a new frame for this thread's scratch memory
+	FrameArena_BeginFrame();
+
 	// Reset counters.
 	g_Ticks_MoveObject = 0;
 	g_nMoveObjectCalls = 0;
@@ -1101,41 +1125,48 @@ bool CServerMgr::Update(int32 updateFlags, uint32 nCurTimeMS)
 	//dl_TieOff(&m_RemovedObjectHead);
 
 #ifdef DE_SERVER_COMPILE
+	if (g_LockServerFPS)
+	{
+		// Keep handling packets while we wait for the next tick.
+		m_TickScheduler.SetRate(g_ServerFPS);
+
+		uint64 nNetInTime = 0, nSleepTime = 0;
+		for (;;)
+		{
+			uint64 nStartTime = time_GetNSTime();
+			LTRESULT dResult = ProcessIncomingPackets();
+			nNetInTime += time_GetNSTime() - nStartTime;
+			if (dResult != LT_OK)
+				return false;
 
-	while (s_serverSleepSecs >= 0.0f )
+			if (!m_TickScheduler.GetTimeToNextTick())
+				break;
+
+			nStartTime = time_GetNSTime();
+			m_TickScheduler.Wait(k_nNetPollIntervalNS);
+			nSleepTime += time_GetNSTime() - nStartTime;
+		}
+
+		m_TickStats.Add(eTickPhase_NetIn, nNetInTime);
+		m_TickStats.Add(eTickPhase_Sleep, nSleepTime);
+		m_TickStats.Add(eTickPhase_Late, m_TickScheduler.BeginTick());
+		m_TickStats.BeginTick();
+	}
+	else
+#endif // DE_SERVER_COMPILE
 	{
-		float timeStart = 0.0F;
-		if (g_LockServerFPS)
-			timeStart = time_GetTime();
+		m_TickStats.BeginTick();
 
+		CTickPhaseTimer cTimer(&m_TickStats, eTickPhase_NetIn);
 		if (ProcessIncomingPackets() != LT_OK)
 			return false;
-
-		if (g_LockServerFPS)
-		{
-			float timeElapsed = (time_GetTime() - timeStart);
-			if (timeElapsed == 0.0f)
-				timeElapsed = 0.001f; // artificially force it to always take "at least 1 ms"
-			s_serverSleepSecs -= timeElapsed;
-			if (s_serverSleepSecs > 0.0f)
-			{
-				dsi_ServerSleep(1);
-				timeElapsed = (time_GetTime() - timeStart);
-				if (timeElapsed == 0.0f)
-					timeElapsed = 0.001f; // always "at least 1 ms"
-				s_serverSleepSecs -= timeElapsed;
-			}
-		}
-		else
-			break;
 	}
-	s_serverSleepSecs = 0.0f; // reset
-#else
-	
-	if (ProcessIncomingPackets() != LT_OK)
-		return false;
 
-#endif // if DE_SERVER_COMPILE
+	if (m_LoadTest.IsRunning())
+	{
+		CTickPhaseTimer cTimer(&m_TickStats, eTickPhase_LoadTest);
+		m_LoadTest.Update(curTime);
+	}
 
 	if (m_State == SERV_RUNNINGWORLD)
 	{
@@ -1152,25 +1183,12 @@ bool CServerMgr::Update(int32 updateFlags, uint32 nCurTimeMS)
             // Update the server shell.
             if (i_server_shell != NULL) 
 			{
+				CTickPhaseTimer cTimer(&m_TickStats, eTickPhase_ShellUpdate);
                 i_server_shell->Update( 0.0f );
             }
-
-	 		#ifdef DE_SERVER_COMPILE
-			if (g_LockServerFPS)
-				dsi_ServerSleep((uint32)((1000 >> 1) / g_ServerFPS)); // half a cycle
-  			#endif // DE_SERVER_COMPILE
 		}
 		else
 		{
-			// Do game time steps.
-			if (g_ServerFPS != m_LastServerFPS)
-			{
-				#ifdef DE_SERVER_COMPILE
-				m_TargetTimeBase = curTime; 
-				m_nTargetTimeSteps = 0;
-				#endif // DE_SERVER_COMPILE
-			}
-	
 			m_FrameTime = ((LTCLAMP(m_nTrueFrameTimeMS / 1000.0f, 0.0f, 0.2f)) * g_ServerTimeScale);
 			m_GameTime += m_FrameTime;
 
@@ -1182,33 +1200,17 @@ bool CServerMgr::Update(int32 updateFlags, uint32 nCurTimeMS)
 
 			// Update the server shell.
 			if (i_server_shell != NULL) {
+				CTickPhaseTimer cTimer(&m_TickStats, eTickPhase_ShellUpdate);
 				i_server_shell->Update(m_FrameTime);
 			}
 
 			// Update the objects.
-			PreUpdateObjects();
-
-			m_nTrueFrameTimeMS = 0; // Reset 
-
-  			#ifdef DE_SERVER_COMPILE
-			if (g_LockServerFPS)
 			{
-				float targetTime = m_TargetTimeBase + (float)m_nTargetTimeSteps / g_ServerFPS;
-				float timeDiff = (targetTime - curTime);
-				if (timeDiff > 0.0f)
-				{
-					if (timeDiff > (1.0f / (3.0f * g_ServerFPS))) // we're ahead of where we need to be and need to wait...
-					{
- 
-						//DebugOut("diff=%.3f, targBase=%3.f, curTime=%.3f, targ=%.3f, catchup=%d\n", timeDiff, m_TargetTimeBase, curTime, targetTime, (int)m_CatchupSteps);
-						s_serverSleepSecs = timeDiff;
-
-					}
-				}
+				CTickPhaseTimer cTimer(&m_TickStats, eTickPhase_PreUpdateObjects);
+				PreUpdateObjects();
 			}
-			m_nTargetTimeSteps += 1;
-  			#endif // DE_SERVER_COMPILE
 
+			m_nTrueFrameTimeMS = 0; // Reset 
 		}
 
 		// Finish the frame.
@@ -1218,13 +1220,6 @@ bool CServerMgr::Update(int32 updateFlags, uint32 nCurTimeMS)
 		// to end a looping sound before it removes it from the client.
 		RemoveSounds();
 	}
-	else
-	{
-  		#ifdef DE_SERVER_COMPILE
-		if (g_LockServerFPS)
-			dsi_ServerSleep((uint32)((1000 >> 1) / g_ServerFPS)); // have a cycle
-  		#endif // DE_SERVER_COMPILE
-	}
 
 	if (g_CV_ShowGameTime)
 	{
@@ -1508,7 +1503,9 @@ LTRESULT CServerMgr::LoadModel(const char* pFilename,
 
 		ModelLoadRequest request;
 
-		request.m_pFile = server_filemgr->OpenFile3(pUsedFile);
+		request.m_pFile = TakePrefetchedFile(server_filemgr->GetUsedFilename(pUsedFile));
+		if (!request.m_pFile)
+			request.m_pFile = server_filemgr->OpenFile3(pUsedFile);
 		if (!request.m_pFile)
 		{
 			DEBUG_PRINT(1, ("Couldn't open model file %s", pFilename));
@@ -1756,6 +1753,8 @@ LTRESULT sm_CreateServerData(ObjectCreateStruct *pStruct,
 	pRet->m_ChangeFlags = 0;
 	dl_TieOff(&pRet->m_ChangedNode);
 	pRet->m_NetFlags = 0;
+	pRet->m_nInterestCell = CInterestGrid::k_nNoCell;
+	pRet->m_nInterestIndex = 0;
 
 	// Add its name to the hash table.
 	if (pStruct->m_Name[0] == 0)
@@ -1812,6 +1811,9 @@ LTRESULT sm_DestroyServerData(LTObject *pObject)
 	BreakInterLinks(pObject, LINKTYPE_CONTAINER, false);
 	BreakInterLinks(pObject, LINKTYPE_SOUND, false);
 
+	// Take it out of the interest grid.
+	g_pServerMgr->m_InterestGrid.RemoveObject(pObject);
+
 	dl_RemoveAt(&g_pServerMgr->m_Objects, &pObject->sd->m_ListNode);
 	g_pServerMgr->m_SObjBank.Free(pObject->sd);
 	return LT_OK;
@@ -1842,6 +1844,7 @@ LTRESULT sm_StartCachingFiles()
 LTRESULT sm_EndCachingFiles()
 {
 	i_server_shell->CacheFiles();
+	g_pServerMgr->CacheQueuedFiles();
 	g_pServerMgr->m_InternalFlags &= ~SFLAG_BUILDINGCACHELIST;
 
 	sm_RemoveAllUnusedSoundData();
@@ -1991,7 +1994,9 @@ CSoundData *CServerMgr::GetSoundData(UsedFile *pFile)
 	const char *pszFileName = server_filemgr->GetUsedFilename(pFile);
 
 	// Read in the file data...
-	ILTStream *pStream = server_filemgr->OpenFile(pszFileName);
+	ILTStream *pStream = TakePrefetchedFile(pszFileName);
+	if (!pStream)
+		pStream = server_filemgr->OpenFile(pszFileName);
 	if (!pStream)
 		return LTNULL;
 
@@ -2012,6 +2017,129 @@ CSoundData *CServerMgr::GetSoundData(UsedFile *pFile)
 	return pSoundData;
 }
 
+//------------------------------------------------------------------------------------
+// CServerMgr::StartWorldPrefetch
+//
+// The models and sounds a world reads while it's loading get recorded, and the
+// next time the world is loaded they're read ahead of time on the prefetch
+// threads so the loading code finds them in memory.  The models and sounds the
+// game caches while the world loads are read ahead too, so the first load gets
+// some of the benefit (see QueueCacheFile).
+//
+//------------------------------------------------------------------------------------
+void CServerMgr::StartWorldPrefetch(const char *pWorldName)
+{
+	EndWorldPrefetch();
+
+	uint32 nNumThreads;
+#ifdef LTMEMTRACK
+	// The memory tracking isn't thread safe
+	nNumThreads = 0;
+#else
+	nNumThreads = (g_CV_PrefetchThreads > 0) ? (uint32)g_CV_PrefetchThreads : 0;
+#endif
+
+	if (m_FilePrefetcher.GetNumThreads() != nNumThreads)
+		m_FilePrefetcher.Init(nNumThreads);
+
+	m_FilePrefetcher.ClearStats();
+
+	char worldKey[_MAX_PATH + 1];
+	LTStrCpy(worldKey, pWorldName, sizeof(worldKey));
+	strupr(worldKey);
+
+	std::vector<std::string> &aFiles = m_WorldFiles[worldKey];
+
+	// The file manager isn't thread safe, so find out which tree each file is
+	// in here and let the threads do the rest
+	for (uint32 nCurFile = 0; nCurFile < aFiles.size(); ++nCurFile)
+	{
+		char formattedFilename[_MAX_PATH + 1];
+		CHelpers::FormatFilename(aFiles[nCurFile].c_str(), formattedFilename, sizeof(formattedFilename));
+
+		HLTFileTree *hTree;
+		if (server_filemgr->DoesFileExist(formattedFilename, &hTree, LTNULL))
+		{
+			m_FilePrefetcher.Add(hTree, formattedFilename);
+		}
+	}
+
+	// Record this load from scratch
+	aFiles.clear();
+	m_pLoadingWorldFiles = &aFiles;
+}
+
+void CServerMgr::EndWorldPrefetch()
+{
+	if (!m_pLoadingWorldFiles)
+		return;
+
+	// DoRunWorld caches these, so the world never got to run
+	m_aQueuedCacheFiles.clear();
+
+	m_pLoadingWorldFiles = LTNULL;
+
+	m_FilePrefetcher.Flush();
+
+	const CFilePrefetcher::SStats &cStats = m_FilePrefetcher.GetStats();
+	if (cStats.m_nAdded)
+	{
+		dsi_ConsolePrint("Prefetched %d of %d files (%dk), waited on %d for %.2f seconds, %d unused, %d failed", 
+			cStats.m_nReady + cStats.m_nWaited, cStats.m_nAdded, cStats.m_nBytesUsed / 1024,
+			cStats.m_nWaited, cStats.m_fWaitTime, cStats.m_nUnused, cStats.m_nFailed);
+	}
+}
+
+bool CServerMgr::QueueCacheFile(uint32 nFileType, const char *pFilename)
+{
+	if (!m_pLoadingWorldFiles || m_bCachingQueuedFiles || !m_FilePrefetcher.GetNumThreads())
+		return false;
+
+	// Textures and sprites only go to the clients
+	if ((nFileType != FT_MODEL) && (nFileType != FT_SOUND))
+		return false;
+
+	if ((nFileType == FT_MODEL) && IsModelCached(pFilename))
+		return false;
+
+	// Let the normal path report missing files
+	HLTFileTree *hTree;
+	if (!server_filemgr->DoesFileExist(pFilename, &hTree, LTNULL))
+		return false;
+
+	m_FilePrefetcher.Add(hTree, pFilename);
+
+	SQueuedCacheFile cQueued;
+	cQueued.m_nFileType = nFileType;
+	cQueued.m_sFilename = pFilename;
+	LT_MEM_TRACK_ALLOC(m_aQueuedCacheFiles.push_back(cQueued), LT_MEM_TYPE_MISC);
+
+	return true;
+}
+
+void CServerMgr::CacheQueuedFiles()
+{
+	// In the order they were asked for, which is the order they're read in
+	m_bCachingQueuedFiles = true;
+	for (uint32 nCurFile = 0; nCurFile < m_aQueuedCacheFiles.size(); ++nCurFile)
+	{
+		sm_CacheFile(m_aQueuedCacheFiles[nCurFile].m_nFileType, m_aQueuedCacheFiles[nCurFile].m_sFilename.c_str());
+	}
+	m_bCachingQueuedFiles = false;
+
+	m_aQueuedCacheFiles.clear();
+}
+
+ILTStream *CServerMgr::TakePrefetchedFile(const char *pFilename)
+{
+	if (!m_pLoadingWorldFiles)
+		return LTNULL;
+
+	m_pLoadingWorldFiles->push_back(pFilename);
+
+	return m_FilePrefetcher.Take(pFilename);
+}
+
 // ------------------------------------------------------------------------------------ //
 // C-style server functions.
 // ------------------------------------------------------------------------------------ //
@@ -2247,6 +2375,12 @@ LTRESULT sm_CacheFile(uint32 fileType, const char *pFilename)
 	char pszFinalFilename[_MAX_PATH + 1];
 	CHelpers::FormatFilename(pFilename, pszFinalFilename, _MAX_PATH + 1);
 
+	// Read it ahead of time if the world's loading
+	if (g_pServerMgr->QueueCacheFile(fileType, pszFinalFilename))
+	{
+		return LT_OK;
+	}
+
 	switch(fileType)
 	{
 		case FT_MODEL:
@@ -2569,6 +2703,9 @@ LTRESULT CServerMgr::DoStartWorld(const char *pWorldName, uint32 flags, uint32 n
 		DoEndWorld(bSameWorld);
 	}
 
+	// Get the files the world read last time coming in while it loads
+	StartWorldPrefetch(pWorldName);
+
 	// Reset sky.
 	memset(m_SkyObjects, 0xFF, sizeof(m_SkyObjects));
 
@@ -2581,6 +2718,9 @@ LTRESULT CServerMgr::DoStartWorld(const char *pWorldName, uint32 flags, uint32 n
 	// Reset the changed object list
 	m_ChangedSoundTrackHead = LTNULL;
 
+	// Start the interest grid over with the current cell size.
+	m_InterestGrid.Init(g_CV_InterestCellSize);
+
 	// Tie this off in case they try to remove some objects.
 	ASSERT(m_RemovedObjectHead.m_pNext == &m_RemovedObjectHead);
 	dl_TieOff(&m_RemovedObjectHead);
@@ -2701,7 +2841,9 @@ LTRESULT CServerMgr::DoRunWorld()
 	sm_EndCachingFiles();
 
 	m_State = SERV_RUNNINGWORLD;
-	m_LastServerFPS = -1.0; // force first-time initialization in Update
+#ifdef DE_SERVER_COMPILE
+	m_TickScheduler.Reset(); // the first tick is due right away
+#endif // DE_SERVER_COMPILE
 
 	// Call PostStartWorld if necessary.
 	i_server_shell->PostStartWorld();
@@ -2720,6 +2862,9 @@ LTRESULT CServerMgr::DoRunWorld()
 	// Finish the update frame.
 	sm_FinishUpdateFrame();
 
+	// Everything the world needed to start should have been read by now
+	EndWorldPrefetch();
+
 	//inform the user how much time it took to run the world
 	clock_t EndTime = clock();
 
@@ -2773,6 +2918,9 @@ void CServerMgr::DoEndWorld(bool bKeepGeometryAround)
 
 	UncacheModels();
 
+	// In case the world never got to run
+	EndWorldPrefetch();
+
 	m_State = SERV_NOSTATE;
 
 	dsi_ConsolePrint("World ended");
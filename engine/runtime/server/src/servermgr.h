@@ -14,6 +14,8 @@
 #ifndef __SERVERMGR_H__
 #define __SERVERMGR_H__
 
+#include <map>
+#include <string>
 #include <vector>
 
 class CServerMgr;
@@ -31,6 +33,22 @@ class ServerAppHandler;
 
 #include "ltobjref.h"
 
+#ifndef __S_INTEREST_H__
+#include "s_interest.h"
+#endif
+
+#ifndef __S_TICK_H__
+#include "s_tick.h"
+#endif
+
+#ifndef __S_LOADTEST_H__
+#include "s_loadtest.h"
+#endif
+
+#ifndef __FILEPREFETCH_H__
+#include "fileprefetch.h"
+#endif
+
 //----------------------------------------------------------------------------
 //Below here are headers that probably wont be needed after certain things 
 //are removed from the client mgr.
@@ -222,6 +240,43 @@ class CServerMgr : public CNetHandler
 		CSoundData *	GetSoundData(UsedFile *pFile);
 		CSoundData *	FindSoundData(UsedFile *pFile);
 
+		// While a world is loading, sm_CacheFile puts the models and sounds it's asked 
+		// for on the prefetch threads and loads them all at once later, so the first 
+		// load of a world gets prefetched too.  Returns false if the file should be 
+		// cached right away.
+		bool			QueueCacheFile(uint32 nFileType, const char *pFilename);
+		// Cache the queued files.  Called once the server shell's done caching.
+		void			CacheQueuedFiles();
+
+	private:
+
+		// Start recording the files read while a world loads, and get the files
+		// it read the last time it was loaded going on the prefetch threads.
+		void			StartWorldPrefetch(const char *pWorldName);
+		// Stop recording and throw out whatever wasn't used.
+		void			EndWorldPrefetch();
+		// Get a file that was prefetched for the world being loaded, or LTNULL
+		// if it has to be opened the normal way.  Also records the file.
+		ILTStream *		TakePrefetchedFile(const char *pFilename);
+
+		// The files each world read while it was loading, by upper case world name
+		typedef std::map<std::string, std::vector<std::string> > TWorldFileMap;
+		TWorldFileMap	m_WorldFiles;
+		// The list being recorded for the world that's loading (LTNULL if not loading)
+		std::vector<std::string> *m_pLoadingWorldFiles;
+
+		CFilePrefetcher	m_FilePrefetcher;
+
+		// Files waiting for CacheQueuedFiles
+		struct SQueuedCacheFile
+		{
+			uint32		m_nFileType;
+			std::string	m_sFilename;
+		};
+		std::vector<SQueuedCacheFile> m_aQueuedCacheFiles;
+		// Set while CacheQueuedFiles is caching them
+		bool			m_bCachingQueuedFiles;
+
 	public:
 
 		// Sound stuff...
@@ -253,6 +308,9 @@ class CServerMgr : public CNetHandler
 		// necessarily always in the world tree).
 		ObjectMgr 		m_ObjectMgr;
 
+		// The objects sorted by position, so the client updates only look at what's nearby.
+		CInterestGrid	m_InterestGrid;
+
 		
 		// The world and info about it.
 		bool 			m_bWorldLoaded;
@@ -272,7 +330,6 @@ class CServerMgr : public CNetHandler
 				
 		// Used in all the equations..
 		float 			m_FrameTime;
-		float 			m_LastServerFPS; // Used to detect changes in server FPS and adjust accordingly.
 
 		// Used to keep the timer as it was when a game was saved.
 		int32 			m_nTimeOffsetMS;
@@ -289,10 +346,15 @@ class CServerMgr : public CNetHandler
 		#ifdef DE_SERVER_COMPILE		
 		// Used to lock a stand-alone server to g_ServerFPS (allowing it
 		// to sleep when it gets ahead).
-		float			m_TargetTimeBase;
-		uint32			m_nTargetTimeSteps;
+		CTickScheduler	m_TickScheduler;
 		#endif // DE_SERVER_COMPILE
 
+		// How long each part of the update takes.
+		CTickStats		m_TickStats;
+
+		// Synthetic clients for the LoadTest command.
+		CLoadTest		m_LoadTest;
+
 	//////// Net stuff ///////////////////////////////////////////
 	public:
 
@@ -86,6 +86,9 @@ public:
 
 	uint16			m_ChangeFlags;		// Stored during updates.
 	uint16			m_NetFlags;			// Net flags (combination of NETFLAG_ defines).
+
+	uint32			m_nInterestCell;	// Cell in the interest grid (CInterestGrid::k_nNoCell if it's not in there).
+	uint32			m_nInterestIndex;	// Index in the cell's object list.
 };
 
 
@@ -152,10 +152,15 @@ char* SMoveAbstract::GetObjectClassName(LTObject *pObject)
     return pObject->sd->m_pClass->m_ClassName;
 }
 
-void FullMoveObject(LTObject *pObj, const LTVector *pP1, const uint32 flags) {
+void FullMoveObject(LTObject *pObj, const LTVector *pP1, const uint32 flags, const CPlayerMoveRecord *pPlayerSolve) {
     MoveState moveState;
 
+    // Any physics move queued before the teleport was worked out from the old spot
+    if (flags & MO_TELEPORT)
+        sm_DropPhysicsMoves(pObj);
+
     moveState.Setup(world_bsp_server->ServerTree(), g_pServerMgr->m_MoveAbstract, pObj, pObj->m_BPriority);
+    moveState.m_pPlayerSolve = pPlayerSolve;
 
     MoveObject(&moveState, *pP1, flags);
 }
@@ -163,4 +168,9 @@ void FullMoveObject(LTObject *pObj, const LTVector *pP1, const uint32 flags) {
 ILTPhysics *SMoveAbstract::GetPhysics() { 
     return ilt_server->Physics(); 
 }
+
+void SMoveAbstract::OnObjectMoved(LTObject *pObj)
+{
+    g_pServerMgr->m_InterestGrid.UpdateObject(pObj);
+}
 //EOF
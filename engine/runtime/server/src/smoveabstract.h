@@ -33,14 +33,19 @@ public:
 	LTBOOL			CanOptimizeObject(LTObject *pObj);
 	char*			GetObjectClassName(LTObject *pObject);
 	ILTPhysics *	GetPhysics();
+	void			OnObjectMoved(LTObject *pObj);
 };
 
 
+class CPlayerMoveRecord;
+
+//pPlayerSolve is a move worked out ahead of time with CPlayerMover::SolveAhead
 void FullMoveObject
 (
 	LTObject*		pObj,
 	const LTVector*	pP1,
-	const uint32	flags
+	const uint32	flags,
+	const CPlayerMoveRecord* pPlayerSolve = LTNULL
 );
 
 #endif
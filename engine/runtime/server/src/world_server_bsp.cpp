@@ -31,6 +31,8 @@ define_holder(ICompress, compress);
 static ILTCollisionMgr* server_collision_mgr;
 define_holder_to_instance(ILTCollisionMgr, server_collision_mgr, Server);
 
+extern int32 g_CV_WorldTreeBVH;
+
 //temporary
 bool i_IntersectSweptSphere(const LTVector& vStart, const LTVector& vEnd, float fRadius, LTVector& vPos, LTVector& vNormal, WorldTree *pWorldTree);
 
@@ -197,6 +199,10 @@ ELoadWorldStatus CWorldServerBSP::Load(ILTStream *pStream)
         return status;
     }
 
+    //nothing on the server walks the tree nodes directly, so the objects
+    //can go in the BVH instead.
+    world_tree.SetUseBVH(g_CV_WorldTreeBVH != 0);
+
     //we are loaded.
     loaded = true;
 
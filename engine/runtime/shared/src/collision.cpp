@@ -2209,7 +2209,7 @@ static void DoPointCollision
 		bContinue = false;
 
 		// Do a fast test to see if we hit anything.
-		pNode = IntersectLine(	request.m_pWorld->GetRootNode(), 
+		pNode = IntersectLine(	request.m_pWorld, 
 								&request.m_OriginalPos,
 								&pInfo->m_FinalPos,
 								&iPos,
@@ -0,0 +1,642 @@
+#ifndef __DYNAMICAABBTREE_H__
+#define __DYNAMICAABBTREE_H__
+
+/*
+CDynamicAABBTree is a binary tree of boxes with one item per leaf, for things
+that move around.  WorldTreeBVH keeps world objects in one, and LTBroadphase
+keeps collision objects in one.
+
+Each leaf's box is the item's box grown by a margin (the "fat" box), so an item
+that moves a little stays inside it and the tree doesn't change at all.  When
+an item moves out of its leaf's box, the leaf is pulled out and put back in
+where it makes the smallest tree, and the boxes above it are refit.  Rotations
+keep the tree balanced.
+
+A leaf's node index is the item's handle.  It stays the same until the item is
+removed, even when the item moves.
+
+The owner walks the tree itself with GetRoot() and GetNode(), so each one can
+filter the way it needs to.  If whatever's called during a walk can change the
+tree, hold a CQueryLock for the walk.  While one is held, Insert, Move and
+Remove are only written down, and they're made in order when the last lock
+goes away.  A leaf that moves more than once just gets its last box.  Until then the walk sees the tree the way it was, except that
+removed leaves have a LTNULL item.
+
+TVector needs x, y and z, a (x, y, z) constructor, + and -, and * by a float.
+*/
+
+#include "ltbasedefs.h"
+
+#include <vector>
+
+
+#define AABBTREE_NULL_NODE		0xFFFFFFFF
+
+
+template <class TVector, class T>
+class CDynamicAABBTree
+{
+public:
+
+	struct SNode
+	{
+		bool		IsLeaf() const	{ return m_iChildren[0] == AABBTREE_NULL_NODE; }
+
+		// For leaves, the item's box plus the margin.
+		TVector		m_vMin;
+		TVector		m_vMax;
+
+		// The next free node when the node isn't used.
+		uint32		m_iParent;
+		uint32		m_iChildren[2];
+
+		// 0 for leaves, -1 for free nodes.
+		int32		m_nHeight;
+
+		// The item in a leaf, or LTNULL if it was removed during a query.
+		T			*m_pItem;
+	};
+
+	// Puts off changes to the tree until it goes away.  These can nest.
+	class CQueryLock
+	{
+	public:
+		CQueryLock(CDynamicAABBTree *pTree) : m_pTree(pTree)	{ m_pTree->BeginQuery(); }
+		~CQueryLock()											{ m_pTree->EndQuery(); }
+	private:
+		CDynamicAABBTree *m_pTree;
+	};
+
+	// A leaf's box is fFatMargin bigger than its item's box on each side, plus
+	// fFatScale times the item's size.  If it gets fShrinkMargins margins
+	// bigger than it needs to be on any side, it's shrunk back down.
+	CDynamicAABBTree(float fFatMargin, float fFatScale = 0.125f, float fShrinkMargins = 4.0f) :
+		m_fFatMargin(fFatMargin),
+		m_fFatScale(fFatScale),
+		m_fShrinkMargins(fShrinkMargins),
+		m_iRoot(AABBTREE_NULL_NODE),
+		m_iFreeList(AABBTREE_NULL_NODE),
+		m_nNumFreeNodes(0),
+		m_nNumItems(0),
+		m_nQueryDepth(0)
+	{
+	}
+
+	// Takes everything out.  The items aren't told.
+	void			Clear();
+
+	// Adds an item with the specified box and returns its leaf.
+	uint32			Insert(T *pItem, const TVector& vMin, const TVector& vMax);
+
+	// Updates the box of a leaf's item.  Returns true if the leaf had to move.
+	bool			Move(uint32 iLeaf, const TVector& vMin, const TVector& vMax);
+
+	void			Remove(uint32 iLeaf);
+
+	void			BeginQuery()	{ ++m_nQueryDepth; }
+	void			EndQuery();
+
+	T*				GetItem(uint32 iLeaf) const		{ return m_aNodes[iLeaf].m_pItem; }
+	const SNode&	GetNode(uint32 iNode) const		{ return m_aNodes[iNode]; }
+	uint32			GetRoot() const					{ return m_iRoot; }
+
+	// Node indices go up to this, free ones included.
+	uint32			GetNodeArraySize() const		{ return (uint32)m_aNodes.size(); }
+
+	uint32			GetNumItems() const				{ return m_nNumItems; }
+	uint32			GetNumNodes() const				{ return (uint32)m_aNodes.size() - m_nNumFreeNodes; }
+
+	// Number of levels below the root (0 for a single leaf or an empty tree).
+	uint32			GetHeight() const;
+
+private:
+
+	// A change made while a query lock was held
+	enum EPendingOp
+	{
+		PendingOp_Insert,
+		PendingOp_Move,
+		PendingOp_Remove
+	};
+
+	struct SPendingOp
+	{
+		EPendingOp	m_eOp;
+		uint32		m_iLeaf;
+		// The item's new box for moves
+		TVector		m_vMin;
+		TVector		m_vMax;
+	};
+
+	static bool		IsBoxInsideBox(	const TVector& vInnerMin, const TVector& vInnerMax,
+									const TVector& vOuterMin, const TVector& vOuterMax);
+	static void		MergeBoxes(	const TVector& vMin1, const TVector& vMax1,
+								const TVector& vMin2, const TVector& vMax2,
+								TVector &vMin, TVector &vMax);
+	// Half the surface area of the box, which is what the insertion cost is based on.
+	static float	GetBoxCost(const TVector& vMin, const TVector& vMax);
+
+	// The margin added to each side of an item's box for its leaf.
+	TVector			GetFatMargin(const TVector& vMin, const TVector& vMax) const;
+	void			SetLeafBox(uint32 iLeaf, const TVector& vMin, const TVector& vMax);
+
+	uint32			AllocNode();
+	void			FreeNode(uint32 iNode);
+
+	void			InsertLeaf(uint32 iLeaf);
+	void			RemoveLeaf(uint32 iLeaf);
+
+	// Refits the boxes and heights from iNode to the root, balancing as it goes.
+	void			RefitUp(uint32 iNode);
+
+	// Does a rotation at iNode if its children's heights are too far apart.
+	// Returns the node that's now where iNode was.
+	uint32			Balance(uint32 iNode);
+
+	void			AddPendingOp(EPendingOp eOp, uint32 iLeaf, const TVector& vMin, const TVector& vMax);
+	// The leaf's move that's waiting for the query to end, or LTNULL.
+	SPendingOp		*FindPendingMove(uint32 iLeaf);
+
+	float			m_fFatMargin;
+	float			m_fFatScale;
+	float			m_fShrinkMargins;
+
+	std::vector<SNode>	m_aNodes;
+
+	uint32			m_iRoot;
+	uint32			m_iFreeList;
+	uint32			m_nNumFreeNodes;
+	uint32			m_nNumItems;
+
+	// How many query locks are held.
+	uint32			m_nQueryDepth;
+
+	// Changes made while a query lock was held, in the order they were made.
+	std::vector<SPendingOp>	m_aPendingOps;
+};
+
+
+// -------------------------------------------------------------------------------- //
+// CDynamicAABBTree implementation.
+// -------------------------------------------------------------------------------- //
+
+template <class TVector, class T>
+void CDynamicAABBTree<TVector, T>::Clear()
+{
+	ASSERT(m_nQueryDepth == 0);
+
+	m_aNodes.clear();
+	m_aPendingOps.clear();
+
+	m_iRoot = AABBTREE_NULL_NODE;
+	m_iFreeList = AABBTREE_NULL_NODE;
+	m_nNumFreeNodes = 0;
+	m_nNumItems = 0;
+}
+
+template <class TVector, class T>
+uint32 CDynamicAABBTree<TVector, T>::Insert(T *pItem, const TVector& vMin, const TVector& vMax)
+{
+	uint32 iLeaf = AllocNode();
+	SetLeafBox(iLeaf, vMin, vMax);
+	m_aNodes[iLeaf].m_pItem = pItem;
+	m_nNumItems++;
+
+	// A walk might be going, so don't link it in until it's done.
+	if(m_nQueryDepth)
+	{
+		AddPendingOp(PendingOp_Insert, iLeaf, vMin, vMax);
+	}
+	else
+	{
+		InsertLeaf(iLeaf);
+	}
+
+	return iLeaf;
+}
+
+template <class TVector, class T>
+bool CDynamicAABBTree<TVector, T>::Move(uint32 iLeaf, const TVector& vMin, const TVector& vMax)
+{
+	const SNode &cLeaf = m_aNodes[iLeaf];
+	ASSERT(cLeaf.IsLeaf() && (cLeaf.m_nHeight == 0) && cLeaf.m_pItem);
+
+	// If it already moved during this query, the leaf's box is out of date, so
+	// just move it to the new box instead.
+	if(m_nQueryDepth)
+	{
+		SPendingOp *pPendingMove = FindPendingMove(iLeaf);
+		if(pPendingMove)
+		{
+			pPendingMove->m_vMin = vMin;
+			pPendingMove->m_vMax = vMax;
+			return true;
+		}
+	}
+
+	// If it's still inside its leaf, and the leaf isn't way too big for it, leave it alone.
+	if(IsBoxInsideBox(vMin, vMax, cLeaf.m_vMin, cLeaf.m_vMax))
+	{
+		TVector vMaxGap = GetFatMargin(vMin, vMax) * m_fShrinkMargins;
+		if(IsBoxInsideBox(cLeaf.m_vMin, cLeaf.m_vMax, vMin - vMaxGap, vMax + vMaxGap))
+			return false;
+	}
+
+	if(m_nQueryDepth)
+	{
+		AddPendingOp(PendingOp_Move, iLeaf, vMin, vMax);
+		return true;
+	}
+
+	// Pull the leaf out and put it back in, so its index stays the same.
+	RemoveLeaf(iLeaf);
+	SetLeafBox(iLeaf, vMin, vMax);
+	InsertLeaf(iLeaf);
+	return true;
+}
+
+template <class TVector, class T>
+void CDynamicAABBTree<TVector, T>::Remove(uint32 iLeaf)
+{
+	SNode &cLeaf = m_aNodes[iLeaf];
+	ASSERT(cLeaf.IsLeaf() && (cLeaf.m_nHeight == 0) && cLeaf.m_pItem);
+
+	cLeaf.m_pItem = LTNULL;
+	m_nNumItems--;
+
+	// A walk might be in the middle of this part of the tree, so leave the
+	// leaf there until it's done.
+	if(m_nQueryDepth)
+	{
+		AddPendingOp(PendingOp_Remove, iLeaf, cLeaf.m_vMin, cLeaf.m_vMax);
+		return;
+	}
+
+	RemoveLeaf(iLeaf);
+	FreeNode(iLeaf);
+}
+
+template <class TVector, class T>
+void CDynamicAABBTree<TVector, T>::EndQuery()
+{
+	ASSERT(m_nQueryDepth > 0);
+	m_nQueryDepth--;
+
+	if(m_nQueryDepth || m_aPendingOps.empty())
+		return;
+
+	// Do them in order, so a leaf that was added and then moved or removed
+	// is linked in before it's taken out again.
+	for(uint32 iCur=0; iCur < m_aPendingOps.size(); iCur++)
+	{
+		const SPendingOp &cOp = m_aPendingOps[iCur];
+		switch(cOp.m_eOp)
+		{
+			case PendingOp_Insert:
+				InsertLeaf(cOp.m_iLeaf);
+				break;
+
+			case PendingOp_Move:
+				RemoveLeaf(cOp.m_iLeaf);
+				SetLeafBox(cOp.m_iLeaf, cOp.m_vMin, cOp.m_vMax);
+				InsertLeaf(cOp.m_iLeaf);
+				break;
+
+			case PendingOp_Remove:
+				RemoveLeaf(cOp.m_iLeaf);
+				FreeNode(cOp.m_iLeaf);
+				break;
+		}
+	}
+	m_aPendingOps.clear();
+}
+
+template <class TVector, class T>
+uint32 CDynamicAABBTree<TVector, T>::GetHeight() const
+{
+	if(m_iRoot == AABBTREE_NULL_NODE)
+		return 0;
+
+	return (uint32)m_aNodes[m_iRoot].m_nHeight;
+}
+
+template <class TVector, class T>
+bool CDynamicAABBTree<TVector, T>::IsBoxInsideBox(	const TVector& vInnerMin, const TVector& vInnerMax,
+													const TVector& vOuterMin, const TVector& vOuterMax)
+{
+	return vInnerMin.x >= vOuterMin.x && vInnerMin.y >= vOuterMin.y && vInnerMin.z >= vOuterMin.z &&
+		vInnerMax.x <= vOuterMax.x && vInnerMax.y <= vOuterMax.y && vInnerMax.z <= vOuterMax.z;
+}
+
+template <class TVector, class T>
+void CDynamicAABBTree<TVector, T>::MergeBoxes(	const TVector& vMin1, const TVector& vMax1,
+												const TVector& vMin2, const TVector& vMax2,
+												TVector &vMin, TVector &vMax)
+{
+	vMin = TVector(LTMIN(vMin1.x, vMin2.x), LTMIN(vMin1.y, vMin2.y), LTMIN(vMin1.z, vMin2.z));
+	vMax = TVector(LTMAX(vMax1.x, vMax2.x), LTMAX(vMax1.y, vMax2.y), LTMAX(vMax1.z, vMax2.z));
+}
+
+template <class TVector, class T>
+float CDynamicAABBTree<TVector, T>::GetBoxCost(const TVector& vMin, const TVector& vMax)
+{
+	TVector vSize = vMax - vMin;
+	return vSize.x * vSize.y + vSize.y * vSize.z + vSize.z * vSize.x;
+}
+
+template <class TVector, class T>
+TVector CDynamicAABBTree<TVector, T>::GetFatMargin(const TVector& vMin, const TVector& vMax) const
+{
+	return (vMax - vMin) * m_fFatScale + TVector(m_fFatMargin, m_fFatMargin, m_fFatMargin);
+}
+
+template <class TVector, class T>
+void CDynamicAABBTree<TVector, T>::SetLeafBox(uint32 iLeaf, const TVector& vMin, const TVector& vMax)
+{
+	SNode &cLeaf = m_aNodes[iLeaf];
+
+	TVector vMargin = GetFatMargin(vMin, vMax);
+	cLeaf.m_vMin = vMin - vMargin;
+	cLeaf.m_vMax = vMax + vMargin;
+}
+
+template <class TVector, class T>
+uint32 CDynamicAABBTree<TVector, T>::AllocNode()
+{
+	uint32 iNode;
+
+	if(m_iFreeList == AABBTREE_NULL_NODE)
+	{
+		iNode = (uint32)m_aNodes.size();
+		m_aNodes.push_back(SNode());
+	}
+	else
+	{
+		iNode = m_iFreeList;
+		m_iFreeList = m_aNodes[iNode].m_iParent;
+		m_nNumFreeNodes--;
+	}
+
+	SNode &cNode = m_aNodes[iNode];
+	cNode.m_vMin = TVector(0.0f, 0.0f, 0.0f);
+	cNode.m_vMax = TVector(0.0f, 0.0f, 0.0f);
+	cNode.m_iParent = AABBTREE_NULL_NODE;
+	cNode.m_iChildren[0] = AABBTREE_NULL_NODE;
+	cNode.m_iChildren[1] = AABBTREE_NULL_NODE;
+	cNode.m_nHeight = 0;
+	cNode.m_pItem = LTNULL;
+
+	return iNode;
+}
+
+template <class TVector, class T>
+void CDynamicAABBTree<TVector, T>::FreeNode(uint32 iNode)
+{
+	SNode &cNode = m_aNodes[iNode];
+	cNode.m_nHeight = -1;
+	cNode.m_pItem = LTNULL;
+	cNode.m_iParent = m_iFreeList;
+
+	m_iFreeList = iNode;
+	m_nNumFreeNodes++;
+}
+
+template <class TVector, class T>
+void CDynamicAABBTree<TVector, T>::InsertLeaf(uint32 iLeaf)
+{
+	if(m_iRoot == AABBTREE_NULL_NODE)
+	{
+		m_iRoot = iLeaf;
+		m_aNodes[iLeaf].m_iParent = AABBTREE_NULL_NODE;
+		return;
+	}
+
+	TVector vLeafMin = m_aNodes[iLeaf].m_vMin;
+	TVector vLeafMax = m_aNodes[iLeaf].m_vMax;
+	TVector vMergedMin, vMergedMax;
+
+	// Walk down from the root, taking the child whose box would grow the
+	// least, and stop when pairing the leaf with the current node is cheaper
+	// than pushing it down any further.
+	uint32 iSibling = m_iRoot;
+	while(!m_aNodes[iSibling].IsLeaf())
+	{
+		const SNode &cNode = m_aNodes[iSibling];
+
+		MergeBoxes(cNode.m_vMin, cNode.m_vMax, vLeafMin, vLeafMax, vMergedMin, vMergedMax);
+		float fCost = GetBoxCost(cNode.m_vMin, cNode.m_vMax);
+		float fMergedCost = GetBoxCost(vMergedMin, vMergedMax);
+
+		// Cost of making a new parent for this node and the leaf.
+		float fNewParentCost = 2.0f * fMergedCost;
+
+		// What pushing the leaf further down costs this node.
+		float fInheritedCost = 2.0f * (fMergedCost - fCost);
+
+		float fChildCosts[2];
+		for(uint32 iChild=0; iChild < 2; iChild++)
+		{
+			const SNode &cChild = m_aNodes[cNode.m_iChildren[iChild]];
+
+			MergeBoxes(cChild.m_vMin, cChild.m_vMax, vLeafMin, vLeafMax, vMergedMin, vMergedMax);
+			fChildCosts[iChild] = GetBoxCost(vMergedMin, vMergedMax) + fInheritedCost;
+			if(!cChild.IsLeaf())
+			{
+				fChildCosts[iChild] -= GetBoxCost(cChild.m_vMin, cChild.m_vMax);
+			}
+		}
+
+		if(fNewParentCost < fChildCosts[0] && fNewParentCost < fChildCosts[1])
+			break;
+
+		iSibling = cNode.m_iChildren[(fChildCosts[0] < fChildCosts[1]) ? 0 : 1];
+	}
+
+	// Make a new parent for the sibling and the leaf.
+	uint32 iNewParent = AllocNode();
+
+	SNode &cNewParent = m_aNodes[iNewParent];
+	SNode &cSibling = m_aNodes[iSibling];
+	SNode &cLeaf = m_aNodes[iLeaf];
+
+	uint32 iOldParent = cSibling.m_iParent;
+
+	cNewParent.m_iParent = iOldParent;
+	cNewParent.m_iChildren[0] = iSibling;
+	cNewParent.m_iChildren[1] = iLeaf;
+	cNewParent.m_nHeight = cSibling.m_nHeight + 1;
+	MergeBoxes(cSibling.m_vMin, cSibling.m_vMax, vLeafMin, vLeafMax, cNewParent.m_vMin, cNewParent.m_vMax);
+
+	cSibling.m_iParent = iNewParent;
+	cLeaf.m_iParent = iNewParent;
+
+	if(iOldParent == AABBTREE_NULL_NODE)
+	{
+		m_iRoot = iNewParent;
+	}
+	else
+	{
+		SNode &cOldParent = m_aNodes[iOldParent];
+		cOldParent.m_iChildren[(cOldParent.m_iChildren[0] == iSibling) ? 0 : 1] = iNewParent;
+	}
+
+	RefitUp(iOldParent);
+}
+
+template <class TVector, class T>
+void CDynamicAABBTree<TVector, T>::RemoveLeaf(uint32 iLeaf)
+{
+	if(iLeaf == m_iRoot)
+	{
+		m_iRoot = AABBTREE_NULL_NODE;
+		return;
+	}
+
+	uint32 iParent = m_aNodes[iLeaf].m_iParent;
+	const SNode &cParent = m_aNodes[iParent];
+	uint32 iGrandParent = cParent.m_iParent;
+	uint32 iSibling = cParent.m_iChildren[(cParent.m_iChildren[0] == iLeaf) ? 1 : 0];
+
+	// The sibling takes the parent's place.
+	m_aNodes[iSibling].m_iParent = iGrandParent;
+	if(iGrandParent == AABBTREE_NULL_NODE)
+	{
+		m_iRoot = iSibling;
+	}
+	else
+	{
+		SNode &cGrandParent = m_aNodes[iGrandParent];
+		cGrandParent.m_iChildren[(cGrandParent.m_iChildren[0] == iParent) ? 0 : 1] = iSibling;
+	}
+
+	FreeNode(iParent);
+	m_aNodes[iLeaf].m_iParent = AABBTREE_NULL_NODE;
+
+	RefitUp(iGrandParent);
+}
+
+template <class TVector, class T>
+void CDynamicAABBTree<TVector, T>::RefitUp(uint32 iNode)
+{
+	while(iNode != AABBTREE_NULL_NODE)
+	{
+		iNode = Balance(iNode);
+
+		SNode &cNode = m_aNodes[iNode];
+		const SNode &cChild0 = m_aNodes[cNode.m_iChildren[0]];
+		const SNode &cChild1 = m_aNodes[cNode.m_iChildren[1]];
+
+		cNode.m_nHeight = 1 + LTMAX(cChild0.m_nHeight, cChild1.m_nHeight);
+		MergeBoxes(cChild0.m_vMin, cChild0.m_vMax, cChild1.m_vMin, cChild1.m_vMax, cNode.m_vMin, cNode.m_vMax);
+
+		iNode = cNode.m_iParent;
+	}
+}
+
+template <class TVector, class T>
+uint32 CDynamicAABBTree<TVector, T>::Balance(uint32 iA)
+{
+	SNode &cA = m_aNodes[iA];
+	if(cA.IsLeaf() || (cA.m_nHeight < 2))
+		return iA;
+
+	uint32 iB = cA.m_iChildren[0];
+	uint32 iC = cA.m_iChildren[1];
+	int32 nBalance = m_aNodes[iC].m_nHeight - m_aNodes[iB].m_nHeight;
+
+	// Rotate whichever child is too tall up into A's place, and give A the
+	// shorter of that child's children.
+	uint32 iUp, iStay, iUpSide;
+	if(nBalance > 1)
+	{
+		iUp = iC;
+		iStay = iB;
+		iUpSide = 1;
+	}
+	else if(nBalance < -1)
+	{
+		iUp = iB;
+		iStay = iC;
+		iUpSide = 0;
+	}
+	else
+	{
+		return iA;
+	}
+
+	SNode &cUp = m_aNodes[iUp];
+	const SNode &cStay = m_aNodes[iStay];
+
+	// Up takes A's place
+	cUp.m_iParent = cA.m_iParent;
+	cA.m_iParent = iUp;
+
+	if(cUp.m_iParent == AABBTREE_NULL_NODE)
+	{
+		m_iRoot = iUp;
+	}
+	else
+	{
+		SNode &cUpParent = m_aNodes[cUp.m_iParent];
+		cUpParent.m_iChildren[(cUpParent.m_iChildren[0] == iA) ? 0 : 1] = iUp;
+	}
+
+	// The taller of Up's children stays with it, and the other goes to A
+	uint32 iF = cUp.m_iChildren[0];
+	uint32 iG = cUp.m_iChildren[1];
+	uint32 iKeep, iGive;
+	if(m_aNodes[iF].m_nHeight > m_aNodes[iG].m_nHeight)
+	{
+		iKeep = iF;
+		iGive = iG;
+	}
+	else
+	{
+		iKeep = iG;
+		iGive = iF;
+	}
+
+	const SNode &cKeep = m_aNodes[iKeep];
+	SNode &cGive = m_aNodes[iGive];
+
+	cUp.m_iChildren[0] = iA;
+	cUp.m_iChildren[1] = iKeep;
+	cA.m_iChildren[iUpSide] = iGive;
+	cGive.m_iParent = iA;
+
+	MergeBoxes(cStay.m_vMin, cStay.m_vMax, cGive.m_vMin, cGive.m_vMax, cA.m_vMin, cA.m_vMax);
+	cA.m_nHeight = 1 + LTMAX(cStay.m_nHeight, cGive.m_nHeight);
+
+	MergeBoxes(cA.m_vMin, cA.m_vMax, cKeep.m_vMin, cKeep.m_vMax, cUp.m_vMin, cUp.m_vMax);
+	cUp.m_nHeight = 1 + LTMAX(cA.m_nHeight, cKeep.m_nHeight);
+
+	return iUp;
+}
+
+template <class TVector, class T>
+void CDynamicAABBTree<TVector, T>::AddPendingOp(EPendingOp eOp, uint32 iLeaf, const TVector& vMin, const TVector& vMax)
+{
+	SPendingOp cOp;
+	cOp.m_eOp = eOp;
+	cOp.m_iLeaf = iLeaf;
+	cOp.m_vMin = vMin;
+	cOp.m_vMax = vMax;
+	m_aPendingOps.push_back(cOp);
+}
+
+template <class TVector, class T>
+typename CDynamicAABBTree<TVector, T>::SPendingOp *CDynamicAABBTree<TVector, T>::FindPendingMove(uint32 iLeaf)
+{
+	// A leaf can only have one, and it's usually one of the last ones
+	for(uint32 iCur=(uint32)m_aPendingOps.size(); iCur--; )
+	{
+		SPendingOp &cOp = m_aPendingOps[iCur];
+		if((cOp.m_iLeaf == iLeaf) && (cOp.m_eOp == PendingOp_Move))
+			return &cOp;
+	}
+
+	return LTNULL;
+}
+
+
+#endif  // __DYNAMICAABBTREE_H__
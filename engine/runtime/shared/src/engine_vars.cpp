@@ -201,7 +201,23 @@ int32 g_CV_BandwidthTargetServer = 256000; // server send bandwidth target in bi
 int32 g_CV_NewPlayerPhysics = 1;	// Use the new player physics
 
 int32 g_CV_UDPSimulatePacketLoss = 0;
+float g_CV_UDPSimulateLossBurst = 0.0f;	// Average length of the simulated packet loss bursts (0 or 1 = independent losses)
 int32 g_CV_UDPSimulateCorruption = 0;
+int32 g_CV_UDPBatchIO = 1;		// Batch UDP sends/receives into as few syscalls as possible
+int32 g_CV_UDPThreadedIO = 0;	// Update UDP connections on the listen thread (takes effect when the socket is opened)
+int32 g_CV_ServerUpdateThreads = 1;	// Threads used to build client updates (0 = one per core, 1 = build them on the server thread)
+int32 g_CV_ServerMoveThreads = 1;	// Threads used for player physics moves, which are held until all the objects have updated (0 = one per core, 1 = move each object during its update)
+int32 g_CV_SnapshotDeltaServer = 1;	// Delta compress unguaranteed positions for remote clients that ask for it
+int32 g_CV_SnapshotDeltaClient = 1;	// Ask the server to delta compress unguaranteed positions
+float g_CV_InterestRadius = 0.0f;	// Only send remote clients the objects this close to their view position (0 = send everything)
+float g_CV_InterestHysteresis = 0.25f;	// How much further out (as a fraction of InterestRadius) objects the client already has are kept
+float g_CV_InterestCellSize = 1024.0f;	// Cell size of the interest grid (takes effect when a world starts)
+int32 g_CV_LoadTestConnectRate = 4;		// LoadTest clients connected per client frame
+int32 g_CV_LoadTestClientFPS = 30;		// How many times a second the LoadTest clients update
+float g_CV_LoadTestMoveRadius = 256.0f;	// Radius of the circle LoadTest clients walk their objects around (0 = stand still)
+float g_CV_LoadTestMoveSpeed = 200.0f;	// How fast LoadTest clients walk their objects around
+int32 g_CV_PrefetchThreads = 2;	// Threads reading a world's files ahead of time when it's loaded again (0 = don't prefetch)
+int32 g_CV_WorldTreeBVH = 0;	// Keep the server's objects in a dynamic BVH instead of the level's quadtree (takes effect when a world loads)
 
 //------------------------------------------------------------------
 //------------------------------------------------------------------
@@ -343,7 +359,23 @@ static LTEngineVar g_LTEngineVars[] =
 	EV_LONG("NewPlayerPhysics", &g_CV_NewPlayerPhysics),
 
 	EV_LONG("UDPSimulatePacketLoss", &g_CV_UDPSimulatePacketLoss),
+	EV_FLOAT("UDPSimulateLossBurst", &g_CV_UDPSimulateLossBurst),
 	EV_LONG("UDPSimulateCorruption", &g_CV_UDPSimulateCorruption),
+	EV_LONG("UDPBatchIO", &g_CV_UDPBatchIO),
+	EV_LONG("UDPThreadedIO", &g_CV_UDPThreadedIO),
+	EV_LONG("ServerUpdateThreads", &g_CV_ServerUpdateThreads),
+	EV_LONG("ServerMoveThreads", &g_CV_ServerMoveThreads),
+	EV_LONG("SnapshotDeltaServer", &g_CV_SnapshotDeltaServer),
+	EV_LONG("SnapshotDeltaClient", &g_CV_SnapshotDeltaClient),
+	EV_FLOAT("InterestRadius", &g_CV_InterestRadius),
+	EV_FLOAT("InterestHysteresis", &g_CV_InterestHysteresis),
+	EV_FLOAT("InterestCellSize", &g_CV_InterestCellSize),
+	EV_LONG("LoadTestConnectRate", &g_CV_LoadTestConnectRate),
+	EV_LONG("LoadTestClientFPS", &g_CV_LoadTestClientFPS),
+	EV_FLOAT("LoadTestMoveRadius", &g_CV_LoadTestMoveRadius),
+	EV_FLOAT("LoadTestMoveSpeed", &g_CV_LoadTestMoveSpeed),
+	EV_LONG("PrefetchThreads", &g_CV_PrefetchThreads),
+	EV_LONG("WorldTreeBVH", &g_CV_WorldTreeBVH),
 
 	EV_LONG("ModelOnlyUpdateDirtyTrackers", &g_CV_ModelOnlyUpdateDirtyTrackers),
 };
@@ -0,0 +1,359 @@
+#include "bdefs.h"
+
+#include "fileprefetch.h"
+#include "genltstream.h"
+#include "sysfile.h"
+
+#include <chrono>
+
+
+// Stride used to fault in memory mapped files.  Pages are at least this big
+// everywhere we run.
+static const uint32 k_nPrefetchPageSize = 4096;
+
+
+// Read only stream over a prefetched file.  If it owns the data it frees it
+// when it's released, otherwise the data is a view of a memory mapped rez file.
+class CPrefetchStream : public CGenLTStream
+{
+public:
+	CPrefetchStream(const uint8 *pData, uint32 nSize, bool bOwnsData) :
+		m_pData(pData),
+		m_nSize(nSize),
+		m_nPos(0),
+		m_bError(false),
+		m_bOwnsData(bOwnsData)
+	{
+	}
+	~CPrefetchStream()
+	{
+		if (m_bOwnsData)
+			delete [] m_pData;
+	}
+
+	LTRESULT Read(void *pData, uint32 nSize)
+	{
+		if (nSize == 0)
+			return LT_OK;
+
+		if ((m_nPos + nSize > m_nSize) || (m_nPos + nSize < m_nPos))
+		{
+			m_nPos = m_nSize;
+			m_bError = true;
+			memset(pData, 0, nSize);
+			return LT_ERROR;
+		}
+
+		memcpy(pData, &m_pData[m_nPos], nSize);
+		m_nPos += nSize;
+		return LT_OK;
+	}
+
+	LTRESULT Write(const void *pData, uint32 nSize)
+	{
+		m_bError = true;
+		return LT_ERROR;
+	}
+
+	LTRESULT ErrorStatus()
+	{
+		return m_bError ? LT_ERROR : LT_OK;
+	}
+
+	LTRESULT SeekTo(uint32 nOffset)
+	{
+		if (nOffset > m_nSize)
+			return LT_ERROR;
+
+		m_nPos = nOffset;
+		return LT_OK;
+	}
+
+	LTRESULT GetPos(uint32 *pPos)
+	{
+		*pPos = m_nPos;
+		return LT_OK;
+	}
+
+	LTRESULT GetLen(uint32 *pLen)
+	{
+		*pLen = m_nSize;
+		return LT_OK;
+	}
+
+	void Release()
+	{
+		delete this;
+	}
+
+private:
+	const uint8 *m_pData;
+	uint32 m_nSize;
+	uint32 m_nPos;
+	bool m_bError;
+	bool m_bOwnsData;
+};
+
+
+//------------------------------------------------------------------
+// CFilePrefetcher
+//------------------------------------------------------------------
+
+CFilePrefetcher::CFilePrefetcher() :
+	m_bShutdown(false)
+{
+	ClearStats();
+}
+
+CFilePrefetcher::~CFilePrefetcher()
+{
+	Term();
+}
+
+bool CFilePrefetcher::Init(uint32 nNumThreads)
+{
+	Term();
+
+	m_bShutdown = false;
+
+	m_aThreads.reserve(nNumThreads);
+	for (uint32 nCurThread = 0; nCurThread < nNumThreads; ++nCurThread)
+	{
+		m_aThreads.push_back(std::thread(&CFilePrefetcher::IOThread, this));
+	}
+
+	return true;
+}
+
+void CFilePrefetcher::Term()
+{
+	Flush();
+
+	if (!m_aThreads.empty())
+	{
+		{
+			std::lock_guard<std::mutex> cLock(m_cQueueMutex);
+			m_bShutdown = true;
+		}
+		m_cQueueEvent.notify_all();
+
+		for (uint32 nCurThread = 0; nCurThread < m_aThreads.size(); ++nCurThread)
+		{
+			m_aThreads[nCurThread].join();
+		}
+		m_aThreads.clear();
+	}
+}
+
+std::string CFilePrefetcher::MakeKey(const char *pFilename)
+{
+	std::string sKey(pFilename);
+	for (std::string::iterator iCur = sKey.begin(); iCur != sKey.end(); ++iCur)
+	{
+		if (*iCur == '/')
+			*iCur = '\\';
+		else
+			*iCur = (char)toupper((unsigned char)*iCur);
+	}
+	return sKey;
+}
+
+void CFilePrefetcher::Add(HLTFileTree *hTree, const char *pFilename)
+{
+	if (m_aThreads.empty() || !hTree || !pFilename || !*pFilename)
+		return;
+
+	std::string sKey = MakeKey(pFilename);
+	if (m_cRequests.find(sKey) != m_cRequests.end())
+		return;
+
+	SRequest *pRequest;
+	LT_MEM_TRACK_ALLOC(pRequest = new SRequest, LT_MEM_TYPE_FILE);
+	pRequest->m_hTree = hTree;
+	pRequest->m_sFilename = pFilename;
+	pRequest->m_pData = LTNULL;
+	pRequest->m_pMappedData = LTNULL;
+	pRequest->m_nSize = 0;
+	pRequest->m_cResult = pRequest->m_cDone.get_future();
+	pRequest->m_bCanceled = false;
+
+	m_cRequests[sKey] = pRequest;
+	++m_Stats.m_nAdded;
+
+	{
+		std::lock_guard<std::mutex> cLock(m_cQueueMutex);
+		m_cQueue.push_back(pRequest);
+	}
+	m_cQueueEvent.notify_one();
+}
+
+bool CFilePrefetcher::IsPending(const char *pFilename) const
+{
+	if (m_cRequests.empty())
+		return false;
+
+	return m_cRequests.find(MakeKey(pFilename)) != m_cRequests.end();
+}
+
+ILTStream *CFilePrefetcher::Take(const char *pFilename)
+{
+	if (m_cRequests.empty())
+		return LTNULL;
+
+	TRequestMap::iterator iRequest = m_cRequests.find(MakeKey(pFilename));
+	if (iRequest == m_cRequests.end())
+		return LTNULL;
+
+	SRequest *pRequest = iRequest->second;
+	m_cRequests.erase(iRequest);
+
+	// Wait for the read if it's still going
+	if (pRequest->m_cResult.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+	{
+		std::chrono::steady_clock::time_point cStart = std::chrono::steady_clock::now();
+		pRequest->m_cResult.wait();
+		m_Stats.m_fWaitTime += std::chrono::duration<float>(std::chrono::steady_clock::now() - cStart).count();
+		++m_Stats.m_nWaited;
+	}
+	else
+	{
+		++m_Stats.m_nReady;
+	}
+
+	ILTStream *pResult = LTNULL;
+	if (pRequest->m_cResult.get())
+	{
+		m_Stats.m_nBytesUsed += pRequest->m_nSize;
+
+		// The stream gets the data
+		if (pRequest->m_pMappedData)
+		{
+			LT_MEM_TRACK_ALLOC(pResult = new CPrefetchStream(pRequest->m_pMappedData, pRequest->m_nSize, false), LT_MEM_TYPE_FILE);
+		}
+		else
+		{
+			LT_MEM_TRACK_ALLOC(pResult = new CPrefetchStream(pRequest->m_pData, pRequest->m_nSize, true), LT_MEM_TYPE_FILE);
+			pRequest->m_pData = LTNULL;
+		}
+	}
+	else
+	{
+		++m_Stats.m_nFailed;
+	}
+
+	FreeRequest(pRequest);
+
+	return pResult;
+}
+
+void CFilePrefetcher::Flush()
+{
+	if (m_cRequests.empty())
+		return;
+
+	// Anything nobody has started on can just be dropped
+	{
+		std::lock_guard<std::mutex> cLock(m_cQueueMutex);
+		for (std::deque<SRequest*>::iterator iCur = m_cQueue.begin(); iCur != m_cQueue.end(); ++iCur)
+		{
+			(*iCur)->m_bCanceled = true;
+		}
+		m_cQueue.clear();
+	}
+
+	for (TRequestMap::iterator iCur = m_cRequests.begin(); iCur != m_cRequests.end(); ++iCur)
+	{
+		SRequest *pRequest = iCur->second;
+		if (!pRequest->m_bCanceled)
+		{
+			if (pRequest->m_cResult.get())
+				++m_Stats.m_nUnused;
+			else
+				++m_Stats.m_nFailed;
+		}
+		FreeRequest(pRequest);
+	}
+	m_cRequests.clear();
+}
+
+void CFilePrefetcher::ClearStats()
+{
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+void CFilePrefetcher::FreeRequest(SRequest *pRequest)
+{
+	delete [] pRequest->m_pData;
+	delete pRequest;
+}
+
+void CFilePrefetcher::IOThread()
+{
+	for (;;)
+	{
+		SRequest *pRequest;
+		{
+			std::unique_lock<std::mutex> cLock(m_cQueueMutex);
+			while (m_cQueue.empty() && !m_bShutdown)
+				m_cQueueEvent.wait(cLock);
+
+			if (m_bShutdown)
+				return;
+
+			pRequest = m_cQueue.front();
+			m_cQueue.pop_front();
+		}
+
+		ReadRequest(pRequest);
+	}
+}
+
+void CFilePrefetcher::ReadRequest(SRequest *pRequest)
+{
+	bool bResult = false;
+
+	// Files in a memory mapped rez don't need to be read anywhere.  Touch each
+	// page so the disk reads happen on this thread instead of when the file's
+	// parsed, and hand out the mapping itself.
+	uint32 nMappedSize = 0;
+	const uint8 *pMappedData = (const uint8*)df_GetMappedData(pRequest->m_hTree, pRequest->m_sFilename.c_str(), &nMappedSize);
+	if (pMappedData)
+	{
+		volatile uint8 nTouch = 0;
+		for (uint32 nOffset = 0; nOffset < nMappedSize; nOffset += k_nPrefetchPageSize)
+		{
+			nTouch += pMappedData[nOffset];
+		}
+
+		pRequest->m_pMappedData = pMappedData;
+		pRequest->m_nSize = nMappedSize;
+		pRequest->m_cDone.set_value(true);
+		return;
+	}
+
+	// Looking a file up doesn't change the file tree and the stream reads lock
+	// it, so this is safe while the main thread is reading other files
+	ILTStream *pStream = df_Open(pRequest->m_hTree, pRequest->m_sFilename.c_str(), DFOPEN_READ);
+	if (pStream)
+	{
+		uint32 nSize = 0;
+		pStream->GetLen(&nSize);
+
+		// Not tracked, since the memory tracking isn't thread safe
+		uint8 *pData = new uint8[nSize ? nSize : 1];
+		if (pData && (pStream->Read(pData, nSize) == LT_OK))
+		{
+			pRequest->m_pData = pData;
+			pRequest->m_nSize = nSize;
+			bResult = true;
+		}
+		else
+		{
+			delete [] pData;
+		}
+
+		pStream->Release();
+	}
+
+	pRequest->m_cDone.set_value(bResult);
+}
@@ -0,0 +1,114 @@
+// Reads files into memory on background threads ahead of when they're needed.
+//
+// The owner finds out which file tree each file lives in (that part of the file
+// managers isn't thread safe) and Add()s it.  The I/O threads open and read the
+// files in the order they were added.  When the file is needed, Take() hands
+// back a memory stream over its data, waiting on the read's future if it isn't
+// finished yet.  Files in memory mapped rez files aren't copied; the stream
+// reads straight out of the mapping.  Parsing stays with the caller, so Take() has to be called
+// from the thread that owns the prefetcher.
+//
+// Files that are never taken get thrown out by Flush().
+
+#ifndef __FILEPREFETCH_H__
+#define __FILEPREFETCH_H__
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class ILTStream;
+typedef void* HLTFileTree; //class HLTFileTree;
+
+class CFilePrefetcher
+{
+public:
+	struct SStats
+	{
+		uint32 m_nAdded;
+		// Files that were read before they were needed
+		uint32 m_nReady;
+		// Files that had to be waited for
+		uint32 m_nWaited;
+		// Files that were read and never used
+		uint32 m_nUnused;
+		uint32 m_nFailed;
+		// Bytes in the files that were used
+		uint32 m_nBytesUsed;
+		// Time spent waiting in Take()
+		float m_fWaitTime;
+	};
+
+	CFilePrefetcher();
+	~CFilePrefetcher();
+
+	// Start up the I/O threads.  With 0 threads, nothing gets prefetched.
+	bool	Init(uint32 nNumThreads);
+	// Throw out everything and shut down the threads
+	void	Term();
+
+	uint32	GetNumThreads() const { return (uint32)m_aThreads.size(); }
+
+	// Queue up pFilename (as it would be passed to df_Open on hTree).  Files
+	// which are already queued are ignored.
+	void	Add(HLTFileTree *hTree, const char *pFilename);
+
+	// Is the file queued or read and waiting to be taken?
+	bool	IsPending(const char *pFilename) const;
+
+	// Get the data for a file that was added.  Returns a memory stream, which
+	// the caller releases, or LTNULL if the file wasn't added or couldn't be read.
+	ILTStream *Take(const char *pFilename);
+
+	// Forget everything that hasn't been taken.  Reads in progress are waited for.
+	void	Flush();
+
+	const SStats &GetStats() const { return m_Stats; }
+	void	ClearStats();
+
+private:
+	struct SRequest
+	{
+		HLTFileTree *m_hTree;
+		std::string m_sFilename;
+		// Set by the I/O thread.  m_pData is a copy of the file, m_pMappedData
+		// points into a memory mapped rez file and isn't freed.
+		uint8 *m_pData;
+		const uint8 *m_pMappedData;
+		uint32 m_nSize;
+		// Set to true when the file was read successfully
+		std::promise<bool> m_cDone;
+		std::future<bool> m_cResult;
+		// Set if the file was thrown out before anyone got to it
+		bool m_bCanceled;
+	};
+
+	typedef std::unordered_map<std::string, SRequest*> TRequestMap;
+
+	// Filenames are matched without regard to case or which slash is used
+	static std::string MakeKey(const char *pFilename);
+
+	void	IOThread();
+	void	ReadRequest(SRequest *pRequest);
+	void	FreeRequest(SRequest *pRequest);
+
+	std::vector<std::thread> m_aThreads;
+
+	// Everything that hasn't been taken, by key.  Only touched by the owner.
+	TRequestMap m_cRequests;
+
+	// Requests waiting for an I/O thread
+	std::mutex m_cQueueMutex;
+	std::condition_variable m_cQueueEvent;
+	std::deque<SRequest*> m_cQueue;
+	bool m_bShutdown;
+
+	SStats m_Stats;
+};
+
+#endif  // __FILEPREFETCH_H__
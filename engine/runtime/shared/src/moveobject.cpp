@@ -13,6 +13,7 @@
 #include "ltsysoptim.h"
 #include "moveplayer.h"
 #include "fullintersectline.h"
+#include "framearena.h"
 
 extern int32 g_CV_NewPlayerPhysics;	// Use the new player physics
 
@@ -28,23 +29,30 @@ uint32 g_nMoveObjectCalls;
 
 
 //*
-#define MAX_INTERSECTING_OBJECTS	128
 #define MAX_CARRIED_OBJECTS			32
 
 
+// The objects found go on the frame arena, so put a CFrameArenaMark around these.
 class IntersectingObjectArray
 {
 public:
 	MoveState	*m_pState;
 	LTObject	**m_pObjects;
 	int32		m_nObjects;
-	LTObject	*m_DefaultArray[MAX_INTERSECTING_OBJECTS];
+	CFrameArenaVector<LTObject*>	m_aFound;
 
 	IntersectingObjectArray()
 	{
-		m_pObjects = m_DefaultArray;
+		m_pObjects = LTNULL;
 		m_nObjects = 0;
 	}
+
+	// Point at what FindObjectsCB found
+	void UseFound()
+	{
+		m_pObjects = m_aFound.empty() ? LTNULL : &m_aFound[0];
+		m_nObjects = (int32)m_aFound.size();
+	}
 };
 
 
@@ -1129,30 +1137,21 @@ static void FindObjectsCB(WorldTreeObj *pTreeObj, void *pCBUser)
 	pObject = (LTObject*)pTreeObj;
 	pArray = (IntersectingObjectArray*)pCBUser;
 	
-	if(pArray->m_nObjects < MAX_INTERSECTING_OBJECTS)
-	{
-		if(pObject == pArray->m_pState->m_pObj)
-			return;
+	if(pObject == pArray->m_pState->m_pObj)
+		return;
 
-		// Check for no possible collisions between these objects...
-		if(!IsPhysical(pObject->m_Flags, pArray->m_pState->m_bServer) && !( pObject->m_Flags & FLAG_TOUCHABLE ))
-			return;
+	// Check for no possible collisions between these objects...
+	if(!IsPhysical(pObject->m_Flags, pArray->m_pState->m_bServer) && !( pObject->m_Flags & FLAG_TOUCHABLE ))
+		return;
 
-		// [RP]
-//		if(!pArray->m_pState->m_bServer)
-//		{
-//			if(pObject->m_Flags & FLAG_CLIENTNONSOLID || !(pObject->m_Flags & FLAG_SOLID))
-//				return;
-//		}
+	// [RP]
+//	if(!pArray->m_pState->m_bServer)
+//	{
+//		if(pObject->m_Flags & FLAG_CLIENTNONSOLID || !(pObject->m_Flags & FLAG_SOLID))
+//			return;
+//	}
 
-		pArray->m_pObjects[pArray->m_nObjects] = pObject;
-		pArray->m_nObjects++;
-	}
-	else
-	{
-		dsi_ConsolePrint("FindObjectsCB: Overflowed (more than %d intersecting objects)!",
-			MAX_INTERSECTING_OBJECTS);
-	}
+	pArray->m_aFound.push_back(pObject);
 }
 
 
@@ -1166,6 +1165,7 @@ static void DetectAndProcessCollisions
 	int32 i, nRestarts;
 	LTObject *pTestObj;
 	LTObject *pHitObjects[2];
+	CFrameArenaMark cArenaMark;
 	IntersectingObjectArray objectArray;
 	
 	pState->m_vStartPos = startPos;
@@ -1189,6 +1189,7 @@ static void DetectAndProcessCollisions
 	{
 		pState->m_pWorldTree->FindObjectsInBox(&pState->m_vMoveMin, &pState->m_vMoveMax,
 			FindObjectsCB, &objectArray);
+		objectArray.UseFound();
 	}
 
 	pHitObjects[0] = pHitObjects[1] = LTNULL;
@@ -1450,6 +1451,7 @@ void MoveObject
 		}
 
 		pState->m_pObj->SetPos( P1 );
+		pState->m_pAbstract->OnObjectMoved(pState->m_pObj);
 		return;
 	}
 
@@ -1535,7 +1537,7 @@ void MoveObject
 			// Move the player
 			CPlayerMover cMover(*pState, flags);
 			LTVector vDest;
-			cMover.MoveTo(P1, &vDest);
+			cMover.MoveTo(P1, &vDest, pState->m_pPlayerSolve);
 
 			// Remember where we ended up
 			pState->m_pObj->SetPos(vDest);
@@ -1565,6 +1567,7 @@ void MoveObject
 
 	// Done moving it around...
 	pState->m_pWorldTree->InsertObject(pState->m_pObj);
+	pState->m_pAbstract->OnObjectMoved(pState->m_pObj);
 
 	if(flags & MO_MOVESTANDINGONS)
 	{
@@ -1692,6 +1695,7 @@ LTBOOL ChangeObjectDimensions(MoveState *pState, LTVector &newDims, LTBOOL bColl
 	SetObjectBoundingBox(pObj, LTTRUE);
 
 	pState->m_pWorldTree->InsertObject(pObj);
+	pState->m_pAbstract->OnObjectMoved(pObj);
 	return bRet;
 }
 
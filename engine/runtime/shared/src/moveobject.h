@@ -7,6 +7,7 @@ class ILTPhysics;
 class WorldTree;
 class Node;
 class WorldModelInstance;
+class CPlayerMoveRecord;
 
 
 void RetransformWorldModel(WorldModelInstance *pWorldModel);
@@ -37,6 +38,8 @@ public:
 	virtual LTBOOL			CanOptimizeObject(LTObject *pObject)=0;
 	virtual char*			GetObjectClassName(LTObject *pObject)=0;
 	virtual ILTPhysics *	GetPhysics()=0;
+	// Called when MoveObject is done with an object, so it can be kept track of.
+	virtual void			OnObjectMoved(LTObject *pObj)=0;
 };
 
 
@@ -49,6 +52,7 @@ public:
 		m_pAbstract = LTNULL;
 		m_pObj = LTNULL;
 		m_nRestart = 0;
+		m_pPlayerSolve = LTNULL;
 	}
 
 		
@@ -72,6 +76,7 @@ public:
 		m_BPriority = bPriority;
 		m_CustomTestObjects = LTNULL;
 		m_nCustomTestObjects = 0;
+		m_pPlayerSolve = LTNULL;
 	}
 
 	void			Inherit(MoveState *pOther, LTObject *pObj)
@@ -89,6 +94,8 @@ public:
 	LTObject		**m_CustomTestObjects; // Tells it to only test these objects for collision.
 	uint32			m_nCustomTestObjects;
 
+	const CPlayerMoveRecord *m_pPlayerSolve; // The move (or just its blocker sweep) worked out ahead of time for CPlayerMover (or LTNULL).
+
 // Used internally, don't set.
 	uint32		m_bServer;
 	LTVector	m_vStartPos;
@@ -10,7 +10,6 @@
 #include "collision.h"
 
 #include <cmath>
-#include <stack>
 
 #if 0
 #ifdef _WIN32
@@ -33,7 +32,9 @@ CPlayerMover::CPlayerMover(const MoveState &cMoveState, uint32 nFlags) :
 	m_pPhysics(cMoveState.m_pAbstract->GetPhysics()),
 	m_pWorldTree(cMoveState.m_pWorldTree),
 	m_bServer(cMoveState.m_bServer != 0),
-	m_pMoveAbstract(cMoveState.m_pAbstract)
+	m_pMoveAbstract(cMoveState.m_pAbstract),
+	m_pRecord(0),
+	m_pBlockerRecord(0)
 {
 	m_nPlayerFlags = m_pPlayer->m_Flags;
 	if (nFlags & MO_NOSLIDING)
@@ -944,8 +945,9 @@ void CPlayerMover::CollideWithWorldModel_Poly(const WorldPoly *pPoly, const LTVe
 
 void CPlayerMover::CollideWithWorldModel(LTObject *pObject, const LTVector &vStart, const LTVector &vEnd, SCollideResult *pResult) const
 {
-	typedef std::stack<Node*> TWalkStack;
-	static TWalkStack cWalkStack;
+	// On the frame arena rather than static so SolveAhead can run on several threads
+	CFrameArenaMark cArenaMark;
+	CFrameArenaVector<const Node*> cWalkStack;
 
 	WorldModelInstance *pWorldModel = pObject->ToWorldModel();
 	if (!pWorldModel)
@@ -978,8 +980,8 @@ void CPlayerMover::CollideWithWorldModel(LTObject *pObject, const LTVector &vSta
 			if (cWalkStack.empty())
 				break;
 
-			pRoot = cWalkStack.top();
-			cWalkStack.pop();
+			pRoot = cWalkStack.back();
+			cWalkStack.pop_back();
 		}
 
 		// Do the fast test on the whole movement area.
@@ -1023,7 +1025,7 @@ void CPlayerMover::CollideWithWorldModel(LTObject *pObject, const LTVector &vSta
 			nStartSide = (pRoot->GetPlane()->DistTo(vStart) > -0.001f) ? FrontSide : BackSide;
 			nEndSide = nStartSide ? BackSide : FrontSide;
 			if ((pRoot->m_Sides[nEndSide] != NODE_IN) && (pRoot->m_Sides[nEndSide] != NODE_OUT))
-				cWalkStack.push(pRoot->m_Sides[nEndSide]);
+				cWalkStack.push_back(pRoot->m_Sides[nEndSide]);
 		}
 		pRoot = pRoot->m_Sides[nStartSide];
 	}
@@ -1200,16 +1202,13 @@ void CPlayerMover::CollideWithObject(LTObject *pObject, const LTVector &vStart,
 
 void CPlayerMover::FindIntersectingObjects_Callback(WorldTreeObj *pObj, void *pUser)
 {
-	FIOCallback_Data *pResult = (FIOCallback_Data *)pUser;
-	if (*pResult->m_pNumObjects < pResult->m_nMaxObjects)
-		pResult->m_pObjects[*pResult->m_pNumObjects] = (LTObject *)pObj;
-	++(*pResult->m_pNumObjects);
+	TObjectList *pResults = (TObjectList *)pUser;
+	pResults->push_back((LTObject *)pObj);
 }
 
-void CPlayerMover::FindIntersectingObjects(const LTVector &vStart, const LTVector &vEnd, LTObject** pResultObjects, uint32 *pResultCount, uint32 nMaxObjects) const
+void CPlayerMover::FindIntersectingObjects(const LTVector &vStart, const LTVector &vEnd, TObjectList *pResults) const
 {
-	*pResultCount = 0;
-	FIOCallback_Data sResultStruct(pResultObjects, pResultCount, nMaxObjects);
+	pResults->clear();
 
 	FindObjInfo cFindInfo;
 	VEC_MIN(cFindInfo.m_Min, vStart, vEnd);
@@ -1217,8 +1216,28 @@ void CPlayerMover::FindIntersectingObjects(const LTVector &vStart, const LTVecto
 	cFindInfo.m_Min -= m_vPlayerDims;
 	cFindInfo.m_Max += m_vPlayerDims;
 	cFindInfo.m_CB = FindIntersectingObjects_Callback;
-	cFindInfo.m_pCBUser = &sResultStruct;
-	m_pWorldTree->FindObjectsInBox2(&cFindInfo);
+	cFindInfo.m_pCBUser = pResults;
+
+	if (!m_pRecord)
+	{
+		m_pWorldTree->FindObjectsInBox2(&cFindInfo);
+		return;
+	}
+
+	// SolveAhead can't touch the frame codes, and has to remember what it saw
+	m_pWorldTree->FindObjectsInBoxReadOnly(&cFindInfo);
+
+	CPlayerMoveRecord::SQuery sQuery;
+	sQuery.m_vMin = cFindInfo.m_Min;
+	sQuery.m_vMax = cFindInfo.m_Max;
+	sQuery.m_nNumObjects = (uint32)pResults->size();
+	m_pRecord->m_aQueries.push_back(sQuery);
+
+	for (TObjectList::const_iterator iCurObj = pResults->begin(); iCurObj != pResults->end(); ++iCurObj)
+	{
+		m_pRecord->m_aObjects.push_back(CPlayerMoveRecord::SObject());
+		m_pRecord->m_aObjects.back().Init(*iCurObj);
+	}
 }
 
 void CPlayerMover::Collide(const LTVector &vStart, const LTVector &vEnd, SCollideResult *pResult) const
@@ -1237,10 +1256,20 @@ void CPlayerMover::Collide(const LTVector &vStart, const LTVector &vEnd, SCollid
 	LTVector vCollideStart = vStart;
 	LTVector vCollideEnd = vEnd;
 
-	// Collide against the blocker polygons
+	// Collide against the blocker polygons, unless it was done ahead of time
 	float fBlockerTime;
 	LTVector vBlockerNormal;
-	bool bHitBlocker = g_iWorldBlockerData->Intersect(vCollideStart, vCollideEnd, m_vPlayerDims, &fBlockerTime, &vBlockerNormal);
+	bool bHitBlocker;
+	const IWorldBlockerData::SSweepResult *pBlockerSweep = m_pBlockerRecord ?
+		m_pBlockerRecord->FindBlockerSweep(vCollideStart, vCollideEnd, m_vPlayerDims) : 0;
+	if (pBlockerSweep)
+	{
+		bHitBlocker = pBlockerSweep->m_bHit;
+		fBlockerTime = pBlockerSweep->m_fTime;
+		vBlockerNormal = pBlockerSweep->m_vNormal;
+	}
+	else
+		bHitBlocker = g_iWorldBlockerData->Intersect(vCollideStart, vCollideEnd, m_vPlayerDims, &fBlockerTime, &vBlockerNormal);
 	if (bHitBlocker)
 	{
 		// Update the collision end point
@@ -1252,21 +1281,12 @@ void CPlayerMover::Collide(const LTVector &vStart, const LTVector &vEnd, SCollid
 	}
 
 	// Find all intersecting objects
-	static uint32 nMaxObjectCount = 32;
-	LTObject **pObjects = (LTObject**)alloca(nMaxObjectCount * sizeof(LTObject*));
-	uint32 nNumObjects;
-	FindIntersectingObjects(vCollideStart, vCollideEnd, pObjects, &nNumObjects, nMaxObjectCount);
-	if (nNumObjects > nMaxObjectCount)
-	{
-		// If we overflow our object intersection count, increase our static buffer size and try it again
-		nMaxObjectCount = nNumObjects;
-		pObjects = (LTObject**)alloca(nMaxObjectCount * sizeof(LTObject*));
-		FindIntersectingObjects(vCollideStart, vCollideEnd, pObjects, &nNumObjects, nMaxObjectCount);
-		ASSERT(nNumObjects == nMaxObjectCount);
-	}
+	CFrameArenaMark cArenaMark;
+	TObjectList aObjects;
+	FindIntersectingObjects(vCollideStart, vCollideEnd, &aObjects);
 
 	// if we're not going to touch anything, we're done
-	if (nNumObjects == 0)
+	if (aObjects.empty())
 		return;
 
 	// How far to move away from the normal after a collision
@@ -1282,8 +1302,8 @@ void CPlayerMover::Collide(const LTVector &vStart, const LTVector &vEnd, SCollid
 	float fMoveDist = vOffset.Mag();
 	LTVector vMoveDir = vOffset / fMoveDist;
 
-	LTObject **pEndObj = &pObjects[nNumObjects];
-	for (LTObject **pCurObj = pObjects; pCurObj < pEndObj; ++pCurObj)
+	LTObject **pEndObj = &aObjects[0] + aObjects.size();
+	for (LTObject **pCurObj = &aObjects[0]; pCurObj < pEndObj; ++pCurObj)
 	{
 		// Skip objects we shouldn't collide with
 		if (!ShouldCollideWithObject(*pCurObj))
@@ -1681,21 +1701,12 @@ void CPlayerMover::SetStandingOn(const LTVector &vPos, const LTVector &vMovement
 void CPlayerMover::TouchObjects(const LTVector &vStart, const LTVector &vEnd) const
 {
 	// Find all intersecting objects
-	static uint32 nMaxObjectCount = 32;
-	LTObject **pObjects = (LTObject**)alloca(nMaxObjectCount * sizeof(LTObject*));
-	uint32 nNumObjects;
-	FindIntersectingObjects(vStart, vEnd, pObjects, &nNumObjects, nMaxObjectCount);
-	if (nNumObjects > nMaxObjectCount)
-	{
-		// If we overflow our object intersection count, increase our static buffer size and try it again
-		nMaxObjectCount = nNumObjects;
-		pObjects = (LTObject**)alloca(nMaxObjectCount * sizeof(LTObject*));
-		FindIntersectingObjects(vStart, vEnd, pObjects, &nNumObjects, nMaxObjectCount);
-		ASSERT(nNumObjects == nMaxObjectCount);
-	}
+	CFrameArenaMark cArenaMark;
+	TObjectList aObjects;
+	FindIntersectingObjects(vStart, vEnd, &aObjects);
 
 	// if we're not going to touch anything, we're done
-	if (nNumObjects == 0)
+	if (aObjects.empty())
 		return;
 
 	LTVector vMoveMin;
@@ -1706,8 +1717,8 @@ void CPlayerMover::TouchObjects(const LTVector &vStart, const LTVector &vEnd) co
 	vMoveMax += m_vPlayerDims;
 
 	// Go through the objects
-	LTObject **pEndObj = &pObjects[nNumObjects];
-	for (LTObject **pCurObj = pObjects; pCurObj < pEndObj; ++pCurObj)
+	LTObject **pEndObj = &aObjects[0] + aObjects.size();
+	for (LTObject **pCurObj = &aObjects[0]; pCurObj < pEndObj; ++pCurObj)
 	{
 		bool bIsSolid = (IsSolid((*pCurObj)->m_Flags, m_bServer) != LTFALSE);
 
@@ -1757,27 +1768,168 @@ void CPlayerMover::TouchObjects(const LTVector &vStart, const LTVector &vEnd) co
 	}
 }
 
-void CPlayerMover::MoveTo(const LTVector &vEnd, LTVector *pResult)
+void CPlayerMover::Solve(const LTVector &vStart, const LTVector &vEnd, LTVector *pResult) const
+{
+	// Handle FLAG_NOSLIDING
+	if (m_nPlayerFlags & FLAG_NOSLIDING)
+	{
+		// Note : Can't stairstep without sliding
+		SCollideResult sCollide;
+		Collide(vStart, vEnd, &sCollide);
+		*pResult = vStart + (vEnd - vStart) * sCollide.m_fTime;
+	}
+	else
+	{
+		// Figure out where we're going to end up
+		if ((m_nPlayerFlags & FLAG_STAIRSTEP) && ((vStart.x != vEnd.x) || (vStart.z != vEnd.z)))
+			StairStep(vStart, vEnd, pResult);
+		else
+			Slide(vStart, vEnd, 0, pResult);
+	}
+}
+
+void CPlayerMoveRecord::SObject::Init(LTObject *pObject)
+{
+	m_pObject = pObject;
+	m_vPos = pObject->GetPos();
+	m_vDims = pObject->GetDims();
+	m_rRot = pObject->m_Rotation;
+	m_nFlags = pObject->m_Flags;
+	m_nFlags2 = pObject->m_Flags2;
+}
+
+bool CPlayerMoveRecord::SObject::Matches(const LTObject *pObject) const
+{
+	return (m_pObject == pObject) &&
+		(m_vPos == pObject->GetPos()) &&
+		(m_vDims == pObject->GetDims()) &&
+		(m_rRot.m_Quat[0] == pObject->m_Rotation.m_Quat[0]) &&
+		(m_rRot.m_Quat[1] == pObject->m_Rotation.m_Quat[1]) &&
+		(m_rRot.m_Quat[2] == pObject->m_Rotation.m_Quat[2]) &&
+		(m_rRot.m_Quat[3] == pObject->m_Rotation.m_Quat[3]) &&
+		(m_nFlags == pObject->m_Flags) &&
+		(m_nFlags2 == pObject->m_Flags2);
+}
+
+void CPlayerMover::SolveAhead(const LTVector &vEnd, CPlayerMoveRecord *pRecord)
+{
+	pRecord->Clear();
+
+	// Teleports don't go anywhere to begin with
+	LTVector vStart = m_pPlayer->GetPos();
+	if (m_bTeleport || (vStart == vEnd))
+		return;
+
+	m_pRecord = pRecord;
+	m_pBlockerRecord = pRecord;
+	Solve(vStart, vEnd, &pRecord->m_vResult);
+	m_pRecord = 0;
+	m_pBlockerRecord = 0;
+
+	pRecord->m_pPlayer = m_pPlayer;
+	pRecord->m_vStart = vStart;
+	pRecord->m_vEnd = vEnd;
+	pRecord->m_nPlayerFlags = m_nPlayerFlags;
+	pRecord->m_nPlayerFlags2 = m_pPlayer->m_Flags2;
+	pRecord->m_vPlayerDims = m_vPlayerDims;
+	pRecord->m_fPlayerStepHeight = m_fPlayerStepHeight;
+	pRecord->m_bStandingOn = (m_pPlayer->m_pStandingOn != 0);
+}
+
+bool CPlayerMover::GetBlockerSweep(const LTVector &vEnd, IWorldBlockerData::SSweep *pSweep) const
+{
+	LTVector vStart = m_pPlayer->GetPos();
+	if (m_bTeleport || (vStart == vEnd))
+		return false;
+
+	pSweep->m_vStartPt = vStart;
+	pSweep->m_vDims = m_vPlayerDims;
+
+	// Solve collides straight toward the end first, unless StairStep is going to
+	// look for the floor
+	if (!(m_nPlayerFlags & FLAG_NOSLIDING) && (m_nPlayerFlags & FLAG_STAIRSTEP) &&
+		((vStart.x != vEnd.x) || (vStart.z != vEnd.z)) && m_pPlayer->m_pStandingOn)
+		pSweep->m_vEndPt = LTVector(vStart.x, LTMIN(vEnd.y, vStart.y) - m_fPlayerHeight * k_fSafetyZone, vStart.z);
+	else
+		pSweep->m_vEndPt = vEnd;
+
+	return true;
+}
+
+// Walks a query's objects in a CPlayerMoveRecord, for IsSolveCurrent
+struct SPlayerMoveCheck
+{
+	const CPlayerMoveRecord::SObject *m_pCur;
+	const CPlayerMoveRecord::SObject *m_pEnd;
+	bool m_bMatches;
+
+	static void Callback(WorldTreeObj *pObj, void *pUser)
+	{
+		SPlayerMoveCheck *pCheck = (SPlayerMoveCheck *)pUser;
+		if (!pCheck->m_bMatches)
+			return;
+
+		if ((pCheck->m_pCur == pCheck->m_pEnd) || !pCheck->m_pCur->Matches((LTObject *)pObj))
+			pCheck->m_bMatches = false;
+		else
+			++pCheck->m_pCur;
+	}
+};
+
+bool CPlayerMover::IsSolveCurrent(const CPlayerMoveRecord &cRecord, const LTVector &vEnd) const
+{
+	// Same move, same player
+	if ((cRecord.m_pPlayer != m_pPlayer) ||
+		(cRecord.m_vStart != m_pPlayer->GetPos()) ||
+		(cRecord.m_vEnd != vEnd) ||
+		(cRecord.m_nPlayerFlags != m_nPlayerFlags) ||
+		(cRecord.m_nPlayerFlags2 != m_pPlayer->m_Flags2) ||
+		(cRecord.m_vPlayerDims != m_vPlayerDims) ||
+		(cRecord.m_fPlayerStepHeight != m_fPlayerStepHeight) ||
+		(cRecord.m_bStandingOn != (m_pPlayer->m_pStandingOn != 0)))
+		return false;
+
+	// Everything Solve found out about the world comes from FindIntersectingObjects,
+	// and the blockers and BSPs don't change, so if the queries all come back the
+	// same, so would the answer.
+	const CPlayerMoveRecord::SObject *pCurObject = cRecord.m_aObjects.empty() ? 0 : &cRecord.m_aObjects[0];
+	for (std::vector<CPlayerMoveRecord::SQuery>::const_iterator iCurQuery = cRecord.m_aQueries.begin(); 
+		iCurQuery != cRecord.m_aQueries.end(); ++iCurQuery)
+	{
+		SPlayerMoveCheck sCheck;
+		sCheck.m_pCur = pCurObject;
+		sCheck.m_pEnd = pCurObject + iCurQuery->m_nNumObjects;
+		sCheck.m_bMatches = true;
+
+		FindObjInfo cFindInfo;
+		cFindInfo.m_Min = iCurQuery->m_vMin;
+		cFindInfo.m_Max = iCurQuery->m_vMax;
+		cFindInfo.m_CB = SPlayerMoveCheck::Callback;
+		cFindInfo.m_pCBUser = &sCheck;
+		m_pWorldTree->FindObjectsInBoxReadOnly(&cFindInfo);
+
+		if (!sCheck.m_bMatches || (sCheck.m_pCur != sCheck.m_pEnd))
+			return false;
+
+		pCurObject = sCheck.m_pEnd;
+	}
+
+	return true;
+}
+
+void CPlayerMover::MoveTo(const LTVector &vEnd, LTVector *pResult, const CPlayerMoveRecord *pSolved)
 {
 	LTVector vOrigin = m_pPlayer->GetPos();
 
 	if (!m_bTeleport && (vOrigin != vEnd))
 	{
-		// Handle FLAG_NOSLIDING
-		if (m_nPlayerFlags & FLAG_NOSLIDING)
-		{
-			// Note : Can't stairstep without sliding
-			SCollideResult sCollide;
-			Collide(vOrigin, vEnd, &sCollide);
-			*pResult = vOrigin + (vEnd - vOrigin) * sCollide.m_fTime;
-		}
+		if (pSolved && pSolved->IsSolved() && IsSolveCurrent(*pSolved, vEnd))
+			*pResult = pSolved->m_vResult;
 		else
 		{
-			// Figure out where we're going to end up
-			if ((m_nPlayerFlags & FLAG_STAIRSTEP) && ((vOrigin.x != vEnd.x) || (vOrigin.z != vEnd.z)))
-				StairStep(vOrigin, vEnd, pResult);
-			else
-				Slide(vOrigin, vEnd, 0, pResult);
+			m_pBlockerRecord = pSolved;
+			Solve(vOrigin, vEnd, pResult);
+			m_pBlockerRecord = 0;
 		}
 	}
 	else
@@ -2,18 +2,123 @@
 #define __MOVEPLAYER_H__
 
 #include "de_objects.h" // Need LTObject for ShouldMoveObject to be inlined
+#include "framearena.h"
+#include "world_blocker_data.h"
+
+#include <vector>
 
 class MoveState;
 class WorldTreeObj;
 class WorldPoly;
 
+// A player move worked out ahead of time by CPlayerMover::SolveAhead, along with
+// everything the world tree told it along the way.  MoveTo only uses the result
+// if the same queries still find the same objects in the same state.
+class CPlayerMoveRecord
+{
+public:
+	CPlayerMoveRecord() : m_pPlayer(0), m_bHasBlockerSweep(false) {}
+
+	void Clear()
+	{
+		m_pPlayer = 0;
+		m_aQueries.clear();
+		m_aObjects.clear();
+	}
+
+	// Has a move been recorded?
+	bool IsSolved() const { return m_pPlayer != 0; }
+
+	// Keep a sweep against the blockers that was done ahead of time (see
+	// CPlayerMover::GetBlockerSweep).  If the move asks for the same sweep, it
+	// uses this result instead of doing it again.  Clear() leaves it alone.
+	void SetBlockerSweep(const IWorldBlockerData::SSweep &sSweep, const IWorldBlockerData::SSweepResult &sResult)
+	{
+		m_sBlockerSweep = sSweep;
+		m_sBlockerResult = sResult;
+		m_bHasBlockerSweep = true;
+	}
+
+	void ClearBlockerSweep() { m_bHasBlockerSweep = false; }
+
+private:
+	friend class CPlayerMover;
+	friend struct SPlayerMoveCheck;
+
+	// What the player mover looks at on an object it finds
+	struct SObject
+	{
+		void Init(LTObject *pObject);
+		bool Matches(const LTObject *pObject) const;
+
+		LTObject *m_pObject;
+		LTVector m_vPos;
+		LTVector m_vDims;
+		LTRotation m_rRot;
+		uint32 m_nFlags;
+		uint32 m_nFlags2;
+	};
+
+	// A FindIntersectingObjects call, and how many objects it found
+	struct SQuery
+	{
+		LTVector m_vMin;
+		LTVector m_vMax;
+		uint32 m_nNumObjects;
+	};
+
+	// The move, and the player's state when it was worked out
+	LTObject *m_pPlayer;
+	LTVector m_vStart;
+	LTVector m_vEnd;
+	LTVector m_vResult;
+	uint32 m_nPlayerFlags;
+	uint32 m_nPlayerFlags2;
+	LTVector m_vPlayerDims;
+	float m_fPlayerStepHeight;
+	bool m_bStandingOn;
+
+	std::vector<SQuery> m_aQueries;
+	// The objects each query found, one query after another
+	std::vector<SObject> m_aObjects;
+
+	// The result of SetBlockerSweep, if it's for this sweep
+	const IWorldBlockerData::SSweepResult *FindBlockerSweep(const LTVector &vStart, const LTVector &vEnd, const LTVector &vDims) const
+	{
+		if (!m_bHasBlockerSweep ||
+			(m_sBlockerSweep.m_vStartPt != vStart) ||
+			(m_sBlockerSweep.m_vEndPt != vEnd) ||
+			(m_sBlockerSweep.m_vDims != vDims))
+			return 0;
+
+		return &m_sBlockerResult;
+	}
+
+	bool m_bHasBlockerSweep;
+	IWorldBlockerData::SSweep m_sBlockerSweep;
+	IWorldBlockerData::SSweepResult m_sBlockerResult;
+};
+
 class CPlayerMover
 {
 public:
 	CPlayerMover(const MoveState &cMoveState, uint32 nFlags);
 	// Move the player to the specified destination, touching objects as necessary
 	// Returns the position where they would end up
-	void MoveTo(const LTVector &vEnd, LTVector *pResult);
+	// If pSolved is a SolveAhead of this move that's still good, its result is used,
+	// and otherwise its blocker sweep is used if it has one
+	void MoveTo(const LTVector &vEnd, LTVector *pResult, const CPlayerMoveRecord *pSolved = 0);
+
+	// Work out where MoveTo would put the player, without changing anything, and
+	// keep it in pRecord.  This only reads the world, so moves for different
+	// players can be worked out on different threads, as long as nothing else is
+	// going on.
+	void SolveAhead(const LTVector &vEnd, CPlayerMoveRecord *pRecord);
+
+	// The blocker sweep that working out a move to vEnd starts with, so a batch
+	// of moves can be swept at once with IWorldBlockerData::IntersectPacket.
+	// Returns false if the move won't sweep anything.
+	bool GetBlockerSweep(const LTVector &vEnd, IWorldBlockerData::SSweep *pSweep) const;
 
 	// Should this object be moved by this class?
 	static bool ShouldMoveObject(const LTObject *pObj, bool bServer) {
@@ -43,6 +148,11 @@ protected:
 		// Did we hit anything?
 		bool m_bCollision;
 	};
+	// Where the player ends up moving from vStart to vEnd (not teleporting)
+	void Solve(const LTVector &vStart, const LTVector &vEnd, LTVector *pResult) const;
+	// Would Solve still come up with what's in cRecord?
+	bool IsSolveCurrent(const CPlayerMoveRecord &cRecord, const LTVector &vEnd) const;
+
 	// Collision function
 	void Collide(const LTVector &vStart, const LTVector &vEnd, SCollideResult *pResult) const;
 	// Move the player, sliding along surfaces
@@ -65,21 +175,11 @@ protected:
 	void CollideWithObject(LTObject *pObject, const LTVector &vStart, const LTVector &vEnd, SCollideResult *pResult) const;
 
 	// Find all objects possibly intersecting the movement path
-	// Note : *pResultCount will be set to a number > nMaxObjects in an overflow situation
-	void FindIntersectingObjects(const LTVector &vStart, const LTVector &vEnd, LTObject** pResultObjects, uint32 *pResultCount, uint32 nMaxObjects) const;
+	// Note : The results are on the frame arena, so put a CFrameArenaMark around them
+	typedef CFrameArenaVector<LTObject*> TObjectList;
+	void FindIntersectingObjects(const LTVector &vStart, const LTVector &vEnd, TObjectList *pResults) const;
 
-	// Callback stuff for FindIntersectingObjects
-	struct FIOCallback_Data
-	{
-		FIOCallback_Data(LTObject **pObjects, uint32 *pNumObjects, uint32 nMaxObjects) :
-			m_pObjects(pObjects), 
-			m_pNumObjects(pNumObjects),
-			m_nMaxObjects(nMaxObjects)
-		{}
-		LTObject **m_pObjects;
-		uint32 *m_pNumObjects;
-		uint32 m_nMaxObjects;
-	};
+	// Callback for FindIntersectingObjects
 	static void FindIntersectingObjects_Callback(WorldTreeObj *pObj, void *pUser);
 
 	// Test a collision against a worldmodel
@@ -152,6 +252,10 @@ protected:
 	bool m_bDetachStandingOn;
 	// Is this a teleportation?
 	bool m_bTeleport;
+	// Where SolveAhead is keeping the queries, if it's running
+	CPlayerMoveRecord *m_pRecord;
+	// The record with a blocker sweep done ahead of time, if there is one
+	const CPlayerMoveRecord *m_pBlockerRecord;
 
 	// Change the internal representation of the dims of the player
 	void ChangeDims(const LTVector &vDims);
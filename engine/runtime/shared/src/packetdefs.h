@@ -29,7 +29,7 @@
 
 
 // Each time the protocol is updated, this number should be incremented.
-#define LT_NET_PROTOCOL_VERSION		7	// 7 == LithTech 3.0 (spring 2001)
+#define LT_NET_PROTOCOL_VERSION		9	// 7 == LithTech 3.0 (spring 2001), 8 == delta snapshot updates, 9 == 32 bit selective ACKs
 
 
 #define DEFAULT_CLIENT_UPDATE_RATE	10
@@ -164,6 +164,13 @@
 // uint16 file_id
 #define SMSG_CHANGE_CHILDMODEL     (PACKETID_SERVERBASE+18)
 
+// Unguaranteed server update with delta compressed positions.  Only sent to
+// clients which have sent a CMSG_SNAPSHOTACK.  (See snapshotdelta.h)
+// uint8: Epoch
+// uint16: Snapshot ID
+// Same as SMSG_UNGUARANTEEDUPDATE from there
+#define SMSG_DELTAUPDATE		(PACKETID_SERVERBASE+19)
+
 // Server subpackets, contained in SMSG_UPDATE packets.
 // Subpackets are only sent when flags==0 at the start of the object update data.
 
@@ -270,6 +277,9 @@ struct FileIDInfo
 // Used for testing (when the client blasts the server).
 #define CMSG_TEST				(PACKETID_CLIENTBASE+7)
 
+// Acks the SMSG_DELTAUPDATE snapshots received, or asks for delta updates.  (See snapshotdelta.h)
+#define CMSG_SNAPSHOTACK		(PACKETID_CLIENTBASE+8)
+
 
 #endif  // __PACKETDEFS_H__
 
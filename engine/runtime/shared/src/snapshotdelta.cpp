@@ -0,0 +1,486 @@
+
+#include "bdefs.h"
+#include "snapshotdelta.h"
+#include "packet.h"
+#include "packetdefs.h"
+
+// How far back a baseline can be
+#define SNAPSHOTDELTA_AGEBITS		5
+#define SNAPSHOTDELTA_MAXAGE		((1 << SNAPSHOTDELTA_AGEBITS) - 1)
+
+// Size classes for the position deltas
+#define SNAPSHOTDELTA_CLASSBITS		2
+#define SNAPSHOTDELTA_SMALLBITS		5
+#define SNAPSHOTDELTA_MEDIUMBITS	9
+
+enum EDeltaClass
+{
+	eDeltaClass_Zero = 0,
+	eDeltaClass_Small = 1,
+	eDeltaClass_Medium = 2,
+	eDeltaClass_Raw = 3,
+};
+
+// Bits in a position without delta compression
+static const uint32 k_nFullPosBits = 16 * 3;
+
+// Is snapshot A newer than snapshot B?  (Handles wrapping)
+inline bool IsNewerSnapshot(uint16 nA, uint16 nB)
+{
+	return (int16)(nA - nB) > 0;
+}
+
+inline bool IsNewerEpoch(uint8 nA, uint8 nB)
+{
+	return (int8)(nA - nB) > 0;
+}
+
+inline int32 SignExtend(uint32 nValue, uint32 nBits)
+{
+	uint32 nSign = 1 << (nBits - 1);
+	return (int32)(nValue ^ nSign) - (int32)nSign;
+}
+
+inline bool FitsInBits(int32 nValue, uint32 nBits)
+{
+	int32 nLimit = 1 << (nBits - 1);
+	return (nValue >= -nLimit) && (nValue < nLimit);
+}
+
+static void WriteFullPos(CPacket_Write &cPacket, const CompWorldPos &cPos)
+{
+	cPacket.Writeuint16(cPos.m_Pos[0]);
+	cPacket.Writeuint16(cPos.m_Pos[1]);
+	cPacket.Writeuint16(cPos.m_Pos[2]);
+}
+
+static void ReadFullPos(CPacket_Read &cPacket, CompWorldPos *pPos)
+{
+	pPos->m_Pos[0] = cPacket.Readuint16();
+	pPos->m_Pos[1] = cPacket.Readuint16();
+	pPos->m_Pos[2] = cPacket.Readuint16();
+	pPos->m_Extra = 0;
+}
+
+static void WriteDeltaComponent(CPacket_Write &cPacket, uint16 nBase, uint16 nValue)
+{
+	int32 nDelta = (int32)nValue - (int32)nBase;
+	if (nDelta == 0)
+	{
+		cPacket.WriteBits(eDeltaClass_Zero, SNAPSHOTDELTA_CLASSBITS);
+	}
+	else if (FitsInBits(nDelta, SNAPSHOTDELTA_SMALLBITS))
+	{
+		cPacket.WriteBits(eDeltaClass_Small, SNAPSHOTDELTA_CLASSBITS);
+		cPacket.WriteBits((uint32)nDelta, SNAPSHOTDELTA_SMALLBITS);
+	}
+	else if (FitsInBits(nDelta, SNAPSHOTDELTA_MEDIUMBITS))
+	{
+		cPacket.WriteBits(eDeltaClass_Medium, SNAPSHOTDELTA_CLASSBITS);
+		cPacket.WriteBits((uint32)nDelta, SNAPSHOTDELTA_MEDIUMBITS);
+	}
+	else
+	{
+		cPacket.WriteBits(eDeltaClass_Raw, SNAPSHOTDELTA_CLASSBITS);
+		cPacket.Writeuint16(nValue);
+	}
+}
+
+static uint16 ReadDeltaComponent(CPacket_Read &cPacket, uint16 nBase)
+{
+	switch (cPacket.ReadBits(SNAPSHOTDELTA_CLASSBITS))
+	{
+		case eDeltaClass_Zero :
+			return nBase;
+		case eDeltaClass_Small :
+			return (uint16)(nBase + SignExtend(cPacket.ReadBits(SNAPSHOTDELTA_SMALLBITS), SNAPSHOTDELTA_SMALLBITS));
+		case eDeltaClass_Medium :
+			return (uint16)(nBase + SignExtend(cPacket.ReadBits(SNAPSHOTDELTA_MEDIUMBITS), SNAPSHOTDELTA_MEDIUMBITS));
+		default :
+			return cPacket.Readuint16();
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// CSnapshotBaselines
+
+uint32 CSnapshotBaselines::GetCount(uint16 nObjectID) const
+{
+	if (nObjectID >= m_aObjects.size())
+		return 0;
+	return m_aObjects[nObjectID].m_nCount;
+}
+
+const CSnapshotBaselines::SEntry &CSnapshotBaselines::Get(uint16 nObjectID, uint32 nIndex) const
+{
+	const SObject &cObject = m_aObjects[nObjectID];
+	ASSERT(nIndex < cObject.m_nCount);
+	return cObject.m_aEntries[(cObject.m_nNext + k_nMaxBaselines - 1 - nIndex) % k_nMaxBaselines];
+}
+
+const CompWorldPos *CSnapshotBaselines::Find(uint16 nObjectID, uint16 nSnapshotID) const
+{
+	uint32 nCount = GetCount(nObjectID);
+	for (uint32 nCurEntry = 0; nCurEntry < nCount; ++nCurEntry)
+	{
+		const SEntry &cEntry = Get(nObjectID, nCurEntry);
+		if (cEntry.m_nSnapshotID == nSnapshotID)
+			return &cEntry.m_cPos;
+	}
+	return LTNULL;
+}
+
+void CSnapshotBaselines::Add(uint16 nObjectID, uint16 nSnapshotID, const CompWorldPos &cPos)
+{
+	if (nObjectID >= m_aObjects.size())
+		m_aObjects.resize(nObjectID + 1);
+
+	SObject &cObject = m_aObjects[nObjectID];
+	SEntry &cEntry = cObject.m_aEntries[cObject.m_nNext];
+	cEntry.m_nSnapshotID = nSnapshotID;
+	cEntry.m_cPos = cPos;
+
+	cObject.m_nNext = (uint8)((cObject.m_nNext + 1) % k_nMaxBaselines);
+	if (cObject.m_nCount < k_nMaxBaselines)
+		++cObject.m_nCount;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// SSnapshotDeltaStats
+
+void SSnapshotDeltaStats::Clear()
+{
+	m_nSnapshots = 0;
+	m_nDeltaSnapshots = 0;
+	m_nUpdateBits = 0;
+	m_nFirstTime = 0;
+	m_nLastTime = 0;
+	m_nDeltaPos = 0;
+	m_nFullPos = 0;
+	m_nPosBits = 0;
+	m_nUncompressedPosBits = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// CSnapshotDeltaSender
+
+CSnapshotDeltaSender::CSnapshotDeltaSender() :
+	m_bEnabled(false),
+	m_bDeltaSnapshot(false),
+	m_nEpoch(0),
+	m_nSnapshotID(0),
+	m_bHaveAck(false),
+	m_nAckNewest(0),
+	m_nAckMask(0)
+{
+}
+
+void CSnapshotDeltaSender::Reset()
+{
+	++m_nEpoch;
+	m_nSnapshotID = 0;
+	m_bHaveAck = false;
+	m_nAckNewest = 0;
+	m_nAckMask = 0;
+	m_cBaselines.Clear();
+	m_aPending.clear();
+}
+
+void CSnapshotDeltaSender::OnAck(CPacket_Read &cPacket)
+{
+	// Any ack means they understand delta updates
+	m_bEnabled = true;
+
+	if (!cPacket.Readbool())
+		return;
+
+	uint8 nEpoch = cPacket.Readuint8();
+	uint16 nNewest = cPacket.Readuint16();
+	uint32 nMask = cPacket.Readuint32();
+
+	// Left over from before the last reset?
+	if (nEpoch != m_nEpoch)
+		return;
+
+	// Don't believe acks for snapshots that haven't been sent
+	if (IsNewerSnapshot(nNewest, m_nSnapshotID))
+		return;
+
+	if (!m_bHaveAck)
+	{
+		m_bHaveAck = true;
+		m_nAckNewest = nNewest;
+		m_nAckMask = nMask;
+		return;
+	}
+
+	// Merge the two windows, keeping the newer one as the reference
+	int32 nDiff = (int16)(nNewest - m_nAckNewest);
+	if (nDiff < 0)
+	{
+		uint32 nShift = (uint32)-nDiff;
+		if (nShift <= 32)
+			m_nAckMask |= 1u << (nShift - 1);
+		if (nShift < 32)
+			m_nAckMask |= nMask << nShift;
+	}
+	else
+	{
+		uint32 nShift = (uint32)nDiff;
+		if (nShift)
+		{
+			uint32 nOldMask = m_nAckMask;
+			m_nAckMask = 0;
+			if (nShift <= 32)
+				m_nAckMask |= 1u << (nShift - 1);
+			if (nShift < 32)
+				m_nAckMask |= nOldMask << nShift;
+			m_nAckNewest = nNewest;
+		}
+		m_nAckMask |= nMask;
+	}
+}
+
+bool CSnapshotDeltaSender::IsAcked(uint16 nSnapshotID) const
+{
+	if (!m_bHaveAck)
+		return false;
+
+	int32 nAge = (int16)(m_nAckNewest - nSnapshotID);
+	if (nAge == 0)
+		return true;
+	if ((nAge < 0) || (nAge > 32))
+		return false;
+	return (m_nAckMask & (1u << (nAge - 1))) != 0;
+}
+
+void CSnapshotDeltaSender::BeginSnapshot(CPacket_Write &cPacket, bool bDelta)
+{
+	ASSERT(m_aPending.empty());
+
+	m_bDeltaSnapshot = bDelta;
+	if (!bDelta)
+	{
+		cPacket.Writeuint8(SMSG_UNGUARANTEEDUPDATE);
+		return;
+	}
+
+	++m_nSnapshotID;
+
+	cPacket.Writeuint8(SMSG_DELTAUPDATE);
+	cPacket.Writeuint8(m_nEpoch);
+	cPacket.Writeuint16(m_nSnapshotID);
+}
+
+void CSnapshotDeltaSender::WritePos(CPacket_Write &cPacket, uint16 nObjectID, const CompWorldPos &cPos)
+{
+	uint32 nStartBits = cPacket.Size();
+
+	// Find the newest position the client is known to have
+	const CSnapshotBaselines::SEntry *pBaseline = LTNULL;
+	uint32 nBaselineAge = 0;
+	uint32 nNumBaselines = m_bDeltaSnapshot ? m_cBaselines.GetCount(nObjectID) : 0;
+	for (uint32 nCurBaseline = 0; nCurBaseline < nNumBaselines; ++nCurBaseline)
+	{
+		const CSnapshotBaselines::SEntry &cEntry = m_cBaselines.Get(nObjectID, nCurBaseline);
+		uint32 nAge = (uint16)(m_nSnapshotID - cEntry.m_nSnapshotID);
+		// They only get older from here
+		if (nAge > SNAPSHOTDELTA_MAXAGE)
+			break;
+		if (IsAcked(cEntry.m_nSnapshotID))
+		{
+			pBaseline = &cEntry;
+			nBaselineAge = nAge;
+			break;
+		}
+	}
+
+	if (m_bDeltaSnapshot)
+		cPacket.Writebool(pBaseline != LTNULL);
+
+	if (pBaseline)
+	{
+		cPacket.WriteBits(nBaselineAge, SNAPSHOTDELTA_AGEBITS);
+		for (uint32 nCurAxis = 0; nCurAxis < 3; ++nCurAxis)
+			WriteDeltaComponent(cPacket, pBaseline->m_cPos.m_Pos[nCurAxis], cPos.m_Pos[nCurAxis]);
+	}
+	else
+	{
+		WriteFullPos(cPacket, cPos);
+	}
+
+	// Remember it once we know it's going out
+	SPendingPos cPending;
+	cPending.m_nObjectID = nObjectID;
+	cPending.m_cPos = cPos;
+	cPending.m_bDelta = (pBaseline != LTNULL);
+	cPending.m_nBits = cPacket.Size() - nStartBits;
+	m_aPending.push_back(cPending);
+}
+
+void CSnapshotDeltaSender::CommitPos()
+{
+	for (uint32 nCurPos = 0; nCurPos < m_aPending.size(); ++nCurPos)
+	{
+		const SPendingPos &cPending = m_aPending[nCurPos];
+		if (m_bDeltaSnapshot)
+			m_cBaselines.Add(cPending.m_nObjectID, m_nSnapshotID, cPending.m_cPos);
+
+		if (cPending.m_bDelta)
+			++m_cStats.m_nDeltaPos;
+		else
+			++m_cStats.m_nFullPos;
+		m_cStats.m_nPosBits += cPending.m_nBits;
+		m_cStats.m_nUncompressedPosBits += k_nFullPosBits;
+	}
+	m_aPending.clear();
+}
+
+void CSnapshotDeltaSender::DiscardPos()
+{
+	m_aPending.clear();
+}
+
+void CSnapshotDeltaSender::EndSnapshot(uint32 nPacketBits, uint32 nUpdateTime)
+{
+	ASSERT(m_aPending.empty());
+
+	if (!m_cStats.m_nSnapshots)
+		m_cStats.m_nFirstTime = nUpdateTime;
+	m_cStats.m_nLastTime = nUpdateTime;
+	++m_cStats.m_nSnapshots;
+	if (m_bDeltaSnapshot)
+		++m_cStats.m_nDeltaSnapshots;
+	m_cStats.m_nUpdateBits += nPacketBits;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// CSnapshotDeltaReceiver
+
+CSnapshotDeltaReceiver::CSnapshotDeltaReceiver()
+{
+	Reset();
+}
+
+void CSnapshotDeltaReceiver::Reset()
+{
+	m_bHaveEpoch = false;
+	m_nEpoch = 0;
+	m_nSnapshotID = 0;
+	m_bSnapshotBad = false;
+	m_bHaveAck = false;
+	m_nAckNewest = 0;
+	m_nAckMask = 0;
+	m_bAckPending = false;
+	m_cBaselines.Clear();
+}
+
+void CSnapshotDeltaReceiver::OnPlainUpdate(bool bWantDelta)
+{
+	if (bWantDelta)
+		m_bAckPending = true;
+}
+
+bool CSnapshotDeltaReceiver::BeginSnapshot(CPacket_Read &cPacket)
+{
+	uint8 nEpoch = cPacket.Readuint8();
+	uint16 nSnapshotID = cPacket.Readuint16();
+
+	if (m_bHaveEpoch && (nEpoch != m_nEpoch))
+	{
+		// Late packet from before the server started over
+		if (!IsNewerEpoch(nEpoch, m_nEpoch))
+			return false;
+
+		Reset();
+	}
+	else if (m_bHaveEpoch)
+	{
+		// Out of order or duplicated.  The baselines have to go in order, and the
+		// positions are out of date anyway.
+		if (!IsNewerSnapshot(nSnapshotID, m_nSnapshotID))
+			return false;
+	}
+
+	m_bHaveEpoch = true;
+	m_nEpoch = nEpoch;
+	m_nSnapshotID = nSnapshotID;
+	m_bSnapshotBad = false;
+
+	return true;
+}
+
+bool CSnapshotDeltaReceiver::ReadPos(CPacket_Read &cPacket, uint16 nObjectID, CompWorldPos *pPos)
+{
+	if (!cPacket.Readbool())
+	{
+		ReadFullPos(cPacket, pPos);
+		m_cBaselines.Add(nObjectID, m_nSnapshotID, *pPos);
+		return true;
+	}
+
+	uint16 nBaselineID = (uint16)(m_nSnapshotID - cPacket.ReadBits(SNAPSHOTDELTA_AGEBITS));
+	const CompWorldPos *pBaseline = m_cBaselines.Find(nObjectID, nBaselineID);
+
+	// Read it anyway so we stay lined up with the rest of the packet
+	CompWorldPos cZero;
+	cZero.m_Pos[0] = cZero.m_Pos[1] = cZero.m_Pos[2] = 0;
+	cZero.m_Extra = 0;
+	const CompWorldPos &cBaseline = pBaseline ? *pBaseline : cZero;
+
+	CompWorldPos cPos;
+	for (uint32 nCurAxis = 0; nCurAxis < 3; ++nCurAxis)
+		cPos.m_Pos[nCurAxis] = ReadDeltaComponent(cPacket, cBaseline.m_Pos[nCurAxis]);
+	cPos.m_Extra = cBaseline.m_Extra;
+
+	if (!pBaseline)
+	{
+		// This shouldn't happen..  Don't ack it so the server doesn't build on it.
+		ASSERT(!"Missing snapshot baseline");
+		m_bSnapshotBad = true;
+		return false;
+	}
+
+	m_cBaselines.Add(nObjectID, m_nSnapshotID, cPos);
+	*pPos = cPos;
+	return true;
+}
+
+void CSnapshotDeltaReceiver::EndSnapshot(bool bComplete)
+{
+	if (m_bSnapshotBad || !bComplete)
+		return;
+
+	// Snapshots only come through in order, so this is always the newest
+	if (m_bHaveAck)
+	{
+		uint32 nShift = (uint16)(m_nSnapshotID - m_nAckNewest);
+		uint32 nOldMask = m_nAckMask;
+		m_nAckMask = 0;
+		if (nShift <= 32)
+			m_nAckMask |= 1u << (nShift - 1);
+		if (nShift < 32)
+			m_nAckMask |= nOldMask << nShift;
+	}
+	else
+	{
+		m_nAckMask = 0;
+	}
+
+	m_bHaveAck = true;
+	m_nAckNewest = m_nSnapshotID;
+	m_bAckPending = true;
+}
+
+void CSnapshotDeltaReceiver::WriteAck(CPacket_Write &cPacket)
+{
+	cPacket.Writebool(m_bHaveAck);
+	if (m_bHaveAck)
+	{
+		cPacket.Writeuint8(m_nEpoch);
+		cPacket.Writeuint16(m_nAckNewest);
+		cPacket.Writeuint32(m_nAckMask);
+	}
+
+	m_bAckPending = false;
+}
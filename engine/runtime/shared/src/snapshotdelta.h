@@ -0,0 +1,188 @@
+// Delta compression of the positions in the unguaranteed object updates.
+//
+// Every update sent to a client in delta mode is a numbered snapshot, and the
+// client acks the snapshots it gets.  Both sides remember the last few positions
+// sent for each object, and positions are written relative to the newest one
+// the client is known to have.  Anything without an acked baseline is sent in full.
+//
+// SMSG_DELTAUPDATE header (after the packet ID) :
+//		uint8 : Epoch (bumped when the server starts over)
+//		uint16 : Snapshot ID
+// Position encoding (for UUF_POS) :
+//		bool : Has baseline
+//		If it has a baseline :
+//			5 bits : How many snapshots back the baseline is
+//			For each axis : 2 bit size class, then 0, 5, 9 or 16 bits
+//		Otherwise :
+//			The full compressed position
+// CMSG_SNAPSHOTACK :
+//		bool : Has acks (false just asks for delta mode)
+//		If it has acks :
+//			uint8 : Epoch
+//			uint16 : Newest snapshot ID received
+//			uint32 : Mask of the 32 snapshots before that (bit 0 = newest - 1)
+
+#ifndef __SNAPSHOTDELTA_H__
+#define __SNAPSHOTDELTA_H__
+
+#ifndef __ILTCOMMON_H__
+#include "iltcommon.h"
+#endif
+
+#include <vector>
+
+class CPacket_Read;
+class CPacket_Write;
+
+// The last few positions sent in a snapshot for each object
+class CSnapshotBaselines
+{
+public:
+	enum { k_nMaxBaselines = 8 };
+
+	struct SEntry
+	{
+		uint16 m_nSnapshotID;
+		CompWorldPos m_cPos;
+	};
+
+	void Clear() { m_aObjects.clear(); }
+
+	// Number of entries for the object, and entry nIndex back from the newest
+	uint32 GetCount(uint16 nObjectID) const;
+	const SEntry &Get(uint16 nObjectID, uint32 nIndex) const;
+
+	// Find the position sent in a snapshot.  Returns 0 if it's not around anymore.
+	const CompWorldPos *Find(uint16 nObjectID, uint16 nSnapshotID) const;
+
+	// Add a position, pushing out the oldest one if it's full.  nSnapshotID must be
+	// newer than everything already in there for the object.
+	void Add(uint16 nObjectID, uint16 nSnapshotID, const CompWorldPos &cPos);
+
+private:
+	struct SObject
+	{
+		SObject() : m_nCount(0), m_nNext(0) {}
+		uint8 m_nCount;
+		uint8 m_nNext;
+		SEntry m_aEntries[k_nMaxBaselines];
+	};
+
+	std::vector<SObject> m_aObjects;
+};
+
+struct SSnapshotDeltaStats
+{
+	SSnapshotDeltaStats() { Clear(); }
+	void Clear();
+
+	uint32 m_nSnapshots;
+	uint32 m_nDeltaSnapshots;
+	// Total size of the unguaranteed updates
+	uint64 m_nUpdateBits;
+	// Update times of the first and last snapshot counted
+	uint32 m_nFirstTime, m_nLastTime;
+
+	uint32 m_nDeltaPos, m_nFullPos;
+	// Bits spent on positions, and what they would have taken without delta compression
+	uint64 m_nPosBits, m_nUncompressedPosBits;
+};
+
+// Server side, one per client
+class CSnapshotDeltaSender
+{
+public:
+	CSnapshotDeltaSender();
+
+	// Forget the baselines and acks, and start a new epoch.  Called when the
+	// client enters a world.
+	void Reset();
+
+	// Has the client asked for delta updates?
+	bool IsEnabled() const { return m_bEnabled; }
+
+	// Handle a CMSG_SNAPSHOTACK
+	void OnAck(CPacket_Read &cPacket);
+
+	// Write the packet ID and header for an unguaranteed update.  This will be an
+	// SMSG_DELTAUPDATE if bDelta is set, or a plain SMSG_UNGUARANTEEDUPDATE otherwise.
+	void BeginSnapshot(CPacket_Write &cPacket, bool bDelta);
+	// Write an object's position
+	void WritePos(CPacket_Write &cPacket, uint16 nObjectID, const CompWorldPos &cPos);
+	// The positions written since the last commit made it into the packet
+	void CommitPos();
+	// The positions written since the last commit got stripped off the end
+	void DiscardPos();
+	// Count the finished snapshot in the stats
+	void EndSnapshot(uint32 nPacketBits, uint32 nUpdateTime);
+
+	const SSnapshotDeltaStats &GetStats() const { return m_cStats; }
+	void ClearStats() { m_cStats.Clear(); }
+
+private:
+	bool IsAcked(uint16 nSnapshotID) const;
+
+	struct SPendingPos
+	{
+		uint16 m_nObjectID;
+		CompWorldPos m_cPos;
+		bool m_bDelta;
+		uint32 m_nBits;
+	};
+
+	bool m_bEnabled;
+	bool m_bDeltaSnapshot;
+	uint8 m_nEpoch;
+	uint16 m_nSnapshotID;
+
+	bool m_bHaveAck;
+	uint16 m_nAckNewest;
+	uint32 m_nAckMask;
+
+	CSnapshotBaselines m_cBaselines;
+	std::vector<SPendingPos> m_aPending;
+
+	SSnapshotDeltaStats m_cStats;
+};
+
+// Client side
+class CSnapshotDeltaReceiver
+{
+public:
+	CSnapshotDeltaReceiver();
+
+	// Forget everything.  Called when a world is loaded.
+	void Reset();
+
+	// Got a plain unguaranteed update.  If bWantDelta is set, the next ack will
+	// ask the server to switch over.
+	void OnPlainUpdate(bool bWantDelta);
+
+	// Read the SMSG_DELTAUPDATE header.  Returns false if the packet is older than
+	// one we've already handled, in which case it should be ignored.
+	bool BeginSnapshot(CPacket_Read &cPacket);
+	// Read an object's position.  Returns false if the baseline is missing.
+	bool ReadPos(CPacket_Read &cPacket, uint16 nObjectID, CompWorldPos *pPos);
+	// Done with the snapshot.  Acks it if everything decoded and bComplete is set.
+	void EndSnapshot(bool bComplete);
+
+	// Is there anything to tell the server?
+	bool IsAckPending() const { return m_bAckPending; }
+	// Write the CMSG_SNAPSHOTACK body
+	void WriteAck(CPacket_Write &cPacket);
+
+private:
+	bool m_bHaveEpoch;
+	uint8 m_nEpoch;
+	uint16 m_nSnapshotID;
+	bool m_bSnapshotBad;
+
+	bool m_bHaveAck;
+	uint16 m_nAckNewest;
+	uint32 m_nAckMask;
+	bool m_bAckPending;
+
+	CSnapshotBaselines m_cBaselines;
+};
+
+#endif  // __SNAPSHOTDELTA_H__
@@ -0,0 +1,78 @@
+/*
+	Single-producer/single-consumer ring buffer
+	Notes :
+		- Exactly one thread may push and exactly one (other) thread may pop.
+			No locks are taken by either side.
+		- SIZE must be a power of two.  The ring holds SIZE - 1 entries.
+		- Entries are assigned on push and pop, and reset to a default value
+			on pop so the ring doesn't hold on to references.
+*/
+
+#ifndef __SPSCRING_H__
+#define __SPSCRING_H__
+
+#include "ltbasetypes.h"
+
+#include <atomic>
+
+template <class T, int SIZE>
+class CSPSCRing
+{
+public:
+	CSPSCRing() : m_nHead(0), m_nTail(0) {}
+
+	//////////////////////////////////////////////////////////////////////////////
+	// Information
+
+	// Is the ring empty?  (Only exact when called from the consumer)
+	bool empty() const { return m_nHead.load(std::memory_order_acquire) == m_nTail.load(std::memory_order_acquire); }
+	// Is the ring full?  (Only exact when called from the producer)
+	bool full() const { return _next(m_nTail.load(std::memory_order_relaxed)) == m_nHead.load(std::memory_order_acquire); }
+
+	//////////////////////////////////////////////////////////////////////////////
+	// Manipulation
+
+	// Producer side.  Returns false if the ring is full.
+	bool push(const T &cValue) {
+		uint32 nTail = m_nTail.load(std::memory_order_relaxed);
+		uint32 nNext = _next(nTail);
+		if (nNext == m_nHead.load(std::memory_order_acquire))
+			return false;
+		m_aRing[nTail] = cValue;
+		m_nTail.store(nNext, std::memory_order_release);
+		return true;
+	}
+	// Consumer side.  Returns false if the ring is empty.
+	bool pop(T &cValue) {
+		uint32 nHead = m_nHead.load(std::memory_order_relaxed);
+		if (nHead == m_nTail.load(std::memory_order_acquire))
+			return false;
+		cValue = m_aRing[nHead];
+		m_aRing[nHead] = T();
+		m_nHead.store(_next(nHead), std::memory_order_release);
+		return true;
+	}
+	// Consumer side.  Look at the next entry without removing it.
+	T *peek() {
+		uint32 nHead = m_nHead.load(std::memory_order_relaxed);
+		if (nHead == m_nTail.load(std::memory_order_acquire))
+			return 0;
+		return &m_aRing[nHead];
+	}
+
+private:
+	enum { k_nMask = SIZE - 1 };
+
+	static uint32 _next(uint32 nIndex) { return (nIndex + 1) & k_nMask; }
+
+	enum { k_nCacheLineSize = 64 };
+
+	T m_aRing[SIZE];
+	// Keep the indices on separate cache lines so the two threads don't fight over them
+	uint8 m_aPad0[k_nCacheLineSize];
+	std::atomic<uint32> m_nHead;
+	uint8 m_aPad1[k_nCacheLineSize - sizeof(std::atomic<uint32>)];
+	std::atomic<uint32> m_nTail;
+};
+
+#endif //__SPSCRING_H__
@@ -0,0 +1,185 @@
+
+#include "bdefs.h"
+#include "taskpool.h"
+
+
+CTaskPool::CTaskPool() :
+	m_pQueues(0),
+	m_nNumQueues(0),
+	m_nBatchID(0),
+	m_nBusyWorkers(0),
+	m_bShutdown(false),
+	m_pTaskFn(0),
+	m_pTaskUser(0),
+	m_nSteals(0)
+{
+}
+
+CTaskPool::~CTaskPool()
+{
+	Term();
+}
+
+bool CTaskPool::Init(uint32 nNumWorkers)
+{
+	Term();
+
+	m_nNumQueues = nNumWorkers + 1;
+	LT_MEM_TRACK_ALLOC(m_pQueues = new SQueue[m_nNumQueues], LT_MEM_TYPE_MISC);
+	for (uint32 nCurQueue = 0; nCurQueue < m_nNumQueues; ++nCurQueue)
+	{
+		m_pQueues[nCurQueue].m_nNext.store(0, std::memory_order_relaxed);
+		m_pQueues[nCurQueue].m_nEnd = 0;
+	}
+
+	m_bShutdown = false;
+	m_nBusyWorkers = 0;
+
+	m_aWorkers.reserve(nNumWorkers);
+	for (uint32 nCurWorker = 0; nCurWorker < nNumWorkers; ++nCurWorker)
+	{
+		m_aWorkers.push_back(std::thread(&CTaskPool::WorkerThread, this, nCurWorker + 1));
+	}
+
+	return true;
+}
+
+void CTaskPool::Term()
+{
+	if (!m_aWorkers.empty())
+	{
+		{
+			std::lock_guard<std::mutex> cLock(m_cMutex);
+			m_bShutdown = true;
+		}
+		m_cWakeEvent.notify_all();
+
+		for (uint32 nCurWorker = 0; nCurWorker < m_aWorkers.size(); ++nCurWorker)
+		{
+			m_aWorkers[nCurWorker].join();
+		}
+		m_aWorkers.clear();
+	}
+
+	delete [] m_pQueues;
+	m_pQueues = 0;
+	m_nNumQueues = 0;
+}
+
+void CTaskPool::Run(uint32 nNumTasks, TTaskFn pFn, void *pUser)
+{
+	if (!nNumTasks)
+		return;
+
+	// Don't bother waking anyone up if there's nobody else to do the work
+	if (m_aWorkers.empty() || (nNumTasks == 1))
+	{
+		for (uint32 nCurTask = 0; nCurTask < nNumTasks; ++nCurTask)
+			pFn(pUser, nCurTask);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> cLock(m_cMutex);
+
+		ASSERT(m_nBusyWorkers == 0);
+
+		// Hand out even shares
+		uint32 nCurTask = 0;
+		for (uint32 nCurQueue = 0; nCurQueue < m_nNumQueues; ++nCurQueue)
+		{
+			uint32 nShare = (nNumTasks - nCurTask) / (m_nNumQueues - nCurQueue);
+			m_pQueues[nCurQueue].m_nNext.store(nCurTask, std::memory_order_relaxed);
+			m_pQueues[nCurQueue].m_nEnd = nCurTask + nShare;
+			nCurTask += nShare;
+		}
+		ASSERT(nCurTask == nNumTasks);
+
+		m_pTaskFn = pFn;
+		m_pTaskUser = pUser;
+		m_nBusyWorkers = (uint32)m_aWorkers.size();
+		++m_nBatchID;
+	}
+	m_cWakeEvent.notify_all();
+
+	DoWork(0);
+
+	// Wait for the stragglers
+	std::unique_lock<std::mutex> cLock(m_cMutex);
+	while (m_nBusyWorkers)
+		m_cDoneEvent.wait(cLock);
+
+	m_pTaskFn = 0;
+	m_pTaskUser = 0;
+}
+
+uint32 CTaskPool::GetDefaultNumWorkers()
+{
+	uint32 nNumCores = std::thread::hardware_concurrency();
+	return (nNumCores > 1) ? (nNumCores - 1) : 0;
+}
+
+void CTaskPool::WorkerThread(uint32 nQueue)
+{
+	uint32 nLastBatchID = 0;
+
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> cLock(m_cMutex);
+			while (!m_bShutdown && (m_nBatchID == nLastBatchID))
+				m_cWakeEvent.wait(cLock);
+
+			if (m_bShutdown)
+				return;
+
+			nLastBatchID = m_nBatchID;
+		}
+
+		DoWork(nQueue);
+
+		bool bLastOne;
+		{
+			std::lock_guard<std::mutex> cLock(m_cMutex);
+			bLastOne = (--m_nBusyWorkers == 0);
+		}
+		if (bLastOne)
+			m_cDoneEvent.notify_one();
+	}
+}
+
+bool CTaskPool::ClaimTask(uint32 nQueue, uint32 *pTask)
+{
+	SQueue &cQueue = m_pQueues[nQueue];
+
+	// Don't bump the counter if it's already empty, so it can't run off the end
+	if (cQueue.m_nNext.load(std::memory_order_relaxed) >= cQueue.m_nEnd)
+		return false;
+
+	uint32 nTask = cQueue.m_nNext.fetch_add(1, std::memory_order_relaxed);
+	if (nTask >= cQueue.m_nEnd)
+		return false;
+
+	*pTask = nTask;
+	return true;
+}
+
+void CTaskPool::DoWork(uint32 nQueue)
+{
+	uint32 nTask;
+
+	// Do our own share first
+	while (ClaimTask(nQueue, &nTask))
+		m_pTaskFn(m_pTaskUser, nTask);
+
+	// Then help everyone else
+	for (uint32 nOffset = 1; nOffset < m_nNumQueues; ++nOffset)
+	{
+		uint32 nVictim = (nQueue + nOffset) % m_nNumQueues;
+		while (ClaimTask(nVictim, &nTask))
+		{
+			m_nSteals.fetch_add(1, std::memory_order_relaxed);
+			m_pTaskFn(m_pTaskUser, nTask);
+		}
+	}
+}
@@ -0,0 +1,80 @@
+// A pool of worker threads for running a batch of independent tasks in parallel.
+// Each thread is handed an even share of the batch, and threads which run out of
+// work take tasks from the other threads' shares.  The thread calling Run() works
+// on the batch too, and Run() doesn't return until the whole batch is done.
+
+#ifndef __TASKPOOL_H__
+#define __TASKPOOL_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class CTaskPool
+{
+public:
+	// Task callback.  nTask is the index of the task in the batch.
+	typedef void (*TTaskFn)(void *pUser, uint32 nTask);
+
+	CTaskPool();
+	~CTaskPool();
+
+	// Start up the worker threads.  With 0 workers, Run() does everything on
+	// the calling thread.
+	bool	Init(uint32 nNumWorkers);
+	void	Term();
+
+	uint32	GetNumWorkers() const { return (uint32)m_aWorkers.size(); }
+
+	// Calls pFn(pUser, nTask) for each nTask in [0, nNumTasks), in no particular
+	// order and on any of the pool's threads.  Must not be called from a task.
+	void	Run(uint32 nNumTasks, TTaskFn pFn, void *pUser);
+
+	// Number of tasks which were run by a thread other than the one they were handed to
+	uint32	GetNumSteals() const { return m_nSteals.load(std::memory_order_relaxed); }
+	void	ResetNumSteals() { m_nSteals.store(0, std::memory_order_relaxed); }
+
+	// Number of workers to use if nobody has a better idea (one less than the number of cores)
+	static uint32 GetDefaultNumWorkers();
+
+private:
+	enum { k_nCacheLineSize = 64 };
+
+	// One thread's share of the batch.  Tasks are claimed by bumping m_nNext,
+	// by the owner and thieves alike.
+	struct SQueue
+	{
+		std::atomic<uint32> m_nNext;
+		uint32 m_nEnd;
+		// Keep the queues from sharing cache lines
+		uint8 m_aPad[k_nCacheLineSize - sizeof(std::atomic<uint32>) - sizeof(uint32)];
+	};
+
+	void	WorkerThread(uint32 nQueue);
+	// Run tasks from queue nQueue, then from everyone else's
+	void	DoWork(uint32 nQueue);
+	bool	ClaimTask(uint32 nQueue, uint32 *pTask);
+
+	std::vector<std::thread> m_aWorkers;
+	// One queue per worker, plus one for the thread calling Run()
+	SQueue *m_pQueues;
+	uint32 m_nNumQueues;
+
+	std::mutex m_cMutex;
+	std::condition_variable m_cWakeEvent;
+	std::condition_variable m_cDoneEvent;
+	// Bumped each time a batch starts
+	uint32 m_nBatchID;
+	// Workers still working on the current batch
+	uint32 m_nBusyWorkers;
+	bool m_bShutdown;
+
+	TTaskFn m_pTaskFn;
+	void *m_pTaskUser;
+
+	std::atomic<uint32> m_nSteals;
+};
+
+#endif  // __TASKPOOL_H__
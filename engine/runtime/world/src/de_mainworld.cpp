@@ -25,6 +25,8 @@
      #include "renderstruct.h"
 #endif
 
+#include <vector>
+
 //------------------------------------------------------------------
 //------------------------------------------------------------------
 // Holders and their headers.
@@ -148,6 +150,9 @@ void w_TransformWorldModel(WorldModelInstance *pInst, LTMatrix *pMat, bool bPart
 
         MatVMul(&pDest->m_Polies[i]->GetCenter(), pMat, &pSrc->m_Polies[i]->GetCenter());
     }
+
+	// The flat nodes have their own copies of the planes.
+	pDest->UpdateFlatPlanes();
 }
 
 
@@ -276,6 +281,11 @@ void WorldBsp::Clear()
 
     m_PolyData = NULL;
     m_PolyDataSize = 0;
+
+    m_FlatPlanes = NULL;
+    m_FlatSides = NULL;
+    m_FlatNodes = NULL;
+    m_nFlatNodes = 0;
     
     m_WorldInfoFlags = 0;
 
@@ -292,6 +302,10 @@ void WorldBsp::Term()
     dfree(m_Planes);
     delete [] m_Surfaces;
     delete [] m_Nodes;
+
+    dfree(m_FlatPlanes);
+    dfree(m_FlatSides);
+    dfree(m_FlatNodes);
     
     dfree(m_TextureNames);
     dfree(m_TextureNameData);
@@ -366,14 +380,28 @@ struct SDiskPoly
 	uint32	m_nVerts[MAX_WORLDPOLY_VERTS];
 };
 
+struct SDiskNode
+{
+	//the size of a node on disk (the poly, the leaf, then the two sides)
+	enum { k_nSize = sizeof(uint32) + sizeof(uint16) + sizeof(int32) * 2 };
+
+	//the nodes are packed, so they're copied out of the block they were read into
+	void Unpack(const uint8 *pData)
+	{
+		memcpy(&m_nPoly, pData, sizeof(m_nPoly));
+		memcpy(m_nSides, &pData[sizeof(uint32) + sizeof(uint16)], sizeof(m_nSides));
+	}
+
+	uint32	m_nPoly;
+	int32	m_nSides[2];
+};
+
 ELoadWorldStatus WorldBsp::Load(ILTStream *pStream, bool bUsePlaneTypes) 
 {
     uint32 i, k;
-    uint16 wLeaf;
 
     uint32 curVert, nLeafs;
     uint32 nPoints, nPolies, nVerts, totalVisListSize;
-    uint32 poliesStartPos;
     uint32 poliesSize;
     
     uint32 curPos;
@@ -429,34 +457,49 @@ ELoadWorldStatus WorldBsp::Load(ILTStream *pStream, bool bUsePlaneTypes)
     LT_MEM_TRACK_ALLOC(m_TextureNameData = (char*)dalloc_z(nNamesLen),LT_MEM_TYPE_WORLD);
     LT_MEM_TRACK_ALLOC(m_TextureNames = (char**)dalloc_z(sizeof(char*) * nTextures),LT_MEM_TYPE_WORLD);
 
+	// The names are read in one block and split up afterwards.  nNamesLen is
+	// the size of the buffer, which can be more than the names take up, so
+	// back up to the end of the last name when it's done.
+	uint32 namesStartPos;
+	pStream->GetPos(&namesStartPos);
+	pStream->Read(m_TextureNameData, nNamesLen);
+
     curPos = 0;
     for (i=0; i < nTextures; i++)
     {
         m_TextureNames[i] = &m_TextureNameData[curPos];
         for (;;)
         {
-            STREAM_READ(m_TextureNameData[curPos]);
+			if (curPos >= nNamesLen)
+				return LoadWorld_InvalidFile;
+
             curPos++;
             if (m_TextureNameData[curPos-1] == 0)
                 break;
         }
     }
+
+	if (curPos != nNamesLen)
+	{
+		memset(&m_TextureNameData[curPos], 0, nNamesLen - curPos);
+		pStream->SeekTo(namesStartPos + curPos);
+	}
 	
-    // Figure out how much space to allocate for the polygon buffers.
-    poliesSize = 0;
-    pStream->GetPos(&poliesStartPos);
+    // Read in the vertex counts so it can figure out how much space to allocate
+	// for the polygon buffers and do structure alignment.
+	std::vector<uint8> aVertexCounts(nPolies);
+	if (nPolies)
+		pStream->Read(&aVertexCounts[0], nPolies);
 
-    // Read in the initial structure sizes so it can do structure alignment.    
+    poliesSize = 0;
 	for (i=0; i < nPolies; i++) 
 	{
-		STREAM_READ(nVertices);
+		nVertices = aVertexCounts[i];
 
 		poliesSize += WORLDPOLY_SIZE(nVertices);
 		poliesSize = ALIGN_MEMORY(poliesSize); 
 	}
 
-    pStream->SeekTo(poliesStartPos);
-
     // (Try to) allocate all the data.
     m_PolyDataSize = poliesSize;
 
@@ -489,7 +532,7 @@ ELoadWorldStatus WorldBsp::Load(ILTStream *pStream, bool bUsePlaneTypes)
     curPos = 0;
     for (i=0; i < nPolies; i++) 
 	{
-        STREAM_READ(nVertices);
+        nVertices = aVertexCounts[i];
 
         pPoly = (WorldPoly*)(&m_PolyData[curPos]);
         pPoly->SetIndex(i);
@@ -534,10 +577,13 @@ ELoadWorldStatus WorldBsp::Load(ILTStream *pStream, bool bUsePlaneTypes)
 	pStream->Read(m_Planes, sizeof(LTPlane) * nPlanes);
 
     // Read in the surfaces.
-	SDiskSurface DiskSurface;
+	std::vector<SDiskSurface> aDiskSurfaces(nSurfaces);
+	if (nSurfaces)
+		pStream->Read(&aDiskSurfaces[0], sizeof(SDiskSurface) * nSurfaces);
+
     for (i=0; i < nSurfaces; i++)
     {
-		pStream->Read(&DiskSurface, sizeof(DiskSurface));
+		const SDiskSurface &DiskSurface = aDiskSurfaces[i];
 
 		m_Surfaces[i].m_pTexture		= NULL;
         m_Surfaces[i].m_Flags			= DiskSurface.m_nFlags;
@@ -545,14 +591,22 @@ ELoadWorldStatus WorldBsp::Load(ILTStream *pStream, bool bUsePlaneTypes)
         m_Surfaces[i].m_TextureFlags	= DiskSurface.m_nTextureFlags;
     }
 
-    // Read in all the polies.
-	SDiskPoly DiskPoly;
+    // Read in all the polies in one block.
+	uint32 nDiskPolySize = 0;
+	for (i=0; i < nPolies; i++)
+		nDiskPolySize += SDiskPoly::CalcPolyReadSize(m_Polies[i]->GetNumVertices());
+
+	std::vector<uint32> aDiskPolies(nDiskPolySize / sizeof(uint32));
+	if (nDiskPolySize)
+		pStream->Read(&aDiskPolies[0], nDiskPolySize);
+
+	const uint32 *pDiskPoly = aDiskPolies.empty() ? NULL : &aDiskPolies[0];
     for (i=0; i < nPolies; i++)
     {
         pPoly = m_Polies[i];
 
-		//read in our polygon from disk
-		pStream->Read(&DiskPoly, SDiskPoly::CalcPolyReadSize(pPoly->GetNumVertices()));
+		const SDiskPoly &DiskPoly = *(const SDiskPoly*)pDiskPoly;
+		pDiskPoly += SDiskPoly::CalcPolyReadSize(pPoly->GetNumVertices()) / sizeof(uint32);
 
         if (DiskPoly.m_nSurface >= m_nSurfaces) 
             return LoadWorld_InvalidFile; 
@@ -564,7 +618,7 @@ ELoadWorldStatus WorldBsp::Load(ILTStream *pStream, bool bUsePlaneTypes)
         pPoly->SetSurface(&m_Surfaces[DiskPoly.m_nSurface]);
 		pPoly->SetPlane(&m_Planes[DiskPoly.m_nPlane]);
         
-        // Read in the list of indices.
+        // Hook up the vertices.
 		for (k=0; k < pPoly->GetNumVertices(); k++) 
 		{
 			if (DiskPoly.m_nVerts[k] >= m_nPoints) 
@@ -574,14 +628,19 @@ ELoadWorldStatus WorldBsp::Load(ILTStream *pStream, bool bUsePlaneTypes)
 		} 
 	}
 
-    // Read nodes.
-	uint32 nNodeIndices[2];
+    // Read nodes, also in one block.
+	std::vector<uint8> aDiskNodes(m_nNodes * SDiskNode::k_nSize);
+	if (m_nNodes)
+		pStream->Read(&aDiskNodes[0], m_nNodes * SDiskNode::k_nSize);
 
     for (i=0; i < m_nNodes; i++)
     {
         pNode = &m_Nodes[i];
+
+		SDiskNode DiskNode;
+		DiskNode.Unpack(&aDiskNodes[i * SDiskNode::k_nSize]);
         
-        STREAM_READ(iPoly);
+        iPoly = DiskNode.m_nPoly;
         if (iPoly >= m_nPolies)
         {
             return LoadWorld_InvalidFile;
@@ -591,12 +650,9 @@ ELoadWorldStatus WorldBsp::Load(ILTStream *pStream, bool bUsePlaneTypes)
 		pNode->m_Flags		= 0;
 		pNode->m_PlaneType	= 0;
 
-        STREAM_READ(wLeaf);
-        STREAM_READ(nNodeIndices);
-
         for (j=0; j < 2; j++)
         {
-            pNode->m_Sides[j] = w_NodeForIndex(m_Nodes, m_nNodes, nNodeIndices[j]);
+            pNode->m_Sides[j] = w_NodeForIndex(m_Nodes, m_nNodes, DiskNode.m_nSides[j]);
             if (!pNode->m_Sides[j])
             {
                 return LoadWorld_InvalidFile;
@@ -632,11 +688,81 @@ ELoadWorldStatus WorldBsp::Load(ILTStream *pStream, bool bUsePlaneTypes)
         return LoadWorld_InvalidFile;
     }
 
+	BuildFlatNodes();
+
     g_WorldGeometryMemory += m_MemoryUse;
 
     return LoadWorld_Ok;
 }
 
+void WorldBsp::BuildFlatNodes()
+{
+	if (!m_RootNode || (m_RootNode->m_Flags & (NF_IN|NF_OUT)))
+		return;
+
+	// Number the nodes depth first, front sides first, so a node's front
+	// side usually sits right after it.
+	std::vector<int32> aFlatIndex(m_nNodes, -1);
+	std::vector<const Node*> aOrder;
+	std::vector<const Node*> aStack;
+
+	aOrder.reserve(m_nNodes);
+	aStack.push_back(m_RootNode);
+	while (!aStack.empty())
+	{
+		const Node *pNode = aStack.back();
+		aStack.pop_back();
+
+		uint32 nIndex = (uint32)(pNode - m_Nodes);
+		if (aFlatIndex[nIndex] != -1)
+			continue;
+
+		aFlatIndex[nIndex] = (int32)aOrder.size();
+		aOrder.push_back(pNode);
+
+		// The front side goes on last so it comes off next
+		if (!(pNode->m_Sides[BackSide]->m_Flags & (NF_IN|NF_OUT)))
+			aStack.push_back(pNode->m_Sides[BackSide]);
+		if (!(pNode->m_Sides[FrontSide]->m_Flags & (NF_IN|NF_OUT)))
+			aStack.push_back(pNode->m_Sides[FrontSide]);
+	}
+
+	m_nFlatNodes = (uint32)aOrder.size();
+
+    LT_MEM_TRACK_ALLOC(m_FlatPlanes = (LTPlane*)dalloc(sizeof(LTPlane) * m_nFlatNodes),LT_MEM_TYPE_WORLD);
+    LT_MEM_TRACK_ALLOC(m_FlatSides = (int32*)dalloc(sizeof(int32) * 2 * m_nFlatNodes),LT_MEM_TYPE_WORLD);
+    LT_MEM_TRACK_ALLOC(m_FlatNodes = (const Node**)dalloc(sizeof(Node*) * m_nFlatNodes),LT_MEM_TYPE_WORLD);
+
+	m_MemoryUse += (sizeof(LTPlane) + sizeof(int32) * 2 + sizeof(Node*)) * m_nFlatNodes;
+
+	for (uint32 i=0; i < m_nFlatNodes; i++)
+	{
+		const Node *pNode = aOrder[i];
+
+		m_FlatNodes[i] = pNode;
+		m_FlatPlanes[i] = *pNode->GetPlane();
+
+		for (uint32 nSide=0; nSide < 2; nSide++)
+		{
+			const Node *pSide = pNode->m_Sides[nSide];
+			if (pSide->m_Flags & NF_IN)
+				m_FlatSides[i * 2 + nSide] = FLATNODE_IN;
+			else if (pSide->m_Flags & NF_OUT)
+				m_FlatSides[i * 2 + nSide] = FLATNODE_OUT;
+			else
+				m_FlatSides[i * 2 + nSide] = aFlatIndex[pSide - m_Nodes];
+		}
+	}
+}
+
+void WorldBsp::UpdateFlatPlanes()
+{
+	for (uint32 i=0; i < m_nFlatNodes; i++)
+	{
+		m_FlatPlanes[i] = *m_FlatNodes[i]->GetPlane();
+	}
+}
+
 void WorldBsp::CalcBoundingSpheres() 
 {
     uint32 i, j;
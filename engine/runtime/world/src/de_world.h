@@ -53,6 +53,10 @@ class VisitPVSRequest;
 #define NF_IN           1
 #define NF_OUT          2   
 
+// Special indices in WorldBsp::m_FlatSides.
+#define FLATNODE_IN     -1
+#define FLATNODE_OUT    -2
+
 #define MAX_WORLDNAME_LEN       64
 
 // Surface flags.
@@ -393,6 +397,12 @@ public:
     //Client ONLY.
     void			SetPolyTexturePointers();
 
+    //builds the flat copy of the node tree.  Called by Load.
+    void			BuildFlatNodes();
+
+    //copies the planes into the flat nodes again after they've been transformed.
+    void			UpdateFlatPlanes();
+
 public:
 
 	// Get WIF_ flags.
@@ -401,6 +411,9 @@ public:
 	//Retreives the root node of the BSP
     const Node*     GetRootNode() const				{ return m_RootNode; }
 
+	//Does it have the flat copy of the node tree?  The root is flat node 0.
+    bool            HasFlatNodes() const			{ return m_nFlatNodes != 0; }
+
     // Setup an HPOLY given a Node.  Returns INVALID_HPOLY if the Node doesn't come from
     // this world.
     HPOLY           MakeHPoly(const Node *pNode) const;
@@ -446,6 +459,16 @@ public:
     char            *m_PolyData;        // Data blocks
     uint32          m_PolyDataSize;
 
+    // The nodes reachable from the root again as flat arrays, numbered depth
+    // first so walking down the tree mostly moves forward through memory.
+    // Flat node i has the plane m_FlatPlanes[i], the sides m_FlatSides[i*2] and
+    // m_FlatSides[i*2+1] (FLATNODE_IN/OUT for the special nodes), and came from
+    // m_FlatNodes[i].  The line intersection code uses these.
+    LTPlane         *m_FlatPlanes;
+    int32           *m_FlatSides;
+    const Node      **m_FlatNodes;
+    uint32          m_nFlatNodes;
+
     char            m_WorldName[MAX_WORLDNAME_LEN+1];   // Name of this world.
 };
 
@@ -43,6 +43,76 @@ static LTVector g_V, g_VTimesInvVV, g_VOrigin, g_VDir;
 static float g_VPTimesInvVV, g_LineLen;
 
 
+// Everything above for one query, so i_IntersectSegments can switch between
+// the queries it's working on.
+struct SIntersectState
+{
+	void Save()
+	{
+		m_FindIntersectionsFn				= g_FindIntersectionsFn;
+		m_pCurQuery							= g_pCurQuery;
+		m_bProcessNonSolid					= g_bProcessNonSolid;
+		m_bProcessObjects					= g_bProcessObjects;
+		m_bCheckIfFromPointIsInsideObject	= g_bCheckIfFromPointIsInsideObject;
+		m_bProcessModelObbs					= g_bProcessModelObbs;
+		m_pWorldIntersection				= g_pWorldIntersection;
+		m_pIntersection						= g_pIntersection;
+		m_IntersectionBestDistSqr			= g_IntersectionBestDistSqr;
+		m_IntersectionPlane					= g_IntersectionPlane;
+		m_IntersectionPos					= g_IntersectionPos;
+		m_hWorldPoly						= g_hWorldPoly;
+		m_hModelNode						= g_hModelNode;
+		m_V									= g_V;
+		m_VTimesInvVV						= g_VTimesInvVV;
+		m_VOrigin							= g_VOrigin;
+		m_VDir								= g_VDir;
+		m_VPTimesInvVV						= g_VPTimesInvVV;
+		m_LineLen							= g_LineLen;
+	}
+
+	void Restore() const
+	{
+		g_FindIntersectionsFn				= m_FindIntersectionsFn;
+		g_pCurQuery							= m_pCurQuery;
+		g_bProcessNonSolid					= m_bProcessNonSolid;
+		g_bProcessObjects					= m_bProcessObjects;
+		g_bCheckIfFromPointIsInsideObject	= m_bCheckIfFromPointIsInsideObject;
+		g_bProcessModelObbs					= m_bProcessModelObbs;
+		g_pWorldIntersection				= m_pWorldIntersection;
+		g_pIntersection						= m_pIntersection;
+		g_IntersectionBestDistSqr			= m_IntersectionBestDistSqr;
+		g_IntersectionPlane					= m_IntersectionPlane;
+		g_IntersectionPos					= m_IntersectionPos;
+		g_hWorldPoly						= m_hWorldPoly;
+		g_hModelNode						= m_hModelNode;
+		g_V									= m_V;
+		g_VTimesInvVV						= m_VTimesInvVV;
+		g_VOrigin							= m_VOrigin;
+		g_VDir								= m_VDir;
+		g_VPTimesInvVV						= m_VPTimesInvVV;
+		g_LineLen							= m_LineLen;
+	}
+
+	void (*m_FindIntersectionsFn)(const WorldBsp *pWorldBsp, const Node **pNodeIntersectionPtr, 
+		LTVector *pIntersectionPosPtr, float *pDistSqrPtr, HPOLY *hWorldPoly,
+		LTVector *pPoint1, LTVector *pPoint2, uint8 bWorldModel);
+	IntersectQuery	*m_pCurQuery;
+	uint8			m_bProcessNonSolid;
+	uint8			m_bProcessObjects;
+	uint8			m_bCheckIfFromPointIsInsideObject;
+	uint8			m_bProcessModelObbs;
+	const Node		*m_pWorldIntersection;
+	LTObject		*m_pIntersection;
+	float			m_IntersectionBestDistSqr;
+	LTPlane			m_IntersectionPlane;
+	LTVector		m_IntersectionPos;
+	HPOLY			m_hWorldPoly;
+	HMODELNODE		m_hModelNode;
+	LTVector		m_V, m_VTimesInvVV, m_VOrigin, m_VDir;
+	float			m_VPTimesInvVV, m_LineLen;
+};
+
+
 
 
 // Get the intersection point and see if it's inside the other dimensions.
@@ -604,7 +674,7 @@ static void i_FindIntersections(const WorldBsp *pWorldBsp, const Node **pNodeInt
 
 
     *hWorldPoly = INVALID_HPOLY;
-    *pNodeIntersectionPtr = IntersectLine(pWorldBsp->GetRootNode(), pPoint1, pPoint2, pIntersectionPosPtr, &iPlane);
+    *pNodeIntersectionPtr = IntersectLine(pWorldBsp, pPoint1, pPoint2, pIntersectionPosPtr, &iPlane);
     if (*pNodeIntersectionPtr) 
 	{
         *pDistSqrPtr = pPoint1->DistSqr(*pIntersectionPosPtr);
@@ -637,13 +707,11 @@ static bool i_ISCallback(WorldTreeObj *pObj, void *pCBUser)
 }       
 
 
-bool i_IntersectSegment(IntersectQuery *pQuery, IntersectInfo *pInfo, WorldTree *pWorldTree)
+// Sets up the globals for a query.  Returns false if the segment is too short to test.
+static bool i_BeginQuery(IntersectQuery *pQuery)
 {
     float InvVV, VP, testMag;
 
-    ++g_nIntersectCalls;
-	CountAdder cTicks_Intersect(&g_Ticks_Intersect);
-        
     // Init..
     g_pCurQuery = pQuery;
     g_pIntersection = LTNULL;
@@ -687,9 +755,12 @@ bool i_IntersectSegment(IntersectQuery *pQuery, IntersectInfo *pInfo, WorldTree
         g_FindIntersectionsFn = i_FindIntersections;
     }
 
-    // Start at the world tree.
-    pWorldTree->IntersectSegment((LTVector*)&pQuery->m_From, (LTVector*)&pQuery->m_To, i_ISCallback, LTNULL);
+	return true;
+}
 
+// Fills in pInfo from the globals once the query's been run.
+static bool i_EndQuery(IntersectInfo *pInfo)
+{
     // If an object was hit, use it!
     if (g_pIntersection) 
 	{
@@ -716,3 +787,91 @@ bool i_IntersectSegment(IntersectQuery *pQuery, IntersectInfo *pInfo, WorldTree
     }
 }
 
+
+bool i_IntersectSegment(IntersectQuery *pQuery, IntersectInfo *pInfo, WorldTree *pWorldTree)
+{
+    ++g_nIntersectCalls;
+	CountAdder cTicks_Intersect(&g_Ticks_Intersect);
+
+	if (!i_BeginQuery(pQuery))
+		return false;
+
+    // Start at the world tree.
+    pWorldTree->IntersectSegment((LTVector*)&pQuery->m_From, (LTVector*)&pQuery->m_To, i_ISCallback, LTNULL);
+
+	return i_EndQuery(pInfo);
+}
+
+
+// The queries i_IntersectSegments is working on.
+struct SIntersectPacket
+{
+	SIntersectState	m_aStates[MAX_IS_PACKET_SEGMENTS];
+};
+
+// Called by the WorldTree in IntersectSegments.  Runs each of the segments
+// that got to the object through the same test i_IntersectSegment does.
+static void i_ISPacketCallback(WorldTreeObj *pObj, uint32 nSegmentMask, void *pCBUser)
+{
+	SIntersectPacket *pPacket = (SIntersectPacket*)pCBUser;
+
+	for (uint32 iSegment = 0; iSegment < MAX_IS_PACKET_SEGMENTS; ++iSegment)
+	{
+		if (!(nSegmentMask & ((uint32)1 << iSegment)))
+			continue;
+
+		SIntersectState &cState = pPacket->m_aStates[iSegment];
+		cState.Restore();
+		i_ISCallback(pObj, LTNULL);
+		cState.Save();
+	}
+}
+
+uint32 i_IntersectSegments(IntersectQuery *pQueries, IntersectInfo *pInfos, uint32 nQueries, WorldTree *pWorldTree)
+{
+	CountAdder cTicks_Intersect(&g_Ticks_Intersect);
+
+	SIntersectPacket cPacket;
+	LTVector aPts[MAX_IS_PACKET_SEGMENTS * 2];
+	uint32 nHits = 0;
+
+	for (uint32 nPacketStart = 0; nPacketStart < nQueries; nPacketStart += MAX_IS_PACKET_SEGMENTS)
+	{
+		uint32 nPacketSize = LTMIN(nQueries - nPacketStart, MAX_IS_PACKET_SEGMENTS);
+
+		// Set up all the queries in the packet
+		uint32 nSegmentMask = 0;
+		for (uint32 iSegment = 0; iSegment < nPacketSize; ++iSegment)
+		{
+			IntersectQuery *pQuery = &pQueries[nPacketStart + iSegment];
+
+			++g_nIntersectCalls;
+			pInfos[nPacketStart + iSegment].m_hObject = LTNULL;
+
+			if (!i_BeginQuery(pQuery))
+				continue;
+
+			cPacket.m_aStates[iSegment].Save();
+			aPts[iSegment * 2] = pQuery->m_From;
+			aPts[iSegment * 2 + 1] = pQuery->m_To;
+			nSegmentMask |= (uint32)1 << iSegment;
+		}
+
+		// Walk the tree once for all of them
+		pWorldTree->IntersectSegments(aPts, nSegmentMask, i_ISPacketCallback, &cPacket);
+
+		// And get the results
+		for (uint32 iSegment = 0; iSegment < nPacketSize; ++iSegment)
+		{
+			if (!(nSegmentMask & ((uint32)1 << iSegment)))
+				continue;
+
+			cPacket.m_aStates[iSegment].Restore();
+			if (i_EndQuery(&pInfos[nPacketStart + iSegment]))
+				++nHits;
+		}
+	}
+
+	return nHits;
+}
+
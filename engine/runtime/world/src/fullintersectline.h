@@ -7,6 +7,12 @@ bool i_BoundingBoxTest(const LTVector& Point1, const LTVector& Point2, const LTO
     LTVector *pIntersectPt, LTPlane *pIntersectPlane);
 bool i_IntersectSegment(IntersectQuery* pQuery, IntersectInfo *pInfo, WorldTree* pWorldTree);
 
+// Runs nQueries queries at once, sharing one walk of the WorldTree between up to
+// MAX_IS_PACKET_SEGMENTS of them at a time.  The results are the same as calling
+// i_IntersectSegment on each one, except pInfos[i].m_hObject is set to LTNULL
+// for the ones that didn't hit anything.  Returns how many hit something.
+uint32 i_IntersectSegments(IntersectQuery *pQueries, IntersectInfo *pInfos, uint32 nQueries, WorldTree *pWorldTree);
+
 #endif
 
 
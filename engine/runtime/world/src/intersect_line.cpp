@@ -51,8 +51,39 @@ inline LTBOOL InsideConvex(WorldPoly *pPoly, LTVector *pPt)
 	return LTTRUE;
 }
 
+// Walks the tree through the Nodes themselves.
+class CNodeWalker
+{
+public:
+	typedef const Node *TNode;
+
+	bool			IsLeaf(TNode pNode) const				{ return (pNode->m_Flags & (NF_IN|NF_OUT)) != 0; }
+	const LTPlane*	GetPlane(TNode pNode) const				{ return pNode->GetPlane(); }
+	TNode			GetSide(TNode pNode, int nSide) const	{ return pNode->m_Sides[nSide]; }
+	const Node*		GetNode(TNode pNode) const				{ return pNode; }
+};
+
+// Walks the tree through a WorldBsp's flat nodes.
+class CFlatNodeWalker
+{
+public:
+	typedef int32 TNode;
+
+	CFlatNodeWalker(const WorldBsp *pWorldBsp) : m_pWorldBsp(pWorldBsp) {}
+
+	bool			IsLeaf(TNode nNode) const				{ return nNode < 0; }
+	const LTPlane*	GetPlane(TNode nNode) const				{ return &m_pWorldBsp->m_FlatPlanes[nNode]; }
+	TNode			GetSide(TNode nNode, int nSide) const	{ return m_pWorldBsp->m_FlatSides[nNode * 2 + nSide]; }
+	const Node*		GetNode(TNode nNode) const				{ return m_pWorldBsp->m_FlatNodes[nNode]; }
+
+private:
+	const WorldBsp	*m_pWorldBsp;
+};
+
+template <class TWalker>
 LTBOOL InternalIntersectLineNode(
-	const Node *pRoot,
+	const TWalker &cWalker,
+	typename TWalker::TNode pRoot,
 	IntersectRequest *pRequest,
 	LTVector point1,
 	const LTVector& point2)
@@ -62,20 +93,21 @@ LTBOOL InternalIntersectLineNode(
 	float dot1, dot2;
 	int side1;
 
-	while((pRoot->m_Flags & (NF_IN|NF_OUT)) == 0)
+	while(!cWalker.IsLeaf(pRoot))
 	{
 		// Go into the correct side.
-		dot1 = pRoot->GetPlane()->DistTo(point1);
-		dot2 = pRoot->GetPlane()->DistTo(point2);
+		const LTPlane *pPlane = cWalker.GetPlane(pRoot);
+		dot1 = pPlane->DistTo(point1);
+		dot2 = pPlane->DistTo(point2);
 
 		// Handle the segment being entirely on one side of the plane
 		if(dot1 > INTERSECT_EPSILON && dot2 > INTERSECT_EPSILON)
 		{
-			pRoot = pRoot->m_Sides[FrontSide];
+			pRoot = cWalker.GetSide(pRoot, FrontSide);
 		}
 		else if(dot1 < -INTERSECT_EPSILON && dot2 < -INTERSECT_EPSILON)
 		{
-			pRoot = pRoot->m_Sides[BackSide];
+			pRoot = cWalker.GetSide(pRoot, BackSide);
 		}
 		else
 		{
@@ -101,7 +133,8 @@ LTBOOL InternalIntersectLineNode(
 				VEC_LERP(iPoint, point1, point2, fBackSideT);
 				// Test the side the starting point is on.
 				if (InternalIntersectLineNode(
-					pRoot->m_Sides[side1], 
+					cWalker,
+					cWalker.GetSide(pRoot, side1), 
 					pRequest,
 					point1,
 					bOnPlane ? point2 : iPoint))
@@ -111,17 +144,18 @@ LTBOOL InternalIntersectLineNode(
 			}
 
 			// Check for a polygon intersection
-			if((side1 == FrontSide) && (pRoot->m_pPoly))
+			const Node *pNode = cWalker.GetNode(pRoot);
+			if((side1 == FrontSide) && (pNode->m_pPoly))
 			{
 				VEC_LERP(iPoint, point1, point2, intersection_t);
-				if(InsideConvex(pRoot->m_pPoly, &iPoint))
+				if(InsideConvex(pNode->m_pPoly, &iPoint))
 				{
 					LTBOOL bDone = LTTRUE;
 
 					IntersectQuery* pQuery = pRequest->m_pQuery;
 					if (pQuery && pQuery->m_PolyFilterFn && pRequest->m_pWorldBsp)
 					{
-						if (!pQuery->m_PolyFilterFn(pRequest->m_pWorldBsp->MakeHPoly(pRoot), pQuery->m_pUserData))
+						if (!pQuery->m_PolyFilterFn(pRequest->m_pWorldBsp->MakeHPoly(pNode), pQuery->m_pUserData))
 						{
 							bDone = LTFALSE;
 						}
@@ -130,7 +164,7 @@ LTBOOL InternalIntersectLineNode(
 					if (bDone)
 					{
 						// Congratulations, we have a winner!
-						pRequest->m_pNodeHit = pRoot;
+						pRequest->m_pNodeHit = pNode;
 						*pRequest->m_pIPos = iPoint;
 						return LTTRUE;
 					}
@@ -147,7 +181,7 @@ LTBOOL InternalIntersectLineNode(
 			point1 = iPoint;
 
 			// Go into the other side.
-			pRoot = pRoot->m_Sides[!side1];
+			pRoot = cWalker.GetSide(pRoot, !side1);
 		}
 	}
 
@@ -159,7 +193,21 @@ LTBOOL IntersectLineNode(
 	const Node *pRoot,
 	IntersectRequest *pRequest)
 {
+	// Use the flat nodes if it's starting at the top of a world that has them
+	const WorldBsp *pWorldBsp = pRequest->m_pWorldBsp;
+	if (pWorldBsp && pWorldBsp->HasFlatNodes() && (pRoot == pWorldBsp->GetRootNode()))
+	{
+		return InternalIntersectLineNode(
+			CFlatNodeWalker(pWorldBsp),
+			0,
+			pRequest,
+			*pRequest->m_pPoints[0],
+			*pRequest->m_pPoints[1]
+			);
+	}
+
 	return InternalIntersectLineNode(
+		CNodeWalker(),
 		pRoot,
 		pRequest,
 		*pRequest->m_pPoints[0],
@@ -184,3 +232,22 @@ const Node* IntersectLine(const Node *pRoot, LTVector *pPoint1, LTVector *pPoint
 
 	return LTNULL;
 }
+
+
+const Node* IntersectLine(const WorldBsp *pWorldBsp, LTVector *pPoint1, LTVector *pPoint2, LTVector *pIPos, LTPlane *pIPlane)
+{
+	IntersectRequest req;
+
+	req.m_pPoints[0] = pPoint1;
+	req.m_pPoints[1] = pPoint2;
+	req.m_pIPos = pIPos;
+	req.m_pWorldBsp = pWorldBsp;
+
+	if( IntersectLineNode( pWorldBsp->GetRootNode(), &req ) )
+	{
+		*pIPlane = *req.m_pNodeHit->GetPlane();
+		return req.m_pNodeHit;
+	}
+
+	return LTNULL;
+}
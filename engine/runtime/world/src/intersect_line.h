@@ -39,6 +39,11 @@ public:
 const Node* IntersectLine(const Node *pRoot, LTVector *pPoint1, LTVector *pPoint2, 
     LTVector *pIPos, LTPlane *pIPlane);
 
+// Same as above, starting at the root of pWorldBsp.  This uses the world's flat
+// nodes, which is quicker than walking the Nodes.
+const Node* IntersectLine(const WorldBsp *pWorldBsp, LTVector *pPoint1, LTVector *pPoint2, 
+    LTVector *pIPos, LTPlane *pIPlane);
+
 // This version returns the node that the line segment hit but is MUCH slower
 // than IntersectLine.  Only use it as a last resort.
 LTBOOL IntersectLineNode(const Node *pRoot, IntersectRequest *pRequest);
@@ -4,11 +4,17 @@
 
 #include "world_blocker_math.h"
 
+#include "framearena.h"
+
 #include <vector>
+#include <algorithm>
 
 // Some base-type vectors
 typedef std::vector<LTVector> TVectorList;
-typedef std::vector<int> TIntList;
+
+// Scratch lists for a single query, which live on the frame arena
+typedef CFrameArenaVector<int> TIntList;
+typedef CFrameArenaVector<LTVector> TScratchVectorList;
 
 struct CBlockerPoly
 {
@@ -259,11 +265,51 @@ public:
 		LTVector *pNormal // Normal of first intersection
 		);
 
+	virtual uint32 IntersectPacket(
+		const SSweep *pSweeps, // Movements to test
+		SSweepResult *pResults, // One result per sweep
+		uint32 nNumSweeps // Number of sweeps
+		);
+
 private:
 	typedef std::vector<CBlockerPoly> TBlockerPolyList;
 	TBlockerPolyList m_aPolys;
 
-	bool GetPolysInSphere(const LTVector &vCenter, float fRadius, TIntList *pResults);
+	// Bounding volume hierarchy over the polys, built on load.  A node's box
+	// encloses the m_vCenter/m_fRadius sphere of each poly under it, which is all
+	// GetPolysInSphere looks at.  Nodes are stored depth first, so the first
+	// child of an interior node is the next node in the list.
+	struct SBlockerNode
+	{
+		LTVector m_vMin, m_vMax;
+		// Leaf: first entry in m_aNodePolys.  Interior: index of the second child.
+		uint32 m_nIndex;
+		// Number of polys in a leaf, 0 for an interior node
+		uint32 m_nNumPolys;
+	};
+	typedef std::vector<SBlockerNode> TBlockerNodeList;
+	TBlockerNodeList m_aNodes;
+	std::vector<int> m_aNodePolys;
+
+	void BuildTree();
+	void BuildTree_R(uint32 nFirst, uint32 nCount);
+
+	bool GetPolysInSphere(const LTVector &vCenter, float fRadius, TIntList *pResults) const;
+
+	// Sweep the player along vMoveDir against the polys in aPolySet and find the
+	// earliest hit.  pTime is the distance along the move.
+	bool FindEarliestIntersection(
+		const TIntList &aPolySet, // Polys to test, in index order
+		const LTVector &vStartPt, // Starting point
+		const LTVector &vMoveDir, // Moving direction (unit)
+		float fMoveMag, // Movement distance
+		const LTVector &vDims, // Dims of the player
+		float *pTime, // Distance to the first intersection
+		LTVector *pNormal // Normal of first intersection
+	);
+
+	// IntersectPacket for up to k_nMaxBlockerPacket sweeps
+	uint32 IntersectPacketChunk(const SSweep *pSweeps, SSweepResult *pResults, uint32 nNumSweeps);
 
 	bool CalcPolyIntersectTime(
 		const CBlockerPoly &cPoly, // The poly we're testing
@@ -300,6 +346,8 @@ CWorldBlockerData::~CWorldBlockerData()
 void CWorldBlockerData::Term()
 {
 	m_aPolys.clear();
+	m_aNodes.clear();
+	m_aNodePolys.clear();
 }
 
 ELoadWorldStatus CWorldBlockerData::Load(ILTStream *pStream)
@@ -320,24 +368,172 @@ ELoadWorldStatus CWorldBlockerData::Load(ILTStream *pStream)
 	*pStream >> nDummy;
 	ASSERT(nDummy == 0);
 
+	BuildTree();
+
 	return LoadWorld_Ok;
 }
 
-// Get the polys touching a sphere
-bool CWorldBlockerData::GetPolysInSphere(const LTVector &vCenter, float fRadius, TIntList *pResults)
+// Most polys in a leaf of the blocker tree
+#define k_nMaxBlockerLeafPolys	4
+// Deepest the blocker tree can get.  Every split is at the median, so this covers
+// far more polys than a world will ever have.
+#define k_nMaxBlockerTreeDepth	64
+// Most sweeps IntersectPacket walks the tree with at once (bits in a uint32 mask)
+#define k_nMaxBlockerPacket		32
+
+// Orders poly indices by their center along one axis, for splitting tree nodes
+struct SBlockerPolyAxisLess
+{
+	SBlockerPolyAxisLess(const std::vector<CBlockerPoly> &aPolys, uint32 nAxis) :
+		m_aPolys(aPolys), m_nAxis(nAxis) {}
+	bool operator()(int nLeft, int nRight) const
+	{
+		return m_aPolys[nLeft].m_vCenter[m_nAxis] < m_aPolys[nRight].m_vCenter[m_nAxis];
+	}
+	const std::vector<CBlockerPoly> &m_aPolys;
+	uint32 m_nAxis;
+};
+
+void CWorldBlockerData::BuildTree()
+{
+	m_aNodes.clear();
+	m_aNodePolys.clear();
+
+	if (m_aPolys.empty())
+		return;
+
+	LT_MEM_TRACK_ALLOC(m_aNodePolys.resize(m_aPolys.size()), LT_MEM_TYPE_WORLD);
+	for (uint32 nCurPoly = 0; nCurPoly < m_aPolys.size(); ++nCurPoly)
+		m_aNodePolys[nCurPoly] = (int)nCurPoly;
+
+	// A binary tree with at least one poly per leaf has fewer than twice as many nodes as polys
+	LT_MEM_TRACK_ALLOC(m_aNodes.reserve(m_aPolys.size() * 2), LT_MEM_TYPE_WORLD);
+	BuildTree_R(0, m_aNodePolys.size());
+}
+
+void CWorldBlockerData::BuildTree_R(uint32 nFirst, uint32 nCount)
+{
+	ASSERT(nCount);
+
+	uint32 nNode = m_aNodes.size();
+	m_aNodes.push_back(SBlockerNode());
+
+	// Get the bounds of the poly spheres, and of their centers for picking the split
+	LTVector vMin, vMax, vCenterMin, vCenterMax;
+	for (uint32 nCurPoly = nFirst; nCurPoly < (nFirst + nCount); ++nCurPoly)
+	{
+		const CBlockerPoly &cPoly = m_aPolys[m_aNodePolys[nCurPoly]];
+		LTVector vRadius(cPoly.m_fRadius, cPoly.m_fRadius, cPoly.m_fRadius);
+		LTVector vPolyMin = cPoly.m_vCenter - vRadius;
+		LTVector vPolyMax = cPoly.m_vCenter + vRadius;
+		if (nCurPoly == nFirst)
+		{
+			vMin = vPolyMin;
+			vMax = vPolyMax;
+			vCenterMin = vCenterMax = cPoly.m_vCenter;
+			continue;
+		}
+		VEC_MIN(vMin, vMin, vPolyMin);
+		VEC_MAX(vMax, vMax, vPolyMax);
+		VEC_MIN(vCenterMin, vCenterMin, cPoly.m_vCenter);
+		VEC_MAX(vCenterMax, vCenterMax, cPoly.m_vCenter);
+	}
+	m_aNodes[nNode].m_vMin = vMin;
+	m_aNodes[nNode].m_vMax = vMax;
+
+	if (nCount <= k_nMaxBlockerLeafPolys)
+	{
+		m_aNodes[nNode].m_nIndex = nFirst;
+		m_aNodes[nNode].m_nNumPolys = nCount;
+		return;
+	}
+
+	// Split at the median along the longest axis of the centers
+	LTVector vExtents = vCenterMax - vCenterMin;
+	uint32 nAxis = 0;
+	if (vExtents.y > vExtents[nAxis])
+		nAxis = 1;
+	if (vExtents.z > vExtents[nAxis])
+		nAxis = 2;
+
+	uint32 nHalf = nCount / 2;
+	std::vector<int>::iterator iFirst = m_aNodePolys.begin() + nFirst;
+	std::nth_element(iFirst, iFirst + nHalf, iFirst + nCount, SBlockerPolyAxisLess(m_aPolys, nAxis));
+
+	m_aNodes[nNode].m_nNumPolys = 0;
+	BuildTree_R(nFirst, nHalf);
+	m_aNodes[nNode].m_nIndex = m_aNodes.size();
+	BuildTree_R(nFirst + nHalf, nCount - nHalf);
+}
+
+// Does a sphere touch a node's box?
+inline bool DoesSphereTouchBlockerBox(const LTVector &vCenter, float fRadiusSqr, const LTVector &vMin, const LTVector &vMax)
+{
+	float fDistSqr = 0.0f;
+	for (uint32 nAxis = 0; nAxis < 3; ++nAxis)
+	{
+		float fOutside = 0.0f;
+		if (vCenter[nAxis] < vMin[nAxis])
+			fOutside = vMin[nAxis] - vCenter[nAxis];
+		else if (vCenter[nAxis] > vMax[nAxis])
+			fOutside = vCenter[nAxis] - vMax[nAxis];
+		fDistSqr += fOutside * fOutside;
+	}
+	return fDistSqr <= fRadiusSqr;
+}
+
+// GetPtDistToCircle is never less than the distance to the center minus the
+// radius, so any poly it accepts has its sphere touching the query sphere.  The
+// tree is walked with a slightly padded query so float rounding can't cull a
+// poly the exact test would have accepted.
+inline float GetBlockerCullRadius(float fRadius)
+{
+	return fRadius * 1.001f + 0.01f;
+}
+
+// Get the polys touching a sphere, in index order
+bool CWorldBlockerData::GetPolysInSphere(const LTVector &vCenter, float fRadius, TIntList *pResults) const
 {
 	ASSERT(pResults);
 
 	uint nOldSize = pResults->size();
 
-	TBlockerPolyList::iterator iCurPoly = m_aPolys.begin();
-	for (int nIndex = 0; iCurPoly != m_aPolys.end(); ++iCurPoly, ++nIndex)
+	if (m_aNodes.empty())
+		return false;
+
+	float fCullRadius = GetBlockerCullRadius(fRadius);
+	float fCullRadiusSqr = fCullRadius * fCullRadius;
+
+	uint32 aStack[k_nMaxBlockerTreeDepth];
+	uint32 nStackSize = 0;
+	aStack[nStackSize++] = 0;
+	while (nStackSize)
 	{
-		float fPolyDist = (*iCurPoly).GetPtDistToCircle(vCenter);
-		if (fPolyDist <= fRadius)
-			pResults->push_back(nIndex);
+		const SBlockerNode &cNode = m_aNodes[aStack[--nStackSize]];
+		if (!DoesSphereTouchBlockerBox(vCenter, fCullRadiusSqr, cNode.m_vMin, cNode.m_vMax))
+			continue;
+
+		if (!cNode.m_nNumPolys)
+		{
+			ASSERT((nStackSize + 2) <= k_nMaxBlockerTreeDepth);
+			aStack[nStackSize++] = cNode.m_nIndex;
+			aStack[nStackSize++] = (uint32)(&cNode - &m_aNodes.front()) + 1;
+			continue;
+		}
+
+		for (uint32 nCurPoly = 0; nCurPoly < cNode.m_nNumPolys; ++nCurPoly)
+		{
+			int nIndex = m_aNodePolys[cNode.m_nIndex + nCurPoly];
+			float fPolyDist = m_aPolys[nIndex].GetPtDistToCircle(vCenter);
+			if (fPolyDist <= fRadius)
+				pResults->push_back(nIndex);
+		}
 	}
 
+	// The polys get tested in the order they're returned, so keep them in the
+	// same order as the poly list for consistent results
+	std::sort(pResults->begin() + nOldSize, pResults->end());
+
 	return nOldSize != pResults->size();
 }
 
@@ -655,16 +851,16 @@ bool CWorldBlockerData::CollidePlayer(
 	if (fMoveMag < 0.0001f)
 		return false;
 
+	CFrameArenaMark cArenaMark;
+
 	// Query a gross estimation of polys that the player "might" touch
-	static TIntList aPolySet;
-	aPolySet.clear();
+	TIntList aPolySet;
 	LTVector vMidPt = (vStartPt + vEndPt) * 0.5f;
 	float fSphereRadius = fMoveMag * 0.5f + vDims.Mag();
 	if (!GetPolysInSphere(vMidPt, fSphereRadius, &aPolySet))
 		return false;
 
-	static TVectorList aRestrictDir;
-	aRestrictDir.clear();
+	TScratchVectorList aRestrictDir;
 	aRestrictDir.reserve(5);
 
 	const float k_fConflictingPlaneEpsilon = -0.001f;
@@ -678,7 +874,7 @@ bool CWorldBlockerData::CollidePlayer(
 		{
 			LTVector vCurNormal = *iCurInputNormal;
 			bool bBadNormal = false;
-			TVectorList::const_iterator iCurTestNormal = aRestrictDir.begin();
+			TScratchVectorList::const_iterator iCurTestNormal = aRestrictDir.begin();
 			for (; iCurTestNormal != aRestrictDir.end(); ++iCurTestNormal)
 			{
 				const LTVector &vRestrictNormal = *iCurTestNormal;
@@ -758,7 +954,7 @@ bool CWorldBlockerData::CollidePlayer(
 			cPlayerRep.m_vOrigin = vCurStartPt + vRepAdj;
 
 			// Add a restriction plane for the intersection
-			TVectorList::iterator iCurPlane = aRestrictDir.begin();
+			TScratchVectorList::iterator iCurPlane = aRestrictDir.begin();
 			bool bBadPlane = false;
 			for (; iCurPlane != aRestrictDir.end(); ++iCurPlane)
 			{
@@ -838,17 +1034,38 @@ bool CWorldBlockerData::Intersect(
 	if (fMoveMag < 0.0001f)
 		return false;
 
+	CFrameArenaMark cArenaMark;
+
 	// Query a gross estimation of polys that the player "might" touch
-	static TIntList aPolySet;
-	aPolySet.clear();
+	TIntList aPolySet;
 	LTVector vMidPt = (vStartPt + vEndPt) * 0.5f;
 	float fSphereRadius = fMoveMag * 0.5f + vDims.Mag();
 	if (!GetPolysInSphere(vMidPt, fSphereRadius, &aPolySet))
 		return false;
 
-	bool bResult = false;
+	float fEarliestTime;
+	LTVector vEarliestPlane;
+	if (!FindEarliestIntersection(aPolySet, vStartPt, vMoveOffset / fMoveMag, fMoveMag, vDims, &fEarliestTime, &vEarliestPlane))
+		return false;
 
-	LTVector vMoveDir = vMoveOffset / fMoveMag;
+	// Return the results
+	*pTime = fEarliestTime / fMoveMag;
+	*pNormal = vEarliestPlane;
+
+	return true;
+}
+
+bool CWorldBlockerData::FindEarliestIntersection(
+		const TIntList &aPolySet,
+		const LTVector &vStartPt,
+		const LTVector &vMoveDir,
+		float fMoveMag,
+		const LTVector &vDims,
+		float *pTime,
+		LTVector *pNormal
+		)
+{
+	bool bResult = false;
 
 	CSweptSphere cPlayerRep;
 	// Make sure the radius encloses the entire dims of the player
@@ -863,8 +1080,8 @@ bool CWorldBlockerData::Intersect(
 	// Find the earliest intersection in the polygons
 	float fEarliestTime = fMoveMag;
 	LTVector vEarliestPlane;
-	TIntList::iterator iCurPoly = aPolySet.begin();
-	for (uint nCurIndex = 0; iCurPoly != aPolySet.end(); ++iCurPoly, ++nCurIndex)
+	TIntList::const_iterator iCurPoly = aPolySet.begin();
+	for (; iCurPoly != aPolySet.end(); ++iCurPoly)
 	{
 		if (*iCurPoly >= (int)m_aPolys.size())
 			continue;
@@ -884,13 +1101,131 @@ bool CWorldBlockerData::Intersect(
 		}
 	}
 
-	// Return the results
 	if (bResult)
 	{
-		*pTime = fEarliestTime / fMoveMag;
+		*pTime = fEarliestTime;
 		*pNormal = vEarliestPlane;
 	}
 
 	return bResult;
 }
 
+uint32 CWorldBlockerData::IntersectPacket(
+		const SSweep *pSweeps,
+		SSweepResult *pResults,
+		uint32 nNumSweeps
+		)
+{
+	uint32 nNumHits = 0;
+	for (uint32 nFirst = 0; nFirst < nNumSweeps; nFirst += k_nMaxBlockerPacket)
+	{
+		uint32 nCount = LTMIN(nNumSweeps - nFirst, (uint32)k_nMaxBlockerPacket);
+		nNumHits += IntersectPacketChunk(&pSweeps[nFirst], &pResults[nFirst], nCount);
+	}
+	return nNumHits;
+}
+
+uint32 CWorldBlockerData::IntersectPacketChunk(const SSweep *pSweeps, SSweepResult *pResults, uint32 nNumSweeps)
+{
+	ASSERT(nNumSweeps <= k_nMaxBlockerPacket);
+
+	CFrameArenaMark cArenaMark;
+
+	// Set up the query sphere of each sweep the same way Intersect does
+	LTVector aCenters[k_nMaxBlockerPacket];
+	float aRadii[k_nMaxBlockerPacket];
+	float aCullRadiiSqr[k_nMaxBlockerPacket];
+	uint32 nActiveMask = 0;
+	for (uint32 nCurSweep = 0; nCurSweep < nNumSweeps; ++nCurSweep)
+	{
+		const SSweep &cSweep = pSweeps[nCurSweep];
+		pResults[nCurSweep].m_bHit = false;
+
+		float fMoveMag = (cSweep.m_vEndPt - cSweep.m_vStartPt).Mag();
+		if (fMoveMag < 0.0001f)
+			continue;
+
+		aCenters[nCurSweep] = (cSweep.m_vStartPt + cSweep.m_vEndPt) * 0.5f;
+		aRadii[nCurSweep] = fMoveMag * 0.5f + cSweep.m_vDims.Mag();
+		float fCullRadius = GetBlockerCullRadius(aRadii[nCurSweep]);
+		aCullRadiiSqr[nCurSweep] = fCullRadius * fCullRadius;
+		nActiveMask |= 1u << nCurSweep;
+	}
+
+	if (!nActiveMask || m_aNodes.empty())
+		return 0;
+
+	// Walk the tree once for the whole packet, carrying the mask of the sweeps
+	// whose query sphere still touches the node.  Each sweep picks up the polys
+	// GetPolysInSphere would have returned for it.
+	TIntList aPolySets[k_nMaxBlockerPacket];
+
+	uint32 aNodeStack[k_nMaxBlockerTreeDepth];
+	uint32 aMaskStack[k_nMaxBlockerTreeDepth];
+	uint32 nStackSize = 0;
+	aNodeStack[nStackSize] = 0;
+	aMaskStack[nStackSize] = nActiveMask;
+	++nStackSize;
+	while (nStackSize)
+	{
+		--nStackSize;
+		uint32 nNode = aNodeStack[nStackSize];
+		const SBlockerNode &cNode = m_aNodes[nNode];
+
+		uint32 nNodeMask = 0;
+		for (uint32 nMask = aMaskStack[nStackSize], nCurSweep = 0; nMask; nMask >>= 1, ++nCurSweep)
+		{
+			if ((nMask & 1) && DoesSphereTouchBlockerBox(aCenters[nCurSweep], aCullRadiiSqr[nCurSweep], cNode.m_vMin, cNode.m_vMax))
+				nNodeMask |= 1u << nCurSweep;
+		}
+		if (!nNodeMask)
+			continue;
+
+		if (!cNode.m_nNumPolys)
+		{
+			ASSERT((nStackSize + 2) <= k_nMaxBlockerTreeDepth);
+			aNodeStack[nStackSize] = cNode.m_nIndex;
+			aMaskStack[nStackSize] = nNodeMask;
+			++nStackSize;
+			aNodeStack[nStackSize] = nNode + 1;
+			aMaskStack[nStackSize] = nNodeMask;
+			++nStackSize;
+			continue;
+		}
+
+		for (uint32 nCurPoly = 0; nCurPoly < cNode.m_nNumPolys; ++nCurPoly)
+		{
+			int nIndex = m_aNodePolys[cNode.m_nIndex + nCurPoly];
+			const CBlockerPoly &cPoly = m_aPolys[nIndex];
+			for (uint32 nMask = nNodeMask, nCurSweep = 0; nMask; nMask >>= 1, ++nCurSweep)
+			{
+				if ((nMask & 1) && (cPoly.GetPtDistToCircle(aCenters[nCurSweep]) <= aRadii[nCurSweep]))
+					aPolySets[nCurSweep].push_back(nIndex);
+			}
+		}
+	}
+
+	// Run the regular intersection on each sweep's polys
+	uint32 nNumHits = 0;
+	for (uint32 nCurSweep = 0; nCurSweep < nNumSweeps; ++nCurSweep)
+	{
+		TIntList &aPolySet = aPolySets[nCurSweep];
+		if (aPolySet.empty())
+			continue;
+		std::sort(aPolySet.begin(), aPolySet.end());
+
+		const SSweep &cSweep = pSweeps[nCurSweep];
+		SSweepResult &cResult = pResults[nCurSweep];
+		LTVector vMoveOffset = cSweep.m_vEndPt - cSweep.m_vStartPt;
+		float fMoveMag = vMoveOffset.Mag();
+		float fEarliestTime;
+		if (FindEarliestIntersection(aPolySet, cSweep.m_vStartPt, vMoveOffset / fMoveMag, fMoveMag, cSweep.m_vDims, &fEarliestTime, &cResult.m_vNormal))
+		{
+			cResult.m_bHit = true;
+			cResult.m_fTime = fEarliestTime / fMoveMag;
+			++nNumHits;
+		}
+	}
+
+	return nNumHits;
+}
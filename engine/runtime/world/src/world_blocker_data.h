@@ -37,6 +37,31 @@ public:
 		float *pTime, // Time of first intersection
 		LTVector *pNormal // Normal of first intersection
 		) = 0;
+
+	// One player movement for IntersectPacket
+	struct SSweep
+	{
+		LTVector m_vStartPt; // Starting point
+		LTVector m_vEndPt; // Ending point
+		LTVector m_vDims; // Dims of the player
+	};
+
+	// The result of an SSweep, same as Intersect would have returned for it
+	struct SSweepResult
+	{
+		bool m_bHit; // Intersect's return value
+		float m_fTime; // Time of first intersection, if m_bHit
+		LTVector m_vNormal; // Normal of first intersection, if m_bHit
+	};
+
+	// Intersect a set of independent movements (i.e. all the players' moves for
+	// a frame) at once, sharing the walk of the blocker tree between them.
+	// Returns the number of sweeps that hit something.
+	virtual uint32 IntersectPacket(
+		const SSweep *pSweeps, // Movements to test
+		SSweepResult *pResults, // One result per sweep
+		uint32 nNumSweeps // Number of sweeps
+		) = 0;
 };
 
 #endif //__WORLD_BLOCKER_DATA_H__
@@ -4,6 +4,12 @@
 
 
 #include "worldtreehelper.h"
+#include "world_tree_bvh.h"
+#include "framearena.h"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
 
 
 // Used by some of the recursive routines.
@@ -33,6 +39,55 @@ public:
 };
 
 
+class ISPacketInfo
+{
+public:
+	typedef std::pair<WorldTreeObj*, uint32> TObjMask;
+
+	NodeObjArray	m_iObjArray;
+	const LTVector	*m_pPts;
+	// Every object visited, in the order it was visited, with the segments
+	// that visited it
+	CFrameArenaVector<TObjMask> m_aObjects;
+};
+
+
+class FindObjReadOnlyInfo
+{
+public:
+	enum { k_nMaxLocalReported = 32 };
+
+	// Has the object already been passed to the callback?  Only needed
+	// for objects in more than one node.
+	bool			WasReported(WorldTreeObj *pObj);
+
+	const FindObjInfo	*m_pInfo;
+
+	// The callback might be filling in a frame arena vector, so these can't
+	// go on the arena.  They're on the stack until there are too many.
+	WorldTreeObj		*m_aLocalReported[k_nMaxLocalReported];
+	uint32				m_nNumLocalReported;
+	std::vector<WorldTreeObj*> m_aReported;
+};
+
+bool FindObjReadOnlyInfo::WasReported(WorldTreeObj *pObj)
+{
+	WorldTreeObj **pLocalEnd = &m_aLocalReported[m_nNumLocalReported];
+	if(std::find(m_aLocalReported, pLocalEnd, pObj) != pLocalEnd)
+		return true;
+
+	if(std::find(m_aReported.begin(), m_aReported.end(), pObj) != m_aReported.end())
+		return true;
+
+	if(m_nNumLocalReported < k_nMaxLocalReported)
+		m_aLocalReported[m_nNumLocalReported++] = pObj;
+	else
+		m_aReported.push_back(pObj);
+
+	return false;
+}
+
+
 static bool IntersectSegment_R(WorldTreeNode *pNode, ISInfo *pInfo);
 
 // -------------------------------------------------------------------------------- //
@@ -172,6 +227,38 @@ static void FindObjectsInBox_R(WorldTreeNode *pNode, FindObjInfo *pInfo)
 	}
 }
 
+// Same as FindObjectsInBox_R, but keeps track of the objects it has seen itself
+// instead of using frame codes.
+static void FindObjectsInBoxReadOnly_R(WorldTreeNode *pNode, FindObjReadOnlyInfo *pInfo)
+{
+	if(pNode->GetNumObjectsOnOrBelow() == 0)
+		return;
+
+	const FindObjInfo *pFind = pInfo->m_pInfo;
+
+	LTLink *pListHead = pNode->m_Objects[pFind->m_iObjArray].AsLTLink();
+	for(LTLink *pCur=pListHead->m_pNext; pCur != pListHead; pCur = pCur->m_pNext)
+	{
+		WorldTreeObj *pObj = (WorldTreeObj*)pCur->m_pData;
+
+		if(!DoBoxesTouch(pObj->GetBBoxMin(), pObj->GetBBoxMax(), pFind->m_Min, pFind->m_Max))
+			continue;
+
+		// Objects in one node can only come up once.  The others are reported
+		// the first time they're seen, which is where the frame codes would let
+		// them through.
+		if(pObj->m_Links[1].m_pNode && pInfo->WasReported(pObj))
+			continue;
+
+		pFind->m_CB(pObj, pFind->m_pCBUser);
+	}
+
+	if(pNode->HasChildren())
+	{
+		FilterBox(&pFind->m_Min, &pFind->m_Max, pNode, (FilterFn_R)FindObjectsInBoxReadOnly_R, pInfo);
+	}
+}
+
 // Intersects the line segment in the specified dimension on fPlane's plane, 
 // then sees if the intersection point is inside the box on iOtherDim1 and iOtherDim2.
 inline bool TestBoxPlane(	const LTVector &pt1, 
@@ -222,38 +309,43 @@ static bool TestBoxBothSides(	const LTVector &pt1,
 }
 
 
-// Does tests to see if the segment intersects the node.  If so, calls IntersectSegment_R
-// on it and returns the value.
-static bool TestNode(WorldTreeNode *pNode, ISInfo *pInfo)
+// Returns true if the segment from pt0 to pt1 goes through the node (on X and Z).
+static bool DoesSegmentTouchNode(WorldTreeNode *pNode, const LTVector &pt0, const LTVector &pt1)
 {
 	PolySide outStatus;
 
 	// Trivial accept.
-	if(base_IsPtInBoxXZ(&pInfo->m_Pts[0], &pNode->GetBBoxMin(), &pNode->GetBBoxMax()) ||
-		base_IsPtInBoxXZ(&pInfo->m_Pts[1], &pNode->GetBBoxMin(), &pNode->GetBBoxMax()))
+	if(base_IsPtInBoxXZ(&pt0, &pNode->GetBBoxMin(), &pNode->GetBBoxMax()) ||
+		base_IsPtInBoxXZ(&pt1, &pNode->GetBBoxMin(), &pNode->GetBBoxMax()))
 	{
-		return IntersectSegment_R(pNode, pInfo);
+		return true;
 	}
-	else
+
+	// If both points are outside on the same side, then the line is outside.
+	outStatus = GetDimBoxStatus(pt0, pt1, pNode->GetBBoxMin(), pNode->GetBBoxMax(), 0);
+	if(outStatus != Intersect)
 	{
-		// If both points are outside on the same side, then the line is outside.
-		outStatus = GetDimBoxStatus(pInfo->m_Pts[0], pInfo->m_Pts[1], pNode->GetBBoxMin(), pNode->GetBBoxMax(), 0);
-		if(outStatus != Intersect)
+		if(outStatus == GetDimBoxStatus(pt0, pt1, pNode->GetBBoxMin(), pNode->GetBBoxMax(), 2))
 		{
-			if(outStatus == GetDimBoxStatus(pInfo->m_Pts[0], pInfo->m_Pts[1], pNode->GetBBoxMin(), pNode->GetBBoxMax(), 2))
-			{
-				// Trivial reject.
-				return false;
-			}
-		}
-		
-		// Allllllllllll-righty, we'll do the extensive test!
-		if(TestBoxBothSides(pInfo->m_Pts[0], pInfo->m_Pts[1], pNode->GetBBoxMin(), pNode->GetBBoxMax(), 0, 2) ||
-			TestBoxBothSides(pInfo->m_Pts[0], pInfo->m_Pts[1], pNode->GetBBoxMin(), pNode->GetBBoxMax(), 2, 0))
-		{
-			return IntersectSegment_R(pNode, pInfo);
+			// Trivial reject.
+			return false;
 		}
 	}
+	
+	// Allllllllllll-righty, we'll do the extensive test!
+	return TestBoxBothSides(pt0, pt1, pNode->GetBBoxMin(), pNode->GetBBoxMax(), 0, 2) ||
+		TestBoxBothSides(pt0, pt1, pNode->GetBBoxMin(), pNode->GetBBoxMax(), 2, 0);
+}
+
+
+// Does tests to see if the segment intersects the node.  If so, calls IntersectSegment_R
+// on it and returns the value.
+static bool TestNode(WorldTreeNode *pNode, ISInfo *pInfo)
+{
+	if(DoesSegmentTouchNode(pNode, pInfo->m_Pts[0], pInfo->m_Pts[1]))
+	{
+		return IntersectSegment_R(pNode, pInfo);
+	}
 
 	return false;
 }
@@ -313,6 +405,96 @@ static bool IntersectSegment_R(WorldTreeNode *pNode, ISInfo *pInfo)
 	return bIntersected;
 }
 
+// Filters a group of segments down the tree together.  nSegmentMask has the
+// segments which go through this node.
+static void IntersectSegments_R(WorldTreeNode *pNode, ISPacketInfo *pInfo, uint32 nSegmentMask)
+{
+	LTLink *pCur, *pListHead;
+
+	// Remember the objects in this node.  An object can be in more than one
+	// node, so they're merged together afterwards.
+	pListHead = pNode->m_Objects[pInfo->m_iObjArray].AsLTLink();
+	for(pCur=pListHead->m_pNext; pCur != pListHead; pCur = pCur->m_pNext)
+	{
+		pInfo->m_aObjects.push_back(ISPacketInfo::TObjMask((WorldTreeObj*)pCur->m_pData, nSegmentMask));
+	}
+
+	if(!pNode->HasChildren())
+		return;
+
+	// IntersectSegment goes through the children front to back from where the
+	// segment starts.  Split the segments up by which quarter of the node they
+	// start in so each one goes through the children in that same order.
+	uint32 aQuarterMasks[MAX_WTNODE_CHILDREN];
+	memset(aQuarterMasks, 0, sizeof(aQuarterMasks));
+
+	for(uint32 iSegment=0; iSegment < MAX_IS_PACKET_SEGMENTS; iSegment++)
+	{
+		uint32 nSegmentBit = 1u << iSegment;
+		if(!(nSegmentMask & nSegmentBit))
+			continue;
+
+		const LTVector &vStart = pInfo->m_pPts[iSegment * 2];
+		int iX = vStart.x > pNode->GetCenterX();
+		int iZ = vStart.z > pNode->GetCenterZ();
+		aQuarterMasks[iX * 2 + iZ] |= nSegmentBit;
+	}
+
+	for(uint32 iQuarter=0; iQuarter < MAX_WTNODE_CHILDREN; iQuarter++)
+	{
+		uint32 nQuarterMask = aQuarterMasks[iQuarter];
+		if(!nQuarterMask)
+			continue;
+
+		int iX = iQuarter / 2;
+		int iZ = iQuarter % 2;
+		WorldTreeNode *aChildren[MAX_WTNODE_CHILDREN] =
+		{
+			pNode->GetChild(iX, iZ),
+			pNode->GetChild(!iX, iZ),
+			pNode->GetChild(iX, !iZ),
+			pNode->GetChild(!iX, !iZ)
+		};
+
+		for(uint32 iChild=0; iChild < MAX_WTNODE_CHILDREN; iChild++)
+		{
+			WorldTreeNode *pChild = aChildren[iChild];
+			if(pChild->GetNumObjectsOnOrBelow() == 0)
+				continue;
+
+			uint32 nChildMask = 0;
+			for(uint32 iSegment=0; iSegment < MAX_IS_PACKET_SEGMENTS; iSegment++)
+			{
+				uint32 nSegmentBit = 1u << iSegment;
+				if(!(nQuarterMask & nSegmentBit))
+					continue;
+
+				if(DoesSegmentTouchNode(pChild, pInfo->m_pPts[iSegment * 2], pInfo->m_pPts[iSegment * 2 + 1]))
+					nChildMask |= nSegmentBit;
+			}
+
+			if(nChildMask)
+			{
+				IntersectSegments_R(pChild, pInfo, nChildMask);
+			}
+		}
+	}
+}
+
+// Sorts the indices of the objects visited by IntersectSegments so each object's
+// entries are together, and in the order they were visited
+struct ISPacketObjIndexLess
+{
+	const ISPacketInfo::TObjMask *m_pObjects;
+
+	bool operator()(uint32 nLHS, uint32 nRHS) const
+	{
+		if(m_pObjects[nLHS].first != m_pObjects[nRHS].first)
+			return m_pObjects[nLHS].first < m_pObjects[nRHS].first;
+		return nLHS < nRHS;
+	}
+};
+
 // -------------------------------------------------------------------------------- //
 // WorldTreeObj.
 // -------------------------------------------------------------------------------- //
@@ -333,6 +515,9 @@ WorldTreeObj::WorldTreeObj(WTObjType objType)
 
 	m_ObjType = objType;
 	m_WTFrameCode = FRAMECODE_NOTINTREE;
+
+	m_pBVH = NULL;
+	m_iBVHLeaf = BVH_NULL_NODE;
 }
 
 
@@ -350,6 +535,11 @@ void WorldTreeObj::RemoveFromWorldTree()
 		WTObjLink *pLink = &m_Links[i];
 		WorldTreeNode::RemoveLink(pLink);
 	}
+
+	if(m_pBVH)
+	{
+		m_pBVH->RemoveObject(this);
+	}
 }
 
 
@@ -539,7 +729,8 @@ void WorldTreeNode::AddObjectToList(WTObjLink *pLink, NodeObjArray iArray)
 WorldTree::WorldTree() :
 	m_pHelper(NULL),
 	m_pNodes(NULL),
-	m_nNumNodes(1)
+	m_nNumNodes(1),
+	m_pBVH(NULL)
 {
 	m_AlwaysVisObjects.TieOff();
 }
@@ -560,6 +751,20 @@ void WorldTree::InitWorldTree(WorldTreeHelper *pHelper)
 
 void WorldTree::Term()
 {
+	//take everything out of the BVH and go back to the quadtree
+	if(m_pBVH)
+	{
+		std::vector<WorldTreeObj*> aObjects;
+		m_pBVH->GetObjects(aObjects);
+		for(uint32 i=0; i < aObjects.size(); i++)
+		{
+			aObjects[i]->RemoveFromWorldTree();
+		}
+
+		delete m_pBVH;
+		m_pBVH = NULL;
+	}
+
 	//make sure to release our memory
 	delete [] m_pNodes;
 	m_pNodes = NULL;
@@ -586,6 +791,22 @@ void WorldTree::InsertObject2(WorldTreeObj *pObj,
 	FilterObjInfo foInfo;
 	LTVector vDiff;
 
+	// Objects that are already in the BVH usually just need their leaf updated.
+	if(m_pBVH && (pObj->m_pBVH == m_pBVH) && (iArray == NOA_Objects))
+	{
+		pObj->m_WTFrameCode = FRAMECODE_NOTINTREE;
+
+		if(pObj->InsertSpecial(this))
+		{
+			m_pBVH->RemoveObject(pObj);
+		}
+		else
+		{
+			m_pBVH->MoveObject(pObj, vMin, vMax);
+		}
+		return;
+	}
+
 	pObj->RemoveFromWorldTree();
 
 	vDiff = vMax - vMin;
@@ -599,7 +820,14 @@ void WorldTree::InsertObject2(WorldTreeObj *pObj,
 
 	if(!pObj->InsertSpecial(this))
 	{
-		FilterObj_R(&m_RootNode, &foInfo);
+		if(m_pBVH && (iArray == NOA_Objects))
+		{
+			m_pBVH->InsertObject(pObj, vMin, vMax);
+		}
+		else
+		{
+			FilterObj_R(&m_RootNode, &foInfo);
+		}
 	}
 }
 
@@ -625,6 +853,25 @@ void WorldTree::FindObjectsInBox2(FindObjInfo *pInfo)
 
 	pInfo->m_pTree = this;
 	FindObjectsInBox_R(&m_RootNode, pInfo);
+
+	if(m_pBVH && (pInfo->m_iObjArray == NOA_Objects))
+	{
+		m_pBVH->FindObjectsInBox(pInfo->m_Min, pInfo->m_Max, m_nTempFrameCode, pInfo->m_CB, pInfo->m_pCBUser);
+	}
+}
+
+
+void WorldTree::FindObjectsInBoxReadOnly(const FindObjInfo *pInfo) const
+{
+	FindObjReadOnlyInfo cInfo;
+	cInfo.m_pInfo = pInfo;
+	cInfo.m_nNumLocalReported = 0;
+	FindObjectsInBoxReadOnly_R(const_cast<WorldTreeNode*>(&m_RootNode), &cInfo);
+
+	if(m_pBVH && (pInfo->m_iObjArray == NOA_Objects))
+	{
+		m_pBVH->FindObjectsInBoxReadOnly(pInfo->m_Min, pInfo->m_Max, pInfo->m_CB, pInfo->m_pCBUser);
+	}
 }
 
 
@@ -652,6 +899,73 @@ void WorldTree::IntersectSegment(const LTVector *pPt1, const LTVector *pPt2,
 	isInfo.m_pCBUser = pCBUser;
 
 	IntersectSegment_R(&m_RootNode, &isInfo);
+
+	if(m_pBVH && (iArray == NOA_Objects))
+	{
+		m_pBVH->IntersectSegment(*pPt1, *pPt2, m_nTempFrameCode, cb, pCBUser);
+	}
+}
+
+void WorldTree::IntersectSegments(const LTVector *pPts, uint32 nSegmentMask, 
+	ISPacketCallback cb, void *pCBUser, NodeObjArray iArray)
+{
+	if(!nSegmentMask)
+		return;
+
+	CFrameArenaMark cArenaMark;
+	CFrameArena &cArena = cArenaMark.GetArena();
+
+	ISPacketInfo isInfo;
+
+	isInfo.m_iObjArray = iArray;
+	isInfo.m_pPts = pPts;
+
+	// Nothing is tested against the root node, same as IntersectSegment
+	IntersectSegments_R(&m_RootNode, &isInfo, nSegmentMask);
+
+	// An object in more than one node only goes to each segment the first time
+	// that segment got to it, like the frame code check in IntersectSegment.  Sort
+	// the entries by object to find the repeats, then take the segments that have
+	// already seen the object out of the later entries.
+	uint32 nNumObjects = (uint32)isInfo.m_aObjects.size();
+	ISPacketInfo::TObjMask *pObjects = isInfo.m_aObjects.data();
+
+	uint32 *pOrder = cArena.AllocArray<uint32>(nNumObjects);
+	for(uint32 iCur=0; iCur < nNumObjects; iCur++)
+	{
+		pOrder[iCur] = iCur;
+	}
+
+	ISPacketObjIndexLess cLess;
+	cLess.m_pObjects = pObjects;
+	std::sort(pOrder, pOrder + nNumObjects, cLess);
+
+	for(uint32 iCur=0; iCur < nNumObjects; )
+	{
+		WorldTreeObj *pObj = pObjects[pOrder[iCur]].first;
+		uint32 nSeenMask = 0;
+		for(; (iCur < nNumObjects) && (pObjects[pOrder[iCur]].first == pObj); iCur++)
+		{
+			uint32 &nEntryMask = pObjects[pOrder[iCur]].second;
+			uint32 nNewMask = nEntryMask & ~nSeenMask;
+			nSeenMask |= nEntryMask;
+			nEntryMask = nNewMask;
+		}
+	}
+
+	// And call back in the order the objects were visited
+	for(uint32 iCur=0; iCur < nNumObjects; iCur++)
+	{
+		if(pObjects[iCur].second)
+		{
+			cb(pObjects[iCur].first, pObjects[iCur].second, pCBUser);
+		}
+	}
+
+	if(m_pBVH && (iArray == NOA_Objects))
+	{
+		m_pBVH->IntersectSegments(pPts, nSegmentMask, cb, pCBUser);
+	}
 }
 
 bool WorldTree::Inherit(const WorldTree *pOther) 
@@ -766,3 +1080,161 @@ void WorldTree::RemoveAlwaysVisObject(WorldTreeObj *pObj)
 
 
 
+// Adds the objects on the node and the nodes below it to the list.
+static void GetNodeObjects_R(const WorldTreeNode *pNode, std::vector<WorldTreeObj*> &aObjects)
+{
+	if(pNode->GetNumObjectsOnOrBelow() == 0)
+		return;
+
+	const CheapLTLink *pListHead = &pNode->m_Objects[NOA_Objects];
+	for(const LTLink *pCur=pListHead->m_pNext; pCur != (const LTLink*)pListHead; pCur = pCur->m_pNext)
+	{
+		aObjects.push_back((WorldTreeObj*)pCur->m_pData);
+	}
+
+	if(pNode->HasChildren())
+	{
+		for(uint32 i=0; i < MAX_WTNODE_CHILDREN; i++)
+		{
+			GetNodeObjects_R(pNode->GetChild(i), aObjects);
+		}
+	}
+}
+
+// All the objects in NOA_Objects, in the nodes and the BVH.  An object in more
+// than one node is only in the list once.
+static void GetTreeObjects(const WorldTree *pTree, std::vector<WorldTreeObj*> &aObjects)
+{
+	GetNodeObjects_R(pTree->GetRootNode(), aObjects);
+
+	std::sort(aObjects.begin(), aObjects.end());
+	aObjects.erase(std::unique(aObjects.begin(), aObjects.end()), aObjects.end());
+
+	if(pTree->GetBVH())
+	{
+		pTree->GetBVH()->GetObjects(aObjects);
+	}
+}
+
+void WorldTree::SetUseBVH(bool bUseBVH)
+{
+	if(bUseBVH == IsUsingBVH())
+		return;
+
+	// Take everything out, switch over, and put it all back in.
+	std::vector<WorldTreeObj*> aObjects;
+	GetTreeObjects(this, aObjects);
+
+	for(uint32 i=0; i < aObjects.size(); i++)
+	{
+		aObjects[i]->RemoveFromWorldTree();
+	}
+
+	if(bUseBVH)
+	{
+		LT_MEM_TRACK_ALLOC(m_pBVH = new WorldTreeBVH, LT_MEM_TYPE_WORLDTREE);
+	}
+	else
+	{
+		delete m_pBVH;
+		m_pBVH = NULL;
+	}
+
+	for(uint32 i=0; i < aObjects.size(); i++)
+	{
+		InsertObject(aObjects[i]);
+	}
+}
+
+
+// Counts what the benchmark queries find.
+static void BenchBoxCB(WorldTreeObj *pObj, void *pUser)
+{
+	++*(uint32*)pUser;
+}
+
+static bool BenchSegmentCB(WorldTreeObj *pObj, void *pUser)
+{
+	++*(uint32*)pUser;
+	return false;
+}
+
+inline float GetBenchSeconds(const std::chrono::steady_clock::time_point &cStart)
+{
+	return std::chrono::duration<float>(std::chrono::steady_clock::now() - cStart).count();
+}
+
+// Runs the benchmark queries against the tree as it is now.
+static void RunBenchmark(WorldTree *pTree, const std::vector<WorldTreeObj*> &aObjects, WTBenchResults *pResults)
+{
+	memset(pResults, 0, sizeof(*pResults));
+
+	uint32 nNumObjects = (uint32)aObjects.size();
+	if(!nNumObjects)
+		return;
+
+	// Boxes a little bigger than the object, which is about what moving it a frame covers
+	LTVector vBoxGrow(64.0f, 64.0f, 64.0f);
+
+	std::chrono::steady_clock::time_point cStart = std::chrono::steady_clock::now();
+	for(uint32 i=0; i < nNumObjects; i++)
+	{
+		LTVector vMin = aObjects[i]->GetBBoxMin() - vBoxGrow;
+		LTVector vMax = aObjects[i]->GetBBoxMax() + vBoxGrow;
+		pTree->FindObjectsInBox(&vMin, &vMax, BenchBoxCB, &pResults->m_nBoxObjects);
+	}
+	pResults->m_fBoxTime = GetBenchSeconds(cStart);
+	pResults->m_nBoxQueries = nNumObjects;
+
+	// Pair each object up with the one halfway around the list, so the
+	// segments go all over the level
+	cStart = std::chrono::steady_clock::now();
+	for(uint32 i=0; i < nNumObjects; i++)
+	{
+		WorldTreeObj *pFrom = aObjects[i];
+		WorldTreeObj *pTo = aObjects[(i + nNumObjects / 2) % nNumObjects];
+
+		LTVector vFrom = (pFrom->GetBBoxMin() + pFrom->GetBBoxMax()) * 0.5f;
+		LTVector vTo = (pTo->GetBBoxMin() + pTo->GetBBoxMax()) * 0.5f;
+		pTree->IntersectSegment(&vFrom, &vTo, BenchSegmentCB, &pResults->m_nSegmentObjects);
+	}
+	pResults->m_fSegmentTime = GetBenchSeconds(cStart);
+	pResults->m_nSegmentQueries = nNumObjects;
+
+	LTVector vMoveOffset(8.0f, 0.0f, 8.0f);
+
+	cStart = std::chrono::steady_clock::now();
+	for(uint32 i=0; i < nNumObjects; i++)
+	{
+		WorldTreeObj *pObj = aObjects[i];
+		pTree->InsertObject2(pObj, pObj->GetBBoxMin() + vMoveOffset, pObj->GetBBoxMax() + vMoveOffset);
+		pTree->InsertObject(pObj);
+	}
+	pResults->m_fMoveTime = GetBenchSeconds(cStart);
+	pResults->m_nMoves = nNumObjects * 2;
+}
+
+void WorldTree::Benchmark(uint32 nMaxObjects, WTBenchResults *pQuadTree, WTBenchResults *pBVH)
+{
+	bool bWasUsingBVH = IsUsingBVH();
+
+	std::vector<WorldTreeObj*> aAllObjects;
+	GetTreeObjects(this, aAllObjects);
+
+	// Spread the ones that get used over the whole list
+	std::vector<WorldTreeObj*> aObjects;
+	uint32 nNumObjects = LTMIN((uint32)aAllObjects.size(), nMaxObjects);
+	for(uint32 i=0; i < nNumObjects; i++)
+	{
+		aObjects.push_back(aAllObjects[(uint32)((uint64)i * aAllObjects.size() / nNumObjects)]);
+	}
+
+	SetUseBVH(false);
+	RunBenchmark(this, aObjects, pQuadTree);
+
+	SetUseBVH(true);
+	RunBenchmark(this, aObjects, pBVH);
+
+	SetUseBVH(bWasUsingBVH);
+}
+
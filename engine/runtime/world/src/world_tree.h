@@ -8,6 +8,10 @@ searches for objects and geometry start at the root of this tree.
 The tree is currently a quadtree but it's relatively easy to change it to 
 a different structure like an octree.
 
+Objects can go in a WorldTreeBVH instead of the quadtree (see SetUseBVH).  The
+queries look in both, but anything that walks the nodes directly (like the
+renderer) only sees the quadtree.
+
 The tree uses the concept of a Vis Container to allow for different visibility
 schemes.  If an object moves into a node with a vis container object, it is added to
 that object's visibility structure.  When the renderer encounters the node with
@@ -16,6 +20,7 @@ the vis container to output any visible objects.
 */
 
 class WorldTreeHelper;
+class WorldTreeBVH;
 
 
 #define MAX_OBJ_NODE_LINKS      5
@@ -50,6 +55,14 @@ typedef enum
 // assist with early termination.
 typedef bool (*ISCallback)(WorldTreeObj *pObj, void *pUser);
 
+// IntersectSegments callback.  nSegmentMask has a bit set for each of the
+// segments that went through a node the object is in.  An object can come
+// through more than once, but never twice for the same segment.
+typedef void (*ISPacketCallback)(WorldTreeObj *pObj, uint32 nSegmentMask, void *pUser);
+
+// How many segments IntersectSegments can take at once.
+#define MAX_IS_PACKET_SEGMENTS  32
+
 typedef void (*WTObjCallback)(WorldTreeObj *pObj, void *pUser);
 
 
@@ -141,6 +154,10 @@ public:
     // Used in conjunction with WorldTree::m_CurFrameCode.
     // Set to FRAMECODE_NOTINTREE if the object is not in the WorldTree.
     uint32          m_WTFrameCode;
+
+    // The BVH the object is in instead of the nodes (or NULL) and its leaf there.
+    WorldTreeBVH    *m_pBVH;
+    uint32          m_iBVHLeaf;
 };
 
 
@@ -226,6 +243,26 @@ private:
 };
 
 
+// Results from WorldTree::Benchmark for one layout.
+class WTBenchResults
+{
+public:
+    // Boxes around each object, like the ones MoveObject looks for touching objects in.
+    uint32          m_nBoxQueries;
+    uint32          m_nBoxObjects;      // Objects the queries found
+    float           m_fBoxTime;         // Seconds
+
+    // Segments from each object to another one across the level.
+    uint32          m_nSegmentQueries;
+    uint32          m_nSegmentObjects;  // Objects the callback was called for
+    float           m_fSegmentTime;
+
+    // Moving each object a little and back again.
+    uint32          m_nMoves;
+    float           m_fMoveTime;
+};
+
+
 class WorldTree
 {
 public:
@@ -253,6 +290,12 @@ public:
     
     void			FindObjectsInBox2(FindObjInfo *pInfo);
 
+    // Finds the same objects as FindObjectsInBox2, in the same order, but doesn't
+    // touch the frame codes (pInfo->m_pTree isn't filled in).  Any number of threads
+    // can run it at once as long as nothing changes the tree, so the callback can't
+    // move or remove objects.
+    void			FindObjectsInBoxReadOnly(const FindObjInfo *pInfo) const;
+
     // Calls the specified callback for objects touching the specified point.
     void			FindObjectsOnPoint(	const LTVector *pPoint,
 										WTObjCallback cb, void *pCBUser, 
@@ -263,9 +306,31 @@ public:
 										ISCallback cb, void *pCBUser, 
 										NodeObjArray iArray=NOA_Objects);
 
+    // Filters a group of segments down the tree in one pass and calls the callback
+    // for the objects in the nodes that any of them intersect.  pPts has the
+    // start and end points of each segment, and only the segments with their bit
+    // set in nSegmentMask are used.  Each segment sees its objects in the same
+    // order IntersectSegment would give them.  Unlike IntersectSegment, this
+    // doesn't touch the tree's frame codes.  The objects visited are kept on the
+    // frame arena while the callbacks run.
+    void			IntersectSegments(	const LTVector *pPts, uint32 nSegmentMask,
+										ISPacketCallback cb, void *pCBUser,
+										NodeObjArray iArray=NOA_Objects);
+
     // Copy from the other tree.
     bool            Inherit(const WorldTree *pOther);
 
+    // Keep the objects (NOA_Objects only) in a BVH instead of the quadtree.  The
+    // objects already in the tree are moved over.  Term() goes back to the quadtree.
+    void            SetUseBVH(bool bUseBVH);
+    bool            IsUsingBVH() const              { return m_pBVH != NULL; }
+    const WorldTreeBVH*	GetBVH() const				{ return m_pBVH; }
+
+    // Runs the same set of queries, built from up to nMaxObjects of the objects
+    // in the tree, with the objects in the quadtree and then in the BVH.  The
+    // tree is put back the way it was afterwards.
+    void            Benchmark(uint32 nMaxObjects, WTBenchResults *pQuadTree, WTBenchResults *pBVH);
+
     // Load/save the node layout.
     bool            LoadLayout(ILTStream *pStream);
 
@@ -298,6 +363,9 @@ private:
 
 	//our allocated list of nodes (not including the first one)
 	WorldTreeNode*	m_pNodes;
+
+	// Where the objects go if SetUseBVH was called.
+	WorldTreeBVH*	m_pBVH;
 };
 
 
@@ -0,0 +1,346 @@
+#include "bdefs.h"
+#include "world_tree_bvh.h"
+
+
+// How much bigger than the object a leaf's box is on each side, along with
+// an eighth of the object's size.
+#define BVH_LOOSE_MARGIN        16.0f
+
+
+// -------------------------------------------------------------------------------- //
+// Internal helpers.
+// -------------------------------------------------------------------------------- //
+
+inline bool DoBVHBoxesTouch(const LTVector& vMin1, const LTVector& vMax1,
+							const LTVector& vMin2, const LTVector& vMax2)
+{
+	return !(vMin1.x > vMax2.x || vMin1.y > vMax2.y || vMin1.z > vMax2.z ||
+			vMax1.x < vMin2.x || vMax1.y < vMin2.y || vMax1.z < vMin2.z);
+}
+
+// A segment set up for testing against lots of boxes.
+class BVHSegment
+{
+public:
+	void Init(const LTVector& vPt1, const LTVector& vPt2)
+	{
+		m_vStart = vPt1;
+
+		LTVector vDelta = vPt2 - vPt1;
+		for(uint32 iDim=0; iDim < 3; iDim++)
+		{
+			m_bParallel[iDim] = fabs(vDelta[iDim]) < 0.0001f;
+			m_vInvDelta[iDim] = m_bParallel[iDim] ? 0.0f : 1.0f / vDelta[iDim];
+		}
+	}
+
+	// Returns true if the segment touches the box.
+	bool Touches(const LTVector& vMin, const LTVector& vMax) const
+	{
+		float fEnter = 0.0f;
+		float fExit = 1.0f;
+
+		for(uint32 iDim=0; iDim < 3; iDim++)
+		{
+			if(m_bParallel[iDim])
+			{
+				// Parallel to the slab, so it has to start inside it
+				if(m_vStart[iDim] < vMin[iDim] || m_vStart[iDim] > vMax[iDim])
+					return false;
+
+				continue;
+			}
+
+			float fT0 = (vMin[iDim] - m_vStart[iDim]) * m_vInvDelta[iDim];
+			float fT1 = (vMax[iDim] - m_vStart[iDim]) * m_vInvDelta[iDim];
+			if(fT0 > fT1)
+			{
+				float fTemp = fT0;
+				fT0 = fT1;
+				fT1 = fTemp;
+			}
+
+			fEnter = LTMAX(fEnter, fT0);
+			fExit = LTMIN(fExit, fT1);
+			if(fEnter > fExit)
+				return false;
+		}
+
+		return true;
+	}
+
+private:
+	LTVector	m_vStart;
+	LTVector	m_vInvDelta;
+	bool		m_bParallel[3];
+};
+
+
+struct WorldTreeBVH::SBoxQuery
+{
+	LTVector		m_vMin;
+	LTVector		m_vMax;
+	uint32			m_nFrameCode;
+	WTObjCallback	m_CB;
+	void			*m_pCBUser;
+};
+
+struct WorldTreeBVH::SSegmentQuery
+{
+	BVHSegment		m_Segment;
+	uint32			m_nFrameCode;
+	ISCallback		m_CB;
+	void			*m_pCBUser;
+};
+
+struct WorldTreeBVH::SPacketQuery
+{
+	BVHSegment		m_aSegments[MAX_IS_PACKET_SEGMENTS];
+	ISPacketCallback m_CB;
+	void			*m_pCBUser;
+};
+
+
+// -------------------------------------------------------------------------------- //
+// WorldTreeBVH.
+// -------------------------------------------------------------------------------- //
+
+WorldTreeBVH::WorldTreeBVH() :
+	m_Tree(BVH_LOOSE_MARGIN)
+{
+}
+
+WorldTreeBVH::~WorldTreeBVH()
+{
+	Term();
+}
+
+void WorldTreeBVH::Term()
+{
+	// Let go of the objects, so they don't have bad pointers into us.
+	for(uint32 iNode=0; iNode < m_Tree.GetNodeArraySize(); iNode++)
+	{
+		const SNode &cNode = m_Tree.GetNode(iNode);
+		if((cNode.m_nHeight == 0) && cNode.m_pItem)
+		{
+			cNode.m_pItem->m_pBVH = LTNULL;
+			cNode.m_pItem->m_iBVHLeaf = BVH_NULL_NODE;
+		}
+	}
+
+	m_Tree.Clear();
+}
+
+void WorldTreeBVH::InsertObject(WorldTreeObj *pObj, const LTVector& vMin, const LTVector& vMax)
+{
+	ASSERT(!pObj->m_pBVH);
+
+	pObj->m_pBVH = this;
+	pObj->m_iBVHLeaf = m_Tree.Insert(pObj, vMin, vMax);
+}
+
+bool WorldTreeBVH::MoveObject(WorldTreeObj *pObj, const LTVector& vMin, const LTVector& vMax)
+{
+	ASSERT(pObj->m_pBVH == this);
+
+	return m_Tree.Move(pObj->m_iBVHLeaf, vMin, vMax);
+}
+
+void WorldTreeBVH::RemoveObject(WorldTreeObj *pObj)
+{
+	ASSERT(pObj->m_pBVH == this);
+
+	m_Tree.Remove(pObj->m_iBVHLeaf);
+
+	pObj->m_pBVH = LTNULL;
+	pObj->m_iBVHLeaf = BVH_NULL_NODE;
+}
+
+void WorldTreeBVH::FindObjectsInBox(const LTVector& vMin, const LTVector& vMax, uint32 nFrameCode,
+	WTObjCallback cb, void *pCBUser)
+{
+	if(m_Tree.GetRoot() == BVH_NULL_NODE)
+		return;
+
+	SBoxQuery cQuery;
+	cQuery.m_vMin = vMin;
+	cQuery.m_vMax = vMax;
+	cQuery.m_nFrameCode = nFrameCode;
+	cQuery.m_CB = cb;
+	cQuery.m_pCBUser = pCBUser;
+
+	CTree::CQueryLock cLock(&m_Tree);
+	FindObjectsInBox_R(m_Tree.GetRoot(), &cQuery);
+}
+
+void WorldTreeBVH::FindObjectsInBoxReadOnly(const LTVector& vMin, const LTVector& vMax,
+	WTObjCallback cb, void *pCBUser) const
+{
+	if(m_Tree.GetRoot() == BVH_NULL_NODE)
+		return;
+
+	SBoxQuery cQuery;
+	cQuery.m_vMin = vMin;
+	cQuery.m_vMax = vMax;
+	cQuery.m_nFrameCode = 0;
+	cQuery.m_CB = cb;
+	cQuery.m_pCBUser = pCBUser;
+
+	// No query lock, the callback can't change the tree
+	FindObjectsInBoxReadOnly_R(m_Tree.GetRoot(), &cQuery);
+}
+
+void WorldTreeBVH::IntersectSegment(const LTVector& vPt1, const LTVector& vPt2, uint32 nFrameCode,
+	ISCallback cb, void *pCBUser)
+{
+	if(m_Tree.GetRoot() == BVH_NULL_NODE)
+		return;
+
+	SSegmentQuery cQuery;
+	cQuery.m_Segment.Init(vPt1, vPt2);
+	cQuery.m_nFrameCode = nFrameCode;
+	cQuery.m_CB = cb;
+	cQuery.m_pCBUser = pCBUser;
+
+	CTree::CQueryLock cLock(&m_Tree);
+	IntersectSegment_R(m_Tree.GetRoot(), &cQuery);
+}
+
+void WorldTreeBVH::IntersectSegments(const LTVector *pPts, uint32 nSegmentMask,
+	ISPacketCallback cb, void *pCBUser)
+{
+	if((m_Tree.GetRoot() == BVH_NULL_NODE) || !nSegmentMask)
+		return;
+
+	SPacketQuery cQuery;
+	for(uint32 iSegment=0; iSegment < MAX_IS_PACKET_SEGMENTS; iSegment++)
+	{
+		if(!(nSegmentMask & ((uint32)1 << iSegment)))
+			continue;
+
+		cQuery.m_aSegments[iSegment].Init(pPts[iSegment * 2], pPts[iSegment * 2 + 1]);
+	}
+	cQuery.m_CB = cb;
+	cQuery.m_pCBUser = pCBUser;
+
+	CTree::CQueryLock cLock(&m_Tree);
+	IntersectSegments_R(m_Tree.GetRoot(), &cQuery, nSegmentMask);
+}
+
+void WorldTreeBVH::GetObjects(std::vector<WorldTreeObj*> &aObjects) const
+{
+	for(uint32 iNode=0; iNode < m_Tree.GetNodeArraySize(); iNode++)
+	{
+		const SNode &cNode = m_Tree.GetNode(iNode);
+		if((cNode.m_nHeight == 0) && cNode.m_pItem)
+		{
+			aObjects.push_back(cNode.m_pItem);
+		}
+	}
+}
+
+// The callbacks can add to the tree, which can move its nodes, so nothing can
+// hold onto a node across a callback.  The query lock keeps the links from
+// changing and the nodes from being freed, so the indices stay good.
+
+void WorldTreeBVH::FindObjectsInBox_R(uint32 iNode, SBoxQuery *pQuery)
+{
+	const SNode &cNode = m_Tree.GetNode(iNode);
+	if(!DoBVHBoxesTouch(cNode.m_vMin, cNode.m_vMax, pQuery->m_vMin, pQuery->m_vMax))
+		return;
+
+	if(cNode.IsLeaf())
+	{
+		WorldTreeObj *pObj = cNode.m_pItem;
+		if(!pObj || (pObj->m_WTFrameCode == pQuery->m_nFrameCode))
+			return;
+
+		pObj->m_WTFrameCode = pQuery->m_nFrameCode;
+
+		// Do the boxes intersect?
+		if(DoBVHBoxesTouch(pObj->GetBBoxMin(), pObj->GetBBoxMax(), pQuery->m_vMin, pQuery->m_vMax))
+		{
+			pQuery->m_CB(pObj, pQuery->m_pCBUser);
+		}
+		return;
+	}
+
+	uint32 iChild1 = cNode.m_iChildren[1];
+	FindObjectsInBox_R(cNode.m_iChildren[0], pQuery);
+	FindObjectsInBox_R(iChild1, pQuery);
+}
+
+void WorldTreeBVH::FindObjectsInBoxReadOnly_R(uint32 iNode, const SBoxQuery *pQuery) const
+{
+	const SNode &cNode = m_Tree.GetNode(iNode);
+	if(!DoBVHBoxesTouch(cNode.m_vMin, cNode.m_vMax, pQuery->m_vMin, pQuery->m_vMax))
+		return;
+
+	if(cNode.IsLeaf())
+	{
+		// Each object is only in one leaf, so there's nothing to skip
+		WorldTreeObj *pObj = cNode.m_pItem;
+		if(pObj && DoBVHBoxesTouch(pObj->GetBBoxMin(), pObj->GetBBoxMax(), pQuery->m_vMin, pQuery->m_vMax))
+		{
+			pQuery->m_CB(pObj, pQuery->m_pCBUser);
+		}
+		return;
+	}
+
+	FindObjectsInBoxReadOnly_R(cNode.m_iChildren[0], pQuery);
+	FindObjectsInBoxReadOnly_R(cNode.m_iChildren[1], pQuery);
+}
+
+void WorldTreeBVH::IntersectSegment_R(uint32 iNode, SSegmentQuery *pQuery)
+{
+	const SNode &cNode = m_Tree.GetNode(iNode);
+	if(!pQuery->m_Segment.Touches(cNode.m_vMin, cNode.m_vMax))
+		return;
+
+	if(cNode.IsLeaf())
+	{
+		WorldTreeObj *pObj = cNode.m_pItem;
+		if(!pObj || (pObj->m_WTFrameCode == pQuery->m_nFrameCode))
+			return;
+
+		pObj->m_WTFrameCode = pQuery->m_nFrameCode;
+		pQuery->m_CB(pObj, pQuery->m_pCBUser);
+		return;
+	}
+
+	uint32 iChild1 = cNode.m_iChildren[1];
+	IntersectSegment_R(cNode.m_iChildren[0], pQuery);
+	IntersectSegment_R(iChild1, pQuery);
+}
+
+void WorldTreeBVH::IntersectSegments_R(uint32 iNode, SPacketQuery *pQuery, uint32 nSegmentMask)
+{
+	const SNode &cNode = m_Tree.GetNode(iNode);
+
+	uint32 nNodeMask = 0;
+	for(uint32 iSegment=0; iSegment < MAX_IS_PACKET_SEGMENTS; iSegment++)
+	{
+		uint32 nSegmentBit = (uint32)1 << iSegment;
+		if(!(nSegmentMask & nSegmentBit))
+			continue;
+
+		if(pQuery->m_aSegments[iSegment].Touches(cNode.m_vMin, cNode.m_vMax))
+			nNodeMask |= nSegmentBit;
+	}
+
+	if(!nNodeMask)
+		return;
+
+	if(cNode.IsLeaf())
+	{
+		if(cNode.m_pItem)
+		{
+			pQuery->m_CB(cNode.m_pItem, nNodeMask, pQuery->m_pCBUser);
+		}
+		return;
+	}
+
+	uint32 iChild1 = cNode.m_iChildren[1];
+	IntersectSegments_R(cNode.m_iChildren[0], pQuery, nNodeMask);
+	IntersectSegments_R(iChild1, pQuery, nNodeMask);
+}
@@ -0,0 +1,96 @@
+#ifndef __WORLD_TREE_BVH_H__
+#define __WORLD_TREE_BVH_H__
+
+/*
+A dynamic bounding volume hierarchy that a WorldTree can keep its objects in
+instead of the quadtree.
+
+The objects are kept in a CDynamicAABBTree (see dynamicaabbtree.h), whose
+leaves are the objects' boxes grown by a margin, so objects that move a little
+don't change the tree at all.
+
+Unlike the quadtree, the layout doesn't come from the level, so it works the
+same no matter how big the level is or how bunched up the objects are.
+
+The query callbacks can add, move and remove objects, but the tree doesn't
+change shape while a query is walking it.  Those changes are written down and
+made once the outermost query is done.  Until then, added objects aren't found,
+moved ones are found where they were, and removed ones are skipped.
+*/
+
+#include "world_tree.h"
+#include "dynamicaabbtree.h"
+
+#include <vector>
+
+
+#define BVH_NULL_NODE           AABBTREE_NULL_NODE
+
+
+class WorldTreeBVH
+{
+public:
+
+                    WorldTreeBVH();
+                    ~WorldTreeBVH();
+
+    // Takes all the objects out.
+    void            Term();
+
+    // Add an object with the specified box.  The object can't already be in a BVH.
+    void            InsertObject(WorldTreeObj *pObj, const LTVector& vMin, const LTVector& vMax);
+
+    // Update the box of an object that's in the tree.  Returns true if it
+    // had to be reinserted.  The object keeps its leaf.
+    bool            MoveObject(WorldTreeObj *pObj, const LTVector& vMin, const LTVector& vMax);
+
+    void            RemoveObject(WorldTreeObj *pObj);
+
+    // Calls the callback for objects whose boxes touch the box.  Objects that
+    // already have nFrameCode are skipped, and the others get it.
+    void            FindObjectsInBox(	const LTVector& vMin, const LTVector& vMax, uint32 nFrameCode,
+										WTObjCallback cb, void *pCBUser);
+
+    // Same as FindObjectsInBox, but without the frame codes, for
+    // WorldTree::FindObjectsInBoxReadOnly.  The callback can't change the tree.
+    void            FindObjectsInBoxReadOnly(	const LTVector& vMin, const LTVector& vMax,
+												WTObjCallback cb, void *pCBUser) const;
+
+    // Calls the callback for objects whose leaf boxes the segment goes through.
+    // Uses frame codes the same way as FindObjectsInBox.
+    void            IntersectSegment(	const LTVector& vPt1, const LTVector& vPt2, uint32 nFrameCode,
+										ISCallback cb, void *pCBUser);
+
+    // Filters a group of segments down the tree together, like
+    // WorldTree::IntersectSegments.  Each object is only in one leaf, so the
+    // callback is called once per object.
+    void            IntersectSegments(	const LTVector *pPts, uint32 nSegmentMask,
+										ISPacketCallback cb, void *pCBUser);
+
+    // Adds all the objects in the tree to the list.
+    void            GetObjects(std::vector<WorldTreeObj*> &aObjects) const;
+
+    uint32          GetNumObjects() const   { return m_Tree.GetNumItems(); }
+    uint32          GetNumNodes() const     { return m_Tree.GetNumNodes(); }
+    // Number of levels below the root (0 for a single leaf or an empty tree).
+    uint32          GetHeight() const       { return m_Tree.GetHeight(); }
+
+private:
+
+    typedef CDynamicAABBTree<LTVector, WorldTreeObj> CTree;
+    typedef CTree::SNode SNode;
+
+    struct SBoxQuery;
+    struct SSegmentQuery;
+    struct SPacketQuery;
+
+    void            FindObjectsInBox_R(uint32 iNode, SBoxQuery *pQuery);
+    void            FindObjectsInBoxReadOnly_R(uint32 iNode, const SBoxQuery *pQuery) const;
+    void            IntersectSegment_R(uint32 iNode, SSegmentQuery *pQuery);
+    void            IntersectSegments_R(uint32 iNode, SPacketQuery *pQuery, uint32 nSegmentMask);
+
+    CTree           m_Tree;
+};
+
+
+#endif  // __WORLD_TREE_BVH_H__
@@ -1917,6 +1917,23 @@ Used for: Special FX.
 */
     LTRESULT (*SetGlobalLightObject)(HOBJECT hObj);
 
+/*!
+\param pQueries The queries, each set up the same way as for \b IntersectSegment.
+\param pInfos (return) The result of each query.
+\param nQueries The number of queries.
+
+\return The number of queries that hit something.
+
+Run a group of \b IntersectSegment queries in one call.  The queries share
+the walk through the world tree, so this is quicker than calling
+\b IntersectSegment on each one (for example, for all of the line of sight
+checks in a frame).  Queries that don't hit anything get their \b m_hObject
+set to NULL.
+
+Used for: Misc.
+*/
+    uint32 (*IntersectSegments)(IntersectQuery *pQueries, IntersectInfo *pInfos, uint32 nQueries);
+
 };
 
 #endif  //! __ILTSERVER_H__
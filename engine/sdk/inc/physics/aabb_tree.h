@@ -262,5 +262,85 @@ bool AABBTreeBoxIntersect
 );
 
 
+//---------------------------------------------------------------------------//
+/*!
+The most queries AABBTreeBoxSweepN() and AABBTreeBoxIntersectN() can
+make at once.
+*/
+const uint32 AABBTREE_MAX_QUERIES = 8;
+
+
+//---------------------------------------------------------------------------//
+/*!
+\param ti		[Return parameter] Triangle indices, one array per segment.
+\param tc		[Return parameter] Number of triangle's found, per segment.
+\param tc_max	Size of each \b ti[].
+\param n		Number of segments, at most AABBTREE_MAX_QUERIES.
+\param min		Root node minimum.
+\param max		Root node maximum.
+\param node		LTAABB_Node array.
+\param p0		First positions of the swept boxes.
+\param p1		Last positions of the swept boxes.
+\param d		Box half-dimensions, the same for every box.
+\return			\b true if any triangles could have been hit,
+				\b false otherwise.
+
+Do AABBTreeBoxSweep() for \b n boxes with the same dimensions, walking the
+tree once.  Each node is unpacked once for all of them, and each box is only
+tested against the nodes it would have been on its own, so every \b ti[i]
+comes out the same as AABBTreeBoxSweep() would have made it.
+
+\see	AABBTreeBoxSweep()
+
+Used for:  Physics.
+*/
+bool AABBTreeBoxSweepN
+(
+	uint16*				ti[],
+	uint16				tc[],
+	const uint16		tc_max,
+	const uint32		n,
+	const LTVector3f&	min,
+	const LTVector3f&	max,
+	const LTAABB_Node	node[],
+	const LTVector3f	p0[],
+	const LTVector3f	p1[],
+	const LTVector3f&	d
+);
+
+
+//---------------------------------------------------------------------------//
+/*!
+\param ti		[Return parameter] Triangle indices, one array per box.
+\param tc		[Return parameter] Number of triangle's found, per box.
+\param tc_max	Size of each \b ti[].
+\param n		Number of boxes, at most AABBTREE_MAX_QUERIES.
+\param min		Root node minimum.
+\param max		Root node maximum.
+\param node		LTAABB_Node array.
+\param box		The boxes to test.
+\return			\b true if any triangles could have been hit,
+				\b false otherwise.
+
+Do AABBTreeBoxIntersect() for \b n boxes, walking the tree once.  Every
+\b ti[i] comes out the same as AABBTreeBoxIntersect() would have made it.
+
+\see	AABBTreeBoxIntersect()
+
+Used for:  Physics.
+*/
+bool AABBTreeBoxIntersectN
+(
+	uint16*				ti[],
+	uint16				tc[],
+	const uint16		tc_max,
+	const uint32		n,
+	const LTVector3f&	min,
+	const LTVector3f&	max,
+	const LTAABB_Node	node[],
+	const LTAABB		box[]
+);
+
+
 #endif
 //EOF
@@ -11,10 +11,30 @@
 #endif
 
 
+/*!
+The LTCollisionPair data type holds two ILTCollisionObject's that are
+close enough that they might be touching.
+
+\see	ILTCollisionMgr::FindPairs().
+
+Used for:  Physics
+*/
+struct LTCollisionPair
+{
+	ILTCollisionObject*	m_pA;
+	ILTCollisionObject*	m_pB;
+};
+
+
 /*!
 The ILTCollisionMgr interface provides methods for adding and removing
 abstract ILTCollisionObject's to the collision database, as well as
 searching for them, given an HOBJECT.  
+
+The database keeps the objects in a bounding volume hierarchy, so queries
+only test the objects that are near the query.  When an object's position,
+orientation or size changes, Update() must be called so the database knows
+where the object is.
 */
 class ILTCollisionMgr
 #ifndef __NO_INTERFACE_DB__
@@ -138,6 +158,32 @@ public:
 		const LTIntersectInfo::Filter&		iif = LTIntersectInfo::EmptyFilter()
 	) const = 0;
 
+	/*!
+	\param	pairs	[Return parameter] An array of LTCollisionPair structures.
+	\param	n		[Return parameter] The number of pairs.
+	\param	sz		The number of elements in \b pairs.
+	\param	of		Object filter (empty by default).
+	\return			\b true if any pairs were found,
+					\b false otherwise.
+
+	Find every pair of objects whose bounds from \f$ {\bf p}_0 \f$ to
+	\f$ {\bf p}_1 \f$ overlap.  This is only a broad test, so the pairs can
+	be handed to ILTCollisionObject::Hit() or ILTCollisionObject::Intersect()
+	to find out if they really touch.
+	Pairs of static geometry and objects that the filter rejects are skipped.
+
+	\see	LTCollisionPair.
+
+	Used For: Physics.
+	*/
+	virtual bool FindPairs
+	(
+		LTCollisionPair						pairs[],
+		int32&								n,
+		const int32							sz,
+		const ILTCollisionObject::Filter&	cof = ILTCollisionObject::EmptyFilter()
+	) const = 0;
+
 	/*!
 	\param	o	A collision object address.
 
@@ -147,6 +193,17 @@ public:
 	*/
 	virtual void Add( ILTCollisionObject* o ) = 0;
 
+	/*!
+	\param	o	A collision object address.
+
+	Tell the database that \b o has moved, turned or changed size.  Queries
+	won't see the change until this is called.  Debug builds assert if a
+	query runs while an object is outside the bounds the database has for it.
+
+	Used For: Physics.
+	*/
+	virtual void Update( ILTCollisionObject* o ) = 0;
+
 	/*!
 	\param	h	The HOBJECT corresponding to the ILTCollisionObject.
 	\return		A pointer to an ILTCollisionObject, \b NULL if a
@@ -281,6 +281,11 @@ public:
 
 	/*! Object handle, NULL if static world geometry */
 	HOBJECT		m_hObj;
+
+	//NOTE:  If the object is in an ILTCollisionMgr, call its Update()
+	//after changing the positions, orientations or shape, otherwise
+	//queries keep finding the object where it used to be.
+
 	/*! Position at time \f$ t_0 \f$ */
 	LTVector3f	m_P0;
 	/*! Position at time \f$ t_0 + \Delta t \f$ */
@@ -4,6 +4,10 @@
 
 #include "math_phys.h"
 
+#ifndef __COLLISION_DATA_H__
+#include "collision_data.h"
+#endif
+
 
 //---------------------------------------------------------------------------//
 /*!
@@ -174,5 +178,75 @@ bool SphereSegmentIntersect
 );
 
 
+//---------------------------------------------------------------------------//
+/*!
+\param ti	[In/Out] Triangle indices.
+\param tc	Number of triangle indices.
+\param tri	Triangle array.
+\param V	Packed vertex array.
+\param min	Minimum extent of the vertex range.
+\param e	Dimensions of the vertex range.
+\param C0	First sphere position.
+\param C1	Second sphere position.
+\param r	Sphere radius.
+\return		The number of triangles left in \b ti[].
+
+Throw out the triangles in \b ti[] that SphereTriangleSweep() can't report
+a hit for, because the sphere starts behind the triangle's plane or never
+comes within \b r of it.  This only looks at the planes, four or eight
+triangles at a time, so it's much cheaper than the full test.  The
+triangles that are left keep their order.
+
+\see	AABBTreeBoxSweep()
+
+Used For: Physics.
+*/
+uint16 SphereTriangleSweepCull
+(
+	uint16				ti[],
+	const uint16		tc,
+	const LTTriangle	tri[],
+	const LTVector3u16	V[],
+	const LTVector3f&	min,
+	const LTVector3f&	e,
+	const LTVector3f&	C0,
+	const LTVector3f&	C1,
+	const float			r
+);
+
+
+//---------------------------------------------------------------------------//
+/*!
+\param ti	[In/Out] Triangle indices.
+\param tc	Number of triangle indices.
+\param tri	Triangle array.
+\param V	Packed vertex array.
+\param min	Minimum extent of the vertex range.
+\param e	Dimensions of the vertex range.
+\param C	Sphere position.
+\param r	Sphere radius.
+\return		The number of triangles left in \b ti[].
+
+Throw out the triangles in \b ti[] whose planes are farther than \b r from
+\b C, since SphereTriangleIntersect() can't find an intersection with them.
+The triangles that are left keep their order.
+
+\see	AABBTreeBoxIntersect()
+
+Used For: Physics.
+*/
+uint16 SphereTriangleIntersectCull
+(
+	uint16				ti[],
+	const uint16		tc,
+	const LTTriangle	tri[],
+	const LTVector3u16	V[],
+	const LTVector3f&	min,
+	const LTVector3f&	e,
+	const LTVector3f&	C,
+	const float			r
+);
+
+
 #endif
 //EOF